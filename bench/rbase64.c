@@ -0,0 +1,163 @@
+#include <rlib/rlib.h>
+
+#define B64_BENCH_BYTES       (64 * 1024 * 1024)
+#define B64_BENCH_LINESIZE    64
+#define B64_BENCH_CHUNK       1500
+
+static double
+bench_gbps (rsize bytes, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? (double)bytes / (double)cd : 0.0;
+}
+
+static const rchar *
+b64_bench_impl_str (RBase64Impl impl)
+{
+  switch (impl) {
+    case R_BASE64_IMPL_SCALAR:
+      return "scalar";
+    case R_BASE64_IMPL_SSE41:
+      return "sse4.1";
+    case R_BASE64_IMPL_AVX2:
+      return "avx2";
+    default:
+      return "auto";
+  }
+}
+
+static void
+b64_bench_run (RBase64Impl impl, const ruint8 * data, rchar * enc, ruint8 * dec, rsize size)
+{
+  RClockTime t0, t1, t2;
+  rsize i, encsize = 0, iterations = MAX (B64_BENCH_BYTES / size, 1);
+
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++)
+    encsize = r_base64_encode_with_impl (impl, enc, R_BASE64_ENCODED_SIZE (size), data, size);
+  t1 = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++)
+    r_assert_cmpuint (r_base64_decode_with_impl (impl, dec, size, enc, encsize), ==, size);
+  t2 = r_time_get_ts_monotonic ();
+
+  r_print ("\t%-7s %9"RSIZE_FMT" B  encode %6.2f GB/s  decode %6.2f GB/s\n",
+      b64_bench_impl_str (impl), size,
+      bench_gbps (iterations * size, t0, t1), bench_gbps (iterations * encsize, t1, t2));
+}
+
+RTEST_BENCH (rbase64, codec, RTEST_FAST)
+{
+  static const RBase64Impl impls[] = {
+    R_BASE64_IMPL_SCALAR, R_BASE64_IMPL_SSE41, R_BASE64_IMPL_AVX2 };
+  static const rsize sizes[] = { 32, 256, 1500, 64 * 1024, 1024 * 1024 };
+  rsize i, j, max = sizes[R_N_ELEMENTS (sizes) - 1];
+  ruint8 * data, * dec;
+  rchar * enc;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- GB/s of the input side\n",
+      R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((data = r_malloc (max)), !=, NULL);
+  r_assert_cmpptr ((dec = r_malloc (max)), !=, NULL);
+  r_assert_cmpptr ((enc = r_malloc (R_BASE64_ENCODED_SIZE (max))), !=, NULL);
+  for (i = 0; i < max; i++)
+    data[i] = (ruint8)(i * 167 + (i >> 9));
+
+  for (i = 0; i < R_N_ELEMENTS (impls); i++) {
+    if (!r_base64_impl_available (impls[i]))
+      continue;
+    for (j = 0; j < R_N_ELEMENTS (sizes); j++)
+      b64_bench_run (impls[i], data, enc, dec, sizes[j]);
+  }
+
+  r_free (enc);
+  r_free (dec);
+  r_free (data);
+}
+RTEST_END;
+
+/* PEM style text, 64 chars and a newline per line */
+RTEST_BENCH (rbase64, lines, RTEST_FAST)
+{
+  RClockTime t0, t1, t2;
+  rsize i, encsize, decsize = 0, size = 1024 * 1024;
+  rsize iterations = B64_BENCH_BYTES / size;
+  ruint8 * data, * dec = NULL;
+  rchar * enc = NULL;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %"RSIZE_FMT" B in %u char lines\n",
+      R_TIME_ARGS (0), R_STRFUNC, size, B64_BENCH_LINESIZE);
+
+  r_assert_cmpptr ((data = r_malloc (size)), !=, NULL);
+  for (i = 0; i < size; i++)
+    data[i] = (ruint8)(i * 167 + (i >> 9));
+
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++) {
+    r_free (enc);
+    enc = r_base64_encode_dup_full (data, size, B64_BENCH_LINESIZE, &encsize);
+  }
+  t1 = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++) {
+    r_free (dec);
+    dec = r_base64_decode_dup (enc, encsize, &decsize);
+  }
+  t2 = r_time_get_ts_monotonic ();
+
+  r_assert_cmpuint (decsize, ==, size);
+  r_assert_cmpmem (dec, ==, data, size);
+  r_print ("\tencode_dup_full %6.2f GB/s  decode_dup %6.2f GB/s\n",
+      bench_gbps (iterations * size, t0, t1), bench_gbps (iterations * encsize, t1, t2));
+
+  r_free (enc);
+  r_free (dec);
+  r_free (data);
+}
+RTEST_END;
+
+/* An RBuffer of packet sized RMems against merging it first */
+RTEST_BENCH (rbase64, buffer, RTEST_FAST)
+{
+  RBuffer * buf;
+  RClockTime t0, t1, t2;
+  rsize i, encsize = 0, size = 1024 * 1024;
+  rsize iterations = B64_BENCH_BYTES / size;
+  ruint8 * data;
+  rchar * enc;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %"RSIZE_FMT" B in %u B RMems\n",
+      R_TIME_ARGS (0), R_STRFUNC, size, B64_BENCH_CHUNK);
+
+  r_assert_cmpptr ((data = r_malloc (size)), !=, NULL);
+  for (i = 0; i < size; i++)
+    data[i] = (ruint8)(i * 167 + (i >> 9));
+  r_assert_cmpptr ((buf = r_buffer_new ()), !=, NULL);
+  for (i = 0; i < size; i += B64_BENCH_CHUNK) {
+    RBuffer * part = r_buffer_new_dup (data + i, MIN (B64_BENCH_CHUNK, size - i));
+    r_assert (r_buffer_append_mem_from_buffer (buf, part));
+    r_buffer_unref (part);
+  }
+
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++) {
+    r_assert_cmpptr ((enc = r_base64_encode_buffer_dup (buf, &encsize)), !=, NULL);
+    r_free (enc);
+  }
+  t1 = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++) {
+    rsize flatsize;
+    rpointer flat = r_buffer_extract_dup (buf, 0, -1, &flatsize);
+    r_assert_cmpptr ((enc = r_base64_encode_dup (flat, flatsize, &encsize)), !=, NULL);
+    r_free (enc);
+    r_free (flat);
+  }
+  t2 = r_time_get_ts_monotonic ();
+
+  r_print ("\t%u RMems  encoder %6.2f GB/s  extract+encode %6.2f GB/s\n",
+      r_buffer_mem_count (buf),
+      bench_gbps (iterations * size, t0, t1), bench_gbps (iterations * size, t1, t2));
+
+  r_buffer_unref (buf);
+  r_free (data);
+}
+RTEST_END;
@@ -0,0 +1,105 @@
+#include <rlib/rlib.h>
+
+static void
+count_timeout (rpointer data, rpointer user)
+{
+  (void) user;
+  (*((rsize *)data))++;
+}
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static void
+bench_timers (rsize count)
+{
+  RClock * clock;
+  RClockEntry ** entries;
+  RPrng * prng;
+  RClockTime t0, t1, t2, t3;
+  rsize i, fired = 0;
+
+  r_assert_cmpptr ((entries = r_mem_new_n (RClockEntry *, count)), !=, NULL);
+  r_assert_cmpptr ((prng = r_rand_prng_new ()), !=, NULL);
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+
+  /* insert all, keeping a reference so half of them can be cancelled */
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < count; i++) {
+    entries[i] = r_clock_add_timeout_callback (clock,
+        1 + (r_prng_get_u64 (prng) % (10 * R_SECOND)),
+        count_timeout, &fired, NULL, NULL, NULL);
+  }
+  t1 = r_time_get_ts_monotonic ();
+  for (i = 0; i < count; i += 2)
+    r_clock_cancel_entry (clock, entries[i]);
+  t2 = r_time_get_ts_monotonic ();
+  r_assert (r_test_clock_update_time (clock, 10 * R_SECOND));
+  r_assert_cmpuint (r_clock_process_entries (clock, NULL), ==, count / 2);
+  t3 = r_time_get_ts_monotonic ();
+  r_assert_cmpuint (fired, ==, count / 2);
+
+  r_print ("\t%8"RSIZE_FMT" timers: insert %10"RINT64_FMT"/s cancel %10"RINT64_FMT"/s fire %10"RINT64_FMT"/s\n",
+      count,
+      bench_rate (count, t0, t1),
+      bench_rate (count - count / 2, t1, t2),
+      bench_rate (count / 2, t2, t3));
+
+  for (i = 0; i < count; i++)
+    r_clock_entry_unref (entries[i]);
+  r_clock_unref (clock);
+  r_prng_unref (prng);
+  r_free (entries);
+}
+
+static void
+bench_timers_rearm (rsize count)
+{
+  RClock * clock;
+  RClockTime t0, t1, now;
+  rsize i, fired = 0, rounds = 0;
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+
+  /* Steady state: timers fire and new ones are added (no references held) */
+  for (i = 0; i < count; i++) {
+    r_clock_entry_unref (r_clock_add_timeout_callback (clock, 1 + (i % 1000) * R_MSECOND,
+          count_timeout, &fired, NULL, NULL, NULL));
+  }
+
+  t0 = r_time_get_ts_monotonic ();
+  for (now = R_MSECOND; now <= R_SECOND; now += R_MSECOND) {
+    rsize n;
+    r_assert (r_test_clock_update_time (clock, now));
+    n = r_clock_process_entries (clock, NULL);
+    for (i = 0; i < n; i++) {
+      r_clock_entry_unref (r_clock_add_timeout_callback (clock, now + R_SECOND,
+            count_timeout, &fired, NULL, NULL, NULL));
+    }
+    rounds += n;
+  }
+  t1 = r_time_get_ts_monotonic ();
+
+  r_print ("\t%8"RSIZE_FMT" timers: fire+rearm %10"RINT64_FMT"/s\n",
+      count, bench_rate (rounds, t0, t1));
+
+  r_clock_unref (clock);
+}
+
+RTEST_BENCH (rclock, timeouts, RTEST_FAST)
+{
+  static const rsize counts[] = { 1000, 100000, 1000000 };
+  rsize i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  for (i = 0; i < R_N_ELEMENTS (counts); i++)
+    bench_timers (counts[i]);
+  for (i = 0; i < R_N_ELEMENTS (counts); i++)
+    bench_timers_rearm (counts[i]);
+}
+RTEST_END;
@@ -0,0 +1,146 @@
+#include <rlib/rlib.h>
+
+#define CRC_BENCH_BYTES       (64 * 1024 * 1024)
+#define CRC_BENCH_PARALLEL    (256 * 1024 * 1024)
+#define CRC_BENCH_THREADS_MAX 8
+
+typedef ruint32 (*RCrcBenchFunc) (RCrcImpl impl, ruint32 crc, rconstpointer buffer, rsize size);
+
+typedef struct {
+  const ruint8 * data;
+  rsize size;
+  ruint32 crc;
+} RCrcBenchChunk;
+
+static double
+bench_gbps (rsize bytes, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? (double)bytes / (double)cd : 0.0;
+}
+
+static const rchar *
+crc_bench_impl_str (RCrcImpl impl)
+{
+  switch (impl) {
+    case R_CRC_IMPL_BYTEWISE:
+      return "bytewise";
+    case R_CRC_IMPL_SLICE8:
+      return "slice8";
+    case R_CRC_IMPL_SLICE16:
+      return "slice16";
+    case R_CRC_IMPL_SSE42:
+      return "sse4.2";
+    case R_CRC_IMPL_PCLMUL:
+      return "pclmul";
+    default:
+      return "auto";
+  }
+}
+
+static void
+crc_bench_run (const rchar * name, RCrcBenchFunc func,
+    RCrcImpl impl, const ruint8 * buf, rsize size)
+{
+  RClockTime start, end;
+  ruint32 crc = R_CRC32_INIT;
+  rsize i, iterations = MAX (CRC_BENCH_BYTES / size, 1);
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++)
+    crc = func (impl, crc, buf, size);
+  end = r_time_get_ts_monotonic ();
+
+  r_print ("\t%-7s %-9s %9"RSIZE_FMT" B %7.2f GB/s (%08x)\n",
+      name, crc_bench_impl_str (impl), size,
+      bench_gbps (iterations * size, start, end), crc);
+}
+
+RTEST_BENCH (rcrc, update, RTEST_FAST)
+{
+  static const RCrcImpl impls[] = {
+    R_CRC_IMPL_BYTEWISE, R_CRC_IMPL_SLICE8, R_CRC_IMPL_SLICE16,
+    R_CRC_IMPL_SSE42, R_CRC_IMPL_PCLMUL, R_CRC_IMPL_AUTO };
+  static const rsize sizes[] = { 64, 200, 1500, 64 * 1024, 16 * 1024 * 1024 };
+  ruint8 * buf;
+  rsize i, j;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((buf = r_malloc (sizes[R_N_ELEMENTS (sizes) - 1])), !=, NULL);
+  for (i = 0; i < sizes[R_N_ELEMENTS (sizes) - 1]; i++)
+    buf[i] = (ruint8)(i * 131);
+
+  for (i = 0; i < R_N_ELEMENTS (impls); i++) {
+    for (j = 0; j < R_N_ELEMENTS (sizes); j++) {
+      if (r_crc32_impl_available (impls[i]))
+        crc_bench_run ("crc32", r_crc32_update_with_impl, impls[i], buf, sizes[j]);
+      if (r_crc32c_impl_available (impls[i]))
+        crc_bench_run ("crc32c", r_crc32c_update_with_impl, impls[i], buf, sizes[j]);
+    }
+  }
+
+  r_free (buf);
+}
+RTEST_END;
+
+static void
+crc_bench_chunk_task (rpointer data, RTaskQueue * tq, RTask * task)
+{
+  RCrcBenchChunk * chunk = data;
+
+  (void) tq;
+  (void) task;
+
+  chunk->crc = r_crc32 (chunk->data, chunk->size);
+}
+
+/* One chunk per worker, stitched together with r_crc32_combine */
+RTEST_BENCH (rcrc, parallel, RTEST_FAST | RTEST_SYSTEM)
+{
+  RCrcBenchChunk chunks[CRC_BENCH_THREADS_MAX];
+  RTask * tasks[CRC_BENCH_THREADS_MAX];
+  RClockTime start, end;
+  ruint8 * buf;
+  ruint32 expected;
+  ruint n, i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %u MB\n",
+      R_TIME_ARGS (0), R_STRFUNC, CRC_BENCH_PARALLEL / (1024 * 1024));
+
+  r_assert_cmpptr ((buf = r_malloc (CRC_BENCH_PARALLEL)), !=, NULL);
+  for (i = 0; i < CRC_BENCH_PARALLEL; i++)
+    buf[i] = (ruint8)(i * 131);
+  expected = r_crc32 (buf, CRC_BENCH_PARALLEL);
+
+  for (n = 1; n <= CRC_BENCH_THREADS_MAX; n *= 2) {
+    RTaskQueue * tq;
+    ruint32 crc;
+
+    r_assert_cmpptr ((tq = r_task_queue_new (1, n)), !=, NULL);
+
+    start = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++) {
+      chunks[i].data = buf + i * (CRC_BENCH_PARALLEL / n);
+      chunks[i].size = CRC_BENCH_PARALLEL / n;
+      r_assert_cmpptr ((tasks[i] = r_task_queue_add (tq,
+              crc_bench_chunk_task, &chunks[i], NULL)), !=, NULL);
+    }
+    r_assert (r_task_wait_many (tasks, n));
+    crc = chunks[0].crc;
+    for (i = 1; i < n; i++)
+      crc = r_crc32_combine (crc, chunks[i].crc, chunks[i].size);
+    end = r_time_get_ts_monotonic ();
+
+    r_assert_cmphex (crc, ==, expected);
+    r_print ("\t%2u threads %7.2f GB/s\n", n,
+        bench_gbps (CRC_BENCH_PARALLEL, start, end));
+
+    for (i = 0; i < n; i++)
+      r_task_unref (tasks[i]);
+    r_task_queue_unref (tq);
+  }
+
+  r_free (buf);
+}
+RTEST_END;
@@ -0,0 +1,240 @@
+#include <rlib/rlib.h>
+#include <rlib/rnet.h>
+#include <rlib/rev.h>
+
+#define LOOP_BENCH_HANDOFFS   200000
+#define LOOP_BENCH_BURST      64
+#define LOOP_BENCH_TIMERS     1000
+#define LOOP_BENCH_TIMER_WAIT (R_USECOND * 250)
+
+typedef struct {
+  REvLoop * loop;
+  REvUDP * evudp;
+  RThread * thread;
+} RLoopBenchLoop;
+
+typedef struct {
+  REvLoop * a;
+  REvLoop * b;
+  rsize left;
+  rsize received;
+  rsize its;
+  rauint done;
+} RLoopBenchCtx;
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static void
+loop_bench_udp_recv (rpointer data, RBuffer * buf, RSocketAddress * addr, REvUDP * evudp)
+{
+  (void) data;
+  (void) buf;
+  (void) addr;
+  (void) evudp;
+}
+
+static void
+loop_bench_stop (rpointer data, REvLoop * loop)
+{
+  (void) loop;
+  r_assert (r_ev_udp_recv_stop (data));
+}
+
+static rpointer
+loop_bench_thread (rpointer data)
+{
+  r_ev_loop_run (data, R_EV_LOOP_RUN_LOOP);
+  return NULL;
+}
+
+/* A receiving socket keeps the loop running until loop_bench_stop */
+static void
+loop_bench_start (RLoopBenchLoop * l)
+{
+  RSocketAddress * addr;
+
+  r_assert_cmpptr ((l->loop = r_ev_loop_new ()), !=, NULL);
+  r_assert_cmpptr ((l->evudp = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, l->loop)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0)), !=, NULL);
+  r_assert (r_ev_udp_bind (l->evudp, addr, TRUE));
+  r_socket_address_unref (addr);
+  r_assert (r_ev_udp_recv_start (l->evudp, NULL, loop_bench_udp_recv, NULL, NULL));
+  r_assert_cmpptr ((l->thread = r_thread_new ("loopbench", loop_bench_thread, l->loop)), !=, NULL);
+}
+
+static void
+loop_bench_finish (RLoopBenchLoop * l)
+{
+  r_assert (r_ev_loop_invoke (l->loop, loop_bench_stop, l->evudp));
+  r_thread_join (l->thread);
+  r_thread_unref (l->thread);
+  r_ev_udp_unref (l->evudp);
+  r_ev_loop_unref (l->loop);
+}
+
+static void
+loop_bench_wait (RLoopBenchCtx * ctx)
+{
+  while (!r_atomic_uint_load (&ctx->done))
+    r_thread_yield ();
+}
+
+static void loop_bench_ping (rpointer data, REvLoop * loop);
+
+static void
+loop_bench_pong (rpointer data, REvLoop * loop)
+{
+  RLoopBenchCtx * ctx = data;
+  (void) loop;
+
+  if (--ctx->left > 0)
+    r_assert (r_ev_loop_invoke (ctx->b, loop_bench_ping, ctx));
+  else
+    r_atomic_uint_store (&ctx->done, TRUE);
+}
+
+static void
+loop_bench_ping (rpointer data, REvLoop * loop)
+{
+  RLoopBenchCtx * ctx = data;
+  (void) loop;
+
+  r_assert (r_ev_loop_invoke (ctx->a, loop_bench_pong, ctx));
+}
+
+static void
+loop_bench_recv (rpointer data, REvLoop * loop)
+{
+  RLoopBenchCtx * ctx = data;
+
+  if (++ctx->received == 1)
+    ctx->its = r_ev_loop_get_iterations (loop);
+  if (ctx->received == LOOP_BENCH_HANDOFFS) {
+    ctx->its = r_ev_loop_get_iterations (loop) + 1 - ctx->its;
+    r_atomic_uint_store (&ctx->done, TRUE);
+  }
+}
+
+/* Runs on a, hands a burst over to b and comes back for the next one */
+static void
+loop_bench_send (rpointer data, REvLoop * loop)
+{
+  RLoopBenchCtx * ctx = data;
+  rsize i;
+  (void) loop;
+
+  for (i = 0; i < LOOP_BENCH_BURST && ctx->left > 0; i++, ctx->left--)
+    r_assert (r_ev_loop_invoke (ctx->b, loop_bench_recv, ctx));
+  if (ctx->left > 0)
+    r_assert (r_ev_loop_invoke (ctx->a, loop_bench_send, ctx));
+}
+
+RTEST_BENCH (revloop, invoke, RTEST_FAST | RTEST_SYSTEM)
+{
+  RLoopBenchLoop a, b;
+  RLoopBenchCtx ctx;
+  RClockTime t0, t1, t2;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  loop_bench_start (&a);
+  loop_bench_start (&b);
+  r_memclear (&ctx, sizeof (RLoopBenchCtx));
+  ctx.a = a.loop;
+  ctx.b = b.loop;
+
+  /* Round trips, every handoff needs a wakeup */
+  ctx.left = LOOP_BENCH_HANDOFFS / 2;
+  t0 = r_time_get_ts_monotonic ();
+  r_assert (r_ev_loop_invoke (ctx.b, loop_bench_ping, &ctx));
+  loop_bench_wait (&ctx);
+  t1 = r_time_get_ts_monotonic ();
+
+  /* One way bursts, wakeups are coalesced */
+  ctx.left = LOOP_BENCH_HANDOFFS;
+  r_atomic_uint_store (&ctx.done, FALSE);
+  r_assert (r_ev_loop_invoke (ctx.a, loop_bench_send, &ctx));
+  loop_bench_wait (&ctx);
+  t2 = r_time_get_ts_monotonic ();
+
+  loop_bench_finish (&a);
+  loop_bench_finish (&b);
+
+  r_print ("\tping-pong: %9"RINT64_FMT" handoffs/s\n",
+      bench_rate (LOOP_BENCH_HANDOFFS, t0, t1));
+  r_print ("\tburst %2u:  %9"RINT64_FMT" handoffs/s  handoffs/wakeup: %.1f\n",
+      LOOP_BENCH_BURST, bench_rate (LOOP_BENCH_HANDOFFS, t1, t2),
+      (rdouble)LOOP_BENCH_HANDOFFS / ctx.its);
+}
+RTEST_END;
+
+static void
+loop_bench_timer (rpointer data, REvLoop * loop)
+{
+  rsize * left = data;
+
+  if (--(*left) > 0) {
+    r_assert (r_ev_loop_add_callback_later (loop, NULL, LOOP_BENCH_TIMER_WAIT,
+          loop_bench_timer, left, NULL));
+  }
+}
+
+/* Upper bound in us of the histogram bucket holding percentile pct */
+static ruint64
+loop_bench_lateness_pct (const REvLoopStats * stats, ruint pct)
+{
+  rsize i, count = 0;
+
+  for (i = 0; i < R_EV_LOOP_LATENESS_BUCKETS - 1; i++) {
+    if ((count += stats->lateness[i]) * 100 >= stats->timers * pct)
+      break;
+  }
+  return RUINT64_CONSTANT (1) << i;
+}
+
+static void
+loop_bench_timers (const rchar * name, REvLoopBackend backend, rboolean hires)
+{
+  REvLoop * loop;
+  REvLoopStats stats;
+  rsize left = LOOP_BENCH_TIMERS;
+
+  if (!r_ev_loop_backend_is_supported (backend))
+    return;
+  r_assert_cmpptr ((loop = r_ev_loop_new_with_backend (NULL, NULL, backend)), !=, NULL);
+  if (!r_ev_loop_set_high_res_timers (loop, hires)) {
+    r_ev_loop_unref (loop);
+    return;
+  }
+
+  r_assert (r_ev_loop_add_callback_later (loop, NULL, LOOP_BENCH_TIMER_WAIT,
+        loop_bench_timer, &left, NULL));
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+  r_ev_loop_get_stats (loop, &stats);
+  r_ev_loop_unref (loop);
+
+  r_assert_cmpuint (stats.timers, ==, LOOP_BENCH_TIMERS);
+  r_print ("\t%-14s lateness mean: %6"RINT64_FMT"ns  p50: <%5"RUINT64_FMT"us  "
+      "p99: <%5"RUINT64_FMT"us  max: %8"RINT64_FMT"ns\n", name,
+      (rint64)(stats.lateness_sum / (RClockTimeDiff)stats.timers),
+      loop_bench_lateness_pct (&stats, 50), loop_bench_lateness_pct (&stats, 99),
+      (rint64)stats.lateness_max);
+}
+
+RTEST_BENCH (revloop, timer_accuracy, RTEST_FAST | RTEST_SYSTEM)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s --- %u timers %"R_TIME_FORMAT" apart\n",
+      R_TIME_ARGS (0), R_STRFUNC, LOOP_BENCH_TIMERS, R_TIME_ARGS (LOOP_BENCH_TIMER_WAIT));
+
+  loop_bench_timers ("epoll", R_EV_LOOP_BACKEND_EPOLL, FALSE);
+  loop_bench_timers ("epoll hi-res", R_EV_LOOP_BACKEND_EPOLL, TRUE);
+  loop_bench_timers ("io_uring", R_EV_LOOP_BACKEND_IO_URING, FALSE);
+  loop_bench_timers ("kqueue", R_EV_LOOP_BACKEND_KQUEUE, FALSE);
+  loop_bench_timers ("poll", R_EV_LOOP_BACKEND_POLL, FALSE);
+}
+RTEST_END;
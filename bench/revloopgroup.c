@@ -0,0 +1,234 @@
+#include <rlib/rlib.h>
+#include <rlib/rnet.h>
+#include <rlib/rev.h>
+#include <rlib/ros.h>
+
+#define GROUP_BENCH_CLIENTS     4
+#define GROUP_BENCH_LOOPS_MAX   4
+#define GROUP_BENCH_UDP_MSGS    16384
+#define GROUP_BENCH_HTTP_REQS   8192
+
+static const rchar group_bench_request[] =
+  "GET /bench HTTP/1.1\r\nHost: localhost\r\n\r\n";
+static const rchar group_bench_response[] =
+  "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+
+typedef struct {
+  RSocketAddress * addr;
+  RSocketType type;
+  rsize count;
+} RGroupBenchClient;
+
+typedef struct {
+  RHttpServer * srv[GROUP_BENCH_LOOPS_MAX];
+  ruint count, stopped;
+  RSocketAddress * addr;
+} RGroupBenchHttp;
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+/* Ping pong, one datagram or request in flight per client */
+static rpointer
+group_bench_client (rpointer data)
+{
+  RGroupBenchClient * cli = data;
+  const rchar * msg, * expected;
+  rsize msgsize, ressize, i, j, sent, recvd;
+  ruint8 res[64];
+  RSocket * sock;
+
+  if (cli->type == R_SOCKET_TYPE_DATAGRAM) {
+    msg = expected = "rlib";
+    msgsize = ressize = 4;
+    r_assert_cmpptr ((sock = r_socket_new (R_SOCKET_FAMILY_IPV4,
+            R_SOCKET_TYPE_DATAGRAM, R_SOCKET_PROTOCOL_UDP)), !=, NULL);
+  } else {
+    msg = group_bench_request;
+    msgsize = sizeof (group_bench_request) - 1;
+    expected = group_bench_response;
+    ressize = sizeof (group_bench_response) - 1;
+    r_assert_cmpptr ((sock = r_socket_new (R_SOCKET_FAMILY_IPV4,
+            R_SOCKET_TYPE_STREAM, R_SOCKET_PROTOCOL_TCP)), !=, NULL);
+  }
+  r_assert (r_socket_set_blocking (sock, TRUE));
+  r_assert_cmpint (r_socket_connect (sock, cli->addr), ==, R_SOCKET_OK);
+
+  for (i = 0; i < cli->count; i++) {
+    for (j = 0; j < msgsize; j += sent)
+      r_assert_cmpint (r_socket_send (sock, (const ruint8 *)msg + j, msgsize - j, &sent), ==, R_SOCKET_OK);
+    for (j = 0; j < ressize; j += recvd) {
+      r_assert_cmpint (r_socket_receive (sock, res + j, ressize - j, &recvd), ==, R_SOCKET_OK);
+      r_assert_cmpuint (recvd, >, 0);
+    }
+  }
+
+  r_assert_cmpint (r_memcmp (res, expected, ressize), ==, 0);
+
+  r_socket_close (sock);
+  r_socket_unref (sock);
+  return NULL;
+}
+
+static RClockTimeDiff
+group_bench_clients (RSocketAddress * addr, RSocketType type, rsize count)
+{
+  RGroupBenchClient cli[GROUP_BENCH_CLIENTS];
+  RThread * threads[GROUP_BENCH_CLIENTS];
+  RClockTime t0;
+  ruint i;
+
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < GROUP_BENCH_CLIENTS; i++) {
+    cli[i].addr = addr;
+    cli[i].type = type;
+    cli[i].count = count;
+    r_assert_cmpptr ((threads[i] = r_thread_new ("groupbench", group_bench_client, &cli[i])), !=, NULL);
+  }
+  for (i = 0; i < GROUP_BENCH_CLIENTS; i++) {
+    r_thread_join (threads[i]);
+    r_thread_unref (threads[i]);
+  }
+
+  return R_CLOCK_DIFF (t0, r_time_get_ts_monotonic ());
+}
+
+static void
+group_bench_udp_echo (rpointer data, RBuffer * buf, RSocketAddress * addr, REvUDP * evudp)
+{
+  (void) data;
+  r_assert (r_ev_udp_send (evudp, buf, addr, NULL, NULL, NULL));
+}
+
+static void
+group_bench_udp_bound (rpointer data, REvUDP * evudp, REvLoop * loop)
+{
+  RSocketAddress ** addr = data;
+  (void) loop;
+
+  if (*addr == NULL)
+    r_assert_cmpptr ((*addr = r_socket_get_local_address (r_ev_udp_get_socket (evudp))), !=, NULL);
+  r_assert (r_ev_udp_recv_start (evudp, NULL, group_bench_udp_echo, NULL, NULL));
+}
+
+static RHttpResponse *
+group_bench_http_handler (rpointer data,
+    RHttpRequest * req, RSocketAddress * addr, RHttpServer * server)
+{
+  RHttpResponse * ret;
+  RBuffer * buf;
+
+  (void) data;
+  (void) addr;
+  (void) server;
+
+  if ((ret = r_http_response_new (req, R_HTTP_STATUS_OK, NULL, NULL, NULL)) != NULL) {
+    buf = r_buffer_new_dup (R_STR_WITH_SIZE_ARGS ("ok"));
+    r_http_response_set_body_buffer (ret, buf);
+    r_buffer_unref (buf);
+  }
+
+  return ret;
+}
+
+/* One RHttpServer per loop, all of them serving the same port */
+static void
+group_bench_http_bound (rpointer data, REvTCP * evtcp, REvLoop * loop)
+{
+  RGroupBenchHttp * http = data;
+  RHttpServer * srv;
+
+  r_assert_cmpptr ((srv = r_http_server_new (loop)), !=, NULL);
+  r_assert (r_http_server_set_handler (srv, "/", -1, group_bench_http_handler, NULL, NULL));
+  r_assert (r_http_server_listen_tcp (srv, evtcp));
+  if (http->addr == NULL)
+    r_assert_cmpptr ((http->addr = r_ev_tcp_get_local_address (evtcp)), !=, NULL);
+  http->srv[http->count++] = srv;
+}
+
+/* Called in loop order, which is the order the servers were created in */
+static void
+group_bench_http_stop (rpointer data, REvLoop * loop)
+{
+  RGroupBenchHttp * http = data;
+  (void) loop;
+
+  r_http_server_stop (http->srv[http->stopped++], NULL, NULL, NULL);
+}
+
+static REvLoopGroup *
+group_bench_new (ruint loops, rboolean pinned)
+{
+  if (pinned) {
+    RBitset * cpuset;
+    ruint i;
+
+    r_assert (r_bitset_init_stack (cpuset, r_sys_cpu_max_count ()));
+    r_assert (r_sys_cpuset_allowed (cpuset));
+    /* Keep the first loops CPUs, the rest is left for the clients */
+    for (i = 0; i < cpuset->bits; i++) {
+      if (r_bitset_is_bit_set (cpuset, i) && loops-- == 0)
+        break;
+    }
+    for (; i < cpuset->bits; i++)
+      r_bitset_set_bit (cpuset, i, FALSE);
+    return r_ev_loop_group_new_on_cpus (cpuset);
+  }
+
+  return r_ev_loop_group_new (loops);
+}
+
+static void
+group_bench_run (const rchar * name, rboolean pinned, REvLoopGroupBindFlags flags)
+{
+  ruint loops;
+
+  for (loops = 1; loops <= GROUP_BENCH_LOOPS_MAX; loops *= 2) {
+    REvLoopGroup * group;
+    RSocketAddress * addr, * bound;
+    RGroupBenchHttp http;
+    RClockTimeDiff udp, tcp;
+
+    if (pinned && loops > r_sys_cpu_allowed_count ())
+      break;
+
+    r_assert_cmpptr ((group = group_bench_new (loops, pinned)), !=, NULL);
+    r_assert (r_ev_loop_group_start (group));
+    r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0)), !=, NULL);
+
+    bound = NULL;
+    r_assert (r_ev_loop_group_bind_udp (group, addr, flags, group_bench_udp_bound, &bound));
+    udp = group_bench_clients (bound, R_SOCKET_TYPE_DATAGRAM, GROUP_BENCH_UDP_MSGS);
+    r_socket_address_unref (bound);
+
+    http.count = http.stopped = 0;
+    http.addr = NULL;
+    r_assert (r_ev_loop_group_bind_tcp (group, addr, flags, group_bench_http_bound, &http));
+    tcp = group_bench_clients (http.addr, R_SOCKET_TYPE_STREAM, GROUP_BENCH_HTTP_REQS);
+    r_socket_address_unref (http.addr);
+
+    /* The servers are stopped on their own loops */
+    r_assert (r_ev_loop_group_foreach (group, group_bench_http_stop, &http));
+    r_ev_loop_group_unref (group);
+    while (http.count > 0)
+      r_http_server_unref (http.srv[--http.count]);
+    r_socket_address_unref (addr);
+
+    r_print ("\t%-8s %u loop(s) udp echo: %8"RINT64_FMT" msg/s  http: %8"RINT64_FMT" req/s\n",
+        name, loops,
+        bench_rate (GROUP_BENCH_UDP_MSGS * GROUP_BENCH_CLIENTS, 0, udp),
+        bench_rate (GROUP_BENCH_HTTP_REQS * GROUP_BENCH_CLIENTS, 0, tcp));
+  }
+}
+
+RTEST_BENCH (revloopgroup, reuseport, RTEST_FAST | RTEST_SYSTEM)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  group_bench_run ("unpinned", FALSE, R_EV_LOOP_GROUP_BIND_NONE);
+  group_bench_run ("pinned", TRUE, R_EV_LOOP_GROUP_BIND_INCOMING_CPU);
+}
+RTEST_END;
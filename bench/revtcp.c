@@ -0,0 +1,150 @@
+#include <rlib/rlib.h>
+#include <rlib/rnet.h>
+#include <rlib/rev.h>
+
+#define TCP_BENCH_MSGS          32768
+#define TCP_BENCH_MSG_SIZE      64
+#define TCP_BENCH_THREADS_MAX   4
+#define TCP_BENCH_PORT          0x6363
+
+typedef struct {
+  REvTCP * listen;
+  rauint running;
+} REvTCPBenchServer;
+
+typedef struct {
+  RSocketAddress * addr;
+  rauint * running;
+} REvTCPBenchClient;
+
+/* Ping pong, one message in flight per connection */
+static rpointer
+tcp_bench_client (rpointer data)
+{
+  REvTCPBenchClient * cli = data;
+  ruint8 msg[TCP_BENCH_MSG_SIZE], res[TCP_BENCH_MSG_SIZE];
+  RSocket * sock;
+  rsize i, j, sent, recvd;
+
+  r_memset (msg, 0x42, sizeof (msg));
+  r_assert_cmpptr ((sock = r_socket_new (R_SOCKET_FAMILY_IPV4,
+          R_SOCKET_TYPE_STREAM, R_SOCKET_PROTOCOL_TCP)), !=, NULL);
+  r_assert (r_socket_set_blocking (sock, TRUE));
+  r_assert_cmpint (r_socket_connect (sock, cli->addr), ==, R_SOCKET_OK);
+
+  for (i = 0; i < TCP_BENCH_MSGS; i++) {
+    for (j = 0; j < sizeof (msg); j += sent)
+      r_assert_cmpint (r_socket_send (sock, msg + j, sizeof (msg) - j, &sent), ==, R_SOCKET_OK);
+    for (j = 0; j < sizeof (res); j += recvd) {
+      r_assert_cmpint (r_socket_receive (sock, res + j, sizeof (res) - j, &recvd), ==, R_SOCKET_OK);
+      r_assert_cmpuint (recvd, >, 0);
+    }
+  }
+
+  r_assert_cmpint (r_memcmp (res, msg, sizeof (msg)), ==, 0);
+
+  r_socket_close (sock);
+  r_socket_unref (sock);
+
+  r_atomic_uint_fetch_sub (cli->running, 1);
+  return NULL;
+}
+
+static void
+tcp_bench_echo (rpointer data, RBuffer * buf, REvTCP * evtcp)
+{
+  (void) data;
+
+  if (buf != NULL) {
+    r_assert (r_ev_tcp_send_and_forget (evtcp, buf));
+  } else {
+    r_ev_tcp_close (evtcp, NULL, NULL, NULL);
+    r_ev_tcp_unref (evtcp);
+  }
+}
+
+static void
+tcp_bench_connection (rpointer data, REvTCP * newtcp, REvTCP * listening)
+{
+  (void) data;
+  (void) listening;
+
+  r_assert (r_ev_tcp_recv_start (r_ev_tcp_ref (newtcp), NULL, tcp_bench_echo, NULL, NULL));
+}
+
+static void
+tcp_bench_check_done (rpointer data, REvLoop * loop)
+{
+  REvTCPBenchServer * ctx = data;
+
+  if (r_atomic_uint_load (&ctx->running) > 0) {
+    r_assert (r_ev_loop_add_callback_later (loop, NULL, 10 * R_MSECOND,
+          tcp_bench_check_done, ctx, NULL));
+  } else {
+    r_ev_tcp_close (ctx->listen, NULL, NULL, NULL);
+  }
+}
+
+static void
+tcp_bench_run (const rchar * name, REvLoopBackend backend)
+{
+  REvTCPBenchClient cli[TCP_BENCH_THREADS_MAX];
+  RThread * threads[TCP_BENCH_THREADS_MAX];
+  RSocketAddress * addr;
+  rsize i, n;
+
+  if (!r_ev_loop_backend_is_supported (backend)) {
+    r_print ("\t%-8s not supported\n", name);
+    return;
+  }
+
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1,
+          TCP_BENCH_PORT)), !=, NULL);
+
+  for (n = 1; n <= TCP_BENCH_THREADS_MAX; n *= 2) {
+    REvLoop * loop;
+    REvTCPBenchServer ctx;
+    RClockTime t0, t1;
+    rsize syscalls;
+
+    r_assert_cmpptr ((loop = r_ev_loop_new_with_backend (NULL, NULL, backend)), !=, NULL);
+    r_assert_cmpptr ((ctx.listen = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+    r_assert_cmpint (r_ev_tcp_bind (ctx.listen, addr, TRUE), ==, R_SOCKET_OK);
+    r_assert_cmpint (r_ev_tcp_listen (ctx.listen, 16, tcp_bench_connection, NULL, NULL), ==, R_SOCKET_OK);
+    r_atomic_uint_store (&ctx.running, (ruint)n);
+
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++) {
+      cli[i].addr = addr;
+      cli[i].running = &ctx.running;
+      r_assert_cmpptr ((threads[i] = r_thread_new ("tcpbench", tcp_bench_client, &cli[i])), !=, NULL);
+    }
+
+    tcp_bench_check_done (&ctx, loop);
+    r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP);
+
+    for (i = 0; i < n; i++) {
+      r_thread_join (threads[i]);
+      r_thread_unref (threads[i]);
+    }
+    t1 = r_time_get_ts_monotonic ();
+    syscalls = r_ev_loop_get_syscalls (loop);
+
+    r_print ("\t%-8s %"RSIZE_FMT" client(s) %8"RINT64_FMT" msg/s  syscalls/msg: %.3f\n",
+        name, n, (rint64)(((rint64)TCP_BENCH_MSGS * n * R_SECOND) / R_CLOCK_DIFF (t0, t1)),
+        (rdouble)syscalls / (TCP_BENCH_MSGS * n));
+
+    r_ev_tcp_unref (ctx.listen);
+    r_ev_loop_unref (loop);
+  }
+
+  r_socket_address_unref (addr);
+}
+
+RTEST_BENCH (revtcp, echo, RTEST_FAST | RTEST_SYSTEM)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  tcp_bench_run ("epoll", R_EV_LOOP_BACKEND_EPOLL);
+  tcp_bench_run ("io_uring", R_EV_LOOP_BACKEND_IO_URING);
+}
+RTEST_END;
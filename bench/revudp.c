@@ -257,3 +257,291 @@ RTEST_BENCH (revudp, multi_loopback_receive, RTEST_FASTSLOW | RTEST_SYSTEM)
 }
 RTEST_END;
 
+
+
+#define BATCH_LENGTH  (5 * R_SECOND)
+
+typedef struct {
+  REvUDPBenchCtx ctx;
+  ruint batch;
+  rsize rxcalls;
+  rsize txcalls;
+
+  rboolean running;
+  RThread * tsnd;
+} REvUDPBatchBenchCtx;
+
+static rpointer
+udp_send_batch (rpointer data)
+{
+  REvUDPBatchBenchCtx * bctx = data;
+  RSocket * sock;
+  RSocketAddress ** addrs;
+  RBuffer ** bufs;
+  ruint8 sendbuf[1024];
+  rsize * sent;
+  ruint i, msgs;
+
+  r_assert_cmpptr ((sock = r_socket_new (R_SOCKET_FAMILY_IPV4, R_SOCKET_TYPE_DATAGRAM, R_SOCKET_PROTOCOL_UDP)), !=, NULL);
+  r_assert (r_socket_set_blocking (sock, TRUE));
+  addrs = r_alloca (bctx->batch * sizeof (RSocketAddress *));
+  bufs = r_alloca (bctx->batch * sizeof (RBuffer *));
+  sent = r_alloca (bctx->batch * sizeof (rsize));
+  r_memclear (sendbuf, sizeof (sendbuf));
+  for (i = 0; i < bctx->batch; i++) {
+    addrs[i] = bctx->ctx.addr;
+    r_assert_cmpptr ((bufs[i] = r_buffer_new_dup (sendbuf, sizeof (sendbuf))), !=, NULL);
+  }
+
+  while (bctx->running) {
+    bctx->txcalls++;
+    if (r_socket_send_messages (sock, addrs, bufs, sent, bctx->batch, &msgs) == R_SOCKET_OK) {
+      for (i = 0; i < msgs; i++) {
+        bctx->ctx.tx.bytes += sent[i];
+        bctx->ctx.tx.packets++;
+      }
+    } else {
+      bctx->ctx.tx.failed++;
+    }
+  }
+
+  for (i = 0; i < bctx->batch; i++)
+    r_buffer_unref (bufs[i]);
+  r_socket_close (sock);
+  r_socket_unref (sock);
+
+  return NULL;
+}
+
+static void
+udp_recv_batch (rpointer user, RBuffer ** bufs, RSocketAddress ** addrs,
+    ruint count, REvUDP * evudp)
+{
+  REvUDPBatchBenchCtx * bctx = user;
+  ruint i;
+  (void) evudp;
+  (void) addrs;
+
+  bctx->rxcalls++;
+  for (i = 0; i < count; i++) {
+    bctx->ctx.rx.packets++;
+    bctx->ctx.rx.bytes += r_buffer_get_size (bufs[i]);
+  }
+}
+
+static void
+stop_batch (rpointer data, REvLoop * loop)
+{
+  REvUDPBatchBenchCtx * bctx = data;
+  (void) loop;
+
+  r_assert (r_ev_udp_recv_stop (bctx->ctx.evudp));
+}
+
+RTEST_BENCH (revudp, batch_loopback_receive, RTEST_FASTSLOW | RTEST_SYSTEM)
+{
+  static const ruint batches[] = { 1, 8, 32, 64 };
+  REvUDPBatchBenchCtx bctx;
+  REvLoop * loop;
+  RClockTime now;
+  ruint i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  for (i = 0; i < R_N_ELEMENTS (batches); i++) {
+    RClockTimeDiff cd;
+    rsize iterations;
+
+    r_memclear (&bctx, sizeof (REvUDPBatchBenchCtx));
+    bctx.batch = batches[i];
+    r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+    r_assert_cmpptr ((bctx.ctx.evudp = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+    r_assert_cmpptr ((bctx.ctx.addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x4242)), !=, NULL);
+    r_assert (r_ev_udp_bind (bctx.ctx.evudp, bctx.ctx.addr, TRUE));
+    r_assert (r_ev_udp_recv_batch_start (bctx.ctx.evudp, bctx.batch,
+          NULL, udp_recv_batch, &bctx, NULL));
+
+    bctx.running = TRUE;
+    bctx.ctx.start = r_time_get_ts_monotonic ();
+    r_assert_cmpptr ((bctx.tsnd = r_thread_new ("send udp batch", udp_send_batch, &bctx)), !=, NULL);
+    r_assert (r_ev_loop_add_callback_later (loop, NULL, BATCH_LENGTH, stop_batch, &bctx, NULL));
+    r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP);
+    now = r_time_get_ts_monotonic ();
+    iterations = r_ev_loop_get_iterations (loop);
+
+    bctx.running = FALSE;
+    r_thread_join (bctx.tsnd);
+    r_thread_unref (bctx.tsnd);
+
+    /* Each wakeup costs an epoll_wait and a final recvmmsg returning EAGAIN */
+    cd = R_CLOCK_DIFF (bctx.ctx.start, now);
+    r_print ("\tbatch %2u: RX pps: %9"RINT64_FMT" syscalls/pkt: %.3f"
+        "  TX pps: %9"RINT64_FMT" syscalls/pkt: %.3f\n", batches[i],
+        ((rint64)bctx.ctx.rx.packets * R_SECOND) / cd,
+        bctx.ctx.rx.packets > 0 ?
+        (rdouble)(bctx.rxcalls + 2 * iterations) / bctx.ctx.rx.packets : 0.0,
+        ((rint64)bctx.ctx.tx.packets * R_SECOND) / cd,
+        bctx.ctx.tx.packets > 0 ?
+        (rdouble)bctx.txcalls / bctx.ctx.tx.packets : 0.0);
+
+    r_socket_address_unref (bctx.ctx.addr);
+    r_ev_udp_unref (bctx.ctx.evudp);
+    r_ev_loop_unref (loop);
+  }
+}
+RTEST_END;
+
+
+static rauint g__allocs;
+
+static rpointer
+counting_malloc (rsize size)
+{
+  r_atomic_uint_fetch_add (&g__allocs, 1);
+  return malloc (size);
+}
+
+static rpointer
+counting_calloc (rsize count, rsize size)
+{
+  r_atomic_uint_fetch_add (&g__allocs, 1);
+  return calloc (count, size);
+}
+
+static rpointer
+counting_realloc (rpointer ptr, rsize size)
+{
+  r_atomic_uint_fetch_add (&g__allocs, 1);
+  return realloc (ptr, size);
+}
+
+RTEST_BENCH (revudp, pool_loopback_receive, RTEST_FASTSLOW | RTEST_SYSTEM)
+{
+  static const ruint batches[] = { 1, 32 };
+  RMemVTable counting = { counting_malloc, counting_calloc, counting_realloc, free };
+  RMemVTable system = { malloc, calloc, realloc, free };
+  REvUDPBatchBenchCtx bctx;
+  RMemAllocator * allocator;
+  RBufferPool * pool;
+  REvLoop * loop;
+  RClockTime now;
+  ruint i, p;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  for (p = 0; p < 2; p++) {
+    for (i = 0; i < R_N_ELEMENTS (batches); i++) {
+      RClockTimeDiff cd;
+      ruint allocs;
+
+      r_memclear (&bctx, sizeof (REvUDPBatchBenchCtx));
+      bctx.batch = 32;
+      r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+      r_assert_cmpptr ((bctx.ctx.evudp = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+      r_assert_cmpptr ((bctx.ctx.addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x4242)), !=, NULL);
+      r_assert (r_ev_udp_bind (bctx.ctx.evudp, bctx.ctx.addr, TRUE));
+      if (p > 0) {
+        r_assert_cmpptr ((allocator = r_mem_allocator_pool_new ("bench-udp", 4096, 256)), !=, NULL);
+        r_assert_cmpptr ((pool = r_buffer_pool_new (allocator, 4096, NULL, 256)), !=, NULL);
+        r_ev_udp_set_buffer_pool (bctx.ctx.evudp, pool);
+        r_buffer_pool_unref (pool);
+        r_mem_allocator_unref (allocator);
+      }
+      if (batches[i] > 1) {
+        r_assert (r_ev_udp_recv_batch_start (bctx.ctx.evudp, batches[i],
+              NULL, udp_recv_batch, &bctx, NULL));
+      } else {
+        r_assert (r_ev_udp_recv_start (bctx.ctx.evudp, NULL, udp_recv, &bctx.ctx, NULL));
+      }
+
+      bctx.running = TRUE;
+      bctx.ctx.start = r_time_get_ts_monotonic ();
+      r_assert_cmpptr ((bctx.tsnd = r_thread_new ("send udp batch", udp_send_batch, &bctx)), !=, NULL);
+      r_assert (r_ev_loop_add_callback_later (loop, NULL, BATCH_LENGTH, stop_batch, &bctx, NULL));
+
+      r_atomic_uint_store (&g__allocs, 0);
+      r_mem_set_vtable (&counting);
+      r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP);
+      r_mem_set_vtable (&system);
+      allocs = r_atomic_uint_load (&g__allocs);
+      now = r_time_get_ts_monotonic ();
+
+      bctx.running = FALSE;
+      r_thread_join (bctx.tsnd);
+      r_thread_unref (bctx.tsnd);
+
+      cd = R_CLOCK_DIFF (bctx.ctx.start, now);
+      r_print ("\t%s batch %2u: RX pps: %9"RINT64_FMT" allocs/pkt: %.3f\n",
+          p > 0 ? "pool  " : "system", batches[i],
+          ((rint64)bctx.ctx.rx.packets * R_SECOND) / cd,
+          bctx.ctx.rx.packets > 0 ? (rdouble)allocs / bctx.ctx.rx.packets : 0.0);
+
+      r_socket_address_unref (bctx.ctx.addr);
+      r_ev_udp_unref (bctx.ctx.evudp);
+      r_ev_loop_unref (loop);
+    }
+  }
+}
+RTEST_END;
+
+RTEST_BENCH (revudp, backend_loopback_receive, RTEST_FASTSLOW | RTEST_SYSTEM)
+{
+  static const REvLoopBackend backends[] = {
+    R_EV_LOOP_BACKEND_EPOLL, R_EV_LOOP_BACKEND_IO_URING
+  };
+  static const rchar * names[] = { "epoll", "io_uring" };
+  static const ruint batches[] = { 1, 32 };
+  REvUDPBatchBenchCtx bctx;
+  REvLoop * loop;
+  RClockTime now;
+  ruint b, i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  for (b = 0; b < R_N_ELEMENTS (backends); b++) {
+    if (!r_ev_loop_backend_is_supported (backends[b])) {
+      r_print ("\t%-8s not supported\n", names[b]);
+      continue;
+    }
+
+    for (i = 0; i < R_N_ELEMENTS (batches); i++) {
+      RClockTimeDiff cd;
+      rsize syscalls;
+
+      r_memclear (&bctx, sizeof (REvUDPBatchBenchCtx));
+      bctx.batch = 32;
+      r_assert_cmpptr ((loop = r_ev_loop_new_with_backend (NULL, NULL, backends[b])), !=, NULL);
+      r_assert_cmpptr ((bctx.ctx.evudp = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+      r_assert_cmpptr ((bctx.ctx.addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x4242)), !=, NULL);
+      r_assert (r_ev_udp_bind (bctx.ctx.evudp, bctx.ctx.addr, TRUE));
+      if (batches[i] > 1) {
+        r_assert (r_ev_udp_recv_batch_start (bctx.ctx.evudp, batches[i],
+              NULL, udp_recv_batch, &bctx, NULL));
+      } else {
+        r_assert (r_ev_udp_recv_start (bctx.ctx.evudp, NULL, udp_recv, &bctx.ctx, NULL));
+      }
+
+      bctx.running = TRUE;
+      bctx.ctx.start = r_time_get_ts_monotonic ();
+      r_assert_cmpptr ((bctx.tsnd = r_thread_new ("send udp batch", udp_send_batch, &bctx)), !=, NULL);
+      r_assert (r_ev_loop_add_callback_later (loop, NULL, BATCH_LENGTH, stop_batch, &bctx, NULL));
+      r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP);
+      now = r_time_get_ts_monotonic ();
+      syscalls = r_ev_loop_get_syscalls (loop);
+
+      bctx.running = FALSE;
+      r_thread_join (bctx.tsnd);
+      r_thread_unref (bctx.tsnd);
+
+      cd = R_CLOCK_DIFF (bctx.ctx.start, now);
+      r_print ("\t%-8s batch %2u: RX pps: %9"RINT64_FMT" syscalls/pkt: %.3f\n",
+          names[b], batches[i], ((rint64)bctx.ctx.rx.packets * R_SECOND) / cd,
+          bctx.ctx.rx.packets > 0 ? (rdouble)syscalls / bctx.ctx.rx.packets : 0.0);
+
+      r_socket_address_unref (bctx.ctx.addr);
+      r_ev_udp_unref (bctx.ctx.evudp);
+      r_ev_loop_unref (loop);
+    }
+  }
+}
+RTEST_END;
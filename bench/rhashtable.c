@@ -0,0 +1,89 @@
+#include <rlib/rlib.h>
+
+/* Prime, so visiting i * HT_BENCH_STRIDE % n is a permutation of 0..n-1
+ * for every power of ten. Keeps lookups from walking memory in order. */
+#define HT_BENCH_STRIDE       RUINT64_CONSTANT (7919)
+#define HT_BENCH_KEY(i)       RSIZE_TO_POINTER ((i) + 1)
+#define HT_BENCH_PERM(i, n)   ((rsize)(((ruint64)(i) * HT_BENCH_STRIDE) % (n)))
+
+static double
+bench_ns (rsize count, RClockTime start, RClockTime end)
+{
+  return (double)R_CLOCK_DIFF (start, end) / (double)count;
+}
+
+static rsize
+ht_bench_insert (RHashTable * ht, rsize n)
+{
+  rsize i;
+
+  for (i = 0; i < n; i++)
+    r_hash_table_insert (ht, HT_BENCH_KEY (i), HT_BENCH_KEY (i));
+
+  return r_hash_table_size (ht);
+}
+
+static rsize
+ht_bench_lookup (RHashTable * ht, rsize n, rsize offset)
+{
+  rsize i, found = 0;
+
+  for (i = 0; i < n; i++) {
+    if (r_hash_table_lookup (ht, HT_BENCH_KEY (HT_BENCH_PERM (i, n) + offset)) != NULL)
+      found++;
+  }
+
+  return found;
+}
+
+static rsize
+ht_bench_erase (RHashTable * ht, rsize n)
+{
+  rsize i, removed = 0;
+
+  for (i = 0; i < n; i++) {
+    if (r_hash_table_remove (ht, HT_BENCH_KEY (HT_BENCH_PERM (i, n))) == R_HASH_TABLE_OK)
+      removed++;
+  }
+
+  return removed;
+}
+
+RTEST_BENCH (rhashtable, ops, RTEST_FAST)
+{
+  RHashTable * ht;
+  RClockTime t0, t1, t2, t3, t4, t5, t6;
+  rsize n;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- pointer sized integer keys\n",
+      R_TIME_ARGS (0), R_STRFUNC);
+  r_print ("\t   entries   insert reserved      hit     miss    erase   (ns/op)\n");
+
+  for (n = 1000; n <= 10000000; n *= 10) {
+    r_assert_cmpptr ((ht = r_hash_table_new (NULL, NULL)), !=, NULL);
+    t0 = r_time_get_ts_monotonic ();
+    r_assert_cmpuint (ht_bench_insert (ht, n), ==, n);
+    t1 = r_time_get_ts_monotonic ();
+    r_hash_table_unref (ht);
+
+    r_assert_cmpptr ((ht = r_hash_table_new (NULL, NULL)), !=, NULL);
+    t2 = r_time_get_ts_monotonic ();
+    r_assert_cmpint (r_hash_table_reserve (ht, n), ==, R_HASH_TABLE_OK);
+    r_assert_cmpuint (ht_bench_insert (ht, n), ==, n);
+    t3 = r_time_get_ts_monotonic ();
+    r_assert_cmpuint (ht_bench_lookup (ht, n, 0), ==, n);
+    t4 = r_time_get_ts_monotonic ();
+    r_assert_cmpuint (ht_bench_lookup (ht, n, n), ==, 0);
+    t5 = r_time_get_ts_monotonic ();
+    r_assert_cmpuint (ht_bench_erase (ht, n), ==, n);
+    t6 = r_time_get_ts_monotonic ();
+    r_assert_cmpuint (r_hash_table_size (ht), ==, 0);
+    r_hash_table_unref (ht);
+
+    r_print ("\t%10"RSIZE_FMT" %8.1f %8.1f %8.1f %8.1f %8.1f\n", n,
+        bench_ns (n, t0, t1), bench_ns (n, t2, t3), bench_ns (n, t3, t4),
+        bench_ns (n, t4, t5), bench_ns (n, t5, t6));
+  }
+}
+RTEST_END;
+
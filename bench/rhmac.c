@@ -0,0 +1,62 @@
+#include <rlib/rlib.h>
+#include <rlib/rcrypto.h>
+
+#define HMAC_BENCH_BYTES      (8 * 1024 * 1024)
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+/* One reset, update and get_data per message, as for SRTP auth tags */
+static void
+hmac_bench_run (RMsgDigestType type, const ruint8 * buf, rsize size)
+{
+  static const ruint8 key[20] = {
+    0x29, 0xf7, 0x97, 0xd9, 0xda, 0xa3, 0x17, 0x60, 0xdf, 0x34,
+    0xb9, 0x5f, 0x87, 0xd3, 0x5d, 0x41, 0x62, 0x0e, 0x96, 0x1b
+  };
+  RHmac * hmac;
+  ruint8 tag[64];
+  RClockTime t0, t1;
+  rsize i, iterations = MAX (HMAC_BENCH_BYTES / size, 1);
+
+  r_assert_cmpptr ((hmac = r_hmac_new (type, key, sizeof (key))), !=, NULL);
+
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < iterations; i++) {
+    r_hmac_reset (hmac);
+    r_hmac_update (hmac, buf, size);
+    r_hmac_get_data (hmac, tag, sizeof (tag), NULL);
+  }
+  t1 = r_time_get_ts_monotonic ();
+
+  r_print ("\t%-8s %5"RSIZE_FMT" B %8"RINT64_FMT" msg/s %6"RINT64_FMT" MB/s\n",
+      r_msg_digest_type_string (type), size,
+      bench_rate (iterations, t0, t1),
+      bench_rate (iterations * size, t0, t1) / (1000 * 1000));
+
+  r_hmac_free (hmac);
+}
+
+RTEST_BENCH (rhmac, messages, RTEST_FAST)
+{
+  static const rsize sizes[] = { 64, 200, 512, 1024, 1500 };
+  ruint8 * buf;
+  rsize i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((buf = r_malloc (sizes[R_N_ELEMENTS (sizes) - 1])), !=, NULL);
+  r_memset (buf, 0x42, sizes[R_N_ELEMENTS (sizes) - 1]);
+
+  for (i = 0; i < R_N_ELEMENTS (sizes); i++)
+    hmac_bench_run (R_MSG_DIGEST_TYPE_SHA1, buf, sizes[i]);
+  for (i = 0; i < R_N_ELEMENTS (sizes); i++)
+    hmac_bench_run (R_MSG_DIGEST_TYPE_SHA256, buf, sizes[i]);
+
+  r_free (buf);
+}
+RTEST_END;
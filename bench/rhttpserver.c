@@ -0,0 +1,189 @@
+#include <rlib/rlib.h>
+#include <rlib/rnet.h>
+#include <rlib/rev.h>
+
+#include <stdlib.h>
+
+#define HTTP_BENCH_REQUESTS     16384
+#define HTTP_BENCH_THREADS_MAX  4
+#define HTTP_BENCH_PORT         0x4848
+
+static const rchar http_bench_request[] =
+  "GET /bench HTTP/1.1\r\nHost: localhost\r\n\r\n";
+static const rchar http_bench_response[] =
+  "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+
+typedef struct {
+  RHttpServer * srv;
+  rauint running;
+} RHttpBenchServer;
+
+typedef struct {
+  RSocketAddress * addr;
+  ruint depth;
+  rauint * running;
+
+  RClockTimeDiff * lat;
+  rsize count;
+} RHttpBenchClient;
+
+static RHttpResponse *
+http_bench_handler (rpointer data,
+    RHttpRequest * req, RSocketAddress * addr, RHttpServer * server)
+{
+  RHttpResponse * ret;
+  RBuffer * buf;
+
+  (void) data;
+  (void) addr;
+  (void) server;
+
+  if ((ret = r_http_response_new (req, R_HTTP_STATUS_OK, NULL, NULL, NULL)) != NULL) {
+    buf = r_buffer_new_dup (R_STR_WITH_SIZE_ARGS ("ok"));
+    r_http_response_set_body_buffer (ret, buf);
+    r_buffer_unref (buf);
+  }
+
+  return ret;
+}
+
+/* Sends depth requests back to back, then reads all the responses */
+static rpointer
+http_bench_client (rpointer data)
+{
+  RHttpBenchClient * cli = data;
+  const rsize reqsize = sizeof (http_bench_request) - 1;
+  const rsize ressize = sizeof (http_bench_response) - 1;
+  ruint8 * reqs, * res;
+  RSocket * sock;
+  rsize i, j;
+
+  reqs = r_malloc (reqsize * cli->depth);
+  res = r_malloc (ressize * cli->depth);
+  for (j = 0; j < cli->depth; j++)
+    r_memcpy (reqs + j * reqsize, http_bench_request, reqsize);
+
+  r_assert_cmpptr ((sock = r_socket_new (R_SOCKET_FAMILY_IPV4,
+          R_SOCKET_TYPE_STREAM, R_SOCKET_PROTOCOL_TCP)), !=, NULL);
+  r_assert (r_socket_set_blocking (sock, TRUE));
+  r_assert_cmpint (r_socket_connect (sock, cli->addr), ==, R_SOCKET_OK);
+
+  for (i = 0; i < cli->count; i += cli->depth) {
+    RClockTime t0 = r_time_get_ts_monotonic ();
+    rsize sent, recvd, total = 0;
+
+    for (j = 0; j < reqsize * cli->depth; j += sent)
+      r_assert_cmpint (r_socket_send (sock, reqs + j, reqsize * cli->depth - j, &sent), ==, R_SOCKET_OK);
+
+    for (j = 0; j < cli->depth; ) {
+      r_assert_cmpint (r_socket_receive (sock, res + total,
+            ressize * cli->depth - total, &recvd), ==, R_SOCKET_OK);
+      r_assert_cmpuint (recvd, >, 0);
+      for (total += recvd; j < cli->depth && total >= (j + 1) * ressize; j++)
+        cli->lat[i + j] = R_CLOCK_DIFF (t0, r_time_get_ts_monotonic ());
+    }
+  }
+
+  r_assert_cmpint (r_memcmp (res, http_bench_response, ressize), ==, 0);
+
+  r_socket_close (sock);
+  r_socket_unref (sock);
+  r_free (reqs);
+  r_free (res);
+
+  r_atomic_uint_fetch_sub (cli->running, 1);
+  return NULL;
+}
+
+static void
+http_bench_check_done (rpointer data, REvLoop * loop)
+{
+  RHttpBenchServer * ctx = data;
+
+  if (r_atomic_uint_load (&ctx->running) > 0) {
+    r_assert (r_ev_loop_add_callback_later (loop, NULL, 10 * R_MSECOND,
+          http_bench_check_done, ctx, NULL));
+  } else {
+    r_http_server_stop (ctx->srv, NULL, NULL, NULL);
+  }
+}
+
+static int
+http_bench_cmp_lat (const void * a, const void * b)
+{
+  RClockTimeDiff x = *(const RClockTimeDiff *)a, y = *(const RClockTimeDiff *)b;
+  return (x > y) - (x < y);
+}
+
+static void
+http_bench_run (ruint depth)
+{
+  RHttpBenchClient cli[HTTP_BENCH_THREADS_MAX];
+  RThread * threads[HTTP_BENCH_THREADS_MAX];
+  RClockTimeDiff * lat;
+  RSocketAddress * addr;
+  rsize i, n;
+
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1,
+          HTTP_BENCH_PORT + depth)), !=, NULL);
+
+  for (n = 1; n <= HTTP_BENCH_THREADS_MAX; n *= 2) {
+    REvLoop * loop;
+    RHttpBenchServer ctx;
+    RClockTime t0, t1;
+
+    r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+    r_assert_cmpptr ((ctx.srv = r_http_server_new (loop)), !=, NULL);
+    r_assert (r_http_server_set_handler (ctx.srv, "/", -1, http_bench_handler, NULL, NULL));
+    r_assert (r_http_server_listen (ctx.srv, addr));
+    r_atomic_uint_store (&ctx.running, (ruint)n);
+
+    r_assert_cmpptr ((lat = r_mem_new_n (RClockTimeDiff, HTTP_BENCH_REQUESTS * n)), !=, NULL);
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++) {
+      cli[i].addr = addr;
+      cli[i].depth = depth;
+      cli[i].running = &ctx.running;
+      cli[i].lat = lat + i * HTTP_BENCH_REQUESTS;
+      cli[i].count = HTTP_BENCH_REQUESTS;
+      r_assert_cmpptr ((threads[i] = r_thread_new ("httpbench", http_bench_client, &cli[i])), !=, NULL);
+    }
+
+    http_bench_check_done (&ctx, loop);
+    r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP);
+
+    for (i = 0; i < n; i++) {
+      r_thread_join (threads[i]);
+      r_thread_unref (threads[i]);
+    }
+    t1 = r_time_get_ts_monotonic ();
+
+    qsort (lat, HTTP_BENCH_REQUESTS * n, sizeof (RClockTimeDiff), http_bench_cmp_lat);
+    r_print ("\tdepth %2u %"RSIZE_FMT" client(s) %8"RINT64_FMT" req/s"
+        "  p50: %6"RINT64_FMT" us  p99: %6"RINT64_FMT" us\n", depth, n,
+        (rint64)(((rint64)HTTP_BENCH_REQUESTS * n * R_SECOND) / R_CLOCK_DIFF (t0, t1)),
+        (rint64)(lat[(HTTP_BENCH_REQUESTS * n) / 2] / R_USECOND),
+        (rint64)(lat[(HTTP_BENCH_REQUESTS * n * 99) / 100] / R_USECOND));
+
+    r_free (lat);
+    r_http_server_unref (ctx.srv);
+    r_ev_loop_unref (loop);
+  }
+
+  r_socket_address_unref (addr);
+}
+
+RTEST_BENCH (rhttpserver, keepalive, RTEST_FAST | RTEST_SYSTEM)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  http_bench_run (1);
+}
+RTEST_END;
+
+RTEST_BENCH (rhttpserver, pipelined, RTEST_FAST | RTEST_SYSTEM)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  http_bench_run (16);
+  http_bench_run (64);
+}
+RTEST_END;
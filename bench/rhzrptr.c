@@ -0,0 +1,132 @@
+#include <rlib/rlib.h>
+
+#define HZR_BENCH_READERS   4
+#define HZR_BENCH_READS     2000000
+/* Reads done for every write */
+#define HZR_BENCH_RATIO     1000
+
+typedef struct {
+  rhzrptr hp;
+  repochptr ep;
+  rauint readers;
+  rauint reads;
+  rsize writes;
+} RHzrBenchCtx;
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static rsize *
+hzr_bench_value_new (rsize val)
+{
+  rsize * ret = r_mem_new (rsize);
+  *ret = val;
+  return ret;
+}
+
+static rpointer
+hzr_bench_hzr_reader (rpointer data)
+{
+  RHzrBenchCtx * ctx = data;
+  RHzrPtrRec * rec = r_hzr_ptr_rec_new ();
+  rsize i, sum = 0;
+
+  for (i = 0; i < HZR_BENCH_READS; i++) {
+    sum += *(rsize *)r_hzr_ptr_aqcuire (&ctx->hp, rec);
+    r_hzr_ptr_release (&ctx->hp, rec);
+    if ((i % HZR_BENCH_RATIO) == 0)
+      r_atomic_uint_fetch_add (&ctx->reads, HZR_BENCH_RATIO);
+  }
+
+  r_hzr_ptr_rec_free (rec);
+  r_atomic_uint_fetch_sub (&ctx->readers, 1);
+  return RSIZE_TO_POINTER (sum);
+}
+
+static rpointer
+hzr_bench_epoch_reader (rpointer data)
+{
+  RHzrBenchCtx * ctx = data;
+  REpochPtrRec * rec = r_epoch_ptr_rec_new ();
+  rsize i, sum = 0;
+
+  for (i = 0; i < HZR_BENCH_READS; i++) {
+    sum += *(rsize *)r_epoch_ptr_aqcuire (&ctx->ep, rec);
+    r_epoch_ptr_release (&ctx->ep, rec);
+    if ((i % HZR_BENCH_RATIO) == 0)
+      r_atomic_uint_fetch_add (&ctx->reads, HZR_BENCH_RATIO);
+  }
+
+  r_epoch_ptr_rec_free (rec);
+  r_atomic_uint_fetch_sub (&ctx->readers, 1);
+  return RSIZE_TO_POINTER (sum);
+}
+
+/* Replace once for every HZR_BENCH_RATIO reads until the readers are done */
+static void
+hzr_bench_run (const rchar * name, RThreadFunc reader, RHzrBenchCtx * ctx,
+    void (*replace) (RHzrBenchCtx *, rsize))
+{
+  RThread * threads[HZR_BENCH_READERS];
+  RClockTime start, end;
+  ruint i;
+
+  r_atomic_uint_store (&ctx->readers, HZR_BENCH_READERS);
+  r_atomic_uint_store (&ctx->reads, 0);
+  ctx->writes = 0;
+  replace (ctx, 0);
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < HZR_BENCH_READERS; i++)
+    r_assert_cmpptr ((threads[i] = r_thread_new ("hzrbench", reader, ctx)), !=, NULL);
+  while (r_atomic_uint_load (&ctx->readers) > 0) {
+    if (r_atomic_uint_load (&ctx->reads) / HZR_BENCH_RATIO > ctx->writes)
+      replace (ctx, ++ctx->writes);
+    else
+      r_thread_yield ();
+  }
+  end = r_time_get_ts_monotonic ();
+
+  for (i = 0; i < HZR_BENCH_READERS; i++) {
+    r_thread_join (threads[i]);
+    r_thread_unref (threads[i]);
+  }
+
+  r_print ("\t%-8s %u readers: %10"RINT64_FMT" reads/s  %7"RSIZE_FMT" writes\n",
+      name, HZR_BENCH_READERS,
+      bench_rate ((rsize)HZR_BENCH_READS * HZR_BENCH_READERS, start, end),
+      ctx->writes);
+}
+
+static void
+hzr_bench_hzr_replace (RHzrBenchCtx * ctx, rsize val)
+{
+  r_hzr_ptr_replace (&ctx->hp, hzr_bench_value_new (val));
+}
+
+static void
+hzr_bench_epoch_replace (RHzrBenchCtx * ctx, rsize val)
+{
+  r_epoch_ptr_replace (&ctx->ep, hzr_bench_value_new (val));
+}
+
+RTEST_BENCH (rhzrptr, read_mostly, RTEST_FAST | RTEST_SYSTEM)
+{
+  RHzrBenchCtx ctx = { R_HZR_PTR_INIT (r_free), R_EPOCH_PTR_INIT (r_free), 0, 0, 0 };
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- 1 write per %u reads\n",
+      R_TIME_ARGS (0), R_STRFUNC, HZR_BENCH_RATIO);
+
+  hzr_bench_run ("hazard", hzr_bench_hzr_reader, &ctx, hzr_bench_hzr_replace);
+  r_hzr_ptr_replace (&ctx.hp, NULL);
+  r_hzr_ptr_reclaim (NULL);
+
+  hzr_bench_run ("epoch", hzr_bench_epoch_reader, &ctx, hzr_bench_epoch_replace);
+  r_epoch_ptr_replace (&ctx.ep, NULL);
+  r_epoch_ptr_reclaim (NULL);
+}
+RTEST_END;
@@ -0,0 +1,92 @@
+#include <rlib/rlib.h>
+
+#define LOG_MSGS          100000
+#define LOG_THREADS_MAX   4
+
+R_LOG_CATEGORY_DEFINE_STATIC (rlogbenchcat, "logbench", "Logging benchmark",
+    R_CLR_BG_GREEN);
+#define R_LOG_CAT_DEFAULT &rlogbenchcat
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static rpointer
+log_bench_thread (rpointer data)
+{
+  RClockTime t0, t1;
+  rsize i;
+
+  (void) data;
+
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < LOG_MSGS; i++)
+    R_LOG_INFO ("log benchmark message %"RSIZE_FMT" of %d", i, LOG_MSGS);
+  t1 = r_time_get_ts_monotonic ();
+
+  return RSIZE_TO_POINTER (bench_rate (LOG_MSGS, t0, t1));
+}
+
+static void
+log_bench_run (const rchar * name, RLogFunc func, rpointer data)
+{
+  RThread * threads[LOG_THREADS_MAX];
+  RLogFunc oldfunc;
+  rpointer olddata;
+  rsize i, n;
+
+  oldfunc = r_log_override_default_handler (func, data, &olddata);
+  for (n = 1; n <= LOG_THREADS_MAX; n *= 2) {
+    rsize rate = 0;
+
+    for (i = 0; i < n; i++)
+      r_assert_cmpptr ((threads[i] = r_thread_new ("logbench", log_bench_thread, NULL)), !=, NULL);
+    for (i = 0; i < n; i++) {
+      rate += RPOINTER_TO_SIZE (r_thread_join (threads[i]));
+      r_thread_unref (threads[i]);
+    }
+
+    r_log_override_default_handler (oldfunc, olddata, NULL);
+    r_print ("\t%-12s %"RSIZE_FMT" thread(s) %9"RSIZE_FMT" calls/s per thread\n",
+        name, n, rate / n);
+    r_log_override_default_handler (func, data, NULL);
+  }
+  r_log_override_default_handler (oldfunc, olddata, NULL);
+}
+
+#ifdef R_OS_UNIX
+RTEST_BENCH (rlog, async, RTEST_FAST)
+{
+  RLogLevel oldlvl;
+  RLogAsync * async;
+  FILE * f;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((f = fopen ("/dev/null", "w")), !=, NULL);
+  r_log_category_register (R_LOG_CAT_DEFAULT);
+  oldlvl = r_log_category_get_threshold (R_LOG_CAT_DEFAULT);
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_INFO);
+
+  log_bench_run ("sync", r_log_default_handler, f);
+
+  r_assert_cmpptr ((async = r_log_async_new (r_fileno (f),
+          R_LOG_ASYNC_RING_SIZE_DEFAULT, R_LOG_ASYNC_BLOCK)), !=, NULL);
+  log_bench_run ("async block", r_log_async_handler, async);
+  r_log_async_free (async);
+
+  r_assert_cmpptr ((async = r_log_async_new (r_fileno (f),
+          R_LOG_ASYNC_RING_SIZE_DEFAULT, R_LOG_ASYNC_DROP)), !=, NULL);
+  log_bench_run ("async drop", r_log_async_handler, async);
+  r_print ("\t%-12s %u messages dropped\n", "", r_log_async_get_dropped (async));
+  r_log_async_free (async);
+
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, oldlvl);
+  r_log_category_unregister (R_LOG_CAT_DEFAULT);
+  fclose (f);
+}
+RTEST_END;
+#endif
@@ -0,0 +1,192 @@
+#include <rlib/rlib.h>
+
+static const rsize mpint_bench_bits[] = { 512, 1024, 2048, 4096, 8192 };
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static void
+mpint_bench_random (rmpint * mpi, RPrng * prng, rsize bits)
+{
+  ruint8 * tmp = r_alloca (bits / 8);
+
+  r_assert (r_prng_fill (prng, tmp, bits / 8));
+  tmp[0] |= 0x80;
+  tmp[bits / 8 - 1] |= 1;
+  r_mpint_init_binary (mpi, tmp, bits / 8);
+}
+
+/* Number of operations for roughly the same amount of work at every size */
+static rsize
+mpint_bench_count (rsize scale, rsize bits)
+{
+  return MAX (scale / ((bits / 512) * (bits / 512)), 4);
+}
+
+RTEST_BENCH (rmpint, mul, RTEST_FAST)
+{
+  RPrng * prng;
+  rsize b;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((prng = r_prng_new_mt ()), !=, NULL);
+  for (b = 0; b < R_N_ELEMENTS (mpint_bench_bits); b++) {
+    rmpint x, y, p;
+    rsize i, count = mpint_bench_count (400000, mpint_bench_bits[b]);
+    RClockTime t0, t1;
+
+    mpint_bench_random (&x, prng, mpint_bench_bits[b]);
+    mpint_bench_random (&y, prng, mpint_bench_bits[b]);
+    r_mpint_init (&p);
+
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < count; i++)
+      r_mpint_mul (&p, &x, &y);
+    t1 = r_time_get_ts_monotonic ();
+
+    r_print ("\t%5"RSIZE_FMT" x %5"RSIZE_FMT" bits %9"RINT64_FMT" op/s\n",
+        mpint_bench_bits[b], mpint_bench_bits[b], bench_rate (count, t0, t1));
+
+    r_mpint_clear (&x);
+    r_mpint_clear (&y);
+    r_mpint_clear (&p);
+  }
+  r_prng_unref (prng);
+}
+RTEST_END;
+
+RTEST_BENCH (rmpint, sqr, RTEST_FAST)
+{
+  RPrng * prng;
+  rsize b;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((prng = r_prng_new_mt ()), !=, NULL);
+  for (b = 0; b < R_N_ELEMENTS (mpint_bench_bits); b++) {
+    rmpint x, p;
+    rsize i, count = mpint_bench_count (400000, mpint_bench_bits[b]);
+    RClockTime t0, t1;
+
+    mpint_bench_random (&x, prng, mpint_bench_bits[b]);
+    r_mpint_init (&p);
+
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < count; i++)
+      r_mpint_sqr (&p, &x);
+    t1 = r_time_get_ts_monotonic ();
+
+    r_print ("\t%5"RSIZE_FMT" bits %9"RINT64_FMT" op/s\n",
+        mpint_bench_bits[b], bench_rate (count, t0, t1));
+
+    r_mpint_clear (&x);
+    r_mpint_clear (&p);
+  }
+  r_prng_unref (prng);
+}
+RTEST_END;
+
+RTEST_BENCH (rmpint, div, RTEST_FAST)
+{
+  RPrng * prng;
+  rsize b;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((prng = r_prng_new_mt ()), !=, NULL);
+  for (b = 0; b < R_N_ELEMENTS (mpint_bench_bits); b++) {
+    rmpint n, d, q, r;
+    rsize i, count = mpint_bench_count (100000, mpint_bench_bits[b]);
+    RClockTime t0, t1;
+
+    /* 2n / n bits, like reducing a product */
+    mpint_bench_random (&n, prng, 2 * mpint_bench_bits[b]);
+    mpint_bench_random (&d, prng, mpint_bench_bits[b]);
+    r_mpint_init (&q);
+    r_mpint_init (&r);
+
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < count; i++)
+      r_mpint_div (&q, &r, &n, &d);
+    t1 = r_time_get_ts_monotonic ();
+
+    r_print ("\t%5"RSIZE_FMT" / %5"RSIZE_FMT" bits %9"RINT64_FMT" op/s\n",
+        2 * mpint_bench_bits[b], mpint_bench_bits[b], bench_rate (count, t0, t1));
+
+    r_mpint_clear (&n);
+    r_mpint_clear (&d);
+    r_mpint_clear (&q);
+    r_mpint_clear (&r);
+  }
+  r_prng_unref (prng);
+}
+RTEST_END;
+
+RTEST_BENCH (rmpint, expmod, RTEST_FAST)
+{
+  RPrng * prng;
+  rsize b;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((prng = r_prng_new_mt ()), !=, NULL);
+  for (b = 0; b < R_N_ELEMENTS (mpint_bench_bits) - 1; b++) {
+    rmpint x, e, m, r;
+    rsize i, count = mpint_bench_count (1000, mpint_bench_bits[b]) / 2;
+    RClockTime t0, t1;
+
+    mpint_bench_random (&m, prng, mpint_bench_bits[b]);
+    mpint_bench_random (&x, prng, mpint_bench_bits[b] - 8);
+    mpint_bench_random (&e, prng, mpint_bench_bits[b]);
+    r_mpint_init (&r);
+
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < count; i++)
+      r_mpint_expmod (&r, &x, &e, &m);
+    t1 = r_time_get_ts_monotonic ();
+
+    r_print ("\t%5"RSIZE_FMT" bits %9"RINT64_FMT" op/s\n",
+        mpint_bench_bits[b], bench_rate (count, t0, t1));
+
+    r_mpint_clear (&x);
+    r_mpint_clear (&e);
+    r_mpint_clear (&m);
+    r_mpint_clear (&r);
+  }
+  r_prng_unref (prng);
+}
+RTEST_END;
+
+RTEST_BENCH (rmpint, gen_prime, RTEST_FAST)
+{
+  RPrng * prng;
+  rsize b;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((prng = r_prng_new_mt ()), !=, NULL);
+  for (b = 0; b < 3; b++) {
+    rmpint p;
+    rsize i, count = mpint_bench_count (64, mpint_bench_bits[b]);
+    RClockTime t0, t1;
+
+    r_mpint_init (&p);
+
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < count; i++)
+      r_assert (r_mpint_gen_prime (&p, mpint_bench_bits[b], prng));
+    t1 = r_time_get_ts_monotonic ();
+
+    r_print ("\t%5"RSIZE_FMT" bits %9"RINT64_FMT" ms/op\n",
+        mpint_bench_bits[b], (rint64)(R_CLOCK_DIFF (t0, t1) / count / R_MSECOND));
+
+    r_mpint_clear (&p);
+  }
+  r_prng_unref (prng);
+}
+RTEST_END;
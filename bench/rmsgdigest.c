@@ -0,0 +1,133 @@
+#include <rlib/rlib.h>
+
+#if defined (__x86_64__) || defined (__i386__)
+#include <x86intrin.h>
+/* TSC ticks, the nominal rather than the actual core clock */
+#define MD_BENCH_CYCLES()     ((ruint64)__rdtsc ())
+#else
+#define MD_BENCH_CYCLES()     ((ruint64)r_time_get_ts_monotonic ())
+#endif
+
+#define MD_BENCH_BYTES        (16 * 1024 * 1024)
+#define MD_BENCH_MULTI        32
+
+static const rchar *
+md_bench_impl_str (RMsgDigestImpl impl)
+{
+  switch (impl) {
+    case R_MSG_DIGEST_IMPL_PORTABLE:
+      return "portable";
+    case R_MSG_DIGEST_IMPL_SHANI:
+      return "sha-ni";
+    case R_MSG_DIGEST_IMPL_AVX2:
+      return "avx2";
+    default:
+      return "auto";
+  }
+}
+
+static void
+md_bench_run (RMsgDigestType type, RMsgDigestImpl impl, const ruint8 * buf, rsize size)
+{
+  RMsgDigest * md;
+  ruint8 out[64];
+  ruint64 c0, c1;
+  rsize i, iterations = MAX (MD_BENCH_BYTES / size, 1);
+
+  if ((md = r_msg_digest_new_with_impl (type, impl)) == NULL)
+    return;
+
+  c0 = MD_BENCH_CYCLES ();
+  for (i = 0; i < iterations; i++) {
+    r_msg_digest_reset (md);
+    r_msg_digest_update (md, buf, size);
+    r_msg_digest_finish (md);
+    r_msg_digest_get_data (md, out, sizeof (out), NULL);
+  }
+  c1 = MD_BENCH_CYCLES ();
+
+  r_print ("\t%-8s %-8s %6"RSIZE_FMT" B %7.2f cycles/B\n",
+      r_msg_digest_type_string (type), md_bench_impl_str (impl), size,
+      (double)(c1 - c0) / (double)(iterations * size));
+
+  r_msg_digest_free (md);
+}
+
+RTEST_BENCH (rmsgdigest, single, RTEST_FAST)
+{
+  static const RMsgDigestType types[] = {
+    R_MSG_DIGEST_TYPE_MD5, R_MSG_DIGEST_TYPE_SHA1,
+    R_MSG_DIGEST_TYPE_SHA256, R_MSG_DIGEST_TYPE_SHA512 };
+  static const rsize sizes[] = { 64, 1500, 16384 };
+  ruint8 * buf;
+  rsize i, j;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+
+  r_assert_cmpptr ((buf = r_malloc (sizes[R_N_ELEMENTS (sizes) - 1])), !=, NULL);
+  r_memset (buf, 0x42, sizes[R_N_ELEMENTS (sizes) - 1]);
+
+  for (i = 0; i < R_N_ELEMENTS (types); i++) {
+    for (j = 0; j < R_N_ELEMENTS (sizes); j++) {
+      md_bench_run (types[i], R_MSG_DIGEST_IMPL_PORTABLE, buf, sizes[j]);
+      md_bench_run (types[i], R_MSG_DIGEST_IMPL_SHANI, buf, sizes[j]);
+    }
+  }
+
+  r_free (buf);
+}
+RTEST_END;
+
+static void
+md_bench_multi_run (RMsgDigestType type, RMsgDigestImpl impl, const ruint8 * buf, rsize size)
+{
+  RMsgDigest * md;
+  RMemChunk msgs[MD_BENCH_MULTI];
+  ruint8 out[MD_BENCH_MULTI * 64];
+  ruint64 c0, c1;
+  rsize i, iterations = MAX (MD_BENCH_BYTES / (size * MD_BENCH_MULTI), 1);
+
+  if ((md = r_msg_digest_new_with_impl (type, impl)) == NULL)
+    return;
+  for (i = 0; i < MD_BENCH_MULTI; i++) {
+    msgs[i].data = (ruint8 *)buf + i * size;
+    msgs[i].size = size;
+  }
+
+  c0 = MD_BENCH_CYCLES ();
+  for (i = 0; i < iterations; i++)
+    r_assert (r_msg_digest_compute_multi (md, msgs, MD_BENCH_MULTI, out, sizeof (out)));
+  c1 = MD_BENCH_CYCLES ();
+
+  r_print ("\t%-8s %-8s %6"RSIZE_FMT" B %7.2f cycles/B\n",
+      r_msg_digest_type_string (type), md_bench_impl_str (impl), size,
+      (double)(c1 - c0) / (double)(iterations * size * MD_BENCH_MULTI));
+
+  r_msg_digest_free (md);
+}
+
+RTEST_BENCH (rmsgdigest, multi, RTEST_FAST)
+{
+  static const RMsgDigestType types[] = {
+    R_MSG_DIGEST_TYPE_SHA1, R_MSG_DIGEST_TYPE_SHA256 };
+  static const rsize sizes[] = { 64, 200, 1500 };
+  ruint8 * buf;
+  rsize i, j, bufsize = MD_BENCH_MULTI * sizes[R_N_ELEMENTS (sizes) - 1];
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %u messages per call\n",
+      R_TIME_ARGS (0), R_STRFUNC, MD_BENCH_MULTI);
+
+  r_assert_cmpptr ((buf = r_malloc (bufsize)), !=, NULL);
+  r_memset (buf, 0x42, bufsize);
+
+  for (i = 0; i < R_N_ELEMENTS (types); i++) {
+    for (j = 0; j < R_N_ELEMENTS (sizes); j++) {
+      md_bench_multi_run (types[i], R_MSG_DIGEST_IMPL_PORTABLE, buf, sizes[j]);
+      md_bench_multi_run (types[i], R_MSG_DIGEST_IMPL_SHANI, buf, sizes[j]);
+      md_bench_multi_run (types[i], R_MSG_DIGEST_IMPL_AVX2, buf, sizes[j]);
+    }
+  }
+
+  r_free (buf);
+}
+RTEST_END;
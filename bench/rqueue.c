@@ -0,0 +1,175 @@
+#include <rlib/rlib.h>
+
+#define QUEUE_BENCH_ITEMS     (1 << 20)
+#define QUEUE_BENCH_SIZE      1024
+#define QUEUE_BENCH_BATCH     16
+#define QUEUE_BENCH_MAX       16
+
+typedef enum {
+  QUEUE_BENCH_MUTEX,
+  QUEUE_BENCH_SPSC,
+  QUEUE_BENCH_MPMC,
+  QUEUE_BENCH_MPMC_BATCH,
+} RQueueBenchType;
+
+typedef struct {
+  RQueueBenchType type;
+  RMutex mutex;
+  RQueueList list;
+  RQueueSPSC * spsc;
+  RQueueMPMC * mpmc;
+
+  rsize perproducer;
+  rauint popped;
+} RQueueBenchCtx;
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static rsize
+queue_bench_push (RQueueBenchCtx * ctx, rpointer const * items, rsize count)
+{
+  switch (ctx->type) {
+    case QUEUE_BENCH_MUTEX:
+      r_mutex_lock (&ctx->mutex);
+      /* Bounded like the rings, for a fair comparison */
+      if (r_queue_list_size (&ctx->list) >= QUEUE_BENCH_SIZE) {
+        count = 0;
+      } else {
+        count = 1;
+        r_queue_list_push (&ctx->list, items[0]);
+      }
+      r_mutex_unlock (&ctx->mutex);
+      return count;
+    case QUEUE_BENCH_SPSC:
+      return r_queue_spsc_push_n (ctx->spsc, items, 1);
+    case QUEUE_BENCH_MPMC:
+      return r_queue_mpmc_push_n (ctx->mpmc, items, 1);
+    case QUEUE_BENCH_MPMC_BATCH:
+      return r_queue_mpmc_push_n (ctx->mpmc, items, count);
+  }
+
+  return 0;
+}
+
+static rsize
+queue_bench_pop (RQueueBenchCtx * ctx, rpointer * items)
+{
+  rsize ret;
+
+  switch (ctx->type) {
+    case QUEUE_BENCH_MUTEX:
+      r_mutex_lock (&ctx->mutex);
+      ret = (items[0] = r_queue_list_pop (&ctx->list)) != NULL;
+      r_mutex_unlock (&ctx->mutex);
+      return ret;
+    case QUEUE_BENCH_SPSC:
+      return r_queue_spsc_pop_n (ctx->spsc, items, 1);
+    case QUEUE_BENCH_MPMC:
+      return r_queue_mpmc_pop_n (ctx->mpmc, items, 1);
+    case QUEUE_BENCH_MPMC_BATCH:
+      return r_queue_mpmc_pop_n (ctx->mpmc, items, QUEUE_BENCH_BATCH);
+  }
+
+  return 0;
+}
+
+static rpointer
+queue_bench_producer (rpointer data)
+{
+  RQueueBenchCtx * ctx = data;
+  rpointer items[QUEUE_BENCH_BATCH];
+  rsize i, n, left;
+
+  for (i = 0; i < QUEUE_BENCH_BATCH; i++)
+    items[i] = RSIZE_TO_POINTER (i + 1);
+
+  for (left = ctx->perproducer; left > 0; left -= n) {
+    if ((n = queue_bench_push (ctx, items, MIN (left, QUEUE_BENCH_BATCH))) == 0)
+      r_thread_yield ();
+  }
+
+  return NULL;
+}
+
+static rpointer
+queue_bench_consumer (rpointer data)
+{
+  RQueueBenchCtx * ctx = data;
+  rpointer items[QUEUE_BENCH_BATCH];
+  rsize n;
+
+  while (r_atomic_uint_load (&ctx->popped) < QUEUE_BENCH_ITEMS) {
+    if ((n = queue_bench_pop (ctx, items)) > 0)
+      r_atomic_uint_fetch_add (&ctx->popped, (ruint)n);
+    else
+      r_thread_yield ();
+  }
+
+  return NULL;
+}
+
+static rint64
+queue_bench_run (RQueueBenchType type, ruint threads)
+{
+  RQueueBenchCtx ctx;
+  RThread * producers[QUEUE_BENCH_MAX], * consumers[QUEUE_BENCH_MAX];
+  RClockTime start, end;
+  ruint i;
+
+  r_memclear (&ctx, sizeof (RQueueBenchCtx));
+  ctx.type = type;
+  r_mutex_init (&ctx.mutex);
+  r_queue_list_init (&ctx.list);
+  r_assert_cmpptr ((ctx.spsc = r_queue_spsc_new (QUEUE_BENCH_SIZE)), !=, NULL);
+  r_assert_cmpptr ((ctx.mpmc = r_queue_mpmc_new (QUEUE_BENCH_SIZE)), !=, NULL);
+  ctx.perproducer = QUEUE_BENCH_ITEMS / threads;
+
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < threads; i++) {
+    r_assert_cmpptr ((consumers[i] = r_thread_new ("consumer", queue_bench_consumer, &ctx)), !=, NULL);
+    r_assert_cmpptr ((producers[i] = r_thread_new ("producer", queue_bench_producer, &ctx)), !=, NULL);
+  }
+  for (i = 0; i < threads; i++) {
+    r_thread_join (producers[i]);
+    r_thread_unref (producers[i]);
+    r_thread_join (consumers[i]);
+    r_thread_unref (consumers[i]);
+  }
+  end = r_time_get_ts_monotonic ();
+
+  r_queue_spsc_unref (ctx.spsc);
+  r_queue_mpmc_unref (ctx.mpmc);
+  r_mutex_clear (&ctx.mutex);
+
+  return bench_rate (QUEUE_BENCH_ITEMS, start, end);
+}
+
+RTEST_BENCH (rqueue, threads, RTEST_FAST | RTEST_SYSTEM)
+{
+  ruint threads;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %u items, bounded to %u\n",
+      R_TIME_ARGS (0), R_STRFUNC, QUEUE_BENCH_ITEMS, QUEUE_BENCH_SIZE);
+  r_print ("\tproducers/consumers  mutex+RQueueList       spsc       mpmc  mpmc batch %u\n",
+      QUEUE_BENCH_BATCH);
+
+  for (threads = 1; threads <= QUEUE_BENCH_MAX; threads *= 2) {
+    rint64 mutex = queue_bench_run (QUEUE_BENCH_MUTEX, threads);
+    rint64 mpmc = queue_bench_run (QUEUE_BENCH_MPMC, threads);
+    rint64 batch = queue_bench_run (QUEUE_BENCH_MPMC_BATCH, threads);
+
+    if (threads == 1) {
+      r_print ("\t%9u/%-9u  %16"RINT64_FMT" %10"RINT64_FMT" %10"RINT64_FMT" %13"RINT64_FMT" items/s\n",
+          threads, threads, mutex, queue_bench_run (QUEUE_BENCH_SPSC, threads), mpmc, batch);
+    } else {
+      r_print ("\t%9u/%-9u  %16"RINT64_FMT" %10s %10"RINT64_FMT" %13"RINT64_FMT" items/s\n",
+          threads, threads, mutex, "-", mpmc, batch);
+    }
+  }
+}
+RTEST_END;
@@ -0,0 +1,149 @@
+#include <rlib/rlib.h>
+#include <rlib/rnet.h>
+
+#define SRTP_PACKETS      100000
+#define SRTP_BATCH        32
+#define SRTP_PAYLOAD      160
+
+/* Long enough for the AES-256 profiles */
+static const ruint8 masterkey[] = {
+  0x3c, 0x39, 0xa8, 0x5c, 0x2d, 0xf0, 0x5e, 0x52, 0x7e, 0x79, 0x12, 0xba, 0x60, 0xc5, 0x25, 0xfe,
+  0x29, 0xf7, 0x97, 0xd9, 0xda, 0xa3, 0x17, 0x60, 0xdf, 0x34, 0xb9, 0x5f, 0x87, 0xd3, 0x5d, 0x41,
+  0x62, 0x0e, 0x96, 0x1b, 0xc4, 0x37, 0x88, 0xa0, 0x3f, 0x71, 0x2b, 0xe6
+};
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static RBuffer *
+srtp_bench_packet (rsize seq)
+{
+  ruint8 pkt[R_RTP_HDR_SIZE + SRTP_PAYLOAD];
+  RBuffer * ret;
+
+  r_memset (pkt, 0x42, sizeof (pkt));
+  pkt[0] = 0x80;
+  pkt[1] = 0x6f;
+  pkt[2] = (ruint8)(seq >> 8);
+  pkt[3] = (ruint8)seq;
+  pkt[8] = 0xb4; pkt[9] = 0x76; pkt[10] = 0x82; pkt[11] = 0x3a;
+
+  r_assert_cmpptr ((ret = r_buffer_new_alloc (NULL, sizeof (pkt) + 32, NULL)), !=, NULL);
+  r_assert_cmpuint (r_buffer_fill (ret, 0, pkt, sizeof (pkt)), ==, sizeof (pkt));
+  r_assert (r_buffer_set_size (ret, sizeof (pkt)));
+  return ret;
+}
+
+static RSRTPCtx *
+srtp_bench_ctx (RSRTPCipherSuite cs)
+{
+  RSRTPCtx * ret;
+
+  r_assert_cmpptr ((ret = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_with_filter (ret, R_SRTP_FILTER_ANY,
+        cs, masterkey), ==, R_SRTP_ERROR_OK);
+  return ret;
+}
+
+static void
+srtp_bench_run (RSRTPCipherSuite cs, RBuffer ** bufs)
+{
+  RSRTPCtx * enc, * dec;
+  RSRTPError err;
+  RClockTime t0, t1, t2;
+  rsize i, j;
+
+  r_print ("\t%s\n", r_srtp_cipher_suite_get_info (cs)->str);
+
+  /* Copying variants */
+  enc = srtp_bench_ctx (cs);
+  dec = srtp_bench_ctx (cs);
+  for (i = 0; i < SRTP_PACKETS; i++)
+    bufs[i] = srtp_bench_packet (i);
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i++) {
+    RBuffer * res = r_srtp_encrypt_rtp (enc, bufs[i], &err);
+    r_buffer_unref (bufs[i]);
+    bufs[i] = res;
+  }
+  t1 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i++) {
+    RBuffer * res = r_srtp_decrypt_rtp (dec, bufs[i], &err);
+    r_buffer_unref (bufs[i]);
+    bufs[i] = res;
+  }
+  t2 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i++)
+    r_buffer_unref (bufs[i]);
+  r_srtp_ctx_unref (enc);
+  r_srtp_ctx_unref (dec);
+  r_print ("\tcopy     encrypt %9"RINT64_FMT" pkt/s decrypt %9"RINT64_FMT" pkt/s\n",
+      bench_rate (SRTP_PACKETS, t0, t1), bench_rate (SRTP_PACKETS, t1, t2));
+
+  /* In-place */
+  enc = srtp_bench_ctx (cs);
+  dec = srtp_bench_ctx (cs);
+  for (i = 0; i < SRTP_PACKETS; i++)
+    bufs[i] = srtp_bench_packet (i);
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i++)
+    r_assert_cmpint (r_srtp_encrypt_rtp_inplace (enc, bufs[i]), ==, R_SRTP_ERROR_OK);
+  t1 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i++)
+    r_assert_cmpint (r_srtp_decrypt_rtp_inplace (dec, bufs[i]), ==, R_SRTP_ERROR_OK);
+  t2 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i++)
+    r_buffer_unref (bufs[i]);
+  r_srtp_ctx_unref (enc);
+  r_srtp_ctx_unref (dec);
+  r_print ("\tin-place encrypt %9"RINT64_FMT" pkt/s decrypt %9"RINT64_FMT" pkt/s\n",
+      bench_rate (SRTP_PACKETS, t0, t1), bench_rate (SRTP_PACKETS, t1, t2));
+
+  /* In-place batches */
+  enc = srtp_bench_ctx (cs);
+  dec = srtp_bench_ctx (cs);
+  for (i = 0; i < SRTP_PACKETS; i++)
+    bufs[i] = srtp_bench_packet (i);
+  t0 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i += j) {
+    j = MIN (SRTP_BATCH, SRTP_PACKETS - i);
+    r_assert_cmpuint (r_srtp_encrypt_rtp_batch (enc, &bufs[i], j, NULL), ==, j);
+  }
+  t1 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i += j) {
+    j = MIN (SRTP_BATCH, SRTP_PACKETS - i);
+    r_assert_cmpuint (r_srtp_decrypt_rtp_batch (dec, &bufs[i], j, NULL), ==, j);
+  }
+  t2 = r_time_get_ts_monotonic ();
+  for (i = 0; i < SRTP_PACKETS; i++)
+    r_buffer_unref (bufs[i]);
+  r_srtp_ctx_unref (enc);
+  r_srtp_ctx_unref (dec);
+  r_print ("\tbatch %2u encrypt %9"RINT64_FMT" pkt/s decrypt %9"RINT64_FMT" pkt/s\n",
+      SRTP_BATCH, bench_rate (SRTP_PACKETS, t0, t1), bench_rate (SRTP_PACKETS, t1, t2));
+}
+
+RTEST_BENCH (rsrtp, encrypt_decrypt_rtp, RTEST_FAST)
+{
+  /* AEAD drops the separate HMAC-SHA1 pass over the packet */
+  static const RSRTPCipherSuite suites[] = {
+    R_SRTP_CS_AES_128_CM_HMAC_SHA1_80,
+    R_SRTP_CS_AEAD_AES_128_GCM,
+    R_SRTP_CS_AEAD_AES_256_GCM,
+  };
+  RBuffer ** bufs;
+  rsize i;
+
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  r_assert_cmpptr ((bufs = r_mem_new_n (RBuffer *, SRTP_PACKETS)), !=, NULL);
+
+  for (i = 0; i < R_N_ELEMENTS (suites); i++)
+    srtp_bench_run (suites[i], bufs);
+
+  r_free (bufs);
+}
+RTEST_END;
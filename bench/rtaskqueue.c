@@ -0,0 +1,267 @@
+#include <rlib/rlib.h>
+
+#include <stdlib.h>
+
+#define TQ_BENCH_TASKS        100000
+#define TQ_BENCH_THREADS_MAX  64
+
+typedef struct {
+  RClockTime queued;
+  RClockTimeDiff lat;
+  rauint * done;
+} RTQBenchTask;
+
+typedef struct {
+  rauint left;
+  rauint done;
+} RTQBenchTree;
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static int
+tq_bench_cmp_lat (const void * a, const void * b)
+{
+  RClockTimeDiff x = ((const RTQBenchTask *)a)->lat;
+  RClockTimeDiff y = ((const RTQBenchTask *)b)->lat;
+  return (x > y) - (x < y);
+}
+
+static void
+tq_bench_task (rpointer data, RTaskQueue * tq, RTask * task)
+{
+  RTQBenchTask * t = data;
+
+  (void) tq;
+  (void) task;
+
+  t->lat = R_CLOCK_DIFF (t->queued, r_time_get_ts_monotonic ());
+  r_atomic_uint_fetch_add (t->done, 1);
+}
+
+/* Every task spawns two more until TQ_BENCH_TASKS have been spawned */
+static void
+tq_bench_tree_task (rpointer data, RTaskQueue * tq, RTask * task)
+{
+  RTQBenchTree * tree = data;
+  ruint i;
+
+  (void) task;
+
+  for (i = 0; i < 2; i++) {
+    if ((int)r_atomic_uint_fetch_sub (&tree->left, 1) <= 0)
+      break;
+    r_task_unref (r_task_queue_add (tq, tq_bench_tree_task, tree, NULL));
+  }
+  r_atomic_uint_fetch_add (&tree->done, 1);
+}
+
+static void
+tq_bench_run (const rchar * name, RTaskQueueFlags flags)
+{
+  RTQBenchTask * tasks;
+  ruint n;
+
+  r_assert_cmpptr ((tasks = r_mem_new_n (RTQBenchTask, TQ_BENCH_TASKS)), !=, NULL);
+
+  for (n = 1; n <= TQ_BENCH_THREADS_MAX; n *= 2) {
+    RTaskQueue * tq;
+    RTQBenchTree tree;
+    rauint done;
+    RClockTime t0, t1, t2;
+    rsize i;
+
+    r_assert_cmpptr ((tq = r_task_queue_new_full (1, n, flags)), !=, NULL);
+
+    /* Tasks added from outside of the queue */
+    r_atomic_uint_store (&done, 0);
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < TQ_BENCH_TASKS; i++) {
+      tasks[i].done = &done;
+      tasks[i].queued = r_time_get_ts_monotonic ();
+      r_task_unref (r_task_queue_add (tq, tq_bench_task, &tasks[i], NULL));
+    }
+    while (r_atomic_uint_load (&done) < TQ_BENCH_TASKS)
+      r_thread_yield ();
+    t1 = r_time_get_ts_monotonic ();
+
+    /* Tasks added from tasks */
+    r_atomic_uint_store (&tree.left, TQ_BENCH_TASKS - 1);
+    r_atomic_uint_store (&tree.done, 0);
+    r_task_unref (r_task_queue_add (tq, tq_bench_tree_task, &tree, NULL));
+    while (r_atomic_uint_load (&tree.done) < TQ_BENCH_TASKS)
+      r_thread_yield ();
+    t2 = r_time_get_ts_monotonic ();
+
+    r_task_queue_unref (tq);
+
+    qsort (tasks, TQ_BENCH_TASKS, sizeof (RTQBenchTask), tq_bench_cmp_lat);
+    r_print ("\t%-14s %2u thread(s) external: %9"RINT64_FMT" tasks/s"
+        "  p50: %6"RINT64_FMT" us  p99: %6"RINT64_FMT" us  spawned: %9"RINT64_FMT" tasks/s\n",
+        name, n, bench_rate (TQ_BENCH_TASKS, t0, t1),
+        (rint64)(tasks[TQ_BENCH_TASKS / 2].lat / R_USECOND),
+        (rint64)(tasks[(TQ_BENCH_TASKS * 99) / 100].lat / R_USECOND),
+        bench_rate (TQ_BENCH_TASKS, t1, t2));
+  }
+
+  r_free (tasks);
+}
+
+static void
+tq_bench_nop (rpointer data, RTaskQueue * tq, RTask * task)
+{
+  (void) data;
+  (void) tq;
+  (void) task;
+}
+
+/* root -> TQ_BENCH_TASKS - 2 independent tasks -> sink */
+static RClockTimeDiff
+tq_bench_dag_fan (RTaskQueue * tq)
+{
+  RTask * root, * sink, * t;
+  RClockTime t0;
+  rsize i;
+
+  t0 = r_time_get_ts_monotonic ();
+  r_assert_cmpptr ((root = r_task_queue_allocate (tq, tq_bench_nop, NULL, NULL)), !=, NULL);
+  r_assert_cmpptr ((sink = r_task_queue_allocate (tq, tq_bench_nop, NULL, NULL)), !=, NULL);
+  r_assert (r_task_queue_add_task (tq, root));
+  for (i = 0; i < TQ_BENCH_TASKS - 2; i++) {
+    r_assert_cmpptr ((t = r_task_queue_add_full (tq, RUINT_MAX, tq_bench_nop, NULL, NULL, root, NULL)), !=, NULL);
+    r_assert (r_task_add_dep (sink, t, NULL));
+    r_task_unref (t);
+  }
+  r_assert (r_task_queue_add_task (tq, sink));
+  r_assert (r_task_wait (sink));
+
+  r_task_unref (root);
+  r_task_unref (sink);
+  return R_CLOCK_DIFF (t0, r_time_get_ts_monotonic ());
+}
+
+/* Item i in stage s depends on item i in stage s - 1 and item i - 1 in s */
+#define TQ_BENCH_PIPELINE_ITEMS   100
+static RClockTimeDiff
+tq_bench_dag_pipeline (RTaskQueue * tq)
+{
+  RTask * prev[TQ_BENCH_PIPELINE_ITEMS], * cur[TQ_BENCH_PIPELINE_ITEMS];
+  RClockTime t0;
+  rsize i, s;
+
+  t0 = r_time_get_ts_monotonic ();
+  for (s = 0; s < TQ_BENCH_TASKS / TQ_BENCH_PIPELINE_ITEMS; s++) {
+    for (i = 0; i < TQ_BENCH_PIPELINE_ITEMS; i++) {
+      r_assert_cmpptr ((cur[i] = r_task_queue_add_full (tq, RUINT_MAX, tq_bench_nop, NULL, NULL,
+              s > 0 ? prev[i] : NULL, i > 0 ? cur[i - 1] : NULL, NULL)), !=, NULL);
+    }
+    if (s > 0) {
+      for (i = 0; i < TQ_BENCH_PIPELINE_ITEMS; i++)
+        r_task_unref (prev[i]);
+    }
+    r_memcpy (prev, cur, sizeof (cur));
+  }
+  r_assert (r_task_wait (prev[TQ_BENCH_PIPELINE_ITEMS - 1]));
+
+  for (i = 0; i < TQ_BENCH_PIPELINE_ITEMS; i++)
+    r_task_unref (prev[i]);
+  return R_CLOCK_DIFF (t0, r_time_get_ts_monotonic ());
+}
+
+static void
+tq_bench_dag_run (const rchar * name, RTaskQueueFlags flags)
+{
+  ruint n;
+
+  for (n = 1; n <= 16; n *= 4) {
+    RTaskQueue * tq;
+    RClockTimeDiff fan, pipeline;
+
+    r_assert_cmpptr ((tq = r_task_queue_new_full (1, n, flags)), !=, NULL);
+    fan = tq_bench_dag_fan (tq);
+    pipeline = tq_bench_dag_pipeline (tq);
+    r_task_queue_unref (tq);
+
+    r_print ("\t%-14s %2u thread(s) fan-out/fan-in: %9"RINT64_FMT" tasks/s"
+        "  pipeline: %9"RINT64_FMT" tasks/s\n", name, n,
+        bench_rate (TQ_BENCH_TASKS, 0, fan), bench_rate (TQ_BENCH_TASKS, 0, pipeline));
+  }
+}
+
+typedef struct {
+  RTaskQueue * tq;
+  rsize count;
+} RTQBenchWaiter;
+
+/* Every waiter thread queues tasks and waits for each of them */
+static rpointer
+tq_bench_waiter (rpointer data)
+{
+  RTQBenchWaiter * w = data;
+  RTask * t;
+  rsize i;
+
+  for (i = 0; i < w->count; i++) {
+    r_assert_cmpptr ((t = r_task_queue_add (w->tq, tq_bench_nop, NULL, NULL)), !=, NULL);
+    r_assert (r_task_wait (t));
+    r_task_unref (t);
+  }
+
+  return NULL;
+}
+
+static void
+tq_bench_waiters_run (const rchar * name, RTaskQueueFlags flags)
+{
+  RThread * threads[TQ_BENCH_THREADS_MAX];
+  RTQBenchWaiter w;
+  ruint n;
+
+  r_assert_cmpptr ((w.tq = r_task_queue_new_full (1, 4, flags)), !=, NULL);
+  for (n = 1; n <= TQ_BENCH_THREADS_MAX; n *= 4) {
+    RClockTime t0, t1;
+    ruint i;
+
+    w.count = TQ_BENCH_TASKS / 4 / n;
+    t0 = r_time_get_ts_monotonic ();
+    for (i = 0; i < n; i++)
+      r_assert_cmpptr ((threads[i] = r_thread_new ("tqwaiter", tq_bench_waiter, &w)), !=, NULL);
+    for (i = 0; i < n; i++) {
+      r_thread_join (threads[i]);
+      r_thread_unref (threads[i]);
+    }
+    t1 = r_time_get_ts_monotonic ();
+
+    r_print ("\t%-14s %2u waiter(s) %9"RINT64_FMT" waits/s\n",
+        name, n, bench_rate (w.count * n, t0, t1));
+  }
+  r_task_queue_unref (w.tq);
+}
+
+RTEST_BENCH (rtaskqueue, schedule, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  tq_bench_run ("mutex", R_TASK_QUEUE_FLAG_NONE);
+  tq_bench_run ("work stealing", R_TASK_QUEUE_FLAG_WORK_STEALING);
+}
+RTEST_END;
+
+RTEST_BENCH (rtaskqueue, dag, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  tq_bench_dag_run ("mutex", R_TASK_QUEUE_FLAG_NONE);
+  tq_bench_dag_run ("work stealing", R_TASK_QUEUE_FLAG_WORK_STEALING);
+}
+RTEST_END;
+
+RTEST_BENCH (rtaskqueue, waiters, RTEST_FAST)
+{
+  r_print ("%"R_TIME_FORMAT" --- %s ---\n", R_TIME_ARGS (0), R_STRFUNC);
+  tq_bench_waiters_run ("mutex", R_TASK_QUEUE_FLAG_NONE);
+  tq_bench_waiters_run ("work stealing", R_TASK_QUEUE_FLAG_WORK_STEALING);
+}
+RTEST_END;
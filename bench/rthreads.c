@@ -0,0 +1,240 @@
+#include <rlib/rlib.h>
+
+#define LOCK_BENCH_OPS        (1 << 20)
+#define LOCK_BENCH_MAX        8
+#define LOCK_BENCH_PINGPONG   (1 << 15)
+#define LOCK_BENCH_WRITE_EVERY  64
+
+typedef struct {
+  RMutex mutex;
+  RRWMutex rwmutex;
+  RCond cond;
+  RFastMutex fmutex;
+  RFastRWMutex frwmutex;
+  RFastCond fcond;
+
+  rboolean fast;
+  rsize perthread;
+  ruint64 counter;
+  rauint readsum;
+  rauint players;
+} RLockBenchCtx;
+
+static rint64
+bench_rate (rsize count, RClockTime start, RClockTime end)
+{
+  RClockTimeDiff cd = R_CLOCK_DIFF (start, end);
+  return cd > 0 ? ((rint64)count * R_SECOND) / cd : 0;
+}
+
+static void
+lock_bench_ctx_init (RLockBenchCtx * ctx, rboolean fast)
+{
+  r_memclear (ctx, sizeof (RLockBenchCtx));
+  ctx->fast = fast;
+  r_mutex_init (&ctx->mutex);
+  r_rwmutex_init (&ctx->rwmutex);
+  r_cond_init (&ctx->cond);
+  r_fast_mutex_init (&ctx->fmutex);
+  r_fast_rwmutex_init (&ctx->frwmutex);
+  r_fast_cond_init (&ctx->fcond);
+}
+
+static void
+lock_bench_ctx_clear (RLockBenchCtx * ctx)
+{
+  r_mutex_clear (&ctx->mutex);
+  r_rwmutex_clear (&ctx->rwmutex);
+  r_cond_clear (&ctx->cond);
+}
+
+static rint64
+lock_bench_run (RLockBenchCtx * ctx, RThreadFunc func, ruint threads, rsize ops)
+{
+  RThread * t[LOCK_BENCH_MAX];
+  RClockTime start, end;
+  ruint i;
+
+  ctx->perthread = ops / threads;
+  start = r_time_get_ts_monotonic ();
+  for (i = 0; i < threads; i++)
+    r_assert_cmpptr ((t[i] = r_thread_new ("lockbench", func, ctx)), !=, NULL);
+  for (i = 0; i < threads; i++) {
+    r_thread_join (t[i]);
+    r_thread_unref (t[i]);
+  }
+  end = r_time_get_ts_monotonic ();
+
+  return bench_rate (ctx->perthread * threads, start, end);
+}
+
+static rpointer
+lock_bench_mutex (rpointer data)
+{
+  RLockBenchCtx * ctx = data;
+  rsize i;
+
+  if (ctx->fast) {
+    for (i = 0; i < ctx->perthread; i++) {
+      r_fast_mutex_lock (&ctx->fmutex);
+      ctx->counter++;
+      r_fast_mutex_unlock (&ctx->fmutex);
+    }
+  } else {
+    for (i = 0; i < ctx->perthread; i++) {
+      r_mutex_lock (&ctx->mutex);
+      ctx->counter++;
+      r_mutex_unlock (&ctx->mutex);
+    }
+  }
+
+  return NULL;
+}
+
+RTEST_BENCH (rthreads, mutex, RTEST_FAST | RTEST_SYSTEM)
+{
+  RLockBenchCtx ctx;
+  RFastLockStats stats;
+  ruint threads;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %u lock/unlock, shared counter\n",
+      R_TIME_ARGS (0), R_STRFUNC, LOCK_BENCH_OPS);
+  r_print ("\tthreads       RMutex  RFastMutex  (contended     spun   parked)\n");
+
+  for (threads = 1; threads <= LOCK_BENCH_MAX; threads *= 2) {
+    rint64 mutex, fast;
+
+    lock_bench_ctx_init (&ctx, FALSE);
+    mutex = lock_bench_run (&ctx, lock_bench_mutex, threads, LOCK_BENCH_OPS);
+    lock_bench_ctx_clear (&ctx);
+
+    r_memclear (&stats, sizeof (RFastLockStats));
+    lock_bench_ctx_init (&ctx, TRUE);
+    r_fast_mutex_set_stats (&ctx.fmutex, &stats);
+    fast = lock_bench_run (&ctx, lock_bench_mutex, threads, LOCK_BENCH_OPS);
+    r_assert_cmpuint (ctx.counter, ==, ctx.perthread * threads);
+    lock_bench_ctx_clear (&ctx);
+
+    r_print ("\t%7u %12"RINT64_FMT" %11"RINT64_FMT"  (%9u %8u %8u) ops/s\n",
+        threads, mutex, fast, r_atomic_uint_load (&stats.contended),
+        r_atomic_uint_load (&stats.spun), r_atomic_uint_load (&stats.parked));
+  }
+}
+RTEST_END;
+
+static rpointer
+lock_bench_rwmutex (rpointer data)
+{
+  RLockBenchCtx * ctx = data;
+  ruint64 sum = 0;
+  rsize i;
+
+  for (i = 0; i < ctx->perthread; i++) {
+    if (i % LOCK_BENCH_WRITE_EVERY == 0) {
+      if (ctx->fast) {
+        r_fast_rwmutex_wrlock (&ctx->frwmutex);
+        ctx->counter++;
+        r_fast_rwmutex_wrunlock (&ctx->frwmutex);
+      } else {
+        r_rwmutex_wrlock (&ctx->rwmutex);
+        ctx->counter++;
+        r_rwmutex_wrunlock (&ctx->rwmutex);
+      }
+    } else {
+      if (ctx->fast) {
+        r_fast_rwmutex_rdlock (&ctx->frwmutex);
+        sum += ctx->counter;
+        r_fast_rwmutex_rdunlock (&ctx->frwmutex);
+      } else {
+        r_rwmutex_rdlock (&ctx->rwmutex);
+        sum += ctx->counter;
+        r_rwmutex_rdunlock (&ctx->rwmutex);
+      }
+    }
+  }
+
+  r_atomic_uint_fetch_add (&ctx->readsum, (ruint)sum);
+  return NULL;
+}
+
+RTEST_BENCH (rthreads, rwmutex, RTEST_FAST | RTEST_SYSTEM)
+{
+  RLockBenchCtx ctx;
+  ruint threads;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %u ops, one write per %u\n",
+      R_TIME_ARGS (0), R_STRFUNC, LOCK_BENCH_OPS, LOCK_BENCH_WRITE_EVERY);
+  r_print ("\tthreads     RRWMutex  RFastRWMutex\n");
+
+  for (threads = 1; threads <= LOCK_BENCH_MAX; threads *= 2) {
+    rint64 rw, fast;
+
+    lock_bench_ctx_init (&ctx, FALSE);
+    rw = lock_bench_run (&ctx, lock_bench_rwmutex, threads, LOCK_BENCH_OPS);
+    lock_bench_ctx_clear (&ctx);
+
+    lock_bench_ctx_init (&ctx, TRUE);
+    fast = lock_bench_run (&ctx, lock_bench_rwmutex, threads, LOCK_BENCH_OPS);
+    lock_bench_ctx_clear (&ctx);
+
+    r_print ("\t%7u %12"RINT64_FMT" %13"RINT64_FMT" ops/s\n", threads, rw, fast);
+  }
+}
+RTEST_END;
+
+/* Two threads taking turns, every turn is a wakeup through the cond */
+static rpointer
+lock_bench_pingpong (rpointer data)
+{
+  RLockBenchCtx * ctx = data;
+  ruint64 parity = r_atomic_uint_fetch_add (&ctx->players, 1) & 1;
+
+  if (ctx->fast) {
+    r_fast_mutex_lock (&ctx->fmutex);
+    while (ctx->counter < ctx->perthread * 2) {
+      if ((ctx->counter & 1) == parity) {
+        ctx->counter++;
+        r_fast_cond_signal (&ctx->fcond);
+      } else {
+        r_fast_cond_wait (&ctx->fcond, &ctx->fmutex);
+      }
+    }
+    r_fast_cond_signal (&ctx->fcond);
+    r_fast_mutex_unlock (&ctx->fmutex);
+  } else {
+    r_mutex_lock (&ctx->mutex);
+    while (ctx->counter < ctx->perthread * 2) {
+      if ((ctx->counter & 1) == parity) {
+        ctx->counter++;
+        r_cond_signal (&ctx->cond);
+      } else {
+        r_cond_wait (&ctx->cond, &ctx->mutex);
+      }
+    }
+    r_cond_signal (&ctx->cond);
+    r_mutex_unlock (&ctx->mutex);
+  }
+
+  return NULL;
+}
+
+RTEST_BENCH (rthreads, cond, RTEST_FAST | RTEST_SYSTEM)
+{
+  RLockBenchCtx ctx;
+  rint64 cond, fast;
+
+  r_print ("%"R_TIME_FORMAT" --- %s --- %u round trips\n",
+      R_TIME_ARGS (0), R_STRFUNC, LOCK_BENCH_PINGPONG);
+
+  lock_bench_ctx_init (&ctx, FALSE);
+  cond = lock_bench_run (&ctx, lock_bench_pingpong, 2, LOCK_BENCH_PINGPONG * 2);
+  lock_bench_ctx_clear (&ctx);
+
+  lock_bench_ctx_init (&ctx, TRUE);
+  fast = lock_bench_run (&ctx, lock_bench_pingpong, 2, LOCK_BENCH_PINGPONG * 2);
+  lock_bench_ctx_clear (&ctx);
+
+  r_print ("\tRMutex+RCond: %10"RINT64_FMT"  RFastMutex+RFastCond: %10"RINT64_FMT" turns/s\n",
+      cond, fast);
+}
+RTEST_END;
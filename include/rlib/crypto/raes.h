@@ -29,8 +29,22 @@ R_BEGIN_DECLS
 
 #define R_AES_STR           "AES"
 #define R_AES_BLOCK_BYTES   16
+#define R_AES_GCM_IV_BYTES  12
+#define R_AES_GCM_TAG_BYTES 16
+
+/* Implementation backing a cipher instance, R_AES_IMPL_AUTO picks hardware
+ * acceleration when the CPU supports it and the portable tables otherwise */
+typedef enum {
+  R_AES_IMPL_AUTO = 0,
+  R_AES_IMPL_PORTABLE,
+  R_AES_IMPL_AESNI,
+} RAesImpl;
+
+R_API rboolean r_cipher_aes_impl_available (RAesImpl impl);
+R_API RAesImpl r_cipher_aes_get_impl (const RCryptoCipher * cipher);
 
 R_API RCryptoCipher * r_cipher_aes_new (RCryptoCipherMode mode, ruint bits, const ruint8 * key) R_ATTR_MALLOC;
+R_API RCryptoCipher * r_cipher_aes_new_with_impl (RCryptoCipherMode mode, ruint bits, const ruint8 * key, RAesImpl impl) R_ATTR_MALLOC;
 R_API RCryptoCipher * r_cipher_aes_new_from_hex (RCryptoCipherMode mode, const rchar * hexkey) R_ATTR_MALLOC;
 R_API RCryptoCipher * r_cipher_aes_128_ecb_new (const ruint8 * key) R_ATTR_MALLOC;
 R_API RCryptoCipher * r_cipher_aes_192_ecb_new (const ruint8 * key) R_ATTR_MALLOC;
@@ -41,6 +55,9 @@ R_API RCryptoCipher * r_cipher_aes_256_cbc_new (const ruint8 * key) R_ATTR_MALLO
 R_API RCryptoCipher * r_cipher_aes_128_ctr_new (const ruint8 * key) R_ATTR_MALLOC;
 R_API RCryptoCipher * r_cipher_aes_192_ctr_new (const ruint8 * key) R_ATTR_MALLOC;
 R_API RCryptoCipher * r_cipher_aes_256_ctr_new (const ruint8 * key) R_ATTR_MALLOC;
+R_API RCryptoCipher * r_cipher_aes_128_gcm_new (const ruint8 * key) R_ATTR_MALLOC;
+R_API RCryptoCipher * r_cipher_aes_192_gcm_new (const ruint8 * key) R_ATTR_MALLOC;
+R_API RCryptoCipher * r_cipher_aes_256_gcm_new (const ruint8 * key) R_ATTR_MALLOC;
 
 
 R_API rboolean r_cipher_aes_ecb_encrypt_block (const RCryptoCipher * cipher,
@@ -62,6 +79,20 @@ R_API RCryptoCipherResult r_cipher_aes_ctr_encrypt (const RCryptoCipher * cipher
     ruint8 * dst, rsize size, rconstpointer data, ruint8 * iv, rsize ivsize);
 #define r_cipher_aes_ctr_decrypt r_cipher_aes_ctr_encrypt
 
+/* AES-GCM (NIST SP 800-38D). The tag is truncated to tagsize (4-16) bytes.
+ * Decryption verifies the tag before writing anything to dst and returns
+ * R_CRYPTO_CIPHER_AUTH_FAILED on mismatch. Both may run in place.
+ * r_crypto_cipher_encrypt/decrypt have nowhere to put the tag and return
+ * R_CRYPTO_CIPHER_INVAL for GCM. */
+R_API RCryptoCipherResult r_cipher_aes_gcm_encrypt_full (const RCryptoCipher * cipher,
+    ruint8 * dst, rsize size, rconstpointer data,
+    const ruint8 * iv, rsize ivsize, rconstpointer aad, rsize aadsize,
+    ruint8 * tag, rsize tagsize);
+R_API RCryptoCipherResult r_cipher_aes_gcm_decrypt_full (const RCryptoCipher * cipher,
+    ruint8 * dst, rsize size, rconstpointer data,
+    const ruint8 * iv, rsize ivsize, rconstpointer aad, rsize aadsize,
+    const ruint8 * tag, rsize tagsize);
+
 R_END_DECLS
 
 #endif /* __R_CRYPTO_AES_H__ */
@@ -63,6 +63,7 @@ typedef enum {
   R_CRYPTO_CIPHER_OOM,
   R_CRYPTO_CIPHER_INVAL,
   R_CRYPTO_CIPHER_WRONG_BLOCK_SIZE,
+  R_CRYPTO_CIPHER_AUTH_FAILED,
 } RCryptoCipherResult;
 
 typedef struct _RCryptoCipher RCryptoCipher;
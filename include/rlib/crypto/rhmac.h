@@ -23,6 +23,7 @@
 #endif
 
 #include <rlib/rtypes.h>
+#include <rlib/rmem.h>
 #include <rlib/rmsgdigest.h>
 
 R_BEGIN_DECLS
@@ -39,6 +40,14 @@ R_API rboolean r_hmac_update (RHmac * hmac, rconstpointer data, rsize size);
 R_API rboolean r_hmac_get_data (RHmac * hmac, ruint8 * data, rsize size, rsize * out);
 R_API rchar * r_hmac_get_hex (RHmac * hmac);
 
+/* Reset, update with each chunk of iov and get the result in one go */
+R_API rboolean r_hmac_compute_iov (RHmac * hmac, const RMemChunk * iov, rsize count,
+    ruint8 * data, rsize size, rsize * out);
+/* MAC of each of msgs, count results of r_hmac_size bytes back to back in
+ * data. Batches go through r_msg_digest_compute_multi. */
+R_API rboolean r_hmac_compute_multi (RHmac * hmac, const RMemChunk * msgs, rsize count,
+    ruint8 * data, rsize size);
+
 R_END_DECLS
 
 #endif /* __R_CRYPTO_MAC_H__ */
@@ -0,0 +1,57 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_EPOCH_PTR_H__
+#define __R_EPOCH_PTR_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only pelase."
+#endif
+
+#include <rlib/rtypes.h>
+#include <rlib/ratomic.h>
+
+
+R_BEGIN_DECLS
+
+/* Epoch based reclamation, used just like rhzrptr. Aqcuire and release are
+ * cheaper, as they don't depend on the pointer, but a reader holding on to
+ * a pointer for long stops all retired pointers from being freed. */
+#define R_EPOCH_PTR_INIT(notify) { 0, (RDestroyNotify)notify }
+typedef struct {
+  raptr ptr;
+  RDestroyNotify notify;
+} repochptr;
+typedef struct _REpochPtrRec REpochPtrRec;
+
+/* Access to the epoch pointer should be guarded with aqcuire/release
+ * pattern. Pairs can be nested, for the same or other epoch pointers. */
+R_API rpointer r_epoch_ptr_aqcuire (repochptr * epochptr, REpochPtrRec * rec);
+R_API void     r_epoch_ptr_release (repochptr * epochptr, REpochPtrRec * rec);
+/* Overwriting the pointer should be done with replace, which frees the
+ * previous once no thread can still see it. reclaim returns how many
+ * retired pointers are still waiting for that. */
+R_API void r_epoch_ptr_replace (repochptr * epochptr, rpointer ptr);
+R_API rsize r_epoch_ptr_reclaim (REpochPtrRec * rec);
+
+
+R_API REpochPtrRec * r_epoch_ptr_rec_new (void);
+R_API void r_epoch_ptr_rec_free (REpochPtrRec * rec);
+
+R_END_DECLS
+
+#endif /* __R_EPOCH_PTR_H__ */
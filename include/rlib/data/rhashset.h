@@ -39,6 +39,8 @@ R_API RHashSet * r_hash_set_new_full (RHashFunc hash, REqualFunc equal,
 
 R_API rsize r_hash_set_size (RHashSet * ht);
 R_API rsize r_hash_set_current_alloc_size (RHashSet * ht);
+/* Grows the set so count items fit without rehashing */
+R_API rboolean r_hash_set_reserve (RHashSet * ht, rsize count);
 
 R_API rboolean r_hash_set_insert (RHashSet * ht, rpointer item);
 
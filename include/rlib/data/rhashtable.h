@@ -49,6 +49,8 @@ R_API RHashTable * r_hash_table_new_full (RHashFunc hash, REqualFunc equal,
 
 R_API rsize r_hash_table_size (RHashTable * ht);
 R_API rsize r_hash_table_current_alloc_size (RHashTable * ht);
+/* Grows the table so count entries fit without rehashing */
+R_API RHashTableError r_hash_table_reserve (RHashTable * ht, rsize count);
 
 R_API RHashTableError r_hash_table_insert (RHashTable * ht,
     rpointer key, rpointer value);
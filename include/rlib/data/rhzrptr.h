@@ -28,6 +28,9 @@
 
 R_BEGIN_DECLS
 
+/* Hazard pointers one thread (RHzrPtrRec) can hold at the same time */
+#define R_HZR_PTR_SLOTS   4
+
 #define R_HZR_PTR_INIT(notify) { 0, (RDestroyNotify)notify }
 typedef struct {
   raptr ptr;
@@ -35,15 +38,22 @@ typedef struct {
 } rhzrptr;
 typedef struct _RHzrPtrRec RHzrPtrRec;
 
-/* Access to the hzr pointer should be guarded with aqcuire/release pattern */
+/* Access to the hzr pointer should be guarded with aqcuire/release pattern.
+ * Up to R_HZR_PTR_SLOTS pointers can be held at once, released in any order */
 R_API rpointer r_hzr_ptr_aqcuire (rhzrptr * hzrptr, RHzrPtrRec * rec);
 R_API void     r_hzr_ptr_release (rhzrptr * hzrptr, RHzrPtrRec * rec);
 /* Overwriting the pointer should be done with replace, which will
- * automatically enforce garbage collecition for the previous */
+ * automatically enforce garbage collecition for the previous.
+ * Retired pointers are collected in batches, or by calling reclaim which
+ * returns how many are still held by hazard pointers. */
 R_API void r_hzr_ptr_replace (rhzrptr * hzrptr, rpointer ptr);
+R_API rsize r_hzr_ptr_reclaim (RHzrPtrRec * rec);
 
 
+/* Records are recycled once freed, along with their retired pointers */
 R_API RHzrPtrRec * r_hzr_ptr_rec_new (void);
 R_API void r_hzr_ptr_rec_free (RHzrPtrRec * rec);
 
+R_END_DECLS
+
 #endif /* __R_HZR_PTR_H__ */
@@ -28,11 +28,26 @@
 
 R_BEGIN_DECLS
 
-#define RMPINT_DEF_DIGITS     64
-#define RMPINT_DEF_ISPRIME_T  8
-
+#if RLIB_MPINT_DIGIT_BITS == 64
+#if !defined (__SIZEOF_INT128__)
+#error "64 bit rmpint digits needs unsigned __int128"
+#endif
+#define RMPINT_DIGIT_BITS     64
+typedef ruint64         rmpint_digit;
+__extension__ typedef unsigned __int128 rmpint_word;
+#define RMPINT_DIGIT_CLZ(x)   RUINT64_CLZ (x)
+#define RMPINT_DIGIT_CTZ(x)   RUINT64_CTZ (x)
+#else
+#define RMPINT_DIGIT_BITS     32
 typedef ruint32         rmpint_digit;
 typedef ruint64         rmpint_word;
+#define RMPINT_DIGIT_CLZ(x)   RUINT32_CLZ (x)
+#define RMPINT_DIGIT_CTZ(x)   RUINT32_CTZ (x)
+#endif
+
+#define RMPINT_DEF_DIGITS     (2048 / RMPINT_DIGIT_BITS)
+#define RMPINT_DEF_ISPRIME_T  8
+
 typedef struct {
   ruint16         dig_alloc, dig_used;
   ruint32         sign;
@@ -60,11 +75,11 @@ R_API rchar * r_mpint_to_str (const rmpint * mpi);
 #define r_mpint_digits_used(mpi)  (mpi)->dig_used
 #define r_mpint_bytes_used(mpi)   ((ruint)((mpi)->dig_used > 0 ?              \
     (ruint)(((ruint)(mpi)->dig_used * sizeof (rmpint_digit)) -                \
-    (ruint)RUINT32_CLZ (r_mpint_get_digit (mpi, (mpi)->dig_used - 1)) / 8) :  \
+    (ruint)RMPINT_DIGIT_CLZ (r_mpint_get_digit (mpi, (mpi)->dig_used - 1)) / 8) : \
     ((ruint)0)))
 #define r_mpint_bits_used(mpi)    ((ruint)((mpi)->dig_used > 0 ?              \
     (ruint)(((ruint)(mpi)->dig_used * sizeof (rmpint_digit) * 8) -            \
-    (ruint)RUINT32_CLZ (r_mpint_get_digit (mpi, (mpi)->dig_used - 1))) :      \
+    (ruint)RMPINT_DIGIT_CLZ (r_mpint_get_digit (mpi, (mpi)->dig_used - 1))) : \
     ((ruint)0)))
 #define r_mpint_clamp(mpi)   R_STMT_START {                           \
   while ((mpi)->dig_used > 0 && (mpi)->data[(mpi)->dig_used-1] == 0)  \
@@ -119,6 +134,7 @@ R_API rboolean r_mpint_shr_digit (rmpint * dst, const rmpint * a, ruint16 d);
 R_API rboolean r_mpint_mul (rmpint * dst, const rmpint * a, const rmpint * b);
 R_API rboolean r_mpint_mul_i32 (rmpint * dst, const rmpint * a, rint32 b);
 R_API rboolean r_mpint_mul_u32 (rmpint * dst, const rmpint * a, ruint32 b);
+R_API rboolean r_mpint_sqr (rmpint * dst, const rmpint * a);
 
 R_API rboolean r_mpint_div (rmpint * q, rmpint * r, const rmpint * n, const rmpint * d);
 R_API rboolean r_mpint_div_i32 (rmpint * q, rmpint * r, const rmpint * n, rint32 d);
@@ -133,6 +149,7 @@ R_API rboolean r_mpint_exp (rmpint * dst, const rmpint * b, ruint16 e);
 #define r_mpint_mulmod(dst, a, b, d)      (r_mpint_mul (dst, a, b) && r_mpint_mod (dst, dst, d))
 #define r_mpint_mulmod_i32(dst, a, b, d)  (r_mpint_mul (dst, a, b) && r_mpint_mod_i32 (dst, dst, d))
 #define r_mpint_mulmod_u32(dst, a, b, d)  (r_mpint_mul (dst, a, b) && r_mpint_mod_u32 (dst, dst, d))
+#define r_mpint_sqrmod(dst, a, d)         (r_mpint_sqr (dst, a) && r_mpint_mod (dst, dst, d))
 
 R_API rboolean r_mpint_invmod (rmpint * dst, const rmpint * a, const rmpint * m);
 R_API rboolean r_mpint_expmod (rmpint * dst, const rmpint * b, const rmpint * e, const rmpint * m);
@@ -105,6 +105,41 @@ R_API rsize     r_queue_ring_size (RQueueRing * q);
 R_API rboolean  r_queue_ring_is_empty (RQueueRing * q);
 
 
+/******************************************************************************/
+/* Bounded lock-free queues implemented with a circular ring buffer           */
+/******************************************************************************/
+/* Both round size up to a power of 2 and don't take NULL items, as pop
+ * returns NULL when empty. The _n variants push/pop up to count items and
+ * return how many. size is only a snapshot when used from several threads.
+ * Items left behind when the queue is freed are not touched. */
+
+/* One producer thread and one consumer thread */
+typedef struct _RQueueSPSC RQueueSPSC;
+R_API RQueueSPSC * r_queue_spsc_new (rsize size) R_ATTR_MALLOC;
+#define r_queue_spsc_ref    r_ref_ref
+#define r_queue_spsc_unref  r_ref_unref
+
+R_API rboolean  r_queue_spsc_push (RQueueSPSC * q, rpointer item) R_ATTR_WARN_UNUSED_RESULT;
+R_API rpointer  r_queue_spsc_pop (RQueueSPSC * q);
+R_API rsize     r_queue_spsc_push_n (RQueueSPSC * q, rpointer const * items, rsize count);
+R_API rsize     r_queue_spsc_pop_n (RQueueSPSC * q, rpointer * items, rsize count);
+R_API rsize     r_queue_spsc_size (RQueueSPSC * q);
+R_API rsize     r_queue_spsc_capacity (const RQueueSPSC * q);
+
+/* Any number of producer and consumer threads */
+typedef struct _RQueueMPMC RQueueMPMC;
+R_API RQueueMPMC * r_queue_mpmc_new (rsize size) R_ATTR_MALLOC;
+#define r_queue_mpmc_ref    r_ref_ref
+#define r_queue_mpmc_unref  r_ref_unref
+
+R_API rboolean  r_queue_mpmc_push (RQueueMPMC * q, rpointer item) R_ATTR_WARN_UNUSED_RESULT;
+R_API rpointer  r_queue_mpmc_pop (RQueueMPMC * q);
+R_API rsize     r_queue_mpmc_push_n (RQueueMPMC * q, rpointer const * items, rsize count);
+R_API rsize     r_queue_mpmc_pop_n (RQueueMPMC * q, rpointer * items, rsize count);
+R_API rsize     r_queue_mpmc_size (RQueueMPMC * q);
+R_API rsize     r_queue_mpmc_capacity (const RQueueMPMC * q);
+
+
 
 
 /******************************************************************************/
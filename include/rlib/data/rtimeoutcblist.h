@@ -31,14 +31,21 @@ typedef struct _RToCB RToCB;
 #define r_to_cb_ref r_ref_ref
 #define r_to_cb_unref r_ref_unref
 
+/* Timeouts are kept in a 4-ary min-heap ordered on (ts, insertion order),
+ * each RToCB knows its own heap index so cancel is O(log n).
+ * Released RToCBs are kept in a free list (pool) for reuse by later inserts.
+ */
 typedef struct {
-  RToCB * head;
-  RToCB * tail;
-
+  RToCB ** heap;
   rsize size;
+  rsize alloc;
+
+  ruint64 seq;
+  RToCB * pool;
+  rsize poolsize;
 } RTimeoutCBList;
 
-#define R_TIMEOUT_CBLIST_INIT { NULL, NULL, 0 }
+#define R_TIMEOUT_CBLIST_INIT { NULL, 0, 0, 0, NULL, 0 }
 #define r_timeout_cblist_init(lst) r_memset (lst, 0, sizeof (RTimeoutCBList))
 
 R_API void r_timeout_cblist_clear (RTimeoutCBList * lst);
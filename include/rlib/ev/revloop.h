@@ -38,12 +38,38 @@ typedef enum {
   R_EV_LOOP_RUN_NOWAIT,
 } REvLoopRunMode;
 
+/* Kernel interface used for IO events. POLL, EPOLL and KQUEUE are picked at
+ * compile time, so only one of them is ever supported. IO_URING is probed at
+ * runtime on top of EPOLL. DEFAULT is the native backend, unless overridden
+ * with R_EV_LOOP_BACKEND=io_uring|epoll in the environment. */
+typedef enum {
+  R_EV_LOOP_BACKEND_DEFAULT,
+  R_EV_LOOP_BACKEND_POLL,
+  R_EV_LOOP_BACKEND_EPOLL,
+  R_EV_LOOP_BACKEND_KQUEUE,
+  R_EV_LOOP_BACKEND_IO_URING,
+} REvLoopBackend;
+
+/* Timer lateness is the time from the deadline of a timer until the loop
+ * fires it. Bucket 0 counts timers less than 1us late, bucket n timers less
+ * than 2^n us late and the last bucket all the later ones. */
+#define R_EV_LOOP_LATENESS_BUCKETS    20
+typedef struct {
+  rsize timers;
+  RClockTimeDiff lateness_sum;
+  RClockTimeDiff lateness_max;
+  rsize lateness[R_EV_LOOP_LATENESS_BUCKETS];
+} REvLoopStats;
+
 typedef struct _REvLoop REvLoop;
 typedef void (*REvFunc) (rpointer data, REvLoop * loop);
 typedef rboolean (*REvFuncReturn) (rpointer data, REvLoop * loop);
 
 #define r_ev_loop_new() r_ev_loop_new_full (NULL, NULL)
 R_API REvLoop * r_ev_loop_new_full (RClock * clock, RTaskQueue * tq) R_ATTR_MALLOC;
+R_API REvLoop * r_ev_loop_new_with_backend (RClock * clock, RTaskQueue * tq,
+    REvLoopBackend backend) R_ATTR_MALLOC;
+R_API rboolean r_ev_loop_backend_is_supported (REvLoopBackend backend);
 R_API REvLoop * r_ev_loop_default (void);
 R_API REvLoop * r_ev_loop_current (void);
 #define r_ev_loop_ref r_ref_ref
@@ -54,6 +80,18 @@ R_API void r_ev_loop_stop (REvLoop * loop);
 
 R_API rsize r_ev_loop_get_iterations (const REvLoop * loop);
 R_API rsize r_ev_loop_get_idle_count (const REvLoop * loop);
+R_API REvLoopBackend r_ev_loop_get_backend (const REvLoop * loop);
+/* Syscalls done on behalf of the loop, REvUDP and REvTCP to wait for and do IO */
+R_API rsize r_ev_loop_get_syscalls (const REvLoop * loop);
+/* Not thread safe, call from the thread running loop or while it is idle */
+R_API void r_ev_loop_get_stats (const REvLoop * loop, REvLoopStats * stats);
+R_API void r_ev_loop_reset_stats (REvLoop * loop);
+
+/* Wait for timers with the precision of the clock instead of whole
+ * milliseconds. Only EPOLL needs it, using epoll_pwait2, the other backends
+ * are always precise. FALSE if not supported by the kernel. */
+R_API rboolean r_ev_loop_set_high_res_timers (REvLoop * loop, rboolean enable);
+R_API rboolean r_ev_loop_get_high_res_timers (const REvLoop * loop);
 
 R_API ruint r_ev_loop_task_group_count (REvLoop * loop);
 
@@ -70,6 +108,13 @@ R_API rboolean r_ev_loop_add_callback_later (REvLoop * loop, RClockEntry ** entr
     RClockTimeDiff delay, REvFunc cb, rpointer data, RDestroyNotify datanotify);
 R_API rboolean r_ev_loop_cancel_timer (REvLoop * loop, RClockEntry * entry);
 
+/* Call func on the thread running loop. Lock-free and safe to call from any
+ * thread, as long as the caller holds a reference to loop. Wakeups are
+ * coalesced, so a burst of invokes costs the loop a single wakeup. */
+#define r_ev_loop_invoke(loop, func, data) r_ev_loop_invoke_full (loop, func, data, NULL)
+R_API rboolean r_ev_loop_invoke_full (REvLoop * loop, REvFunc func,
+    rpointer data, RDestroyNotify datanotify);
+
 #define r_ev_loop_add_task(loop, task, done, data, datanotify)                \
   r_ev_loop_add_task_full (loop, RUINT_MAX, task, done, data, datanotify, NULL)
 #define r_ev_loop_add_task_with_taskgroup(loop, group, task, done, data, datanotify)  \
@@ -0,0 +1,94 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_EV_LOOP_GROUP_H__
+#define __R_EV_LOOP_GROUP_H__
+
+#if !defined(__RLIB_H_INCLUDE_GUARD__) && !defined(RLIB_COMPILATION)
+#error "#include <rlib.h> only pelase."
+#endif
+
+#include <rlib/rtypes.h>
+
+#include <rlib/ev/revloop.h>
+#include <rlib/ev/revtcp.h>
+#include <rlib/ev/revudp.h>
+#include <rlib/data/rbitset.h>
+#include <rlib/rsocketaddress.h>
+#include <rlib/rref.h>
+
+R_BEGIN_DECLS
+
+/* A set of REvLoops, each run by its own thread, optionally pinned to one
+ * CPU each. The loops share one RTaskQueue, but nothing else, so a
+ * connection or datagram is handled start to end on the loop it arrived on.
+ * Endpoints bound with r_ev_loop_group_bind_* share a port through
+ * SO_REUSEPORT, and the kernel spreads the traffic over the loops. */
+typedef struct _REvLoopGroup REvLoopGroup;
+
+typedef enum {
+  R_EV_LOOP_GROUP_BIND_NONE         = 0,
+  /* SO_INCOMING_CPU, prefer the loop pinned to the receiving CPU */
+  R_EV_LOOP_GROUP_BIND_INCOMING_CPU = (1 << 0),
+  /* Classic BPF program selecting the loop pinned to the receiving CPU */
+  R_EV_LOOP_GROUP_BIND_CPU_STEERING = (1 << 1),
+} REvLoopGroupBindFlag;
+typedef ruint32 REvLoopGroupBindFlags;
+
+/* Called on the thread of loop, once per loop and in loop order */
+typedef void (*REvLoopGroupTCPFunc) (rpointer data, REvTCP * evtcp, REvLoop * loop);
+typedef void (*REvLoopGroupUDPFunc) (rpointer data, REvUDP * evudp, REvLoop * loop);
+
+R_API REvLoopGroup * r_ev_loop_group_new (ruint count) R_ATTR_MALLOC;
+/* One loop per CPU in cpuset, or per allowed CPU if cpuset is NULL */
+R_API REvLoopGroup * r_ev_loop_group_new_on_cpus (const RBitset * cpuset) R_ATTR_MALLOC;
+#define r_ev_loop_group_ref r_ref_ref
+#define r_ev_loop_group_unref r_ref_unref
+
+R_API ruint r_ev_loop_group_size (const REvLoopGroup * group);
+R_API REvLoop * r_ev_loop_group_get_loop (const REvLoopGroup * group, ruint idx);
+/* RSIZE_MAX if the group is not pinned */
+R_API rsize r_ev_loop_group_get_cpu (const REvLoopGroup * group, ruint idx);
+
+/* The loops keep running without sources until stopped. Stopping closes the
+ * endpoints bound through the group and is final, as for r_ev_loop_stop. */
+R_API rboolean r_ev_loop_group_start (REvLoopGroup * group);
+R_API void r_ev_loop_group_stop (REvLoopGroup * group);
+R_API rboolean r_ev_loop_group_is_running (const REvLoopGroup * group);
+
+/* Call func on every loop, in order, and wait for it to return. Before the
+ * group is started func is called on the calling thread. Must not be called
+ * from one of the loops of group. */
+R_API rboolean r_ev_loop_group_foreach (REvLoopGroup * group,
+    REvFunc func, rpointer data);
+
+/* Create and bind one endpoint per loop to addr with SO_REUSEPORT and hand
+ * each to func. The group keeps a reference to the endpoints until it is
+ * freed. When the port of addr is 0, the port picked for the first loop is
+ * used for the rest. TCP endpoints should be put to listen from func, as
+ * the kernel numbers the sockets in the group in the order they listen. */
+R_API rboolean r_ev_loop_group_bind_tcp (REvLoopGroup * group,
+    const RSocketAddress * addr, REvLoopGroupBindFlags flags,
+    REvLoopGroupTCPFunc func, rpointer data);
+R_API rboolean r_ev_loop_group_bind_udp (REvLoopGroup * group,
+    const RSocketAddress * addr, REvLoopGroupBindFlags flags,
+    REvLoopGroupUDPFunc func, rpointer data);
+
+R_END_DECLS
+
+#endif /* __R_EV_LOOP_GROUP_H__ */
+
@@ -47,6 +47,8 @@ R_API rboolean r_ev_tcp_close (REvTCP * evtcp, REvIOFunc close_cb,
 
 R_API RSocketAddress * r_ev_tcp_get_local_address (const REvTCP * evtcp);
 R_API RSocketAddress * r_ev_tcp_get_remote_address (const REvTCP * evtcp);
+/* Borrowed, for setting socket options */
+R_API RSocket * r_ev_tcp_get_socket (const REvTCP * evtcp);
 
 R_API RSocketStatus r_ev_tcp_bind (REvTCP * evtcp,
     const RSocketAddress * address, rboolean reuse);
@@ -56,6 +58,9 @@ R_API RSocketStatus r_ev_tcp_connect (REvTCP * evtcp, const RSocketAddress * add
 R_API RSocketStatus r_ev_tcp_listen (REvTCP * evtcp, ruint8 backlog,
     REvTCPConnectionReadyFunc connection, rpointer data, RDestroyNotify datanotify);
 
+/* Make the default allocator (alloc == NULL) take buffers from pool.
+ * Must be set before starting to receive. Accepted connections inherit it. */
+R_API void r_ev_tcp_set_buffer_pool (REvTCP * evtcp, RBufferPool * pool);
 R_API rboolean r_ev_tcp_recv_start (REvTCP * evtcp,
     REvTCPBufferAllocFunc alloc, REvTCPBufferFunc recv,
     rpointer data, RDestroyNotify datanotify);
@@ -27,6 +27,7 @@
 #include <rlib/ev/revloop.h>
 #include <rlib/rbuffer.h>
 #include <rlib/rsocketaddress.h>
+#include <rlib/rsocket.h>
 #include <rlib/rref.h>
 
 R_BEGIN_DECLS
@@ -34,13 +35,22 @@ R_BEGIN_DECLS
 typedef struct _REvUDP REvUDP;
 typedef RBuffer * (*REvUDPBufferAllocFunc) (rpointer data, REvUDP * evudp);
 typedef void (*REvUDPBufferFunc) (rpointer data, RBuffer * buf, RSocketAddress * addr, REvUDP * evudp);
+/* Batched receive: bufs[i] was received from addrs[i], refs are only valid
+ * for the duration of the callback (ref to keep). */
+typedef void (*REvUDPBufferBatchFunc) (rpointer data, RBuffer ** bufs, RSocketAddress ** addrs, ruint count, REvUDP * evudp);
 
 R_API REvUDP * r_ev_udp_new (RSocketFamily family, REvLoop * loop);
 #define r_ev_udp_ref r_ref_ref
 #define r_ev_udp_unref r_ref_unref
 
+/* Borrowed, for setting socket options */
+R_API RSocket * r_ev_udp_get_socket (const REvUDP * evudp);
+
 R_API rboolean r_ev_udp_bind (REvUDP * evudp,
     const RSocketAddress * address, rboolean reuse);
+/* Make the default allocator (alloc == NULL) take buffers from pool.
+ * Must be set before starting to receive. */
+R_API void r_ev_udp_set_buffer_pool (REvUDP * evudp, RBufferPool * pool);
 R_API rboolean r_ev_udp_recv_start (REvUDP * evudp,
     REvUDPBufferAllocFunc alloc, REvUDPBufferFunc recv,
     rpointer data, RDestroyNotify datanotify);
@@ -48,6 +58,13 @@ R_API rboolean r_ev_udp_recv_start (REvUDP * evudp,
 R_API rboolean r_ev_udp_task_recv_start (REvUDP * evudp, ruint taskgroup,
     REvUDPBufferAllocFunc alloc, REvUDPBufferFunc recv,
     rpointer data, RDestroyNotify datanotify);
+/* Receive up to batch datagrams per syscall (recvmmsg where supported) */
+R_API rboolean r_ev_udp_recv_batch_start (REvUDP * evudp, ruint batch,
+    REvUDPBufferAllocFunc alloc, REvUDPBufferBatchFunc recv,
+    rpointer data, RDestroyNotify datanotify);
+R_API rboolean r_ev_udp_task_recv_batch_start (REvUDP * evudp, ruint taskgroup,
+    ruint batch, REvUDPBufferAllocFunc alloc, REvUDPBufferBatchFunc recv,
+    rpointer data, RDestroyNotify datanotify);
 R_API rboolean r_ev_udp_recv_stop (REvUDP * evudp);
 R_API rboolean r_ev_udp_send (REvUDP * evudp, RBuffer * buf,
     RSocketAddress * address, REvUDPBufferFunc done,
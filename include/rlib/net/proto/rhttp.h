@@ -167,6 +167,33 @@ R_API RUri * r_http_request_get_uri (RHttpRequest * req);
 #define r_http_request_set_body_buffer(req, buf) r_http_msg_set_body_buffer ((RHttpMsg *)req, buf)
 R_API RHttpBodyParseType r_http_request_get_body_parse_type (RHttpRequest * req);
 R_API rssize r_http_request_calc_body_size (RHttpRequest * req, RHttpBodyParseType * type);
+R_API rboolean r_http_request_is_persistent (RHttpRequest * req);
+
+
+/* Resumable request parser. Push data as it arrives and pull events with
+ * r_http_request_parser_next() until it returns R_HTTP_PARSE_NEED_DATA.
+ * Data is only scanned once and requests/bodies are views of the pushed
+ * buffers, so nothing is copied. Any number of pipelined requests may be
+ * pushed at once, each of them is reported as a R_HTTP_PARSE_REQUEST event,
+ * zero or more R_HTTP_PARSE_BODY events (one for each piece of body data,
+ * chunked encoding removed) and finally a R_HTTP_PARSE_END event. */
+typedef enum {
+  R_HTTP_PARSE_NEED_DATA = 0,
+  R_HTTP_PARSE_REQUEST,
+  R_HTTP_PARSE_BODY,
+  R_HTTP_PARSE_END,
+  R_HTTP_PARSE_ERROR,
+} RHttpParseEvent;
+
+#define R_HTTP_REQUEST_PARSER_MAX_HDR_SIZE    (64 * 1024)
+typedef struct _RHttpRequestParser RHttpRequestParser;
+
+R_API RHttpRequestParser * r_http_request_parser_new (void) R_ATTR_MALLOC;
+R_API void r_http_request_parser_free (RHttpRequestParser * parser);
+R_API rboolean r_http_request_parser_push (RHttpRequestParser * parser, RBuffer * buf);
+R_API RHttpParseEvent r_http_request_parser_next (RHttpRequestParser * parser,
+    RHttpRequest ** req, RBuffer ** body, RHttpError * err);
+R_API rsize r_http_request_parser_get_buffered (const RHttpRequestParser * parser);
 
 
 typedef struct _RHttpResponse RHttpResponse;
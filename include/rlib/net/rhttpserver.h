@@ -27,6 +27,7 @@
 
 #include <rlib/net/proto/rhttp.h>
 #include <rlib/ev/revloop.h>
+#include <rlib/ev/revtcp.h>
 
 #include <rlib/rsocketaddress.h>
 
@@ -38,6 +39,10 @@ typedef RHttpResponse * (*RHttpRequestHandler) (rpointer data,
 typedef void (*RHttpResponseReady) (rpointer data,
     RHttpResponse * res, RHttpServer * server);
 typedef void (*RHttpServerStop) (rpointer data, RHttpServer * server);
+/* Called with each piece of request body as it is received, and with
+ * buf == NULL once the body is complete (right before the request handler). */
+typedef void (*RHttpRequestBodyFunc) (rpointer data,
+    RHttpRequest * req, RBuffer * buf, RHttpServer * server);
 
 R_API RHttpServer * r_http_server_new (REvLoop * loop);
 #define r_http_server_ref    r_ref_ref
@@ -46,8 +51,16 @@ R_API RHttpServer * r_http_server_new (REvLoop * loop);
 R_API rboolean r_http_server_set_handler (RHttpServer * server,
   const rchar * pattern, rssize size, RHttpRequestHandler handler,
   rpointer data, RDestroyNotify notify);
+/* Streams request bodies for pattern to func instead of collecting them
+ * into the request passed to the request handler. */
+R_API rboolean r_http_server_set_body_handler (RHttpServer * server,
+  const rchar * pattern, rssize size, RHttpRequestBodyFunc func,
+  rpointer data, RDestroyNotify notify);
 
 R_API rboolean r_http_server_listen (RHttpServer * server, RSocketAddress * addr);
+/* Listen on an already bound tcp, which must belong to the loop of server.
+ * Used with REvLoopGroup to serve one SO_REUSEPORT group from every loop. */
+R_API rboolean r_http_server_listen_tcp (RHttpServer * server, REvTCP * tcp);
 R_API rsize r_http_server_stop (RHttpServer * server, RHttpServerStop func,
     rpointer data, RDestroyNotify notify);
 
@@ -49,6 +49,7 @@ typedef enum {
   R_SRTP_ERROR_REPLAY_TOO_OLD,
   R_SRTP_ERROR_AUTH,
   R_SRTP_ERROR_E_BIT_MISMATCH,
+  R_SRTP_ERROR_NOT_WRITABLE,
 } RSRTPError;
 
 typedef struct _RSRTPCtx RSRTPCtx;
@@ -61,9 +62,27 @@ R_API RSRTPError r_srtp_add_crypto_context_for_ssrc (RSRTPCtx * ctx,
     ruint32 ssrc, RSRTPCipherSuite cs, const ruint8 * key);
 R_API RSRTPError r_srtp_add_crypto_context_with_filter (RSRTPCtx * ctx,
     ruint32 filter, RSRTPCipherSuite cs, const ruint8 * key);
+/* key is the session key and session salt, used as is for both RTP and
+ * RTCP without key derivation. Only for the AEAD profiles, as used by the
+ * RFC 7714 test vectors. */
+R_API RSRTPError r_srtp_add_session_key_for_ssrc (RSRTPCtx * ctx,
+    ruint32 ssrc, RSRTPCipherSuite cs, const ruint8 * key);
 
 R_API RBuffer * r_srtp_encrypt_rtp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * err) R_ATTR_WARN_UNUSED_RESULT;
 R_API RBuffer * r_srtp_decrypt_rtp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * err) R_ATTR_WARN_UNUSED_RESULT;
+/* In-place variants transform the packet within its existing memory, which
+ * must be a single writable RMem. Encrypting needs tailroom for MKI and auth
+ * tag. R_SRTP_ERROR_NOT_WRITABLE is returned, without touching any stream
+ * state, when this is not the case. */
+R_API RSRTPError r_srtp_encrypt_rtp_inplace (RSRTPCtx * ctx, RBuffer * packet);
+R_API RSRTPError r_srtp_decrypt_rtp_inplace (RSRTPCtx * ctx, RBuffer * packet);
+/* In-place processing of count packets, looking up the stream once per run
+ * of equal SSRCs. Per packet result is stored in errs (if not NULL).
+ * Returns the number of packets successfully processed. */
+R_API ruint r_srtp_encrypt_rtp_batch (RSRTPCtx * ctx, RBuffer ** packets,
+    ruint count, RSRTPError * errs);
+R_API ruint r_srtp_decrypt_rtp_batch (RSRTPCtx * ctx, RBuffer ** packets,
+    ruint count, RSRTPError * errs);
 R_API RBuffer * r_srtp_encrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * err) R_ATTR_WARN_UNUSED_RESULT;
 R_API RBuffer * r_srtp_decrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * err) R_ATTR_WARN_UNUSED_RESULT;
 
@@ -23,6 +23,11 @@
 #endif
 
 #include <rlib/rtypes.h>
+#include <rlib/rbuffer.h>
+
+/* Output room needed for size bytes of input, without line breaks */
+#define R_BASE64_ENCODED_SIZE(size)   ((((size) + 2) / 3) * 4)
+#define R_BASE64_DECODED_SIZE(size)   ((((size) + 3) / 4) * 3)
 
 R_BEGIN_DECLS
 
@@ -35,6 +40,52 @@ R_API rchar * r_base64_encode_dup (rconstpointer data, rsize size, rsize * outsi
 R_API rchar * r_base64_encode_dup_full (rconstpointer data, rsize size, rsize linesize, rsize * outsize) R_ATTR_MALLOC;
 R_API ruint8 * r_base64_decode_dup (const rchar * data, rssize size, rsize * outsize) R_ATTR_MALLOC;
 
+typedef enum {
+  R_BASE64_IMPL_AUTO = 0,
+  R_BASE64_IMPL_SCALAR,
+  /* pshufb based, 12 bytes to 16 chars per step */
+  R_BASE64_IMPL_SSE41,
+  /* pshufb based, 24 bytes to 32 chars per step */
+  R_BASE64_IMPL_AVX2,
+} RBase64Impl;
+
+R_API rboolean r_base64_impl_available (RBase64Impl impl);
+/* Unavailable impl falls back to R_BASE64_IMPL_AUTO */
+R_API rsize r_base64_encode_with_impl (RBase64Impl impl, rchar * dst, rsize dsize, rconstpointer src, rsize size);
+R_API rsize r_base64_decode_with_impl (RBase64Impl impl, ruint8 * dst, rsize dsize, const rchar * src, rssize size);
+
+/* Incremental encoding, the input can be split anywhere. update needs
+ * R_BASE64_ENCODED_SIZE (size) of room in dst and finish 4, both return
+ * the number of chars written. */
+#define R_BASE64_ENCODER_INIT     { { 0, 0, 0 }, 0 }
+typedef struct {
+  ruint8 pending[3];
+  ruint8 npending;
+} RBase64Encoder;
+
+R_API void r_base64_encoder_init (RBase64Encoder * enc);
+R_API rsize r_base64_encoder_update (RBase64Encoder * enc, rchar * dst, rsize dsize, rconstpointer src, rsize size);
+R_API rsize r_base64_encoder_finish (RBase64Encoder * enc, rchar * dst, rsize dsize);
+
+/* Incremental decoding with the same rules as r_base64_decode, white
+ * space is skipped and '=' or an invalid char ends the input. update
+ * needs R_BASE64_DECODED_SIZE (size) of room in dst and finish 2, both
+ * return the number of bytes written. */
+#define R_BASE64_DECODER_INIT     { { 0, 0, 0, 0 }, 0, FALSE }
+typedef struct {
+  ruint8 quad[4];
+  ruint8 nquad;
+  rboolean done;
+} RBase64Decoder;
+
+R_API void r_base64_decoder_init (RBase64Decoder * dec);
+R_API rsize r_base64_decoder_update (RBase64Decoder * dec, ruint8 * dst, rsize dsize, const rchar * src, rsize size);
+R_API rsize r_base64_decoder_finish (RBase64Decoder * dec, ruint8 * dst, rsize dsize);
+
+/* Every RMem of buffer in turn, without merging them first */
+R_API rchar * r_base64_encode_buffer_dup (RBuffer * buffer, rsize * outsize) R_ATTR_MALLOC;
+R_API ruint8 * r_base64_decode_buffer_dup (RBuffer * buffer, rsize * outsize) R_ATTR_MALLOC;
+
 R_END_DECLS
 
 #endif /* __R_BASE64_H__ */
@@ -103,6 +103,18 @@ R_API int   r_buffer_cmp (RBuffer * buf1, rsize offset1, RBuffer * buf2, rsize o
 R_API int   r_buffer_memcmp (RBuffer * buffer, rsize offset, rconstpointer mem, rsize size);
 R_API rsize r_buffer_memset (RBuffer * buffer, rsize offset, ruint8 val, rsize size);
 
+/* RBufferPool recycles single RMem buffers of allocsize bytes. A buffer
+ * acquired from the pool goes back to it (up to max buffers) when the last
+ * reference is dropped, as long as it still has its original RMem only. */
+typedef struct _RBufferPool RBufferPool;
+#define r_buffer_pool_ref    r_ref_ref
+#define r_buffer_pool_unref  r_ref_unref
+
+R_API RBufferPool * r_buffer_pool_new (RMemAllocator * allocator, rsize allocsize,
+    const RMemAllocationParams * params, ruint max) R_ATTR_WARN_UNUSED_RESULT;
+R_API RBuffer * r_buffer_pool_acquire (RBufferPool * pool) R_ATTR_WARN_UNUSED_RESULT;
+R_API rsize r_buffer_pool_get_allocsize (const RBufferPool * pool);
+
 R_END_DECLS
 
 #endif /* __R_BUFFER_H__ */
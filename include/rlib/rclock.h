@@ -29,8 +29,10 @@
 /* Simple abstraction for a monotonic clock
  *
  * System clock
- *  - singleton
+ *  - singleton, or a private instance from r_system_clock_new ()
  *  - uses r_time_get_ts_monotonic ()
+ *  - timers are not thread safe, so every thread adding timers
+ *    (i.e. every REvLoop) needs its own instance
  *
  * Test clock
  *  - for use in tests where time must be updated manually.
@@ -50,6 +52,7 @@ typedef struct _RClockEntry RClockEntry;
 
 
 R_API RClock * r_system_clock_get (void);
+R_API RClock * r_system_clock_new (void) R_ATTR_MALLOC;
 R_API RClock * r_test_clock_new (rboolean update_on_wait) R_ATTR_MALLOC;
 
 R_API RClockTime r_clock_get_time (const RClock * clock);
@@ -67,6 +70,8 @@ R_API rboolean r_clock_is_synthetic (const RClock * clock);
 /* These functions are used by threads/sources that wait for time */
 R_API RClockTime r_clock_first_timeout (RClock * clock);
 R_API ruint r_clock_process_entries (RClock * clock, RClockTime * out);
+/* Process the entries due at ts or earlier, without reading the clock */
+R_API ruint r_clock_process_entries_until (RClock * clock, RClockTime ts);
 
 /* RTestClock spesific */
 R_API rboolean r_test_clock_update_time (RClock * clock, RClockTime ts);
@@ -36,6 +36,29 @@ R_API ruint32 r_crc32_update (ruint32 crc, rconstpointer buffer, rsize size);
 R_API ruint32 r_crc32c_update (ruint32 crc, rconstpointer buffer, rsize size);
 R_API ruint32 r_crc32bzip2_update (ruint32 crc, rconstpointer buffer, rsize size);
 
+typedef enum {
+  R_CRC_IMPL_AUTO = 0,
+  /* One table lookup per byte */
+  R_CRC_IMPL_BYTEWISE,
+  R_CRC_IMPL_SLICE8,
+  R_CRC_IMPL_SLICE16,
+  /* CRC32C with the SSE4.2 crc32 instruction */
+  R_CRC_IMPL_SSE42,
+  /* CRC32 and CRC32C folded 64 bytes at a time with PCLMULQDQ */
+  R_CRC_IMPL_PCLMUL,
+} RCrcImpl;
+
+R_API rboolean r_crc32_impl_available (RCrcImpl impl);
+R_API rboolean r_crc32c_impl_available (RCrcImpl impl);
+/* Unavailable impl falls back to R_CRC_IMPL_AUTO */
+R_API ruint32 r_crc32_update_with_impl (RCrcImpl impl, ruint32 crc, rconstpointer buffer, rsize size);
+R_API ruint32 r_crc32c_update_with_impl (RCrcImpl impl, ruint32 crc, rconstpointer buffer, rsize size);
+
+/* CRC of A followed by B out of the CRCs of A and B and the size of B,
+ * so pieces of a buffer can be checksummed independently */
+R_API ruint32 r_crc32_combine (ruint32 crc1, ruint32 crc2, rsize size2);
+R_API ruint32 r_crc32c_combine (ruint32 crc1, ruint32 crc2, rsize size2);
+
 R_END_DECLS
 
 #endif /* __R_CRC_H__ */
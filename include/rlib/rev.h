@@ -21,6 +21,7 @@
 #include <rlib/rlib.h>
 
 #include <rlib/ev/revloop.h>
+#include <rlib/ev/revloopgroup.h>
 #include <rlib/ev/revresolve.h>
 #include <rlib/ev/revtcp.h>
 #include <rlib/ev/revudp.h>
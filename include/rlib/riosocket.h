@@ -76,10 +76,18 @@ R_API RSocketStatus r_io_get_socket_acceptconn (RIOHandle handle, rboolean * lis
 R_API RSocketStatus r_io_get_socket_broadcast (RIOHandle handle, rboolean * broadcast);
 R_API RSocketStatus r_io_get_socket_keepalive (RIOHandle handle, rboolean * keepalive);
 R_API RSocketStatus r_io_get_socket_reuseaddr (RIOHandle handle, rboolean * reuse);
+R_API RSocketStatus r_io_get_socket_reuseport (RIOHandle handle, rboolean * reuse);
 
 R_API RSocketStatus r_io_set_socket_broadcast (RIOHandle handle, rboolean broadcast);
 R_API RSocketStatus r_io_set_socket_keepalive (RIOHandle handle, rboolean keepalive);
 R_API RSocketStatus r_io_set_socket_reuseaddr (RIOHandle handle, rboolean reuse);
+R_API RSocketStatus r_io_set_socket_reuseport (RIOHandle handle, rboolean reuse);
+/* Prefer this socket in its SO_REUSEPORT group for traffic received on cpu */
+R_API RSocketStatus r_io_set_socket_incoming_cpu (RIOHandle handle, int cpu);
+/* Attach a BPF program to the SO_REUSEPORT group of handle, selecting the
+ * socket bound as number i in the group for traffic received on cpus[i] */
+R_API RSocketStatus r_io_set_socket_reuseport_cpus (RIOHandle handle,
+    const ruint * cpus, ruint count);
 
 /* Operations */
 R_API RSocketStatus r_io_socket_close (RIOHandle handle);
@@ -97,6 +105,12 @@ R_API RSocketStatus r_io_socket_receive_message (RIOHandle handle, RSocketAddres
 R_API RSocketStatus r_io_socket_send (RIOHandle handle, rconstpointer buffer, rsize size, rsize * sent);
 R_API RSocketStatus r_io_socket_send_to (RIOHandle handle, const RSocketAddress * address, rconstpointer buffer, rsize size, rsize * sent);
 R_API RSocketStatus r_io_socket_send_message (RIOHandle handle, const RSocketAddress * address, RBuffer * buf, rsize * sent);
+/* Batched variants (recvmmsg/sendmmsg where available), handles at most
+ * R_SOCKET_MAX_MESSAGES per call. Returns R_SOCKET_OK if at least one message
+ * was processed, *msgs is the number of messages actually received/sent. */
+#define R_SOCKET_MAX_MESSAGES     128
+R_API RSocketStatus r_io_socket_receive_messages (RIOHandle handle, RSocketAddress ** addresses, RBuffer ** bufs, rsize * received, ruint count, ruint * msgs);
+R_API RSocketStatus r_io_socket_send_messages (RIOHandle handle, RSocketAddress * const * addresses, RBuffer ** bufs, rsize * sent, ruint count, ruint * msgs);
 
 /* IP spesific */
 R_API RSocketStatus r_io_get_socket_ipv4_multicast_loop (RIOHandle handle, rboolean * mloop);
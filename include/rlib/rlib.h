@@ -66,6 +66,7 @@
 #include <rlib/data/rbitset.h>
 #include <rlib/data/rdictionary.h>
 #include <rlib/data/rdirtree.h>
+#include <rlib/data/repochptr.h>
 #include <rlib/data/rhashfuncs.h>
 #include <rlib/data/rhashset.h>
 #include <rlib/data/rhashtable.h>
@@ -152,6 +152,33 @@ R_API void r_log_default_handler (RLogCategory * cat, RLogLevel lvl,
 R_API RLogFunc r_log_override_default_handler (RLogFunc func, rpointer data,
     rpointer * old);
 
+/* RLogAsync formats log lines on the calling thread and hands them to a
+ * dedicated writer thread through per-thread lock-free ring buffers, which
+ * are drained with batched writev(). Use r_log_async_handler() with the
+ * RLogAsync as data in r_log_override_default_handler(), or set R_DEBUG_ASYNC
+ * to "drop" or "block" in the environment to make it the default at startup.
+ *
+ * Restore the previous handler and make sure no thread is logging through it
+ * before calling r_log_async_free().
+ */
+typedef enum {
+  R_LOG_ASYNC_DROP  = 0,    /* Drop (and count) messages when ring is full */
+  R_LOG_ASYNC_BLOCK,        /* Wait for the writer thread to make room */
+} RLogAsyncPolicy;
+
+#define R_LOG_ASYNC_RING_SIZE_DEFAULT   (64 * 1024)
+
+typedef struct _RLogAsync RLogAsync;
+
+R_API RLogAsync * r_log_async_new (RIOHandle handle, rsize ringsize,
+    RLogAsyncPolicy policy) R_ATTR_WARN_UNUSED_RESULT;
+R_API void r_log_async_free (RLogAsync * async);
+R_API void r_log_async_flush (RLogAsync * async);
+R_API ruint r_log_async_get_dropped (RLogAsync * async);
+R_API void r_log_async_handler (RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * msg, rpointer user_data);
+
 /* RLogKeepLast API uses r_log_override_default_handler() so be careful with
  * what you do between begin() and end().
  *
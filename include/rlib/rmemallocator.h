@@ -153,6 +153,14 @@ r_mem_allocator_alloc (RMemAllocator * allocator, RMemFlags flags, rsize size,
   return r_mem_allocator_alloc_full (allocator, size, &params);
 }
 
+/* Pool allocator, recycling fixed size slabs of slabsize bytes through
+ * per-thread free lists (holding at most maxcached slabs each) backed by a
+ * shared depot. Requests not fitting a slab are served by plain heap memory.
+ * Register it with r_mem_allocator_register() to make it findable by name. */
+R_API RMemAllocator * r_mem_allocator_pool_new (const rchar * name,
+    rsize slabsize, ruint maxcached) R_ATTR_WARN_UNUSED_RESULT;
+R_API rsize r_mem_allocator_pool_slab_size (const RMemAllocator * allocator);
+
 struct _RMemAllocator {
   RRef            ref;
   const rchar *   mem_type;
@@ -23,6 +23,7 @@
 #endif
 
 #include <rlib/rtypes.h>
+#include <rlib/rmem.h>
 
 R_BEGIN_DECLS
 
@@ -48,6 +49,24 @@ typedef struct _RMsgDigest RMsgDigest;
 
 R_API RMsgDigest * r_msg_digest_new (RMsgDigestType type);
 R_API void r_msg_digest_free (RMsgDigest * md);
+/* Snapshot of the running state, r_msg_digest_copy restores it into a
+ * digest of the same type */
+R_API RMsgDigest * r_msg_digest_clone (const RMsgDigest * md) R_ATTR_MALLOC;
+R_API rboolean r_msg_digest_copy (RMsgDigest * dst, const RMsgDigest * src);
+
+typedef enum {
+  R_MSG_DIGEST_IMPL_AUTO = 0,
+  R_MSG_DIGEST_IMPL_PORTABLE,
+  /* SHA-1 and SHA-224/256 with the x86 SHA extensions */
+  R_MSG_DIGEST_IMPL_SHANI,
+  /* Portable, but r_msg_digest_compute_multi hashes 8 messages at a time */
+  R_MSG_DIGEST_IMPL_AVX2,
+} RMsgDigestImpl;
+
+R_API rboolean r_msg_digest_impl_available (RMsgDigestImpl impl);
+R_API RMsgDigestImpl r_msg_digest_get_impl (const RMsgDigest * md);
+/* NULL if impl isn't available or doesn't apply to type */
+R_API RMsgDigest * r_msg_digest_new_with_impl (RMsgDigestType type, RMsgDigestImpl impl);
 
 R_API RMsgDigest * r_msg_digest_new_md2 (void);
 R_API RMsgDigest * r_msg_digest_new_md4 (void);
@@ -78,6 +97,12 @@ R_API rchar * r_msg_digest_get_hex (const RMsgDigest * md);
 R_API rchar * r_msg_digest_get_hex_full (const RMsgDigest * md,
     const rchar * divider, rsize interval);
 
+/* Hash each of msgs, starting from the state of init which is left as is,
+ * so init can be a fresh digest or a keyed midstate. out gets count
+ * digests of r_msg_digest_size bytes each, back to back. */
+R_API rboolean r_msg_digest_compute_multi (const RMsgDigest * init,
+    const RMemChunk * msgs, rsize count, ruint8 * out, rsize size);
+
 R_END_DECLS
 
 #endif /* __R_MSG_DIGEST_H__ */
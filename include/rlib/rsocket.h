@@ -79,6 +79,7 @@ R_API RSocketStatus r_socket_get_error (RSocket * socket);
 R_API rboolean r_socket_get_blocking (RSocket * socket);
 R_API rboolean r_socket_get_broadcast (RSocket * socket);
 R_API rboolean r_socket_get_keepalive (RSocket * socket);
+R_API rboolean r_socket_get_reuseport (RSocket * socket);
 R_API rboolean r_socket_get_multicast_loop (RSocket * socket);
 R_API ruint r_socket_get_multicast_ttl (RSocket * socket);
 R_API ruint r_socket_get_ttl (RSocket * socket);
@@ -87,6 +88,11 @@ R_API rboolean r_socket_set_option (RSocket * socket, int level, int optname, in
 R_API rboolean r_socket_set_blocking (RSocket * socket, rboolean blocking);
 R_API rboolean r_socket_set_broadcast (RSocket * socket, rboolean broadcast);
 R_API rboolean r_socket_set_keepalive (RSocket * socket, rboolean keepalive);
+/* SO_REUSEPORT, must be set on every socket in the group before binding */
+R_API rboolean r_socket_set_reuseport (RSocket * socket, rboolean reuse);
+R_API rboolean r_socket_set_incoming_cpu (RSocket * socket, int cpu);
+/* Steer traffic received on cpus[i] to socket number i in the reuseport group */
+R_API rboolean r_socket_set_reuseport_cpus (RSocket * socket, const ruint * cpus, ruint count);
 R_API rboolean r_socket_set_multicast_loop (RSocket * socket, rboolean loop);
 R_API rboolean r_socket_set_multicast_ttl (RSocket * socket, ruint ttl);
 R_API rboolean r_socket_set_ttl (RSocket * socket, ruint ttl);
@@ -105,6 +111,8 @@ R_API RSocketStatus r_socket_receive_message (RSocket * socket, RSocketAddress *
 R_API RSocketStatus r_socket_send (RSocket * socket, const ruint8 * buffer, rsize size, rsize * sent);
 R_API RSocketStatus r_socket_send_to (RSocket * socket, const RSocketAddress * address, const ruint8 * buffer, rsize size, rsize * sent);
 R_API RSocketStatus r_socket_send_message (RSocket * socket, const RSocketAddress * address, RBuffer * buf, rsize * sent);
+R_API RSocketStatus r_socket_receive_messages (RSocket * socket, RSocketAddress ** addresses, RBuffer ** bufs, rsize * received, ruint count, ruint * msgs);
+R_API RSocketStatus r_socket_send_messages (RSocket * socket, RSocketAddress * const * addresses, RBuffer ** bufs, rsize * sent, ruint count, ruint * msgs);
 
 R_END_DECLS
 
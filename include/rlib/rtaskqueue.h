@@ -37,13 +37,32 @@ typedef void (*RTaskFunc) (rpointer data, RTaskQueue * queue, RTask * task);
 
 #define r_task_ref    r_ref_ref
 #define r_task_unref  r_ref_unref
+/* Only before task is queued, and dep must be queued already. The task is
+ * handed to a thread once all its dependencies are done or canceled. */
 R_API rboolean r_task_add_dep (RTask * task, RTask * dep, ...) R_ATTR_NULL_TERMINATED;
 R_API rboolean r_task_add_dep_v (RTask * task, RTask * dep, va_list args);
 R_API rboolean r_task_cancel (RTask * task, rboolean wait_if_running);
 R_API rboolean r_task_wait (RTask * task);
+/* Wait for all tasks to be done or canceled */
+R_API rboolean r_task_wait_many (RTask ** tasks, rsize count);
+/* Wait for one of the tasks, returns its index or -1 */
+R_API rssize r_task_wait_any (RTask ** tasks, rsize count);
 
-R_API RTaskQueue * r_task_queue_new (ruint groups, ruint threads_per_group) R_ATTR_MALLOC;
-R_API RTaskQueue * r_task_queue_new_pin_and_group_on_numa_node (const RBitset * nodeset, ruint threads_per_group) R_ATTR_MALLOC;
+typedef enum {
+  R_TASK_QUEUE_FLAG_NONE          = 0,
+  /* Per-thread deques and lock-free injection, idle threads steal work from
+   * their own group first and then from the other groups. The group given
+   * when adding a task is then where it is queued, not where it must run. */
+  R_TASK_QUEUE_FLAG_WORK_STEALING = (1 << 0),
+} RTaskQueueFlag;
+typedef ruint32 RTaskQueueFlags;
+
+#define r_task_queue_new(groups, threads_per_group)                           \
+  r_task_queue_new_full (groups, threads_per_group, R_TASK_QUEUE_FLAG_NONE)
+R_API RTaskQueue * r_task_queue_new_full (ruint groups, ruint threads_per_group, RTaskQueueFlags flags) R_ATTR_MALLOC;
+#define r_task_queue_new_pin_and_group_on_numa_node(nodeset, threads_per_group) \
+  r_task_queue_new_pin_and_group_on_numa_node_full (nodeset, threads_per_group, R_TASK_QUEUE_FLAG_NONE)
+R_API RTaskQueue * r_task_queue_new_pin_and_group_on_numa_node_full (const RBitset * nodeset, ruint threads_per_group, RTaskQueueFlags flags) R_ATTR_MALLOC;
 R_API RTaskQueue * r_task_queue_new_pin_on_cpu_group_numa_node (const RBitset * nodeset) R_ATTR_MALLOC;
 R_API RTaskQueue * r_task_queue_new_pin_on_each_cpu (const RBitset * cpuset, ruint groups) R_ATTR_MALLOC;
 R_API RTaskQueue * r_task_queue_new_pin_on_each_cpu_group_numa_node (const RBitset * cpuset) R_ATTR_MALLOC;
@@ -106,6 +106,57 @@ R_API void      r_cond_wait         (RCond * cond, RMutex * mutex);
 R_API void      r_cond_signal       (RCond * cond);
 R_API void      r_cond_broadcast    (RCond * cond);
 
+/* Lightweight locks built on atomics, parking threads with futex on Linux
+ * and yielding elsewhere. They are plain integers, so they need no init
+ * or clear beyond the static initializers below. Meant for short critical
+ * sections, as a contended lock spins for a while before parking. */
+typedef struct {
+  rauint contended;   /* Found locked */
+  rauint spun;        /* Acquired while spinning */
+  rauint parked;      /* Had to sleep for it */
+} RFastLockStats;
+
+#define R_FAST_MUTEX_INIT     { 0, NULL }
+typedef struct {
+  rauint state;
+  RFastLockStats * stats;
+} RFastMutex;
+
+#define R_FAST_COND_INIT      { 0 }
+typedef struct {
+  rauint seq;
+} RFastCond;
+
+/* Reader biased, readers get in as long as no writer holds it, so writers
+ * can starve under a steady stream of readers */
+#define R_FAST_RWMUTEX_INIT   { 0 }
+typedef struct {
+  rauint state;
+} RFastRWMutex;
+
+/* Mutex, non-recursive. Contention is counted in stats if set, which can be
+ * shared between several mutexes */
+R_API void      r_fast_mutex_init       (RFastMutex * mutex);
+R_API void      r_fast_mutex_set_stats  (RFastMutex * mutex, RFastLockStats * stats);
+R_API void      r_fast_mutex_lock       (RFastMutex * mutex);
+R_API rboolean  r_fast_mutex_trylock    (RFastMutex * mutex);
+R_API void      r_fast_mutex_unlock     (RFastMutex * mutex);
+
+/* Condition variable, wakeups can be spurious */
+R_API void      r_fast_cond_init        (RFastCond * cond);
+R_API void      r_fast_cond_wait        (RFastCond * cond, RFastMutex * mutex);
+R_API void      r_fast_cond_signal      (RFastCond * cond);
+R_API void      r_fast_cond_broadcast   (RFastCond * cond);
+
+/* Read/Write mutex */
+R_API void      r_fast_rwmutex_init     (RFastRWMutex * mutex);
+R_API void      r_fast_rwmutex_rdlock   (RFastRWMutex * mutex);
+R_API void      r_fast_rwmutex_wrlock   (RFastRWMutex * mutex);
+R_API rboolean  r_fast_rwmutex_tryrdlock (RFastRWMutex * mutex);
+R_API rboolean  r_fast_rwmutex_trywrlock (RFastRWMutex * mutex);
+R_API void      r_fast_rwmutex_rdunlock (RFastRWMutex * mutex);
+R_API void      r_fast_rwmutex_wrunlock (RFastRWMutex * mutex);
+
 /* Threads */
 #define r_thread_new(name, func, data)                                        \
   r_thread_new_full (name, NULL, func, data)
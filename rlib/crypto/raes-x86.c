@@ -0,0 +1,491 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rcrypto-private.h"
+#include <rlib/crypto/raes.h>
+
+#include <rlib/ratomic.h>
+#include <rlib/rmem.h>
+
+#if defined (HAVE_X86_AESNI)
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+
+/* Number of blocks kept in flight to hide the aesenc/aesdec latency */
+#define R_AES_X86_LANES       8
+#define R_AES_X86_MAX_ROUNDS  14
+
+#define R_AES_X86_TARGET      __attribute__ ((target ("aes,sse2")))
+#define R_AES_X86_GCM_TARGET  __attribute__ ((target ("aes,pclmul,sse2,ssse3")))
+
+#define R_AES_X86_FEATURE_AES     (1 << 0)
+#define R_AES_X86_FEATURE_CLMUL   (1 << 1)
+
+static raint g__r_aes_x86_features = -1;
+
+static int
+r_aes_x86_features (void)
+{
+  int features = r_atomic_int_load (&g__r_aes_x86_features);
+
+  if (R_UNLIKELY (features < 0)) {
+    unsigned int eax, ebx, ecx, edx;
+
+    features = 0;
+    if (__get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+      /* CPUID.01H:ECX.AES[bit 25] */
+      if (ecx & bit_AES)
+        features |= R_AES_X86_FEATURE_AES;
+      /* GHASH needs PCLMULQDQ and the SSSE3 byte shuffle */
+      if ((ecx & bit_AES) && (ecx & bit_PCLMUL) && (ecx & bit_SSSE3))
+        features |= R_AES_X86_FEATURE_CLMUL;
+    }
+    r_atomic_int_store (&g__r_aes_x86_features, features);
+  }
+
+  return features;
+}
+
+rboolean
+r_aes_x86_available (void)
+{
+  return (r_aes_x86_features () & R_AES_X86_FEATURE_AES) != 0;
+}
+
+rboolean
+r_aes_x86_clmul_available (void)
+{
+  return (r_aes_x86_features () & R_AES_X86_FEATURE_CLMUL) != 0;
+}
+
+/* The portable key schedule is stored as little endian words, so on x86
+ * the memory layout of each four word round key is exactly what aesenc
+ * expects. The decryption schedule is already in the inverse mix columns
+ * form used by aesdec. */
+static inline R_AES_X86_TARGET void
+r_aes_x86_load_rk (__m128i * dst, const ruint32 * rk, ruint rounds)
+{
+  ruint i;
+  for (i = 0; i <= rounds; i++)
+    dst[i] = _mm_loadu_si128 ((const __m128i *)&rk[i * 4]);
+}
+
+static inline R_AES_X86_TARGET __m128i
+r_aes_x86_enc1 (const __m128i * rk, ruint rounds, __m128i b)
+{
+  ruint r;
+
+  b = _mm_xor_si128 (b, rk[0]);
+  for (r = 1; r < rounds; r++)
+    b = _mm_aesenc_si128 (b, rk[r]);
+  return _mm_aesenclast_si128 (b, rk[rounds]);
+}
+
+static inline R_AES_X86_TARGET __m128i
+r_aes_x86_dec1 (const __m128i * rk, ruint rounds, __m128i b)
+{
+  ruint r;
+
+  b = _mm_xor_si128 (b, rk[0]);
+  for (r = 1; r < rounds; r++)
+    b = _mm_aesdec_si128 (b, rk[r]);
+  return _mm_aesdeclast_si128 (b, rk[rounds]);
+}
+
+static inline R_AES_X86_TARGET void
+r_aes_x86_enc8 (const __m128i * rk, ruint rounds, __m128i * b)
+{
+  ruint r, i;
+
+  for (i = 0; i < R_AES_X86_LANES; i++)
+    b[i] = _mm_xor_si128 (b[i], rk[0]);
+  for (r = 1; r < rounds; r++) {
+    for (i = 0; i < R_AES_X86_LANES; i++)
+      b[i] = _mm_aesenc_si128 (b[i], rk[r]);
+  }
+  for (i = 0; i < R_AES_X86_LANES; i++)
+    b[i] = _mm_aesenclast_si128 (b[i], rk[rounds]);
+}
+
+static inline R_AES_X86_TARGET void
+r_aes_x86_dec8 (const __m128i * rk, ruint rounds, __m128i * b)
+{
+  ruint r, i;
+
+  for (i = 0; i < R_AES_X86_LANES; i++)
+    b[i] = _mm_xor_si128 (b[i], rk[0]);
+  for (r = 1; r < rounds; r++) {
+    for (i = 0; i < R_AES_X86_LANES; i++)
+      b[i] = _mm_aesdec_si128 (b[i], rk[r]);
+  }
+  for (i = 0; i < R_AES_X86_LANES; i++)
+    b[i] = _mm_aesdeclast_si128 (b[i], rk[rounds]);
+}
+
+R_AES_X86_TARGET void
+r_aes_x86_encrypt_block (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1];
+
+  r_aes_x86_load_rk (rk, erk, rounds);
+  _mm_storeu_si128 ((__m128i *)dst,
+      r_aes_x86_enc1 (rk, rounds, _mm_loadu_si128 ((const __m128i *)src)));
+}
+
+R_AES_X86_TARGET void
+r_aes_x86_decrypt_block (const ruint32 * drk, ruint rounds,
+    ruint8 * dst, const ruint8 * src)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1];
+
+  r_aes_x86_load_rk (rk, drk, rounds);
+  _mm_storeu_si128 ((__m128i *)dst,
+      r_aes_x86_dec1 (rk, rounds, _mm_loadu_si128 ((const __m128i *)src)));
+}
+
+R_AES_X86_TARGET void
+r_aes_x86_ecb_encrypt (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1], b[R_AES_X86_LANES];
+  ruint i;
+
+  r_aes_x86_load_rk (rk, erk, rounds);
+
+  for (; blocks >= R_AES_X86_LANES; blocks -= R_AES_X86_LANES) {
+    for (i = 0; i < R_AES_X86_LANES; i++)
+      b[i] = _mm_loadu_si128 ((const __m128i *)&src[i * R_AES_BLOCK_BYTES]);
+    r_aes_x86_enc8 (rk, rounds, b);
+    for (i = 0; i < R_AES_X86_LANES; i++)
+      _mm_storeu_si128 ((__m128i *)&dst[i * R_AES_BLOCK_BYTES], b[i]);
+    src += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+    dst += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+  }
+
+  for (; blocks > 0; blocks--) {
+    _mm_storeu_si128 ((__m128i *)dst,
+        r_aes_x86_enc1 (rk, rounds, _mm_loadu_si128 ((const __m128i *)src)));
+    src += R_AES_BLOCK_BYTES;
+    dst += R_AES_BLOCK_BYTES;
+  }
+}
+
+R_AES_X86_TARGET void
+r_aes_x86_ecb_decrypt (const ruint32 * drk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1], b[R_AES_X86_LANES];
+  ruint i;
+
+  r_aes_x86_load_rk (rk, drk, rounds);
+
+  for (; blocks >= R_AES_X86_LANES; blocks -= R_AES_X86_LANES) {
+    for (i = 0; i < R_AES_X86_LANES; i++)
+      b[i] = _mm_loadu_si128 ((const __m128i *)&src[i * R_AES_BLOCK_BYTES]);
+    r_aes_x86_dec8 (rk, rounds, b);
+    for (i = 0; i < R_AES_X86_LANES; i++)
+      _mm_storeu_si128 ((__m128i *)&dst[i * R_AES_BLOCK_BYTES], b[i]);
+    src += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+    dst += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+  }
+
+  for (; blocks > 0; blocks--) {
+    _mm_storeu_si128 ((__m128i *)dst,
+        r_aes_x86_dec1 (rk, rounds, _mm_loadu_si128 ((const __m128i *)src)));
+    src += R_AES_BLOCK_BYTES;
+    dst += R_AES_BLOCK_BYTES;
+  }
+}
+
+R_AES_X86_TARGET void
+r_aes_x86_cbc_encrypt (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks, ruint8 * iv)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1], c;
+
+  r_aes_x86_load_rk (rk, erk, rounds);
+  c = _mm_loadu_si128 ((const __m128i *)iv);
+
+  /* CBC encryption is inherently serial, each block depends on the last */
+  for (; blocks > 0; blocks--) {
+    c = _mm_xor_si128 (c, _mm_loadu_si128 ((const __m128i *)src));
+    c = r_aes_x86_enc1 (rk, rounds, c);
+    _mm_storeu_si128 ((__m128i *)dst, c);
+    src += R_AES_BLOCK_BYTES;
+    dst += R_AES_BLOCK_BYTES;
+  }
+
+  _mm_storeu_si128 ((__m128i *)iv, c);
+}
+
+R_AES_X86_TARGET void
+r_aes_x86_cbc_decrypt (const ruint32 * drk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks, ruint8 * iv)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1], b[R_AES_X86_LANES], c[R_AES_X86_LANES];
+  __m128i prev;
+  ruint i;
+
+  r_aes_x86_load_rk (rk, drk, rounds);
+  prev = _mm_loadu_si128 ((const __m128i *)iv);
+
+  /* Ciphertext is read into registers before anything is stored, which
+   * keeps in place decryption working */
+  for (; blocks >= R_AES_X86_LANES; blocks -= R_AES_X86_LANES) {
+    for (i = 0; i < R_AES_X86_LANES; i++)
+      b[i] = c[i] = _mm_loadu_si128 ((const __m128i *)&src[i * R_AES_BLOCK_BYTES]);
+    r_aes_x86_dec8 (rk, rounds, b);
+    _mm_storeu_si128 ((__m128i *)dst, _mm_xor_si128 (b[0], prev));
+    for (i = 1; i < R_AES_X86_LANES; i++)
+      _mm_storeu_si128 ((__m128i *)&dst[i * R_AES_BLOCK_BYTES], _mm_xor_si128 (b[i], c[i - 1]));
+    prev = c[R_AES_X86_LANES - 1];
+    src += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+    dst += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+  }
+
+  for (; blocks > 0; blocks--) {
+    c[0] = _mm_loadu_si128 ((const __m128i *)src);
+    _mm_storeu_si128 ((__m128i *)dst,
+        _mm_xor_si128 (r_aes_x86_dec1 (rk, rounds, c[0]), prev));
+    prev = c[0];
+    src += R_AES_BLOCK_BYTES;
+    dst += R_AES_BLOCK_BYTES;
+  }
+
+  _mm_storeu_si128 ((__m128i *)iv, prev);
+}
+
+/* The counter block is the whole 16 byte IV as a big endian integer, kept
+ * here as two host order halves and byte swapped into place per block. */
+static inline R_AES_X86_TARGET __m128i
+r_aes_x86_ctr_block (ruint64 hi, ruint64 lo)
+{
+  return _mm_set_epi64x ((rint64)RUINT64_TO_BE (lo), (rint64)RUINT64_TO_BE (hi));
+}
+
+#define R_AES_X86_CTR_INC(hi, lo) R_STMT_START {                               \
+  if (++(lo) == 0) (hi)++;                                                     \
+} R_STMT_END
+
+R_AES_X86_TARGET void
+r_aes_x86_ctr_crypt (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize size, ruint8 * iv)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1], b[R_AES_X86_LANES];
+  ruint64 hi, lo;
+  ruint i;
+
+  r_aes_x86_load_rk (rk, erk, rounds);
+  r_memcpy (&hi, &iv[0], sizeof (ruint64));
+  r_memcpy (&lo, &iv[8], sizeof (ruint64));
+  hi = RUINT64_FROM_BE (hi);
+  lo = RUINT64_FROM_BE (lo);
+
+  /* Pipelined keystream, eight counter blocks per pass */
+  for (; size >= R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+      size -= R_AES_X86_LANES * R_AES_BLOCK_BYTES) {
+    for (i = 0; i < R_AES_X86_LANES; i++) {
+      b[i] = r_aes_x86_ctr_block (hi, lo);
+      R_AES_X86_CTR_INC (hi, lo);
+    }
+    r_aes_x86_enc8 (rk, rounds, b);
+    for (i = 0; i < R_AES_X86_LANES; i++) {
+      _mm_storeu_si128 ((__m128i *)&dst[i * R_AES_BLOCK_BYTES], _mm_xor_si128 (b[i],
+            _mm_loadu_si128 ((const __m128i *)&src[i * R_AES_BLOCK_BYTES])));
+    }
+    src += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+    dst += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+  }
+
+  for (; size >= R_AES_BLOCK_BYTES; size -= R_AES_BLOCK_BYTES) {
+    b[0] = r_aes_x86_enc1 (rk, rounds, r_aes_x86_ctr_block (hi, lo));
+    R_AES_X86_CTR_INC (hi, lo);
+    _mm_storeu_si128 ((__m128i *)dst,
+        _mm_xor_si128 (b[0], _mm_loadu_si128 ((const __m128i *)src)));
+    src += R_AES_BLOCK_BYTES;
+    dst += R_AES_BLOCK_BYTES;
+  }
+
+  if (size > 0) {
+    ruint8 ks[R_AES_BLOCK_BYTES];
+
+    _mm_storeu_si128 ((__m128i *)ks,
+        r_aes_x86_enc1 (rk, rounds, r_aes_x86_ctr_block (hi, lo)));
+    R_AES_X86_CTR_INC (hi, lo);
+    for (i = 0; i < size; i++)
+      dst[i] = src[i] ^ ks[i];
+  }
+
+  hi = RUINT64_TO_BE (hi);
+  lo = RUINT64_TO_BE (lo);
+  r_memcpy (&iv[0], &hi, sizeof (ruint64));
+  r_memcpy (&iv[8], &lo, sizeof (ruint64));
+}
+
+static inline R_AES_X86_GCM_TARGET __m128i
+r_aes_x86_bswap128 (__m128i x)
+{
+  return _mm_shuffle_epi8 (x,
+      _mm_set_epi8 (0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+/* Carry-less multiplication in GF(2^128) of byte reversed operands,
+ * followed by the shift and reduction modulo x^128 + x^7 + x^2 + x + 1
+ * (Intel, "Carry-Less Multiplication and Its Usage for Computing the GCM
+ * Mode", algorithm 5) */
+static inline R_AES_X86_GCM_TARGET __m128i
+r_aes_x86_gfmul (__m128i a, __m128i b)
+{
+  __m128i t2, t3, t4, t5, t6, t7, t8, t9;
+
+  t3 = _mm_clmulepi64_si128 (a, b, 0x00);
+  t4 = _mm_clmulepi64_si128 (a, b, 0x10);
+  t5 = _mm_clmulepi64_si128 (a, b, 0x01);
+  t6 = _mm_clmulepi64_si128 (a, b, 0x11);
+
+  t4 = _mm_xor_si128 (t4, t5);
+  t5 = _mm_slli_si128 (t4, 8);
+  t4 = _mm_srli_si128 (t4, 8);
+  t3 = _mm_xor_si128 (t3, t5);
+  t6 = _mm_xor_si128 (t6, t4);
+
+  /* Shift the 256 bit product left by one */
+  t7 = _mm_srli_epi32 (t3, 31);
+  t8 = _mm_srli_epi32 (t6, 31);
+  t3 = _mm_slli_epi32 (t3, 1);
+  t6 = _mm_slli_epi32 (t6, 1);
+  t9 = _mm_srli_si128 (t7, 12);
+  t8 = _mm_slli_si128 (t8, 4);
+  t7 = _mm_slli_si128 (t7, 4);
+  t3 = _mm_or_si128 (t3, t7);
+  t6 = _mm_or_si128 (t6, t8);
+  t6 = _mm_or_si128 (t6, t9);
+
+  /* Reduce */
+  t7 = _mm_slli_epi32 (t3, 31);
+  t8 = _mm_slli_epi32 (t3, 30);
+  t9 = _mm_slli_epi32 (t3, 25);
+  t7 = _mm_xor_si128 (t7, t8);
+  t7 = _mm_xor_si128 (t7, t9);
+  t8 = _mm_srli_si128 (t7, 4);
+  t7 = _mm_slli_si128 (t7, 12);
+  t3 = _mm_xor_si128 (t3, t7);
+
+  t2 = _mm_srli_epi32 (t3, 1);
+  t4 = _mm_srli_epi32 (t3, 2);
+  t5 = _mm_srli_epi32 (t3, 7);
+  t2 = _mm_xor_si128 (t2, t4);
+  t2 = _mm_xor_si128 (t2, t5);
+  t2 = _mm_xor_si128 (t2, t8);
+  t3 = _mm_xor_si128 (t3, t2);
+
+  return _mm_xor_si128 (t6, t3);
+}
+
+R_AES_X86_GCM_TARGET void
+r_aes_x86_ghash (const ruint8 * h, ruint8 * y, const ruint8 * data, rsize size)
+{
+  __m128i hv, yv;
+
+  hv = r_aes_x86_bswap128 (_mm_loadu_si128 ((const __m128i *)h));
+  yv = r_aes_x86_bswap128 (_mm_loadu_si128 ((const __m128i *)y));
+
+  for (; size >= R_AES_BLOCK_BYTES; size -= R_AES_BLOCK_BYTES, data += R_AES_BLOCK_BYTES) {
+    yv = _mm_xor_si128 (yv,
+        r_aes_x86_bswap128 (_mm_loadu_si128 ((const __m128i *)data)));
+    yv = r_aes_x86_gfmul (yv, hv);
+  }
+
+  if (size > 0) {
+    ruint8 last[R_AES_BLOCK_BYTES] = { 0 };
+
+    r_memcpy (last, data, size);
+    yv = _mm_xor_si128 (yv,
+        r_aes_x86_bswap128 (_mm_loadu_si128 ((const __m128i *)last)));
+    yv = r_aes_x86_gfmul (yv, hv);
+  }
+
+  _mm_storeu_si128 ((__m128i *)y, r_aes_x86_bswap128 (yv));
+}
+
+/* The counter block is kept byte reversed, which puts the big endian 32 bit
+ * counter of GCM in the lowest lane where _mm_add_epi32 wraps it exactly
+ * like inc32 does. */
+R_AES_X86_GCM_TARGET void
+r_aes_x86_gcm_ctr (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize size, const ruint8 * icb)
+{
+  __m128i rk[R_AES_X86_MAX_ROUNDS + 1], b[R_AES_X86_LANES];
+  __m128i ctr, one = _mm_set_epi32 (0, 0, 0, 1);
+  ruint i;
+
+  r_aes_x86_load_rk (rk, erk, rounds);
+  ctr = r_aes_x86_bswap128 (_mm_loadu_si128 ((const __m128i *)icb));
+
+  for (; size >= R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+      size -= R_AES_X86_LANES * R_AES_BLOCK_BYTES) {
+    for (i = 0; i < R_AES_X86_LANES; i++) {
+      b[i] = r_aes_x86_bswap128 (ctr);
+      ctr = _mm_add_epi32 (ctr, one);
+    }
+    r_aes_x86_enc8 (rk, rounds, b);
+    for (i = 0; i < R_AES_X86_LANES; i++) {
+      _mm_storeu_si128 ((__m128i *)&dst[i * R_AES_BLOCK_BYTES], _mm_xor_si128 (b[i],
+            _mm_loadu_si128 ((const __m128i *)&src[i * R_AES_BLOCK_BYTES])));
+    }
+    src += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+    dst += R_AES_X86_LANES * R_AES_BLOCK_BYTES;
+  }
+
+  for (; size >= R_AES_BLOCK_BYTES; size -= R_AES_BLOCK_BYTES) {
+    b[0] = r_aes_x86_enc1 (rk, rounds, r_aes_x86_bswap128 (ctr));
+    ctr = _mm_add_epi32 (ctr, one);
+    _mm_storeu_si128 ((__m128i *)dst,
+        _mm_xor_si128 (b[0], _mm_loadu_si128 ((const __m128i *)src)));
+    src += R_AES_BLOCK_BYTES;
+    dst += R_AES_BLOCK_BYTES;
+  }
+
+  if (size > 0) {
+    ruint8 ks[R_AES_BLOCK_BYTES];
+
+    _mm_storeu_si128 ((__m128i *)ks,
+        r_aes_x86_enc1 (rk, rounds, r_aes_x86_bswap128 (ctr)));
+    for (i = 0; i < size; i++)
+      dst[i] = src[i] ^ ks[i];
+  }
+}
+
+#else
+
+rboolean
+r_aes_x86_available (void)
+{
+  return FALSE;
+}
+
+rboolean
+r_aes_x86_clmul_available (void)
+{
+  return FALSE;
+}
+
+#endif
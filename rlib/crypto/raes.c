@@ -17,6 +17,7 @@
  */
 
 #include "config.h"
+#include "rcrypto-private.h"
 #include <rlib/crypto/raes.h>
 #include <rlib/crypto/raes-data.inc>
 
@@ -60,8 +61,28 @@ typedef struct {
   ruint32 erk[R_AES_BLOCK_BYTES * sizeof (ruint32)];
   ruint32 drk[R_AES_BLOCK_BYTES * sizeof (ruint32)];
   ruint8 rounds;
+  RAesImpl impl;
 } RAesCipher;
 
+/* GCM keeps the hash subkey H next to the key schedule, together with the
+ * 4-bit multiplication tables used by the portable GHASH */
+typedef struct {
+  RAesCipher aes;
+
+  ruint8 h[R_AES_BLOCK_BYTES];
+  ruint64 hl[16];
+  ruint64 hh[16];
+  rboolean clmul;
+} RAesGcmCipher;
+
+#if defined (HAVE_X86_AESNI)
+#define R_AES_IS_AESNI(aes)   ((aes)->impl == R_AES_IMPL_AESNI)
+#define R_AES_GCM_IS_CLMUL(gcm) ((gcm)->clmul && R_AES_IS_AESNI (&(gcm)->aes))
+#else
+#define R_AES_IS_AESNI(aes)   FALSE
+#define R_AES_GCM_IS_CLMUL(gcm) FALSE
+#endif
+
 const RCryptoCipherInfo g__r_crypto_cipher_aes_128_ecb =  { "AES-128-ECB",
   R_CRYPTO_CIPHER_ALGO_AES, R_CRYPTO_CIPHER_MODE_ECB, 128, 16, 16,
   r_cipher_aes_ecb_encrypt, r_cipher_aes_ecb_decrypt
@@ -100,6 +121,80 @@ const RCryptoCipherInfo g__r_crypto_cipher_aes_256_ctr = { "AES-256-CTR",
   r_cipher_aes_ctr_encrypt, r_cipher_aes_ctr_decrypt
 };
 
+/* GCM needs room for the tag, which RCryptoCipherOperation callers don't
+ * leave, so only r_cipher_aes_gcm_encrypt_full and _decrypt_full work */
+static RCryptoCipherResult
+r_cipher_aes_gcm_generic (const RCryptoCipher * cipher,
+    ruint8 * dst, rsize size, rconstpointer data, ruint8 * iv, rsize ivsize)
+{
+  (void) cipher;
+  (void) dst;
+  (void) size;
+  (void) data;
+  (void) iv;
+  (void) ivsize;
+  return R_CRYPTO_CIPHER_INVAL;
+}
+
+const RCryptoCipherInfo g__r_crypto_cipher_aes_128_gcm = { "AES-128-GCM",
+  R_CRYPTO_CIPHER_ALGO_AES, R_CRYPTO_CIPHER_MODE_GCM, 128, R_AES_GCM_IV_BYTES, 16,
+  r_cipher_aes_gcm_generic, r_cipher_aes_gcm_generic
+};
+const RCryptoCipherInfo g__r_crypto_cipher_aes_192_gcm = { "AES-192-GCM",
+  R_CRYPTO_CIPHER_ALGO_AES, R_CRYPTO_CIPHER_MODE_GCM, 192, R_AES_GCM_IV_BYTES, 16,
+  r_cipher_aes_gcm_generic, r_cipher_aes_gcm_generic
+};
+const RCryptoCipherInfo g__r_crypto_cipher_aes_256_gcm = { "AES-256-GCM",
+  R_CRYPTO_CIPHER_ALGO_AES, R_CRYPTO_CIPHER_MODE_GCM, 256, R_AES_GCM_IV_BYTES, 16,
+  r_cipher_aes_gcm_generic, r_cipher_aes_gcm_generic
+};
+
+/* Reduction of the four bits shifted out of the 4-bit table GHASH */
+static const ruint64 r_aes_gcm_last4[16] = {
+  0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+  0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0
+};
+
+static void
+r_cipher_aes_gcm_init (RAesGcmCipher * gcm)
+{
+  ruint64 vh, vl;
+  ruint32 t;
+  int i, j;
+
+  /* H = E(K, 0^128) */
+  gcm->clmul = r_aes_x86_clmul_available ();
+  r_memclear (gcm->h, sizeof (gcm->h));
+  r_cipher_aes_ecb_encrypt_block ((const RCryptoCipher *)gcm, gcm->h, gcm->h);
+
+  /* Shoup's 4-bit tables: hh/hl[i] = i * H in the bit reflected field */
+  r_memcpy (&vh, &gcm->h[0], sizeof (ruint64));
+  r_memcpy (&vl, &gcm->h[8], sizeof (ruint64));
+  vh = RUINT64_FROM_BE (vh);
+  vl = RUINT64_FROM_BE (vl);
+
+  gcm->hl[8] = vl;
+  gcm->hh[8] = vh;
+  gcm->hl[0] = gcm->hh[0] = 0;
+
+  for (i = 4; i > 0; i >>= 1) {
+    t = (ruint32)(vl & 1) * 0xe1000000U;
+    vl = (vh << 63) | (vl >> 1);
+    vh = (vh >> 1) ^ ((ruint64)t << 32);
+    gcm->hl[i] = vl;
+    gcm->hh[i] = vh;
+  }
+
+  for (i = 2; i <= 8; i *= 2) {
+    vh = gcm->hh[i];
+    vl = gcm->hl[i];
+    for (j = 1; j < i; j++) {
+      gcm->hh[i + j] = vh ^ gcm->hh[j];
+      gcm->hl[i + j] = vl ^ gcm->hl[j];
+    }
+  }
+}
+
 static void
 r_cipher_aes_free (RAesCipher * cipher)
 {
@@ -113,12 +208,14 @@ r_cipher_aes_new_with_info (const RCryptoCipherInfo * info, const ruint8 * key)
 
   if (R_UNLIKELY (key == NULL)) return NULL;
 
-  if ((ret = r_mem_new (RAesCipher)) != NULL) {
+  if ((ret = r_malloc (info->mode == R_CRYPTO_CIPHER_MODE_GCM ?
+          sizeof (RAesGcmCipher) : sizeof (RAesCipher))) != NULL) {
     ruint8 i;
     ruint32 * rk, * src;
 
     r_ref_init (ret, r_cipher_aes_free);
     ret->cipher.info = info;
+    ret->impl = r_aes_x86_available () ? R_AES_IMPL_AESNI : R_AES_IMPL_PORTABLE;
     r_memcpy (ret->key, key, info->keybits / 8);
 
     rk = ret->erk;
@@ -218,6 +315,9 @@ r_cipher_aes_new_with_info (const RCryptoCipherInfo * info, const ruint8 * key)
     *rk++ = *src++;
     *rk++ = *src++;
     *rk++ = *src++;
+
+    if (info->mode == R_CRYPTO_CIPHER_MODE_GCM)
+      r_cipher_aes_gcm_init ((RAesGcmCipher *)ret);
   }
 
   return (RCryptoCipher *)ret;
@@ -277,6 +377,24 @@ r_cipher_aes_256_ctr_new (const ruint8 * key)
   return r_cipher_aes_new_with_info (&g__r_crypto_cipher_aes_256_ctr, key);
 }
 
+RCryptoCipher *
+r_cipher_aes_128_gcm_new (const ruint8 * key)
+{
+  return r_cipher_aes_new_with_info (&g__r_crypto_cipher_aes_128_gcm, key);
+}
+
+RCryptoCipher *
+r_cipher_aes_192_gcm_new (const ruint8 * key)
+{
+  return r_cipher_aes_new_with_info (&g__r_crypto_cipher_aes_192_gcm, key);
+}
+
+RCryptoCipher *
+r_cipher_aes_256_gcm_new (const ruint8 * key)
+{
+  return r_cipher_aes_new_with_info (&g__r_crypto_cipher_aes_256_gcm, key);
+}
+
 RCryptoCipher *
 r_cipher_aes_new (RCryptoCipherMode mode, ruint bits, const ruint8 * key)
 {
@@ -289,6 +407,8 @@ r_cipher_aes_new (RCryptoCipherMode mode, ruint bits, const ruint8 * key)
           return r_cipher_aes_128_cbc_new (key);
         case R_CRYPTO_CIPHER_MODE_CTR:
           return r_cipher_aes_128_ctr_new (key);
+        case R_CRYPTO_CIPHER_MODE_GCM:
+          return r_cipher_aes_128_gcm_new (key);
         default:
           break;
       }
@@ -301,6 +421,8 @@ r_cipher_aes_new (RCryptoCipherMode mode, ruint bits, const ruint8 * key)
           return r_cipher_aes_192_cbc_new (key);
         case R_CRYPTO_CIPHER_MODE_CTR:
           return r_cipher_aes_192_ctr_new (key);
+        case R_CRYPTO_CIPHER_MODE_GCM:
+          return r_cipher_aes_192_gcm_new (key);
         default:
           break;
       }
@@ -313,6 +435,8 @@ r_cipher_aes_new (RCryptoCipherMode mode, ruint bits, const ruint8 * key)
           return r_cipher_aes_256_cbc_new (key);
         case R_CRYPTO_CIPHER_MODE_CTR:
           return r_cipher_aes_256_ctr_new (key);
+        case R_CRYPTO_CIPHER_MODE_GCM:
+          return r_cipher_aes_256_gcm_new (key);
         default:
           break;
       }
@@ -324,6 +448,43 @@ r_cipher_aes_new (RCryptoCipherMode mode, ruint bits, const ruint8 * key)
   return NULL;
 }
 
+rboolean
+r_cipher_aes_impl_available (RAesImpl impl)
+{
+  switch (impl) {
+    case R_AES_IMPL_AUTO:
+    case R_AES_IMPL_PORTABLE:
+      return TRUE;
+    case R_AES_IMPL_AESNI:
+      return r_aes_x86_available ();
+    default:
+      return FALSE;
+  }
+}
+
+RCryptoCipher *
+r_cipher_aes_new_with_impl (RCryptoCipherMode mode, ruint bits,
+    const ruint8 * key, RAesImpl impl)
+{
+  RCryptoCipher * ret;
+
+  if (R_UNLIKELY (!r_cipher_aes_impl_available (impl))) return NULL;
+
+  if ((ret = r_cipher_aes_new (mode, bits, key)) != NULL && impl != R_AES_IMPL_AUTO)
+    ((RAesCipher *)ret)->impl = impl;
+
+  return ret;
+}
+
+RAesImpl
+r_cipher_aes_get_impl (const RCryptoCipher * cipher)
+{
+  if (R_UNLIKELY (cipher == NULL)) return R_AES_IMPL_AUTO;
+  if (R_UNLIKELY (cipher->info->type != R_CRYPTO_CIPHER_ALGO_AES)) return R_AES_IMPL_AUTO;
+
+  return ((const RAesCipher *)cipher)->impl;
+}
+
 RCryptoCipher *
 r_cipher_aes_new_from_hex (RCryptoCipherMode mode, const rchar * hexkey)
 {
@@ -353,6 +514,10 @@ r_cipher_aes_ecb_encrypt_block (const RCryptoCipher * cipher,
   if (R_UNLIKELY (cipher == NULL)) return FALSE;
 
   aes = (const RAesCipher *)cipher;
+  if (R_AES_IS_AESNI (aes)) {
+    r_aes_x86_encrypt_block (aes->erk, aes->rounds, ciphertxt, plaintxt);
+    return TRUE;
+  }
   rk = aes->erk;
 
   input[0] = RUINT32_FROM_LE (*((ruint32 *)&plaintxt[0x0])) ^ *rk++;
@@ -408,6 +573,10 @@ r_cipher_aes_ecb_decrypt_block (const RCryptoCipher * cipher,
   if (R_UNLIKELY (cipher == NULL)) return FALSE;
 
   aes = (const RAesCipher *)cipher;
+  if (R_AES_IS_AESNI (aes)) {
+    r_aes_x86_decrypt_block (aes->drk, aes->rounds, plaintxt, ciphertxt);
+    return TRUE;
+  }
   rk = aes->drk;
 
   input[0] = RUINT32_FROM_LE (*((ruint32 *)&ciphertxt[0x0])) ^ *rk++;
@@ -465,6 +634,12 @@ r_cipher_aes_ecb_encrypt (const RCryptoCipher * cipher,
   if (R_UNLIKELY (dst == NULL)) return R_CRYPTO_CIPHER_INVAL;
   if (R_UNLIKELY ((size % R_AES_BLOCK_BYTES) > 0)) return R_CRYPTO_CIPHER_WRONG_BLOCK_SIZE;
 
+  if (R_AES_IS_AESNI ((const RAesCipher *)cipher)) {
+    const RAesCipher * aes = (const RAesCipher *)cipher;
+    r_aes_x86_ecb_encrypt (aes->erk, aes->rounds, dst, data, size / R_AES_BLOCK_BYTES);
+    return R_CRYPTO_CIPHER_OK;
+  }
+
   for (ptr = data; ptr < ((ruint8 *)data) + size; ptr += R_AES_BLOCK_BYTES, dst += R_AES_BLOCK_BYTES)
     r_cipher_aes_ecb_encrypt_block (cipher, dst, ptr);
 
@@ -485,6 +660,12 @@ r_cipher_aes_ecb_decrypt (const RCryptoCipher * cipher,
   if (R_UNLIKELY (dst == NULL)) return R_CRYPTO_CIPHER_INVAL;
   if (R_UNLIKELY ((size % R_AES_BLOCK_BYTES) > 0)) return R_CRYPTO_CIPHER_WRONG_BLOCK_SIZE;
 
+  if (R_AES_IS_AESNI ((const RAesCipher *)cipher)) {
+    const RAesCipher * aes = (const RAesCipher *)cipher;
+    r_aes_x86_ecb_decrypt (aes->drk, aes->rounds, dst, data, size / R_AES_BLOCK_BYTES);
+    return R_CRYPTO_CIPHER_OK;
+  }
+
   for (ptr = data; ptr < ((ruint8 *)data) + size; ptr += R_AES_BLOCK_BYTES, dst += R_AES_BLOCK_BYTES)
     r_cipher_aes_ecb_decrypt_block (cipher, dst, ptr);
 
@@ -504,6 +685,12 @@ r_cipher_aes_cbc_encrypt (const RCryptoCipher * cipher,
   if (R_UNLIKELY (ivsize != R_AES_BLOCK_BYTES)) return R_CRYPTO_CIPHER_INVAL;
   if (R_UNLIKELY ((size % R_AES_BLOCK_BYTES) > 0)) return R_CRYPTO_CIPHER_WRONG_BLOCK_SIZE;
 
+  if (R_AES_IS_AESNI ((const RAesCipher *)cipher)) {
+    const RAesCipher * aes = (const RAesCipher *)cipher;
+    r_aes_x86_cbc_encrypt (aes->erk, aes->rounds, dst, data, size / R_AES_BLOCK_BYTES, iv);
+    return R_CRYPTO_CIPHER_OK;
+  }
+
   for (ptr = data; ptr < ((ruint8 *)data) + size; ptr += R_AES_BLOCK_BYTES, dst += R_AES_BLOCK_BYTES) {
     for (i = 0; i < R_AES_BLOCK_BYTES; i++)
         dst[i] = ptr[i] ^ iv[i];
@@ -528,6 +715,12 @@ r_cipher_aes_cbc_decrypt (const RCryptoCipher * cipher,
   if (R_UNLIKELY (ivsize != R_AES_BLOCK_BYTES)) return R_CRYPTO_CIPHER_INVAL;
   if (R_UNLIKELY ((size % R_AES_BLOCK_BYTES) > 0)) return R_CRYPTO_CIPHER_WRONG_BLOCK_SIZE;
 
+  if (R_AES_IS_AESNI ((const RAesCipher *)cipher)) {
+    const RAesCipher * aes = (const RAesCipher *)cipher;
+    r_aes_x86_cbc_decrypt (aes->drk, aes->rounds, dst, data, size / R_AES_BLOCK_BYTES, iv);
+    return R_CRYPTO_CIPHER_OK;
+  }
+
   for (ptr = data; ptr < ((ruint8 *)data) + size; ptr += R_AES_BLOCK_BYTES, dst += R_AES_BLOCK_BYTES) {
     /* Use scratch memory because decryption can be done inplace */
     r_memcpy (scratch, ptr, R_AES_BLOCK_BYTES);
@@ -554,6 +747,12 @@ r_cipher_aes_ctr_encrypt (const RCryptoCipher * cipher,
   if (R_UNLIKELY (dst == NULL)) return R_CRYPTO_CIPHER_INVAL;
   if (R_UNLIKELY (ivsize != R_AES_BLOCK_BYTES)) return R_CRYPTO_CIPHER_INVAL;
 
+  if (R_AES_IS_AESNI ((const RAesCipher *)cipher)) {
+    const RAesCipher * aes = (const RAesCipher *)cipher;
+    r_aes_x86_ctr_crypt (aes->erk, aes->rounds, dst, data, size, iv);
+    return R_CRYPTO_CIPHER_OK;
+  }
+
   size %= R_AES_BLOCK_BYTES;
   bsize -= size;
 
@@ -580,3 +779,213 @@ r_cipher_aes_ctr_encrypt (const RCryptoCipher * cipher,
   return R_CRYPTO_CIPHER_OK;
 }
 
+
+static void
+r_cipher_aes_gcm_mult (const RAesGcmCipher * gcm, ruint8 x[R_AES_BLOCK_BYTES])
+{
+  ruint64 zh, zl;
+  ruint8 lo, hi, rem;
+  int i;
+
+  lo = x[15] & 0xf;
+  zh = gcm->hh[lo];
+  zl = gcm->hl[lo];
+
+  for (i = 15; i >= 0; i--) {
+    lo = x[i] & 0xf;
+    hi = (x[i] >> 4) & 0xf;
+
+    if (i != 15) {
+      rem = (ruint8)zl & 0xf;
+      zl = (zh << 60) | (zl >> 4);
+      zh = (zh >> 4) ^ (r_aes_gcm_last4[rem] << 48);
+      zh ^= gcm->hh[lo];
+      zl ^= gcm->hl[lo];
+    }
+
+    rem = (ruint8)zl & 0xf;
+    zl = (zh << 60) | (zl >> 4);
+    zh = (zh >> 4) ^ (r_aes_gcm_last4[rem] << 48);
+    zh ^= gcm->hh[hi];
+    zl ^= gcm->hl[hi];
+  }
+
+  zh = RUINT64_TO_BE (zh);
+  zl = RUINT64_TO_BE (zl);
+  r_memcpy (&x[0], &zh, sizeof (ruint64));
+  r_memcpy (&x[8], &zl, sizeof (ruint64));
+}
+
+/* Folds data into the GHASH state y, zero padding a trailing partial block */
+static void
+r_cipher_aes_gcm_ghash (const RAesGcmCipher * gcm, ruint8 y[R_AES_BLOCK_BYTES],
+    const ruint8 * data, rsize size)
+{
+  rsize i;
+
+  if (R_AES_GCM_IS_CLMUL (gcm)) {
+    r_aes_x86_ghash (gcm->h, y, data, size);
+    return;
+  }
+
+  for (; size >= R_AES_BLOCK_BYTES; size -= R_AES_BLOCK_BYTES, data += R_AES_BLOCK_BYTES) {
+    for (i = 0; i < R_AES_BLOCK_BYTES; i++)
+      y[i] ^= data[i];
+    r_cipher_aes_gcm_mult (gcm, y);
+  }
+
+  if (size > 0) {
+    for (i = 0; i < size; i++)
+      y[i] ^= data[i];
+    r_cipher_aes_gcm_mult (gcm, y);
+  }
+}
+
+static inline void
+r_cipher_aes_gcm_inc32 (ruint8 cb[R_AES_BLOCK_BYTES])
+{
+  ruint32 ctr;
+
+  r_memcpy (&ctr, &cb[12], sizeof (ruint32));
+  ctr = RUINT32_TO_BE (RUINT32_FROM_BE (ctr) + 1);
+  r_memcpy (&cb[12], &ctr, sizeof (ruint32));
+}
+
+/* GCTR, only the low 32 bits of the counter block are incremented */
+static void
+r_cipher_aes_gcm_ctr (const RAesGcmCipher * gcm, ruint8 * dst,
+    const ruint8 * src, rsize size, const ruint8 icb[R_AES_BLOCK_BYTES])
+{
+  ruint8 cb[R_AES_BLOCK_BYTES], ks[R_AES_BLOCK_BYTES];
+  rsize i, len;
+
+  if (R_AES_GCM_IS_CLMUL (gcm)) {
+    r_aes_x86_gcm_ctr (gcm->aes.erk, gcm->aes.rounds, dst, src, size, icb);
+    return;
+  }
+
+  r_memcpy (cb, icb, R_AES_BLOCK_BYTES);
+
+  for (; size > 0; size -= len, src += len, dst += len) {
+    r_cipher_aes_ecb_encrypt_block ((const RCryptoCipher *)gcm, ks, cb);
+    len = MIN (size, R_AES_BLOCK_BYTES);
+    for (i = 0; i < len; i++)
+      dst[i] = src[i] ^ ks[i];
+    r_cipher_aes_gcm_inc32 (cb);
+  }
+}
+
+static void
+r_cipher_aes_gcm_lengths (const RAesGcmCipher * gcm, ruint8 y[R_AES_BLOCK_BYTES],
+    ruint64 asize, ruint64 csize)
+{
+  ruint8 lens[R_AES_BLOCK_BYTES];
+
+  asize = RUINT64_TO_BE (asize * 8);
+  csize = RUINT64_TO_BE (csize * 8);
+  r_memcpy (&lens[0], &asize, sizeof (ruint64));
+  r_memcpy (&lens[8], &csize, sizeof (ruint64));
+  r_cipher_aes_gcm_ghash (gcm, y, lens, sizeof (lens));
+}
+
+static void
+r_cipher_aes_gcm_j0 (const RAesGcmCipher * gcm, ruint8 j0[R_AES_BLOCK_BYTES],
+    const ruint8 * iv, rsize ivsize)
+{
+  if (ivsize == R_AES_GCM_IV_BYTES) {
+    r_memcpy (j0, iv, R_AES_GCM_IV_BYTES);
+    j0[12] = j0[13] = j0[14] = 0;
+    j0[15] = 1;
+  } else {
+    r_memclear (j0, R_AES_BLOCK_BYTES);
+    r_cipher_aes_gcm_ghash (gcm, j0, iv, ivsize);
+    r_cipher_aes_gcm_lengths (gcm, j0, 0, ivsize);
+  }
+}
+
+static void
+r_cipher_aes_gcm_tag (const RAesGcmCipher * gcm, ruint8 tag[R_AES_BLOCK_BYTES],
+    const ruint8 j0[R_AES_BLOCK_BYTES], const ruint8 * aad, rsize aadsize,
+    const ruint8 * ct, rsize size)
+{
+  ruint8 ekj0[R_AES_BLOCK_BYTES];
+  int i;
+
+  r_memclear (tag, R_AES_BLOCK_BYTES);
+  if (aadsize > 0)
+    r_cipher_aes_gcm_ghash (gcm, tag, aad, aadsize);
+  if (size > 0)
+    r_cipher_aes_gcm_ghash (gcm, tag, ct, size);
+  r_cipher_aes_gcm_lengths (gcm, tag, aadsize, size);
+
+  r_cipher_aes_ecb_encrypt_block ((const RCryptoCipher *)gcm, ekj0, j0);
+  for (i = 0; i < R_AES_BLOCK_BYTES; i++)
+    tag[i] ^= ekj0[i];
+}
+
+RCryptoCipherResult
+r_cipher_aes_gcm_encrypt_full (const RCryptoCipher * cipher,
+    ruint8 * dst, rsize size, rconstpointer data,
+    const ruint8 * iv, rsize ivsize, rconstpointer aad, rsize aadsize,
+    ruint8 * tag, rsize tagsize)
+{
+  const RAesGcmCipher * gcm;
+  ruint8 j0[R_AES_BLOCK_BYTES], cb[R_AES_BLOCK_BYTES], calctag[R_AES_BLOCK_BYTES];
+
+  if (R_UNLIKELY (cipher == NULL)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (cipher->info->mode != R_CRYPTO_CIPHER_MODE_GCM)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (size > 0 && (data == NULL || dst == NULL))) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (aadsize > 0 && aad == NULL)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (iv == NULL || ivsize == 0)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (tag == NULL || tagsize < 4 || tagsize > R_AES_GCM_TAG_BYTES))
+    return R_CRYPTO_CIPHER_INVAL;
+
+  gcm = (const RAesGcmCipher *)cipher;
+  r_cipher_aes_gcm_j0 (gcm, j0, iv, ivsize);
+  r_memcpy (cb, j0, R_AES_BLOCK_BYTES);
+  r_cipher_aes_gcm_inc32 (cb);
+
+  if (size > 0)
+    r_cipher_aes_gcm_ctr (gcm, dst, data, size, cb);
+  r_cipher_aes_gcm_tag (gcm, calctag, j0, aad, aadsize, dst, size);
+  r_memcpy (tag, calctag, tagsize);
+
+  return R_CRYPTO_CIPHER_OK;
+}
+
+RCryptoCipherResult
+r_cipher_aes_gcm_decrypt_full (const RCryptoCipher * cipher,
+    ruint8 * dst, rsize size, rconstpointer data,
+    const ruint8 * iv, rsize ivsize, rconstpointer aad, rsize aadsize,
+    const ruint8 * tag, rsize tagsize)
+{
+  const RAesGcmCipher * gcm;
+  ruint8 j0[R_AES_BLOCK_BYTES], cb[R_AES_BLOCK_BYTES], calctag[R_AES_BLOCK_BYTES];
+  ruint8 diff;
+  rsize i;
+
+  if (R_UNLIKELY (cipher == NULL)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (cipher->info->mode != R_CRYPTO_CIPHER_MODE_GCM)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (size > 0 && (data == NULL || dst == NULL))) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (aadsize > 0 && aad == NULL)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (iv == NULL || ivsize == 0)) return R_CRYPTO_CIPHER_INVAL;
+  if (R_UNLIKELY (tag == NULL || tagsize < 4 || tagsize > R_AES_GCM_TAG_BYTES))
+    return R_CRYPTO_CIPHER_INVAL;
+
+  gcm = (const RAesGcmCipher *)cipher;
+  r_cipher_aes_gcm_j0 (gcm, j0, iv, ivsize);
+
+  /* Verify before decrypting, dst is left untouched on failure */
+  r_cipher_aes_gcm_tag (gcm, calctag, j0, aad, aadsize, data, size);
+  for (i = 0, diff = 0; i < tagsize; i++)
+    diff |= calctag[i] ^ tag[i];
+  if (diff != 0)
+    return R_CRYPTO_CIPHER_AUTH_FAILED;
+
+  r_memcpy (cb, j0, R_AES_BLOCK_BYTES);
+  r_cipher_aes_gcm_inc32 (cb);
+  if (size > 0)
+    r_cipher_aes_gcm_ctr (gcm, dst, data, size, cb);
+
+  return R_CRYPTO_CIPHER_OK;
+}
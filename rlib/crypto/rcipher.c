@@ -51,6 +51,9 @@ const RCryptoCipherInfo * g__r_crypto_ciphers[] = {
   &g__r_crypto_cipher_aes_128_ctr,
   &g__r_crypto_cipher_aes_192_ctr,
   &g__r_crypto_cipher_aes_256_ctr,
+  &g__r_crypto_cipher_aes_128_gcm,
+  &g__r_crypto_cipher_aes_192_gcm,
+  &g__r_crypto_cipher_aes_256_gcm,
 };
 
 const RCryptoCipherInfo *
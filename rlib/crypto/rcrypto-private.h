@@ -93,6 +93,32 @@ R_API_HIDDEN const RCryptoCipherInfo g__r_crypto_cipher_aes_256_cbc;
 R_API_HIDDEN const RCryptoCipherInfo g__r_crypto_cipher_aes_128_ctr;
 R_API_HIDDEN const RCryptoCipherInfo g__r_crypto_cipher_aes_192_ctr;
 R_API_HIDDEN const RCryptoCipherInfo g__r_crypto_cipher_aes_256_ctr;
+R_API_HIDDEN const RCryptoCipherInfo g__r_crypto_cipher_aes_128_gcm;
+R_API_HIDDEN const RCryptoCipherInfo g__r_crypto_cipher_aes_192_gcm;
+R_API_HIDDEN const RCryptoCipherInfo g__r_crypto_cipher_aes_256_gcm;
+
+/* AES-NI backend (raes-x86.c), operating on the portable key schedules */
+R_API_HIDDEN rboolean r_aes_x86_available (void);
+R_API_HIDDEN void r_aes_x86_encrypt_block (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src);
+R_API_HIDDEN void r_aes_x86_decrypt_block (const ruint32 * drk, ruint rounds,
+    ruint8 * dst, const ruint8 * src);
+R_API_HIDDEN void r_aes_x86_ecb_encrypt (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks);
+R_API_HIDDEN void r_aes_x86_ecb_decrypt (const ruint32 * drk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks);
+R_API_HIDDEN void r_aes_x86_cbc_encrypt (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks, ruint8 * iv);
+R_API_HIDDEN void r_aes_x86_cbc_decrypt (const ruint32 * drk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize blocks, ruint8 * iv);
+R_API_HIDDEN void r_aes_x86_ctr_crypt (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize size, ruint8 * iv);
+/* GHASH with PCLMULQDQ and the GCM 32 bit counter mode */
+R_API_HIDDEN rboolean r_aes_x86_clmul_available (void);
+R_API_HIDDEN void r_aes_x86_ghash (const ruint8 * h, ruint8 * y,
+    const ruint8 * data, rsize size);
+R_API_HIDDEN void r_aes_x86_gcm_ctr (const ruint32 * erk, ruint rounds,
+    ruint8 * dst, const ruint8 * src, rsize size, const ruint8 * icb);
 
 R_END_DECLS
 
@@ -22,38 +22,59 @@
 #include <rlib/rmem.h>
 #include <rlib/rstr.h>
 
+/* Messages per r_msg_digest_compute_multi round in r_hmac_compute_multi */
+#define R_HMAC_MULTI_BATCH    16
+
 struct _RHmac {
   RMsgDigest * inner;
   RMsgDigest * outer;
-  ruint32 * keyblock;
-  rsize blocksize;
+  /* Digests of the padded key blocks, restored on reset */
+  RMsgDigest * innermid;
+  RMsgDigest * outermid;
 };
 
 RHmac *
 r_hmac_new (RMsgDigestType type, rconstpointer key, rsize keysize)
 {
   RHmac * hmac;
+  ruint32 * keyblock;
+  rsize blocksize, i;
 
-  if ((hmac = r_mem_new (RHmac)) != NULL) {
+  if ((blocksize = r_msg_digest_type_blocksize (type)) == 0)
+    return NULL;
+
+  if ((hmac = r_mem_new0 (RHmac)) != NULL) {
+    keyblock = r_alloca0 (blocksize);
     hmac->inner = r_msg_digest_new (type);
     hmac->outer = r_msg_digest_new (type);
-    hmac->blocksize = r_msg_digest_blocksize (hmac->inner);
-    hmac->keyblock = r_malloc0 (hmac->blocksize);
 
-    if (hmac->inner == NULL || hmac->outer == NULL ||
-        hmac->blocksize == 0 || hmac->keyblock == NULL) {
+    if (hmac->inner == NULL || hmac->outer == NULL) {
       r_hmac_free (hmac);
       return NULL;
     }
 
-    if (keysize > hmac->blocksize) {
+    if (keysize > blocksize) {
       r_msg_digest_update (hmac->inner, key, keysize);
-      r_msg_digest_get_data (hmac->inner, (ruint8 *)hmac->keyblock, keysize, NULL);
+      r_msg_digest_get_data (hmac->inner, (ruint8 *)keyblock, blocksize, NULL);
+      r_msg_digest_reset (hmac->inner);
     } else {
-      r_memcpy (hmac->keyblock, key, keysize);
+      r_memcpy (keyblock, key, keysize);
     }
 
-    r_hmac_reset (hmac);
+    for (i = 0; i < blocksize / sizeof (ruint32); i++)
+      keyblock[i] ^= 0x36363636;
+    r_msg_digest_update (hmac->inner, keyblock, blocksize);
+
+    for (i = 0; i < blocksize / sizeof (ruint32); i++)
+      keyblock[i] ^= 0x36363636 ^ 0x5c5c5c5c;
+    r_msg_digest_update (hmac->outer, keyblock, blocksize);
+    r_memclear (keyblock, blocksize);
+
+    if ((hmac->innermid = r_msg_digest_clone (hmac->inner)) == NULL ||
+        (hmac->outermid = r_msg_digest_clone (hmac->outer)) == NULL) {
+      r_hmac_free (hmac);
+      return NULL;
+    }
   }
 
   return hmac;
@@ -65,7 +86,8 @@ r_hmac_free (RHmac * hmac)
   if (hmac != NULL) {
     r_msg_digest_free (hmac->inner);
     r_msg_digest_free (hmac->outer);
-    r_free (hmac->keyblock);
+    r_msg_digest_free (hmac->innermid);
+    r_msg_digest_free (hmac->outermid);
     r_free (hmac);
   }
 }
@@ -79,22 +101,10 @@ r_hmac_size (const RHmac * hmac)
 void
 r_hmac_reset (RHmac * hmac)
 {
-  rsize i;
-  ruint32 * block = r_alloca (hmac->blocksize);
-
-  r_msg_digest_reset (hmac->inner);
-  r_msg_digest_reset (hmac->outer);
-
-  for (i = 0; i < hmac->blocksize / sizeof (ruint32); i++)
-    block[i] = hmac->keyblock[i] ^ 0x36363636;
-  r_msg_digest_update (hmac->inner, block, hmac->blocksize);
-
-  for (i = 0; i < hmac->blocksize / sizeof (ruint32); i++)
-    block[i] = hmac->keyblock[i] ^ 0x5c5c5c5c;
-  r_msg_digest_update (hmac->outer, block, hmac->blocksize);
+  r_msg_digest_copy (hmac->inner, hmac->innermid);
+  r_msg_digest_copy (hmac->outer, hmac->outermid);
 }
 
-
 rboolean
 r_hmac_update (RHmac * hmac, rconstpointer data, rsize size)
 {
@@ -130,3 +140,49 @@ r_hmac_get_hex (RHmac * hmac)
   return NULL;
 }
 
+rboolean
+r_hmac_compute_iov (RHmac * hmac, const RMemChunk * iov, rsize count,
+    ruint8 * data, rsize size, rsize * out)
+{
+  rsize i;
+
+  if (R_UNLIKELY (hmac == NULL || (iov == NULL && count > 0)))
+    return FALSE;
+
+  r_hmac_reset (hmac);
+  for (i = 0; i < count; i++) {
+    if (!r_msg_digest_update (hmac->inner, iov[i].data, iov[i].size))
+      return FALSE;
+  }
+
+  return r_hmac_get_data (hmac, data, size, out);
+}
+
+rboolean
+r_hmac_compute_multi (RHmac * hmac, const RMemChunk * msgs, rsize count,
+    ruint8 * data, rsize size)
+{
+  ruint8 inner[R_HMAC_MULTI_BATCH * 64];
+  RMemChunk chunks[R_HMAC_MULTI_BATCH];
+  rsize i, n, mdsize;
+
+  if (R_UNLIKELY (hmac == NULL || data == NULL))
+    return FALSE;
+  mdsize = r_msg_digest_size (hmac->inner);
+  if (R_UNLIKELY (mdsize == 0 || size / mdsize < count))
+    return FALSE;
+
+  for (; count > 0; count -= n, msgs += n, data += n * mdsize, size -= n * mdsize) {
+    n = MIN (count, R_HMAC_MULTI_BATCH);
+    if (!r_msg_digest_compute_multi (hmac->innermid, msgs, n, inner, sizeof (inner)))
+      return FALSE;
+    for (i = 0; i < n; i++) {
+      chunks[i].data = inner + i * mdsize;
+      chunks[i].size = mdsize;
+    }
+    if (!r_msg_digest_compute_multi (hmac->outermid, chunks, n, data, size))
+      return FALSE;
+  }
+
+  return TRUE;
+}
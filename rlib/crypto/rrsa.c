@@ -18,6 +18,7 @@
 
 #include "config.h"
 #include "rcrypto-private.h"
+#include "../data/rmpint-private.h"
 
 #include <rlib/crypto/rrsa.h>
 
@@ -33,6 +34,8 @@ typedef struct {
 
   rmpint n;
   rmpint e;
+
+  RMpintMontCtx mont;
 } RRsaPubKey;
 
 typedef struct {
@@ -47,6 +50,11 @@ typedef struct {
   rmpint dp;
   rmpint dq;
   rmpint qp;
+
+  /* Set up when all CRT parameters are present and consistent */
+  rboolean crt;
+  RMpintMontCtx mont_p;
+  RMpintMontCtx mont_q;
 } RRsaPrivKey;
 
 static RCryptoResult
@@ -174,11 +182,47 @@ r_rsa_pub_key_free (rpointer data)
   if ((key = data) != NULL) {
     r_mpint_clear (&key->n);
     r_mpint_clear (&key->e);
+    r_mpint_montgomery_ctx_clear (&key->mont);
     r_crypto_key_destroy ((RCryptoKey *)key);
     r_free (key);
   }
 }
 
+static void
+r_rsa_pub_key_setup (RRsaPubKey * key)
+{
+  /* An even modulus is no RSA key, operations will fail */
+  r_mpint_montgomery_ctx_init (&key->mont, &key->n);
+}
+
+static void
+r_rsa_priv_key_setup (RRsaPrivKey * key)
+{
+  rmpint pq;
+
+  r_rsa_pub_key_setup (&key->pub);
+
+  r_memset (&key->mont_p, 0, sizeof (RMpintMontCtx));
+  r_memset (&key->mont_q, 0, sizeof (RMpintMontCtx));
+  key->crt = FALSE;
+
+  if (r_mpint_iszero (&key->p) || r_mpint_iszero (&key->q) ||
+      r_mpint_iszero (&key->dp) || r_mpint_iszero (&key->dq) ||
+      r_mpint_iszero (&key->qp))
+    return;
+
+  r_mpint_init (&pq);
+  if (r_mpint_mul (&pq, &key->p, &key->q) && r_mpint_cmp (&pq, &key->pub.n) == 0 &&
+      r_mpint_montgomery_ctx_init (&key->mont_p, &key->p) &&
+      r_mpint_montgomery_ctx_init (&key->mont_q, &key->q)) {
+    key->crt = TRUE;
+  } else {
+    r_mpint_montgomery_ctx_clear (&key->mont_p);
+    r_mpint_montgomery_ctx_clear (&key->mont_q);
+  }
+  r_mpint_clear (&pq);
+}
+
 static void
 r_rsa_pub_key_init (RCryptoKey * key, ruint bits)
 {
@@ -205,6 +249,8 @@ r_rsa_priv_key_free (rpointer data)
     r_mpint_clear (&key->dp);
     r_mpint_clear (&key->dq);
     r_mpint_clear (&key->qp);
+    r_mpint_montgomery_ctx_clear (&key->mont_p);
+    r_mpint_montgomery_ctx_clear (&key->mont_q);
 
     r_rsa_pub_key_free (data);
   }
@@ -235,6 +281,7 @@ r_rsa_pub_key_new (const rmpint * n, const rmpint * e)
       r_mpint_init_copy (&ret->e, e);
       ret->padding = R_RSA_PADDING_PKCS1_V15;
       r_rsa_pub_key_init (&ret->key, r_mpint_bits_used (&ret->n));
+      r_rsa_pub_key_setup (ret);
     }
   } else {
     ret = NULL;
@@ -255,6 +302,7 @@ r_rsa_pub_key_new_binary (rconstpointer n, rsize nsize,
       r_mpint_init_binary (&ret->e, e, esize);
       ret->padding = R_RSA_PADDING_PKCS1_V15;
       r_rsa_pub_key_init (&ret->key, r_mpint_bits_used (&ret->n));
+      r_rsa_pub_key_setup (ret);
     }
   } else {
     ret = NULL;
@@ -280,6 +328,7 @@ r_rsa_priv_key_new (const rmpint * n, const rmpint * e, const rmpint * d)
       r_mpint_init (&ret->qp);
       ret->pub.padding = R_RSA_PADDING_PKCS1_V15;
       r_rsa_priv_key_init (&ret->pub.key, r_mpint_bits_used (&ret->pub.n));
+      r_rsa_priv_key_setup (ret);
     }
   } else {
     ret = NULL;
@@ -296,7 +345,7 @@ r_rsa_priv_key_new_full (rint32 ver, const rmpint * n, const rmpint * e,
   RRsaPrivKey * ret;
 
   if (n != NULL && e != NULL && d != NULL) {
-    if ((ret = r_mem_new (RRsaPrivKey)) != NULL) {
+    if ((ret = r_mem_new0 (RRsaPrivKey)) != NULL) {
       ret->ver = ver;
       r_mpint_init_copy (&ret->pub.n, n);
       r_mpint_init_copy (&ret->pub.e, e);
@@ -313,6 +362,7 @@ r_rsa_priv_key_new_full (rint32 ver, const rmpint * n, const rmpint * e,
       else            r_mpint_init (&ret->qp);
       ret->pub.padding = R_RSA_PADDING_PKCS1_V15;
       r_rsa_priv_key_init (&ret->pub.key, r_mpint_bits_used (&ret->pub.n));
+      r_rsa_priv_key_setup (ret);
     }
   } else {
     ret = NULL;
@@ -339,6 +389,7 @@ r_rsa_priv_key_new_binary (rconstpointer n, rsize nsize,
       r_mpint_init (&ret->qp);
       ret->pub.padding = R_RSA_PADDING_PKCS1_V15;
       r_rsa_priv_key_init (&ret->pub.key, r_mpint_bits_used (&ret->pub.n));
+      r_rsa_priv_key_setup (ret);
     }
   } else {
     ret = NULL;
@@ -352,7 +403,7 @@ r_rsa_priv_key_new_from_asn1 (RAsn1BinDecoder * dec, RAsn1BinTLV * tlv)
 {
   RRsaPrivKey * ret;
 
-  if ((ret = r_mem_new (RRsaPrivKey)) != NULL) {
+  if ((ret = r_mem_new0 (RRsaPrivKey)) != NULL) {
 
     r_mpint_init (&ret->pub.n);
     r_mpint_init (&ret->pub.e);
@@ -386,6 +437,7 @@ r_rsa_priv_key_new_from_asn1 (RAsn1BinDecoder * dec, RAsn1BinTLV * tlv)
     } else {
       ret->pub.padding = R_RSA_PADDING_PKCS1_V15;
       r_rsa_priv_key_init (&ret->pub.key, r_mpint_bits_used (&ret->pub.n));
+      r_rsa_priv_key_setup (ret);
     }
   }
 
@@ -461,6 +513,7 @@ r_rsa_priv_key_new_gen (rsize bits, ruint64 e, RPrng * prng)
       r_mpint_invmod (&ret->d, &ret->pub.e, &p_1mulq_1);  /* d  = e^-1 mod ((p - 1) * (q - 1)) */
       r_mpint_mod (&ret->dp, &ret->d, &p_1);              /* dp = d mod (p - 1) */
       r_mpint_mod (&ret->dq, &ret->d, &q_1);              /* dq = d mod (q - 1) */
+      r_rsa_priv_key_setup (ret);
     } else {
       r_crypto_key_unref (ret);
       ret = NULL;
@@ -591,7 +644,7 @@ r_rsa_raw_encrypt_internal (const RRsaPubKey * key,
   rsize k;
   rmpint c, m;
 
-  k = r_mpint_digits_used (&key->n) * sizeof (rmpint_digit);
+  k = r_mpint_bytes_used (&key->n);
   if (size != k)
     return R_CRYPTO_INVAL;
 
@@ -603,7 +656,7 @@ r_rsa_raw_encrypt_internal (const RRsaPubKey * key,
 
   r_mpint_init_size (&c, r_mpint_digits_used (&key->n));
 
-  ret = r_mpint_expmod (&c, &m, &key->e, &key->n) &&
+  ret = r_mpint_expmod_montgomery (&c, &m, &key->e, &key->mont) &&
     r_mpint_to_binary_with_size (&c, out, k);
 
   r_mpint_clear (&m);
@@ -632,6 +685,39 @@ r_rsa_raw_encrypt (const RCryptoKey * key, RPrng * prng,
   return ret;
 }
 
+/* m = c^d mod n by the chinese remainder theorem (RFC 8017 5.1.2) with two
+ * half size exponentiations. The result is checked with the public exponent
+ * so a faulty computation never leaks the factors (Boneh, DeMillo, Lipton). */
+static rboolean
+r_rsa_priv_key_expmod_crt (const RRsaPrivKey * key, rmpint * m, const rmpint * c)
+{
+  rmpint m1, m2, h;
+  rboolean ret;
+
+  r_mpint_init_size (&m1, r_mpint_digits_used (&key->p));
+  r_mpint_init_size (&m2, r_mpint_digits_used (&key->q));
+  r_mpint_init_size (&h, r_mpint_digits_used (&key->pub.n));
+
+  /* m1 = c^dp mod p, m2 = c^dq mod q and h = qp * (m1 - m2) mod p */
+  ret = r_mpint_expmod_montgomery (&m1, c, &key->dp, &key->mont_p) &&
+    r_mpint_expmod_montgomery (&m2, c, &key->dq, &key->mont_q) &&
+    r_mpint_mod (&h, &m2, &key->p);
+  if (ret && r_mpint_ucmp (&m1, &h) < 0)
+    ret = r_mpint_add (&m1, &m1, &key->p);
+  ret = ret && r_mpint_sub (&h, &m1, &h) &&
+    r_mpint_mulmod (&h, &h, &key->qp, &key->p) &&
+    /* m = m2 + q * h */
+    r_mpint_mul (&h, &h, &key->q) &&
+    r_mpint_add (m, &m2, &h) &&
+    r_mpint_expmod_montgomery (&m1, m, &key->pub.e, &key->pub.mont) &&
+    r_mpint_cmp (&m1, c) == 0;
+
+  r_mpint_clear (&m1);
+  r_mpint_clear (&m2);
+  r_mpint_clear (&h);
+  return ret;
+}
+
 static RCryptoResult
 r_rsa_raw_decrypt_internal (const RRsaPrivKey * key,
     rconstpointer data, ruint8 * out, rsize size)
@@ -640,7 +726,7 @@ r_rsa_raw_decrypt_internal (const RRsaPrivKey * key,
   rsize k;
   rmpint c, m;
 
-  k = r_mpint_digits_used (&key->pub.n) * sizeof (rmpint_digit);
+  k = r_mpint_bytes_used (&key->pub.n);
   if (size != k)
     return R_CRYPTO_INVAL;
 
@@ -652,9 +738,11 @@ r_rsa_raw_decrypt_internal (const RRsaPrivKey * key,
 
   r_mpint_init_size (&m, r_mpint_digits_used (&key->pub.n));
 
-  /* FIXME: implement... faster mode when we have q, p, dQ, dP and qInv */
-  ret = r_mpint_expmod (&m, &c, &key->d, &key->pub.n) &&
-    r_mpint_to_binary_with_size (&m, out, k);
+  if (key->crt && r_mpint_ucmp (&c, &key->pub.n) < 0)
+    ret = r_rsa_priv_key_expmod_crt (key, &m, &c);
+  else
+    ret = r_mpint_expmod_montgomery (&m, &c, &key->d, &key->pub.mont);
+  ret = ret && r_mpint_to_binary_with_size (&m, out, k);
 
   r_mpint_clear (&m);
   r_mpint_clear (&c);
@@ -696,7 +784,7 @@ r_rsa_pkcs1v1_5_encrypt (const RCryptoKey * key, RPrng * prng,
   if (R_UNLIKELY (data == NULL)) return R_CRYPTO_INVAL;
   if (R_UNLIKELY (out == NULL || outsize == NULL)) return R_CRYPTO_INVAL;
 
-  k = r_mpint_digits_used (&((const RRsaPrivKey*)key)->pub.n) * sizeof (rmpint_digit);
+  k = r_mpint_bytes_used (&((const RRsaPrivKey*)key)->pub.n);
   if (size > k - 11 || *outsize < k)
     return R_CRYPTO_WRONG_SIZE;
 
@@ -727,7 +815,7 @@ r_rsa_pkcs1v1_5_decrypt (const RCryptoKey * key,
 
   if (R_UNLIKELY (data == NULL || out == NULL || outsize == NULL))
     return R_CRYPTO_INVAL;
-  if (size != r_mpint_digits_used (&((const RRsaPrivKey*)key)->pub.n) * sizeof (rmpint_digit))
+  if (size != r_mpint_bytes_used (&((const RRsaPrivKey*)key)->pub.n))
     return R_CRYPTO_WRONG_SIZE;
 
   buffer = (*outsize >= size) ? out : r_alloca (size);
@@ -25,6 +25,12 @@
 
 /* This list should be sorted on preference! */
 static const RSRTPCipherSuiteInfo g__r_srtp_cipher_suites[] = {
+  { R_SRTP_CS_AEAD_AES_128_GCM, "SRTP-AEAD-AES-128-GCM",
+    &g__r_crypto_cipher_aes_128_gcm, 96, R_MSG_DIGEST_TYPE_NONE, 0, 128, 128,
+    &g__r_crypto_cipher_aes_128_ctr },
+  { R_SRTP_CS_AEAD_AES_256_GCM, "SRTP-AEAD-AES-256-GCM",
+    &g__r_crypto_cipher_aes_256_gcm, 96, R_MSG_DIGEST_TYPE_NONE, 0, 128, 128,
+    &g__r_crypto_cipher_aes_256_ctr },
   { R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, "SRTP-AES-128-CM-HMAC-SHA1-80",
     &g__r_crypto_cipher_aes_128_ctr, 112, R_MSG_DIGEST_TYPE_SHA1, 0, 80, 80,
     &g__r_crypto_cipher_aes_128_ctr },
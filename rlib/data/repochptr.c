@@ -0,0 +1,244 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include <rlib/data/repochptr.h>
+
+#include <rlib/data/rlist.h>
+
+#include <rlib/rassert.h>
+#include <rlib/rmem.h>
+#include <rlib/rthreads.h>
+
+/* The global epoch moves in steps of two, leaving the lowest bit to mark
+ * a record as active in the epoch it holds */
+#define R_EPOCH_PTR_ACTIVE    1
+#define R_EPOCH_PTR_STEP      2
+/* Pointers retired between each try to advance the epoch */
+#define R_EPOCH_PTR_BATCH     64
+
+static raptr        g__r_epochptr; /* (REpochPtrRec *) */
+static rauint       g__r_epochptr_epoch;
+static RTss         g__r_epochptr_tss = R_TSS_INIT (r_epoch_ptr_rec_free);
+
+/* Pointers retired in epoch */
+typedef struct {
+  RFreePtrCtx * ptrs;
+  rsize count, alloc;
+  ruint epoch;
+} REpochPtrBucket;
+
+struct _REpochPtrRec {
+  rauint epoch;
+  ruint nesting;
+  raint active;
+
+  /* A pointer retired in epoch e is safe to free once the global epoch has
+   * advanced twice, so the bucket for e is reused in e + 3 */
+  REpochPtrBucket bucket[3];
+  ruint retires;
+
+  REpochPtrRec * next;
+};
+
+
+static REpochPtrRec *
+r_epoch_ptr_rec_get (void)
+{
+  REpochPtrRec * rec;
+
+  if ((rec = r_tss_get (&g__r_epochptr_tss)) == NULL)
+    r_tss_set (&g__r_epochptr_tss, (rec = r_epoch_ptr_rec_new ()));
+
+  return rec;
+}
+
+rpointer
+r_epoch_ptr_aqcuire (repochptr * epochptr, REpochPtrRec * rec)
+{
+  if (rec == NULL)
+    rec = r_epoch_ptr_rec_get ();
+
+  if (rec->nesting++ == 0) {
+    r_atomic_uint_store (&rec->epoch,
+        r_atomic_uint_load (&g__r_epochptr_epoch) | R_EPOCH_PTR_ACTIVE);
+  }
+
+  return r_atomic_ptr_load (&epochptr->ptr);
+}
+
+void
+r_epoch_ptr_release (repochptr * epochptr, REpochPtrRec * rec)
+{
+  (void)epochptr;
+
+  if (rec == NULL) {
+    rec = r_tss_get (&g__r_epochptr_tss);
+    r_assert_cmpptr (rec, !=, NULL);
+  }
+
+  r_assert_cmpuint (rec->nesting, >, 0);
+  if (--rec->nesting == 0)
+    r_atomic_uint_store (&rec->epoch, 0);
+}
+
+static void
+r_epoch_ptr_bucket_free (REpochPtrBucket * bucket)
+{
+  RFreePtrCtx * ptrs = bucket->ptrs;
+  rsize i, count = bucket->count, alloc = bucket->alloc;
+
+  /* Detach first, the notifies might retire more pointers */
+  bucket->ptrs = NULL;
+  bucket->count = bucket->alloc = 0;
+
+  for (i = 0; i < count; i++) {
+    if (ptrs[i].notify != NULL)
+      ptrs[i].notify (ptrs[i].ptr);
+  }
+
+  if (bucket->ptrs == NULL) {
+    bucket->ptrs = ptrs;
+    bucket->alloc = alloc;
+  } else {
+    r_free (ptrs);
+  }
+}
+
+static ruint
+r_epoch_ptr_try_advance (void)
+{
+  ruint epoch = r_atomic_uint_load (&g__r_epochptr_epoch), e;
+  REpochPtrRec * it;
+
+  for (it = r_atomic_ptr_load (&g__r_epochptr); it != NULL; it = it->next) {
+    e = r_atomic_uint_load (&it->epoch);
+    if ((e & R_EPOCH_PTR_ACTIVE) && (e & ~R_EPOCH_PTR_ACTIVE) != epoch)
+      return epoch;
+  }
+
+  /* Failing means some other thread advanced it, which is just as good */
+  if (r_atomic_uint_cmp_xchg_strong (&g__r_epochptr_epoch, &epoch, epoch + R_EPOCH_PTR_STEP))
+    epoch += R_EPOCH_PTR_STEP;
+  return epoch;
+}
+
+static rsize
+r_epoch_ptr_rec_collect (REpochPtrRec * rec, ruint epoch)
+{
+  rsize ret = 0;
+  ruint i;
+
+  for (i = 0; i < R_N_ELEMENTS (rec->bucket); i++) {
+    REpochPtrBucket * bucket = &rec->bucket[i];
+    if (bucket->count > 0 && epoch - bucket->epoch >= 2 * R_EPOCH_PTR_STEP)
+      r_epoch_ptr_bucket_free (bucket);
+    ret += bucket->count;
+  }
+
+  return ret;
+}
+
+void
+r_epoch_ptr_replace (repochptr * epochptr, rpointer ptr)
+{
+  REpochPtrRec * rec;
+  REpochPtrBucket * bucket;
+  rpointer retired;
+  ruint epoch;
+
+  rec = r_epoch_ptr_rec_get ();
+
+  if ((retired = r_atomic_ptr_exchange (&epochptr->ptr, ptr)) == NULL)
+    return;
+
+  epoch = r_atomic_uint_load (&g__r_epochptr_epoch);
+  bucket = &rec->bucket[(epoch / R_EPOCH_PTR_STEP) % R_N_ELEMENTS (rec->bucket)];
+  if (bucket->epoch != epoch) {
+    /* Retired three epochs ago or more */
+    bucket->epoch = epoch;
+    r_epoch_ptr_bucket_free (bucket);
+  }
+
+  if (R_UNLIKELY (bucket->count == bucket->alloc)) {
+    rsize alloc = MAX (bucket->alloc * 2, R_EPOCH_PTR_BATCH);
+    RFreePtrCtx * ptrs;
+
+    if ((ptrs = r_realloc (bucket->ptrs, alloc * sizeof (RFreePtrCtx))) == NULL)
+      return; /* Out of memory, leaking is all we can do */
+    bucket->ptrs = ptrs;
+    bucket->alloc = alloc;
+  }
+  bucket->ptrs[bucket->count].ptr = retired;
+  bucket->ptrs[bucket->count].notify = epochptr->notify;
+  bucket->count++;
+
+  if (++rec->retires >= R_EPOCH_PTR_BATCH) {
+    rec->retires = 0;
+    r_epoch_ptr_rec_collect (rec, r_epoch_ptr_try_advance ());
+  }
+}
+
+rsize
+r_epoch_ptr_reclaim (REpochPtrRec * rec)
+{
+  if (rec == NULL)
+    rec = r_epoch_ptr_rec_get ();
+
+  /* Two steps make everything retired so far safe, unless someone is
+   * holding on to an older epoch */
+  r_epoch_ptr_try_advance ();
+  return r_epoch_ptr_rec_collect (rec, r_epoch_ptr_try_advance ());
+}
+
+REpochPtrRec *
+r_epoch_ptr_rec_new (void)
+{
+  REpochPtrRec * rec;
+  rpointer old;
+
+  for (rec = r_atomic_ptr_load (&g__r_epochptr); rec != NULL; rec = rec->next) {
+    int oa = FALSE;
+    if (r_atomic_int_cmp_xchg_strong (&rec->active, &oa, TRUE))
+      goto done;
+  }
+
+  if ((rec = r_mem_new0 (REpochPtrRec)) == NULL)
+    goto done;
+  rec->active = TRUE;
+
+  old = r_atomic_ptr_load (&g__r_epochptr);
+  do {
+    rec->next = old;
+  } while (!r_atomic_ptr_cmp_xchg_weak (&g__r_epochptr, &old, rec));
+
+done:
+  return rec;
+}
+
+void
+r_epoch_ptr_rec_free (REpochPtrRec * rec)
+{
+  if (rec != NULL) {
+    r_assert_cmpuint (rec->nesting, ==, 0);
+    /* Whatever is still retired is left for the next user of rec */
+    r_epoch_ptr_reclaim (rec);
+    r_atomic_int_store (&rec->active, FALSE);
+  }
+}
+
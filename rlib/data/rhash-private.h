@@ -24,11 +24,61 @@
 
 #include <rlib/rtypes.h>
 
-#define R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE(idx)     ((rsize)1 << (idx + 3))
+/* Open addressing core shared by RHashTable and RHashSet (rhashcore.c).
+ *
+ * Every slot has a control byte, kept in its own array so a probe reads
+ * R_HASH_GROUP_WIDTH of them with one SSE2 load. A full slot stores the
+ * low 7 bits of the mixed hash as its tag, so almost every mismatch is
+ * rejected without touching the slot. The rest of the hash picks the
+ * first group and probing is triangular over whole groups.
+ *
+ * Slots are slotsize bytes and start with the key pointer, the owner
+ * fills in the rest. Capacity is a power of two of at least
+ * R_HASH_CORE_MIN_CAPACITY and at most 7/8 of it is used. */
+#define R_HASH_GROUP_WIDTH          16
+#define R_HASH_CORE_MIN_CAPACITY    8
+
+#define R_HASH_CTRL_EMPTY           ((ruint8)0x80)
+#define R_HASH_CTRL_DELETED         ((ruint8)0xfe)
+#define R_HASH_CTRL_SENTINEL        ((ruint8)0xff)
+#define R_HASH_CTRL_IS_FULL(c)      (((c) & 0x80) == 0)
+
+typedef struct {
+  ruint8 * ctrl;
+  ruint8 * slots;
+  rsize mask;
+  rsize size;
+  rsize growth_left;
+  rsize slotsize;
+
+  RHashFunc hashfunc;
+  REqualFunc equalfunc;
+} RHashCore;
+
+#define R_HASH_CORE_CAPACITY(core)          ((core)->mask + 1)
+#define R_HASH_CORE_SLOT(core, idx)         ((rpointer)((core)->slots + (idx) * (core)->slotsize))
+#define R_HASH_CORE_SLOT_KEY(slot)          (*(rpointer *)(slot))
+#define R_HASH_CORE_IS_FULL(core, idx)      R_HASH_CTRL_IS_FULL ((core)->ctrl[idx])
 
 R_BEGIN_DECLS
 
-R_API_HIDDEN extern const rsize r_hash_size_primes[RLIB_SIZEOF_SIZE_T * 8 - 2];
+R_API_HIDDEN rboolean r_hash_core_init (RHashCore * core, rsize slotsize,
+    RHashFunc hash, REqualFunc equal);
+R_API_HIDDEN void r_hash_core_clear (RHashCore * core);
+
+/* Makes room for count entries without any further rehashing */
+R_API_HIDDEN rboolean r_hash_core_reserve (RHashCore * core, rsize count);
+
+/* Returns the slot holding key or NULL */
+R_API_HIDDEN rpointer r_hash_core_find (RHashCore * core, rconstpointer key);
+/* Returns the slot holding key, or claims a new one for it (found is set
+ * to FALSE and the key is written). NULL only when growing fails. */
+R_API_HIDDEN rpointer r_hash_core_insert (RHashCore * core, rconstpointer key,
+    rboolean * found);
+/* Frees a slot returned by find or insert, the other slots never move */
+R_API_HIDDEN void r_hash_core_erase (RHashCore * core, rpointer slot);
+/* Marks every slot empty, keeping the capacity */
+R_API_HIDDEN void r_hash_core_erase_all (RHashCore * core);
 
 R_END_DECLS
 
@@ -0,0 +1,311 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rhash-private.h"
+
+#include <rlib/data/rhashfuncs.h>
+
+#include <rlib/rmem.h>
+
+#if defined (__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define R_HASH_GROUP_SHIFT          4
+#define R_HASH_TAG(hash)            ((ruint8)((hash) & 0x7f))
+#define R_HASH_CORE_MAX_LOAD(cap)   ((cap) - (cap) / 8)
+
+/* Callers hand us r_direct_hash of small integers and aligned pointers,
+ * so every bit of the hash is mixed into both the tag and the group. */
+static inline rsize
+r_hash_core_mix (rsize hash)
+{
+#if RLIB_SIZEOF_SIZE_T >= 8
+  hash ^= hash >> 32;
+  hash *= RUINT64_CONSTANT (0xd6e8feb86659fd93);
+  hash ^= hash >> 32;
+  hash *= RUINT64_CONSTANT (0xd6e8feb86659fd93);
+  hash ^= hash >> 32;
+#else
+  hash ^= hash >> 16;
+  hash *= 0x7feb352d;
+  hash ^= hash >> 15;
+  hash *= 0x846ca68b;
+  hash ^= hash >> 16;
+#endif
+  return hash;
+}
+
+static inline rsize
+r_hash_core_hash (const RHashCore * core, rconstpointer key)
+{
+  return r_hash_core_mix (core->hashfunc (key));
+}
+
+/* Bit i of the returned masks is control byte i of the group */
+#if defined (__SSE2__)
+static inline ruint
+r_hash_group_match (const ruint8 * ctrl, ruint8 tag)
+{
+  __m128i g = _mm_loadu_si128 ((const __m128i *)ctrl);
+  return (ruint)_mm_movemask_epi8 (_mm_cmpeq_epi8 (g, _mm_set1_epi8 ((rchar)tag)));
+}
+
+/* EMPTY and DELETED are the only control bytes below SENTINEL as signed */
+static inline ruint
+r_hash_group_match_free (const ruint8 * ctrl)
+{
+  __m128i g = _mm_loadu_si128 ((const __m128i *)ctrl);
+  return (ruint)_mm_movemask_epi8 (_mm_cmpgt_epi8 (
+        _mm_set1_epi8 ((rchar)R_HASH_CTRL_SENTINEL), g));
+}
+#else
+static inline ruint
+r_hash_group_match (const ruint8 * ctrl, ruint8 tag)
+{
+  ruint i, ret = 0;
+  for (i = 0; i < R_HASH_GROUP_WIDTH; i++)
+    ret |= (ruint)(ctrl[i] == tag) << i;
+  return ret;
+}
+
+static inline ruint
+r_hash_group_match_free (const ruint8 * ctrl)
+{
+  ruint i, ret = 0;
+  for (i = 0; i < R_HASH_GROUP_WIDTH; i++)
+    ret |= (ruint)(ctrl[i] == R_HASH_CTRL_EMPTY || ctrl[i] == R_HASH_CTRL_DELETED) << i;
+  return ret;
+}
+#endif
+
+#define r_hash_group_match_empty(ctrl)  r_hash_group_match (ctrl, R_HASH_CTRL_EMPTY)
+
+static inline rboolean
+r_hash_core_key_equal (const RHashCore * core, rconstpointer a, rconstpointer b)
+{
+  return core->equalfunc == NULL ? a == b : core->equalfunc (a, b);
+}
+
+static void
+r_hash_core_reset_ctrl (RHashCore * core)
+{
+  rsize capacity = R_HASH_CORE_CAPACITY (core);
+
+  r_memset (core->ctrl, R_HASH_CTRL_EMPTY, capacity);
+  /* Tables smaller than a group are padded with bytes that never match */
+  if (capacity < R_HASH_GROUP_WIDTH) {
+    r_memset (core->ctrl + capacity, R_HASH_CTRL_SENTINEL,
+        R_HASH_GROUP_WIDTH - capacity);
+  }
+
+  core->size = 0;
+  core->growth_left = R_HASH_CORE_MAX_LOAD (capacity);
+}
+
+static rboolean
+r_hash_core_alloc (RHashCore * core, rsize capacity)
+{
+  rsize ctrlsize = MAX (capacity, R_HASH_GROUP_WIDTH);
+  ruint8 * mem;
+
+  if (R_UNLIKELY (capacity > (RSIZE_MAX - ctrlsize) / core->slotsize))
+    return FALSE;
+  if (R_UNLIKELY ((mem = r_malloc (ctrlsize + capacity * core->slotsize)) == NULL))
+    return FALSE;
+
+  core->ctrl = mem;
+  core->slots = mem + ctrlsize;
+  core->mask = capacity - 1;
+  r_hash_core_reset_ctrl (core);
+  return TRUE;
+}
+
+/* First EMPTY or DELETED slot along the probe sequence of hash */
+static rsize
+r_hash_core_find_free (const RHashCore * core, rsize hash)
+{
+  rsize gmask = core->mask >> R_HASH_GROUP_SHIFT;
+  rsize g = (hash >> 7) & gmask, step = 0;
+  ruint m;
+
+  while ((m = r_hash_group_match_free (core->ctrl + (g << R_HASH_GROUP_SHIFT))) == 0)
+    g = (g + ++step) & gmask;
+
+  return (g << R_HASH_GROUP_SHIFT) + RUINT_CTZ (m);
+}
+
+static inline rpointer
+r_hash_core_find_with_hash (RHashCore * core, rconstpointer key, rsize hash)
+{
+  rsize gmask = core->mask >> R_HASH_GROUP_SHIFT;
+  rsize g = (hash >> 7) & gmask, step = 0;
+  ruint8 tag = R_HASH_TAG (hash);
+
+  /* At least 1/8 of the slots are EMPTY, so every probe ends */
+  for (;;) {
+    const ruint8 * ctrl = core->ctrl + (g << R_HASH_GROUP_SHIFT);
+    ruint m;
+
+    for (m = r_hash_group_match (ctrl, tag); m != 0; m &= m - 1) {
+      rpointer slot = R_HASH_CORE_SLOT (core, (g << R_HASH_GROUP_SHIFT) + RUINT_CTZ (m));
+      if (r_hash_core_key_equal (core, key, R_HASH_CORE_SLOT_KEY (slot)))
+        return slot;
+    }
+
+    if (r_hash_group_match_empty (ctrl) != 0)
+      return NULL;
+
+    g = (g + ++step) & gmask;
+  }
+}
+
+static rboolean
+r_hash_core_resize (RHashCore * core, rsize capacity)
+{
+  ruint8 * ctrl = core->ctrl, * slots = core->slots;
+  rsize i, size = core->size, old = R_HASH_CORE_CAPACITY (core);
+
+  if (R_UNLIKELY (!r_hash_core_alloc (core, capacity)))
+    return FALSE;
+
+  for (i = 0; i < old; i++) {
+    rsize hash, idx;
+    rpointer src;
+
+    if (!R_HASH_CTRL_IS_FULL (ctrl[i]))
+      continue;
+
+    src = slots + i * core->slotsize;
+    hash = r_hash_core_hash (core, R_HASH_CORE_SLOT_KEY (src));
+    idx = r_hash_core_find_free (core, hash);
+    core->ctrl[idx] = R_HASH_TAG (hash);
+    r_memcpy (R_HASH_CORE_SLOT (core, idx), src, core->slotsize);
+  }
+
+  core->size = size;
+  core->growth_left -= size;
+  r_free (ctrl);
+  return TRUE;
+}
+
+rboolean
+r_hash_core_init (RHashCore * core, rsize slotsize,
+    RHashFunc hash, REqualFunc equal)
+{
+  core->slotsize = slotsize;
+  core->hashfunc = hash != NULL ? hash : r_direct_hash;
+  core->equalfunc = equal;
+
+  return r_hash_core_alloc (core, R_HASH_CORE_MIN_CAPACITY);
+}
+
+void
+r_hash_core_clear (RHashCore * core)
+{
+  r_free (core->ctrl);
+  core->ctrl = core->slots = NULL;
+  core->size = core->growth_left = 0;
+}
+
+rboolean
+r_hash_core_reserve (RHashCore * core, rsize count)
+{
+  rsize capacity = R_HASH_CORE_MIN_CAPACITY;
+
+  if (count <= core->size + core->growth_left)
+    return TRUE;
+
+  while (R_HASH_CORE_MAX_LOAD (capacity) < count) {
+    if (R_UNLIKELY (capacity > RSIZE_MAX / 2))
+      return FALSE;
+    capacity <<= 1;
+  }
+
+  /* Same capacity when count fits once the tombstones are gone */
+  return r_hash_core_resize (core, MAX (capacity, R_HASH_CORE_CAPACITY (core)));
+}
+
+rpointer
+r_hash_core_find (RHashCore * core, rconstpointer key)
+{
+  return r_hash_core_find_with_hash (core, key, r_hash_core_hash (core, key));
+}
+
+rpointer
+r_hash_core_insert (RHashCore * core, rconstpointer key, rboolean * found)
+{
+  rsize hash = r_hash_core_hash (core, key), idx;
+  rpointer slot;
+
+  if ((slot = r_hash_core_find_with_hash (core, key, hash)) != NULL) {
+    *found = TRUE;
+    return slot;
+  }
+
+  idx = r_hash_core_find_free (core, hash);
+  if (R_UNLIKELY (core->growth_left == 0 && core->ctrl[idx] == R_HASH_CTRL_EMPTY)) {
+    rsize capacity = R_HASH_CORE_CAPACITY (core);
+
+    /* Mostly tombstones means rehashing in place is enough */
+    if (core->size >= R_HASH_CORE_MAX_LOAD (capacity) / 2) {
+      if (R_UNLIKELY (capacity > RSIZE_MAX / 2))
+        return NULL;
+      capacity <<= 1;
+    }
+    if (R_UNLIKELY (!r_hash_core_resize (core, capacity)))
+      return NULL;
+
+    idx = r_hash_core_find_free (core, hash);
+  }
+
+  if (core->ctrl[idx] == R_HASH_CTRL_EMPTY)
+    core->growth_left--;
+  core->ctrl[idx] = R_HASH_TAG (hash);
+  core->size++;
+
+  slot = R_HASH_CORE_SLOT (core, idx);
+  R_HASH_CORE_SLOT_KEY (slot) = (rpointer)key;
+  *found = FALSE;
+  return slot;
+}
+
+void
+r_hash_core_erase (RHashCore * core, rpointer slot)
+{
+  rsize idx = (rsize)((ruint8 *)slot - core->slots) / core->slotsize;
+
+  /* A probe only walks past a group without EMPTY slots, so if this group
+   * has one no other key can depend on this slot staying occupied. */
+  if (r_hash_group_match_empty (core->ctrl + (idx & ~(rsize)(R_HASH_GROUP_WIDTH - 1))) != 0) {
+    core->ctrl[idx] = R_HASH_CTRL_EMPTY;
+    core->growth_left++;
+  } else {
+    core->ctrl[idx] = R_HASH_CTRL_DELETED;
+  }
+
+  core->size--;
+}
+
+void
+r_hash_core_erase_all (RHashCore * core)
+{
+  r_hash_core_reset_ctrl (core);
+}
+
@@ -25,66 +25,34 @@
 
 typedef struct {
   rpointer item;
-  rsize hash;
-} RHashSetBucket;
+} RHashSetSlot;
 
 struct _RHashSet {
   RRef ref;
 
-  rsize size;
-  ruint8 allocidx;
-  RHashSetBucket * buckets;
+  RHashCore core;
 
-  RHashFunc hashfunc;
-  REqualFunc equalfunc;
   RDestroyNotify notify;
 };
 
 static void
-r_hash_set_free (RHashSet * hs)
+r_hash_set_notify_all (RHashSet * hs)
 {
   if (hs->notify != NULL) {
-    rsize i, c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
+    rsize i, c = R_HASH_CORE_CAPACITY (&hs->core);
     for (i = 0; i < c; i++) {
-      if (hs->buckets[i].hash != R_HASH_EMPTY)
-        hs->notify (hs->buckets[i].item);
+      if (R_HASH_CORE_IS_FULL (&hs->core, i))
+        hs->notify (((RHashSetSlot *)R_HASH_CORE_SLOT (&hs->core, i))->item);
     }
   }
-
-  r_free (hs->buckets);
-  r_free (hs);
 }
 
 static void
-r_hash_set_resize (RHashSet * hs, ruint8 allocidx)
+r_hash_set_free (RHashSet * hs)
 {
-  RHashSetBucket * buckets = hs->buckets;
-  rsize i, size;
-
-  size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (allocidx);
-  hs->buckets = r_mem_new_n (RHashSetBucket, size);
-  for (i = 0; i < size; i++)
-    hs->buckets[i].hash = R_HASH_EMPTY;
-
-  size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
-  hs->allocidx = allocidx;
-
-  for (i = 0; i < size; i++) {
-    rsize idx, step = 0;
-
-    if (buckets[i].hash == R_HASH_EMPTY)
-      continue;
-
-    idx = buckets[i].hash % r_hash_size_primes[hs->allocidx];
-    while (hs->buckets[idx].hash != R_HASH_EMPTY) {
-      idx += ++step;
-      idx &= (R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx) - 1);
-    }
-
-    hs->buckets[idx] = buckets[i];
-  }
-
-  r_free (buckets);
+  r_hash_set_notify_all (hs);
+  r_hash_core_clear (&hs->core);
+  r_free (hs);
 }
 
 RHashSet *
@@ -93,17 +61,13 @@ r_hash_set_new_full (RHashFunc hash, REqualFunc equal, RDestroyNotify notify)
   RHashSet * ret;
 
   if ((ret = r_mem_new (RHashSet)) != NULL) {
-    rsize i, size;
-    r_ref_init (ret, r_hash_set_free);
+    if (R_UNLIKELY (!r_hash_core_init (&ret->core, sizeof (RHashSetSlot),
+            hash, equal))) {
+      r_free (ret);
+      return NULL;
+    }
 
-    ret->size = 0;
-    ret->allocidx = 0;
-    size = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (ret->allocidx);
-    ret->buckets = r_mem_new_n (RHashSetBucket, size);
-    for (i = 0; i < size; i++)
-      ret->buckets[i].hash = R_HASH_EMPTY;
-    ret->hashfunc = hash != NULL ? hash : r_direct_hash;
-    ret->equalfunc = equal;
+    r_ref_init (ret, r_hash_set_free);
     ret->notify = notify;
   }
 
@@ -113,92 +77,60 @@ r_hash_set_new_full (RHashFunc hash, REqualFunc equal, RDestroyNotify notify)
 rsize
 r_hash_set_size (RHashSet * hs)
 {
-  return hs->size;
+  return hs->core.size;
 }
 
 rsize
 r_hash_set_current_alloc_size (RHashSet * hs)
 {
-  return R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
-}
-
-static inline rsize
-r_hash_set_hash (RHashSet * hs, rconstpointer item)
-{
-  rsize ret = hs->hashfunc (item);
-  if (R_UNLIKELY (ret == R_HASH_EMPTY))
-    ret++;
-  return ret;
+  return R_HASH_CORE_CAPACITY (&hs->core);
 }
 
-static rsize
-r_hash_set_lookup_bucket (RHashSet * hs, rconstpointer item, rsize * hash)
+rboolean
+r_hash_set_reserve (RHashSet * hs, rsize count)
 {
-  rsize idx, step = 0;
-
-  *hash = r_hash_set_hash (hs, item);
-  idx = *hash % r_hash_size_primes[hs->allocidx];
-
-  while (hs->buckets[idx].hash != R_HASH_EMPTY) {
-    if (hs->buckets[idx].hash == *hash) {
-      if ((hs->equalfunc == NULL && item == hs->buckets[idx].item) ||
-          hs->equalfunc (item, hs->buckets[idx].item))
-        break;
-    }
-
-    idx += ++step;
-    idx &= (R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx) - 1);
-  }
+  if (R_UNLIKELY (hs == NULL)) return FALSE;
 
-  return idx;
+  return r_hash_core_reserve (&hs->core, count);
 }
 
 rboolean
 r_hash_set_insert (RHashSet * hs, rpointer item)
 {
-  rsize idx, hash;
+  RHashSetSlot * slot;
+  rboolean found;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
 
-  if (hs->size >= R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx))
-    r_hash_set_resize (hs, hs->allocidx + 1);
+  if (R_UNLIKELY ((slot = r_hash_core_insert (&hs->core, item, &found)) == NULL))
+    return FALSE;
 
-  idx = r_hash_set_lookup_bucket (hs, item, &hash);
-  if (hs->buckets[idx].hash == hash) {
-    if (hs->notify != NULL)
-      hs->notify (hs->buckets[idx].item);
-  } else {
-    hs->buckets[idx].hash = hash;
-    hs->size++;
-  }
+  if (found && hs->notify != NULL)
+    hs->notify (slot->item);
 
-  hs->buckets[idx].item = item;
+  slot->item = item;
   return TRUE;
 }
 
 rboolean
 r_hash_set_contains (RHashSet * hs, rconstpointer item)
 {
-  rsize idx, hash;
-
   if (R_UNLIKELY (hs == NULL)) return FALSE;
 
-  idx = r_hash_set_lookup_bucket (hs, item, &hash);
-  return hs->buckets[idx].hash == hash;
+  return r_hash_core_find (&hs->core, item) != NULL;
 }
 
 rboolean
 r_hash_set_contains_full (RHashSet * hs, rconstpointer item,
     rpointer * out)
 {
-  rsize idx, hash;
+  RHashSetSlot * slot;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
 
-  idx = r_hash_set_lookup_bucket (hs, item, &hash);
-  if (hs->buckets[idx].hash == hash) {
+  if ((slot = r_hash_core_find (&hs->core, item)) != NULL) {
     if (out != NULL)
-      *out = hs->buckets[idx].item;
+      *out = slot->item;
     return TRUE;
   }
 
@@ -209,58 +141,48 @@ void
 r_hash_set_remove_all (RHashSet * hs)
 {
   if (R_UNLIKELY (hs == NULL)) return;
-  if (R_UNLIKELY (hs->size == 0)) return;
-
-  if (hs->notify != NULL) {
-    rsize i, c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
-    for (i = 0; i < c; i++) {
-      if (hs->buckets[i].hash == R_HASH_EMPTY) continue;
-      hs->notify (hs->buckets[i].item);
-      hs->buckets[i].hash = R_HASH_EMPTY;
-    }
-  }
+  if (R_UNLIKELY (hs->core.size == 0)) return;
 
-  hs->size = 0;
+  r_hash_set_notify_all (hs);
+  r_hash_core_erase_all (&hs->core);
 }
 
 rboolean
 r_hash_set_remove (RHashSet * hs, rconstpointer item)
 {
-  rsize idx, hash;
+  RHashSetSlot * slot;
+  rpointer old;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
 
-  idx = r_hash_set_lookup_bucket (hs, item, &hash);
-  if (R_UNLIKELY (hs->buckets[idx].hash != hash))
+  if (R_UNLIKELY ((slot = r_hash_core_find (&hs->core, item)) == NULL))
     return FALSE;
 
+  old = slot->item;
+  r_hash_core_erase (&hs->core, slot);
   if (hs->notify != NULL)
-    hs->notify (hs->buckets[idx].item);
-  hs->buckets[idx].hash = R_HASH_EMPTY;
+    hs->notify (old);
 
-  hs->size--;
   return TRUE;
 }
 
 rboolean
 r_hash_set_steal (RHashSet * hs, rconstpointer item, rpointer * out)
 {
-  rsize idx, hash;
+  RHashSetSlot * slot;
 
   if (R_UNLIKELY (hs == NULL)) return FALSE;
 
-  idx = r_hash_set_lookup_bucket (hs, item, &hash);
-  if (R_UNLIKELY (hs->buckets[idx].hash != hash)) {
+  if (R_UNLIKELY ((slot = r_hash_core_find (&hs->core, item)) == NULL)) {
     if (out != NULL)
       *out = NULL;
     return FALSE;
   }
 
   if (out != NULL)
-    *out = hs->buckets[idx].item;
-  hs->buckets[idx].hash = R_HASH_EMPTY;
+    *out = slot->item;
+  r_hash_core_erase (&hs->core, slot);
 
-  hs->size--;
   return TRUE;
 }
 
@@ -272,10 +194,10 @@ r_hash_set_foreach (RHashSet * hs, RFunc func, rpointer user)
   if (R_UNLIKELY (hs == NULL)) return FALSE;
   if (R_UNLIKELY (func == NULL)) return FALSE;
 
-  c = R_HASH_CONTAINER_ALLOC_IDX_TO_SIZE (hs->allocidx);
+  c = R_HASH_CORE_CAPACITY (&hs->core);
   for (i = 0; i < c; i++) {
-    if (hs->buckets[i].hash != R_HASH_EMPTY)
-      func (hs->buckets[i].item, user);
+    if (R_HASH_CORE_IS_FULL (&hs->core, i))
+      func (((RHashSetSlot *)R_HASH_CORE_SLOT (&hs->core, i))->item, user);
   }
 
   return TRUE;
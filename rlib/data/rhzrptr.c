@@ -22,40 +22,64 @@
 #include <rlib/data/rlist.h>
 
 #include <rlib/rassert.h>
+#include <rlib/rmem.h>
 #include <rlib/rthreads.h>
 
-#define R_HZR_PTR_R g__r_hzrptr_count
+#include <stdlib.h>
+
+/* Retired pointers kept before scanning, at least twice the number of
+ * hazard pointers, so every scan frees at least half of them */
+#define R_HZR_PTR_BATCH   64
 
 static raptr        g__r_hzrptr; /* (RHzrPtrRec *) */
-static ruint        g__r_hzrptr_count;
+static rauint       g__r_hzrptr_count;
 static RTss         g__r_hzrptr_tss = R_TSS_INIT (r_hzr_ptr_rec_free);
 
 struct _RHzrPtrRec {
-  rpointer ptr;
+  raptr hp[R_HZR_PTR_SLOTS];
+  const rhzrptr * owner[R_HZR_PTR_SLOTS];
   raint active;
 
-  RFreeList * rlist;
-  ruint rcount;
+  /* Retired pointers, swapped with spare while scanning */
+  RFreePtrCtx * retired, * spare;
+  rsize rcount, ralloc, salloc;
+  rboolean scanning;
+
+  /* Sorted hazard pointers of all records, reused between scans */
+  rpointer * hazards;
+  rsize halloc;
 
   RHzrPtrRec * next;
 };
 
 
+static RHzrPtrRec *
+r_hzr_ptr_rec_get (void)
+{
+  RHzrPtrRec * rec;
+
+  if ((rec = r_tss_get (&g__r_hzrptr_tss)) == NULL)
+    r_tss_set (&g__r_hzrptr_tss, (rec = r_hzr_ptr_rec_new ()));
+
+  return rec;
+}
+
 rpointer
 r_hzr_ptr_aqcuire (rhzrptr * hzrptr, RHzrPtrRec * rec)
 {
   rpointer ret;
+  ruint i;
 
-  if (rec == NULL) {
-    if ((rec = r_tss_get (&g__r_hzrptr_tss)) == NULL)
-      r_tss_set (&g__r_hzrptr_tss, (rec = r_hzr_ptr_rec_new ()));
-  }
+  if (rec == NULL)
+    rec = r_hzr_ptr_rec_get ();
 
-  r_assert_cmpptr (rec->ptr, ==, NULL);
+  for (i = 0; i < R_HZR_PTR_SLOTS && rec->owner[i] != NULL; i++);
+  r_assert_cmpuint (i, <, R_HZR_PTR_SLOTS);
+  rec->owner[i] = hzrptr;
 
   do {
     ret = r_atomic_ptr_load (&hzrptr->ptr);
-    rec->ptr = ret; /* ret could be NULL! */
+    r_atomic_ptr_store (&rec->hp[i], ret); /* ret could be NULL! */
   } while (r_atomic_ptr_load (&hzrptr->ptr) != ret);
 
   return ret;
@@ -64,41 +88,129 @@ r_hzr_ptr_aqcuire (rhzrptr * hzrptr, RHzrPtrRec * rec)
 void
 r_hzr_ptr_release (rhzrptr * hzrptr, RHzrPtrRec * rec)
 {
-  (void)hzrptr;
+  ruint i;
 
   if (rec == NULL) {
     rec = r_tss_get (&g__r_hzrptr_tss);
     r_assert_cmpptr (rec, !=, NULL);
   }
 
-  /* We can't assert that rec->ptr is non-NULL */
-  rec->ptr = NULL;
+  /* We can't assert that the hazard pointer is non-NULL */
+  for (i = R_HZR_PTR_SLOTS; i > 0; i--) {
+    if (rec->owner[i - 1] == hzrptr) {
+      rec->owner[i - 1] = NULL;
+      r_atomic_ptr_store (&rec->hp[i - 1], NULL);
+      return;
+    }
+  }
+
+  r_assert_not_reached ();
 }
 
 static rboolean
-r_hzr_ptr_remove_entry (rpointer data, rpointer user)
+r_hzr_ptr_rec_retire (RHzrPtrRec * rec, rpointer ptr, RDestroyNotify notify)
 {
-  RSList * plist = user;
-  RFreePtrCtx * ctx = data;
-  /* Remove from rlist if not found in plist */
-  return !r_slist_contains (plist, ctx->ptr);
+  if (R_UNLIKELY (rec->rcount == rec->ralloc)) {
+    rsize alloc = MAX (rec->ralloc * 2, R_HZR_PTR_BATCH);
+    RFreePtrCtx * retired;
+
+    if ((retired = r_realloc (rec->retired, alloc * sizeof (RFreePtrCtx))) == NULL)
+      return FALSE;
+    rec->retired = retired;
+    rec->ralloc = alloc;
+  }
+
+  rec->retired[rec->rcount].ptr = ptr;
+  rec->retired[rec->rcount].notify = notify;
+  rec->rcount++;
+  return TRUE;
 }
 
-static void
+static int
+r_hzr_ptr_cmp (const void * a, const void * b)
+{
+  ruintptr pa = (ruintptr)*(rpointer const *)a;
+  ruintptr pb = (ruintptr)*(rpointer const *)b;
+  return (pa > pb) - (pa < pb);
+}
+
+static rboolean
+r_hzr_ptr_rec_is_hazard (const RHzrPtrRec * rec, rsize count, rpointer ptr)
+{
+  rsize lo = 0, hi = count, mid;
+
+  while (lo < hi) {
+    mid = lo + (hi - lo) / 2;
+    if ((ruintptr)rec->hazards[mid] < (ruintptr)ptr)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  return lo < count && rec->hazards[lo] == ptr;
+}
+
+static rsize
 r_hzr_ptr_rec_scan (RHzrPtrRec * rec)
 {
-  RSList * plist = NULL;
   RHzrPtrRec * it;
+  RFreePtrCtx * retired;
+  rsize i, count, rcount, ralloc;
+  rpointer ptr;
+  ruint s;
 
-  /* FIXME: Optimize by using a sorted data structure and binary search? */
+  /* Notifies might replace hazard pointers, which must not scan again */
+  if (rec->scanning)
+    return rec->rcount;
+  rec->scanning = TRUE;
+
+  count = 0;
   for (it = r_atomic_ptr_load (&g__r_hzrptr); it != NULL; it = it->next) {
-    if (it->ptr != NULL)
-      plist = r_slist_prepend (plist, it->ptr);
+    for (s = 0; s < R_HZR_PTR_SLOTS; s++) {
+      if ((ptr = r_atomic_ptr_load (&it->hp[s])) == NULL)
+        continue;
+      if (R_UNLIKELY (count == rec->halloc)) {
+        rsize alloc = MAX (rec->halloc * 2, R_HZR_PTR_BATCH);
+        rpointer * hazards;
+
+        if ((hazards = r_realloc (rec->hazards, alloc * sizeof (rpointer))) == NULL)
+          goto beach;
+        rec->hazards = hazards;
+        rec->halloc = alloc;
+      }
+      rec->hazards[count++] = ptr;
+    }
+  }
+  if (count > 0)
+    qsort (rec->hazards, count, sizeof (rpointer), r_hzr_ptr_cmp);
+
+  /* Retire anything still hazardous, and new pointers retired by the
+   * notifies, into the spare array */
+  retired = rec->retired;
+  rcount = rec->rcount;
+  ralloc = rec->ralloc;
+  rec->retired = rec->spare;
+  rec->ralloc = rec->salloc;
+  rec->rcount = 0;
+
+  for (i = 0; i < rcount; i++) {
+    if (r_hzr_ptr_rec_is_hazard (rec, count, retired[i].ptr)) {
+      if (!r_hzr_ptr_rec_retire (rec, retired[i].ptr, retired[i].notify))
+        break;
+    } else if (retired[i].notify != NULL) {
+      retired[i].notify (retired[i].ptr);
+    }
   }
+  /* Out of memory, keep the rest for later */
+  for (; i < rcount; i++)
+    rec->retired[rec->rcount++] = retired[i];
 
-  r_free_list_foreach_remove (&rec->rlist, r_hzr_ptr_remove_entry, plist);
+  rec->spare = retired;
+  rec->salloc = ralloc;
 
-  r_slist_destroy (plist);
+beach:
+  rec->scanning = FALSE;
+  return rec->rcount;
 }
 
 void
@@ -106,18 +218,32 @@ r_hzr_ptr_replace (rhzrptr * hzrptr, rpointer ptr)
 {
   RHzrPtrRec * rec;
   rpointer retired;
+  rsize threshold;
 
-  if ((rec = r_tss_get (&g__r_hzrptr_tss)) == NULL)
-    r_tss_set (&g__r_hzrptr_tss, (rec = r_hzr_ptr_rec_new ()));
+  rec = r_hzr_ptr_rec_get ();
 
   retired = r_atomic_ptr_exchange (&hzrptr->ptr, ptr);
   if (retired != NULL) {
-    rec->rlist = r_free_list_prepend (rec->rlist, retired, hzrptr->notify);
-    if (++rec->rcount > R_HZR_PTR_R)
+    while (!r_hzr_ptr_rec_retire (rec, retired, hzrptr->notify)) {
+      if (rec->scanning || r_hzr_ptr_rec_scan (rec) == rec->ralloc)
+        return; /* Out of memory, leaking is all we can do */
+    }
+
+    threshold = 2 * R_HZR_PTR_SLOTS * r_atomic_uint_load (&g__r_hzrptr_count);
+    if (rec->rcount >= MAX (threshold, R_HZR_PTR_BATCH))
       r_hzr_ptr_rec_scan (rec);
   }
 }
 
+rsize
+r_hzr_ptr_reclaim (RHzrPtrRec * rec)
+{
+  if (rec == NULL)
+    rec = r_hzr_ptr_rec_get ();
+
+  return r_hzr_ptr_rec_scan (rec);
+}
+
 RHzrPtrRec *
 r_hzr_ptr_rec_new (void)
 {
@@ -130,11 +256,15 @@ r_hzr_ptr_rec_new (void)
       goto done;
   }
 
-  rec = r_mem_new0 (RHzrPtrRec);
+  if ((rec = r_mem_new0 (RHzrPtrRec)) == NULL)
+    goto done;
   rec->active = TRUE;
 
   old = r_atomic_ptr_load (&g__r_hzrptr);
-  while (!r_atomic_ptr_cmp_xchg_weak (&g__r_hzrptr, &old, rec));
+  do {
+    rec->next = old;
+  } while (!r_atomic_ptr_cmp_xchg_weak (&g__r_hzrptr, &old, rec));
+  r_atomic_uint_fetch_add (&g__r_hzrptr_count, 1);
 
 done:
   return rec;
@@ -144,7 +274,12 @@ void
 r_hzr_ptr_rec_free (RHzrPtrRec * rec)
 {
   if (rec != NULL) {
-    r_assert_cmpptr (rec->ptr, ==, NULL);
+    ruint i;
+
+    for (i = 0; i < R_HZR_PTR_SLOTS; i++)
+      r_assert_cmpptr (rec->owner[i], ==, NULL);
+    /* Whatever is still retired is left for the next user of rec */
+    r_hzr_ptr_rec_scan (rec);
     r_atomic_int_store (&rec->active, FALSE);
   }
 }
@@ -26,8 +26,8 @@
 
 R_BEGIN_DECLS
 
-#define r_mpint_ensure_bits (mpi, bits) \
-  r_mpint_ensure_digits (mpi, (bits + sizeof (rmpint_digit) - 1) / sizeof (rmpint_digit))
+#define r_mpint_ensure_bits(mpi, bits) \
+  r_mpint_ensure_digits (mpi, ((bits) + RMPINT_DIGIT_BITS - 1) / RMPINT_DIGIT_BITS)
 R_API_HIDDEN void r_mpint_ensure_digits (rmpint * mpi, ruint16 digits);
 
 R_API_HIDDEN rboolean r_mpint_add_unsigned (rmpint * dst,
@@ -35,6 +35,25 @@ R_API_HIDDEN rboolean r_mpint_add_unsigned (rmpint * dst,
 /* NOTE: a MUST be bigger than b */
 R_API_HIDDEN rboolean r_mpint_sub_unsigned (rmpint * dst,
     const rmpint * a, const rmpint * b);
+R_API_HIDDEN rboolean r_mpint_mul_digit (rmpint * dst,
+    const rmpint * a, rmpint_digit b);
+
+/* Operand sizes (in digits) from where Karatsuba beats the schoolbook
+ * multiplication and squaring, see bench/rmpint.c */
+#if RMPINT_DIGIT_BITS == 64
+#define RMPINT_KARATSUBA_MUL_THRESHOLD    32
+#define RMPINT_KARATSUBA_SQR_THRESHOLD    48
+#else
+#define RMPINT_KARATSUBA_MUL_THRESHOLD    48
+#define RMPINT_KARATSUBA_SQR_THRESHOLD    64
+#endif
+
+/* r[0 .. an + bn) = a * b, r must not overlap a or b */
+R_API_HIDDEN void r_mpint_mul_digits (rmpint_digit * r,
+    const rmpint_digit * a, ruint16 an, const rmpint_digit * b, ruint16 bn);
+/* r[0 .. 2n) = a * a, r must not overlap a */
+R_API_HIDDEN void r_mpint_sqr_digits (rmpint_digit * r,
+    const rmpint_digit * a, ruint16 n);
 
 #define RMPINT_N_PRIMES       256
 R_API_HIDDEN extern const rmpint_digit r_mpint_primes[RMPINT_N_PRIMES];
@@ -46,6 +65,28 @@ R_API_HIDDEN rboolean r_mpint_montgomery_reduce (rmpint * a, const rmpint * m,
     rmpint_digit mp);
 R_API_HIDDEN rboolean r_mpint_montgomery_normalize (rmpint * a, const rmpint * m);
 
+/* Per modulus Montgomery state, set up once and reused for every
+ * multiplication and exponentiation with the same (odd) modulus */
+typedef struct {
+  rmpint m;
+  rmpint one;           /* R mod m, which is 1 in Montgomery form */
+  rmpint rr;            /* R^2 mod m, for converting into Montgomery form */
+  rmpint_digit mp;      /* -m^-1 mod b */
+} RMpintMontCtx;
+
+R_API_HIDDEN rboolean r_mpint_montgomery_ctx_init (RMpintMontCtx * ctx,
+    const rmpint * m);
+R_API_HIDDEN void r_mpint_montgomery_ctx_clear (RMpintMontCtx * ctx);
+#define r_mpint_montgomery_ctx_is_valid(ctx) (!r_mpint_iszero (&(ctx)->m))
+/* dst = a * b * R^-1 mod m, a and b must be less than m */
+R_API_HIDDEN rboolean r_mpint_montgomery_mul (rmpint * dst,
+    const rmpint * a, const rmpint * b, const RMpintMontCtx * ctx);
+/* dst = a * a * R^-1 mod m, a must be less than m */
+R_API_HIDDEN rboolean r_mpint_montgomery_sqr (rmpint * dst,
+    const rmpint * a, const RMpintMontCtx * ctx);
+R_API_HIDDEN rboolean r_mpint_expmod_montgomery (rmpint * dst,
+    const rmpint * b, const rmpint * e, const RMpintMontCtx * ctx);
+
 R_END_DECLS
 
 #endif /* __R_MPINT_PRIVATE_H__ */
@@ -126,23 +126,21 @@ r_mpint_clear (rmpint * mpi)
 static void
 r_mpint_to_binary_copy (ruint8 * dst, ruint8 * src, ruint8 b, rsize d)
 {
+  rsize i;
+
 #if R_BYTE_ORDER == R_LITTLE_ENDIAN
   while (b-- > 0)
     *dst++ = src[d * sizeof (rmpint_digit) + b];
   while (d-- > 0) {
-    *dst++ = src[d * sizeof (rmpint_digit) + 3];
-    *dst++ = src[d * sizeof (rmpint_digit) + 2];
-    *dst++ = src[d * sizeof (rmpint_digit) + 1];
-    *dst++ = src[d * sizeof (rmpint_digit) + 0];
+    for (i = sizeof (rmpint_digit); i > 0; i--)
+      *dst++ = src[d * sizeof (rmpint_digit) + i - 1];
   }
 #else
   while (b > 0)
     *dst++ = src[(d+1) * sizeof (rmpint_digit) - b--];
   while (d-- > 0) {
-    *dst++ = src[d * sizeof (rmpint_digit) + 0];
-    *dst++ = src[d * sizeof (rmpint_digit) + 1];
-    *dst++ = src[d * sizeof (rmpint_digit) + 2];
-    *dst++ = src[d * sizeof (rmpint_digit) + 3];
+    for (i = 0; i < sizeof (rmpint_digit); i++)
+      *dst++ = src[d * sizeof (rmpint_digit) + i];
   }
 #endif
 }
@@ -315,7 +313,7 @@ r_mpint_prime_miller_rabin (const rmpint * n, const rmpint * a)
 
   if (r_mpint_cmp (&y, &n1) != 0 && r_mpint_ucmp_u32 (&y, 1) != 0) {
     for (j = 1; j < s && r_mpint_cmp (&y, &n1) != 0; j++) {
-      if (!r_mpint_mulmod (&y, &y, &y, n))
+      if (!r_mpint_sqrmod (&y, &y, n))
         goto error;
 
       if (r_mpint_ucmp_u32 (&y, 1) == 0) {
@@ -403,7 +401,7 @@ r_mpint_prime_miller_rabin_full (const rmpint * n, RPrng * prng)
       continue;
 
     for (j = 1; j < s && r_mpint_cmp (&a, &n1) != 0; j++) {
-      if (!r_mpint_mulmod (&a, &a, &a, n))
+      if (!r_mpint_sqrmod (&a, &a, n))
         goto error;
 
       if (r_mpint_ucmp_u32 (&a, 1) == 0) {
@@ -589,13 +587,13 @@ r_mpint_set_binary (rmpint * mpi, rconstpointer data, rsize size)
 #else
   dst = (ruint8 *)(rpointer)&mpi->data[digits - 1];
   switch (size % sizeof (rmpint_digit)) {
-#if 0 /*sizeof (rmpint_digit) >= 8*/
+#if RMPINT_DIGIT_BITS >= 64
     case 7: dst[sizeof (rmpint_digit) - 7] = *src++;
     case 6: dst[sizeof (rmpint_digit) - 6] = *src++;
     case 5: dst[sizeof (rmpint_digit) - 5] = *src++;
     case 4: dst[sizeof (rmpint_digit) - 4] = *src++;
 #endif
-#if 1 /*sizeof (rmpint_digit) >= 4*/
+#if RMPINT_DIGIT_BITS >= 32
     case 3: dst[sizeof (rmpint_digit) - 3] = *src++;
     case 2: dst[sizeof (rmpint_digit) - 2] = *src++;
 #endif
@@ -645,10 +643,16 @@ r_mpint_set_i64 (rmpint * mpi, rint64 value)
 void
 r_mpint_set_u64 (rmpint * mpi, ruint64 value)
 {
-  r_memset (&mpi->data[2], 0, (mpi->dig_alloc - 3) * sizeof (rmpint_digit));
+#if RMPINT_DIGIT_BITS >= 64
+  mpi->data[0] = (rmpint_digit)value;
+  r_memset (&mpi->data[1], 0, (mpi->dig_alloc - 1) * sizeof (rmpint_digit));
+  mpi->dig_used = 1;
+#else
+  r_memset (&mpi->data[2], 0, (mpi->dig_alloc - 2) * sizeof (rmpint_digit));
   mpi->data[1] = (rmpint_digit)(value >> 32);
   mpi->data[0] = (rmpint_digit)(value & RUINT32_MAX);
   mpi->dig_used = 2;
+#endif
   mpi->sign = 0;
   r_mpint_clamp (mpi);
 }
@@ -659,7 +663,7 @@ r_mpint_ctz (const rmpint * mpi)
   ruint16 i;
 
   for (i = 0; i < mpi->dig_used && r_mpint_get_digit (mpi, i) == 0; i++);
-  return i * sizeof (rmpint_digit) * 8 + RUINT32_CTZ (r_mpint_get_digit (mpi, i));
+  return i * RMPINT_DIGIT_BITS + RMPINT_DIGIT_CTZ (r_mpint_get_digit (mpi, i));
 }
 
 int
@@ -680,9 +684,8 @@ r_mpint_cmp (const rmpint * a, const rmpint * b)
     ruint16 i;
 
     for (i = a->dig_used; i > 0; i--) {
-      rint64 c = (rint64)a->data[i - 1] - (rint64)b->data[i - 1];
-      if (c != 0)
-        return c > 0 ? 1 : -1;
+      if (a->data[i - 1] != b->data[i - 1])
+        return a->data[i - 1] > b->data[i - 1] ? 1 : -1;
     }
   }
   return 0;
@@ -701,9 +704,8 @@ r_mpint_ucmp (const rmpint * a, const rmpint * b)
   if (a->dig_used > 0) {
     ruint16 i;
     for (i = a->dig_used; i > 0; i--) {
-      rint64 c = (rint64)a->data[i - 1] - (rint64)b->data[i - 1];
-      if (c != 0)
-        return c > 0 ? 1 : -1;
+      if (a->data[i - 1] != b->data[i - 1])
+        return a->data[i - 1] > b->data[i - 1] ? 1 : -1;
     }
   }
   return 0;
@@ -737,16 +739,14 @@ r_mpint_cmp_i32 (const rmpint * a, rint32 b)
 int
 r_mpint_ucmp_u32 (const rmpint * a, ruint32 b)
 {
-  rint64 c;
-
   if (R_UNLIKELY (a == NULL)) return -1;
 
   if (b == 0)
     return (int)a->dig_used;
   if (a->dig_used != 1)
     return (int)a->dig_used - 1;
-  if ((c = (rint64)a->data[0] - (rint64)b) != 0)
-    return c > 0 ? 1 : -1;
+  if (a->data[0] != b)
+    return a->data[0] > b ? 1 : -1;
   return 0;
 }
 
@@ -855,10 +855,12 @@ rboolean
 r_mpint_add_u32 (rmpint * dst, const rmpint * a, ruint32 b)
 {
   rmpint mpi;
+  rmpint_digit digit = b;
+
   mpi.dig_alloc = 0;
   mpi.dig_used = 1;
   mpi.sign = 0;
-  mpi.data = &b;
+  mpi.data = &digit;
 
   return r_mpint_add_unsigned (dst, a, &mpi);
 }
@@ -899,10 +901,12 @@ rboolean
 r_mpint_sub_u32 (rmpint * dst, const rmpint * a, ruint32 b)
 {
   rmpint mpi;
+  rmpint_digit digit = b;
+
   mpi.dig_alloc = 0;
   mpi.dig_used = 1;
   mpi.sign = 0;
-  mpi.data = &b;
+  mpi.data = &digit;
 
   return r_mpint_sub (dst, a, &mpi);
 }
@@ -986,7 +990,8 @@ r_mpint_shl_digit (rmpint * dst, const rmpint * a, ruint16 d)
     r_memmove (&dst->data[d], a->data, a->dig_used * sizeof (rmpint_digit));
   } else {
     if (dst->dig_alloc > a->dig_alloc)
-      r_memset (&dst->data[a->dig_alloc], 0, dst->dig_alloc - a->dig_alloc);
+      r_memset (&dst->data[a->dig_alloc], 0,
+          (dst->dig_alloc - a->dig_alloc) * sizeof (rmpint_digit));
 
     r_memcpy (&dst->data[d], a->data, a->dig_used * sizeof (rmpint_digit));
   }
@@ -1010,18 +1015,258 @@ r_mpint_shr_digit (rmpint * dst, const rmpint * a, ruint16 d)
   else
     r_memcpy (dst->data, &a->data[d], dst->dig_used * sizeof (rmpint_digit));
 
-  r_memset (&dst->data[dst->dig_used], 0, dst->dig_alloc - dst->dig_used);
+  r_memset (&dst->data[dst->dig_used], 0,
+      (dst->dig_alloc - dst->dig_used) * sizeof (rmpint_digit));
   return TRUE;
 }
 
-/* Based on Paul G. Combas algorithm/method */
+static rmpint_digit
+r_mpint_digits_add (rmpint_digit * r, const rmpint_digit * a, ruint16 an,
+    const rmpint_digit * b, ruint16 bn)
+{
+  rmpint_word w = 0;
+  ruint16 i;
+
+  for (i = 0; i < bn; i++) {
+    w += (rmpint_word)a[i] + b[i];
+    r[i] = (rmpint_digit)w;
+    w >>= RMPINT_DIGIT_BITS;
+  }
+  for (; i < an; i++) {
+    w += a[i];
+    r[i] = (rmpint_digit)w;
+    w >>= RMPINT_DIGIT_BITS;
+  }
+
+  return (rmpint_digit)w;
+}
+
+static rmpint_digit
+r_mpint_digits_sub (rmpint_digit * r, const rmpint_digit * a, ruint16 an,
+    const rmpint_digit * b, ruint16 bn)
+{
+  rmpint_digit borrow = 0;
+  ruint16 i;
+
+  for (i = 0; i < bn; i++) {
+    rmpint_digit d = a[i] - b[i] - borrow;
+    borrow = (a[i] < b[i]) || (a[i] == b[i] && borrow);
+    r[i] = d;
+  }
+  for (; i < an; i++) {
+    rmpint_digit d = a[i] - borrow;
+    borrow = (a[i] < borrow);
+    r[i] = d;
+  }
+
+  return borrow;
+}
+
+static void
+r_mpint_mul_basecase (rmpint_digit * r, const rmpint_digit * a, ruint16 an,
+    const rmpint_digit * b, ruint16 bn)
+{
+  ruint16 i, j;
+
+  r_memset (r, 0, an * sizeof (rmpint_digit));
+  for (j = 0; j < bn; j++) {
+    rmpint_digit carry = 0;
+
+    for (i = 0; i < an; i++) {
+      rmpint_word w = (rmpint_word)a[i] * b[j] + r[i + j] + carry;
+      r[i + j] = (rmpint_digit)w;
+      carry = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+    }
+    r[an + j] = carry;
+  }
+}
+
+/* Every cross product a[i] * a[j] (i < j) is computed once and doubled,
+ * before adding the squares on the diagonal */
+static void
+r_mpint_sqr_basecase (rmpint_digit * r, const rmpint_digit * a, ruint16 n)
+{
+  rmpint_word w;
+  rmpint_digit carry;
+  ruint16 i, j;
+
+  r_memset (r, 0, 2 * n * sizeof (rmpint_digit));
+  for (i = 0; i + 1 < n; i++) {
+    for (j = i + 1, carry = 0; j < n; j++) {
+      w = (rmpint_word)a[i] * a[j] + r[i + j] + carry;
+      r[i + j] = (rmpint_digit)w;
+      carry = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+    }
+    r[i + n] = carry;
+  }
+
+  for (i = 0, carry = 0; i < 2 * n; i++) {
+    rmpint_digit d = r[i];
+    r[i] = (d << 1) | carry;
+    carry = d >> (RMPINT_DIGIT_BITS - 1);
+  }
+
+  for (i = 0, carry = 0; i < n; i++) {
+    w = (rmpint_word)a[i] * a[i] + r[2 * i] + carry;
+    r[2 * i] = (rmpint_digit)w;
+    w = (rmpint_word)r[2 * i + 1] + (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+    r[2 * i + 1] = (rmpint_digit)w;
+    carry = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+  }
+}
+
+static rsize
+r_mpint_karatsuba_scratch (ruint16 n, ruint16 threshold)
+{
+  rsize ret = 0;
+
+  /* sa, sb and z1 for each level of recursion, see below */
+  for (; n >= threshold; n = n - n / 2 + 1)
+    ret += 4 * (n - n / 2 + 1);
+  return ret;
+}
+
+/* Split a = a1 * B^lo + a0 and b = b1 * B^lo + b0, then
+ * a * b = z2 * B^2lo + (z1 - z2 - z0) * B^lo + z0 where
+ * z0 = a0 * b0, z2 = a1 * b1 and z1 = (a0 + a1) * (b0 + b1) */
+static void
+r_mpint_mul_karatsuba (rmpint_digit * r, const rmpint_digit * a,
+    const rmpint_digit * b, ruint16 n, rmpint_digit * tmp)
+{
+  rmpint_digit * sa, * sb, * z1;
+  ruint16 lo, hi, zn;
+
+  if (n < RMPINT_KARATSUBA_MUL_THRESHOLD) {
+    r_mpint_mul_basecase (r, a, n, b, n);
+    return;
+  }
+
+  lo = n / 2;
+  hi = n - lo;
+  sa = tmp;
+  sb = sa + hi + 1;
+  z1 = sb + hi + 1;
+  tmp = z1 + 2 * (hi + 1);
+
+  sa[hi] = r_mpint_digits_add (sa, a + lo, hi, a, lo);
+  sb[hi] = r_mpint_digits_add (sb, b + lo, hi, b, lo);
+  r_mpint_mul_karatsuba (z1, sa, sb, hi + 1, tmp);
+  r_mpint_mul_karatsuba (r, a, b, lo, tmp);
+  r_mpint_mul_karatsuba (r + 2 * lo, a + lo, b + lo, hi, tmp);
+
+  zn = 2 * (hi + 1);
+  r_mpint_digits_sub (z1, z1, zn, r, 2 * lo);
+  r_mpint_digits_sub (z1, z1, zn, r + 2 * lo, 2 * hi);
+  while (zn > 0 && z1[zn - 1] == 0)
+    zn--;
+  r_mpint_digits_add (r + lo, r + lo, 2 * n - lo, z1, zn);
+}
+
+static void
+r_mpint_sqr_karatsuba (rmpint_digit * r, const rmpint_digit * a, ruint16 n,
+    rmpint_digit * tmp)
+{
+  rmpint_digit * sa, * z1;
+  ruint16 lo, hi, zn;
+
+  if (n < RMPINT_KARATSUBA_SQR_THRESHOLD) {
+    r_mpint_sqr_basecase (r, a, n);
+    return;
+  }
+
+  lo = n / 2;
+  hi = n - lo;
+  sa = tmp;
+  z1 = sa + hi + 1;
+  tmp = z1 + 2 * (hi + 1);
+
+  sa[hi] = r_mpint_digits_add (sa, a + lo, hi, a, lo);
+  r_mpint_sqr_karatsuba (z1, sa, hi + 1, tmp);
+  r_mpint_sqr_karatsuba (r, a, lo, tmp);
+  r_mpint_sqr_karatsuba (r + 2 * lo, a + lo, hi, tmp);
+
+  zn = 2 * (hi + 1);
+  r_mpint_digits_sub (z1, z1, zn, r, 2 * lo);
+  r_mpint_digits_sub (z1, z1, zn, r + 2 * lo, 2 * hi);
+  while (zn > 0 && z1[zn - 1] == 0)
+    zn--;
+  r_mpint_digits_add (r + lo, r + lo, 2 * n - lo, z1, zn);
+}
+
+#define RMPINT_SCRATCH_ALLOCA_MAX   4096
+
+void
+r_mpint_mul_digits (rmpint_digit * r, const rmpint_digit * a, ruint16 an,
+    const rmpint_digit * b, ruint16 bn)
+{
+  rmpint_digit * tmp, * prod;
+  rsize size;
+  ruint16 off;
+
+  if (an < bn) {
+    const rmpint_digit * t = a; ruint16 tn = an;
+    a = b; an = bn;
+    b = t; bn = tn;
+  }
+
+  if (bn < RMPINT_KARATSUBA_MUL_THRESHOLD) {
+    r_mpint_mul_basecase (r, a, an, b, bn);
+    return;
+  }
+
+  size = r_mpint_karatsuba_scratch (bn, RMPINT_KARATSUBA_MUL_THRESHOLD);
+  if (an == bn) {
+    size *= sizeof (rmpint_digit);
+    tmp = size <= RMPINT_SCRATCH_ALLOCA_MAX ? r_alloca (size) : r_malloc (size);
+    r_mpint_mul_karatsuba (r, a, b, bn, tmp);
+    if (size > RMPINT_SCRATCH_ALLOCA_MAX)
+      r_free (tmp);
+    return;
+  }
+
+  /* Unbalanced, multiply b with a in slices of bn digits */
+  size = (size + 2 * bn) * sizeof (rmpint_digit);
+  tmp = size <= RMPINT_SCRATCH_ALLOCA_MAX ? r_alloca (size) : r_malloc (size);
+  prod = tmp + size / sizeof (rmpint_digit) - 2 * bn;
+
+  r_memset (r, 0, (an + bn) * sizeof (rmpint_digit));
+  for (off = 0; off < an; off += bn) {
+    ruint16 len = MIN (bn, an - off);
+    if (len == bn)
+      r_mpint_mul_karatsuba (prod, a + off, b, bn, tmp);
+    else
+      r_mpint_mul_digits (prod, b, bn, a + off, len);
+    r_mpint_digits_add (r + off, r + off, an + bn - off, prod, len + bn);
+  }
+
+  if (size > RMPINT_SCRATCH_ALLOCA_MAX)
+    r_free (tmp);
+}
+
+void
+r_mpint_sqr_digits (rmpint_digit * r, const rmpint_digit * a, ruint16 n)
+{
+  rmpint_digit * tmp;
+  rsize size;
+
+  if (n < RMPINT_KARATSUBA_SQR_THRESHOLD) {
+    r_mpint_sqr_basecase (r, a, n);
+    return;
+  }
+
+  size = r_mpint_karatsuba_scratch (n, RMPINT_KARATSUBA_SQR_THRESHOLD) *
+    sizeof (rmpint_digit);
+  tmp = size <= RMPINT_SCRATCH_ALLOCA_MAX ? r_alloca (size) : r_malloc (size);
+  r_mpint_sqr_karatsuba (r, a, n, tmp);
+  if (size > RMPINT_SCRATCH_ALLOCA_MAX)
+    r_free (tmp);
+}
+
 rboolean
 r_mpint_mul (rmpint * dst, const rmpint * a, const rmpint * b)
 {
-  rint32 ix, iy, iz, tx, ty;
   ruint16 used;
   rmpint * tmp, * out;
-  rmpint_word w, acc, c;
 
   if (R_UNLIKELY (dst == NULL || a == NULL || b == NULL))
     return FALSE;
@@ -1030,13 +1275,10 @@ r_mpint_mul (rmpint * dst, const rmpint * a, const rmpint * b)
   if (R_UNLIKELY (used < a->dig_used || used < b->dig_used))
     return FALSE;
 
-  /* FIXME: Add specific comba versions for 1024 and 2048 bits multiplications */
-#if 0
-  if (a->dig_used == 16 && b->dig_used == 16)
-    return r_mpint_mul_comba16 (dst, a, b);
-  if (a->dig_used == 32 && b->dig_used == 32)
-    return r_mpint_mul_comba32 (dst, a, b);
-#endif
+  if (r_mpint_iszero (a) || r_mpint_iszero (b)) {
+    r_mpint_zero (dst);
+    return TRUE;
+  }
 
   if (a == dst || b == dst) {
     tmp = r_mem_newa (rmpint);
@@ -1048,23 +1290,10 @@ r_mpint_mul (rmpint * dst, const rmpint * a, const rmpint * b)
     out = dst;
   }
 
-  for (ix = 0, acc = 0; ix < used; ix++) {
-    ty = MIN (ix, b->dig_used - 1);
-    tx = ix - ty;
-
-    iy = MIN (a->dig_used - tx, ty + 1);
-    for (iz = 0, c = 0; iz < iy; iz++) {
-      /* acc += a * b  (c used as carry) */
-      w = (rmpint_word)acc +
-        ((rmpint_word)r_mpint_get_digit (a, tx + iz)) *
-        ((rmpint_word)r_mpint_get_digit (b, ty - iz));
-      if (w < acc) c++;
-      acc = w;
-    }
-
-    out->data[ix] = acc;
-    acc = c << (sizeof (rmpint_digit) * 8) | acc >> sizeof (rmpint_digit) * 8;
-  }
+  if (a == b)
+    r_mpint_sqr_digits (out->data, a->data, a->dig_used);
+  else
+    r_mpint_mul_digits (out->data, a->data, a->dig_used, b->data, b->dig_used);
 
   out->sign = a->sign ^ b->sign;
   out->dig_used = used;
@@ -1078,6 +1307,12 @@ r_mpint_mul (rmpint * dst, const rmpint * a, const rmpint * b)
   return TRUE;
 }
 
+rboolean
+r_mpint_sqr (rmpint * dst, const rmpint * a)
+{
+  return r_mpint_mul (dst, a, a);
+}
+
 rboolean
 r_mpint_mul_i32 (rmpint * dst, const rmpint * a, rint32 b)
 {
@@ -1095,6 +1330,12 @@ r_mpint_mul_i32 (rmpint * dst, const rmpint * a, rint32 b)
 
 rboolean
 r_mpint_mul_u32 (rmpint * dst, const rmpint * a, ruint32 b)
+{
+  return r_mpint_mul_digit (dst, a, b);
+}
+
+rboolean
+r_mpint_mul_digit (rmpint * dst, const rmpint * a, rmpint_digit b)
 {
   rmpint_word w;
   ruint16 i;
@@ -1103,7 +1344,7 @@ r_mpint_mul_u32 (rmpint * dst, const rmpint * a, ruint32 b)
   for (i = 0, w = 0; i < a->dig_used; i++) {
     w += ((rmpint_word)r_mpint_get_digit (a, i)) * ((rmpint_word)b);
     dst->data[i] = (rmpint_digit)w;
-    w >>= sizeof (rmpint_digit) * 8;
+    w >>= RMPINT_DIGIT_BITS;
   }
   if (w > 0) dst->data[i++] = w;
   r_memset (&dst->data[i], 0, (dst->dig_alloc - i) * sizeof (rmpint_digit));
@@ -1120,6 +1361,7 @@ r_mpint_div (rmpint * q, rmpint * r, const rmpint * n, const rmpint * d)
   rmpint x, y, qtmp, *qp, tmp1, tmp2;
   int cmp;
   ruint norm, bits;
+  ruint32 qsign, rsign;
   ruint16 i, nn, tt;
 
   if (R_UNLIKELY (n == NULL || d == NULL))
@@ -1154,19 +1396,23 @@ r_mpint_div (rmpint * q, rmpint * r, const rmpint * n, const rmpint * d)
     norm = 0;
   }
 
+  /* q and r may be the same as n or d */
+  qsign = n->sign ^ d->sign;
+  rsign = n->sign;
   x.sign = y.sign = 0;
   nn = r_mpint_digits_used (&x) - 1;
   tt = r_mpint_digits_used (&y) - 1;
 
   if (q != NULL) {
     r_mpint_ensure_digits (q, nn - tt + 1);
+    r_mpint_zero (q);
     qp = q;
   } else {
     r_mpint_init_size (&qtmp, nn - tt + 1);
     qp = &qtmp;
   }
   qp->dig_used = nn - tt + 1;
-  qp->sign = n->sign ^ d->sign;
+  qp->sign = qsign;
 
   /* step 2 */
   r_mpint_shl_digit (&tmp1, &y, nn - tt);
@@ -1204,7 +1450,7 @@ r_mpint_div (rmpint * q, rmpint * r, const rmpint * n, const rmpint * d)
       tmp1.data[0] = (tt > 0) ? y.data[tt - 1] : 0;
       tmp1.data[1] = y.data[tt];
       tmp1.dig_used = 2;
-      r_mpint_mul_u32 (&tmp1, &tmp1, *qit);
+      r_mpint_mul_digit (&tmp1, &tmp1, *qit);
 
       r_mpint_clamp (&tmp1);
       if (r_mpint_ucmp (&tmp1, &tmp2) <= 0)
@@ -1213,7 +1459,7 @@ r_mpint_div (rmpint * q, rmpint * r, const rmpint * n, const rmpint * d)
     }
 
     /* Step 3.3 */
-    r_mpint_mul_u32 (&tmp1, &y, *qit);
+    r_mpint_mul_digit (&tmp1, &y, *qit);
     r_mpint_shl_digit (&tmp1, &tmp1, i - tt - 1);
     r_mpint_sub (&x, &x, &tmp1);
 
@@ -1230,7 +1476,7 @@ r_mpint_div (rmpint * q, rmpint * r, const rmpint * n, const rmpint * d)
   if (r != NULL) {
     r_mpint_clamp (&x);
     r_mpint_shr (r, &x, norm);
-    r->sign = n->sign;
+    r->sign = rsign;
   }
 
   r_mpint_clear (&tmp1);
@@ -1270,6 +1516,7 @@ rboolean
 r_mpint_div_u32 (rmpint * q, rmpint * r, const rmpint * n, ruint32 d)
 {
   rmpint mpi;
+  rmpint_digit digit = d;
 
   if (d == 0)
     return FALSE;
@@ -1277,7 +1524,7 @@ r_mpint_div_u32 (rmpint * q, rmpint * r, const rmpint * n, ruint32 d)
   mpi.dig_alloc = 0;
   mpi.dig_used = 1;
   mpi.sign = 0;
-  mpi.data = &d;
+  mpi.data = &digit;
 
   return r_mpint_div (q, r, n, &mpi);
 }
@@ -1302,7 +1549,7 @@ r_mpint_exp (rmpint * dst, const rmpint * b, ruint16 e)
   for (; e > 1; e >>= 1) {
     if (e & 1)
       r_mpint_mul (dst, &s, dst);
-    r_mpint_mul (&s, &s, &s);
+    r_mpint_sqr (&s, &s);
   }
 
   ret = r_mpint_mul (dst, dst, &s);
@@ -1478,59 +1725,18 @@ r_mpint_invmod (rmpint * dst, const rmpint * a, const rmpint * m)
 rboolean
 r_mpint_expmod (rmpint * dst, const rmpint * b, const rmpint * e, const rmpint * m)
 {
-  rmpint R[2];
-  rmpint_digit mp;
-  ruint16 didx, bidx;
+  RMpintMontCtx ctx;
+  rboolean ret;
 
   if (R_UNLIKELY (dst == NULL || b == NULL || e == NULL || m == NULL))
     return FALSE;
 
-  if (!r_mpint_montgomery_setup (&mp, m))
-     return FALSE;
-
-  r_mpint_init (&R[0]);
-  r_mpint_init (&R[1]);
-
-  if (!r_mpint_montgomery_normalize (&R[0], m))
-    goto expmod_failed;
-
-  if (r_mpint_ucmp (b, m) > 0) {
-    if (!r_mpint_mod (&R[1], b, m))
-      goto expmod_failed;
-  } else {
-     r_mpint_set (&R[1], b);
-  }
-  if (!r_mpint_mulmod (&R[1], &R[1], &R[0], m))
-    goto expmod_failed;
-
-  /* For loops iterates all bits from msb to lsb */
-  for (didx = r_mpint_digits_used (e); didx > 0; didx--) {
-    rmpint_digit dig = r_mpint_get_digit (e, didx - 1);
-    for (bidx = 0; bidx < sizeof (rmpint_digit) * 8; bidx++) {
-      rmpint_digit bit = (dig >> (sizeof (rmpint_digit) * 8 - 1)) & 1;
-      dig <<= 1;
-
-      /* Do this for all bits */
-      if (!r_mpint_mul (&R[bit^1], &R[0], &R[1]) ||
-          !r_mpint_montgomery_reduce (&R[bit^1], m, mp))
-        goto expmod_failed;
-      if (!r_mpint_mul (&R[bit], &R[bit], &R[bit]) ||
-          !r_mpint_montgomery_reduce (&R[bit], m, mp))
-        goto expmod_failed;
-    }
-  }
-
-  if (!r_mpint_montgomery_reduce (&R[0], m, mp))
-    goto expmod_failed;
+  if (!r_mpint_montgomery_ctx_init (&ctx, m))
+    return FALSE;
 
-  r_mpint_set (dst, &R[0]);
-  r_mpint_clear (&R[0]);
-  r_mpint_clear (&R[1]);
-  return TRUE;
-expmod_failed:
-  r_mpint_clear (&R[0]);
-  r_mpint_clear (&R[1]);
-  return FALSE;
+  ret = r_mpint_expmod_montgomery (dst, b, e, &ctx);
+  r_mpint_montgomery_ctx_clear (&ctx);
+  return ret;
 }
 
 /* Based on Handbook of Applied Cryptography (HAC) 14.4.3 (p.608) */
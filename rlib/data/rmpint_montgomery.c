@@ -19,61 +19,97 @@
 #include "config.h"
 #include "rmpint-private.h"
 
+#include <rlib/rmem.h>
+
 rboolean
 r_mpint_montgomery_setup (rmpint_digit * mp, const rmpint * m)
 {
   rmpint_digit x, b;
+  ruint bits;
 
   if (!r_mpint_isodd (m))
     return FALSE;
 
+  /* x = b^-1 mod 2^4, each Newton step doubles the number of correct bits */
   b = r_mpint_get_digit (m, 0);
   x = (((b + 2) & 4) << 1) + b;
-  x *= 2 - b * x;
-  x *= 2 - b * x;
-  x *= 2 - b * x;
+  for (bits = 4; bits < RMPINT_DIGIT_BITS; bits *= 2)
+    x *= 2 - b * x;
 
   *mp = (rmpint_digit)(((rmpint_word) 1 << (sizeof (rmpint_digit) * 8)) - ((rmpint_word)x));
   return TRUE;
 }
 
-rboolean
-r_mpint_montgomery_reduce (rmpint * a, const rmpint * m, rmpint_digit mp)
+/* t has 2n + 1 digits, on return t[n .. 2n) holds t * R^-1 mod m */
+static void
+r_mpint_montgomery_redc (rmpint_digit * t, const rmpint_digit * m,
+    ruint16 n, rmpint_digit mp)
 {
-  rmpint_digit * cptr, mu;
-  rmpint c;
-  int x, y;
-
-  r_mpint_init_size (&c, 2*r_mpint_digits_used (m)+1);
-  r_mpint_set (&c, a);
-
-  for (x = 0; x < r_mpint_digits_used (m); x++) {
-    rmpint_digit carry = 0;
-
-    mu = r_mpint_get_digit (&c, x) * mp;
-    cptr = c.data + x;
-    for (y = 0; y < r_mpint_digits_used (m); y++) {
-      rmpint_word t;
-      cptr[0] = t  = ((rmpint_word)cptr[0] + (rmpint_word)carry) +
-        (((rmpint_word)mu) * ((rmpint_word)r_mpint_get_digit (m, y)));
-      carry = (t >> (sizeof (rmpint_digit) * 8));
-      ++cptr;
+  ruint16 i, j;
+
+  for (i = 0; i < n; i++) {
+    rmpint_digit carry = 0, mu = t[i] * mp;
+
+    for (j = 0; j < n; j++) {
+      rmpint_word w = (rmpint_word)mu * m[j] + t[i + j] + carry;
+      t[i + j] = (rmpint_digit)w;
+      carry = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
     }
-    while (carry != 0) {
-      rmpint_digit t = cptr[0] += carry;
-      carry = (t < carry);
-      ++cptr;
+    for (j += i; carry != 0; j++) {
+      t[j] += carry;
+      carry = (t[j] < carry);
     }
   }
+}
 
-  c.dig_used = 2*r_mpint_digits_used (m)+1;
-  r_mpint_clamp (&c);
-  r_mpint_shr_digit (a, &c, r_mpint_digits_used (m));
-  r_mpint_clear (&c);
+/* t has n + 1 digits and is less than 2m, subtract m once if needed */
+static void
+r_mpint_montgomery_final_sub (rmpint_digit * t, const rmpint_digit * m,
+    ruint16 n)
+{
+  rmpint_digit carry;
+  ruint16 j;
+
+  for (j = n; t[n] == 0 && j > 0; j--) {
+    if (t[j - 1] != m[j - 1])
+      break;
+  }
+  if (t[n] != 0 || j == 0 || t[j - 1] > m[j - 1]) {
+    carry = 0;
+    for (j = 0; j < n; j++) {
+      rmpint_digit d = t[j] - m[j] - carry;
+      carry = (t[j] < m[j]) || (t[j] == m[j] && carry);
+      t[j] = d;
+    }
+  }
+}
+
+static void
+r_mpint_montgomery_set_result (rmpint * dst, const rmpint_digit * t, ruint16 n)
+{
+  r_mpint_ensure_digits (dst, n);
+  r_memcpy (dst->data, t, n * sizeof (rmpint_digit));
+  dst->dig_used = n;
+  dst->sign = 0;
+  r_mpint_clamp (dst);
+}
+
+rboolean
+r_mpint_montgomery_reduce (rmpint * a, const rmpint * m, rmpint_digit mp)
+{
+  rmpint_digit * t;
+  ruint16 n = r_mpint_digits_used (m);
+
+  if (R_UNLIKELY (n == 0 || a->dig_used > 2 * n))
+    return FALSE;
 
-  if (r_mpint_ucmp (a, m) >= 0)
-    r_mpint_sub_unsigned (a, a, m);
+  t = r_alloca ((2 * n + 1) * sizeof (rmpint_digit));
+  r_memcpy (t, a->data, a->dig_used * sizeof (rmpint_digit));
+  r_memset (t + a->dig_used, 0, (2 * n + 1 - a->dig_used) * sizeof (rmpint_digit));
 
+  r_mpint_montgomery_redc (t, m->data, n, mp);
+  r_mpint_montgomery_final_sub (t + n, m->data, n);
+  r_mpint_montgomery_set_result (a, t + n, n);
   return TRUE;
 }
 
@@ -102,3 +138,199 @@ r_mpint_montgomery_normalize (rmpint * a, const rmpint * m)
   return TRUE;
 }
 
+rboolean
+r_mpint_montgomery_ctx_init (RMpintMontCtx * ctx, const rmpint * m)
+{
+  r_memset (ctx, 0, sizeof (RMpintMontCtx));
+
+  if (r_mpint_isneg (m) || !r_mpint_montgomery_setup (&ctx->mp, m))
+    return FALSE;
+
+  r_mpint_init_copy (&ctx->m, m);
+  r_mpint_init_size (&ctx->one, r_mpint_digits_used (m));
+  r_mpint_init_size (&ctx->rr, r_mpint_digits_used (m) * 2);
+  if (!r_mpint_montgomery_normalize (&ctx->one, m) ||
+      !r_mpint_mulmod (&ctx->rr, &ctx->one, &ctx->one, m)) {
+    r_mpint_montgomery_ctx_clear (ctx);
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+void
+r_mpint_montgomery_ctx_clear (RMpintMontCtx * ctx)
+{
+  r_mpint_clear (&ctx->m);
+  r_mpint_clear (&ctx->one);
+  r_mpint_clear (&ctx->rr);
+  ctx->mp = 0;
+}
+
+/* Coarsely Integrated Operand Scanning (CIOS), multiplication and reduction
+ * interleaved per digit so the double width product is never formed.
+ * See Koc, Acar and Kaliski - Analyzing and Comparing Montgomery
+ * Multiplication Algorithms */
+rboolean
+r_mpint_montgomery_mul (rmpint * dst, const rmpint * a, const rmpint * b,
+    const RMpintMontCtx * ctx)
+{
+  const rmpint_digit * m = ctx->m.data;
+  rmpint_digit * t, * ad, * bd, carry, mu;
+  rmpint_word w;
+  ruint16 n = r_mpint_digits_used (&ctx->m);
+  ruint16 i, j;
+
+  if (R_UNLIKELY (n == 0 || a->dig_used > n || b->dig_used > n))
+    return FALSE;
+
+  /* Operands zero padded to the width of the modulus */
+  t = r_alloca ((3 * n + 2) * sizeof (rmpint_digit));
+  ad = t + n + 2;
+  bd = ad + n;
+  r_memset (t, 0, (n + 2) * sizeof (rmpint_digit));
+  r_memcpy (ad, a->data, a->dig_used * sizeof (rmpint_digit));
+  r_memset (ad + a->dig_used, 0, (n - a->dig_used) * sizeof (rmpint_digit));
+  r_memcpy (bd, b->data, b->dig_used * sizeof (rmpint_digit));
+  r_memset (bd + b->dig_used, 0, (n - b->dig_used) * sizeof (rmpint_digit));
+
+  for (i = 0; i < n; i++) {
+    /* t += a * b[i] */
+    carry = 0;
+    for (j = 0; j < n; j++) {
+      w = (rmpint_word)t[j] + (rmpint_word)ad[j] * bd[i] + carry;
+      t[j] = (rmpint_digit)w;
+      carry = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+    }
+    w = (rmpint_word)t[n] + carry;
+    t[n] = (rmpint_digit)w;
+    t[n + 1] = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+
+    /* t = (t + mu * m) / b */
+    mu = t[0] * ctx->mp;
+    w = (rmpint_word)t[0] + (rmpint_word)mu * m[0];
+    carry = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+    for (j = 1; j < n; j++) {
+      w = (rmpint_word)t[j] + (rmpint_word)mu * m[j] + carry;
+      t[j - 1] = (rmpint_digit)w;
+      carry = (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+    }
+    w = (rmpint_word)t[n] + carry;
+    t[n - 1] = (rmpint_digit)w;
+    t[n] = t[n + 1] + (rmpint_digit)(w >> RMPINT_DIGIT_BITS);
+  }
+
+  r_mpint_montgomery_final_sub (t, m, n);
+  r_mpint_montgomery_set_result (dst, t, n);
+  return TRUE;
+}
+
+/* Separated squaring and reduction, the square needs about half the digit
+ * multiplications of a generic product */
+rboolean
+r_mpint_montgomery_sqr (rmpint * dst, const rmpint * a,
+    const RMpintMontCtx * ctx)
+{
+  rmpint_digit * t;
+  ruint16 n = r_mpint_digits_used (&ctx->m);
+  ruint16 used = r_mpint_digits_used (a);
+
+  if (R_UNLIKELY (n == 0 || used > n))
+    return FALSE;
+
+  t = r_alloca ((2 * n + 1) * sizeof (rmpint_digit));
+  r_mpint_sqr_digits (t, a->data, used);
+  r_memset (t + 2 * used, 0, (2 * (n - used) + 1) * sizeof (rmpint_digit));
+
+  r_mpint_montgomery_redc (t, ctx->m.data, n, ctx->mp);
+  r_mpint_montgomery_final_sub (t + n, ctx->m.data, n);
+  r_mpint_montgomery_set_result (dst, t + n, n);
+  return TRUE;
+}
+
+#define RMPINT_EXPMOD_MAX_WINDOW    6
+
+static ruint
+r_mpint_expmod_window_bits (ruint bits)
+{
+  if (bits > 671) return 6;
+  if (bits > 239) return 5;
+  if (bits >  79) return 4;
+  if (bits >  23) return 3;
+  return 1;
+}
+
+static inline ruint
+r_mpint_get_bits (const rmpint * e, ruint pos, ruint count)
+{
+  ruint d = pos / RMPINT_DIGIT_BITS, off = pos % RMPINT_DIGIT_BITS;
+  rmpint_word v = r_mpint_get_digit (e, d) >> off;
+
+  if (off + count > RMPINT_DIGIT_BITS && d + 1 < r_mpint_digits_used (e))
+    v |= (rmpint_word)r_mpint_get_digit (e, d + 1) << (RMPINT_DIGIT_BITS - off);
+  return (ruint)(v & ((1u << count) - 1));
+}
+
+/* Fixed window exponentiation, the same sequence of squarings and
+ * multiplications is done for every exponent of the same bit length */
+rboolean
+r_mpint_expmod_montgomery (rmpint * dst, const rmpint * b, const rmpint * e,
+    const RMpintMontCtx * ctx)
+{
+  rmpint tbl[1 << RMPINT_EXPMOD_MAX_WINDOW], acc;
+  ruint16 n = r_mpint_digits_used (&ctx->m);
+  ruint bits, w, wins, i, k;
+  rboolean ret = FALSE;
+
+  if (R_UNLIKELY (dst == NULL || b == NULL || e == NULL || ctx == NULL))
+    return FALSE;
+  if (R_UNLIKELY (!r_mpint_montgomery_ctx_is_valid (ctx) || r_mpint_isneg (e)))
+    return FALSE;
+
+  bits = r_mpint_bits_used (e);
+  w = r_mpint_expmod_window_bits (bits);
+  wins = (bits + w - 1) / w;
+
+  for (i = 0; i < (1u << w); i++)
+    r_mpint_init_size (&tbl[i], n);
+  r_mpint_init_size (&acc, n);
+
+  /* tbl[i] = b^i * R mod m */
+  r_mpint_set (&tbl[0], &ctx->one);
+  if (r_mpint_isneg (b) || r_mpint_ucmp (b, &ctx->m) >= 0) {
+    if (!r_mpint_mod (&tbl[1], b, &ctx->m))
+      goto beach;
+  } else {
+    r_mpint_set (&tbl[1], b);
+  }
+  if (!r_mpint_montgomery_mul (&tbl[1], &tbl[1], &ctx->rr, ctx))
+    goto beach;
+  for (i = 2; i < (1u << w); i++) {
+    if (!r_mpint_montgomery_mul (&tbl[i], &tbl[i - 1], &tbl[1], ctx))
+      goto beach;
+  }
+
+  r_mpint_set (&acc, &ctx->one);
+  for (i = wins; i > 0; i--) {
+    if (i < wins) {
+      for (k = 0; k < w; k++) {
+        if (!r_mpint_montgomery_sqr (&acc, &acc, ctx))
+          goto beach;
+      }
+    }
+    if (!r_mpint_montgomery_mul (&acc, &acc,
+          &tbl[r_mpint_get_bits (e, (i - 1) * w, w)], ctx))
+      goto beach;
+  }
+
+  /* Out of Montgomery form */
+  r_mpint_set_u32 (&tbl[0], 1);
+  if ((ret = r_mpint_montgomery_mul (&acc, &acc, &tbl[0], ctx)))
+    r_mpint_set (dst, &acc);
+
+beach:
+  for (i = 0; i < (1u << w); i++)
+    r_mpint_clear (&tbl[i]);
+  r_mpint_clear (&acc);
+  return ret;
+}
@@ -19,6 +19,14 @@
 #include "config.h"
 #include <rlib/data/rqueue.h>
 
+#include <rlib/ratomic.h>
+#include <rlib/rmem.h>
+
+/* Keeps the producer and consumer ends of the lock-free rings apart */
+#define R_QUEUE_CACHE_LINE    64
+/* Positions are ruint and wrap around, which works for up to half of it */
+#define R_QUEUE_LOCKFREE_MAX  (RUINT32_MAX / 2 + 1)
+
 struct _RQueueRing {
   RRef ref;
 
@@ -112,3 +120,286 @@ r_queue_ring_is_empty (RQueueRing * q)
 }
 
 
+static ruint
+r_queue_lockfree_capacity (rsize size)
+{
+  ruint ret;
+
+  if (R_UNLIKELY (size == 0 || size > R_QUEUE_LOCKFREE_MAX))
+    return 0;
+
+  for (ret = 1; ret < size; ret <<= 1);
+  return ret;
+}
+
+/* Single producer single consumer, a plain ring where each end only writes
+ * its own position. Each end keeps a cached copy of the other position and
+ * only reloads it when the ring looks full or empty. */
+struct _RQueueSPSC {
+  RRef ref;
+
+  rpointer * buffer;
+  ruint mask;
+
+  ruint8 pad0[R_QUEUE_CACHE_LINE];
+  rauint tail;
+  ruint headcache;
+  ruint8 pad1[R_QUEUE_CACHE_LINE];
+  rauint head;
+  ruint tailcache;
+  ruint8 pad2[R_QUEUE_CACHE_LINE];
+};
+
+static void
+r_queue_spsc_free (RQueueSPSC * q)
+{
+  if (R_LIKELY (q != NULL)) {
+    r_free (q->buffer);
+    r_free (q);
+  }
+}
+
+RQueueSPSC *
+r_queue_spsc_new (rsize size)
+{
+  RQueueSPSC * ret;
+  ruint capacity;
+
+  if (R_UNLIKELY ((capacity = r_queue_lockfree_capacity (size)) == 0))
+    return NULL;
+
+  if ((ret = r_mem_new0 (RQueueSPSC)) != NULL) {
+    r_ref_init (ret, r_queue_spsc_free);
+
+    ret->mask = capacity - 1;
+    if (R_UNLIKELY ((ret->buffer = r_mem_new_n (rpointer, capacity)) == NULL)) {
+      r_queue_spsc_unref (ret);
+      ret = NULL;
+    }
+  }
+
+  return ret;
+}
+
+rsize
+r_queue_spsc_push_n (RQueueSPSC * q, rpointer const * items, rsize count)
+{
+  ruint tail = r_atomic_uint_load (&q->tail);
+  rsize i, space;
+
+  if ((space = q->mask + 1 - (tail - q->headcache)) < count) {
+    q->headcache = r_atomic_uint_load (&q->head);
+    space = q->mask + 1 - (tail - q->headcache);
+  }
+
+  count = MIN (count, space);
+  for (i = 0; i < count; i++)
+    q->buffer[(tail + i) & q->mask] = items[i];
+  if (count > 0)
+    r_atomic_uint_store (&q->tail, tail + (ruint)count);
+
+  return count;
+}
+
+rsize
+r_queue_spsc_pop_n (RQueueSPSC * q, rpointer * items, rsize count)
+{
+  ruint head = r_atomic_uint_load (&q->head);
+  rsize i, avail;
+
+  if ((avail = q->tailcache - head) < count) {
+    q->tailcache = r_atomic_uint_load (&q->tail);
+    avail = q->tailcache - head;
+  }
+
+  count = MIN (count, avail);
+  for (i = 0; i < count; i++)
+    items[i] = q->buffer[(head + i) & q->mask];
+  if (count > 0)
+    r_atomic_uint_store (&q->head, head + (ruint)count);
+
+  return count;
+}
+
+rboolean
+r_queue_spsc_push (RQueueSPSC * q, rpointer item)
+{
+  if (R_UNLIKELY (item == NULL)) return FALSE;
+  return r_queue_spsc_push_n (q, &item, 1) == 1;
+}
+
+rpointer
+r_queue_spsc_pop (RQueueSPSC * q)
+{
+  rpointer ret;
+  return r_queue_spsc_pop_n (q, &ret, 1) == 1 ? ret : NULL;
+}
+
+rsize
+r_queue_spsc_size (RQueueSPSC * q)
+{
+  ruint head = r_atomic_uint_load (&q->head);
+  ruint tail = r_atomic_uint_load (&q->tail);
+  return (rsint)(tail - head) > 0 ? MIN (tail - head, q->mask + 1) : 0;
+}
+
+rsize
+r_queue_spsc_capacity (const RQueueSPSC * q)
+{
+  return q->mask + 1;
+}
+
+
+/* Multi producer multi consumer, as described by Dmitry Vyukov. Every cell
+ * has a sequence number telling whether it is free for the producer at
+ * position pos (seq == pos) or filled for the consumer at pos (seq == pos+1).
+ * Producers and consumers claim positions by moving tail and head with CAS,
+ * the batch variants claim a run of cells at once. */
+typedef struct {
+  rauint seq;
+  rpointer data;
+} RQueueMPMCCell;
+
+struct _RQueueMPMC {
+  RRef ref;
+
+  RQueueMPMCCell * cells;
+  ruint mask;
+
+  ruint8 pad0[R_QUEUE_CACHE_LINE];
+  rauint tail;
+  ruint8 pad1[R_QUEUE_CACHE_LINE];
+  rauint head;
+  ruint8 pad2[R_QUEUE_CACHE_LINE];
+};
+
+static void
+r_queue_mpmc_free (RQueueMPMC * q)
+{
+  if (R_LIKELY (q != NULL)) {
+    r_free (q->cells);
+    r_free (q);
+  }
+}
+
+RQueueMPMC *
+r_queue_mpmc_new (rsize size)
+{
+  RQueueMPMC * ret;
+  ruint i, capacity;
+
+  if (R_UNLIKELY ((capacity = r_queue_lockfree_capacity (size)) == 0))
+    return NULL;
+
+  if ((ret = r_mem_new0 (RQueueMPMC)) != NULL) {
+    r_ref_init (ret, r_queue_mpmc_free);
+
+    ret->mask = capacity - 1;
+    if (R_LIKELY ((ret->cells = r_mem_new_n (RQueueMPMCCell, capacity)) != NULL)) {
+      for (i = 0; i < capacity; i++)
+        r_atomic_uint_store (&ret->cells[i].seq, i);
+    } else {
+      r_queue_mpmc_unref (ret);
+      ret = NULL;
+    }
+  }
+
+  return ret;
+}
+
+rsize
+r_queue_mpmc_push_n (RQueueMPMC * q, rpointer const * items, rsize count)
+{
+  RQueueMPMCCell * cell;
+  ruint pos, n, i;
+
+  count = MIN (count, q->mask + 1);
+  pos = r_atomic_uint_load (&q->tail);
+  for (;;) {
+    for (n = 0; n < count; n++) {
+      cell = &q->cells[(pos + n) & q->mask];
+      if (r_atomic_uint_load (&cell->seq) != pos + n)
+        break;
+    }
+
+    if (n > 0) {
+      if (r_atomic_uint_cmp_xchg_weak (&q->tail, &pos, pos + n))
+        break;
+    } else if ((rsint)(r_atomic_uint_load (&q->cells[pos & q->mask].seq) - pos) < 0) {
+      return 0; /* Full */
+    } else {
+      pos = r_atomic_uint_load (&q->tail);
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    cell = &q->cells[(pos + i) & q->mask];
+    cell->data = items[i];
+    r_atomic_uint_store (&cell->seq, pos + i + 1);
+  }
+
+  return n;
+}
+
+rsize
+r_queue_mpmc_pop_n (RQueueMPMC * q, rpointer * items, rsize count)
+{
+  RQueueMPMCCell * cell;
+  ruint pos, n, i;
+
+  count = MIN (count, q->mask + 1);
+  pos = r_atomic_uint_load (&q->head);
+  for (;;) {
+    for (n = 0; n < count; n++) {
+      cell = &q->cells[(pos + n) & q->mask];
+      if (r_atomic_uint_load (&cell->seq) != pos + n + 1)
+        break;
+    }
+
+    if (n > 0) {
+      if (r_atomic_uint_cmp_xchg_weak (&q->head, &pos, pos + n))
+        break;
+    } else if ((rsint)(r_atomic_uint_load (&q->cells[pos & q->mask].seq) - (pos + 1)) < 0) {
+      return 0; /* Empty */
+    } else {
+      pos = r_atomic_uint_load (&q->head);
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    cell = &q->cells[(pos + i) & q->mask];
+    items[i] = cell->data;
+    r_atomic_uint_store (&cell->seq, pos + i + q->mask + 1);
+  }
+
+  return n;
+}
+
+rboolean
+r_queue_mpmc_push (RQueueMPMC * q, rpointer item)
+{
+  if (R_UNLIKELY (item == NULL)) return FALSE;
+  return r_queue_mpmc_push_n (q, &item, 1) == 1;
+}
+
+rpointer
+r_queue_mpmc_pop (RQueueMPMC * q)
+{
+  rpointer ret;
+  return r_queue_mpmc_pop_n (q, &ret, 1) == 1 ? ret : NULL;
+}
+
+rsize
+r_queue_mpmc_size (RQueueMPMC * q)
+{
+  ruint head = r_atomic_uint_load (&q->head);
+  ruint tail = r_atomic_uint_load (&q->tail);
+  return (rsint)(tail - head) > 0 ? MIN (tail - head, q->mask + 1) : 0;
+}
+
+rsize
+r_queue_mpmc_capacity (const RQueueMPMC * q)
+{
+  return q->mask + 1;
+}
+
@@ -20,8 +20,9 @@
 struct _RToCB {
   RRef ref;
   RTimeoutCBList * lst;
-  RToCB * next;
-  RToCB * prev;
+  rsize idx;
+  ruint64 seq;
+  RToCB * next; /* Link in RTimeoutCBList::pool when released */
   RClockTime ts;
   RFunc cb;
   rpointer data;
@@ -34,7 +35,8 @@ static inline void
 r_to_cb_init (RToCB * tocb, RClockTime ts, RFunc cb,
     rpointer data, RDestroyNotify datanotify, rpointer user, RDestroyNotify usernotify)
 {
-  tocb->next = tocb->prev = NULL;
+  tocb->lst = NULL;
+  tocb->next = NULL;
   tocb->ts = ts;
   tocb->cb = cb;
   tocb->data = data;
@@ -51,43 +53,3 @@ r_to_cb_deinit (RToCB * tocb)
   if (tocb->usernotify != NULL)
     tocb->usernotify (tocb->user);
 }
-
-static inline void
-r_timeout_cblist_internal_insert (RTimeoutCBList * lst, RToCB * tocb)
-{
-  RToCB * it;
-
-  tocb->lst = lst;
-  if (lst->head == NULL) {
-    lst->head = lst->tail = tocb;
-  } else if (tocb->ts >= lst->tail->ts) { /* last */
-    tocb->prev = lst->tail;
-    lst->tail->next = tocb;
-    lst->tail = tocb;
-  } else if (tocb->ts < lst->head->ts) { /* first */
-    tocb->next = lst->head;
-    lst->head->prev = tocb;
-    lst->head = tocb;
-  } else if (tocb->ts - lst->head->ts > lst->tail->ts - tocb->ts) { /* iterate backwards */
-    for (it = lst->tail->prev; tocb->ts < it->ts; it = it->prev)
-      ;
-
-    /* insert after it */
-    tocb->next = it->next;
-    tocb->prev = it;
-    it->next->prev = tocb;
-    it->next = tocb;
-  } else { /* iterate forwards */
-    for (it = lst->head->next; tocb->ts >= it->ts; it = it->next)
-      ;
-
-    /* insert before it */
-    tocb->prev = it->prev;
-    tocb->next = it;
-    it->prev->next = tocb;
-    it->prev = tocb;
-  }
-
-  lst->size++;
-}
-
@@ -21,12 +21,11 @@
 
 #include <rlib/rmem.h>
 
-#define r_to_cb_internal_free(tocb)                                           \
-  R_STMT_START {                                                              \
-    (tocb)->next = (tocb)->prev = NULL;                                       \
-    (tocb)->lst = NULL;                                                       \
-    r_to_cb_unref (tocb);                                                     \
-  } R_STMT_END
+#define R_TIMEOUT_CBLIST_D          4
+#define R_TIMEOUT_CBLIST_MIN_ALLOC  64
+
+#define r_to_cb_is_before(a, b)                                               \
+  ((a)->ts < (b)->ts || ((a)->ts == (b)->ts && (a)->seq < (b)->seq))
 
 static void
 r_to_cb_free (RToCB * cb)
@@ -36,28 +35,142 @@ r_to_cb_free (RToCB * cb)
 }
 
 static RToCB *
-r_to_cb_alloc (RClockTime ts, RFunc cb,
+r_to_cb_alloc (RTimeoutCBList * lst, RClockTime ts, RFunc cb,
     rpointer data, RDestroyNotify datanotify, rpointer user, RDestroyNotify usernotify)
 {
   RToCB * ret;
-  if ((ret = r_mem_new (RToCB)) != NULL) {
-    r_ref_init (ret, r_to_cb_free);
-    r_to_cb_init (ret, ts, cb, data, datanotify, user, usernotify);
+
+  if ((ret = lst->pool) != NULL) {
+    lst->pool = ret->next;
+    lst->poolsize--;
+  } else if ((ret = r_mem_new (RToCB)) == NULL) {
+    return NULL;
+  }
+
+  r_ref_init (ret, r_to_cb_free);
+  r_to_cb_init (ret, ts, cb, data, datanotify, user, usernotify);
+  return ret;
+}
+
+/* Drop the reference held by the list. If nobody else holds on to the RToCB
+ * it is deinitialized and put back in the pool instead of being freed. */
+static void
+r_timeout_cblist_release (RTimeoutCBList * lst, RToCB * tocb)
+{
+  tocb->lst = NULL;
+
+  if (r_ref_refcount (tocb) == 1 &&
+      r_atomic_ptr_load (&tocb->ref.weaklst) == NULL &&
+      lst->poolsize < lst->alloc) {
+    r_to_cb_deinit (tocb);
+    tocb->next = lst->pool;
+    lst->pool = tocb;
+    lst->poolsize++;
+  } else {
+    r_to_cb_unref (tocb);
+  }
+}
+
+static void
+r_timeout_cblist_sift_up (RTimeoutCBList * lst, rsize idx)
+{
+  RToCB * tocb = lst->heap[idx];
+
+  while (idx > 0) {
+    rsize parent = (idx - 1) / R_TIMEOUT_CBLIST_D;
+    if (!r_to_cb_is_before (tocb, lst->heap[parent]))
+      break;
+    lst->heap[idx] = lst->heap[parent];
+    lst->heap[idx]->idx = idx;
+    idx = parent;
+  }
+
+  lst->heap[idx] = tocb;
+  tocb->idx = idx;
+}
+
+static void
+r_timeout_cblist_sift_down (RTimeoutCBList * lst, rsize idx)
+{
+  RToCB * tocb = lst->heap[idx];
+  rsize first, last, best, i;
+
+  while ((first = idx * R_TIMEOUT_CBLIST_D + 1) < lst->size) {
+    last = MIN (first + R_TIMEOUT_CBLIST_D, lst->size);
+    for (best = first, i = first + 1; i < last; i++) {
+      if (r_to_cb_is_before (lst->heap[i], lst->heap[best]))
+        best = i;
+    }
+
+    if (!r_to_cb_is_before (lst->heap[best], tocb))
+      break;
+    lst->heap[idx] = lst->heap[best];
+    lst->heap[idx]->idx = idx;
+    idx = best;
+  }
+
+  lst->heap[idx] = tocb;
+  tocb->idx = idx;
+}
+
+static RToCB *
+r_timeout_cblist_remove_at (RTimeoutCBList * lst, rsize idx)
+{
+  RToCB * ret = lst->heap[idx];
+  RToCB * last = lst->heap[--lst->size];
+
+  if (idx < lst->size) {
+    lst->heap[idx] = last;
+    last->idx = idx;
+    if (idx > 0 && r_to_cb_is_before (last,
+          lst->heap[(idx - 1) / R_TIMEOUT_CBLIST_D]))
+      r_timeout_cblist_sift_up (lst, idx);
+    else
+      r_timeout_cblist_sift_down (lst, idx);
   }
+
   return ret;
 }
 
+static rboolean
+r_timeout_cblist_internal_insert (RTimeoutCBList * lst, RToCB * tocb)
+{
+  if (R_UNLIKELY (lst->size == lst->alloc)) {
+    rsize alloc = MAX (lst->alloc * 2, R_TIMEOUT_CBLIST_MIN_ALLOC);
+    RToCB ** heap;
+
+    if ((heap = r_realloc (lst->heap, alloc * sizeof (RToCB *))) == NULL)
+      return FALSE;
+    lst->heap = heap;
+    lst->alloc = alloc;
+  }
+
+  tocb->lst = lst;
+  tocb->seq = lst->seq++;
+  lst->heap[lst->size] = tocb;
+  r_timeout_cblist_sift_up (lst, lst->size++);
+  return TRUE;
+}
+
 void
 r_timeout_cblist_clear (RTimeoutCBList * lst)
 {
-  RToCB * it = lst->head;
+  RToCB ** heap = lst->heap;
+  RToCB * it = lst->pool;
+  rsize i, size = lst->size;
 
   r_timeout_cblist_init (lst);
 
+  for (i = 0; i < size; i++) {
+    heap[i]->lst = NULL;
+    r_to_cb_unref (heap[i]);
+  }
+  r_free (heap);
+
   while (it != NULL) {
     RToCB * cur = it;
     it = it->next;
-    r_to_cb_internal_free (cur);
+    r_free (cur);
   }
 }
 
@@ -68,11 +181,14 @@ r_timeout_cblist_insert (RTimeoutCBList * lst,
 {
   RToCB * tocb;
 
-  if ((tocb = r_to_cb_alloc (ts, cb, data, datanotify, user, usernotify)) != NULL) {
-    r_timeout_cblist_internal_insert (lst, tocb);
-    if (out != NULL)
-      *out = r_to_cb_ref (tocb);
-    return TRUE;
+  if ((tocb = r_to_cb_alloc (lst, ts, cb, data, datanotify, user, usernotify)) != NULL) {
+    if (R_LIKELY (r_timeout_cblist_internal_insert (lst, tocb))) {
+      if (out != NULL)
+        *out = r_to_cb_ref (tocb);
+      return TRUE;
+    }
+
+    r_to_cb_unref (tocb);
   }
 
   if (out != NULL)
@@ -83,32 +199,18 @@ r_timeout_cblist_insert (RTimeoutCBList * lst,
 rboolean
 r_timeout_cblist_cancel (RTimeoutCBList * lst, RToCB * cb)
 {
-  RToCB * next, * prev;
-
   if (R_UNLIKELY (cb == NULL)) return FALSE;
   if (R_UNLIKELY (cb->lst != lst)) return FALSE;
 
-  if (cb == lst->head)
-    lst->head = cb->next;
-  if (cb == lst->tail)
-    lst->tail = cb->prev;
-
-  prev = cb->prev;
-  next = cb->next;
-  if (prev != NULL)
-    prev->next = cb->next;
-  if (next != NULL)
-    next->prev = cb->prev;
-
-  r_to_cb_internal_free (cb);
-  lst->size--;
+  r_timeout_cblist_remove_at (lst, cb->idx);
+  r_timeout_cblist_release (lst, cb);
   return TRUE;
 }
 
 RClockTime
 r_timeout_cblist_first_timeout (RTimeoutCBList * lst)
 {
-  return (lst->head != NULL) ? lst->head->ts : R_CLOCK_TIME_NONE;
+  return (lst->size > 0) ? lst->heap[0]->ts : R_CLOCK_TIME_NONE;
 }
 
 rsize
@@ -116,26 +218,17 @@ r_timeout_cblist_update (RTimeoutCBList * lst, RClockTime ts)
 {
   rsize ret = 0;
 
-  while (lst->head != NULL) {
-    RToCB * cur = lst->head;
-
-    if (ts < cur->ts)
-      break;
+  while (lst->size > 0 && lst->heap[0]->ts <= ts) {
+    RToCB * cur = r_timeout_cblist_remove_at (lst, 0);
 
+    /* Detach before invoking, so the callback can't cancel it under us */
+    cur->lst = NULL;
     if (R_LIKELY (cur->cb != NULL))
       cur->cb (cur->data, cur->user);
 
-    lst->head = lst->head->next;
-    r_to_cb_internal_free (cur);
+    r_timeout_cblist_release (lst, cur);
     ret++;
   }
 
-  if (lst->head != NULL)
-    lst->head->prev = NULL;
-  else
-    lst->tail = NULL;
-
-  lst->size -= ret;
   return ret;
 }
-
@@ -40,15 +40,35 @@ R_API_HIDDEN R_LOG_CATEGORY_DEFINE_EXTERN (revlogcat);
 
 R_API_HIDDEN void r_ev_loop_add_cb_after (REvLoop * loop, RFunc func,
     rpointer data, RDestroyNotify datanotify, rpointer user, RDestroyNotify usernotify);
+/* Keep running in R_EV_LOOP_RUN_LOOP without sources, until r_ev_loop_stop */
+R_API_HIDDEN void r_ev_loop_keepalive (REvLoop * loop, rboolean keepalive);
 
 typedef enum {
   R_EV_IO_FLAGS_NONE  = 0,
   R_EV_IO_ADDED       = (1 << 0),
   R_EV_IO_INTERNAL    = (1 << 1),
   R_EV_IO_CLOSED      = (1 << 2),
+  R_EV_IO_RING_MSG    = (1 << 3), /* ringrecv wants the source address */
+  R_EV_IO_RING_EOF    = (1 << 4), /* ringrecv got EOF or error, not re-armed */
 } REvIOFlag;
 typedef ruint32 REvIOFlags;
 
+/* Completion based IO, only used with the io_uring backend. The op is owned
+ * by whoever submitted it, and func is called for every completion. evio is
+ * set to NULL when the REvIO goes away while the op is still in flight. */
+typedef struct _REvIOOp REvIOOp;
+typedef void (*REvIOOpFunc) (REvIOOp * op, int res, ruint flags, rboolean last);
+struct _REvIOOp {
+  REvIO * evio;
+  REvIOOpFunc func;
+};
+
+/* Data received by the loop on behalf of evio, only valid during the call.
+ * size is 0 for EOF and -errno on error. more is TRUE when the next
+ * completion is already known to be for the same REvIO. */
+typedef void (*REvIORingRecvFunc) (REvIO * evio, rconstpointer data, rssize size,
+    rconstpointer name, rsize namelen, rboolean more);
+
 struct _REvIO {
   RRef ref;
 
@@ -63,6 +83,11 @@ struct _REvIO {
 
   rpointer user;
   RDestroyNotify usernotify;
+
+  /* io_uring backend */
+  REvIORingRecvFunc ringrecv;
+  REvIOOp * pollop;
+  REvIOOp * recvop;
 };
 
 #define R_EV_IO_FORMAT        "%p [%"R_IO_HANDLE_FMT"]"
@@ -79,11 +104,26 @@ R_API_HIDDEN void r_ev_io_init (REvIO * evio, REvLoop * loop, RIOHandle handle,
 R_API_HIDDEN void r_ev_io_clear (REvIO * evio);
 R_API_HIDDEN rboolean r_ev_io_validate_taskgroup (REvIO * evio, ruint taskgroup);
 
+R_API_HIDDEN void r_ev_loop_count_syscalls (REvLoop * loop, ruint count);
+#define r_ev_io_count_syscalls(evio, count)                                   \
+  r_ev_loop_count_syscalls ((evio)->loop, count)
+
+/* TRUE if the loop of evio runs the io_uring backend */
+R_API_HIDDEN rboolean r_ev_io_ring_enabled (const REvIO * evio);
+/* Receive into loop owned buffers instead of invoking the READABLE iocb */
+R_API_HIDDEN void r_ev_io_set_ring_recv (REvIO * evio, REvIORingRecvFunc recv, rboolean msg);
+/* msg is a struct msghdr which must be kept alive until op completes.
+ * handle is passed explicitly as it outlives the REvIO handle on close. */
+R_API_HIDDEN rboolean r_ev_loop_ring_sendmsg (REvLoop * loop, RIOHandle handle,
+    REvIOOp * op, rpointer msg);
+
 #define r_ev_io_invoke_iocb(evio, events)                                     \
   R_STMT_START {                                                              \
-    RCBList * it;                                                             \
+    RCBList * it, * next;                                                     \
     REvIOCB iocb;                                                             \
-    for (it = evio->iocbq.head; it != NULL; it = it->next) {                  \
+    /* The callback might stop itself, freeing it */                          \
+    for (it = evio->iocbq.head; it != NULL; it = next) {                      \
+      next = it->next;                                                        \
       iocb = (REvIOCB) it->data.cb;                                           \
       iocb (it->data.data, events, evio);                                     \
     }                                                                         \
@@ -22,9 +22,11 @@
 
 #include <rlib/rassert.h>
 #include <rlib/ratomic.h>
+#include <rlib/renv.h>
 #include <rlib/rio.h>
 #include <rlib/rmem.h>
 #include <rlib/rpoll.h>
+#include <rlib/rstr.h>
 #include <rlib/rthreads.h>
 
 #ifdef HAVE_UNISTD_H
@@ -56,15 +58,78 @@
 #define USE_WAKEUP  1
 #endif
 
+/* io_uring is selected at runtime on top of epoll */
+#if defined (USE_EPOLL) && defined (HAVE_IO_URING)
+#define USE_IO_URING  1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <signal.h>
+#endif
+
+/* High resolution timers need epoll_pwait2, which glibc only wraps since
+ * 2.35 while the syscall is there since Linux 5.11 */
+#if defined (USE_EPOLL) && defined (HAVE_EPOLL_PWAIT2)
+#define USE_EPOLL_PWAIT2  1
+#define r_epoll_pwait2    epoll_pwait2
+#elif defined (USE_EPOLL) && defined (__linux__)
+#include <sys/syscall.h>
+#if defined (__NR_epoll_pwait2)
+#define USE_EPOLL_PWAIT2  1
+static int
+r_epoll_pwait2 (int epfd, struct epoll_event * events, int maxevents,
+    const struct timespec * timeout, const void * sigmask)
+{
+  /* The kernel takes a 64bit struct __kernel_timespec everywhere */
+  struct { rint64 sec, nsec; } ts, * pts = NULL;
+
+  if (timeout != NULL) {
+    ts.sec = timeout->tv_sec;
+    ts.nsec = timeout->tv_nsec;
+    pts = &ts;
+  }
+
+  return (int)syscall (__NR_epoll_pwait2, epfd, events, maxevents, pts,
+      sigmask, (rsize)8);
+}
+#endif
+#endif
+
 
 R_LOG_CATEGORY_DEFINE (revlogcat, "ev", "RLib EvLoop",
     R_CLR_BG_CYAN | R_CLR_FG_RED | R_CLR_FMT_BOLD);
 #define R_LOG_CAT_DEFAULT &revlogcat
 
+static REvLoopBackend g__r_ev_loop_backend = R_EV_LOOP_BACKEND_DEFAULT;
+
 void
 r_ev_loop_init (void)
 {
+  const rchar * env;
+
   r_log_category_register (&revlogcat);
+
+  if ((env = r_getenv ("R_EV_LOOP_BACKEND")) != NULL) {
+    REvLoopBackend backend;
+
+    if (r_str_equals (env, "io_uring"))
+      backend = R_EV_LOOP_BACKEND_IO_URING;
+    else if (r_str_equals (env, "epoll"))
+      backend = R_EV_LOOP_BACKEND_EPOLL;
+    else if (r_str_equals (env, "kqueue"))
+      backend = R_EV_LOOP_BACKEND_KQUEUE;
+    else if (r_str_equals (env, "poll"))
+      backend = R_EV_LOOP_BACKEND_POLL;
+    else
+      backend = R_EV_LOOP_BACKEND_DEFAULT;
+
+    if (r_ev_loop_backend_is_supported (backend)) {
+      g__r_ev_loop_backend = backend;
+    } else {
+      R_LOG_WARNING ("R_EV_LOOP_BACKEND=%s not supported, using default", env);
+    }
+  }
 }
 
 void
@@ -79,21 +144,84 @@ static RTss  g__r_ev_loop_tss = R_TSS_INIT (NULL);
 static void r_ev_loop_wakeup_cb (rpointer data, REvIOEvents events, REvIO * evio);
 #endif
 
+/* Callback handed to the loop from any thread. notify is called with the
+ * message itself once func has been called, or when the loop goes away. */
+typedef struct _REvLoopMsg REvLoopMsg;
+struct _REvLoopMsg {
+  raptr next;
+  REvFunc func;
+  rpointer data;
+  RDestroyNotify notify;
+};
+
+#ifdef USE_IO_URING
+#define R_EV_RING_ENTRIES         256
+#define R_EV_RING_BUFS            256 /* Must be a power of 2 */
+/* Room for struct io_uring_recvmsg_out and a sockaddr in front of 4k data */
+#define R_EV_RING_BUF_SIZE        (4096 + 256)
+#define R_EV_RING_BGID            0
+
+typedef struct {
+  int fd;
+  rauint * sqhead;
+  rauint * sqtail;
+  ruint sqmask;
+  ruint sqentries;
+  ruint sqlocal;
+  struct io_uring_sqe * sqes;
+  rauint * cqhead;
+  rauint * cqtail;
+  ruint cqmask;
+  struct io_uring_cqe * cqes;
+
+  rpointer rmem;
+  rsize rmemsize;
+  rsize sqesize;
+
+  /* Provided buffers for multishot recv, allocated on first use */
+  struct io_uring_buf_ring * br;
+  ruint8 * bufs;
+  ruint16 brtail;
+  rboolean norecv;
+
+  ruint inflight;
+} REvLoopRing;
+
+typedef struct {
+  REvIOOp op;
+  REvLoop * loop;
+  struct msghdr msg;
+} REvLoopRingRecvOp;
+
+static rboolean r_ev_loop_ring_setup (REvLoopRing * ring);
+static void r_ev_loop_ring_clear (REvLoop * loop);
+static void r_ev_io_ring_detach (REvIO * evio);
+#endif
+
 
 struct _REvLoop {
   RRef ref;
 
+  REvLoopBackend backend;
   rsize iterations;
   rsize idle_count;
+  rauint syscalls;
+  REvLoopStats stats;
 
   rboolean stop_request;
+  rboolean hirestimers;
+  rboolean keepalive;
   RClockTime ts;
   RClock * clock;
 
   RTaskQueue * tq;
   rauint tqitems;
-  RCBQueue dcbs;
-  RMutex done_mutex;
+
+  /* Intrusive MPSC FIFO of REvLoopMsg, popped by the loop thread only */
+  raptr msghead;
+  REvLoopMsg * msgtail;
+  REvLoopMsg msgstub;
+  rauint msgwakeup; /* TRUE while a wakeup is pending */
 
   /* Wakeup handle for backends not supporting it natively */
 #ifdef USE_WAKEUP
@@ -110,14 +238,62 @@ struct _REvLoop {
   RIOHandle handle;
 #ifdef USE_RPOLL
   RPollSet pollset;
+#endif
+#ifdef USE_IO_URING
+  REvLoopRing ring;
 #endif
   RQueue active;
   RQueue chg;
 };
 
+static void
+r_ev_loop_msg_push (REvLoop * loop, REvLoopMsg * msg)
+{
+  REvLoopMsg * prev;
+
+  r_atomic_ptr_store (&msg->next, NULL);
+  prev = r_atomic_ptr_exchange (&loop->msghead, msg);
+  r_atomic_ptr_store (&prev->next, msg);
+}
+
+/* Returns NULL when empty, or when the next message is still being pushed */
+static REvLoopMsg *
+r_ev_loop_msg_pop (REvLoop * loop)
+{
+  REvLoopMsg * tail = loop->msgtail;
+  REvLoopMsg * next = r_atomic_ptr_load (&tail->next);
+
+  if (tail == &loop->msgstub) {
+    if (next == NULL)
+      return NULL;
+    loop->msgtail = tail = next;
+    next = r_atomic_ptr_load (&tail->next);
+  }
+
+  if (next == NULL) {
+    /* Last one, requeue the stub behind it unless a push is in progress */
+    if (tail != r_atomic_ptr_load (&loop->msghead))
+      return NULL;
+    r_ev_loop_msg_push (loop, &loop->msgstub);
+    if ((next = r_atomic_ptr_load (&tail->next)) == NULL)
+      return NULL;
+  }
+
+  loop->msgtail = next;
+  return tail;
+}
+
+static inline rboolean
+r_ev_loop_has_msgs (REvLoop * loop)
+{
+  return loop->msgtail != &loop->msgstub ||
+    r_atomic_ptr_load (&loop->msgstub.next) != NULL;
+}
+
 static void
 r_ev_loop_free (REvLoop * loop)
 {
+  REvLoopMsg * msg;
   REvLoop * prev = loop;
   r_atomic_ptr_cmp_xchg_strong (&g__r_ev_loop_default, &prev, NULL);
 
@@ -129,6 +305,11 @@ r_ev_loop_free (REvLoop * loop)
   r_ev_wakeup_clear (&loop->evio_wakeup);
 #endif
 
+#ifdef USE_IO_URING
+  if (loop->backend == R_EV_LOOP_BACKEND_IO_URING)
+    r_ev_loop_ring_clear (loop);
+#endif
+
   r_queue_clear (&loop->chg, NULL);
   r_queue_clear (&loop->active, NULL);
   r_cbrlist_destroy (loop->prepare);  loop->prepare = NULL;
@@ -138,10 +319,8 @@ r_ev_loop_free (REvLoop * loop)
 
   r_clock_unref (loop->clock);    loop->clock = NULL;
   r_task_queue_unref (loop->tq);  loop->tq = NULL;
-  r_mutex_lock (&loop->done_mutex);
-  r_cbqueue_clear (&loop->dcbs);
-  r_mutex_unlock (&loop->done_mutex);
-  r_mutex_clear (&loop->done_mutex);
+  while ((msg = r_ev_loop_msg_pop (loop)) != NULL)
+    msg->notify (msg);
 
   if (loop->handle != R_IO_HANDLE_INVALID) {
     r_io_close (loop->handle);
@@ -151,25 +330,29 @@ r_ev_loop_free (REvLoop * loop)
   r_free (loop);
 }
 
-static void
+static rboolean
 r_ev_loop_setup (REvLoop * loop, RClock * clock, RTaskQueue * tq)
 {
   loop->iterations = loop->idle_count = 0;
-  loop->stop_request = FALSE;
-  r_cbqueue_init (&loop->dcbs);
+  r_atomic_uint_store (&loop->syscalls, 0);
+  r_memclear (&loop->stats, sizeof (REvLoopStats));
+  loop->stop_request = loop->keepalive = loop->hirestimers = FALSE;
   r_cbqueue_init (&loop->bcbs);
   r_cbqueue_init (&loop->acbs);
   loop->prepare = loop->idle = NULL;
   r_queue_init (&loop->active);
   r_queue_init (&loop->chg);
 
-  loop->clock = clock != NULL ? r_clock_ref (clock) : r_system_clock_get ();
+  loop->clock = clock != NULL ? r_clock_ref (clock) : r_system_clock_new ();
   loop->ts = r_clock_get_time (loop->clock);
 
   loop->tq = tq != NULL ? r_task_queue_ref (tq) :
     r_task_queue_new (1, R_EV_LOOP_DEFAULT_TASK_THREADS);
   r_atomic_uint_store (&loop->tqitems, 0);
-  r_mutex_init (&loop->done_mutex);
+  r_atomic_ptr_store (&loop->msgstub.next, NULL);
+  r_atomic_ptr_store (&loop->msghead, &loop->msgstub);
+  loop->msgtail = &loop->msgstub;
+  r_atomic_uint_store (&loop->msgwakeup, FALSE);
 
 #ifdef USE_WAKEUP
   r_ev_wakeup_init (&loop->evio_wakeup, loop, NULL);
@@ -192,6 +375,12 @@ r_ev_loop_setup (REvLoop * loop, RClock * clock, RTaskQueue * tq)
     }
   }
 #elif defined (USE_EPOLL)
+#ifdef USE_IO_URING
+  if (loop->backend == R_EV_LOOP_BACKEND_IO_URING) {
+    loop->handle = R_IO_HANDLE_INVALID;
+    return r_ev_loop_ring_setup (&loop->ring);
+  }
+#endif
  loop->handle = epoll_create1 (0);
 #elif defined (USE_RPOLL)
   loop->handle = R_IO_HANDLE_INVALID;
@@ -199,17 +388,91 @@ r_ev_loop_setup (REvLoop * loop, RClock * clock, RTaskQueue * tq)
 #else
   loop->handle = R_IO_HANDLE_INVALID;
 #endif
+
+  return TRUE;
+}
+
+static REvLoopBackend
+r_ev_loop_native_backend (void)
+{
+#if defined (USE_KQUEUE)
+  return R_EV_LOOP_BACKEND_KQUEUE;
+#elif defined (USE_EPOLL)
+  return R_EV_LOOP_BACKEND_EPOLL;
+#elif defined (USE_RPOLL)
+  return R_EV_LOOP_BACKEND_POLL;
+#else
+  return R_EV_LOOP_BACKEND_DEFAULT;
+#endif
+}
+
+#ifdef USE_IO_URING
+static rauint g__r_ev_loop_ring_supported; /* 0 = not probed, 1 = yes, 2 = no */
+
+static rboolean
+r_ev_loop_ring_probe (void)
+{
+  ruint supported;
+
+  if ((supported = r_atomic_uint_load (&g__r_ev_loop_ring_supported)) == 0) {
+    REvLoopRing ring;
+
+    if (r_ev_loop_ring_setup (&ring)) {
+      munmap (ring.sqes, ring.sqesize);
+      munmap (ring.rmem, ring.rmemsize);
+      if (ring.br != NULL)
+        munmap (ring.br, R_EV_RING_BUFS * sizeof (struct io_uring_buf));
+      r_io_close (ring.fd);
+      supported = 1;
+    } else {
+      supported = 2;
+    }
+    r_atomic_uint_store (&g__r_ev_loop_ring_supported, supported);
+  }
+
+  return supported == 1;
+}
+#endif
+
+rboolean
+r_ev_loop_backend_is_supported (REvLoopBackend backend)
+{
+  if (backend == R_EV_LOOP_BACKEND_DEFAULT || backend == r_ev_loop_native_backend ())
+    return TRUE;
+#ifdef USE_IO_URING
+  if (backend == R_EV_LOOP_BACKEND_IO_URING)
+    return r_ev_loop_ring_probe ();
+#endif
+
+  return FALSE;
 }
 
 REvLoop *
 r_ev_loop_new_full (RClock * clock, RTaskQueue * tq)
+{
+  return r_ev_loop_new_with_backend (clock, tq, R_EV_LOOP_BACKEND_DEFAULT);
+}
+
+REvLoop *
+r_ev_loop_new_with_backend (RClock * clock, RTaskQueue * tq, REvLoopBackend backend)
 {
   REvLoop * loop;
 
-  if ((loop = r_mem_new (REvLoop)) != NULL) {
+  if (backend == R_EV_LOOP_BACKEND_DEFAULT)
+    backend = g__r_ev_loop_backend;
+  if (backend == R_EV_LOOP_BACKEND_DEFAULT)
+    backend = r_ev_loop_native_backend ();
+  if (R_UNLIKELY (!r_ev_loop_backend_is_supported (backend))) return NULL;
+
+  if ((loop = r_mem_new0 (REvLoop)) != NULL) {
     REvLoop * prev = NULL;
     r_ref_init (loop, r_ev_loop_free);
-    r_ev_loop_setup (loop, clock, tq);
+    loop->backend = backend;
+    if (R_UNLIKELY (!r_ev_loop_setup (loop, clock, tq))) {
+      R_LOG_ERROR ("Failed to setup backend %d for loop %p", (int)backend, loop);
+      r_ev_loop_unref (loop);
+      return NULL;
+    }
 
     r_atomic_ptr_cmp_xchg_strong (&g__r_ev_loop_default, &prev, loop);
   }
@@ -241,20 +504,49 @@ r_ev_loop_idle (REvLoop * loop)
   loop->idle = r_cbrlist_call (loop->idle);
 }
 
+static void
+r_ev_loop_update_lateness (REvLoop * loop, RClockTimeDiff late, ruint count)
+{
+  ruint64 us = (ruint64)late / R_USECOND;
+  ruint bucket = us > 0 ? 64 - RUINT64_CLZ (us) : 0;
+
+  loop->stats.timers += count;
+  loop->stats.lateness_sum += late * count;
+  if (late > loop->stats.lateness_max)
+    loop->stats.lateness_max = late;
+  loop->stats.lateness[MIN (bucket, R_EV_LOOP_LATENESS_BUCKETS - 1)] += count;
+}
+
 static void
 r_ev_loop_update_timers (REvLoop * loop)
 {
-  r_clock_process_entries (loop->clock, &loop->ts);
+  RClockTime first;
+  ruint count;
+
+  loop->ts = r_clock_get_time (loop->clock);
+  /* One deadline at a time, to tell how late the timers fire */
+  while ((first = r_clock_first_timeout (loop->clock)) <= loop->ts) {
+    if ((count = r_clock_process_entries_until (loop->clock, first)) > 0)
+      r_ev_loop_update_lateness (loop, R_CLOCK_DIFF (first, loop->ts), count);
+  }
 }
 
 static void
-r_ev_loop_move_done_callbacks (REvLoop * loop)
+r_ev_loop_process_msgs (REvLoop * loop)
 {
-  r_mutex_lock (&loop->done_mutex);
-  R_LOG_TRACE ("loop %p - Move callbacks: %"RSIZE_FMT,
-      loop, r_cbqueue_size (&loop->dcbs));
-  r_cbqueue_merge (&loop->acbs, &loop->dcbs);
-  r_mutex_unlock (&loop->done_mutex);
+  REvLoopMsg * msg;
+  rsize count = 0;
+
+  /* Clear before popping, anything pushed after this signals a new wakeup */
+  r_atomic_uint_store (&loop->msgwakeup, FALSE);
+  while ((msg = r_ev_loop_msg_pop (loop)) != NULL) {
+    msg->func (msg->data, loop);
+    msg->notify (msg);
+    count++;
+  }
+
+  if (count > 0)
+    R_LOG_TRACE ("loop %p - Processed messages: %"RSIZE_FMT, loop, count);
 }
 
 static RClockTime
@@ -264,7 +556,9 @@ r_ev_loop_next_deadline (REvLoop * loop, REvLoopRunMode mode)
   if (loop->stop_request) return loop->ts;
   if (loop->idle != NULL) return loop->ts;
   if (r_cbqueue_size (&loop->acbs) > 0) return loop->ts;
-  if (r_clock_timeout_count (loop->clock) == 0 &&
+  if (r_ev_loop_has_msgs (loop)) return loop->ts;
+  if (!loop->keepalive &&
+      r_clock_timeout_count (loop->clock) == 0 &&
       r_queue_size (&loop->active) == 0 &&
       r_atomic_uint_load (&loop->tqitems) == 0)
     return loop->ts;
@@ -374,7 +668,6 @@ r_ev_loop_io_wait (REvLoop * loop, RClockTime deadline)
         case EVFILT_USER:
           R_LOG_DEBUG ("USER flags: 0x%"RINT16_MODIFIER"x fflags: 0x%"RINT32_MODIFIER"x",
               ev->flags, ev->fflags);
-          r_ev_loop_move_done_callbacks (loop);
           continue;
         default:
           R_LOG_DEBUG ("evio "R_EV_IO_FORMAT" gives filter: %"RINT16_FMT
@@ -394,7 +687,7 @@ r_ev_loop_io_wait (REvLoop * loop, RClockTime deadline)
 }
 #elif defined (USE_EPOLL)
 static int
-r_ev_loop_io_wait (REvLoop * loop, RClockTime deadline)
+r_ev_loop_epoll_wait (REvLoop * loop, RClockTime deadline)
 {
   REvIO * evio;
   int ret, i, tms;
@@ -433,6 +726,7 @@ r_ev_loop_io_wait (REvLoop * loop, RClockTime deadline)
     else
       op = EPOLL_CTL_ADD;
 
+    r_ev_loop_count_syscalls (loop, 1);
     if (epoll_ctl (loop->handle, op, evio->handle, ev) == 0) {
       evio->events = pending;
       switch (op) {
@@ -455,15 +749,36 @@ r_ev_loop_io_wait (REvLoop * loop, RClockTime deadline)
     }
   }
 
-  if (deadline != R_CLOCK_TIME_INFINITE)
-    tms = R_TIME_AS_MSECONDS (deadline - loop->ts) + 1;
-  else
-    tms = -1;
+#ifdef USE_EPOLL_PWAIT2
+  if (loop->hirestimers) {
+    struct timespec spec, * timeout = NULL;
 
-  do {
-    R_LOG_TRACE ("executing epoll_wait for loop %p with timeout %d", loop, tms);
-    ret = epoll_wait (loop->handle, events, R_N_ELEMENTS (events), tms);
-  } while (ret < 0 && errno == EINTR);
+    if (deadline != R_CLOCK_TIME_INFINITE) {
+      /* Callbacks have run since loop->ts, so don't rely on it */
+      RClockTime now = r_clock_get_time (loop->clock);
+      R_TIME_TO_TIMESPEC (deadline > now ? deadline - now : 0, spec);
+      timeout = &spec;
+    }
+
+    do {
+      R_LOG_TRACE ("executing epoll_pwait2 for loop %p", loop);
+      r_ev_loop_count_syscalls (loop, 1);
+      ret = r_epoll_pwait2 (loop->handle, events, R_N_ELEMENTS (events), timeout, NULL);
+    } while (ret < 0 && errno == EINTR);
+  } else
+#endif
+  {
+    if (deadline != R_CLOCK_TIME_INFINITE)
+      tms = R_TIME_AS_MSECONDS (deadline - loop->ts) + 1;
+    else
+      tms = -1;
+
+    do {
+      R_LOG_TRACE ("executing epoll_wait for loop %p with timeout %d", loop, tms);
+      r_ev_loop_count_syscalls (loop, 1);
+      ret = epoll_wait (loop->handle, events, R_N_ELEMENTS (events), tms);
+    } while (ret < 0 && errno == EINTR);
+  }
 
   if (ret >= 0) {
     R_LOG_DEBUG ("epoll_wait for loop %p with %d events", loop, ret);
@@ -598,6 +913,488 @@ r_ev_loop_io_wait (REvLoop * loop, RClockTime deadline)
 }
 #endif
 
+#ifdef USE_IO_URING
+static rboolean
+r_ev_loop_ring_setup (REvLoopRing * ring)
+{
+  struct io_uring_params p;
+  struct io_uring_buf_reg reg;
+  ruint * sqarray, i;
+
+  r_memclear (ring, sizeof (REvLoopRing));
+  r_memclear (&p, sizeof (p));
+  p.flags = IORING_SETUP_CLAMP | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+  if ((ring->fd = (int)syscall (__NR_io_uring_setup, R_EV_RING_ENTRIES, &p)) < 0) {
+    /* Older kernels reject flags they don't know about */
+    r_memclear (&p, sizeof (p));
+    p.flags = IORING_SETUP_CLAMP;
+    if ((ring->fd = (int)syscall (__NR_io_uring_setup, R_EV_RING_ENTRIES, &p)) < 0)
+      return FALSE;
+  }
+
+  if ((p.features & (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG)) !=
+      (IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG))
+    goto error;
+
+  ring->rmemsize = MAX (p.sq_off.array + p.sq_entries * sizeof (ruint),
+      p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe));
+  ring->rmem = mmap (NULL, ring->rmemsize, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  if (ring->rmem == MAP_FAILED)
+    goto error;
+  ring->sqesize = p.sq_entries * sizeof (struct io_uring_sqe);
+  ring->sqes = mmap (NULL, ring->sqesize, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sqes == MAP_FAILED) {
+    munmap (ring->rmem, ring->rmemsize);
+    goto error;
+  }
+
+  ring->sqhead = (rauint *)((ruint8 *)ring->rmem + p.sq_off.head);
+  ring->sqtail = (rauint *)((ruint8 *)ring->rmem + p.sq_off.tail);
+  ring->sqmask = *(ruint *)((ruint8 *)ring->rmem + p.sq_off.ring_mask);
+  ring->sqentries = p.sq_entries;
+  ring->sqlocal = r_atomic_uint_load (ring->sqtail);
+  ring->cqhead = (rauint *)((ruint8 *)ring->rmem + p.cq_off.head);
+  ring->cqtail = (rauint *)((ruint8 *)ring->rmem + p.cq_off.tail);
+  ring->cqmask = *(ruint *)((ruint8 *)ring->rmem + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)((ruint8 *)ring->rmem + p.cq_off.cqes);
+
+  /* sqes are always used in order */
+  sqarray = (ruint *)((ruint8 *)ring->rmem + p.sq_off.array);
+  for (i = 0; i < p.sq_entries; i++)
+    sqarray[i] = i;
+
+  /* Without provided buffer rings READABLE is served by multishot poll */
+  ring->br = mmap (NULL, R_EV_RING_BUFS * sizeof (struct io_uring_buf),
+      PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+  if (ring->br != MAP_FAILED) {
+    r_memclear (&reg, sizeof (reg));
+    reg.ring_addr = (ruintptr)ring->br;
+    reg.ring_entries = R_EV_RING_BUFS;
+    reg.bgid = R_EV_RING_BGID;
+    if (syscall (__NR_io_uring_register, ring->fd,
+          IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+      munmap (ring->br, R_EV_RING_BUFS * sizeof (struct io_uring_buf));
+      ring->br = NULL;
+    }
+  } else {
+    ring->br = NULL;
+  }
+  ring->norecv = ring->br == NULL;
+
+  return TRUE;
+
+error:
+  r_io_close (ring->fd);
+  ring->fd = -1;
+  return FALSE;
+}
+
+static int
+r_ev_loop_ring_enter (REvLoop * loop, ruint flags, ruint wait,
+    struct __kernel_timespec * ts)
+{
+  REvLoopRing * ring = &loop->ring;
+  struct io_uring_getevents_arg arg;
+  ruint submit;
+  int ret;
+
+  r_atomic_uint_store (ring->sqtail, ring->sqlocal);
+  submit = ring->sqlocal - r_atomic_uint_load (ring->sqhead);
+
+  r_memclear (&arg, sizeof (arg));
+  arg.sigmask_sz = _NSIG / 8;
+  arg.ts = (ruintptr)ts;
+
+  r_ev_loop_count_syscalls (loop, 1);
+  ret = (int)syscall (__NR_io_uring_enter, ring->fd, submit, wait,
+      flags | IORING_ENTER_EXT_ARG, &arg, sizeof (arg));
+  return ret < 0 ? -errno : ret;
+}
+
+static struct io_uring_sqe *
+r_ev_loop_ring_sqe (REvLoop * loop)
+{
+  REvLoopRing * ring = &loop->ring;
+  struct io_uring_sqe * sqe;
+
+  if (R_UNLIKELY (ring->sqlocal - r_atomic_uint_load (ring->sqhead) >= ring->sqentries)) {
+    r_ev_loop_ring_enter (loop, 0, 0, NULL);
+    if (ring->sqlocal - r_atomic_uint_load (ring->sqhead) >= ring->sqentries) {
+      R_LOG_ERROR ("io_uring submission queue for loop %p is stuck", loop);
+      abort ();
+    }
+  }
+
+  sqe = &ring->sqes[ring->sqlocal++ & ring->sqmask];
+  r_memclear (sqe, sizeof (struct io_uring_sqe));
+  return sqe;
+}
+
+static void
+r_ev_loop_ring_cancel (REvLoop * loop, REvIOOp ** op)
+{
+  struct io_uring_sqe * sqe = r_ev_loop_ring_sqe (loop);
+
+  sqe->opcode = IORING_OP_ASYNC_CANCEL;
+  sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+  sqe->addr = (ruintptr)*op;
+
+  (*op)->evio = NULL;
+  *op = NULL;
+}
+
+static void
+r_ev_loop_ring_buf_put (REvLoopRing * ring, ruint16 bid)
+{
+  struct io_uring_buf * buf = &ring->br->bufs[ring->brtail & (R_EV_RING_BUFS - 1)];
+
+  buf->addr = (ruintptr)(ring->bufs + (rsize)bid * R_EV_RING_BUF_SIZE);
+  buf->len = R_EV_RING_BUF_SIZE;
+  buf->bid = bid;
+  __atomic_store_n (&ring->br->tail, ++ring->brtail, __ATOMIC_RELEASE);
+}
+
+static inline void
+r_ev_io_ring_change (REvIO * evio)
+{
+  if (!R_EV_IO_IS_CHANGING (evio))
+    evio->chglnk = r_queue_push (&evio->loop->chg, evio);
+}
+
+static void
+r_ev_loop_ring_poll_done (REvIOOp * op, int res, ruint flags, rboolean last)
+{
+  REvIO * evio = op->evio;
+  rboolean final = !(flags & IORING_CQE_F_MORE);
+
+  (void) last;
+
+  if (final && evio != NULL) {
+    /* Multishot poll terminated, re-arm unless it failed */
+    evio->pollop = NULL;
+    evio->events = 0;
+    if (res >= 0)
+      r_ev_io_ring_change (evio);
+  }
+
+  if (evio != NULL) {
+    REvIOEvents rev = 0;
+
+    if (res >= 0) {
+      if (res & EPOLLERR)  rev |= R_EV_IO_ERROR;
+      if (res & EPOLLHUP)  rev |= R_EV_IO_HANGUP;
+      if (res & EPOLLIN)   rev |= R_EV_IO_READABLE;
+      if (res & EPOLLOUT)  rev |= R_EV_IO_WRITABLE;
+    } else if (res != -ECANCELED) {
+      R_LOG_ERROR ("poll for evio "R_EV_IO_FORMAT" failed %d: \"%s\"",
+          R_EV_IO_ARGS (evio), -res, strerror (-res));
+      rev = R_EV_IO_ERROR;
+    }
+
+    if (R_LIKELY (rev != 0))
+      r_ev_io_invoke_iocb (evio, rev);
+  }
+
+  if (final)
+    r_free (op);
+}
+
+static void
+r_ev_loop_ring_poll (REvLoop * loop, REvIO * evio, REvIOEvents events)
+{
+  struct io_uring_sqe * sqe;
+  REvIOOp * op;
+  ruint32 mask = 0;
+
+  if (R_UNLIKELY ((op = r_mem_new (REvIOOp)) == NULL))
+    return;
+  op->evio = evio;
+  op->func = r_ev_loop_ring_poll_done;
+
+  /* Multishot poll is edge triggered, just like the epoll backend */
+  if (events & R_EV_IO_READABLE) mask |= EPOLLIN;
+  if (events & R_EV_IO_WRITABLE) mask |= EPOLLOUT;
+  if (events & R_EV_IO_HANGUP)   mask |= EPOLLRDHUP;
+#if R_BYTE_ORDER == R_BIG_ENDIAN
+  mask = (mask << 16) | (mask >> 16);
+#endif
+
+  sqe = r_ev_loop_ring_sqe (loop);
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = evio->handle;
+  sqe->len = IORING_POLL_ADD_MULTI;
+  sqe->poll32_events = mask;
+  sqe->user_data = (ruintptr)op;
+
+  loop->ring.inflight++;
+  evio->pollop = op;
+  evio->events = events;
+}
+
+static void
+r_ev_loop_ring_recv_done (REvIOOp * op, int res, ruint flags, rboolean last)
+{
+  REvLoopRingRecvOp * rop = (REvLoopRingRecvOp *)op;
+  REvLoopRing * ring = &rop->loop->ring;
+  REvIO * evio = op->evio;
+  rboolean final = !(flags & IORING_CQE_F_MORE);
+  ruint16 bid = 0;
+  ruint8 * buf = NULL;
+
+  if (flags & IORING_CQE_F_BUFFER) {
+    bid = (ruint16)(flags >> IORING_CQE_BUFFER_SHIFT);
+    buf = ring->bufs + (rsize)bid * R_EV_RING_BUF_SIZE;
+  }
+
+  if (final && evio != NULL) {
+    evio->recvop = NULL;
+    if (res == -EINVAL) {
+      /* Fall back to poll and let the iocb do the reading */
+      R_LOG_WARNING ("multishot recv not supported for evio "R_EV_IO_FORMAT,
+          R_EV_IO_ARGS (evio));
+      ring->norecv = TRUE;
+      r_ev_io_ring_change (evio);
+    } else if (res > 0 || res == -ENOBUFS ||
+        (res < 0 && (evio->flags & R_EV_IO_RING_MSG))) {
+      r_ev_io_ring_change (evio);
+    } else {
+      /* EOF or error on a stream */
+      evio->flags |= R_EV_IO_RING_EOF;
+    }
+  }
+
+  if (evio != NULL && evio->ringrecv != NULL) {
+    if (res > 0 && buf != NULL) {
+      if (evio->flags & R_EV_IO_RING_MSG) {
+        const struct io_uring_recvmsg_out * out = (const struct io_uring_recvmsg_out *)buf;
+        const ruint8 * name = (const ruint8 *)(out + 1);
+        const ruint8 * payload = name + rop->msg.msg_namelen + rop->msg.msg_controllen;
+        rsize size = (rsize)res - (rsize)(payload - buf);
+
+        evio->ringrecv (evio, payload, (rssize)MIN (size, out->payloadlen),
+            name, MIN (out->namelen, rop->msg.msg_namelen), !last);
+      } else {
+        evio->ringrecv (evio, buf, res, NULL, 0, !last);
+      }
+    } else if (res == 0 || (final && res < 0 && res != -ECANCELED &&
+          res != -ENOBUFS && res != -EINVAL && !(evio->flags & R_EV_IO_RING_MSG))) {
+      evio->ringrecv (evio, NULL, res, NULL, 0, FALSE);
+    }
+  }
+
+  if (buf != NULL)
+    r_ev_loop_ring_buf_put (ring, bid);
+  if (final)
+    r_free (op);
+}
+
+static void
+r_ev_loop_ring_recv (REvLoop * loop, REvIO * evio)
+{
+  REvLoopRing * ring = &loop->ring;
+  REvLoopRingRecvOp * op;
+  struct io_uring_sqe * sqe;
+
+  if (R_UNLIKELY (ring->bufs == NULL)) {
+    ruint16 i;
+
+    if ((ring->bufs = r_malloc (R_EV_RING_BUFS * R_EV_RING_BUF_SIZE)) == NULL)
+      return;
+    for (i = 0; i < R_EV_RING_BUFS; i++)
+      r_ev_loop_ring_buf_put (ring, i);
+  }
+
+  if (R_UNLIKELY ((op = r_mem_new0 (REvLoopRingRecvOp)) == NULL))
+    return;
+  op->op.evio = evio;
+  op->op.func = r_ev_loop_ring_recv_done;
+  op->loop = loop;
+
+  sqe = r_ev_loop_ring_sqe (loop);
+  sqe->fd = evio->handle;
+  sqe->ioprio = IORING_RECV_MULTISHOT;
+  sqe->flags = IOSQE_BUFFER_SELECT;
+  sqe->buf_group = R_EV_RING_BGID;
+  sqe->user_data = (ruintptr)op;
+  if (evio->flags & R_EV_IO_RING_MSG) {
+    op->msg.msg_namelen = sizeof (struct sockaddr_storage);
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->addr = (ruintptr)&op->msg;
+    sqe->len = 1;
+  } else {
+    sqe->opcode = IORING_OP_RECV;
+  }
+
+  ring->inflight++;
+  evio->recvop = &op->op;
+}
+
+static void
+r_ev_io_ring_detach (REvIO * evio)
+{
+  if (evio->pollop != NULL)
+    r_ev_loop_ring_cancel (evio->loop, &evio->pollop);
+  if (evio->recvop != NULL)
+    r_ev_loop_ring_cancel (evio->loop, &evio->recvop);
+  evio->events = 0;
+}
+
+static int
+r_ev_loop_ring_reap (REvLoop * loop)
+{
+  REvLoopRing * ring = &loop->ring;
+  ruint head, tail;
+  int ret = 0;
+
+  head = r_atomic_uint_load (ring->cqhead);
+  tail = r_atomic_uint_load (ring->cqtail);
+  while (head != tail) {
+    const struct io_uring_cqe * cqe = &ring->cqes[head & ring->cqmask];
+    REvIOOp * op = (REvIOOp *)(ruintptr)cqe->user_data;
+    int res = cqe->res;
+    ruint flags = cqe->flags;
+    rboolean last;
+
+    r_atomic_uint_store (ring->cqhead, ++head);
+    ret++;
+
+    /* Failed cancellations */
+    if (op == NULL)
+      continue;
+    if (!(flags & IORING_CQE_F_MORE))
+      ring->inflight--;
+
+    if (head == tail)
+      tail = r_atomic_uint_load (ring->cqtail);
+    last = head == tail ||
+      ring->cqes[head & ring->cqmask].user_data != (ruintptr)op;
+    op->func (op, res, flags, last);
+  }
+
+  return ret;
+}
+
+static int
+r_ev_loop_ring_wait (REvLoop * loop, RClockTime deadline)
+{
+  REvLoopRing * ring = &loop->ring;
+  struct __kernel_timespec ts = { 0, 0 };
+  REvIO * evio;
+  rboolean ready;
+  int ret;
+
+  while ((evio = r_queue_pop (&loop->chg)) != NULL) {
+    REvIOEvents pending;
+    rboolean recv = FALSE;
+
+    evio->chglnk = NULL;
+    if (R_UNLIKELY (evio->handle == R_IO_HANDLE_INVALID))
+      continue;
+    if (R_UNLIKELY (R_EV_IO_IS_CLOSED (evio))) {
+      r_ev_io_ring_detach (evio);
+      evio->handle = R_IO_HANDLE_INVALID;
+      continue;
+    }
+
+    pending = r_ev_io_get_iocbq_events (evio);
+    R_LOG_DEBUG ("loop %p changes evio "R_EV_IO_FORMAT" %4x->%x",
+        loop, R_EV_IO_ARGS (evio), evio->events, pending);
+
+    /* READABLE is served by multishot recv directly into provided buffers */
+    if (evio->ringrecv != NULL && !ring->norecv && (pending & R_EV_IO_READABLE)) {
+      pending &= ~R_EV_IO_READABLE;
+      recv = !(evio->flags & R_EV_IO_RING_EOF);
+    }
+    if (recv && evio->recvop == NULL)
+      r_ev_loop_ring_recv (loop, evio);
+    else if (!recv && evio->recvop != NULL)
+      r_ev_loop_ring_cancel (loop, &evio->recvop);
+
+    if (evio->events != pending) {
+      if (evio->pollop != NULL)
+        r_ev_loop_ring_cancel (loop, &evio->pollop);
+      evio->events = 0;
+      if (pending != 0)
+        r_ev_loop_ring_poll (loop, evio, pending);
+    }
+  }
+
+  /* Don't wait if there are completions already, and skip the syscall
+   * entirely if there is nothing to submit either */
+  ready = r_atomic_uint_load (ring->cqhead) != r_atomic_uint_load (ring->cqtail);
+  if (ready && ring->sqlocal == r_atomic_uint_load (ring->sqhead))
+    return r_ev_loop_ring_reap (loop);
+
+  if (!ready && deadline > loop->ts) {
+    if (deadline != R_CLOCK_TIME_INFINITE) {
+      R_TIME_TO_TIMESPEC (deadline - loop->ts, ts);
+      ret = r_ev_loop_ring_enter (loop, IORING_ENTER_GETEVENTS, 1, &ts);
+    } else {
+      ret = r_ev_loop_ring_enter (loop, IORING_ENTER_GETEVENTS, 1, NULL);
+    }
+  } else {
+    ret = r_ev_loop_ring_enter (loop, IORING_ENTER_GETEVENTS, 0, NULL);
+  }
+
+  if (ret < 0 && ret != -ETIME && ret != -EINTR && ret != -EBUSY && ret != -EAGAIN) {
+    R_LOG_ERROR ("io_uring_enter for loop %p failed %d: \"%s\"",
+        loop, -ret, strerror (-ret));
+    return ret;
+  }
+
+  ret = r_ev_loop_ring_reap (loop);
+  R_LOG_DEBUG ("io_uring_enter for loop %p with %d completions", loop, ret);
+  return ret;
+}
+
+static void
+r_ev_loop_ring_clear (REvLoop * loop)
+{
+  REvLoopRing * ring = &loop->ring;
+
+  if (ring->fd < 0)
+    return;
+
+  /* Everything left is detached, but the kernel might still write into
+   * buffers or msghdrs we own, so wait for it to let go */
+  if (ring->inflight > 0) {
+    struct io_uring_sqe * sqe = r_ev_loop_ring_sqe (loop);
+    struct __kernel_timespec ts = { 1, 0 };
+
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    while (ring->inflight > 0) {
+      if (r_ev_loop_ring_enter (loop, IORING_ENTER_GETEVENTS, 1, &ts) == -ETIME) {
+        R_LOG_WARNING ("loop %p leaking %u io_uring operations", loop, ring->inflight);
+        break;
+      }
+      r_ev_loop_ring_reap (loop);
+    }
+  }
+
+  munmap (ring->sqes, ring->sqesize);
+  munmap (ring->rmem, ring->rmemsize);
+  if (ring->br != NULL)
+    munmap (ring->br, R_EV_RING_BUFS * sizeof (struct io_uring_buf));
+  r_free (ring->bufs);
+  r_io_close (ring->fd);
+  ring->fd = -1;
+}
+
+static int
+r_ev_loop_io_wait (REvLoop * loop, RClockTime deadline)
+{
+  if (loop->backend == R_EV_LOOP_BACKEND_IO_URING)
+    return r_ev_loop_ring_wait (loop, deadline);
+  return r_ev_loop_epoll_wait (loop, deadline);
+}
+#elif defined (USE_EPOLL)
+#define r_ev_loop_io_wait r_ev_loop_epoll_wait
+#endif
+
 static ruint
 r_ev_loop_outstanding_events (REvLoop * loop)
 {
@@ -605,6 +1402,8 @@ r_ev_loop_outstanding_events (REvLoop * loop)
     r_cbqueue_size (&loop->acbs) +
     r_cbqueue_size (&loop->bcbs) +
     loop->tqitems +
+    (loop->keepalive ? 1 : 0) +
+    (r_ev_loop_has_msgs (loop) ? 1 : 0) +
     r_clock_timeout_count (loop->clock) +
     r_queue_size (&loop->active);
 }
@@ -628,7 +1427,7 @@ r_ev_loop_run (REvLoop * loop, REvLoopRunMode mode)
     r_ev_loop_prepare (loop);
     r_ev_loop_update_timers (loop);
 
-    r_ev_loop_move_done_callbacks (loop);
+    r_ev_loop_process_msgs (loop);
 
     r_cbqueue_call_pop (&loop->bcbs);
     deadline = r_ev_loop_next_deadline (loop, mode);
@@ -644,6 +1443,7 @@ r_ev_loop_run (REvLoop * loop, REvLoopRunMode mode)
         break;
       }
     }
+    r_ev_loop_process_msgs (loop);
     r_cbqueue_call_pop (&loop->acbs);
 
     r_ev_loop_update_timers (loop);
@@ -665,6 +1465,12 @@ r_ev_loop_stop (REvLoop * loop)
   loop->stop_request = TRUE;
 }
 
+void
+r_ev_loop_keepalive (REvLoop * loop, rboolean keepalive)
+{
+  loop->keepalive = keepalive;
+}
+
 rsize
 r_ev_loop_get_iterations (const REvLoop * loop)
 {
@@ -677,6 +1483,61 @@ r_ev_loop_get_idle_count (const REvLoop * loop)
   return loop->idle_count;
 }
 
+REvLoopBackend
+r_ev_loop_get_backend (const REvLoop * loop)
+{
+  return loop->backend;
+}
+
+rsize
+r_ev_loop_get_syscalls (const REvLoop * loop)
+{
+  return r_atomic_uint_load ((rauint *)&loop->syscalls);
+}
+
+void
+r_ev_loop_count_syscalls (REvLoop * loop, ruint count)
+{
+  r_atomic_uint_fetch_add (&loop->syscalls, count);
+}
+
+void
+r_ev_loop_get_stats (const REvLoop * loop, REvLoopStats * stats)
+{
+  r_memcpy (stats, &loop->stats, sizeof (REvLoopStats));
+}
+
+void
+r_ev_loop_reset_stats (REvLoop * loop)
+{
+  r_memclear (&loop->stats, sizeof (REvLoopStats));
+}
+
+rboolean
+r_ev_loop_set_high_res_timers (REvLoop * loop, rboolean enable)
+{
+#if defined (USE_EPOLL)
+  if (enable && loop->backend == R_EV_LOOP_BACKEND_EPOLL) {
+#ifdef USE_EPOLL_PWAIT2
+    /* maxevents of 0 fails with EINVAL if the syscall is there at all */
+    if (r_epoll_pwait2 (loop->handle, NULL, 0, NULL, NULL) < 0 && errno == ENOSYS)
+      return FALSE;
+#else
+    return FALSE;
+#endif
+  }
+#endif
+
+  loop->hirestimers = enable;
+  return TRUE;
+}
+
+rboolean
+r_ev_loop_get_high_res_timers (const REvLoop * loop)
+{
+  return loop->hirestimers;
+}
+
 ruint
 r_ev_loop_task_group_count (REvLoop * loop)
 {
@@ -780,8 +1641,6 @@ r_ev_loop_wakeup_cb (rpointer data, REvIOEvents events, REvIO * evio)
       abort ();
     }
 #endif
-
-    r_ev_loop_move_done_callbacks (loop);
   }
 }
 #endif
@@ -806,54 +1665,106 @@ r_ev_loop_wakeup (REvLoop * loop)
 #endif
 }
 
+/* Pushes msg and wakes up the loop unless a wakeup is already pending */
+static void
+r_ev_loop_post (REvLoop * loop, REvLoopMsg * msg)
+{
+  r_ev_loop_msg_push (loop, msg);
+  if (!r_atomic_uint_exchange (&loop->msgwakeup, TRUE))
+    r_ev_loop_wakeup (loop);
+}
+
 typedef struct {
+  REvLoopMsg msg;
+  RDestroyNotify datanotify;
+} REvLoopInvokeMsg;
+
+static void
+r_ev_loop_invoke_msg_free (rpointer data)
+{
+  REvLoopInvokeMsg * imsg = data;
+
+  if (imsg->datanotify != NULL)
+    imsg->datanotify (imsg->msg.data);
+  r_free (imsg);
+}
+
+rboolean
+r_ev_loop_invoke_full (REvLoop * loop, REvFunc func,
+    rpointer data, RDestroyNotify datanotify)
+{
+  REvLoopInvokeMsg * imsg;
+
+  if (R_UNLIKELY (loop == NULL)) return FALSE;
+  if (R_UNLIKELY (func == NULL)) return FALSE;
+
+  if ((imsg = r_mem_new (REvLoopInvokeMsg)) == NULL)
+    return FALSE;
+
+  imsg->msg.func = func;
+  imsg->msg.data = data;
+  imsg->msg.notify = r_ev_loop_invoke_msg_free;
+  imsg->datanotify = datanotify;
+  r_ev_loop_post (loop, &imsg->msg);
+  return TRUE;
+}
+
+typedef struct {
+  REvLoopMsg msg;
   REvLoop * loop;
   RTaskFunc task;
   REvFunc done;
   rpointer data;
   RDestroyNotify datanotify;
+  RTask * t;
+  rauint posted;
 } REvLoopTaskCtx;
 
 static void
-r_ev_loop_task_done (rpointer data, rpointer user)
+r_ev_loop_task_done (rpointer data, REvLoop * loop)
 {
   REvLoopTaskCtx * ctx = data;
-  (void) user;
 
   /* This is a barrier, so after this barrier - task_proxy is done and
    * the loop is unrefed!*/
-  r_mutex_lock (&ctx->loop->done_mutex);
-  r_mutex_unlock (&ctx->loop->done_mutex);
+  while (!r_atomic_uint_load (&ctx->posted))
+    r_thread_yield ();
 
-  R_LOG_TRACE ("loop %p task done: %p", ctx->loop, ctx->done);
+  R_LOG_TRACE ("loop %p task done: %p", loop, ctx->done);
 
   if (ctx->done != NULL)
-    ctx->done (ctx->data, ctx->loop);
+    ctx->done (ctx->data, loop);
 
   if (ctx->datanotify != NULL)
     ctx->datanotify (ctx->data);
 
-  r_atomic_uint_fetch_sub (&ctx->loop->tqitems, 1);
+  r_atomic_uint_fetch_sub (&loop->tqitems, 1);
+}
+
+static void
+r_ev_loop_task_msg_release (rpointer data)
+{
+  /* ctx is owned by the task and might go away with it */
+  r_task_unref (((REvLoopTaskCtx *)data)->t);
 }
 
 static void
 r_ev_loop_task_proxy (rpointer data, RTaskQueue * q, RTask * t)
 {
   REvLoopTaskCtx * ctx = data;
-  rboolean wakeup;
+  REvLoop * loop = ctx->loop;
 
   ctx->task (ctx->data, q, t);
 
-  r_mutex_lock (&ctx->loop->done_mutex);
-  wakeup = r_cbqueue_is_empty (&ctx->loop->dcbs);
-  R_LOG_TRACE ("loop %p push r_ev_loop_task_done", ctx->loop);
-  r_cbqueue_push (&ctx->loop->dcbs, r_ev_loop_task_done,
-      ctx, NULL, r_task_ref (t), r_task_unref);
+  R_LOG_TRACE ("loop %p post r_ev_loop_task_done", loop);
+  ctx->t = r_task_ref (t);
+  ctx->msg.func = r_ev_loop_task_done;
+  ctx->msg.data = ctx;
+  ctx->msg.notify = r_ev_loop_task_msg_release;
+  r_ev_loop_post (loop, &ctx->msg);
 
-  if (wakeup)
-    r_ev_loop_wakeup (ctx->loop);
-  r_ev_loop_unref (ctx->loop);
-  r_mutex_unlock (&ctx->loop->done_mutex);
+  r_ev_loop_unref (loop);
+  r_atomic_uint_store (&ctx->posted, TRUE);
 }
 
 RTask *
@@ -889,6 +1800,7 @@ r_ev_loop_add_task_full_v (REvLoop * loop, ruint taskgroup,
     ctx->done = done;
     ctx->data = data;
     ctx->datanotify = datanotify;
+    r_atomic_uint_store (&ctx->posted, FALSE);
     if ((ret = r_task_queue_add_full_v (loop->tq, taskgroup,
             r_ev_loop_task_proxy, ctx, r_free, args)) != NULL) {
       r_atomic_uint_fetch_add (&loop->tqitems, 1);
@@ -919,6 +1831,10 @@ r_ev_io_clear (REvIO * evio)
     r_queue_remove_link (&evio->loop->chg, evio->chglnk);
   evio->alnk = evio->chglnk = NULL;
 
+#ifdef USE_IO_URING
+  r_ev_io_ring_detach (evio);
+#endif
+
   r_cbqueue_clear (&evio->iocbq);
 
   if (evio->loop != NULL)
@@ -947,6 +1863,8 @@ r_ev_io_init (REvIO * evio, REvLoop * loop, RIOHandle handle, RDestroyNotify not
   r_cbqueue_init (&evio->iocbq);
   evio->user = NULL;
   evio->usernotify = NULL;
+  evio->ringrecv = NULL;
+  evio->pollop = evio->recvop = NULL;
 
 #ifdef R_OS_UNIX
   if (handle != R_IO_HANDLE_INVALID)
@@ -1048,6 +1966,11 @@ r_ev_io_close (REvIO * evio, REvIOFunc close_cb,
 
   R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT, evio->loop, R_EV_IO_ARGS (evio));
 
+#ifdef USE_IO_URING
+  /* Operations in flight keep the file open, so cancel them right away */
+  r_ev_io_ring_detach (evio);
+#endif
+
   if (evio->handle != R_IO_HANDLE_INVALID && !R_EV_IO_IS_CLOSED (evio)) {
     r_io_close (evio->handle);
     evio->flags |= R_EV_IO_CLOSED;
@@ -1069,3 +1992,55 @@ r_ev_io_close (REvIO * evio, REvIOFunc close_cb,
   return TRUE;
 }
 
+rboolean
+r_ev_io_ring_enabled (const REvIO * evio)
+{
+#ifdef USE_IO_URING
+  return evio->loop->backend == R_EV_LOOP_BACKEND_IO_URING;
+#else
+  (void) evio;
+  return FALSE;
+#endif
+}
+
+void
+r_ev_io_set_ring_recv (REvIO * evio, REvIORingRecvFunc recv, rboolean msg)
+{
+  if (!r_ev_io_ring_enabled (evio))
+    return;
+
+  evio->ringrecv = recv;
+  evio->flags &= ~(R_EV_IO_RING_MSG | R_EV_IO_RING_EOF);
+  if (msg)
+    evio->flags |= R_EV_IO_RING_MSG;
+  if (!R_EV_IO_IS_CHANGING (evio))
+    evio->chglnk = r_queue_push (&evio->loop->chg, evio);
+}
+
+rboolean
+r_ev_loop_ring_sendmsg (REvLoop * loop, RIOHandle handle, REvIOOp * op, rpointer msg)
+{
+#ifdef USE_IO_URING
+  struct io_uring_sqe * sqe;
+
+  if (R_UNLIKELY (loop->backend != R_EV_LOOP_BACKEND_IO_URING)) return FALSE;
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return FALSE;
+
+  /* Never parked in the kernel, EAGAIN is left to the caller */
+  sqe = r_ev_loop_ring_sqe (loop);
+  sqe->opcode = IORING_OP_SENDMSG;
+  sqe->fd = handle;
+  sqe->addr = (ruintptr)msg;
+  sqe->msg_flags = MSG_NOSIGNAL | MSG_DONTWAIT;
+  sqe->user_data = (ruintptr)op;
+  loop->ring.inflight++;
+  return TRUE;
+#else
+  (void) loop;
+  (void) handle;
+  (void) op;
+  (void) msg;
+  return FALSE;
+#endif
+}
+
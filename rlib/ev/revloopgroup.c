@@ -0,0 +1,459 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rev-private.h"
+#include <rlib/ev/revloopgroup.h>
+
+#include <rlib/data/rptrarray.h>
+#include <rlib/rmem.h>
+#include <rlib/rstr.h>
+#include <rlib/rthreadpool.h>
+
+#define R_LOG_CAT_DEFAULT &revlogcat
+
+typedef struct {
+  REvLoop * loop;
+  rsize cpu;
+} REvLoopGroupMember;
+
+struct _REvLoopGroup {
+  RRef ref;
+
+  REvLoopGroupMember * members;
+  ruint count;
+  rboolean pinned;
+
+  RTaskQueue * tq;
+  RThreadPool * pool;
+  rboolean stopped;
+
+  RPtrArray * tcp;
+  RPtrArray * udp;
+};
+
+static void
+r_ev_loop_group_free (REvLoopGroup * group)
+{
+  ruint i;
+
+  r_ev_loop_group_stop (group);
+
+  r_ptr_array_unref (group->tcp);
+  r_ptr_array_unref (group->udp);
+  for (i = 0; i < group->count; i++)
+    r_ev_loop_unref (group->members[i].loop);
+  r_free (group->members);
+  if (group->tq != NULL)
+    r_task_queue_unref (group->tq);
+  r_free (group);
+}
+
+static REvLoopGroup *
+r_ev_loop_group_new_internal (ruint count)
+{
+  REvLoopGroup * ret;
+  ruint i;
+
+  if ((ret = r_mem_new0 (REvLoopGroup)) != NULL) {
+    r_ref_init (ret, r_ev_loop_group_free);
+    ret->tcp = r_ptr_array_new ();
+    ret->udp = r_ptr_array_new ();
+    ret->tq = r_task_queue_new (1, R_EV_LOOP_DEFAULT_TASK_THREADS);
+    if ((ret->members = r_mem_new0_n (REvLoopGroupMember, count)) == NULL) {
+      r_ev_loop_group_unref (ret);
+      return NULL;
+    }
+
+    /* Every loop gets a clock of its own, as timers aren't thread safe */
+    for (i = 0; i < count; i++) {
+      if ((ret->members[i].loop = r_ev_loop_new_full (NULL, ret->tq)) == NULL) {
+        r_ev_loop_group_unref (ret);
+        return NULL;
+      }
+      ret->members[i].cpu = RSIZE_MAX;
+      ret->count++;
+    }
+  }
+
+  return ret;
+}
+
+REvLoopGroup *
+r_ev_loop_group_new (ruint count)
+{
+  if (R_UNLIKELY (count == 0)) return NULL;
+  return r_ev_loop_group_new_internal (count);
+}
+
+REvLoopGroup *
+r_ev_loop_group_new_on_cpus (const RBitset * cpuset)
+{
+  REvLoopGroup * ret;
+  ruint i;
+  rsize cpu;
+
+  if (cpuset == NULL) {
+    RBitset * allowed;
+    if (R_UNLIKELY (!r_bitset_init_stack (allowed, r_sys_cpu_max_count ())))
+      return NULL;
+    if (!r_sys_cpuset_allowed (allowed))
+      return NULL;
+    cpuset = allowed;
+  }
+
+  if (R_UNLIKELY (r_bitset_popcount (cpuset) == 0)) return NULL;
+
+  if ((ret = r_ev_loop_group_new_internal ((ruint)r_bitset_popcount (cpuset))) != NULL) {
+    ret->pinned = TRUE;
+    for (i = 0, cpu = 0; cpu < cpuset->bits; cpu++) {
+      if (r_bitset_is_bit_set (cpuset, cpu))
+        ret->members[i++].cpu = cpu;
+    }
+  }
+
+  return ret;
+}
+
+ruint
+r_ev_loop_group_size (const REvLoopGroup * group)
+{
+  return group != NULL ? group->count : 0;
+}
+
+REvLoop *
+r_ev_loop_group_get_loop (const REvLoopGroup * group, ruint idx)
+{
+  if (R_UNLIKELY (group == NULL)) return NULL;
+  if (R_UNLIKELY (idx >= group->count)) return NULL;
+
+  return group->members[idx].loop;
+}
+
+rsize
+r_ev_loop_group_get_cpu (const REvLoopGroup * group, ruint idx)
+{
+  if (R_UNLIKELY (group == NULL)) return RSIZE_MAX;
+  if (R_UNLIKELY (idx >= group->count)) return RSIZE_MAX;
+
+  return group->members[idx].cpu;
+}
+
+static rpointer
+r_ev_loop_group_thread (rpointer common, rpointer specific)
+{
+  REvLoop * loop = specific;
+  (void) common;
+
+  r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP);
+  return NULL;
+}
+
+rboolean
+r_ev_loop_group_start (REvLoopGroup * group)
+{
+  ruint i;
+
+  if (R_UNLIKELY (group == NULL)) return FALSE;
+  if (R_UNLIKELY (group->pool != NULL || group->stopped)) return FALSE;
+
+  if ((group->pool = r_thread_pool_new ("evloop", r_ev_loop_group_thread, group)) == NULL)
+    return FALSE;
+
+  for (i = 0; i < group->count; i++) {
+    REvLoopGroupMember * m = &group->members[i];
+    rboolean started;
+
+    r_ev_loop_keepalive (m->loop, TRUE);
+    if (group->pinned) {
+      started = r_thread_pool_start_thread_on_cpu (group->pool, m->cpu, m->loop);
+    } else {
+      rchar name[16];
+      r_snprintf (name, sizeof (name), "%u", i);
+      started = r_thread_pool_start_thread (group->pool, name, NULL, m->loop);
+    }
+
+    if (R_UNLIKELY (!started)) {
+      R_LOG_ERROR ("group %p: Failed to start thread for loop %u", group, i);
+      r_ev_loop_keepalive (m->loop, FALSE);
+      r_ev_loop_group_stop (group);
+      return FALSE;
+    }
+  }
+
+  R_LOG_DEBUG ("group %p: Started %u loops%s", group, group->count,
+      group->pinned ? " pinned" : "");
+  return TRUE;
+}
+
+/* Endpoints are taken off the loop they belong to before it stops */
+static void
+r_ev_loop_group_stop_loop (rpointer data, REvLoop * loop)
+{
+  REvLoopGroup * group = data;
+  REvIO * evio;
+  rsize i;
+
+  for (i = 0; i < r_ptr_array_size (group->tcp); i++) {
+    if ((evio = r_ptr_array_get (group->tcp, i))->loop == loop)
+      r_ev_tcp_close ((REvTCP *)evio, NULL, NULL, NULL);
+  }
+  for (i = 0; i < r_ptr_array_size (group->udp); i++) {
+    if ((evio = r_ptr_array_get (group->udp, i))->loop == loop)
+      r_ev_udp_recv_stop ((REvUDP *)evio);
+  }
+
+  r_ev_loop_keepalive (loop, FALSE);
+  r_ev_loop_stop (loop);
+}
+
+void
+r_ev_loop_group_stop (REvLoopGroup * group)
+{
+  ruint i;
+
+  if (R_UNLIKELY (group == NULL)) return;
+  if (group->stopped) return;
+
+  if (group->pool != NULL) {
+    for (i = 0; i < group->count; i++)
+      r_ev_loop_invoke (group->members[i].loop, r_ev_loop_group_stop_loop, group);
+    r_thread_pool_join (group->pool);
+    r_thread_pool_unref (group->pool);
+    group->pool = NULL;
+  } else {
+    for (i = 0; i < group->count; i++)
+      r_ev_loop_group_stop_loop (group, group->members[i].loop);
+  }
+  group->stopped = TRUE;
+}
+
+rboolean
+r_ev_loop_group_is_running (const REvLoopGroup * group)
+{
+  return group != NULL && group->pool != NULL;
+}
+
+typedef struct {
+  REvFunc func;
+  rpointer data;
+
+  RMutex mutex;
+  RCond cond;
+  ruint done;
+} REvLoopGroupForeachCtx;
+
+static void
+r_ev_loop_group_foreach_proxy (rpointer data, REvLoop * loop)
+{
+  REvLoopGroupForeachCtx * ctx = data;
+
+  ctx->func (ctx->data, loop);
+
+  r_mutex_lock (&ctx->mutex);
+  ctx->done++;
+  r_cond_signal (&ctx->cond);
+  r_mutex_unlock (&ctx->mutex);
+}
+
+rboolean
+r_ev_loop_group_foreach (REvLoopGroup * group, REvFunc func, rpointer data)
+{
+  REvLoopGroupForeachCtx ctx;
+  REvLoop * cur;
+  ruint i;
+
+  if (R_UNLIKELY (group == NULL)) return FALSE;
+  if (R_UNLIKELY (func == NULL)) return FALSE;
+  if (R_UNLIKELY (group->stopped)) return FALSE;
+
+  if (group->pool == NULL) {
+    for (i = 0; i < group->count; i++)
+      func (data, group->members[i].loop);
+    return TRUE;
+  }
+
+  if ((cur = r_ev_loop_current ()) != NULL) {
+    for (i = 0; i < group->count; i++) {
+      if (R_UNLIKELY (group->members[i].loop == cur)) {
+        R_LOG_ERROR ("group %p: foreach called from loop %p in the group", group, cur);
+        return FALSE;
+      }
+    }
+  }
+
+  ctx.func = func;
+  ctx.data = data;
+  ctx.done = 0;
+  r_mutex_init (&ctx.mutex);
+  r_cond_init (&ctx.cond);
+
+  r_mutex_lock (&ctx.mutex);
+  for (i = 0; i < group->count; i++) {
+    if (R_UNLIKELY (!r_ev_loop_invoke (group->members[i].loop,
+            r_ev_loop_group_foreach_proxy, &ctx)))
+      break;
+    while (ctx.done <= i)
+      r_cond_wait (&ctx.cond, &ctx.mutex);
+  }
+  r_mutex_unlock (&ctx.mutex);
+
+  r_mutex_clear (&ctx.mutex);
+  r_cond_clear (&ctx.cond);
+  return i == group->count;
+}
+
+typedef struct {
+  REvLoopGroup * group;
+  RSocketAddress * addr;
+  REvLoopGroupBindFlags flags;
+  rboolean tcp;
+  RFunc func;
+  rpointer data;
+
+  ruint idx;
+  rboolean ok;
+} REvLoopGroupBindCtx;
+
+static rboolean
+r_ev_loop_group_setup_socket (REvLoopGroupBindCtx * ctx, RSocket * socket,
+    ruint idx)
+{
+  REvLoopGroup * group = ctx->group;
+
+  if (!r_socket_set_reuseport (socket, TRUE)) {
+    R_LOG_WARNING ("group %p: SO_REUSEPORT not supported", group);
+    return FALSE;
+  }
+
+  if (!group->pinned)
+    return TRUE;
+
+  if ((ctx->flags & R_EV_LOOP_GROUP_BIND_INCOMING_CPU) &&
+      !r_socket_set_incoming_cpu (socket, (int)group->members[idx].cpu)) {
+    R_LOG_WARNING ("group %p: SO_INCOMING_CPU not supported", group);
+    return FALSE;
+  }
+
+  /* The program belongs to the reuseport group, so attach it once */
+  if ((ctx->flags & R_EV_LOOP_GROUP_BIND_CPU_STEERING) && idx == 0) {
+    ruint * cpus = r_alloca (group->count * sizeof (ruint));
+    ruint i;
+
+    for (i = 0; i < group->count; i++)
+      cpus[i] = (ruint)group->members[i].cpu;
+    if (!r_socket_set_reuseport_cpus (socket, cpus, group->count)) {
+      R_LOG_WARNING ("group %p: SO_ATTACH_REUSEPORT_CBPF not supported", group);
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+static void
+r_ev_loop_group_bind_one (rpointer data, REvLoop * loop)
+{
+  REvLoopGroupBindCtx * ctx = data;
+  RSocketFamily family = r_socket_address_get_family (ctx->addr);
+  RSocket * socket;
+  rpointer ep;
+  ruint idx;
+
+  if (!ctx->ok)
+    return;
+  idx = ctx->idx++;
+
+  if (ctx->tcp) {
+    if ((ep = r_ev_tcp_new (family, loop)) == NULL)
+      goto error;
+    socket = r_ev_tcp_get_socket (ep);
+    if (!r_ev_loop_group_setup_socket (ctx, socket, idx) ||
+        r_ev_tcp_bind (ep, ctx->addr, TRUE) != R_SOCKET_OK)
+      goto error;
+  } else {
+    if ((ep = r_ev_udp_new (family, loop)) == NULL)
+      goto error;
+    socket = r_ev_udp_get_socket (ep);
+    if (!r_ev_loop_group_setup_socket (ctx, socket, idx) ||
+        !r_ev_udp_bind (ep, ctx->addr, TRUE))
+      goto error;
+  }
+
+  if (idx == 0 && family == R_SOCKET_FAMILY_IPV4 &&
+      r_socket_address_ipv4_get_port (ctx->addr) == 0) {
+    RSocketAddress * bound;
+    if ((bound = r_socket_get_local_address (socket)) == NULL)
+      goto error;
+    r_socket_address_unref (ctx->addr);
+    ctx->addr = bound;
+  }
+
+  r_ptr_array_add (ctx->tcp ? ctx->group->tcp : ctx->group->udp, ep, r_ref_unref);
+  if (ctx->tcp)
+    ((REvLoopGroupTCPFunc)ctx->func) (ctx->data, ep, loop);
+  else
+    ((REvLoopGroupUDPFunc)ctx->func) (ctx->data, ep, loop);
+  return;
+
+error:
+  R_LOG_WARNING ("group %p: Failed to bind %s endpoint for loop %u",
+      ctx->group, ctx->tcp ? "TCP" : "UDP", idx);
+  if (ep != NULL)
+    r_ref_unref (ep);
+  ctx->ok = FALSE;
+}
+
+static rboolean
+r_ev_loop_group_bind (REvLoopGroup * group, const RSocketAddress * addr,
+    REvLoopGroupBindFlags flags, rboolean tcp, RFunc func, rpointer data)
+{
+  REvLoopGroupBindCtx ctx;
+  rboolean ret;
+
+  if (R_UNLIKELY (group == NULL)) return FALSE;
+  if (R_UNLIKELY (addr == NULL)) return FALSE;
+  if (R_UNLIKELY (func == NULL)) return FALSE;
+
+  ctx.group = group;
+  ctx.addr = r_socket_address_copy (addr);
+  ctx.flags = flags;
+  ctx.tcp = tcp;
+  ctx.func = func;
+  ctx.data = data;
+  ctx.idx = 0;
+  ctx.ok = TRUE;
+
+  ret = r_ev_loop_group_foreach (group, r_ev_loop_group_bind_one, &ctx) && ctx.ok;
+  r_socket_address_unref (ctx.addr);
+  return ret;
+}
+
+rboolean
+r_ev_loop_group_bind_tcp (REvLoopGroup * group, const RSocketAddress * addr,
+    REvLoopGroupBindFlags flags, REvLoopGroupTCPFunc func, rpointer data)
+{
+  return r_ev_loop_group_bind (group, addr, flags, TRUE, (RFunc)func, data);
+}
+
+rboolean
+r_ev_loop_group_bind_udp (REvLoopGroup * group, const RSocketAddress * addr,
+    REvLoopGroupBindFlags flags, REvLoopGroupUDPFunc func, rpointer data)
+{
+  return r_ev_loop_group_bind (group, addr, flags, FALSE, (RFunc)func, data);
+}
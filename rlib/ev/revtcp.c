@@ -24,6 +24,11 @@
 
 #include <rlib/rmem.h>
 
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+#include <errno.h>
+
 #define R_LOG_CAT_DEFAULT &revlogcat
 
 typedef struct {
@@ -40,6 +45,27 @@ typedef struct {
       (send)->datanotify ((send)->data);                                      \
   } R_STMT_END
 
+static void
+r_ev_tcp_send_ctx_free (REvTCPSendCtx * ctx)
+{
+  r_ev_tcp_send_ctx_clear (ctx);
+  r_free (ctx);
+}
+
+#ifdef HAVE_SYS_SOCKET_H
+#define R_EV_TCP_SEND_IOV           64
+
+/* Queued buffers submitted to the io_uring backend as a single sendmsg */
+typedef struct {
+  REvIOOp op;
+  struct msghdr msg;
+  ruint count;
+  RMem * mem[R_EV_TCP_SEND_IOV];
+  RMemMapInfo info[R_EV_TCP_SEND_IOV];
+  struct iovec iov[R_EV_TCP_SEND_IOV];
+} REvTCPSendOp;
+#endif
+
 
 struct _REvTCP {
   REvIO evio;
@@ -59,14 +85,19 @@ struct _REvTCP {
   rpointer send_iocb_ctx;
   rauint recv_counter;
   RTask * recv_task;
+  RBufferPool * pool;
 
   RQueue qsend;
+  rpointer sendop; /* Only one sendmsg in flight with io_uring */
+  rsize sendoff; /* Bytes already sent from the head of qsend */
 };
 
 static void
 r_ev_tcp_free (REvTCP * evtcp)
 {
-  r_queue_clear (&evtcp->qsend, r_buffer_unref);
+  if (evtcp->pool != NULL)
+    r_buffer_pool_unref (evtcp->pool);
+  r_queue_clear (&evtcp->qsend, (RDestroyNotify)r_ev_tcp_send_ctx_free);
   r_socket_unref (evtcp->socket);
   r_ev_io_clear (&evtcp->evio);
   r_free (evtcp);
@@ -153,6 +184,12 @@ r_ev_tcp_get_remote_address (const REvTCP * evtcp)
   return evtcp != NULL ? r_socket_get_remote_address (evtcp->socket) : NULL;
 }
 
+RSocket *
+r_ev_tcp_get_socket (const REvTCP * evtcp)
+{
+  return evtcp != NULL ? evtcp->socket : NULL;
+}
+
 RSocketStatus
 r_ev_tcp_bind (REvTCP * evtcp, const RSocketAddress * address, rboolean reuse)
 {
@@ -177,6 +214,8 @@ r_ev_tcp_accept (REvTCP * evtcp, RSocketStatus * res)
       if (res != NULL)
         *res = R_SOCKET_OOM;
       r_socket_unref (socket);
+    } else if (evtcp->pool != NULL) {
+      ret->pool = r_buffer_pool_ref (evtcp->pool);
     }
   } else {
     ret = NULL;
@@ -276,11 +315,46 @@ static RBuffer *
 r_ev_tcp_buffer_alloc_default (rpointer data, REvTCP * evtcp)
 {
   (void) data;
-  (void) evtcp;
 
+  if (evtcp->pool != NULL)
+    return r_buffer_pool_acquire (evtcp->pool);
   return r_buffer_new_alloc (NULL, R_EV_TCP_BUFFER_SIZE, NULL);
 }
 
+void
+r_ev_tcp_set_buffer_pool (REvTCP * evtcp, RBufferPool * pool)
+{
+  if (pool != NULL)
+    r_buffer_pool_ref (pool);
+  if (evtcp->pool != NULL)
+    r_buffer_pool_unref (evtcp->pool);
+  evtcp->pool = pool;
+}
+
+static void
+r_ev_tcp_recv_eos (REvTCP * evtcp)
+{
+  R_LOG_DEBUG ("loop %p evio "R_EV_IO_FORMAT" EOS",
+      evtcp->evio.loop, R_EV_IO_ARGS (evtcp));
+
+  /* Almost like r_ev_tcp_recv_stop */
+  r_ev_loop_add_cb_after (evtcp->evio.loop, (RFunc)r_ev_io_stop,
+      r_ev_tcp_ref (evtcp), r_ev_tcp_unref,
+      evtcp->recv_iocb_ctx, NULL);
+  evtcp->recv_iocb_ctx = NULL;
+  r_ev_io_set_ring_recv (&evtcp->evio, NULL, FALSE);
+  if (evtcp->recv_task != NULL) {
+    r_task_unref (evtcp->recv_task);
+    evtcp->recv_task = NULL;
+  }
+
+  /* Lastly call recv handler.
+   * Be aware that handler might close and even unref
+   * Allthough we should have a ref becuase r_ev_io_stop above
+   */
+  evtcp->recv (evtcp->recv_data, NULL, evtcp);
+}
+
 static void
 r_ev_tcp_recv_iocb (REvTCP * evtcp)
 {
@@ -298,6 +372,7 @@ r_ev_tcp_recv_iocb (REvTCP * evtcp)
       break;
     }
 
+    r_ev_io_count_syscalls (&evtcp->evio, 1);
     res = r_socket_receive_message (evtcp->socket, NULL, buf, &size);
     switch (res) {
       case R_SOCKET_OK:
@@ -306,24 +381,8 @@ r_ev_tcp_recv_iocb (REvTCP * evtcp)
               evtcp->evio.loop, R_EV_IO_ARGS (evtcp));
           evtcp->recv (evtcp->recv_data, buf, evtcp);
         } else {
-          R_LOG_DEBUG ("loop %p evio "R_EV_IO_FORMAT" EOS",
-              evtcp->evio.loop, R_EV_IO_ARGS (evtcp));
-
-          /* Almost like r_ev_tcp_recv_stop */
-          r_ev_loop_add_cb_after (evtcp->evio.loop, (RFunc)r_ev_io_stop,
-              r_ev_tcp_ref (evtcp), r_ev_tcp_unref,
-              evtcp->recv_iocb_ctx, NULL);
-          evtcp->recv_iocb_ctx = NULL;
-          if (evtcp->recv_task != NULL) {
-            r_task_unref (evtcp->recv_task);
-            evtcp->recv_task = NULL;
-          }
-
-          /* Lastly call recv handler.
-           * Be aware that handler might close and even unref
-           * Allthough we should have a ref becuase r_ev_io_stop above
-           */
-          evtcp->recv (evtcp->recv_data, NULL, evtcp);
+          r_buffer_unref (buf);
+          r_ev_tcp_recv_eos (evtcp);
           return;
         }
         break;
@@ -341,7 +400,157 @@ r_ev_tcp_recv_iocb (REvTCP * evtcp)
   /* FIXME: What do we do when something fails and we are unable to drain socket? */
 }
 
+/* Data received by the io_uring backend, split into buffers from alloc */
+static void
+r_ev_tcp_ring_recv (REvIO * evio, rconstpointer data, rssize size,
+    rconstpointer name, rsize namelen, rboolean more)
+{
+  REvTCP * evtcp = (REvTCP *)evio;
+  RBuffer * buf;
+  rsize off, filled;
+
+  (void) name;
+  (void) namelen;
+  (void) more;
+
+  if (size == 0) {
+    r_ev_tcp_recv_eos (evtcp);
+    return;
+  } else if (R_UNLIKELY (size < 0)) {
+    R_LOG_ERROR ("loop %p evio "R_EV_IO_FORMAT" res %d",
+        evtcp->evio.loop, R_EV_IO_ARGS (evtcp), (int)size);
+    return;
+  }
+
+  r_ev_tcp_ref (evtcp);
+  for (off = 0; off < (rsize)size && evtcp->recv_iocb_ctx != NULL; off += filled) {
+    if ((buf = evtcp->alloc (evtcp->recv_data, evtcp)) == NULL) {
+      R_LOG_ERROR ("loop %p evio "R_EV_IO_FORMAT" dropping %"RSIZE_FMT" bytes",
+          evtcp->evio.loop, R_EV_IO_ARGS (evtcp), (rsize)size - off);
+      break;
+    }
+    filled = r_buffer_fill (buf, 0, (const ruint8 *)data + off, (rsize)size - off);
+    r_buffer_resize (buf, 0, filled);
+    R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT,
+        evtcp->evio.loop, R_EV_IO_ARGS (evtcp));
+    evtcp->recv (evtcp->recv_data, buf, evtcp);
+    r_buffer_unref (buf);
+    if (R_UNLIKELY (filled == 0))
+      break;
+  }
+  r_ev_tcp_unref (evtcp);
+}
+
 static void r_ev_tcp_iocb (rpointer data, REvIOEvents events, REvIO * evio);
+static void r_ev_tcp_send_iocb (REvTCP * evtcp);
+
+#ifdef HAVE_SYS_SOCKET_H
+static void
+r_ev_tcp_ring_send_done (REvIOOp * op, int res, ruint flags, rboolean last)
+{
+  REvTCPSendOp * sop = (REvTCPSendOp *)op;
+  REvTCP * evtcp = (REvTCP *)op->evio;
+  REvTCPSendCtx * ctx;
+  ruint i;
+
+  (void) flags;
+  (void) last;
+
+  for (i = 0; i < sop->count; i++) {
+    r_mem_unmap (sop->mem[i], &sop->info[i]);
+    r_mem_unref (sop->mem[i]);
+  }
+  r_free (sop);
+  evtcp->sendop = NULL;
+
+  if (res >= 0) {
+    rsize sent = (rsize)res + evtcp->sendoff;
+    rboolean popped = FALSE;
+
+    R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT" sent %d",
+        evtcp->evio.loop, R_EV_IO_ARGS (evtcp), res);
+    while ((ctx = r_queue_peek (&evtcp->qsend)) != NULL &&
+        sent >= r_buffer_get_size (ctx->buf)) {
+      sent -= r_buffer_get_size (ctx->buf);
+      r_queue_pop (&evtcp->qsend);
+      if (ctx->done != NULL)
+        ctx->done (ctx->data, ctx->buf, evtcp);
+      r_ev_tcp_send_ctx_free (ctx);
+      popped = TRUE;
+    }
+    evtcp->sendoff = sent;
+
+    if (res > 0 || popped)
+      r_ev_tcp_send_iocb (evtcp);
+  } else if (res == -EAGAIN) {
+    if (evtcp->send_iocb_ctx == NULL)
+      evtcp->send_iocb_ctx = r_ev_io_start (&evtcp->evio, R_EV_IO_WRITABLE,
+          r_ev_tcp_iocb, NULL, NULL);
+  } else {
+    R_LOG_ERROR ("loop %p evio "R_EV_IO_FORMAT" res %d",
+        evtcp->evio.loop, R_EV_IO_ARGS (evtcp), res);
+  }
+
+  r_ev_tcp_unref (evtcp);
+}
+
+static void
+r_ev_tcp_ring_send (REvTCP * evtcp)
+{
+  REvTCPSendOp * sop;
+  REvTCPSendCtx * ctx;
+  RList * it;
+  rsize skip = evtcp->sendoff;
+
+  if ((sop = r_mem_new0 (REvTCPSendOp)) == NULL)
+    return;
+
+  for (it = evtcp->qsend.head; it != NULL && sop->count < R_N_ELEMENTS (sop->iov); it = it->next) {
+    ruint i, count;
+
+    ctx = it->data;
+    count = r_buffer_mem_count (ctx->buf);
+    for (i = 0; i < count && sop->count < R_N_ELEMENTS (sop->iov); i++) {
+      RMem * mem = r_buffer_mem_peek (ctx->buf, i);
+
+      if (!r_mem_map (mem, &sop->info[sop->count], R_MEM_MAP_READ)) {
+        r_mem_unref (mem);
+        continue;
+      }
+      if (skip >= sop->info[sop->count].size) {
+        skip -= sop->info[sop->count].size;
+        r_mem_unmap (mem, &sop->info[sop->count]);
+        r_mem_unref (mem);
+        continue;
+      }
+
+      sop->mem[sop->count] = mem;
+      sop->iov[sop->count].iov_base = sop->info[sop->count].data + skip;
+      sop->iov[sop->count].iov_len = sop->info[sop->count].size - skip;
+      skip = 0;
+      sop->count++;
+    }
+  }
+
+  sop->op.evio = &evtcp->evio;
+  sop->op.func = r_ev_tcp_ring_send_done;
+  sop->msg.msg_iov = sop->iov;
+  sop->msg.msg_iovlen = sop->count;
+  if (r_ev_loop_ring_sendmsg (evtcp->evio.loop, (RIOHandle)evtcp->socket->handle,
+        &sop->op, &sop->msg)) {
+    /* The op keeps us alive, so everything queued is flushed on close too */
+    r_ev_tcp_ref (evtcp);
+    evtcp->sendop = sop;
+  } else {
+    ruint i;
+    for (i = 0; i < sop->count; i++) {
+      r_mem_unmap (sop->mem[i], &sop->info[i]);
+      r_mem_unref (sop->mem[i]);
+    }
+    r_free (sop);
+  }
+}
+#endif
 
 static void
 r_ev_tcp_send_iocb (REvTCP * evtcp)
@@ -350,7 +559,18 @@ r_ev_tcp_send_iocb (REvTCP * evtcp)
   RSocketStatus res;
   rsize sent;
 
+  if (evtcp->sendop != NULL)
+    return;
+#ifdef HAVE_SYS_SOCKET_H
+  if (r_ev_io_ring_enabled (&evtcp->evio)) {
+    if (!r_queue_is_empty (&evtcp->qsend))
+      r_ev_tcp_ring_send (evtcp);
+    return;
+  }
+#endif
+
   while ((ctx = r_queue_peek (&evtcp->qsend)) != NULL) {
+    r_ev_io_count_syscalls (&evtcp->evio, 1);
     res = r_socket_send_message (evtcp->socket, NULL, ctx->buf, &sent);
     R_LOG_TRACE ("loop %p evio "R_EV_IO_FORMAT" res %d sent %"RSIZE_FMT,
         evtcp->evio.loop, R_EV_IO_ARGS (evtcp), res, sent);
@@ -437,6 +657,7 @@ r_ev_tcp_recv_start (REvTCP * evtcp,
     evtcp->alloc = alloc;
     evtcp->recv = recv;
     evtcp->recv_data = data;
+    r_ev_io_set_ring_recv (&evtcp->evio, r_ev_tcp_ring_recv, FALSE);
     return TRUE;
   }
 
@@ -476,6 +697,7 @@ r_ev_tcp_recv_stop (REvTCP * evtcp)
 
   ret = r_ev_io_stop (&evtcp->evio, evtcp->recv_iocb_ctx);
   evtcp->recv_iocb_ctx = NULL;
+  r_ev_io_set_ring_recv (&evtcp->evio, NULL, FALSE);
   if (evtcp->recv_task != NULL) {
     r_task_wait (evtcp->recv_task);
     r_task_unref (evtcp->recv_task);
@@ -40,6 +40,13 @@ typedef struct {
       (send)->datanotify ((send)->data);                                      \
   } R_STMT_END
 
+static void
+r_ev_udp_send_ctx_free (REvUDPSendCtx * ctx)
+{
+  r_ev_udp_send_ctx_clear (ctx);
+  r_free (ctx);
+}
+
 
 struct _REvUDP {
   REvIO evio;
@@ -50,18 +57,44 @@ struct _REvUDP {
 
   REvUDPBufferAllocFunc alloc;
   REvUDPBufferFunc recv;
+  REvUDPBufferBatchFunc recv_batch;
+  ruint batch;
+  RBuffer ** rxbufs; /* Allocated but unused buffers kept for next batch */
+  RSocketAddress ** rxaddrs; /* Only used with io_uring */
+  ruint rxfilled;
   rpointer recv_data;
   rpointer recv_iocb_ctx;
   rauint recv_counter;
   RTask * recv_task;
+  RBufferPool * pool;
 
   RQueue qsend;
 };
 
+static void
+r_ev_udp_clear_rxbufs (REvUDP * evudp)
+{
+  ruint i;
+
+  for (i = 0; i < evudp->rxfilled; i++) {
+    r_buffer_unref (evudp->rxbufs[i]);
+    if (evudp->rxaddrs != NULL && evudp->rxaddrs[i] != NULL)
+      r_socket_address_unref (evudp->rxaddrs[i]);
+  }
+  r_free (evudp->rxbufs);
+  r_free (evudp->rxaddrs);
+  evudp->rxbufs = NULL;
+  evudp->rxaddrs = NULL;
+  evudp->rxfilled = 0;
+}
+
 static void
 r_ev_udp_free (REvUDP * evudp)
 {
-  r_queue_clear (&evudp->qsend, r_buffer_unref);
+  r_ev_udp_clear_rxbufs (evudp);
+  if (evudp->pool != NULL)
+    r_buffer_pool_unref (evudp->pool);
+  r_queue_clear (&evudp->qsend, (RDestroyNotify)r_ev_udp_send_ctx_free);
   r_socket_unref (evudp->socket);
   r_ev_io_clear (&evudp->evio);
   r_free (evudp);
@@ -90,6 +123,12 @@ r_ev_udp_new (RSocketFamily family, REvLoop * loop)
   return ret;
 }
 
+RSocket *
+r_ev_udp_get_socket (const REvUDP * evudp)
+{
+  return evudp != NULL ? evudp->socket : NULL;
+}
+
 rboolean
 r_ev_udp_bind (REvUDP * evudp, const RSocketAddress * address, rboolean reuse)
 {
@@ -103,11 +142,82 @@ static RBuffer *
 r_ev_udp_buffer_alloc_default (rpointer data, REvUDP * evudp)
 {
   (void) data;
-  (void) evudp;
 
+  if (evudp->pool != NULL)
+    return r_buffer_pool_acquire (evudp->pool);
   return r_buffer_new_alloc (NULL, R_EV_UDP_BUFFER_SIZE, NULL);
 }
 
+void
+r_ev_udp_set_buffer_pool (REvUDP * evudp, RBufferPool * pool)
+{
+  if (pool != NULL)
+    r_buffer_pool_ref (pool);
+  if (evudp->pool != NULL)
+    r_buffer_pool_unref (evudp->pool);
+  evudp->pool = pool;
+}
+
+static void
+r_ev_udp_recv_batch_iocb (REvUDP * evudp)
+{
+  RBuffer ** rxbufs = evudp->rxbufs, ** bufs;
+  rpointer ctx = evudp->recv_iocb_ctx;
+  ruint batch = evudp->batch;
+  RSocketAddress * addr, ** paddr, ** copy;
+  RSocketStatus res;
+  ruint i, msgs;
+
+  addr = r_alloca0 (batch * sizeof (RSocketAddress));
+  paddr = r_alloca (batch * sizeof (RSocketAddress *));
+  copy = r_alloca (batch * sizeof (RSocketAddress *));
+  bufs = r_alloca (batch * sizeof (RBuffer *));
+  for (i = 0; i < batch; i++)
+    paddr[i] = &addr[i];
+  r_atomic_uint_store (&evudp->recv_counter, 0);
+
+  do {
+    /* Buffers not filled by the previous round are reused */
+    for (; evudp->rxfilled < batch; evudp->rxfilled++) {
+      if ((rxbufs[evudp->rxfilled] = evudp->alloc (evudp->recv_data, evudp)) == NULL)
+        break;
+    }
+    if (evudp->rxfilled == 0) {
+      res = R_SOCKET_OOM;
+      break;
+    }
+
+    for (i = 0; i < evudp->rxfilled; i++)
+      addr[i].addrlen = sizeof (addr[i].addr);
+    r_ev_io_count_syscalls (&evudp->evio, 1);
+    res = r_socket_receive_messages (evudp->socket, paddr, rxbufs, NULL,
+        evudp->rxfilled, &msgs);
+    if (res == R_SOCKET_OK) {
+      /* The callback might stop receiving and free rxbufs */
+      r_memcpy (bufs, rxbufs, msgs * sizeof (RBuffer *));
+      evudp->rxfilled -= msgs;
+      r_memmove (rxbufs, &rxbufs[msgs], evudp->rxfilled * sizeof (RBuffer *));
+      for (i = 0; i < msgs; i++)
+        copy[i] = r_socket_address_copy (&addr[i]);
+
+      evudp->recv_batch (evudp->recv_data, bufs, copy, msgs, evudp);
+      for (i = 0; i < msgs; i++) {
+        r_socket_address_unref (copy[i]);
+        r_buffer_unref (bufs[i]);
+      }
+
+      if (evudp->recv_iocb_ctx != ctx || evudp->rxbufs != rxbufs ||
+          evudp->batch != batch)
+        return;
+    }
+    /* FIXME: Handle errors?? */
+  } while (res == R_SOCKET_OK);
+
+  /* FIXME: What do we do when something fails and we are unable to drain socket? */
+  if (res != R_SOCKET_WOULD_BLOCK)
+    abort ();
+}
+
 static void
 r_ev_udp_recv_iocb (REvUDP * evudp)
 {
@@ -116,6 +226,11 @@ r_ev_udp_recv_iocb (REvUDP * evudp)
   RSocketAddress addr, * copy;
   rsize size;
 
+  if (evudp->recv_batch != NULL) {
+    r_ev_udp_recv_batch_iocb (evudp);
+    return;
+  }
+
   r_memclear (&addr, sizeof (RSocketAddress));
   r_atomic_uint_store (&evudp->recv_counter, 0);
 
@@ -126,6 +241,7 @@ r_ev_udp_recv_iocb (REvUDP * evudp)
     }
 
     addr.addrlen = sizeof (addr.addr);
+    r_ev_io_count_syscalls (&evudp->evio, 1);
     res = r_socket_receive_message (evudp->socket, &addr, buf, &size);
     switch (res) {
       case R_SOCKET_OK:
@@ -145,21 +261,95 @@ r_ev_udp_recv_iocb (REvUDP * evudp)
     abort ();
 }
 
+static RBuffer *
+r_ev_udp_ring_buffer (REvUDP * evudp, rconstpointer data, rsize size)
+{
+  RBuffer * buf;
+
+  if ((buf = evudp->alloc (evudp->recv_data, evudp)) != NULL)
+    r_buffer_resize (buf, 0, r_buffer_fill (buf, 0, data, size));
+
+  return buf;
+}
+
+/* Datagrams received by the io_uring backend, delivered in batches of up
+ * to evudp->batch as long as the loop has more completions for us */
+static void
+r_ev_udp_ring_recv (REvIO * evio, rconstpointer data, rssize size,
+    rconstpointer name, rsize namelen, rboolean more)
+{
+  REvUDP * evudp = (REvUDP *)evio;
+  RSocketAddress * addr, ** addrs;
+  RBuffer * buf, ** bufs;
+  ruint i, count;
+
+  /* Errors are reported for a single datagram, just keep going */
+  if (R_UNLIKELY (size < 0))
+    return;
+  if (R_UNLIKELY ((buf = r_ev_udp_ring_buffer (evudp, data, size)) == NULL))
+    return;
+  addr = r_socket_address_new_from_native (name, namelen);
+
+  if (evudp->recv_batch == NULL) {
+    evudp->recv (evudp->recv_data, buf, addr, evudp);
+    r_buffer_unref (buf);
+    if (addr != NULL)
+      r_socket_address_unref (addr);
+    return;
+  }
+
+  evudp->rxbufs[evudp->rxfilled] = buf;
+  evudp->rxaddrs[evudp->rxfilled] = addr;
+  if (++evudp->rxfilled < evudp->batch && more)
+    return;
+
+  /* The callback might stop receiving and free rxbufs */
+  count = evudp->rxfilled;
+  bufs = r_alloca (count * sizeof (RBuffer *));
+  addrs = r_alloca (count * sizeof (RSocketAddress *));
+  r_memcpy (bufs, evudp->rxbufs, count * sizeof (RBuffer *));
+  r_memcpy (addrs, evudp->rxaddrs, count * sizeof (RSocketAddress *));
+  r_memclear (evudp->rxaddrs, count * sizeof (RSocketAddress *));
+  evudp->rxfilled = 0;
+
+  evudp->recv_batch (evudp->recv_data, bufs, addrs, count, evudp);
+  for (i = 0; i < count; i++) {
+    r_buffer_unref (bufs[i]);
+    if (addrs[i] != NULL)
+      r_socket_address_unref (addrs[i]);
+  }
+}
+
+#define R_EV_UDP_SEND_BATCH         32
+
 static void
 r_ev_udp_send_iocb (REvUDP * evudp)
 {
   REvUDPSendCtx * ctx;
+  RSocketAddress * addrs[R_EV_UDP_SEND_BATCH];
+  RBuffer * bufs[R_EV_UDP_SEND_BATCH];
   RSocketStatus res;
-  rsize sent;
+  RList * it;
+  ruint i, count, msgs;
+
+  while (!r_queue_is_empty (&evudp->qsend)) {
+    for (count = 0, it = evudp->qsend.head;
+        it != NULL && count < R_N_ELEMENTS (bufs); it = it->next, count++) {
+      ctx = it->data;
+      addrs[count] = ctx->addr;
+      bufs[count] = ctx->buf;
+    }
 
-  while ((ctx = r_queue_peek (&evudp->qsend)) != NULL) {
-    res = r_socket_send_message (evudp->socket, ctx->addr, ctx->buf, &sent);
+    r_ev_io_count_syscalls (&evudp->evio, 1);
+    res = r_socket_send_messages (evudp->socket, addrs, bufs, NULL, count, &msgs);
     if (res == R_SOCKET_OK) {
-      r_queue_pop (&evudp->qsend);
-      if (ctx->done != NULL)
-        ctx->done (ctx->data, ctx->buf, ctx->addr, evudp);
-      r_ev_udp_send_ctx_clear (ctx);
-      r_free (ctx);
+      for (i = 0; i < msgs; i++) {
+        ctx = r_queue_pop (&evudp->qsend);
+        if (ctx->done != NULL)
+          ctx->done (ctx->data, ctx->buf, ctx->addr, evudp);
+        r_ev_udp_send_ctx_clear (ctx);
+        r_free (ctx);
+      }
     } else if (res == R_SOCKET_WOULD_BLOCK) {
       break;
     } else {
@@ -231,7 +421,9 @@ r_ev_udp_recv_start (REvUDP * evudp,
 
     evudp->alloc = alloc;
     evudp->recv = recv;
+    evudp->recv_batch = NULL;
     evudp->recv_data = data;
+    r_ev_io_set_ring_recv (&evudp->evio, r_ev_udp_ring_recv, TRUE);
     return TRUE;
   }
 
@@ -255,6 +447,70 @@ r_ev_udp_task_recv_start (REvUDP * evudp, ruint taskgroup,
     evudp->taskgroup = taskgroup;
     evudp->alloc = alloc;
     evudp->recv = recv;
+    evudp->recv_batch = NULL;
+    evudp->recv_data = data;
+    r_atomic_uint_store (&evudp->recv_counter, 0);
+    evudp->recv_task = NULL;
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+rboolean
+r_ev_udp_recv_batch_start (REvUDP * evudp, ruint batch,
+    REvUDPBufferAllocFunc alloc, REvUDPBufferBatchFunc recv,
+    rpointer data, RDestroyNotify datanotify)
+{
+  if (R_UNLIKELY (recv == NULL)) return FALSE;
+  if (R_UNLIKELY (batch == 0 || batch > R_SOCKET_MAX_MESSAGES)) return FALSE;
+  if (R_UNLIKELY (evudp->recv_iocb_ctx != NULL)) return FALSE;
+
+  r_ev_udp_clear_rxbufs (evudp);
+  if ((evudp->rxbufs = r_mem_new_n (RBuffer *, batch)) == NULL) return FALSE;
+  if (r_ev_io_ring_enabled (&evudp->evio) &&
+      (evudp->rxaddrs = r_mem_new0_n (RSocketAddress *, batch)) == NULL) return FALSE;
+
+  if ((evudp->recv_iocb_ctx = r_ev_io_start (&evudp->evio, R_EV_IO_READABLE,
+      r_ev_udp_iocb, data, datanotify))) {
+    if (alloc == NULL)
+      alloc = r_ev_udp_buffer_alloc_default;
+
+    evudp->alloc = alloc;
+    evudp->recv = NULL;
+    evudp->recv_batch = recv;
+    evudp->batch = batch;
+    evudp->recv_data = data;
+    r_ev_io_set_ring_recv (&evudp->evio, r_ev_udp_ring_recv, TRUE);
+    return TRUE;
+  }
+
+  return FALSE;
+}
+
+rboolean
+r_ev_udp_task_recv_batch_start (REvUDP * evudp, ruint taskgroup, ruint batch,
+    REvUDPBufferAllocFunc alloc, REvUDPBufferBatchFunc recv,
+    rpointer data, RDestroyNotify datanotify)
+{
+  if (R_UNLIKELY (recv == NULL)) return FALSE;
+  if (R_UNLIKELY (batch == 0 || batch > R_SOCKET_MAX_MESSAGES)) return FALSE;
+  if (R_UNLIKELY (evudp->recv_iocb_ctx != NULL)) return FALSE;
+  if (R_UNLIKELY (!r_ev_io_validate_taskgroup (&evudp->evio, taskgroup))) return FALSE;
+
+  r_ev_udp_clear_rxbufs (evudp);
+  if ((evudp->rxbufs = r_mem_new_n (RBuffer *, batch)) == NULL) return FALSE;
+
+  if ((evudp->recv_iocb_ctx = r_ev_io_start (&evudp->evio, R_EV_IO_READABLE,
+      r_ev_udp_task_iocb, data, datanotify))) {
+    if (alloc == NULL)
+      alloc = r_ev_udp_buffer_alloc_default;
+
+    evudp->taskgroup = taskgroup;
+    evudp->alloc = alloc;
+    evudp->recv = NULL;
+    evudp->recv_batch = recv;
+    evudp->batch = batch;
     evudp->recv_data = data;
     r_atomic_uint_store (&evudp->recv_counter, 0);
     evudp->recv_task = NULL;
@@ -271,10 +527,12 @@ r_ev_udp_recv_stop (REvUDP * evudp)
 
   ret = r_ev_io_stop (&evudp->evio, evudp->recv_iocb_ctx);
   evudp->recv_iocb_ctx = NULL;
+  r_ev_io_set_ring_recv (&evudp->evio, NULL, FALSE);
   if (evudp->recv_task != NULL) {
     r_task_wait (evudp->recv_task);
     r_task_unref (evudp->recv_task);
   }
+  r_ev_udp_clear_rxbufs (evudp);
 
   return ret;
 }
@@ -645,6 +645,338 @@ r_http_request_calc_body_size (RHttpRequest * req, RHttpBodyParseType * type)
 }
 
 
+rboolean
+r_http_request_is_persistent (RHttpRequest * req)
+{
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rboolean http10;
+
+  if (r_http_request_has_header_of_value (req, "Connection", -1, "close", -1))
+    return FALSE;
+
+  /* HTTP/1.1 defaults to persistent connections, HTTP/1.0 must ask for it */
+  if (r_buffer_map (req->msg.start, &info, R_MEM_MAP_READ)) {
+    http10 = r_str_idx_of_str ((const rchar *)info.data, info.size,
+        R_STR_WITH_SIZE_ARGS ("HTTP/1.0")) >= 0;
+    r_buffer_unmap (req->msg.start, &info);
+  } else {
+    http10 = TRUE;
+  }
+
+  return !http10 ||
+    r_http_request_has_header_of_value (req, "Connection", -1, "keep-alive", -1);
+}
+
+
+typedef enum {
+  R_HTTP_PARSER_STATE_HDR = 0,
+  R_HTTP_PARSER_STATE_BODY,
+  R_HTTP_PARSER_STATE_CHUNK_SIZE,
+  R_HTTP_PARSER_STATE_CHUNK_DATA,
+  R_HTTP_PARSER_STATE_CHUNK_CRLF,
+  R_HTTP_PARSER_STATE_TRAILER,
+  R_HTTP_PARSER_STATE_ERROR,
+} RHttpParserState;
+
+#define R_HTTP_PARSER_MAX_CHUNK_LINE    1024
+
+struct _RHttpRequestParser {
+  RBuffer * buf;      /* Not yet consumed data */
+  rsize scan;         /* Bytes of buf already scanned for a terminator */
+  ruint match;        /* Number of matched "\r\n\r\n" bytes at scan */
+
+  RHttpParserState state;
+  RHttpRequest * req;
+  ruint64 remaining;  /* Body or chunk data left */
+  RHttpError err;
+};
+
+RHttpRequestParser *
+r_http_request_parser_new (void)
+{
+  return r_mem_new0 (RHttpRequestParser);
+}
+
+void
+r_http_request_parser_free (RHttpRequestParser * parser)
+{
+  if (parser != NULL) {
+    if (parser->buf != NULL)
+      r_buffer_unref (parser->buf);
+    if (parser->req != NULL)
+      r_http_request_unref (parser->req);
+    r_free (parser);
+  }
+}
+
+rboolean
+r_http_request_parser_push (RHttpRequestParser * parser, RBuffer * buf)
+{
+  if (R_UNLIKELY (parser == NULL)) return FALSE;
+  if (R_UNLIKELY (buf == NULL)) return FALSE;
+
+  /* Only references the memory of buf, the pushed buffer is left untouched */
+  if (parser->buf == NULL && (parser->buf = r_buffer_new ()) == NULL)
+    return FALSE;
+  return r_buffer_append_mem_from_buffer (parser->buf, buf);
+}
+
+rsize
+r_http_request_parser_get_buffered (const RHttpRequestParser * parser)
+{
+  return parser->buf != NULL ? r_buffer_get_size (parser->buf) : 0;
+}
+
+static void
+r_http_request_parser_consume (RHttpRequestParser * parser, rsize size)
+{
+  RBuffer * rest;
+
+  if (size < r_buffer_get_size (parser->buf))
+    rest = r_buffer_view (parser->buf, size, -1);
+  else
+    rest = NULL;
+
+  r_buffer_unref (parser->buf);
+  parser->buf = rest;
+  parser->scan = parser->scan > size ? parser->scan - size : 0;
+}
+
+/* Scans the not yet scanned data for "\r\n" (term == 2) or "\r\n\r\n"
+ * (term == 4), one mem at the time. The progress is kept in the parser so
+ * data is never scanned twice, no matter how it is split across reads. */
+static rboolean
+r_http_request_parser_scan (RHttpRequestParser * parser, ruint term, rsize * end)
+{
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  ruint idx, count, match = parser->match;
+  rsize off, i;
+
+  if (parser->buf == NULL || parser->scan >= r_buffer_get_size (parser->buf))
+    return FALSE;
+  if (!r_buffer_mem_find (parser->buf, parser->scan, -1, &idx, &count, &off, NULL))
+    return FALSE;
+
+  for (count += idx; idx < count; idx++, off = 0) {
+    if (!r_buffer_map_mem_range (parser->buf, idx, 1, &info, R_MEM_MAP_READ))
+      return FALSE;
+
+    for (i = off; i < info.size; i++) {
+      if (match == 0) {
+        const ruint8 * cr;
+        if ((cr = r_mem_scan_byte (info.data + i, info.size - i, (ruint8)'\r')) == NULL)
+          break;
+        i = RPOINTER_TO_SIZE (cr - info.data);
+      }
+
+      switch (info.data[i]) {
+        case '\r':
+          match = (match == 2) ? 3 : 1;
+          break;
+        case '\n':
+          match = (match == 1 || match == 3) ? match + 1 : 0;
+          break;
+        default:
+          match = 0;
+          break;
+      }
+
+      if (match == term) {
+        *end = parser->scan + i - off + 1;
+        r_buffer_unmap (parser->buf, &info);
+        parser->scan = 0;
+        parser->match = 0;
+        return TRUE;
+      }
+    }
+
+    parser->scan += info.size - off;
+    r_buffer_unmap (parser->buf, &info);
+  }
+
+  parser->match = match;
+  return FALSE;
+}
+
+static RHttpParseEvent
+r_http_request_parser_error (RHttpRequestParser * parser, RHttpError err,
+    RHttpError * out)
+{
+  parser->state = R_HTTP_PARSER_STATE_ERROR;
+  parser->err = err;
+  if (out != NULL)
+    *out = err;
+  return R_HTTP_PARSE_ERROR;
+}
+
+static RHttpParseEvent
+r_http_request_parser_headers (RHttpRequestParser * parser,
+    RHttpRequest ** req, RHttpError * err)
+{
+  RHttpBodyParseType type;
+  RBuffer * hdr;
+  RHttpError res;
+  rssize bodysize;
+  rsize end;
+
+  if (!r_http_request_parser_scan (parser, 4, &end)) {
+    if (r_http_request_parser_get_buffered (parser) > R_HTTP_REQUEST_PARSER_MAX_HDR_SIZE)
+      return r_http_request_parser_error (parser, R_HTTP_BAD_DATA, err);
+    return R_HTTP_PARSE_NEED_DATA;
+  }
+
+  if ((hdr = r_buffer_view (parser->buf, 0, end)) == NULL)
+    return r_http_request_parser_error (parser, R_HTTP_OOM, err);
+  r_http_request_parser_consume (parser, end);
+  parser->req = r_http_request_new_from_buffer (hdr, &res, NULL);
+  r_buffer_unref (hdr);
+  if (parser->req == NULL)
+    return r_http_request_parser_error (parser, res, err);
+
+  bodysize = r_http_request_calc_body_size (parser->req, &type);
+  if (type == R_HTTP_BODY_PARSE_CHUNKED) {
+    parser->state = R_HTTP_PARSER_STATE_CHUNK_SIZE;
+  } else if (bodysize >= 0) {
+    parser->state = R_HTTP_PARSER_STATE_BODY;
+    parser->remaining = (ruint64)bodysize;
+  } else {
+    return r_http_request_parser_error (parser, R_HTTP_BAD_DATA, err);
+  }
+
+  if (req != NULL)
+    *req = r_http_request_ref (parser->req);
+  return R_HTTP_PARSE_REQUEST;
+}
+
+static RHttpParseEvent
+r_http_request_parser_chunk_size (RHttpRequestParser * parser, RHttpError * err)
+{
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rboolean valid;
+  rsize end, i;
+
+  if (!r_http_request_parser_scan (parser, 2, &end)) {
+    if (r_http_request_parser_get_buffered (parser) > R_HTTP_PARSER_MAX_CHUNK_LINE)
+      return r_http_request_parser_error (parser, R_HTTP_BAD_DATA, err);
+    return R_HTTP_PARSE_NEED_DATA;
+  }
+
+  /* chunk-size [ chunk-ext ] CRLF */
+  if (!r_buffer_map_byte_range (parser->buf, 0, end, &info, R_MEM_MAP_READ))
+    return r_http_request_parser_error (parser, R_HTTP_OOM, err);
+  parser->remaining = 0;
+  for (i = 0; i < 16 && r_ascii_isxdigit (info.data[i]); i++)
+    parser->remaining = (parser->remaining << 4) | (ruint64)r_ascii_xdigit_value (info.data[i]);
+  valid = i > 0 && (info.data[i] == ';' || info.data[i] == '\r' ||
+      info.data[i] == ' ' || info.data[i] == '\t');
+  r_buffer_unmap (parser->buf, &info);
+
+  if (!valid)
+    return r_http_request_parser_error (parser, R_HTTP_BAD_DATA, err);
+
+  r_http_request_parser_consume (parser, end);
+  if (parser->remaining > 0) {
+    parser->state = R_HTTP_PARSER_STATE_CHUNK_DATA;
+  } else {
+    /* Last chunk, the (ignored) trailer section ends with an empty line */
+    parser->state = R_HTTP_PARSER_STATE_TRAILER;
+    parser->match = 2;
+  }
+
+  return R_HTTP_PARSE_NEED_DATA;
+}
+
+static RHttpParseEvent
+r_http_request_parser_data (RHttpRequestParser * parser, RBuffer ** body,
+    RHttpError * err)
+{
+  rsize size;
+
+  if (parser->buf == NULL)
+    return R_HTTP_PARSE_NEED_DATA;
+
+  size = r_buffer_get_size (parser->buf);
+  if ((ruint64)size > parser->remaining)
+    size = (rsize)parser->remaining;
+
+  if (body != NULL && (*body = r_buffer_view (parser->buf, 0, size)) == NULL)
+    return r_http_request_parser_error (parser, R_HTTP_OOM, err);
+  r_http_request_parser_consume (parser, size);
+  parser->remaining -= size;
+
+  return R_HTTP_PARSE_BODY;
+}
+
+RHttpParseEvent
+r_http_request_parser_next (RHttpRequestParser * parser,
+    RHttpRequest ** req, RBuffer ** body, RHttpError * err)
+{
+  RHttpParseEvent ret;
+  rsize end;
+
+  if (R_UNLIKELY (parser == NULL)) {
+    if (err != NULL) *err = R_HTTP_INVAL;
+    return R_HTTP_PARSE_ERROR;
+  }
+
+  if (req != NULL) *req = NULL;
+  if (body != NULL) *body = NULL;
+  if (err != NULL) *err = R_HTTP_OK;
+
+  for (;;) {
+    switch (parser->state) {
+      case R_HTTP_PARSER_STATE_HDR:
+        return r_http_request_parser_headers (parser, req, err);
+      case R_HTTP_PARSER_STATE_BODY:
+        if (parser->remaining == 0)
+          goto complete;
+        return r_http_request_parser_data (parser, body, err);
+      case R_HTTP_PARSER_STATE_CHUNK_SIZE:
+        /* Either stuck in the same state, or moved on to the chunk data */
+        if ((ret = r_http_request_parser_chunk_size (parser, err)) != R_HTTP_PARSE_NEED_DATA ||
+            parser->state == R_HTTP_PARSER_STATE_CHUNK_SIZE)
+          return ret;
+        break;
+      case R_HTTP_PARSER_STATE_CHUNK_DATA:
+        if (parser->remaining > 0)
+          return r_http_request_parser_data (parser, body, err);
+        parser->state = R_HTTP_PARSER_STATE_CHUNK_CRLF;
+        break;
+      case R_HTTP_PARSER_STATE_CHUNK_CRLF:
+        if (r_http_request_parser_get_buffered (parser) < 2)
+          return R_HTTP_PARSE_NEED_DATA;
+        if (r_buffer_memcmp (parser->buf, 0, "\r\n", 2) != 0)
+          return r_http_request_parser_error (parser, R_HTTP_BAD_DATA, err);
+        r_http_request_parser_consume (parser, 2);
+        parser->state = R_HTTP_PARSER_STATE_CHUNK_SIZE;
+        break;
+      case R_HTTP_PARSER_STATE_TRAILER:
+        if (!r_http_request_parser_scan (parser, 4, &end)) {
+          if (r_http_request_parser_get_buffered (parser) > R_HTTP_REQUEST_PARSER_MAX_HDR_SIZE)
+            return r_http_request_parser_error (parser, R_HTTP_BAD_DATA, err);
+          return R_HTTP_PARSE_NEED_DATA;
+        }
+        r_http_request_parser_consume (parser, end);
+        goto complete;
+      case R_HTTP_PARSER_STATE_ERROR:
+      default:
+        if (err != NULL)
+          *err = parser->err;
+        return R_HTTP_PARSE_ERROR;
+    }
+  }
+
+complete:
+  parser->state = R_HTTP_PARSER_STATE_HDR;
+  if (req != NULL)
+    *req = parser->req;
+  else
+    r_http_request_unref (parser->req);
+  parser->req = NULL;
+  return R_HTTP_PARSE_END;
+}
+
+
 static const rchar *
 r_http_status_get_phrase (RHttpStatus status)
 {
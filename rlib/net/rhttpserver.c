@@ -27,12 +27,14 @@
 #include <rlib/data/rptrarray.h>
 
 #include <rlib/rmem.h>
+#include <rlib/rstr.h>
 
 struct _RHttpServer {
   RRef ref;
 
   REvLoop * loop;
   RDirTree * dt;
+  RDirTree * bodydt;
 
   RPtrArray * clients;
   RPtrArray * listen;
@@ -43,11 +45,16 @@ typedef struct {
   RHttpServer * server;
   REvTCP * evtcp;
 
+  RHttpRequestParser * parser;
   RHttpRequest * req;
-  rssize bodysize;
-  RBuffer * inbuf;
+  RBuffer * body;
+  RBuffer * outbuf;
+  RHttpRequestBodyFunc bodyfunc;
+  rpointer bodydata;
 
   rboolean keepalive;
+  rboolean closing;   /* Last dispatched request closes the connection */
+  rsize inflight;     /* Requests dispatched, but not yet responded to */
 } RHttpClientCtx;
 
 #define R_LOG_CAT_DEFAULT &httpsrvcat
@@ -61,13 +68,38 @@ r_http_server_init (void)
 }
 
 
+static RHttpRequestBodyFunc
+r_http_server_lookup_body_handler (RHttpServer * server, RHttpRequest * req,
+    rpointer * data)
+{
+  RHttpRequestBodyFunc ret = NULL;
+  RDirTreeNode * node;
+  const rchar * path;
+  rsize size = 0;
+  RUri * uri;
+
+  if ((uri = r_http_request_get_uri (req)) != NULL) {
+    if ((path = r_uri_get_path_ptr (uri, &size)) != NULL &&
+        (node = r_dir_tree_get_or_any_parent (server->bodydt, path, (rssize)size)) != NULL &&
+        (ret = (RHttpRequestBodyFunc) r_dir_tree_node_func (node)) != NULL) {
+      *data = r_dir_tree_node_get (node);
+    }
+    r_uri_unref (uri);
+  }
+
+  return ret;
+}
+
 static void
 r_http_client_ctx_free (RHttpClientCtx * ctx)
 {
-  if (ctx->inbuf != NULL)
-    r_buffer_unref (ctx->inbuf);
+  r_http_request_parser_free (ctx->parser);
   if (ctx->req != NULL)
     r_http_request_unref (ctx->req);
+  if (ctx->body != NULL)
+    r_buffer_unref (ctx->body);
+  if (ctx->outbuf != NULL)
+    r_buffer_unref (ctx->outbuf);
 
   r_ev_tcp_unref (ctx->evtcp);
   r_http_server_unref (ctx->server);
@@ -87,6 +119,7 @@ r_http_client_ctx_new (RHttpServer * server, REvTCP * evtcp)
 
     ret->server = r_http_server_ref (server);
     ret->evtcp = r_ev_tcp_ref (evtcp);
+    ret->parser = r_http_request_parser_new ();
   }
 
   return ret;
@@ -118,13 +151,42 @@ r_http_client_ctx_tcp_response_ready (rpointer data, RHttpResponse * res,
 {
   RHttpClientCtx * ctx = data;
   RBuffer * buf;
+  rboolean keepalive;
+
+  /* Responses are ready in the same order as the requests were dispatched */
+  ctx->inflight--;
+  keepalive = !ctx->closing || ctx->inflight > 0;
+
+  /* A persistent connection needs the response to be delimited */
+  if (keepalive &&
+      !r_http_response_has_header (res, "Content-Length", -1) &&
+      !r_http_response_has_header (res, "Transfer-Encoding", -1)) {
+    rchar len[24];
+    RBuffer * body = r_http_response_get_body_buffer (res);
+
+    r_sprintf (len, "%"RSIZE_FMT, body != NULL ? r_buffer_get_size (body) : 0);
+    r_http_response_add_header (res, "Content-Length", -1, len, -1);
+    if (body != NULL)
+      r_buffer_unref (body);
+  }
 
-  if ((buf = r_http_response_get_buffer (res)) != NULL) {
+  if (res != NULL && (buf = r_http_response_get_buffer (res)) != NULL) {
     R_LOG_TRACE ("%p: Buffer %p on "R_EV_IO_FORMAT" [%s]",
-        server, buf, R_EV_IO_ARGS (ctx->evtcp), ctx->keepalive ? "keepalive" : "close");
+        server, buf, R_EV_IO_ARGS (ctx->evtcp), keepalive ? "keepalive" : "close");
     R_LOG_BUF_DUMP (R_LOG_LEVEL_TRACE, buf);
 
-    if (!ctx->keepalive) {
+    if (ctx->outbuf == NULL) {
+      ctx->outbuf = buf;
+    } else {
+      r_buffer_append_mem_from_buffer (ctx->outbuf, buf);
+      r_buffer_unref (buf);
+    }
+  }
+
+  /* Responses to pipelined requests are sent together with the last one */
+  if (ctx->inflight == 0 && (buf = ctx->outbuf) != NULL) {
+    ctx->outbuf = NULL;
+    if (!keepalive) {
       r_ev_tcp_send (ctx->evtcp, buf, r_http_client_ctx_response_sent,
           r_ref_ref (ctx), r_ref_unref);
     } else {
@@ -140,10 +202,18 @@ r_http_client_ctx_process (RHttpClientCtx * ctx)
   RSocketAddress * addr = r_ev_tcp_get_remote_address (ctx->evtcp);
   rboolean ret;
 
+  if (ctx->body != NULL) {
+    r_http_request_set_body_buffer (ctx->req, ctx->body);
+    r_buffer_unref (ctx->body);
+    ctx->body = NULL;
+  }
+
   if ((ret = r_http_server_process_request (ctx->server, ctx->req, addr,
       r_http_client_ctx_tcp_response_ready, r_ref_ref (ctx), r_ref_unref))) {
     r_http_request_unref (ctx->req);
     ctx->req = NULL;
+    ctx->inflight++;
+    ctx->closing = !ctx->keepalive;
   }
 
   if (addr != NULL)
@@ -152,26 +222,58 @@ r_http_client_ctx_process (RHttpClientCtx * ctx)
   return ret;
 }
 
+static void
+r_http_client_ctx_bad_request_respond (rpointer data, REvLoop * loop)
+{
+  RHttpClientCtx * ctx = data;
+  RHttpResponse * res;
+
+  (void) loop;
+
+  if ((res = r_http_response_new (NULL, R_HTTP_STATUS_BAD_REQUEST,
+          NULL, NULL, NULL)) != NULL) {
+    r_http_client_ctx_tcp_response_ready (ctx, res, ctx->server);
+    r_http_response_unref (res);
+  } else {
+    R_LOG_WARNING ("%p: "R_EV_IO_FORMAT" closing, error and unable to respond",
+        ctx->server, R_EV_IO_ARGS (ctx->evtcp));
+    r_http_client_ctx_close (ctx, NULL, NULL);
+  }
+}
+
+static void
+r_http_client_ctx_bad_request (RHttpClientCtx * ctx, RHttpError err)
+{
+  R_LOG_TRACE ("%p: "R_EV_IO_FORMAT" request not parsed. err: %d",
+      ctx->server, R_EV_IO_ARGS (ctx->evtcp), (int)err);
+
+  /* Send error (after responses to requests already dispatched) and close! */
+  ctx->keepalive = FALSE;
+  ctx->closing = TRUE;
+  ctx->inflight++;
+  r_ev_loop_add_callback (ctx->server->loop, FALSE,
+      r_http_client_ctx_bad_request_respond, r_ref_ref (ctx), r_ref_unref);
+}
+
 static void
 r_http_client_ctx_tcp_recv (rpointer data, RBuffer * buf, REvTCP * evtcp)
 {
   RHttpClientCtx * ctx = data;
+  RHttpRequest * req;
+  RBuffer * body;
   RHttpError err;
 
-  if (buf != NULL) {
-    R_LOG_TRACE ("%p: Buffer %p on "R_EV_IO_FORMAT" (%"RSIZE_FMT")",
-        ctx->server, buf, R_EV_IO_ARGS (evtcp), r_buffer_get_size (buf));
-    R_LOG_BUF_DUMP (R_LOG_LEVEL_TRACE, buf);
+  /* Anything received after a request closing the connection is ignored */
+  if (ctx->closing)
+    return;
 
-    if (ctx->inbuf == NULL)
-      ctx->inbuf = r_buffer_ref (buf);
-    else
-      r_buffer_append_mem_from_buffer (ctx->inbuf, buf);
-  } else {
+  if (buf == NULL) {
     /* FIXME */
     ctx->keepalive = FALSE;
 
     if (ctx->req != NULL) {
+      if (ctx->bodyfunc != NULL)
+        ctx->bodyfunc (ctx->bodydata, ctx->req, NULL, ctx->server);
       r_http_client_ctx_process (ctx);
     } else {
       R_LOG_INFO ("%p: "R_EV_IO_FORMAT" closing, but nothing parsed",
@@ -182,89 +284,59 @@ r_http_client_ctx_tcp_recv (rpointer data, RBuffer * buf, REvTCP * evtcp)
     return;
   }
 
-  do {
-    /* Process request-line and headers */
-    if (ctx->req == NULL) {
-      buf = NULL;
-      if ((ctx->req = r_http_request_new_from_buffer (ctx->inbuf, &err, &buf)) != NULL) {
-        ctx->bodysize = r_http_request_calc_body_size (ctx->req, NULL);
-        if (r_http_request_has_header_of_value (ctx->req, "Connection", -1, "close", -1))
-          ctx->keepalive = FALSE;
-        else
-          ctx->keepalive = r_http_request_has_header_of_value (ctx->req,
-              "Connection", -1, "keep-alive", -1);
-
-        R_LOG_TRACE ("%p: "R_EV_IO_FORMAT" request created %p [%s] waiting for body size %"RSSIZE_FMT,
-            ctx->server, R_EV_IO_ARGS (evtcp), ctx->req, ctx->keepalive ? "keepalive" : "close", ctx->bodysize);
-      } else if (err == R_HTTP_BUF_TOO_SMALL) {
-        R_LOG_TRACE ("%p: "R_EV_IO_FORMAT" waiting for more data (%"RSIZE_FMT")",
-            ctx->server, R_EV_IO_ARGS (evtcp), r_buffer_get_size (ctx->inbuf));
-      } else {
-        RHttpResponse * res;
-
-        R_LOG_TRACE ("%p: "R_EV_IO_FORMAT" request not parsed. err: %d",
-            ctx->server, R_EV_IO_ARGS (evtcp), (int)err);
-
-        /* Send error and close! */
-        ctx->keepalive = FALSE;
-        if ((res = r_http_response_new (NULL, R_HTTP_STATUS_BAD_REQUEST,
-                NULL, NULL, NULL)) != NULL) {
-          r_http_client_ctx_tcp_response_ready (ctx, res, ctx->server);
-          r_http_response_unref (res);
-        } else {
-          R_LOG_WARNING ("%p: "R_EV_IO_FORMAT" closing, error and unable to respond",
-              ctx->server, R_EV_IO_ARGS (evtcp));
-          r_http_client_ctx_close (ctx, NULL, NULL);
-        }
-      }
+  R_LOG_TRACE ("%p: Buffer %p on "R_EV_IO_FORMAT" (%"RSIZE_FMT")",
+      ctx->server, buf, R_EV_IO_ARGS (evtcp), r_buffer_get_size (buf));
+  R_LOG_BUF_DUMP (R_LOG_LEVEL_TRACE, buf);
 
-      if (buf != NULL) {
-        R_LOG_TRACE ("%p: "R_EV_IO_FORMAT" data buffered: %"RSIZE_FMT,
-            ctx->server, R_EV_IO_ARGS (evtcp), r_buffer_get_size (buf));
-      }
-      r_buffer_unref (ctx->inbuf);
-      ctx->inbuf = buf;
+  r_http_request_parser_push (ctx->parser, buf);
 
-      if (ctx->req == NULL)
+  /* Any number of (pipelined) requests might be complete by now */
+  for (;;) {
+    switch (r_http_request_parser_next (ctx->parser, &req, &body, &err)) {
+      case R_HTTP_PARSE_NEED_DATA:
+        R_LOG_TRACE ("%p: "R_EV_IO_FORMAT" waiting for more data (%"RSIZE_FMT")",
+            ctx->server, R_EV_IO_ARGS (evtcp),
+            r_http_request_parser_get_buffered (ctx->parser));
+        return;
+      case R_HTTP_PARSE_REQUEST:
+        ctx->req = req;
+        ctx->keepalive = r_http_request_is_persistent (req);
+        ctx->bodyfunc = r_http_server_lookup_body_handler (ctx->server, req,
+            &ctx->bodydata);
+        R_LOG_TRACE ("%p: "R_EV_IO_FORMAT" request created %p [%s]",
+            ctx->server, R_EV_IO_ARGS (evtcp), req, ctx->keepalive ? "keepalive" : "close");
         break;
-    }
-
-    /* Process body */
-    if (ctx->bodysize == 0) {
-      r_http_client_ctx_process (ctx);
-    } else if (ctx->bodysize > 0) {
-      if (ctx->inbuf != NULL) {
-        rsize cur = r_buffer_get_size (ctx->inbuf);
-
-        if (cur < (rsize)ctx->bodysize) {
-          return;
-        } else if (cur == (rsize)ctx->bodysize) {
-          r_http_request_set_body_buffer (ctx->req, ctx->inbuf);
-          r_buffer_unref (ctx->inbuf);
-          ctx->inbuf = NULL;
-        } else if (cur > (rsize)ctx->bodysize) {
-          RBuffer * body = r_buffer_view (ctx->inbuf, 0, (rsize)ctx->bodysize);
-          RBuffer * rest = r_buffer_view (ctx->inbuf, (rsize)ctx->bodysize, -1);
-          r_http_request_set_body_buffer (ctx->req, body);
-          r_buffer_unref (body);
-          r_buffer_unref (ctx->inbuf);
-          ctx->inbuf = rest;
+      case R_HTTP_PARSE_BODY:
+        if (ctx->bodyfunc != NULL) {
+          ctx->bodyfunc (ctx->bodydata, ctx->req, body, ctx->server);
+        } else if (ctx->body == NULL) {
+          ctx->body = r_buffer_ref (body);
+        } else {
+          r_buffer_append_mem_from_buffer (ctx->body, body);
         }
-
+        r_buffer_unref (body);
+        break;
+      case R_HTTP_PARSE_END:
+        r_http_request_unref (req);
+        if (ctx->bodyfunc != NULL)
+          ctx->bodyfunc (ctx->bodydata, ctx->req, NULL, ctx->server);
         r_http_client_ctx_process (ctx);
-      }
-    } else if (ctx->bodysize < 0) {
-      /* TODO: chunked */
-      return;
+        if (ctx->closing)
+          return;
+        break;
+      case R_HTTP_PARSE_ERROR:
+      default:
+        r_http_client_ctx_bad_request (ctx, err);
+        return;
     }
-  } while (ctx->req == NULL && ctx->inbuf != NULL);
+  }
 }
 
-
 static void
 r_http_server_free (RHttpServer * server)
 {
   r_dir_tree_unref (server->dt);
+  r_dir_tree_unref (server->bodydt);
   r_ev_loop_unref (server->loop);
   r_ptr_array_unref (server->clients);
   r_ptr_array_unref (server->listen);
@@ -284,6 +356,7 @@ r_http_server_new (REvLoop * loop)
 
     ret->loop = loop;
     ret->dt = r_dir_tree_new ();
+    ret->bodydt = r_dir_tree_new ();
 
     ret->clients = r_ptr_array_new_sized (1024);
     ret->listen = r_ptr_array_new ();
@@ -313,6 +386,23 @@ r_http_server_set_handler (RHttpServer * server,
       data, notify, (RFunc)handler) != NULL;
 }
 
+rboolean
+r_http_server_set_body_handler (RHttpServer * server,
+  const rchar * pattern, rssize size, RHttpRequestBodyFunc func,
+  rpointer data, RDestroyNotify notify)
+{
+  if (R_UNLIKELY (func == NULL)) return FALSE;
+
+  if (size < 0) {
+    R_LOG_INFO ("%p: Body handler %p for %s", server, func, pattern);
+  } else {
+    R_LOG_INFO ("%p: Body handler %p for %.*s", server, func, (int)size, pattern);
+  }
+
+  return r_dir_tree_set_full (server->bodydt, pattern, size,
+      data, notify, (RFunc)func) != NULL;
+}
+
 typedef struct {
   RHttpRequestHandler handler;
   RHttpServer * server;
@@ -421,6 +511,7 @@ r_http_server_tcp_connection_ready (rpointer data,
     if (r_ev_tcp_recv_start (newtcp, NULL, r_http_client_ctx_tcp_recv, ctx, NULL)) {
       r_ptr_array_add (server->clients, r_ref_ref (ctx), r_ref_unref);
     }
+    r_ref_unref (ctx);
   } else {
     R_LOG_WARNING ("%p: New connection "R_EV_IO_FORMAT" on "R_EV_IO_FORMAT
         " failed to create context! OOM?",
@@ -432,26 +523,54 @@ rboolean
 r_http_server_listen (RHttpServer * server, RSocketAddress * addr)
 {
   REvTCP * tcp;
+  rboolean ret;
+
+  if ((tcp = r_ev_tcp_new_bind (addr, server->loop)) != NULL) {
+    ret = r_http_server_listen_tcp (server, tcp);
+    r_ev_tcp_unref (tcp);
+  } else {
+    rchar * addrstr = r_socket_address_to_str (addr);
+    R_LOG_ERROR ("%p: Failed to bind %s", server, addrstr);
+    r_free (addrstr);
+    ret = FALSE;
+  }
+
+  return ret;
+}
+
+rboolean
+r_http_server_listen_tcp (RHttpServer * server, REvTCP * tcp)
+{
+  RSocketAddress * addr;
   rchar * addrstr;
+  rsize idx;
+  rboolean ret = FALSE;
 
-  addrstr = r_socket_address_to_str (addr);
+  if (R_UNLIKELY (server == NULL)) return FALSE;
+  if (R_UNLIKELY (tcp == NULL)) return FALSE;
+  if (R_UNLIKELY (((REvIO *)tcp)->loop != server->loop)) return FALSE;
 
-  if ((tcp = r_ev_tcp_new_bind (addr, server->loop)) != NULL) {
-    if (r_ev_tcp_listen (tcp, R_SOCKET_DEFAULT_BACKLOG,
-          r_http_server_tcp_connection_ready, server, NULL) >= R_SOCKET_OK) {
-      if (r_ptr_array_add (server->listen, tcp, r_ev_tcp_unref) != R_PTR_ARRAY_INVALID_IDX) {
-        R_LOG_INFO ("%p: TCP listen %s", server, addrstr);
-        r_free (addrstr);
-        return TRUE;
-      }
-    }
+  if ((addr = r_ev_tcp_get_local_address (tcp)) == NULL) return FALSE;
+  addrstr = r_socket_address_to_str (addr);
 
+  /* Track the listener before it starts accepting, so a failure
+   * never leaves a listening socket the server can't stop */
+  if ((idx = r_ptr_array_add (server->listen, r_ev_tcp_ref (tcp),
+          r_ev_tcp_unref)) == R_PTR_ARRAY_INVALID_IDX) {
     r_ev_tcp_unref (tcp);
+    R_LOG_ERROR ("%p: Failed for %s", server, addrstr);
+  } else if (r_ev_tcp_listen (tcp, R_SOCKET_DEFAULT_BACKLOG,
+        r_http_server_tcp_connection_ready, server, NULL) < R_SOCKET_OK) {
+    r_ptr_array_remove_idx (server->listen, idx);
+    R_LOG_ERROR ("%p: Failed for %s", server, addrstr);
+  } else {
+    R_LOG_INFO ("%p: TCP listen %s", server, addrstr);
+    ret = TRUE;
   }
 
-  R_LOG_ERROR ("%p: Failed for %s", server, addrstr);
   r_free (addrstr);
-  return FALSE;
+  r_socket_address_unref (addr);
+  return ret;
 }
 
 typedef struct {
@@ -20,6 +20,7 @@
 #include "../rlib-private.h"
 #include <rlib/net/rsrtp.h>
 
+#include <rlib/crypto/raes.h>
 #include <rlib/crypto/rcipher.h>
 #include <rlib/crypto/rhmac.h>
 
@@ -30,9 +31,13 @@
 #include <rlib/rmem.h>
 
 #define R_SRTP_MAX_SALT_SIZE      16
+#define R_SRTP_KDPRF_SALT_SIZE    14
 #define R_SRTP_WINDOW_SIZE        1024
 #define R_SRTCP_E_BIT             0x80000000
 
+/* RFC 7714 AEAD profiles, the tag is produced by the cipher itself */
+#define R_SRTP_STATE_IS_AEAD(s)   ((s)->cipher->info->mode == R_CRYPTO_CIPHER_MODE_GCM)
+
 #define R_SRTP_ERRRET(errval, lbl)            \
   R_STMT_START {                              \
     err = errval;                             \
@@ -60,6 +65,7 @@ typedef struct {
   const RSRTPCipherSuiteInfo * csinfo;
   ruint32 ssrc;
   ruint32 filter;
+  rboolean session; /* key is session key || session salt, no derivation */
   ruint8 key[0];
 } RSRTPCryptoCtx;
 
@@ -130,6 +136,8 @@ r_srtp_kdprf_generate (ruint8 * buf, rsize bufsize,
       iv, cipher->info->ivsize);
 }
 
+/* salt is the master salt padded to saltsize, the session salt generated is
+ * as long as the master salt of the cipher suite. */
 static RCryptoCipherResult
 r_srtp_state_init (RSRTPState * state, ruint lbloffset,
     const RCryptoCipher * kdprf, ruint kdr, const RSRTPCipherSuiteInfo * csinfo,
@@ -148,8 +156,8 @@ r_srtp_state_init (RSRTPState * state, ruint lbloffset,
   }
 
   /* Session salt */
-  if (R_LIKELY ((state->saltsize = saltsize) > 0)) {
-    if ((ret = r_srtp_kdprf_generate (state->salt, saltsize, kdprf,
+  if (R_LIKELY ((state->saltsize = csinfo->saltbits / 8) > 0)) {
+    if ((ret = r_srtp_kdprf_generate (state->salt, state->saltsize, kdprf,
             lbloffset + R_SRTP_KDPRF_LABEL_RTP_SALT, state->index, kdr,
             salt, saltsize)) != R_CRYPTO_CIPHER_OK)
       return ret;
@@ -162,6 +170,8 @@ r_srtp_state_init (RSRTPState * state, ruint lbloffset,
     rsize authsize = r_msg_digest_type_size (csinfo->auth);
     if ((state->cipher = r_crypto_cipher_new (csinfo->cipher, scratch)) == NULL) {
       ret = R_CRYPTO_CIPHER_OOM;
+    } else if (csinfo->auth == R_MSG_DIGEST_TYPE_NONE) {
+      /* AEAD or NULL auth, no session auth key */
     } else if ((ret = r_srtp_kdprf_generate (scratch, authsize, kdprf,
             lbloffset + R_SRTP_KDPRF_LABEL_RTP_MSG_AUTH, state->index, kdr,
             salt, saltsize)) == R_CRYPTO_CIPHER_OK) {
@@ -178,6 +188,19 @@ r_srtp_state_init (RSRTPState * state, ruint lbloffset,
   return ret;
 }
 
+/* AEAD profiles only, which have no session auth key */
+static RCryptoCipherResult
+r_srtp_state_init_session (RSRTPState * state,
+    const RSRTPCipherSuiteInfo * csinfo, const ruint8 * key)
+{
+  state->saltsize = csinfo->saltbits / 8;
+  r_memcpy (state->salt, key + csinfo->cipher->keybits / 8, state->saltsize);
+  if ((state->cipher = r_crypto_cipher_new (csinfo->cipher, key)) == NULL)
+    return R_CRYPTO_CIPHER_OOM;
+
+  return R_CRYPTO_CIPHER_OK;
+}
+
 static void
 r_srtp_state_clear (RSRTPState * state)
 {
@@ -195,12 +218,39 @@ r_srtp_stream_free (RSRTPStream * stream)
   r_free (stream);
 }
 
+static RSRTPStream *
+r_srtp_stream_new_with_session_key (ruint32 ssrc, const RSRTPCryptoCtx * cctx)
+{
+  RSRTPStream * ret;
+
+  if ((ret = r_mem_new0 (RSRTPStream)) != NULL) {
+    ret->ssrc = ssrc;
+    ret->cctx = cctx;
+    r_bitset_init_heap (ret->rtp.window, R_SRTP_WINDOW_SIZE);
+    r_bitset_init_heap (ret->rtcp.window, R_SRTP_WINDOW_SIZE);
+
+    if (R_UNLIKELY (r_srtp_state_init_session (&ret->rtp, cctx->csinfo, cctx->key) != R_CRYPTO_CIPHER_OK ||
+          r_srtp_state_init_session (&ret->rtcp, cctx->csinfo, cctx->key) != R_CRYPTO_CIPHER_OK)) {
+      R_LOG_WARNING ("stream: 0x%.8x - crypto init failed", ssrc);
+      r_srtp_stream_free (ret);
+      ret = NULL;
+    } else {
+      R_LOG_DEBUG ("stream: 0x%.8x - %p", ssrc, ret);
+    }
+  }
+
+  return ret;
+}
+
 static RSRTPStream *
 r_srtp_stream_new (ruint32 ssrc, const RSRTPCryptoCtx * cctx)
 {
   RSRTPStream * ret;
   RCryptoCipher * kdcipher;
 
+  if (cctx->session)
+    return r_srtp_stream_new_with_session_key (ssrc, cctx);
+
   if (R_UNLIKELY ((kdcipher = r_crypto_cipher_new (cctx->csinfo->kdprf,
             cctx->key)) == NULL)) {
     R_LOG_WARNING ("Unable to create key derivation PRF cipher");
@@ -210,7 +260,13 @@ r_srtp_stream_new (ruint32 ssrc, const RSRTPCryptoCtx * cctx)
   if ((ret = r_mem_new0 (RSRTPStream)) != NULL) {
     RCryptoCipherResult res;
     rsize keysize = cctx->csinfo->cipher->keybits / 8;
-    rsize saltsize = cctx->csinfo->saltbits / 8;
+    ruint8 salt[R_SRTP_KDPRF_SALT_SIZE];
+
+    /* The AES-CM PRF takes a 112 bit master salt, shorter salts (96 bit for
+     * the RFC 7714 AEAD profiles) are padded with zeros like libsrtp does */
+    r_memclear (salt, sizeof (salt));
+    r_memcpy (salt, cctx->key + keysize,
+        MIN (cctx->csinfo->saltbits / 8, sizeof (salt)));
 
     ret->ssrc = ssrc;
     ret->cctx = cctx;
@@ -219,13 +275,13 @@ r_srtp_stream_new (ruint32 ssrc, const RSRTPCryptoCtx * cctx)
 
     if (R_UNLIKELY ((res = r_srtp_state_init (&ret->rtp,
               R_SRTP_KDPRF_LABEL_RTP_ENCRYPTION, kdcipher, 0, cctx->csinfo,
-              cctx->key + keysize, saltsize)) != R_CRYPTO_CIPHER_OK)) {
+              salt, sizeof (salt))) != R_CRYPTO_CIPHER_OK)) {
       R_LOG_WARNING ("stream: 0x%.8x - RTP crypto init failed %d", ssrc, res);
       r_srtp_stream_free (ret);
       ret = NULL;
     } else if (R_UNLIKELY ((res = r_srtp_state_init (&ret->rtcp,
               R_SRTP_KDPRF_LABEL_RTCP_ENCRYPTION, kdcipher, 0, cctx->csinfo,
-              cctx->key + keysize, saltsize)) != R_CRYPTO_CIPHER_OK)) {
+              salt, sizeof (salt))) != R_CRYPTO_CIPHER_OK)) {
       R_LOG_WARNING ("stream: 0x%.8x - RTCP crypto init failed %d", ssrc, res);
       r_srtp_stream_free (ret);
       ret = NULL;
@@ -265,9 +321,9 @@ r_srtp_ctx_new (void)
   return ret;
 }
 
-RSRTPError
-r_srtp_add_crypto_context_for_ssrc (RSRTPCtx * ctx,
-    ruint32 ssrc, RSRTPCipherSuite cs, const ruint8 * key)
+static RSRTPError
+r_srtp_add_crypto_context_for_ssrc_full (RSRTPCtx * ctx,
+    ruint32 ssrc, RSRTPCipherSuite cs, const ruint8 * key, rboolean session)
 {
   const RSRTPCipherSuiteInfo * info;
   RSRTPCryptoCtx * cctx;
@@ -277,6 +333,9 @@ r_srtp_add_crypto_context_for_ssrc (RSRTPCtx * ctx,
   if (R_UNLIKELY (key == NULL)) return R_SRTP_ERROR_INVAL;
   if (R_UNLIKELY ((info = r_srtp_cipher_suite_get_info (cs)) == NULL))
     return R_SRTP_ERROR_INVAL;
+  if (R_UNLIKELY (session && (info->auth != R_MSG_DIGEST_TYPE_NONE ||
+            info->cipher->mode != R_CRYPTO_CIPHER_MODE_GCM)))
+    return R_SRTP_ERROR_INVAL;
   if (R_UNLIKELY (r_hash_table_contains (ctx->crypto_ssrc,
           RUINT_TO_POINTER (ssrc)) == R_HASH_TABLE_OK))
     return R_SRTP_ERROR_CRYPTO_CTX_EXISTS;
@@ -286,6 +345,7 @@ r_srtp_add_crypto_context_for_ssrc (RSRTPCtx * ctx,
     cctx->csinfo = info;
     cctx->ssrc = ssrc;
     cctx->filter = 0;
+    cctx->session = session;
     r_memcpy (cctx->key, key, keysize);
 
     r_hash_table_insert (ctx->crypto_ssrc, RUINT_TO_POINTER (ssrc), cctx);
@@ -296,6 +356,20 @@ r_srtp_add_crypto_context_for_ssrc (RSRTPCtx * ctx,
   return R_SRTP_ERROR_OOM;
 }
 
+RSRTPError
+r_srtp_add_crypto_context_for_ssrc (RSRTPCtx * ctx,
+    ruint32 ssrc, RSRTPCipherSuite cs, const ruint8 * key)
+{
+  return r_srtp_add_crypto_context_for_ssrc_full (ctx, ssrc, cs, key, FALSE);
+}
+
+RSRTPError
+r_srtp_add_session_key_for_ssrc (RSRTPCtx * ctx,
+    ruint32 ssrc, RSRTPCipherSuite cs, const ruint8 * key)
+{
+  return r_srtp_add_crypto_context_for_ssrc_full (ctx, ssrc, cs, key, TRUE);
+}
+
 RSRTPError
 r_srtp_add_crypto_context_with_filter (RSRTPCtx * ctx,
     ruint32 filter, RSRTPCipherSuite cs, const ruint8 * key)
@@ -315,6 +389,7 @@ r_srtp_add_crypto_context_with_filter (RSRTPCtx * ctx,
     cctx->csinfo = info;
     cctx->ssrc = 0;
     cctx->filter = filter;
+    cctx->session = FALSE;
     r_memcpy (cctx->key, key, keysize);
 
     ctx->crypto_filter = r_list_prepend (ctx->crypto_filter, cctx);
@@ -416,6 +491,285 @@ r_srtp_state_create_iv (ruint8 * iv, rsize ivsize, const RSRTPState * state,
   iv[ivsize - (sizeof (ruint16) +  1)] ^= ((idx      ) & 0xff);
 }
 
+/* RFC 7714 section 8.1 and 9.1 IV: 00 00 || SSRC || 48 bit index XOR salt.
+ * For SRTCP the index is the 31 bit SRTCP index */
+static inline void
+r_srtp_state_create_aead_iv (ruint8 * iv, const RSRTPState * state,
+    ruint32 ssrc, ruint64 idx)
+{
+  r_memcpy (iv, state->salt, R_AES_GCM_IV_BYTES);
+  iv[ 2] ^= ((ssrc >> 24) & 0xff);
+  iv[ 3] ^= ((ssrc >> 16) & 0xff);
+  iv[ 4] ^= ((ssrc >>  8) & 0xff);
+  iv[ 5] ^= ((ssrc      ) & 0xff);
+  iv[ 6] ^= ((idx >> 40) & 0xff);
+  iv[ 7] ^= ((idx >> 32) & 0xff);
+  iv[ 8] ^= ((idx >> 24) & 0xff);
+  iv[ 9] ^= ((idx >> 16) & 0xff);
+  iv[10] ^= ((idx >>  8) & 0xff);
+  iv[11] ^= ((idx      ) & 0xff);
+}
+
+/* A stream without a direction yet is fine for both, see
+ * r_srtp_get_stream_for_direction for the one claiming it */
+static rboolean
+r_srtp_stream_check_direction (const RSRTPStream * stream,
+    RSRTPDirection dir, RSRTPError * err)
+{
+  if (R_UNLIKELY (stream->dir != dir && stream->dir != R_SRTP_DIRECTION_UNKNOWN)) {
+    R_LOG_INFO ("ssrc (0x%.8x) collision?", stream->ssrc);
+    *err = R_SRTP_ERROR_WRONG_DIRECTION;
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+static RSRTPStream *
+r_srtp_get_stream_for_direction (RSRTPCtx * ctx, ruint32 ssrc,
+    RSRTPDirection dir, RSRTPError * err)
+{
+  RSRTPStream * ret;
+
+  if ((ret = r_srtp_get_stream (ctx, ssrc)) != NULL) {
+    if (R_UNLIKELY (!r_srtp_stream_check_direction (ret, dir, err)))
+      return NULL;
+    ret->dir = dir;
+  } else {
+    *err = R_SRTP_ERROR_NO_CRYPTO_CTX;
+  }
+
+  return ret;
+}
+
+/* Stream lookup for batches, only looked up again when the SSRC changes.
+ * The direction is checked but left for the caller to claim, once the
+ * packet is known to be processed. */
+static RSRTPStream *
+r_srtp_get_stream_cached (RSRTPCtx * ctx, ruint32 ssrc,
+    RSRTPDirection dir, RSRTPStream ** cache, RSRTPError * err)
+{
+  RSRTPStream * ret;
+
+  if (cache != NULL && *cache != NULL && (*cache)->ssrc == ssrc)
+    return *cache;
+
+  if ((ret = r_srtp_get_stream (ctx, ssrc)) == NULL)
+    *err = R_SRTP_ERROR_NO_CRYPTO_CTX;
+  else if (R_UNLIKELY (!r_srtp_stream_check_direction (ret, dir, err)))
+    ret = NULL;
+
+  if (cache != NULL)
+    *cache = ret;
+  return ret;
+}
+
+static inline rsize
+r_srtp_buffer_get_tailroom (const RBuffer * buf)
+{
+  return r_buffer_get_allocsize (buf) - r_buffer_get_offset (buf);
+}
+
+/* The AAD of the AEAD profiles is the RTP header including extension, which
+ * only needs copying when not contiguous in memory. */
+static const ruint8 *
+r_srtp_rtp_get_aad (const RRTPBuffer * rtp, ruint8 * scratch, rsize * size)
+{
+  *size = rtp->hdr.size + rtp->ext.size;
+  if (rtp->ext.data == NULL || rtp->ext.data == rtp->hdr.data + rtp->hdr.size)
+    return rtp->hdr.data;
+
+  r_memcpy (scratch, rtp->hdr.data, rtp->hdr.size);
+  r_memcpy (scratch + rtp->hdr.size, rtp->ext.data, rtp->ext.size);
+  return scratch;
+}
+
+/* RFC 7714: ciphertext || tag || MKI */
+static RSRTPError
+r_srtp_stream_encrypt_rtp_aead (RSRTPStream * stream, const RRTPBuffer * rtp,
+    ruint64 idx, ruint8 * dst)
+{
+  rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+  ruint8 iv[R_AES_GCM_IV_BYTES];
+  const ruint8 * aad;
+  rsize aadsize;
+
+  aad = r_srtp_rtp_get_aad (rtp,
+      r_alloca (rtp->hdr.size + rtp->ext.size), &aadsize);
+  r_srtp_state_create_aead_iv (iv, &stream->rtp, stream->ssrc, idx);
+
+  R_LOG_TRACE ("Encrypting %u bytes", (ruint)rtp->pay.size);
+  if (R_UNLIKELY (r_cipher_aes_gcm_encrypt_full (stream->rtp.cipher,
+          dst, rtp->pay.size, rtp->pay.data, iv, sizeof (iv), aad, aadsize,
+          dst + rtp->pay.size, tagsize) != R_CRYPTO_CIPHER_OK)) {
+    R_LOG_ERROR ("AEAD encryption for SRTP failed");
+    return R_SRTP_ERROR_INTERNAL;
+  }
+
+  if (stream->rtpmkisize > 0) {
+    /* FIXME: insert mki */
+  }
+
+  return R_SRTP_ERROR_OK;
+}
+
+/* Writes the encrypted payload of rtp to dst, no MKI or auth tag */
+static void
+r_srtp_stream_encrypt_rtp_payload (RSRTPStream * stream, const RRTPBuffer * rtp,
+    ruint64 idx, ruint8 * dst)
+{
+  rsize ivsize = stream->rtp.cipher->info->ivsize;
+  ruint8 * iv;
+
+  iv = r_alloca0 (ivsize);
+  r_srtp_state_create_iv (iv, ivsize, &stream->rtp, stream->ssrc, idx);
+
+  R_LOG_TRACE ("Encrypting %u bytes", (ruint)rtp->pay.size);
+  r_crypto_cipher_encrypt (stream->rtp.cipher, dst, rtp->pay.size,
+      rtp->pay.data, iv, ivsize);
+
+  if (stream->rtpmkisize > 0) {
+    /* FIXME: insert mki */
+  }
+}
+
+/* Writes encrypted payload, MKI and auth tag of rtp to dst. dst may be the
+ * mapped payload of rtp itself. */
+static RSRTPError
+r_srtp_stream_encrypt_rtp (RSRTPStream * stream, const RRTPBuffer * rtp,
+    ruint64 idx, ruint8 * dst)
+{
+  rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+
+  if (R_SRTP_STATE_IS_AEAD (&stream->rtp))
+    return r_srtp_stream_encrypt_rtp_aead (stream, rtp, idx, dst);
+
+  r_srtp_stream_encrypt_rtp_payload (stream, rtp, idx, dst);
+
+  /* add auth tag */
+  if (stream->rtp.mac != NULL && tagsize > 0) {
+    ruint32 roc = RUINT32_TO_BE ((ruint32)(idx >> 16));
+
+    r_hmac_reset (stream->rtp.mac);
+    if (r_hmac_update (stream->rtp.mac, rtp->hdr.data, rtp->hdr.size) &&
+        (rtp->ext.data == NULL ||
+         r_hmac_update (stream->rtp.mac, rtp->ext.data, rtp->ext.size)) &&
+        r_hmac_update (stream->rtp.mac, dst, rtp->pay.size) &&
+        r_hmac_update (stream->rtp.mac, &roc, sizeof (ruint32))) {
+      ruint8 calctag[32];
+      rsize calcsize;
+
+      r_hmac_get_data (stream->rtp.mac, calctag, sizeof (calctag), &calcsize);
+      r_memcpy (dst + rtp->pay.size + stream->rtpmkisize, calctag, tagsize);
+    } else {
+      R_LOG_ERROR ("HMAC update for SRTP auth failed");
+      return R_SRTP_ERROR_INTERNAL;
+    }
+  }
+
+  return R_SRTP_ERROR_OK;
+}
+
+/* The tag is verified before anything is written to dst */
+static RSRTPError
+r_srtp_stream_decrypt_rtp_aead (RSRTPStream * stream, const RRTPBuffer * rtp,
+    ruint64 idx, ruint8 * dst)
+{
+  rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+  rsize payloadsize = rtp->pay.size - tagsize - stream->rtpmkisize;
+  ruint8 iv[R_AES_GCM_IV_BYTES];
+  const ruint8 * aad;
+  rsize aadsize;
+
+  aad = r_srtp_rtp_get_aad (rtp,
+      r_alloca (rtp->hdr.size + rtp->ext.size), &aadsize);
+  r_srtp_state_create_aead_iv (iv, &stream->rtp, stream->ssrc, idx);
+
+  R_LOG_TRACE ("Decrypting %u bytes", (ruint)payloadsize);
+  switch (r_cipher_aes_gcm_decrypt_full (stream->rtp.cipher,
+        dst, payloadsize, rtp->pay.data, iv, sizeof (iv), aad, aadsize,
+        rtp->pay.data + payloadsize, tagsize)) {
+    case R_CRYPTO_CIPHER_OK:
+      return R_SRTP_ERROR_OK;
+    case R_CRYPTO_CIPHER_AUTH_FAILED:
+      R_LOG_INFO ("stream: 0x%.8x - SRTP auth failed for idx 0x%"R_RTP_SEQIDX_FMT,
+          stream->ssrc, idx);
+      return R_SRTP_ERROR_AUTH;
+    default:
+      R_LOG_ERROR ("AEAD decryption for SRTP failed");
+      return R_SRTP_ERROR_INTERNAL;
+  }
+}
+
+/* Writes the first payloadsize bytes of the payload of rtp, decrypted, to
+ * dst. The auth tag is verified by the caller. */
+static void
+r_srtp_stream_decrypt_rtp_payload (RSRTPStream * stream, const RRTPBuffer * rtp,
+    ruint64 idx, ruint8 * dst, rsize payloadsize)
+{
+  rsize ivsize = stream->rtp.cipher->info->ivsize;
+  ruint8 * iv;
+
+  iv = r_alloca0 (ivsize);
+  r_srtp_state_create_iv (iv, ivsize, &stream->rtp, stream->ssrc, idx);
+
+  R_LOG_TRACE ("Decrypting %u bytes", (ruint)payloadsize);
+  r_crypto_cipher_decrypt (stream->rtp.cipher, dst, payloadsize,
+      rtp->pay.data, iv, ivsize);
+}
+
+/* Verifies the auth tag of rtp and writes the decrypted payload
+ * (excluding MKI and tag) to dst, which may be the payload of rtp itself. */
+static RSRTPError
+r_srtp_stream_decrypt_rtp (RSRTPStream * stream, const RRTPBuffer * rtp,
+    ruint64 idx, ruint8 * dst)
+{
+  rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+  rsize payloadsize = rtp->pay.size - tagsize - stream->rtpmkisize;
+
+  if (R_SRTP_STATE_IS_AEAD (&stream->rtp))
+    return r_srtp_stream_decrypt_rtp_aead (stream, rtp, idx, dst);
+
+  if (stream->rtp.mac != NULL && tagsize > 0) {
+    ruint8 * authtag = rtp->pay.data + rtp->pay.size - tagsize;
+    ruint8 calctag[32];
+    rsize calcsize;
+    ruint32 roc = RUINT32_TO_BE ((ruint32)(idx >> 16));
+
+    r_hmac_reset (stream->rtp.mac);
+    if (r_hmac_update (stream->rtp.mac, rtp->hdr.data, rtp->hdr.size) &&
+        (rtp->ext.data == NULL ||
+         r_hmac_update (stream->rtp.mac, rtp->ext.data, rtp->ext.size)) &&
+        r_hmac_update (stream->rtp.mac, rtp->pay.data, payloadsize) &&
+        r_hmac_update (stream->rtp.mac, &roc, sizeof (ruint32)) &&
+        r_hmac_get_data (stream->rtp.mac, calctag, sizeof (calctag), &calcsize)) {
+      if (R_UNLIKELY (r_memcmp (authtag, calctag, tagsize) != 0)) {
+        R_LOG_INFO ("stream: 0x%.8x - SRTP auth failed for idx 0x%"R_RTP_SEQIDX_FMT,
+            stream->ssrc, idx);
+        return R_SRTP_ERROR_AUTH;
+      }
+    } else {
+      R_LOG_ERROR ("HMAC update for SRTP auth failed");
+      return R_SRTP_ERROR_INTERNAL;
+    }
+  }
+
+  r_srtp_stream_decrypt_rtp_payload (stream, rtp, idx, dst, payloadsize);
+  return R_SRTP_ERROR_OK;
+}
+
+static inline RSRTPError
+r_srtp_stream_check_auth_prefix (const RSRTPStream * stream)
+{
+  if (stream->cctx->csinfo->authprefixlen > 0) {
+    /* FIXME: Handle keystream prefix */
+    R_LOG_ERROR ("SRTP Auth prefix not implmented yet...");
+    return R_SRTP_ERROR_INTERNAL;
+  }
+
+  return R_SRTP_ERROR_OK;
+}
+
 RBuffer *
 r_srtp_encrypt_rtp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
 {
@@ -429,77 +783,28 @@ r_srtp_encrypt_rtp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
   if (r_rtp_buffer_map (&rtp, packet, R_MEM_MAP_READ)) {
     RSRTPStream * stream;
 
-    if ((stream = r_srtp_get_stream (ctx, r_rtp_buffer_get_ssrc (&rtp))) != NULL) {
-      ruint64 idx;
-
-      if (R_UNLIKELY (stream->dir != R_SRTP_DIRECTION_OUTBOUND)) {
-        if (stream->dir == R_SRTP_DIRECTION_UNKNOWN) {
-          stream->dir = R_SRTP_DIRECTION_OUTBOUND;
-        } else {
-          R_LOG_INFO ("ssrc (0x%.8x) collision?", stream->ssrc);
-          err = R_SRTP_ERROR_WRONG_DIRECTION;
-          goto beach_map;
-        }
-      }
+    if ((stream = r_srtp_get_stream_for_direction (ctx,
+            r_rtp_buffer_get_ssrc (&rtp), R_SRTP_DIRECTION_OUTBOUND, &err)) != NULL) {
+      ruint64 idx = r_rtp_buffer_estimate_seq_idx (&rtp, stream->rtp.index);
 
-      idx = r_rtp_buffer_estimate_seq_idx (&rtp, stream->rtp.index);
-      if ((err = r_srtp_stream_replay_check (&stream->rtp, idx, stream->ssrc)) == R_SRTP_ERROR_OK) {
+      if ((err = r_srtp_stream_replay_check (&stream->rtp, idx, stream->ssrc)) == R_SRTP_ERROR_OK &&
+          (err = r_srtp_stream_check_auth_prefix (stream)) == R_SRTP_ERROR_OK) {
         rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
         rsize payloadsize = rtp.pay.size + tagsize + stream->rtpmkisize;
         RBuffer * payload;
 
         r_srtp_stream_rtp_replay_add (&stream->rtp, idx);
 
-        if (stream->cctx->csinfo->authprefixlen > 0) {
-          /* FIXME: Handle keystream prefix */
-          R_LOG_ERROR ("SRTP Auth prefix not implmented yet...");
-          err = R_SRTP_ERROR_INTERNAL;
-          goto beach_map;
-        }
-
         if ((payload = r_buffer_new_alloc (NULL, payloadsize, NULL)) != NULL) {
           RMemMapInfo info = R_MEM_MAP_INFO_INIT;
 
           if (r_buffer_map (payload, &info, R_MEM_MAP_WRITE)) {
-            rsize ivsize = stream->rtp.cipher->info->ivsize;
-            ruint8 * iv = r_alloca0 (ivsize);
-
-            r_srtp_state_create_iv (iv, ivsize, &stream->rtp, stream->ssrc, idx);
-
-            R_LOG_TRACE ("Encrypting %u bytes", (ruint)rtp.pay.size);
-            r_crypto_cipher_encrypt (stream->rtp.cipher, info.data, rtp.pay.size,
-                rtp.pay.data, iv, ivsize);
-
-            if (stream->rtpmkisize > 0) {
-              /* FIXME: insert mki */
-            }
-
-            /* add auth tag */
-            if (stream->rtp.mac != NULL && tagsize > 0) {
-              ruint32 roc = RUINT32_TO_BE ((ruint32)(idx >> 16));
-
-              r_hmac_reset (stream->rtp.mac);
-              if (r_hmac_update (stream->rtp.mac, rtp.hdr.data, rtp.hdr.size) &&
-                  (rtp.ext.data == NULL ||
-                   r_hmac_update (stream->rtp.mac, rtp.ext.data, rtp.ext.size)) &&
-                  r_hmac_update (stream->rtp.mac, info.data, rtp.pay.size) &&
-                  r_hmac_update (stream->rtp.mac, &roc, sizeof (ruint32))) {
-                ruint8 calctag[32];
-                rsize calcsize;
-
-                r_hmac_get_data (stream->rtp.mac, calctag, sizeof (calctag), &calcsize);
-                r_memcpy (info.data + payloadsize - tagsize, calctag, tagsize);
-              } else {
-                R_LOG_ERROR ("HMAC update for SRTP auth failed");
-                err = R_SRTP_ERROR_INTERNAL;
-                goto beach_map;
-              }
-            }
-
+            err = r_srtp_stream_encrypt_rtp (stream, &rtp, idx, info.data);
             r_buffer_unmap (payload, &info);
 
-            if (R_UNLIKELY ((ret = r_buffer_replace_byte_range (packet,
-                rtp.hdr.size + rtp.ext.size, -1, payload)) == NULL)) {
+            if (err == R_SRTP_ERROR_OK &&
+                R_UNLIKELY ((ret = r_buffer_replace_byte_range (packet,
+                    rtp.hdr.size + rtp.ext.size, -1, payload)) == NULL)) {
               err = R_SRTP_ERROR_INTERNAL;
             }
           } else {
@@ -510,11 +815,8 @@ r_srtp_encrypt_rtp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
           err = R_SRTP_ERROR_OOM;
         }
       }
-    } else {
-      err = R_SRTP_ERROR_NO_CRYPTO_CTX;
     }
 
-beach_map:
     r_rtp_buffer_unmap (&rtp, packet);
   } else {
     err = R_SRTP_ERROR_BAD_RTP_HDR;
@@ -539,74 +841,28 @@ r_srtp_decrypt_rtp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
   if (r_rtp_buffer_map (&rtp, packet, R_MEM_MAP_READ)) {
     RSRTPStream * stream;
 
-    if ((stream = r_srtp_get_stream (ctx, r_rtp_buffer_get_ssrc (&rtp))) != NULL) {
-      ruint64 idx;
+    if ((stream = r_srtp_get_stream_for_direction (ctx,
+            r_rtp_buffer_get_ssrc (&rtp), R_SRTP_DIRECTION_INBOUND, &err)) != NULL) {
+      ruint64 idx = r_rtp_buffer_estimate_seq_idx (&rtp, stream->rtp.index);
 
-      if (R_UNLIKELY (stream->dir != R_SRTP_DIRECTION_INBOUND)) {
-        if (stream->dir == R_SRTP_DIRECTION_UNKNOWN) {
-          stream->dir = R_SRTP_DIRECTION_INBOUND;
-        } else {
-          R_LOG_INFO ("ssrc (0x%.8x) collision?", stream->ssrc);
-          err = R_SRTP_ERROR_WRONG_DIRECTION;
-          goto beach_map;
-        }
-      }
-
-      idx = r_rtp_buffer_estimate_seq_idx (&rtp, stream->rtp.index);
-      if ((err = r_srtp_stream_replay_check (&stream->rtp, idx, stream->ssrc)) == R_SRTP_ERROR_OK) {
+      if ((err = r_srtp_stream_replay_check (&stream->rtp, idx, stream->ssrc)) == R_SRTP_ERROR_OK &&
+          (err = r_srtp_stream_check_auth_prefix (stream)) == R_SRTP_ERROR_OK) {
         rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
         rsize payloadsize = rtp.pay.size - tagsize - stream->rtpmkisize;
         RBuffer * payload;
 
-        if (stream->cctx->csinfo->authprefixlen > 0) {
-          /* FIXME: Handle keystream prefix */
-          R_LOG_ERROR ("SRTP Auth prefix not implmented yet...");
-          err = R_SRTP_ERROR_INTERNAL;
-          goto beach_map;
-        }
-
-        if (stream->rtp.mac != NULL && tagsize > 0) {
-          ruint8 * authtag = rtp.pay.data + rtp.pay.size - tagsize;
-          ruint8 calctag[32];
-          rsize calcsize;
-          ruint32 roc = RUINT32_TO_BE ((ruint32)(idx >> 16));
-
-          r_hmac_reset (stream->rtp.mac);
-          if (r_hmac_update (stream->rtp.mac, rtp.hdr.data, rtp.hdr.size) &&
-              (rtp.ext.data == NULL ||
-               r_hmac_update (stream->rtp.mac, rtp.ext.data, rtp.ext.size)) &&
-              r_hmac_update (stream->rtp.mac, rtp.pay.data, payloadsize) &&
-              r_hmac_update (stream->rtp.mac, &roc, sizeof (ruint32)) &&
-              r_hmac_get_data (stream->rtp.mac, calctag, sizeof (calctag), &calcsize)) {
-            if (R_UNLIKELY (r_memcmp (authtag, calctag, tagsize) != 0)) {
-              R_LOG_INFO ("stream: 0x%.8x - SRTP auth failed for idx 0x%"R_RTP_SEQIDX_FMT,
-                  stream->ssrc, idx);
-              err = R_SRTP_ERROR_AUTH;
-              goto beach_map;
-            }
-          } else {
-            R_LOG_ERROR ("HMAC update for SRTP auth failed");
-            err = R_SRTP_ERROR_INTERNAL;
-            goto beach_map;
-          }
-        }
-
-        if ((payload = r_buffer_new_alloc (NULL, payloadsize, NULL)) != NULL) {
+        if (R_UNLIKELY (rtp.pay.size < tagsize + stream->rtpmkisize)) {
+          err = R_SRTP_ERROR_BAD_RTP_HDR;
+        } else if ((payload = r_buffer_new_alloc (NULL, payloadsize, NULL)) != NULL) {
           RMemMapInfo info = R_MEM_MAP_INFO_INIT;
 
           if (r_buffer_map (payload, &info, R_MEM_MAP_WRITE)) {
-            rsize ivsize = stream->rtp.cipher->info->ivsize;
-            ruint8 * iv = r_alloca0 (ivsize);
-
-            r_srtp_state_create_iv (iv, ivsize, &stream->rtp, stream->ssrc, idx);
-
-            R_LOG_TRACE ("Decrypting %u bytes", (ruint)info.size);
-            r_crypto_cipher_decrypt (stream->rtp.cipher, info.data, info.size,
-                rtp.pay.data, iv, ivsize);
+            err = r_srtp_stream_decrypt_rtp (stream, &rtp, idx, info.data);
             r_buffer_unmap (payload, &info);
 
-            if (R_UNLIKELY ((ret = r_buffer_replace_byte_range (packet,
-                rtp.hdr.size + rtp.ext.size, -1, payload)) == NULL)) {
+            if (err == R_SRTP_ERROR_OK &&
+                R_UNLIKELY ((ret = r_buffer_replace_byte_range (packet,
+                    rtp.hdr.size + rtp.ext.size, -1, payload)) == NULL)) {
               err = R_SRTP_ERROR_INTERNAL;
             }
           } else {
@@ -617,13 +873,11 @@ r_srtp_decrypt_rtp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
           err = R_SRTP_ERROR_OOM;
         }
 
-        r_srtp_stream_rtp_replay_add (&stream->rtp, idx);
+        if (err == R_SRTP_ERROR_OK)
+          r_srtp_stream_rtp_replay_add (&stream->rtp, idx);
       }
-    } else {
-      err = R_SRTP_ERROR_NO_CRYPTO_CTX;
     }
 
-beach_map:
     r_rtp_buffer_unmap (&rtp, packet);
   } else {
     err = R_SRTP_ERROR_BAD_RTP_HDR;
@@ -635,6 +889,407 @@ beach:
   return ret;
 }
 
+static rboolean
+r_srtp_buffer_is_inplace_capable (const RBuffer * packet)
+{
+  return r_buffer_mem_count (packet) == 1 && r_buffer_is_all_writable (packet);
+}
+
+/* Batches authenticate with r_hmac_compute_multi, one call per run of
+ * packets from the same stream. A deferred packet stays mapped with the
+ * ROC written in place right after its authenticated bytes, which is
+ * where the MKI and tag go, until its tag is done. */
+#define R_SRTP_AUTH_BATCH       16
+#define R_SRTP_AUTH_MAX_MAC     32
+
+typedef struct {
+  ruint i;
+  RBuffer * packet;
+  RRTPBuffer rtp;
+  RSRTPStream * stream;
+  ruint64 idx;
+  rsize paysize;
+  rsize newsize;
+  ruint8 saved[sizeof (ruint32)];
+  ruint8 tag[R_SRTP_AUTH_MAX_MAC];
+} RSRTPAuthEntry;
+
+typedef struct {
+  RSRTPAuthEntry entry[R_SRTP_AUTH_BATCH];
+  RMemChunk msgs[R_SRTP_AUTH_BATCH];
+  ruint8 macs[R_SRTP_AUTH_BATCH * R_SRTP_AUTH_MAX_MAC];
+  ruint count;
+} RSRTPAuthBatch;
+
+static rboolean
+r_srtp_auth_batch_can_defer (const RSRTPStream * stream, const RRTPBuffer * rtp)
+{
+  rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+  const ruint8 * end = rtp->hdr.data + rtp->hdr.size;
+
+  if (R_SRTP_STATE_IS_AEAD (&stream->rtp) || stream->rtp.mac == NULL || tagsize == 0)
+    return FALSE;
+  if (tagsize + stream->rtpmkisize < sizeof (ruint32) ||
+      r_hmac_size (stream->rtp.mac) > R_SRTP_AUTH_MAX_MAC)
+    return FALSE;
+
+  if (rtp->ext.data != NULL) {
+    if (rtp->ext.data != end)
+      return FALSE;
+    end += rtp->ext.size;
+  }
+
+  return rtp->pay.data == end;
+}
+
+/* tag is the received tag when decrypting, NULL when encrypting */
+static void
+r_srtp_auth_batch_push (RSRTPAuthBatch * batch, ruint i, RBuffer * packet,
+    const RRTPBuffer * rtp, RSRTPStream * stream, ruint64 idx,
+    rsize paysize, rsize newsize, const ruint8 * tag)
+{
+  RSRTPAuthEntry * e = &batch->entry[batch->count];
+  ruint32 roc = RUINT32_TO_BE ((ruint32)(idx >> 16));
+  ruint8 * tail = rtp->pay.data + paysize;
+
+  e->i = i;
+  e->packet = packet;
+  e->rtp = *rtp;
+  e->stream = stream;
+  e->idx = idx;
+  e->paysize = paysize;
+  e->newsize = newsize;
+  if (tag != NULL)
+    r_memcpy (e->tag, tag, stream->cctx->csinfo->srtp_tagbits / 8);
+
+  r_memcpy (e->saved, tail, sizeof (ruint32));
+  r_memcpy (tail, &roc, sizeof (ruint32));
+  batch->msgs[batch->count].data = rtp->hdr.data;
+  batch->msgs[batch->count].size = (rsize)(tail - rtp->hdr.data) + sizeof (ruint32);
+  batch->count++;
+}
+
+/* MACs of the entries from first on that share its stream, returns the
+ * end of that run */
+static ruint
+r_srtp_auth_batch_run (RSRTPAuthBatch * batch, ruint first, rboolean * ok)
+{
+  RSRTPStream * stream = batch->entry[first].stream;
+  ruint last;
+
+  for (last = first + 1; last < batch->count && batch->entry[last].stream == stream; last++);
+
+  if (!(*ok = r_hmac_compute_multi (stream->rtp.mac, &batch->msgs[first],
+          last - first, batch->macs, sizeof (batch->macs))))
+    R_LOG_ERROR ("HMAC update for SRTP auth failed");
+
+  return last;
+}
+
+static ruint
+r_srtp_auth_batch_finish (RSRTPAuthEntry * e, RSRTPError err, RSRTPError * errs)
+{
+  r_rtp_buffer_unmap (&e->rtp, e->packet);
+  if (err == R_SRTP_ERROR_OK &&
+      !r_buffer_resize (e->packet, r_buffer_get_offset (e->packet), e->newsize))
+    err = R_SRTP_ERROR_INTERNAL;
+
+  if (errs != NULL)
+    errs[e->i] = err;
+  return err == R_SRTP_ERROR_OK ? 1 : 0;
+}
+
+static ruint
+r_srtp_auth_batch_flush_encrypt (RSRTPAuthBatch * batch, RSRTPError * errs)
+{
+  ruint first, last, j, ret = 0;
+  rboolean ok;
+
+  for (first = 0; first < batch->count; first = last) {
+    last = r_srtp_auth_batch_run (batch, first, &ok);
+
+    for (j = first; j < last; j++) {
+      RSRTPAuthEntry * e = &batch->entry[j];
+      RSRTPStream * stream = e->stream;
+
+      if (ok) {
+        r_memcpy (e->rtp.pay.data + e->paysize + stream->rtpmkisize,
+            batch->macs + (j - first) * r_hmac_size (stream->rtp.mac),
+            stream->cctx->csinfo->srtp_tagbits / 8);
+      }
+      ret += r_srtp_auth_batch_finish (e,
+          ok ? R_SRTP_ERROR_OK : R_SRTP_ERROR_INTERNAL, errs);
+    }
+  }
+
+  batch->count = 0;
+  return ret;
+}
+
+/* Packets only count as received, and are decrypted, once the tag is
+ * verified. The replay check is done again as the same packet might be
+ * in the batch more than once. */
+static ruint
+r_srtp_auth_batch_flush_decrypt (RSRTPAuthBatch * batch, RSRTPError * errs)
+{
+  ruint first, last, j, ret = 0;
+  rboolean ok;
+
+  for (first = 0; first < batch->count; first = last) {
+    last = r_srtp_auth_batch_run (batch, first, &ok);
+
+    for (j = first; j < last; j++) {
+      RSRTPAuthEntry * e = &batch->entry[j];
+      RSRTPStream * stream = e->stream;
+      rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+      RSRTPError err;
+
+      r_memcpy (e->rtp.pay.data + e->paysize, e->saved, sizeof (ruint32));
+
+      if (!ok) {
+        err = R_SRTP_ERROR_INTERNAL;
+      } else if (R_UNLIKELY (r_memcmp (e->tag, batch->macs +
+              (j - first) * r_hmac_size (stream->rtp.mac), tagsize) != 0)) {
+        R_LOG_INFO ("stream: 0x%.8x - SRTP auth failed for idx 0x%"R_RTP_SEQIDX_FMT,
+            stream->ssrc, e->idx);
+        err = R_SRTP_ERROR_AUTH;
+      } else if ((err = r_srtp_stream_replay_check (&stream->rtp, e->idx, stream->ssrc)) == R_SRTP_ERROR_OK) {
+        r_srtp_stream_decrypt_rtp_payload (stream, &e->rtp, e->idx,
+            e->rtp.pay.data, e->paysize);
+        r_srtp_stream_rtp_replay_add (&stream->rtp, e->idx);
+      }
+
+      ret += r_srtp_auth_batch_finish (e, err, errs);
+    }
+  }
+
+  batch->count = 0;
+  return ret;
+}
+
+/* With a batch, the HMAC of packet might be deferred to the batch, which
+ * then holds on to the mapped packet */
+static RSRTPError
+r_srtp_encrypt_rtp_inplace_cached (RSRTPCtx * ctx, RBuffer * packet,
+    RSRTPStream ** cache, RSRTPAuthBatch * batch, ruint i)
+{
+  RSRTPError err;
+  RRTPBuffer rtp = R_RTP_BUFFER_INIT;
+
+  if (R_UNLIKELY (!r_srtp_buffer_is_inplace_capable (packet)))
+    return R_SRTP_ERROR_NOT_WRITABLE;
+
+  if (r_rtp_buffer_map (&rtp, packet, R_MEM_MAP_RW)) {
+    RSRTPStream * stream;
+
+    if ((stream = r_srtp_get_stream_cached (ctx, r_rtp_buffer_get_ssrc (&rtp),
+            R_SRTP_DIRECTION_OUTBOUND, cache, &err)) != NULL) {
+      rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+      rsize newsize = rtp.hdr.size + rtp.ext.size + rtp.pay.size +
+        stream->rtpmkisize + tagsize;
+      ruint64 idx = r_rtp_buffer_estimate_seq_idx (&rtp, stream->rtp.index);
+
+      if (R_UNLIKELY (newsize > r_srtp_buffer_get_tailroom (packet))) {
+        err = R_SRTP_ERROR_NOT_WRITABLE;
+      } else if ((err = r_srtp_stream_replay_check (&stream->rtp, idx, stream->ssrc)) == R_SRTP_ERROR_OK &&
+          (err = r_srtp_stream_check_auth_prefix (stream)) == R_SRTP_ERROR_OK) {
+        stream->dir = R_SRTP_DIRECTION_OUTBOUND;
+        r_srtp_stream_rtp_replay_add (&stream->rtp, idx);
+        if (batch != NULL && r_srtp_auth_batch_can_defer (stream, &rtp)) {
+          r_srtp_stream_encrypt_rtp_payload (stream, &rtp, idx, rtp.pay.data);
+          r_srtp_auth_batch_push (batch, i, packet, &rtp, stream, idx,
+              rtp.pay.size, newsize, NULL);
+          return R_SRTP_ERROR_OK;
+        }
+        err = r_srtp_stream_encrypt_rtp (stream, &rtp, idx, rtp.pay.data);
+      }
+
+      r_rtp_buffer_unmap (&rtp, packet);
+      if (err == R_SRTP_ERROR_OK &&
+          !r_buffer_resize (packet, r_buffer_get_offset (packet), newsize))
+        err = R_SRTP_ERROR_INTERNAL;
+    } else {
+      r_rtp_buffer_unmap (&rtp, packet);
+    }
+  } else {
+    err = R_SRTP_ERROR_BAD_RTP_HDR;
+  }
+
+  return err;
+}
+
+static RSRTPError
+r_srtp_decrypt_rtp_inplace_cached (RSRTPCtx * ctx, RBuffer * packet,
+    RSRTPStream ** cache, RSRTPAuthBatch * batch, ruint i)
+{
+  RSRTPError err;
+  RRTPBuffer rtp = R_RTP_BUFFER_INIT;
+
+  if (R_UNLIKELY (!r_srtp_buffer_is_inplace_capable (packet)))
+    return R_SRTP_ERROR_NOT_WRITABLE;
+
+  if (r_rtp_buffer_map (&rtp, packet, R_MEM_MAP_RW)) {
+    RSRTPStream * stream;
+
+    if ((stream = r_srtp_get_stream_cached (ctx, r_rtp_buffer_get_ssrc (&rtp),
+            R_SRTP_DIRECTION_INBOUND, cache, &err)) != NULL) {
+      rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
+      rsize newsize = rtp.hdr.size + rtp.ext.size + rtp.pay.size -
+        stream->rtpmkisize - tagsize;
+      ruint64 idx = r_rtp_buffer_estimate_seq_idx (&rtp, stream->rtp.index);
+
+      stream->dir = R_SRTP_DIRECTION_INBOUND;
+      if (R_UNLIKELY (rtp.pay.size < tagsize + stream->rtpmkisize)) {
+        err = R_SRTP_ERROR_BAD_RTP_HDR;
+      } else if ((err = r_srtp_stream_replay_check (&stream->rtp, idx, stream->ssrc)) == R_SRTP_ERROR_OK &&
+          (err = r_srtp_stream_check_auth_prefix (stream)) == R_SRTP_ERROR_OK) {
+        if (batch != NULL && r_srtp_auth_batch_can_defer (stream, &rtp)) {
+          rsize paysize = rtp.pay.size - tagsize - stream->rtpmkisize;
+          r_srtp_auth_batch_push (batch, i, packet, &rtp, stream, idx,
+              paysize, newsize, rtp.pay.data + rtp.pay.size - tagsize);
+          return R_SRTP_ERROR_OK;
+        }
+        if ((err = r_srtp_stream_decrypt_rtp (stream, &rtp, idx, rtp.pay.data)) == R_SRTP_ERROR_OK)
+          r_srtp_stream_rtp_replay_add (&stream->rtp, idx);
+      }
+
+      r_rtp_buffer_unmap (&rtp, packet);
+      if (err == R_SRTP_ERROR_OK &&
+          !r_buffer_resize (packet, r_buffer_get_offset (packet), newsize))
+        err = R_SRTP_ERROR_INTERNAL;
+    } else {
+      r_rtp_buffer_unmap (&rtp, packet);
+    }
+  } else {
+    err = R_SRTP_ERROR_BAD_RTP_HDR;
+  }
+
+  return err;
+}
+
+RSRTPError
+r_srtp_encrypt_rtp_inplace (RSRTPCtx * ctx, RBuffer * packet)
+{
+  if (R_UNLIKELY (ctx == NULL)) return R_SRTP_ERROR_INVAL;
+  if (R_UNLIKELY (packet == NULL)) return R_SRTP_ERROR_INVAL;
+
+  return r_srtp_encrypt_rtp_inplace_cached (ctx, packet, NULL, NULL, 0);
+}
+
+RSRTPError
+r_srtp_decrypt_rtp_inplace (RSRTPCtx * ctx, RBuffer * packet)
+{
+  if (R_UNLIKELY (ctx == NULL)) return R_SRTP_ERROR_INVAL;
+  if (R_UNLIKELY (packet == NULL)) return R_SRTP_ERROR_INVAL;
+
+  return r_srtp_decrypt_rtp_inplace_cached (ctx, packet, NULL, NULL, 0);
+}
+
+ruint
+r_srtp_encrypt_rtp_batch (RSRTPCtx * ctx, RBuffer ** packets, ruint count,
+    RSRTPError * errs)
+{
+  RSRTPStream * stream = NULL;
+  RSRTPAuthBatch batch;
+  RSRTPError err;
+  ruint i, ret, deferred;
+
+  if (R_UNLIKELY (ctx == NULL)) return 0;
+  if (R_UNLIKELY (packets == NULL)) return 0;
+
+  batch.count = 0;
+  for (i = ret = 0; i < count; i++) {
+    deferred = batch.count;
+    if (R_LIKELY (packets[i] != NULL))
+      err = r_srtp_encrypt_rtp_inplace_cached (ctx, packets[i], &stream, &batch, i);
+    else
+      err = R_SRTP_ERROR_INVAL;
+
+    /* Deferred packets get their result when the batch is flushed */
+    if (batch.count > deferred) {
+      if (batch.count == R_SRTP_AUTH_BATCH)
+        ret += r_srtp_auth_batch_flush_encrypt (&batch, errs);
+      continue;
+    }
+
+    if (err == R_SRTP_ERROR_OK)
+      ret++;
+    if (errs != NULL)
+      errs[i] = err;
+  }
+
+  return ret + r_srtp_auth_batch_flush_encrypt (&batch, errs);
+}
+
+ruint
+r_srtp_decrypt_rtp_batch (RSRTPCtx * ctx, RBuffer ** packets, ruint count,
+    RSRTPError * errs)
+{
+  RSRTPStream * stream = NULL;
+  RSRTPAuthBatch batch;
+  RSRTPError err;
+  ruint i, ret, deferred;
+
+  if (R_UNLIKELY (ctx == NULL)) return 0;
+  if (R_UNLIKELY (packets == NULL)) return 0;
+
+  batch.count = 0;
+  for (i = ret = 0; i < count; i++) {
+    deferred = batch.count;
+    if (R_LIKELY (packets[i] != NULL))
+      err = r_srtp_decrypt_rtp_inplace_cached (ctx, packets[i], &stream, &batch, i);
+    else
+      err = R_SRTP_ERROR_INVAL;
+
+    /* Deferred packets get their result when the batch is flushed */
+    if (batch.count > deferred) {
+      if (batch.count == R_SRTP_AUTH_BATCH)
+        ret += r_srtp_auth_batch_flush_decrypt (&batch, errs);
+      continue;
+    }
+
+    if (err == R_SRTP_ERROR_OK)
+      ret++;
+    if (errs != NULL)
+      errs[i] = err;
+  }
+
+  return ret + r_srtp_auth_batch_flush_decrypt (&batch, errs);
+}
+
+/* RFC 7714 section 9: header and SSRC are sent in the clear and together
+ * with the E flag and SRTCP index make up the AAD. Writes
+ * header || ciphertext || tag || E flag and index to dst. */
+static RSRTPError
+r_srtp_stream_encrypt_rtcp_aead (RSRTPStream * stream, const RMemMapInfo * rtcp,
+    ruint32 idx, rsize tagsize, ruint8 * dst)
+{
+  ruint8 iv[R_AES_GCM_IV_BYTES], aad[3 * sizeof (ruint32)];
+  ruint8 * eidx = dst + rtcp->size + tagsize;
+
+  r_memcpy (dst, rtcp->data, 2 * sizeof (ruint32));
+  *(ruint32 *)eidx = RUINT32_TO_BE (idx | R_SRTCP_E_BIT);
+  r_memcpy (aad, dst, 2 * sizeof (ruint32));
+  r_memcpy (aad + 2 * sizeof (ruint32), eidx, sizeof (ruint32));
+
+  r_srtp_state_create_aead_iv (iv, &stream->rtcp, stream->ssrc, idx);
+
+  R_LOG_TRACE ("Encrypting %u bytes", (ruint)(rtcp->size - 2 * sizeof (ruint32)));
+  if (R_UNLIKELY (r_cipher_aes_gcm_encrypt_full (stream->rtcp.cipher,
+          dst + 2 * sizeof (ruint32), rtcp->size - 2 * sizeof (ruint32),
+          rtcp->data + 2 * sizeof (ruint32), iv, sizeof (iv), aad, sizeof (aad),
+          dst + rtcp->size, tagsize) != R_CRYPTO_CIPHER_OK)) {
+    R_LOG_ERROR ("AEAD encryption for SRTCP failed");
+    return R_SRTP_ERROR_INTERNAL;
+  }
+
+  if (stream->rtpmkisize > 0) {
+    /* FIXME: insert mki */
+  }
+
+  return R_SRTP_ERROR_OK;
+}
+
 RBuffer *
 r_srtp_encrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
 {
@@ -682,7 +1337,19 @@ r_srtp_encrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
       if ((ret = r_buffer_new_alloc (NULL, newsize, NULL)) != NULL) {
         RMemMapInfo info = R_MEM_MAP_INFO_INIT;
 
-        if (r_buffer_map (ret, &info, R_MEM_MAP_WRITE)) {
+        if (R_SRTP_STATE_IS_AEAD (&stream->rtcp)) {
+          if (r_buffer_map (ret, &info, R_MEM_MAP_WRITE)) {
+            err = r_srtp_stream_encrypt_rtcp_aead (stream, &rtcp.info, idx,
+                tagsize, info.data);
+            r_buffer_unmap (ret, &info);
+          } else {
+            err = R_SRTP_ERROR_INTERNAL;
+          }
+          if (err != R_SRTP_ERROR_OK) {
+            r_buffer_unref (ret);
+            ret = NULL;
+          }
+        } else if (r_buffer_map (ret, &info, R_MEM_MAP_WRITE)) {
           rsize ivsize = stream->rtcp.cipher->info->ivsize;
           ruint8 * iv = r_alloca0 (ivsize);
           ruint8 * ptr = info.data;
@@ -766,8 +1433,7 @@ r_srtp_decrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
     if ((rtcppacket = r_rtcp_buffer_get_first_packet (&rtcp)) != NULL &&
         (stream = r_srtp_get_stream (ctx, r_rtcp_packet_get_ssrc (rtcppacket))) != NULL) {
       rsize tagsize = stream->cctx->csinfo->srtp_tagbits / 8;
-      const ruint8 * authtag = rtcp.info.data + rtcp.info.size - tagsize;
-      const ruint8 * srtpidx = authtag - stream->rtpmkisize - sizeof (ruint32);
+      const ruint8 * authtag, * srtpidx, * end;
       ruint32 idx;
 
       if (R_UNLIKELY (stream->dir != R_SRTP_DIRECTION_INBOUND)) {
@@ -780,6 +1446,23 @@ r_srtp_decrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
         }
       }
 
+      if (R_UNLIKELY (rtcp.info.size <
+            3 * sizeof (ruint32) + tagsize + stream->rtpmkisize)) {
+        err = R_SRTP_ERROR_BAD_RTP_HDR;
+        goto beach_map;
+      }
+
+      if (R_SRTP_STATE_IS_AEAD (&stream->rtcp)) {
+        /* RFC 7714: the tag precedes E flag, index and MKI */
+        srtpidx = rtcp.info.data + rtcp.info.size - stream->rtpmkisize - sizeof (ruint32);
+        authtag = srtpidx - tagsize;
+        end = authtag;
+      } else {
+        authtag = rtcp.info.data + rtcp.info.size - tagsize;
+        srtpidx = authtag - stream->rtpmkisize - sizeof (ruint32);
+        end = srtpidx;
+      }
+
       idx = RUINT32_TO_BE (*(const ruint32 *)srtpidx);
       if (idx & R_SRTCP_E_BIT) {
         if (stream->rtcp.cipher->info->type <= R_CRYPTO_CIPHER_ALGO_NULL) {
@@ -799,7 +1482,7 @@ r_srtp_decrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
       }
 
       if ((err = r_srtp_stream_replay_check (&stream->rtcp, idx, stream->ssrc)) == R_SRTP_ERROR_OK) {
-        rsize newsize = srtpidx - rtcp.info.data;
+        rsize newsize = end - rtcp.info.data;
 
         if (stream->cctx->csinfo->authprefixlen > 0) {
           /* FIXME: Handle keystream prefix */
@@ -835,15 +1518,31 @@ r_srtp_decrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
             rsize ivsize = stream->rtcp.cipher->info->ivsize;
             ruint8 * iv = r_alloca0 (ivsize);
 
-            r_srtp_state_create_iv (iv, ivsize, &stream->rtcp, stream->ssrc, idx);
-
             /* Copy header and ssrc */
             r_memcpy (info.data, rtcp.info.data, 2 * sizeof (ruint32));
 
             R_LOG_TRACE ("Decrypting %u bytes", (ruint)info.size);
-            r_crypto_cipher_decrypt (stream->rtcp.cipher,
-                info.data + 2 * sizeof (ruint32), info.size - 2 * sizeof (ruint32),
-                rtcp.info.data + 2 * sizeof (ruint32), iv, ivsize);
+            if (R_SRTP_STATE_IS_AEAD (&stream->rtcp)) {
+              ruint8 aad[3 * sizeof (ruint32)];
+
+              r_memcpy (aad, rtcp.info.data, 2 * sizeof (ruint32));
+              r_memcpy (aad + 2 * sizeof (ruint32), srtpidx, sizeof (ruint32));
+              r_srtp_state_create_aead_iv (iv, &stream->rtcp, stream->ssrc, idx);
+
+              if (r_cipher_aes_gcm_decrypt_full (stream->rtcp.cipher,
+                    info.data + 2 * sizeof (ruint32), info.size - 2 * sizeof (ruint32),
+                    rtcp.info.data + 2 * sizeof (ruint32), iv, ivsize,
+                    aad, sizeof (aad), authtag, tagsize) != R_CRYPTO_CIPHER_OK) {
+                R_LOG_INFO ("stream: 0x%.8x - SRTP auth failed for idx 0x%"R_RTP_SEQIDX_FMT,
+                    stream->ssrc, (ruint64)idx);
+                err = R_SRTP_ERROR_AUTH;
+              }
+            } else {
+              r_srtp_state_create_iv (iv, ivsize, &stream->rtcp, stream->ssrc, idx);
+              r_crypto_cipher_decrypt (stream->rtcp.cipher,
+                  info.data + 2 * sizeof (ruint32), info.size - 2 * sizeof (ruint32),
+                  rtcp.info.data + 2 * sizeof (ruint32), iv, ivsize);
+            }
             r_buffer_unmap (ret, &info);
           } else {
             err = R_SRTP_ERROR_INTERNAL;
@@ -852,7 +1551,12 @@ r_srtp_decrypt_rtcp (RSRTPCtx * ctx, RBuffer * packet, RSRTPError * errout)
           err = R_SRTP_ERROR_OOM;
         }
 
-        r_srtp_stream_rtp_replay_add (&stream->rtcp, idx);
+        if (err == R_SRTP_ERROR_OK) {
+          r_srtp_stream_rtp_replay_add (&stream->rtcp, idx);
+        } else if (ret != NULL) {
+          r_buffer_unref (ret);
+          ret = NULL;
+        }
       }
     } else {
       err = R_SRTP_ERROR_NO_CRYPTO_CTX;
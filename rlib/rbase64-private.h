@@ -0,0 +1,45 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_BASE64_PRIV_H__
+#define __R_BASE64_PRIV_H__
+
+#if !defined(RLIB_COMPILATION)
+#error "rbase64-private.h should only be used internally in rlib!"
+#endif
+
+#include <rlib/rbase64.h>
+
+R_BEGIN_DECLS
+
+/* x86 backend (rbase64-x86.c). The encoders return the number of bytes
+ * consumed from src, a multiple of 3, after writing 4 chars for every 3
+ * of them to dst which must have room for all of it. The decoders stop
+ * at the last whole quad in front of anything but the 64 alphabet chars
+ * and return the number of chars consumed, a multiple of 4. They store
+ * whole vectors, so dst past the decoded bytes (but within dsize) is
+ * clobbered. */
+R_API_HIDDEN rboolean r_base64_x86_sse41_available (void);
+R_API_HIDDEN rboolean r_base64_x86_avx2_available (void);
+R_API_HIDDEN rsize r_base64_x86_encode_sse41 (rchar * dst, const ruint8 * src, rsize size);
+R_API_HIDDEN rsize r_base64_x86_encode_avx2 (rchar * dst, const ruint8 * src, rsize size);
+R_API_HIDDEN rsize r_base64_x86_decode_sse41 (ruint8 * dst, rsize dsize, const rchar * src, rsize size);
+R_API_HIDDEN rsize r_base64_x86_decode_avx2 (ruint8 * dst, rsize dsize, const rchar * src, rsize size);
+
+R_END_DECLS
+
+#endif /* __R_BASE64_PRIV_H__ */
@@ -0,0 +1,308 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#include "config.h"
+#include "rbase64-private.h"
+
+#include <rlib/ratomic.h>
+
+#if defined (HAVE_X86_AVX2)
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define R_BASE64_X86_SSE41_TARGET __attribute__ ((target ("ssse3,sse4.1")))
+#define R_BASE64_X86_AVX2_TARGET  __attribute__ ((target ("avx2")))
+
+#define R_BASE64_X86_FEATURE_SSE41  (1 << 0)
+#define R_BASE64_X86_FEATURE_AVX2   (1 << 1)
+
+static raint g__r_base64_x86_features = -1;
+
+static int
+r_base64_x86_features (void)
+{
+  int features = r_atomic_int_load (&g__r_base64_x86_features);
+
+  if (R_UNLIKELY (features < 0)) {
+    unsigned int eax, ebx, ecx, edx, ecx1;
+
+    features = 0;
+    if (__get_cpuid (1, &eax, &ebx, &ecx1, &edx)) {
+      if ((ecx1 & bit_SSSE3) && (ecx1 & bit_SSE4_1))
+        features |= R_BASE64_X86_FEATURE_SSE41;
+      /* CPUID.07H:EBX.AVX2[bit 5], and the OS must save the ymm registers */
+      if (__get_cpuid_max (0, NULL) >= 7 && (ecx1 & bit_OSXSAVE)) {
+        unsigned int xcr0, xcr0hi;
+        __cpuid_count (7, 0, eax, ebx, ecx, edx);
+        __asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0hi) : "c" (0));
+        if ((ebx & bit_AVX2) && (xcr0 & 0x6) == 0x6)
+          features |= R_BASE64_X86_FEATURE_AVX2;
+      }
+    }
+    r_atomic_int_store (&g__r_base64_x86_features, features);
+  }
+
+  return features;
+}
+
+rboolean
+r_base64_x86_sse41_available (void)
+{
+  return (r_base64_x86_features () & R_BASE64_X86_FEATURE_SSE41) != 0;
+}
+
+rboolean
+r_base64_x86_avx2_available (void)
+{
+  return (r_base64_x86_features () & R_BASE64_X86_FEATURE_AVX2) != 0;
+}
+
+/* The kernels follow Muła and Lemire, "Faster Base64 Encoding and
+ * Decoding Using AVX2 Instructions". Both widths work on 16 byte lanes,
+ * the AVX2 versions are the same steps on two lanes at once. */
+
+/**************************************/
+/*           SSE4.1 (16 chars)        */
+/**************************************/
+
+/* 12 bytes at 0..11 to one 6 bit index per byte */
+static inline R_BASE64_X86_SSE41_TARGET __m128i
+r_base64_x86_enc_split_sse41 (__m128i in)
+{
+  __m128i t0, t1;
+
+  /* b1 b0 b2 b1 per 32 bit word */
+  in = _mm_shuffle_epi8 (in, _mm_set_epi8 (10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  t0 = _mm_mulhi_epu16 (_mm_and_si128 (in, _mm_set1_epi32 (0x0fc0fc00)),
+      _mm_set1_epi32 (0x04000040));
+  t1 = _mm_mullo_epi16 (_mm_and_si128 (in, _mm_set1_epi32 (0x003f03f0)),
+      _mm_set1_epi32 (0x01000010));
+  return _mm_or_si128 (t0, t1);
+}
+
+/* Index to ASCII by adding an offset picked by range */
+static inline R_BASE64_X86_SSE41_TARGET __m128i
+r_base64_x86_enc_translate_sse41 (__m128i idx)
+{
+  const __m128i offsets = _mm_setr_epi8 ('a' - 26, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '+' - 62, '/' - 63, 'A', 0, 0);
+  __m128i r;
+
+  /* 0 for 26..51, 1..12 for 52..63 and 13 for 0..25 */
+  r = _mm_subs_epu8 (idx, _mm_set1_epi8 (51));
+  r = _mm_or_si128 (r, _mm_and_si128 (_mm_cmpgt_epi8 (_mm_set1_epi8 (26), idx),
+        _mm_set1_epi8 (13)));
+  return _mm_add_epi8 (_mm_shuffle_epi8 (offsets, r), idx);
+}
+
+R_BASE64_X86_SSE41_TARGET rsize
+r_base64_x86_encode_sse41 (rchar * dst, const ruint8 * src, rsize size)
+{
+  rsize done;
+
+  /* 16 bytes are loaded for every 12 used */
+  for (done = 0; size - done >= 16; done += 12, dst += 16) {
+    __m128i in = _mm_loadu_si128 ((const __m128i *)(src + done));
+    _mm_storeu_si128 ((__m128i *)dst,
+        r_base64_x86_enc_translate_sse41 (r_base64_x86_enc_split_sse41 (in)));
+  }
+
+  return done;
+}
+
+/* The number of leading alphabet chars in in, 16 when there is nothing
+ * else. The low and high nibble tables share a bit only for those. */
+static inline R_BASE64_X86_SSE41_TARGET int
+r_base64_x86_dec_sse41 (__m128i in, __m128i * out)
+{
+  const __m128i lut_lo = _mm_setr_epi8 (0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+      0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m128i lut_hi = _mm_setr_epi8 (0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+      0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m128i lut_roll = _mm_setr_epi8 (0, 16, 19, 4, -65, -65, -71, -71,
+      0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i mask = _mm_set1_epi8 (0x0f);
+  __m128i hi, lo, bad, roll, merged;
+  int valid;
+
+  hi = _mm_and_si128 (_mm_srli_epi32 (in, 4), mask);
+  lo = _mm_and_si128 (in, mask);
+  bad = _mm_and_si128 (_mm_shuffle_epi8 (lut_lo, lo), _mm_shuffle_epi8 (lut_hi, hi));
+  valid = _mm_movemask_epi8 (_mm_cmpeq_epi8 (bad, _mm_setzero_si128 ()));
+
+  /* '/' shares the high nibble with '+' but needs another offset */
+  roll = _mm_shuffle_epi8 (lut_roll,
+      _mm_add_epi8 (_mm_cmpeq_epi8 (in, _mm_set1_epi8 ('/')), hi));
+  in = _mm_add_epi8 (in, roll);
+
+  /* Four 6 bit values to 24 bits per 32 bit word, then pack 12 bytes */
+  merged = _mm_maddubs_epi16 (in, _mm_set1_epi32 (0x01400140));
+  merged = _mm_madd_epi16 (merged, _mm_set1_epi32 (0x00011000));
+  *out = _mm_shuffle_epi8 (merged,
+      _mm_setr_epi8 (2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+  return valid == 0xffff ? 16 : __builtin_ctz (~valid);
+}
+
+R_BASE64_X86_SSE41_TARGET rsize
+r_base64_x86_decode_sse41 (ruint8 * dst, rsize dsize, const rchar * src, rsize size)
+{
+  rsize done;
+
+  /* 16 bytes are stored for every 12 written. A block cut short by a
+   * line break still gives the whole quads in front of it. */
+  for (done = 0; size - done >= 16 && dsize >= 16; done += 16, dst += 12, dsize -= 12) {
+    __m128i out;
+    int n = r_base64_x86_dec_sse41 (_mm_loadu_si128 ((const __m128i *)(src + done)), &out);
+
+    if (n < 16) {
+      if (n >= 4) {
+        _mm_storeu_si128 ((__m128i *)dst, out);
+        done += n & ~3;
+      }
+      break;
+    }
+    _mm_storeu_si128 ((__m128i *)dst, out);
+  }
+
+  return done;
+}
+
+/**************************************/
+/*            AVX2 (32 chars)         */
+/**************************************/
+
+static inline R_BASE64_X86_AVX2_TARGET __m256i
+r_base64_x86_enc_split_avx2 (__m256i in)
+{
+  __m256i t0, t1;
+
+  in = _mm256_shuffle_epi8 (in, _mm256_set_epi8 (
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+        10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  t0 = _mm256_mulhi_epu16 (_mm256_and_si256 (in, _mm256_set1_epi32 (0x0fc0fc00)),
+      _mm256_set1_epi32 (0x04000040));
+  t1 = _mm256_mullo_epi16 (_mm256_and_si256 (in, _mm256_set1_epi32 (0x003f03f0)),
+      _mm256_set1_epi32 (0x01000010));
+  return _mm256_or_si256 (t0, t1);
+}
+
+static inline R_BASE64_X86_AVX2_TARGET __m256i
+r_base64_x86_enc_translate_avx2 (__m256i idx)
+{
+  const __m256i offsets = _mm256_setr_epi8 (
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+      'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+      '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  __m256i r;
+
+  r = _mm256_subs_epu8 (idx, _mm256_set1_epi8 (51));
+  r = _mm256_or_si256 (r, _mm256_and_si256 (
+        _mm256_cmpgt_epi8 (_mm256_set1_epi8 (26), idx), _mm256_set1_epi8 (13)));
+  return _mm256_add_epi8 (_mm256_shuffle_epi8 (offsets, r), idx);
+}
+
+R_BASE64_X86_AVX2_TARGET rsize
+r_base64_x86_encode_avx2 (rchar * dst, const ruint8 * src, rsize size)
+{
+  rsize done;
+
+  /* 12 bytes into each lane, 28 bytes are loaded for every 24 used */
+  for (done = 0; size - done >= 28; done += 24, dst += 32) {
+    __m256i in = _mm256_inserti128_si256 (_mm256_castsi128_si256 (
+          _mm_loadu_si128 ((const __m128i *)(src + done))),
+        _mm_loadu_si128 ((const __m128i *)(src + done + 12)), 1);
+    _mm256_storeu_si256 ((__m256i *)dst,
+        r_base64_x86_enc_translate_avx2 (r_base64_x86_enc_split_avx2 (in)));
+  }
+
+  /* The legacy SSE encoding stalls on dirty upper ymm halves and the
+   * compiler doesn't clear them ahead of a call */
+  _mm256_zeroupper ();
+  if (size - done >= 16)
+    done += r_base64_x86_encode_sse41 (dst, src + done, size - done);
+
+  return done;
+}
+
+static inline R_BASE64_X86_AVX2_TARGET rboolean
+r_base64_x86_dec_avx2 (__m256i in, __m256i * out)
+{
+  const __m256i lut_lo = _mm256_setr_epi8 (
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+      0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+  const __m256i lut_hi = _mm256_setr_epi8 (
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+      0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  const __m256i lut_roll = _mm256_setr_epi8 (
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+      0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+  const __m256i mask = _mm256_set1_epi8 (0x0f);
+  __m256i hi, lo, roll, merged;
+
+  hi = _mm256_and_si256 (_mm256_srli_epi32 (in, 4), mask);
+  lo = _mm256_and_si256 (in, mask);
+  if (!_mm256_testz_si256 (_mm256_shuffle_epi8 (lut_lo, lo), _mm256_shuffle_epi8 (lut_hi, hi)))
+    return FALSE;
+
+  roll = _mm256_shuffle_epi8 (lut_roll,
+      _mm256_add_epi8 (_mm256_cmpeq_epi8 (in, _mm256_set1_epi8 ('/')), hi));
+  in = _mm256_add_epi8 (in, roll);
+
+  merged = _mm256_maddubs_epi16 (in, _mm256_set1_epi32 (0x01400140));
+  merged = _mm256_madd_epi16 (merged, _mm256_set1_epi32 (0x00011000));
+  merged = _mm256_shuffle_epi8 (merged, _mm256_setr_epi8 (
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+  /* Both lanes hold 12 bytes, close the gap between them */
+  *out = _mm256_permutevar8x32_epi32 (merged, _mm256_setr_epi32 (0, 1, 2, 4, 5, 6, 3, 7));
+  return TRUE;
+}
+
+R_BASE64_X86_AVX2_TARGET rsize
+r_base64_x86_decode_avx2 (ruint8 * dst, rsize dsize, const rchar * src, rsize size)
+{
+  rsize done;
+
+  for (done = 0; size - done >= 32 && dsize >= 32; done += 32, dst += 24, dsize -= 24) {
+    __m256i out;
+    if (!r_base64_x86_dec_avx2 (_mm256_loadu_si256 ((const __m256i *)(src + done)), &out))
+      break;
+    _mm256_storeu_si256 ((__m256i *)dst, out);
+  }
+
+  _mm256_zeroupper ();
+  return done + r_base64_x86_decode_sse41 (dst, dsize, src + done, size - done);
+}
+
+#else
+
+rboolean
+r_base64_x86_sse41_available (void)
+{
+  return FALSE;
+}
+
+rboolean
+r_base64_x86_avx2_available (void)
+{
+  return FALSE;
+}
+
+#endif
@@ -17,7 +17,8 @@
  */
 
 #include "config.h"
-#include <rlib/rbase64.h>
+#include "rbase64-private.h"
+#include <rlib/rmem.h>
 #include <rlib/rstr.h>
 #include <rlib/rtty.h>
 
@@ -53,42 +54,146 @@ r_base64_is_valid_char (rchar ch)
   return base64_dec_table[(ruint8)ch] < 64;
 }
 
-rsize
-r_base64_encode (rchar * dst, rsize dsize, rconstpointer data, rsize size)
+typedef rsize (*RBase64EncodeKernel) (rchar * dst, const ruint8 * src, rsize size);
+typedef rsize (*RBase64DecodeKernel) (ruint8 * dst, rsize dsize, const rchar * src, rsize size);
+
+rboolean
+r_base64_impl_available (RBase64Impl impl)
 {
-  const ruint8 * src;
-  rchar * ptr;
+  switch (impl) {
+    case R_BASE64_IMPL_AUTO:
+    case R_BASE64_IMPL_SCALAR:
+      return TRUE;
+    case R_BASE64_IMPL_SSE41:
+      return r_base64_x86_sse41_available ();
+    case R_BASE64_IMPL_AVX2:
+      return r_base64_x86_avx2_available ();
+    default:
+      return FALSE;
+  }
+}
 
-  if (R_UNLIKELY (dst == NULL)) return 0;
-  if (R_UNLIKELY (data == NULL)) return 0;
+#if defined (HAVE_X86_AVX2)
+static RBase64Impl
+r_base64_resolve_impl (RBase64Impl impl)
+{
+  if (impl != R_BASE64_IMPL_AUTO && r_base64_impl_available (impl))
+    return impl;
+  if (r_base64_x86_avx2_available ())
+    return R_BASE64_IMPL_AVX2;
+  if (r_base64_x86_sse41_available ())
+    return R_BASE64_IMPL_SSE41;
+  return R_BASE64_IMPL_SCALAR;
+}
+#endif
+
+static RBase64EncodeKernel
+r_base64_encode_kernel (RBase64Impl impl)
+{
+#if defined (HAVE_X86_AVX2)
+  switch (r_base64_resolve_impl (impl)) {
+    case R_BASE64_IMPL_AVX2:
+      return r_base64_x86_encode_avx2;
+    case R_BASE64_IMPL_SSE41:
+      return r_base64_x86_encode_sse41;
+    default:
+      break;
+  }
+#else
+  (void) impl;
+#endif
+  return NULL;
+}
+
+static RBase64DecodeKernel
+r_base64_decode_kernel (RBase64Impl impl)
+{
+#if defined (HAVE_X86_AVX2)
+  switch (r_base64_resolve_impl (impl)) {
+    case R_BASE64_IMPL_AVX2:
+      return r_base64_x86_decode_avx2;
+    case R_BASE64_IMPL_SSE41:
+      return r_base64_x86_decode_sse41;
+    default:
+      break;
+  }
+#else
+  (void) impl;
+#endif
+  return NULL;
+}
+
+/* Whole 3 byte groups only, dst has room for all of them */
+static rchar *
+r_base64_encode_groups (RBase64EncodeKernel kernel, rchar * ptr,
+    const ruint8 * src, rsize groups)
+{
+  if (kernel != NULL) {
+    rsize done = kernel (ptr, src, groups * 3);
+    ptr += (done / 3) * 4;
+    src += done;
+    groups -= done / 3;
+  }
 
-  for (ptr = dst, src = data; size >= 3 && dsize >= 4; dsize -= 4, size -= 3, src += 3) {
+  for (; groups > 0; groups--, src += 3) {
     *ptr++ = base64_enc_table[(src[0] & 0xfc) >> 2];
     *ptr++ = base64_enc_table[((src[0] & 0x03) << 4) | ((src[1] & 0xf0) >> 4)];
     *ptr++ = base64_enc_table[((src[1] & 0x0F) << 2) | ((src[2] & 0xc0) >> 6)];
     *ptr++ = base64_enc_table[(src[2] & 0x3f)];
   }
 
-  if (dsize >= 4) {
-    if (size == 2) {
-      *ptr++ = base64_enc_table[(src[0] & 0xfc) >> 2];
-      *ptr++ = base64_enc_table[((src[0] & 0x03) << 4) | ((src[1] & 0xf0) >> 4)];
-      *ptr++ = base64_enc_table[((src[1] & 0x0F) << 2)];
-      *ptr++ = '=';
-    } else if (size == 1) {
-      *ptr++ = base64_enc_table[(src[0] & 0xfc) >> 2];
-      *ptr++ = base64_enc_table[((src[0] & 0x03) << 4)];
-      *ptr++ = '=';
-      *ptr++ = '=';
-    }
+  return ptr;
+}
+
+/* The last 1 or 2 bytes with padding */
+static rchar *
+r_base64_encode_tail (rchar * ptr, const ruint8 * src, rsize size)
+{
+  if (size == 2) {
+    *ptr++ = base64_enc_table[(src[0] & 0xfc) >> 2];
+    *ptr++ = base64_enc_table[((src[0] & 0x03) << 4) | ((src[1] & 0xf0) >> 4)];
+    *ptr++ = base64_enc_table[((src[1] & 0x0F) << 2)];
+    *ptr++ = '=';
+  } else if (size == 1) {
+    *ptr++ = base64_enc_table[(src[0] & 0xfc) >> 2];
+    *ptr++ = base64_enc_table[((src[0] & 0x03) << 4)];
+    *ptr++ = '=';
+    *ptr++ = '=';
   }
 
+  return ptr;
+}
+
+rsize
+r_base64_encode_with_impl (RBase64Impl impl, rchar * dst, rsize dsize,
+    rconstpointer data, rsize size)
+{
+  const ruint8 * src = data;
+  rchar * ptr;
+  rsize groups;
+
+  if (R_UNLIKELY (dst == NULL)) return 0;
+  if (R_UNLIKELY (data == NULL)) return 0;
+
+  groups = MIN (size / 3, dsize / 4);
+  ptr = r_base64_encode_groups (r_base64_encode_kernel (impl), dst, src, groups);
+  if (groups == size / 3 && dsize - groups * 4 >= 4)
+    ptr = r_base64_encode_tail (ptr, src + groups * 3, size - groups * 3);
+
   return RPOINTER_TO_SIZE (ptr - dst);
 }
 
 rsize
-r_base64_decode (ruint8 * dst, rsize dsize, const rchar * data, rssize size)
+r_base64_encode (rchar * dst, rsize dsize, rconstpointer data, rsize size)
 {
+  return r_base64_encode_with_impl (R_BASE64_IMPL_AUTO, dst, dsize, data, size);
+}
+
+rsize
+r_base64_decode_with_impl (RBase64Impl impl, ruint8 * dst, rsize dsize,
+    const rchar * data, rssize size)
+{
+  RBase64DecodeKernel kernel = r_base64_decode_kernel (impl);
   ruint8 c, scratch[4] = { 0, 0, 0, 0 };
   const rchar * src = data, * srcend;
   ruint8 * ptr = dst;
@@ -98,6 +203,16 @@ r_base64_decode (ruint8 * dst, rsize dsize, const rchar * data, rssize size)
   srcend = src + size;
 
   while (src < srcend) {
+    /* runs of plain alphabet chars, up to the next space or padding */
+    if (kernel != NULL) {
+      rsize done = kernel (ptr, RPOINTER_TO_SIZE (dst + dsize - ptr),
+          src, RPOINTER_TO_SIZE (srcend - src));
+      src += done;
+      ptr += (done / 4) * 3;
+      if (src >= srcend)
+        break;
+    }
+
     /* fill scratch */
     for (i = 0; i < 4;) {
       if (R_UNLIKELY (src >= srcend))
@@ -134,6 +249,12 @@ beach:
   return RPOINTER_TO_SIZE (ptr - dst);
 }
 
+rsize
+r_base64_decode (ruint8 * dst, rsize dsize, const rchar * data, rssize size)
+{
+  return r_base64_decode_with_impl (R_BASE64_IMPL_AUTO, dst, dsize, data, size);
+}
+
 rchar *
 r_base64_encode_dup (rconstpointer data, rsize size, rsize * outsize)
 {
@@ -172,35 +293,21 @@ r_base64_encode_dup_full (rconstpointer data, rsize size, rsize linesize, rsize
     s++;
 
     if ((ret = r_malloc (s)) != NULL) {
-      const ruint8 * src = data;
-      rchar * dst = ret;
-      rsize lpos;
-
-      for (lpos = 0; size >= 3; size -= 3, src += 3) {
-        *dst++ = base64_enc_table[(src[0] & 0xfc) >> 2];
-        *dst++ = base64_enc_table[((src[0] & 0x03) << 4) | ((src[1] & 0xf0) >> 4)];
-        *dst++ = base64_enc_table[((src[1] & 0x0F) << 2) | ((src[2] & 0xc0) >> 6)];
-        *dst++ = base64_enc_table[(src[2] & 0x3f)];
-
-        lpos += 4;
-        if (lpos >= linesize) {
-          if (size > 3)
-            *dst++ = '\n';
-          lpos = 0;
-        }
-      }
-
-      if (size == 2) {
-        *dst++ = base64_enc_table[(src[0] & 0xfc) >> 2];
-        *dst++ = base64_enc_table[((src[0] & 0x03) << 4) | ((src[1] & 0xf0) >> 4)];
-        *dst++ = base64_enc_table[((src[1] & 0x0F) << 2)];
-        *dst++ = '=';
-      } else if (size == 1) {
-        *dst++ = base64_enc_table[(src[0] & 0xfc) >> 2];
-        *dst++ = base64_enc_table[((src[0] & 0x03) << 4)];
-        *dst++ = '=';
-        *dst++ = '=';
+      /* Encode in one go to the end of ret, then move the lines down
+       * to make room for the line breaks */
+      rsize line = (linesize + 3) & ~3, enclen = ((size + 2) / 3) * 4;
+      rchar * dst = ret, * src = ret + s - 1 - enclen;
+
+      r_base64_encode (src, enclen, data, size);
+      while (enclen > line) {
+        r_memmove (dst, src, line);
+        dst += line;
+        *dst++ = '\n';
+        src += line;
+        enclen -= line;
       }
+      r_memmove (dst, src, enclen);
+      dst += enclen;
 
       *dst = 0;
       if (outsize != NULL)
@@ -234,3 +341,184 @@ r_base64_decode_dup (const rchar * data, rssize size, rsize * outsize)
   return ret;
 }
 
+void
+r_base64_encoder_init (RBase64Encoder * enc)
+{
+  r_memclear (enc, sizeof (RBase64Encoder));
+}
+
+rsize
+r_base64_encoder_update (RBase64Encoder * enc, rchar * dst, rsize dsize,
+    rconstpointer data, rsize size)
+{
+  const ruint8 * src = data;
+  rchar * ptr = dst;
+  rsize groups;
+
+  if (R_UNLIKELY (enc == NULL || dst == NULL)) return 0;
+  if (R_UNLIKELY (data == NULL && size > 0)) return 0;
+  if (R_UNLIKELY (dsize < ((enc->npending + size) / 3) * 4)) return 0;
+
+  if (enc->npending > 0) {
+    while (enc->npending < 3 && size > 0) {
+      enc->pending[enc->npending++] = *src++;
+      size--;
+    }
+    if (enc->npending < 3)
+      return 0;
+    ptr = r_base64_encode_groups (NULL, ptr, enc->pending, 1);
+    enc->npending = 0;
+  }
+
+  groups = size / 3;
+  ptr = r_base64_encode_groups (r_base64_encode_kernel (R_BASE64_IMPL_AUTO),
+      ptr, src, groups);
+  for (src += groups * 3, size -= groups * 3; size > 0; size--)
+    enc->pending[enc->npending++] = *src++;
+
+  return RPOINTER_TO_SIZE (ptr - dst);
+}
+
+rsize
+r_base64_encoder_finish (RBase64Encoder * enc, rchar * dst, rsize dsize)
+{
+  rchar * ptr;
+
+  if (R_UNLIKELY (enc == NULL || dst == NULL)) return 0;
+  if (R_UNLIKELY (enc->npending > 0 && dsize < 4)) return 0;
+
+  ptr = r_base64_encode_tail (dst, enc->pending, enc->npending);
+  r_base64_encoder_init (enc);
+
+  return RPOINTER_TO_SIZE (ptr - dst);
+}
+
+void
+r_base64_decoder_init (RBase64Decoder * dec)
+{
+  r_memclear (dec, sizeof (RBase64Decoder));
+}
+
+rsize
+r_base64_decoder_update (RBase64Decoder * dec, ruint8 * dst, rsize dsize,
+    const rchar * src, rsize size)
+{
+  RBase64DecodeKernel kernel;
+  const rchar * srcend = src + size;
+  ruint8 c, * ptr = dst;
+
+  if (R_UNLIKELY (dec == NULL || dst == NULL)) return 0;
+  if (R_UNLIKELY (src == NULL && size > 0)) return 0;
+  if (R_UNLIKELY (dsize < ((dec->nquad + size) / 4) * 3)) return 0;
+
+  kernel = r_base64_decode_kernel (R_BASE64_IMPL_AUTO);
+  while (!dec->done && src < srcend) {
+    if (dec->nquad == 0 && kernel != NULL) {
+      rsize done = kernel (ptr, RPOINTER_TO_SIZE (dst + dsize - ptr),
+          src, RPOINTER_TO_SIZE (srcend - src));
+      src += done;
+      ptr += (done / 4) * 3;
+      if (src >= srcend)
+        break;
+    }
+
+    if ((c = base64_dec_table[(ruint8)*src++]) < 64) {
+      dec->quad[dec->nquad++] = c;
+      if (dec->nquad == 4) {
+        *ptr++ = ((dec->quad[0] << 2) & 0xfc) | ((dec->quad[1] >> 4) & 0x03);
+        *ptr++ = ((dec->quad[1] << 4) & 0xf0) | ((dec->quad[2] >> 2) & 0x0f);
+        *ptr++ = ((dec->quad[2] << 6) & 0xc0) | ((dec->quad[3] >> 0) & 0x3f);
+        dec->nquad = 0;
+      }
+    } else if (c != R_BASE64_BYTE_SPACE) {
+      dec->done = TRUE;
+    }
+  }
+
+  return RPOINTER_TO_SIZE (ptr - dst);
+}
+
+rsize
+r_base64_decoder_finish (RBase64Decoder * dec, ruint8 * dst, rsize dsize)
+{
+  ruint8 * ptr = dst;
+
+  if (R_UNLIKELY (dec == NULL || dst == NULL)) return 0;
+  if (R_UNLIKELY (dsize < 2 && dec->nquad > 1)) return 0;
+
+  if (dec->nquad >= 2)
+    *ptr++ = ((dec->quad[0] << 2) & 0xfc) | ((dec->quad[1] >> 4) & 0x03);
+  if (dec->nquad == 3)
+    *ptr++ = ((dec->quad[1] << 4) & 0xf0) | ((dec->quad[2] >> 2) & 0x0f);
+  r_base64_decoder_init (dec);
+
+  return RPOINTER_TO_SIZE (ptr - dst);
+}
+
+rchar *
+r_base64_encode_buffer_dup (RBuffer * buffer, rsize * outsize)
+{
+  RBase64Encoder enc = R_BASE64_ENCODER_INIT;
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  rchar * ret, * ptr;
+  rsize size;
+  ruint idx, count;
+
+  if (R_UNLIKELY (buffer == NULL)) return NULL;
+  if (R_UNLIKELY ((size = r_buffer_get_size (buffer)) == 0)) return NULL;
+
+  size = R_BASE64_ENCODED_SIZE (size) + 1;
+  if ((ret = r_malloc (size)) != NULL) {
+    ptr = ret;
+    for (idx = 0, count = r_buffer_mem_count (buffer); idx < count; idx++) {
+      if (!r_buffer_map_mem_range (buffer, idx, 1, &info, R_MEM_MAP_READ)) {
+        r_free (ret);
+        return NULL;
+      }
+      ptr += r_base64_encoder_update (&enc, ptr, size - RPOINTER_TO_SIZE (ptr - ret),
+          info.data, info.size);
+      r_buffer_unmap (buffer, &info);
+    }
+    ptr += r_base64_encoder_finish (&enc, ptr, 4);
+
+    *ptr = 0;
+    if (outsize != NULL)
+      *outsize = RPOINTER_TO_SIZE (ptr - ret);
+  }
+
+  return ret;
+}
+
+ruint8 *
+r_base64_decode_buffer_dup (RBuffer * buffer, rsize * outsize)
+{
+  RBase64Decoder dec = R_BASE64_DECODER_INIT;
+  RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+  ruint8 * ret, * ptr;
+  rsize size;
+  ruint idx, count;
+
+  if (R_UNLIKELY (buffer == NULL)) return NULL;
+  if (R_UNLIKELY ((size = r_buffer_get_size (buffer)) == 0)) return NULL;
+
+  size = R_BASE64_DECODED_SIZE (size) + 1;
+  if ((ret = r_malloc (size)) != NULL) {
+    ptr = ret;
+    for (idx = 0, count = r_buffer_mem_count (buffer); idx < count && !dec.done; idx++) {
+      if (!r_buffer_map_mem_range (buffer, idx, 1, &info, R_MEM_MAP_READ)) {
+        r_free (ret);
+        return NULL;
+      }
+      ptr += r_base64_decoder_update (&dec, ptr, size - RPOINTER_TO_SIZE (ptr - ret),
+          (const rchar *)info.data, info.size);
+      r_buffer_unmap (buffer, &info);
+    }
+    ptr += r_base64_decoder_finish (&dec, ptr, 2);
+
+    *ptr = 0;
+    if (outsize != NULL)
+      *outsize = RPOINTER_TO_SIZE (ptr - ret);
+  }
+
+  return ret;
+}
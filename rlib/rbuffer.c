@@ -20,6 +20,7 @@
 #include <rlib/rbuffer.h>
 
 #include <rlib/rmem.h>
+#include <rlib/rthreads.h>
 
 /* FIXME: Add logging??? */
 
@@ -30,12 +31,34 @@ struct _RBuffer {
 
   RMem * mem[R_BUFFER_MAX_MEM];
   ruint mem_count;
+
+  RBufferPool * pool;
+};
+
+struct _RBufferPool {
+  RRef ref;
+
+  RMemAllocator * allocator;
+  RMemAllocationParams params;
+  rsize allocsize;
+
+  RMutex mutex;
+  RBuffer ** free;
+  ruint count;
+  ruint max;
 };
 
+static rboolean r_buffer_pool_release (RBufferPool * pool, RBuffer * buf);
+
 static void
 r_buffer_free (RBuffer * buf)
 {
-  ruint i, count = buf->mem_count;
+  ruint i, count;
+
+  if (buf->pool != NULL && r_buffer_pool_release (buf->pool, buf))
+    return;
+
+  count = buf->mem_count;
   buf->mem_count = 0;
 
   for (i = 0; i < count; i++)
@@ -1038,3 +1061,112 @@ r_buffer_memcmp (RBuffer * buffer, rsize offset, rconstpointer mem, rsize size)
   return size == 0 ? ret : 1;
 }
 
+
+static void
+r_buffer_pool_free (RBufferPool * pool)
+{
+  ruint i;
+
+  for (i = 0; i < pool->count; i++)
+    r_buffer_free (pool->free[i]);
+
+  r_mutex_clear (&pool->mutex);
+  r_mem_allocator_unref (pool->allocator);
+  r_free (pool->free);
+  r_free (pool);
+}
+
+RBufferPool *
+r_buffer_pool_new (RMemAllocator * allocator, rsize allocsize,
+    const RMemAllocationParams * params, ruint max)
+{
+  RBufferPool * ret;
+
+  if (R_UNLIKELY (allocsize == 0)) return NULL;
+
+  if ((ret = r_mem_new0 (RBufferPool)) != NULL) {
+    r_ref_init (ret, r_buffer_pool_free);
+    ret->allocator = allocator != NULL ?
+      r_mem_allocator_ref (allocator) : r_mem_allocator_default ();
+    if (params != NULL)
+      ret->params = *params;
+    ret->allocsize = allocsize;
+    ret->max = max;
+    r_mutex_init (&ret->mutex);
+    if (R_UNLIKELY ((ret->free = r_mem_new_n (RBuffer *, MAX (max, 1))) == NULL)) {
+      r_buffer_pool_unref (ret);
+      ret = NULL;
+    }
+  }
+
+  return ret;
+}
+
+RBuffer *
+r_buffer_pool_acquire (RBufferPool * pool)
+{
+  RBuffer * ret;
+
+  if (R_UNLIKELY (pool == NULL)) return NULL;
+
+  r_mutex_lock (&pool->mutex);
+  ret = pool->count > 0 ? pool->free[--pool->count] : NULL;
+  r_mutex_unlock (&pool->mutex);
+
+  if (ret != NULL)
+    r_ref_init (ret, r_buffer_free);
+  else if ((ret = r_buffer_new_alloc (pool->allocator, pool->allocsize, &pool->params)) == NULL)
+    return NULL;
+
+  ret->pool = r_buffer_pool_ref (pool);
+  return ret;
+}
+
+rsize
+r_buffer_pool_get_allocsize (const RBufferPool * pool)
+{
+  return pool != NULL ? pool->allocsize : 0;
+}
+
+/* Returns TRUE if buf was taken back by the pool */
+static rboolean
+r_buffer_pool_release (RBufferPool * pool, RBuffer * buf)
+{
+  const RMemAllocationParams * params = &pool->params;
+  rboolean ret = FALSE;
+  RMem * mem;
+
+  buf->pool = NULL;
+
+  /* Only recycle buffers still looking like what r_buffer_pool_acquire made */
+  if (buf->mem_count == 1 && (mem = buf->mem[0])->parent == NULL &&
+      mem->allocator == pool->allocator && r_mem_is_writable (mem) &&
+      mem->allocsize == params->prefix + pool->allocsize + params->padding &&
+      r_ref_refcount (mem) == 1) {
+    mem->flags = params->flags;
+    mem->offset = params->prefix;
+    mem->size = pool->allocsize;
+
+    if (params->flags & (R_MEM_FLAG_ZERO_PREFIXED | R_MEM_FLAG_ZERO_PADDED)) {
+      RMemMapInfo info = R_MEM_MAP_INFO_INIT;
+      if (r_mem_map (mem, &info, R_MEM_MAP_WRITE)) {
+        if (params->flags & R_MEM_FLAG_ZERO_PREFIXED)
+          r_memset (info.data - params->prefix, 0, params->prefix);
+        if (params->flags & R_MEM_FLAG_ZERO_PADDED)
+          r_memset (info.data + info.size, 0, params->padding);
+        r_mem_unmap (mem, &info);
+      } else {
+        goto done;
+      }
+    }
+
+    r_mutex_lock (&pool->mutex);
+    if ((ret = (pool->count < pool->max)))
+      pool->free[pool->count++] = buf;
+    r_mutex_unlock (&pool->mutex);
+  }
+
+done:
+  r_buffer_pool_unref (pool);
+  return ret;
+}
@@ -70,34 +70,23 @@ r_clock_wait (RClock * clock, RClockTime ts)
   return clock->wait (clock, ts);
 }
 
-static void
-r_clock_entry_free (RClockEntry * entry)
-{
-  r_to_cb_deinit (&entry->tocb);
-  r_free (entry);
-}
-
 RClockEntry *
 r_clock_add_timeout_callback (RClock * clock,
     RClockTime ts, RFunc cb, rpointer data, RDestroyNotify datanotify,
     rpointer user, RDestroyNotify usernotify)
 {
-  RClockEntry * ret;
-  if ((ret = r_mem_new (RClockEntry)) != NULL) {
-    r_ref_init (ret, r_clock_entry_free);
-    r_to_cb_init (&ret->tocb, ts, cb, data, datanotify, user, usernotify);
+  RToCB * ret;
 
-    r_timeout_cblist_internal_insert (&clock->timers,
-        r_to_cb_ref (ret));
-  }
+  r_timeout_cblist_insert (&clock->timers, &ret,
+      ts, cb, data, datanotify, user, usernotify);
 
-  return ret;
+  return (RClockEntry *)ret;
 }
 
 rboolean
 r_clock_cancel_entry (RClock * clock, RClockEntry * entry)
 {
-  return r_timeout_cblist_cancel (&clock->timers, &entry->tocb);
+  return r_timeout_cblist_cancel (&clock->timers, (RToCB *)entry);
 }
 
 rsize
@@ -129,6 +118,12 @@ r_clock_process_entries (RClock * clock, RClockTime * tsout)
   return r_timeout_cblist_update (&clock->timers, ts);
 }
 
+ruint
+r_clock_process_entries_until (RClock * clock, RClockTime ts)
+{
+  return r_timeout_cblist_update (&clock->timers, ts);
+}
+
 
 
 /* System clock */
@@ -158,6 +153,29 @@ r_system_clock_get (void)
   return r_clock_ref (&g__r_sysclock);
 }
 
+static void
+r_system_clock_free (RClock * clock)
+{
+  r_clock_clear (clock);
+  r_free (clock);
+}
+
+RClock *
+r_system_clock_new (void)
+{
+  RClock * ret;
+
+  if ((ret = r_mem_new (RClock)) != NULL) {
+    r_ref_init (ret, r_system_clock_free);
+    ret->get_time = (RClockGetTimeFunc)r_time_get_ts_monotonic;
+    ret->wait = r_system_clock_wait;
+    ret->is_synthetic = FALSE;
+    r_timeout_cblist_init (&ret->timers);
+  }
+
+  return ret;
+}
+
 
 
 /* Test clock */
@@ -0,0 +1,45 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_CRC_PRIV_H__
+#define __R_CRC_PRIV_H__
+
+#if !defined(RLIB_COMPILATION)
+#error "rcrc-private.h should only be used internally in rlib!"
+#endif
+
+#include <rlib/rcrc.h>
+
+R_BEGIN_DECLS
+
+/* x86 backend (rcrc-x86.c). All of these work on the raw register, the
+ * caller does the pre and post inversion. */
+R_API_HIDDEN rboolean r_crc_x86_sse42_available (void);
+R_API_HIDDEN rboolean r_crc_x86_pclmul_available (void);
+R_API_HIDDEN ruint32 r_crc32c_x86_sse42 (ruint32 crc, const ruint8 * data, rsize size);
+
+/* Folds size rounded down to 16 bytes into the 16 bytes at out. The CRC
+ * of out from a zero register is the register after the consumed bytes.
+ * Returns the number of bytes consumed, size must be at least
+ * R_CRC_X86_FOLD_MIN. */
+#define R_CRC_X86_FOLD_MIN        64
+R_API_HIDDEN rsize r_crc32_x86_fold (ruint32 crc, const ruint8 * data, rsize size, ruint8 * out);
+R_API_HIDDEN rsize r_crc32c_x86_fold (ruint32 crc, const ruint8 * data, rsize size, ruint8 * out);
+
+R_END_DECLS
+
+#endif /* __R_CRC_PRIV_H__ */
@@ -0,0 +1,167 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#include "config.h"
+#include "rcrc-private.h"
+
+#include <rlib/ratomic.h>
+
+#if defined (HAVE_X86_CRC)
+#include <cpuid.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#include <string.h>
+
+#define R_CRC_X86_SSE42_TARGET    __attribute__ ((target ("sse4.2")))
+#define R_CRC_X86_PCLMUL_TARGET   __attribute__ ((target ("pclmul,sse2")))
+
+#define R_CRC_X86_FEATURE_SSE42   (1 << 0)
+#define R_CRC_X86_FEATURE_PCLMUL  (1 << 1)
+
+static raint g__r_crc_x86_features = -1;
+
+static int
+r_crc_x86_features (void)
+{
+  int features = r_atomic_int_load (&g__r_crc_x86_features);
+
+  if (R_UNLIKELY (features < 0)) {
+    unsigned int eax, ebx, ecx, edx;
+
+    features = 0;
+    if (__get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+      if (ecx & bit_SSE4_2)
+        features |= R_CRC_X86_FEATURE_SSE42;
+      if (ecx & bit_PCLMUL)
+        features |= R_CRC_X86_FEATURE_PCLMUL;
+    }
+    r_atomic_int_store (&g__r_crc_x86_features, features);
+  }
+
+  return features;
+}
+
+rboolean
+r_crc_x86_sse42_available (void)
+{
+  return (r_crc_x86_features () & R_CRC_X86_FEATURE_SSE42) != 0;
+}
+
+rboolean
+r_crc_x86_pclmul_available (void)
+{
+  return (r_crc_x86_features () & R_CRC_X86_FEATURE_PCLMUL) != 0;
+}
+
+/* The crc32 instruction is CRC32C only, one dependency chain through the
+ * register */
+R_CRC_X86_SSE42_TARGET ruint32
+r_crc32c_x86_sse42 (ruint32 crc, const ruint8 * data, rsize size)
+{
+#if defined (__x86_64__)
+  ruint64 crc64 = crc;
+
+  for (; size >= 8; size -= 8, data += 8) {
+    ruint64 v;
+    memcpy (&v, data, sizeof (v));
+    crc64 = _mm_crc32_u64 (crc64, v);
+  }
+  crc = (ruint32)crc64;
+#endif
+  for (; size >= 4; size -= 4, data += 4) {
+    ruint32 v;
+    memcpy (&v, data, sizeof (v));
+    crc = _mm_crc32_u32 (crc, v);
+  }
+  while (size--)
+    crc = _mm_crc32_u8 (crc, *data++);
+
+  return crc;
+}
+
+/* Folding constants for the bit reflected polynomials, each pair is
+ * x^(d + 32) and x^(d - 32) mod P bit reflected and shifted up by one,
+ * for folding d bits ahead. 512 for four 16 byte lanes, 128 for one. */
+#define R_CRC32_X86_K512          _mm_set_epi64x (0x1c6e41596, 0x154442bd4)
+#define R_CRC32_X86_K128          _mm_set_epi64x (0x0ccaa009e, 0x1751997d0)
+#define R_CRC32C_X86_K512         _mm_set_epi64x (0x09e4addf8, 0x0740eef02)
+#define R_CRC32C_X86_K128         _mm_set_epi64x (0x14cd00bd6, 0x0f20c0dfe)
+
+/* The low half holds the first 8 bytes, which sit d + 32 bits ahead */
+#define R_CRC_X86_FOLD(x, k, next)                                            \
+  _mm_xor_si128 (_mm_xor_si128 (_mm_clmulepi64_si128 (x, k, 0x00),            \
+        _mm_clmulepi64_si128 (x, k, 0x11)), next)
+
+static inline R_CRC_X86_PCLMUL_TARGET rsize
+r_crc_x86_fold (__m128i k512, __m128i k128,
+    ruint32 crc, const ruint8 * data, rsize size, ruint8 * out)
+{
+  const ruint8 * ptr = data;
+  __m128i x0, x1, x2, x3;
+
+  x0 = _mm_xor_si128 (_mm_loadu_si128 ((const __m128i *)ptr),
+      _mm_cvtsi32_si128 ((int)crc));
+  x1 = _mm_loadu_si128 ((const __m128i *)(ptr + 16));
+  x2 = _mm_loadu_si128 ((const __m128i *)(ptr + 32));
+  x3 = _mm_loadu_si128 ((const __m128i *)(ptr + 48));
+  ptr += 64;
+  size -= 64;
+
+  for (; size >= 64; size -= 64, ptr += 64) {
+    x0 = R_CRC_X86_FOLD (x0, k512, _mm_loadu_si128 ((const __m128i *)ptr));
+    x1 = R_CRC_X86_FOLD (x1, k512, _mm_loadu_si128 ((const __m128i *)(ptr + 16)));
+    x2 = R_CRC_X86_FOLD (x2, k512, _mm_loadu_si128 ((const __m128i *)(ptr + 32)));
+    x3 = R_CRC_X86_FOLD (x3, k512, _mm_loadu_si128 ((const __m128i *)(ptr + 48)));
+  }
+
+  x0 = R_CRC_X86_FOLD (x0, k128, x1);
+  x0 = R_CRC_X86_FOLD (x0, k128, x2);
+  x0 = R_CRC_X86_FOLD (x0, k128, x3);
+  for (; size >= 16; size -= 16, ptr += 16)
+    x0 = R_CRC_X86_FOLD (x0, k128, _mm_loadu_si128 ((const __m128i *)ptr));
+
+  _mm_storeu_si128 ((__m128i *)out, x0);
+  return (rsize)(ptr - data);
+}
+
+R_CRC_X86_PCLMUL_TARGET rsize
+r_crc32_x86_fold (ruint32 crc, const ruint8 * data, rsize size, ruint8 * out)
+{
+  return r_crc_x86_fold (R_CRC32_X86_K512, R_CRC32_X86_K128, crc, data, size, out);
+}
+
+R_CRC_X86_PCLMUL_TARGET rsize
+r_crc32c_x86_fold (ruint32 crc, const ruint8 * data, rsize size, ruint8 * out)
+{
+  return r_crc_x86_fold (R_CRC32C_X86_K512, R_CRC32C_X86_K128, crc, data, size, out);
+}
+
+#else
+
+rboolean
+r_crc_x86_sse42_available (void)
+{
+  return FALSE;
+}
+
+rboolean
+r_crc_x86_pclmul_available (void)
+{
+  return FALSE;
+}
+
+#endif
@@ -17,9 +17,16 @@
  */
 
 #include "config.h"
-#include <rlib/rcrc.h>
+#include "rlib-private.h"
+#include "rcrc-private.h"
 
 #define R_CRC32_POLYNOMIAL        0x04c11db7
+/* Bit reversed polynomials for CRC32 and CRC32C */
+#define R_CRC32_POLYNOMIAL_REV    0xedb88320
+#define R_CRC32C_POLYNOMIAL_REV   0x82f63b78
+
+/* Below this the crc32 instruction beats folding for CRC32C */
+#define R_CRC32C_FOLD_MIN         512
 
 static const ruint32 g__r_crc32_tbl[] = {
   0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f, 0xe963a535, 0x9e6495a3,
@@ -90,46 +97,280 @@ static const ruint32 g__r_crc32c_tbl[] = {
   0x79b737ba, 0x8bdcb4b9, 0x988c474d, 0x6ae7c44e, 0xbe2da0a5, 0x4c4623a6, 0x5f16d052, 0xad7d5351
 };
 
-ruint32
-r_crc32_update (ruint32 crc, rconstpointer buffer, rsize size)
+
+/* Tables for slicing, [0] is the plain bytewise table and [k] advances
+ * the register over k more zero bytes. Filled in by r_crc_init (). */
+static ruint32 g__r_crc32_slice[16][256];
+static ruint32 g__r_crc32c_slice[16][256];
+static ruint32 g__r_crc32bzip2_slice[8][256];
+/* x^(2^n) modulo the polynomial, for combining. The size in bits of
+ * any rsize needs the first 3 + 8 * sizeof (rsize) of these. */
+#define R_CRC_X2N                 (3 + 8 * sizeof (rsize))
+static ruint32 g__r_crc32_x2n[R_CRC_X2N];
+static ruint32 g__r_crc32c_x2n[R_CRC_X2N];
+
+/* a * b modulo the bit reversed poly, where bit 31 is x^0 */
+static ruint32
+r_crc_multmodp (ruint32 poly, ruint32 a, ruint32 b)
 {
-  const ruint8 * ptr = buffer;
+  ruint32 m = 1u << 31, p = 0;
 
-  crc = ~crc;
+  for (;;) {
+    if (a & m) {
+      p ^= b;
+      if ((a & (m - 1)) == 0)
+        break;
+    }
+    m >>= 1;
+    b = (b & 1) ? (b >> 1) ^ poly : b >> 1;
+  }
+
+  return p;
+}
+
+static void
+r_crc_init_reflected (ruint32 (*slice)[256], ruint32 * x2n,
+    const ruint32 * tbl, ruint32 poly)
+{
+  ruint32 p;
+  ruint i, k;
+
+  for (i = 0; i < 256; i++) {
+    slice[0][i] = tbl[i];
+    for (k = 1; k < 16; k++)
+      slice[k][i] = (slice[k - 1][i] >> 8) ^ tbl[slice[k - 1][i] & 0xff];
+  }
+
+  x2n[0] = p = 1u << 30;
+  for (i = 1; i < R_CRC_X2N; i++)
+    x2n[i] = p = r_crc_multmodp (poly, p, p);
+}
+
+void
+r_crc_init (void)
+{
+  ruint i, k;
+
+  r_crc_init_reflected (g__r_crc32_slice, g__r_crc32_x2n,
+      g__r_crc32_tbl, R_CRC32_POLYNOMIAL_REV);
+  r_crc_init_reflected (g__r_crc32c_slice, g__r_crc32c_x2n,
+      g__r_crc32c_tbl, R_CRC32C_POLYNOMIAL_REV);
+
+  for (i = 0; i < 256; i++) {
+    ruint32 crc = i << 24;
+    for (k = 0; k < 8; k++)
+      crc = (crc & 0x80000000) ? (crc << 1) ^ R_CRC32_POLYNOMIAL : crc << 1;
+    g__r_crc32bzip2_slice[0][i] = crc;
+  }
+  for (i = 0; i < 256; i++) {
+    for (k = 1; k < 8; k++) {
+      ruint32 prev = g__r_crc32bzip2_slice[k - 1][i];
+      g__r_crc32bzip2_slice[k][i] = (prev << 8) ^ g__r_crc32bzip2_slice[0][prev >> 24];
+    }
+  }
+}
+
+/* The functions below work on the raw register, no inversion */
+static ruint32
+r_crc_bytewise (const ruint32 * tbl, ruint32 crc, const ruint8 * ptr, rsize size)
+{
   while (size--)
-    crc = (g__r_crc32_tbl[(crc ^ *ptr++) & 0xff]) ^ (crc >> 8);
-  return ~crc;
+    crc = tbl[(crc ^ *ptr++) & 0xff] ^ (crc >> 8);
+  return crc;
+}
+
+static ruint32
+r_crc_slice8 (const ruint32 (*t)[256], ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  for (; size >= 8; size -= 8, ptr += 8) {
+    crc ^= (ruint32)ptr[0] | ((ruint32)ptr[1] << 8) |
+      ((ruint32)ptr[2] << 16) | ((ruint32)ptr[3] << 24);
+    crc = t[7][crc & 0xff] ^ t[6][(crc >> 8) & 0xff] ^
+      t[5][(crc >> 16) & 0xff] ^ t[4][crc >> 24] ^
+      t[3][ptr[4]] ^ t[2][ptr[5]] ^ t[1][ptr[6]] ^ t[0][ptr[7]];
+  }
+
+  return r_crc_bytewise (t[0], crc, ptr, size);
+}
+
+static ruint32
+r_crc_slice16 (const ruint32 (*t)[256], ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  for (; size >= 16; size -= 16, ptr += 16) {
+    crc ^= (ruint32)ptr[0] | ((ruint32)ptr[1] << 8) |
+      ((ruint32)ptr[2] << 16) | ((ruint32)ptr[3] << 24);
+    crc = t[15][crc & 0xff] ^ t[14][(crc >> 8) & 0xff] ^
+      t[13][(crc >> 16) & 0xff] ^ t[12][crc >> 24] ^
+      t[11][ptr[4]] ^ t[10][ptr[5]] ^ t[9][ptr[6]] ^ t[8][ptr[7]] ^
+      t[7][ptr[8]] ^ t[6][ptr[9]] ^ t[5][ptr[10]] ^ t[4][ptr[11]] ^
+      t[3][ptr[12]] ^ t[2][ptr[13]] ^ t[1][ptr[14]] ^ t[0][ptr[15]];
+  }
+
+  return r_crc_slice8 (t, crc, ptr, size);
+}
+
+#if defined (HAVE_X86_CRC)
+typedef rsize (*RCrcFold) (ruint32 crc, const ruint8 * data, rsize size, ruint8 * out);
+
+static ruint32
+r_crc_pclmul (RCrcFold fold, const ruint32 (*t)[256],
+    ruint32 crc, const ruint8 * ptr, rsize size)
+{
+  if (size >= R_CRC_X86_FOLD_MIN) {
+    ruint8 folded[16];
+    rsize done = fold (crc, ptr, size, folded);
+
+    crc = r_crc_slice16 (t, 0, folded, sizeof (folded));
+    ptr += done;
+    size -= done;
+  }
+
+  return r_crc_slice16 (t, crc, ptr, size);
+}
+#endif
+
+static RCrcImpl
+r_crc32_auto_impl (rsize size)
+{
+  if (size >= R_CRC_X86_FOLD_MIN && r_crc_x86_pclmul_available ())
+    return R_CRC_IMPL_PCLMUL;
+  return R_CRC_IMPL_SLICE16;
+}
+
+static RCrcImpl
+r_crc32c_auto_impl (rsize size)
+{
+  if (r_crc_x86_sse42_available ()) {
+    if (size >= R_CRC32C_FOLD_MIN && r_crc_x86_pclmul_available ())
+      return R_CRC_IMPL_PCLMUL;
+    return R_CRC_IMPL_SSE42;
+  }
+
+  return r_crc32_auto_impl (size);
+}
+
+rboolean
+r_crc32_impl_available (RCrcImpl impl)
+{
+  switch (impl) {
+    case R_CRC_IMPL_AUTO:
+    case R_CRC_IMPL_BYTEWISE:
+    case R_CRC_IMPL_SLICE8:
+    case R_CRC_IMPL_SLICE16:
+      return TRUE;
+    case R_CRC_IMPL_PCLMUL:
+      return r_crc_x86_pclmul_available ();
+    default:
+      return FALSE;
+  }
+}
+
+rboolean
+r_crc32c_impl_available (RCrcImpl impl)
+{
+  if (impl == R_CRC_IMPL_SSE42)
+    return r_crc_x86_sse42_available ();
+  return r_crc32_impl_available (impl);
 }
 
 ruint32
-r_crc32c_update (ruint32 crc, rconstpointer buffer, rsize size)
+r_crc32_update_with_impl (RCrcImpl impl, ruint32 crc, rconstpointer buffer, rsize size)
 {
-  const ruint8 * ptr = buffer;
+  if (impl == R_CRC_IMPL_AUTO || !r_crc32_impl_available (impl))
+    impl = r_crc32_auto_impl (size);
 
-  crc = ~crc;
-  while (size--)
-    crc = (g__r_crc32c_tbl[(crc ^ *ptr++) & 0xff]) ^ (crc >> 8);
-  return ~crc;
+  switch (impl) {
+    case R_CRC_IMPL_BYTEWISE:
+      return ~r_crc_bytewise (g__r_crc32_tbl, ~crc, buffer, size);
+    case R_CRC_IMPL_SLICE8:
+      return ~r_crc_slice8 (g__r_crc32_slice, ~crc, buffer, size);
+#if defined (HAVE_X86_CRC)
+    case R_CRC_IMPL_PCLMUL:
+      return ~r_crc_pclmul (r_crc32_x86_fold, g__r_crc32_slice, ~crc, buffer, size);
+#endif
+    default:
+      return ~r_crc_slice16 (g__r_crc32_slice, ~crc, buffer, size);
+  }
+}
+
+ruint32
+r_crc32c_update_with_impl (RCrcImpl impl, ruint32 crc, rconstpointer buffer, rsize size)
+{
+  if (impl == R_CRC_IMPL_AUTO || !r_crc32c_impl_available (impl))
+    impl = r_crc32c_auto_impl (size);
+
+  switch (impl) {
+    case R_CRC_IMPL_BYTEWISE:
+      return ~r_crc_bytewise (g__r_crc32c_tbl, ~crc, buffer, size);
+    case R_CRC_IMPL_SLICE8:
+      return ~r_crc_slice8 (g__r_crc32c_slice, ~crc, buffer, size);
+#if defined (HAVE_X86_CRC)
+    case R_CRC_IMPL_SSE42:
+      return ~r_crc32c_x86_sse42 (~crc, buffer, size);
+    case R_CRC_IMPL_PCLMUL:
+      return ~r_crc_pclmul (r_crc32c_x86_fold, g__r_crc32c_slice, ~crc, buffer, size);
+#endif
+    default:
+      return ~r_crc_slice16 (g__r_crc32c_slice, ~crc, buffer, size);
+  }
+}
+
+ruint32
+r_crc32_update (ruint32 crc, rconstpointer buffer, rsize size)
+{
+  return r_crc32_update_with_impl (R_CRC_IMPL_AUTO, crc, buffer, size);
+}
+
+ruint32
+r_crc32c_update (ruint32 crc, rconstpointer buffer, rsize size)
+{
+  return r_crc32c_update_with_impl (R_CRC_IMPL_AUTO, crc, buffer, size);
 }
 
 ruint32
 r_crc32bzip2_update (ruint32 crc, rconstpointer buffer, rsize size)
 {
+  const ruint32 (*t)[256] = g__r_crc32bzip2_slice;
   const ruint8 * ptr = buffer;
 
   crc = ~crc;
-  while (size--) {
-    int n;
-    ruint8 cur = *ptr++;
-    for (n = 0; n < 8; n++) {
-      if ((cur >> 7) ^ (crc >> 31))
-        crc = (crc << 1) ^ R_CRC32_POLYNOMIAL;
-      else
-        crc <<= 1;
-      cur <<= 1;
-    }
+  for (; size >= 8; size -= 8, ptr += 8) {
+    crc ^= ((ruint32)ptr[0] << 24) | ((ruint32)ptr[1] << 16) |
+      ((ruint32)ptr[2] << 8) | (ruint32)ptr[3];
+    crc = t[7][crc >> 24] ^ t[6][(crc >> 16) & 0xff] ^
+      t[5][(crc >> 8) & 0xff] ^ t[4][crc & 0xff] ^
+      t[3][ptr[4]] ^ t[2][ptr[5]] ^ t[1][ptr[6]] ^ t[0][ptr[7]];
   }
+  while (size--)
+    crc = (crc << 8) ^ t[0][(crc >> 24) ^ *ptr++];
 
   return ~crc;
 }
 
+/* crc1 * x^(8 * size2) + crc2, the inversions cancel out */
+static ruint32
+r_crc_combine (ruint32 poly, const ruint32 * x2n,
+    ruint32 crc1, ruint32 crc2, rsize size2)
+{
+  ruint32 p = 1u << 31;
+  ruint k = 3;
+
+  for (; size2 > 0; size2 >>= 1, k++) {
+    if (size2 & 1)
+      p = r_crc_multmodp (poly, x2n[k], p);
+  }
+
+  return r_crc_multmodp (poly, p, crc1) ^ crc2;
+}
+
+ruint32
+r_crc32_combine (ruint32 crc1, ruint32 crc2, rsize size2)
+{
+  return r_crc_combine (R_CRC32_POLYNOMIAL_REV, g__r_crc32_x2n, crc1, crc2, size2);
+}
+
+ruint32
+r_crc32c_combine (ruint32 crc1, ruint32 crc2, rsize size2)
+{
+  return r_crc_combine (R_CRC32C_POLYNOMIAL_REV, g__r_crc32c_x2n, crc1, crc2, size2);
+}
@@ -22,6 +22,10 @@
 
 #include <rlib/rio.h>
 
+#if defined (R_OS_LINUX) && defined (HAVE_POSIX_SOCKETS)
+#include <linux/filter.h>
+#endif
+
 static inline RSocketStatus
 r_socket_err_to_socket_status (int err)
 {
@@ -205,6 +209,18 @@ r_io_get_socket_reuseaddr (RIOHandle handle, rboolean * reuse)
   return r_io_get_socket_option_bool (handle, SOL_SOCKET, SO_REUSEADDR, reuse);
 }
 
+RSocketStatus
+r_io_get_socket_reuseport (RIOHandle handle, rboolean * reuse)
+{
+#ifdef SO_REUSEPORT
+  return r_io_get_socket_option_bool (handle, SOL_SOCKET, SO_REUSEPORT, reuse);
+#else
+  (void) handle;
+  (void) reuse;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
 RSocketStatus
 r_io_set_socket_broadcast (RIOHandle handle, rboolean broadcast)
 {
@@ -223,6 +239,64 @@ r_io_set_socket_reuseaddr (RIOHandle handle, rboolean reuse)
   return r_io_set_socket_option (handle, SOL_SOCKET, SO_REUSEADDR, reuse);
 }
 
+RSocketStatus
+r_io_set_socket_reuseport (RIOHandle handle, rboolean reuse)
+{
+#ifdef SO_REUSEPORT
+  return r_io_set_socket_option (handle, SOL_SOCKET, SO_REUSEPORT, reuse);
+#else
+  (void) handle;
+  (void) reuse;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
+RSocketStatus
+r_io_set_socket_incoming_cpu (RIOHandle handle, int cpu)
+{
+#ifdef SO_INCOMING_CPU
+  return r_io_set_socket_option (handle, SOL_SOCKET, SO_INCOMING_CPU, cpu);
+#else
+  (void) handle;
+  (void) cpu;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
+RSocketStatus
+r_io_set_socket_reuseport_cpus (RIOHandle handle, const ruint * cpus, ruint count)
+{
+#if defined (SO_ATTACH_REUSEPORT_CBPF) && defined (SKF_AD_CPU)
+  struct sock_filter * code;
+  struct sock_fprog prog;
+  ruint i;
+
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (cpus == NULL || count == 0 || count > 1024)) return R_SOCKET_INVAL;
+
+  /* A = cpu; if (A == cpus[i]) return i; ...; return count (kernel hashes) */
+  code = r_alloca ((2 * count + 2) * sizeof (struct sock_filter));
+  code[0] = (struct sock_filter) BPF_STMT (BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_CPU);
+  for (i = 0; i < count; i++) {
+    code[2 * i + 1] = (struct sock_filter) BPF_JUMP (BPF_JMP | BPF_JEQ | BPF_K, cpus[i], 0, 1);
+    code[2 * i + 2] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K, i);
+  }
+  code[2 * count + 1] = (struct sock_filter) BPF_STMT (BPF_RET | BPF_K, count);
+
+  prog.len = (unsigned short)(2 * count + 2);
+  prog.filter = code;
+  if (setsockopt (handle, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof (prog)) == 0)
+    return R_SOCKET_OK;
+
+  return r_socket_errno_to_socket_status ();
+#else
+  (void) handle;
+  (void) cpus;
+  (void) count;
+  return R_SOCKET_NOT_SUPPORTED;
+#endif
+}
+
 RSocketStatus
 r_io_socket_close (RIOHandle handle)
 {
@@ -739,6 +813,251 @@ r_io_socket_send_message (RIOHandle handle, const RSocketAddress * address,
 #endif
 }
 
+#if defined (HAVE_POSIX_SOCKETS) && (defined (HAVE_RECVMMSG) || defined (HAVE_SENDMMSG))
+static rsize
+r_io_socket_map_buffer (RBuffer * buffer, struct iovec * iov,
+    RMemMapInfo * info, RMemMapFlags flags)
+{
+  rsize i, mem_count = r_buffer_mem_count (buffer);
+
+  for (i = 0; i < mem_count; i++) {
+    RMem * mem = r_buffer_mem_peek (buffer, i);
+    if (r_mem_map (mem, &info[i], flags)) {
+      iov[i].iov_base = info[i].data;
+      iov[i].iov_len = info[i].size;
+    } else {
+      /* WARNING */
+      iov[i].iov_base = "";
+      iov[i].iov_len = 0;
+    }
+    r_mem_unref (mem);
+  }
+
+  return mem_count;
+}
+
+/* Unmap all mems in buffer, and if resize trim the buffer down to b bytes */
+static void
+r_io_socket_unmap_buffer (RBuffer * buffer, RMemMapInfo * info,
+    rsize b, rboolean resize)
+{
+  rsize i, mem_count = r_buffer_mem_count (buffer);
+
+  for (i = 0; i < mem_count; i++) {
+    RMem * mem = r_buffer_mem_peek (buffer, i);
+    r_mem_unmap (mem, &info[i]);
+
+    if (resize) {
+      if (b >= mem->size) {
+        b -= mem->size;
+      } else {
+        r_mem_resize (mem, mem->offset, b);
+        b = 0;
+      }
+    }
+    r_mem_unref (mem);
+  }
+}
+
+static rsize
+r_io_socket_buffers_mem_count (RBuffer ** buffers, ruint count)
+{
+  rsize ret = 0;
+  ruint i;
+
+  for (i = 0; i < count; i++)
+    ret += r_buffer_mem_count (buffers[i]);
+
+  return ret;
+}
+#endif
+
+RSocketStatus
+r_io_socket_receive_messages (RIOHandle handle, RSocketAddress ** addresses,
+    RBuffer ** buffers, rsize * received, ruint count, ruint * msgs)
+{
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_RECVMMSG)
+  struct mmsghdr * hdrs;
+  struct iovec * iov;
+  RMemMapInfo * info;
+  rsize mapped;
+  ruint i;
+  int res;
+
+  if (msgs != NULL)
+    *msgs = 0;
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (buffers == NULL)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (count == 0)) return R_SOCKET_INVAL;
+
+  count = MIN (count, R_SOCKET_MAX_MESSAGES);
+  mapped = r_io_socket_buffers_mem_count (buffers, count);
+  hdrs = r_alloca (count * sizeof (struct mmsghdr));
+  iov = r_alloca (mapped * sizeof (struct iovec));
+  info = r_alloca (mapped * sizeof (RMemMapInfo));
+
+  for (i = 0, mapped = 0; i < count; i++) {
+    struct msghdr * msg = &hdrs[i].msg_hdr;
+
+    msg->msg_iov = &iov[mapped];
+    msg->msg_iovlen = r_io_socket_map_buffer (buffers[i],
+        msg->msg_iov, &info[mapped], R_MEM_MAP_WRITE);
+    mapped += msg->msg_iovlen;
+    msg->msg_control = NULL;
+    msg->msg_controllen = 0;
+    msg->msg_flags = 0;
+    if (addresses != NULL && addresses[i] != NULL) {
+      msg->msg_name = &addresses[i]->addr;
+      msg->msg_namelen = addresses[i]->addrlen;
+    } else {
+      msg->msg_name = NULL;
+      msg->msg_namelen = 0;
+    }
+    hdrs[i].msg_len = 0;
+  }
+
+  do {
+#ifdef MSG_WAITFORONE
+    res = recvmmsg (handle, hdrs, count, MSG_WAITFORONE, NULL);
+#else
+    res = recvmmsg (handle, hdrs, count, 0, NULL);
+#endif
+  } while (res < 0 && R_SOCKET_ERRNO == EINTR);
+
+  for (i = 0, mapped = 0; i < count; i++) {
+    r_io_socket_unmap_buffer (buffers[i], &info[mapped],
+        hdrs[i].msg_len, (int)i < res);
+    mapped += hdrs[i].msg_hdr.msg_iovlen;
+
+    if ((int)i < res) {
+      if (addresses != NULL && addresses[i] != NULL)
+        addresses[i]->addrlen = hdrs[i].msg_hdr.msg_namelen;
+      if (received != NULL)
+        received[i] = hdrs[i].msg_len;
+    }
+  }
+
+  if (res > 0) {
+    if (msgs != NULL)
+      *msgs = (ruint)res;
+    return R_SOCKET_OK;
+  }
+
+  return res == 0 ? R_SOCKET_WOULD_BLOCK : r_socket_errno_to_socket_status ();
+#else
+  RSocketStatus ret = R_SOCKET_INVAL;
+  ruint i;
+
+  if (msgs != NULL)
+    *msgs = 0;
+  if (R_UNLIKELY (buffers == NULL)) return R_SOCKET_INVAL;
+
+  for (i = 0; i < count; i++) {
+    ret = r_io_socket_receive_message (handle,
+        addresses != NULL ? addresses[i] : NULL, buffers[i],
+        received != NULL ? &received[i] : NULL);
+    if (ret != R_SOCKET_OK)
+      break;
+  }
+
+  if (i > 0) {
+    if (msgs != NULL)
+      *msgs = i;
+    return R_SOCKET_OK;
+  }
+
+  return ret;
+#endif
+}
+
+RSocketStatus
+r_io_socket_send_messages (RIOHandle handle, RSocketAddress * const * addresses,
+    RBuffer ** buffers, rsize * sent, ruint count, ruint * msgs)
+{
+#if defined (HAVE_POSIX_SOCKETS) && defined (HAVE_SENDMMSG)
+  struct mmsghdr * hdrs;
+  struct iovec * iov;
+  RMemMapInfo * info;
+  rsize mapped;
+  ruint i;
+  int res;
+
+  if (msgs != NULL)
+    *msgs = 0;
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (buffers == NULL)) return R_SOCKET_INVAL;
+  if (R_UNLIKELY (count == 0)) return R_SOCKET_INVAL;
+
+  count = MIN (count, R_SOCKET_MAX_MESSAGES);
+  mapped = r_io_socket_buffers_mem_count (buffers, count);
+  hdrs = r_alloca (count * sizeof (struct mmsghdr));
+  iov = r_alloca (mapped * sizeof (struct iovec));
+  info = r_alloca (mapped * sizeof (RMemMapInfo));
+
+  for (i = 0, mapped = 0; i < count; i++) {
+    struct msghdr * msg = &hdrs[i].msg_hdr;
+
+    msg->msg_iov = &iov[mapped];
+    msg->msg_iovlen = r_io_socket_map_buffer (buffers[i],
+        msg->msg_iov, &info[mapped], R_MEM_MAP_READ);
+    mapped += msg->msg_iovlen;
+    msg->msg_control = NULL;
+    msg->msg_controllen = 0;
+    msg->msg_flags = 0;
+    if (addresses != NULL && addresses[i] != NULL) {
+      msg->msg_name = (rpointer)&addresses[i]->addr;
+      msg->msg_namelen = addresses[i]->addrlen;
+    } else {
+      msg->msg_name = NULL;
+      msg->msg_namelen = 0;
+    }
+    hdrs[i].msg_len = 0;
+  }
+
+  do {
+    res = sendmmsg (handle, hdrs, count, 0);
+  } while (res < 0 && R_SOCKET_ERRNO == EINTR);
+
+  for (i = 0, mapped = 0; i < count; i++) {
+    r_io_socket_unmap_buffer (buffers[i], &info[mapped], 0, FALSE);
+    mapped += hdrs[i].msg_hdr.msg_iovlen;
+    if ((int)i < res && sent != NULL)
+      sent[i] = hdrs[i].msg_len;
+  }
+
+  if (res > 0) {
+    if (msgs != NULL)
+      *msgs = (ruint)res;
+    return R_SOCKET_OK;
+  }
+
+  return res == 0 ? R_SOCKET_WOULD_BLOCK : r_socket_errno_to_socket_status ();
+#else
+  RSocketStatus ret = R_SOCKET_INVAL;
+  ruint i;
+
+  if (msgs != NULL)
+    *msgs = 0;
+  if (R_UNLIKELY (buffers == NULL)) return R_SOCKET_INVAL;
+
+  for (i = 0; i < count; i++) {
+    ret = r_io_socket_send_message (handle,
+        addresses != NULL ? addresses[i] : NULL, buffers[i],
+        sent != NULL ? &sent[i] : NULL);
+    if (ret != R_SOCKET_OK)
+      break;
+  }
+
+  if (i > 0) {
+    if (msgs != NULL)
+      *msgs = i;
+    return R_SOCKET_OK;
+  }
+
+  return ret;
+#endif
+}
+
 RSocketStatus
 r_io_get_socket_ipv4_multicast_loop (RIOHandle handle, rboolean * mloop)
 {
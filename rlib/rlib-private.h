@@ -28,6 +28,8 @@
 R_API_HIDDEN void r_ref__init (void);
 R_API_HIDDEN void r_ref__deinit (void);
 
+R_API_HIDDEN void r_crc_init (void);
+
 R_API_HIDDEN void r_ev_loop_init (void);
 R_API_HIDDEN void r_ev_loop_deinit (void);
 
@@ -35,6 +35,7 @@ R_INITIALIZER (rlib_init)
     r_log_category_set_threshold (&rlib_logcat, R_LOG_LEVEL_WARNING);
 
   r_ref__init ();
+  r_crc_init ();
   r_ev_loop_init ();
   r_http_server_init ();
   r_mem_allocator_init ();
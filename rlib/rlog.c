@@ -24,12 +24,22 @@
 #include <rlib/os/rproc.h>
 
 #include <rlib/renv.h>
+#include <rlib/rio.h>
 #include <rlib/rmem.h>
 #include <rlib/rstr.h>
 #include <rlib/rthreads.h>
 #include <rlib/rtime.h>
 #include <rlib/rtty.h>
 
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#else
+struct iovec {
+  rpointer iov_base;
+  rsize iov_len;
+};
+#endif
+#include <errno.h>
 
 rauint _r_log_level_min = R_LOG_LEVEL_DEFAULT;
 R_LOG_CATEGORY_DEFINE (_r_log_cat_assert, "assert", "Assertions logger",
@@ -44,6 +54,13 @@ static RClockTime g__r_log_ts_start = R_CLOCK_TIME_NONE;
 static RSList * g__r_log_cats = NULL;
 static FILE * g__r_log_file = NULL;
 static rchar ** g__r_log_dbg_strv = NULL;
+static RLogAsync * g__r_log_async = NULL;
+
+/* Async logging thread rings, see below. The mutex protects the ring lists,
+ * the writer thread state and is used with the RLogAsync conditions. */
+static RTss g__r_log_async_tss;
+static RMutex g__r_log_async_mutex;
+static void r_log_async_thread_release (rpointer lst);
 
 
 /*
@@ -104,6 +121,18 @@ r_log_init (void)
   if (r_getenv ("R_DEBUG_NO_COLOR") != NULL)
     g__r_log_color = FALSE;
 
+  r_mutex_init (&g__r_log_async_mutex);
+#ifdef R_OS_UNIX
+  if ((env = r_getenv ("R_DEBUG_ASYNC")) != NULL) {
+    RLogAsyncPolicy policy = r_str_equals (env, "block") ?
+      R_LOG_ASYNC_BLOCK : R_LOG_ASYNC_DROP;
+
+    if ((g__r_log_async = r_log_async_new (r_fileno (file != NULL ? file : stderr),
+            R_LOG_ASYNC_RING_SIZE_DEFAULT, policy)) != NULL)
+      r_log_override_default_handler (r_log_async_handler, g__r_log_async, NULL);
+  }
+#endif
+
   if ((env = r_getenv ("R_DEBUG")) != NULL)
     r_strv_foreach ((g__r_log_dbg_strv = r_strsplit (env, ",", RSIZE_MAX)),
         r_log_set_initial_default_level, NULL);
@@ -119,6 +148,15 @@ r_log_init (void)
 void
 r_log_deinit (void)
 {
+  if (g__r_log_async != NULL) {
+    r_log_override_default_handler (r_log_default_handler, NULL, NULL);
+    r_log_async_free (g__r_log_async);
+    g__r_log_async = NULL;
+  }
+  r_log_async_thread_release (r_tss_get (&g__r_log_async_tss));
+  r_tss_set (&g__r_log_async_tss, NULL);
+  r_mutex_clear (&g__r_log_async_mutex);
+
   r_slist_destroy (g__r_log_cats);
   g__r_log_cats = NULL;
   r_strv_free (g__r_log_dbg_strv);
@@ -419,6 +457,492 @@ r_log_default_handler (RLogCategory * cat, RLogLevel lvl,
   fflush (f);
 }
 
+static int
+r_log_format_line (rchar * buf, rsize size, rboolean color, int pid,
+    RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func, const rchar * msg)
+{
+  RClockTime elapsed = r_time_get_ts_monotonic () - g__r_log_ts_start;
+
+#ifdef R_OS_UNIX
+  if (color) {
+    rchar clr[R_TTY_MAX_CC];
+    r_tty_clr_to_str (cat->clr, clr);
+
+    return r_snprintf (buf, size,
+        CLK_FMT" "PID_FMT" "THR_FMT" %s"LVL_FMT" %s"CAT_FMT R_TTY_SGR_RESET" "MSG_FMT"\n",
+        R_TIME_ARGS (elapsed), pid, r_thread_current (),
+        r_log_level_get_term_clr_code (lvl), r_log_level_get_name (lvl),
+        clr, cat->name, file, line, func,
+        msg);
+  }
+#else
+  (void) color;
+#endif
+
+  return r_snprintf (buf, size,
+      CLK_FMT" "PID_FMT" "THR_FMT" "LVL_FMT" "CAT_FMT" "MSG_FMT"\n",
+      R_TIME_ARGS (elapsed), pid, r_thread_current (),
+      r_log_level_get_name (lvl),
+      cat->name, file, line, func, msg);
+}
+
+
+/******************************************************************************/
+/* RLogAsync - Per-thread rings drained by a writer thread                    */
+/******************************************************************************/
+#define R_LOG_ASYNC_RING_SIZE_MIN   256
+#define R_LOG_ASYNC_RING_SIZE_MAX   (1U << 30)
+#define R_LOG_ASYNC_LINE_SIZE       512
+#define R_LOG_ASYNC_IOV_MAX         64
+
+typedef struct _RLogAsyncRing RLogAsyncRing;
+
+/* Byte ring of complete log lines with the owning thread as the only
+ * producer and the writer thread as the only consumer. Linked into the
+ * owning thread's list (tnext) and the RLogAsync's list (next). async is set
+ * to NULL when the RLogAsync goes away and the ring is then freed by the
+ * thread, closed is set when the thread exits and the ring is then freed by
+ * the writer once drained. The links, async and closed are protected by
+ * g__r_log_async_mutex, head and tail are not. */
+struct _RLogAsyncRing {
+  RLogAsync * async;
+  RLogAsyncRing * tnext;
+  RLogAsyncRing * next;
+  rboolean closed;
+  ruint size;
+  ruint8 * data;
+
+  rauint head;
+  ruint8 pad[64];
+  rauint tail;
+  ruint headcache;
+};
+
+struct _RLogAsync {
+  int pid;
+  RIOHandle handle;
+  RLogAsyncPolicy policy;
+  rboolean color;
+  ruint ringsize;
+
+  RThread * thread;
+  rboolean running;
+  rauint sleeping;
+  rauint dropped;
+  RCond wakecond;
+  RCond spacecond;
+
+  RLogAsyncRing * rings;
+};
+
+static RTss g__r_log_async_tss = R_TSS_INIT (r_log_async_thread_release);
+
+static void
+r_log_async_thread_release (rpointer data)
+{
+  RLogAsyncRing * ring, * next;
+
+  r_mutex_lock (&g__r_log_async_mutex);
+  for (ring = data; ring != NULL; ring = next) {
+    next = ring->tnext;
+    if (ring->async != NULL)
+      ring->closed = TRUE;
+    else
+      r_free (ring);
+  }
+  r_mutex_unlock (&g__r_log_async_mutex);
+}
+
+static RLogAsyncRing *
+r_log_async_ring_get (RLogAsync * async)
+{
+  RLogAsyncRing * head, * ring, ** prev;
+
+  head = r_tss_get (&g__r_log_async_tss);
+  if (R_LIKELY (head != NULL && head->async == async))
+    return head;
+
+  r_mutex_lock (&g__r_log_async_mutex);
+  for (prev = &head; (ring = *prev) != NULL; ) {
+    if (ring->async == async) {
+      /* Move to front, so the next lookup is fast */
+      *prev = ring->tnext;
+      break;
+    } else if (ring->async == NULL) {
+      *prev = ring->tnext;
+      r_free (ring);
+    } else {
+      prev = &ring->tnext;
+    }
+  }
+
+  if (ring == NULL &&
+      (ring = r_malloc (sizeof (RLogAsyncRing) + async->ringsize)) != NULL) {
+    r_memset (ring, 0, sizeof (RLogAsyncRing));
+    ring->async = async;
+    ring->size = async->ringsize;
+    ring->data = (ruint8 *)(ring + 1);
+    ring->next = async->rings;
+    async->rings = ring;
+  }
+  r_mutex_unlock (&g__r_log_async_mutex);
+
+  if (ring != NULL) {
+    ring->tnext = head;
+    head = ring;
+  }
+  r_tss_set (&g__r_log_async_tss, head);
+
+  return ring;
+}
+
+static rboolean
+r_log_async_ring_push (RLogAsyncRing * ring, const rchar * str, ruint size)
+{
+  ruint tail = r_atomic_uint_load (&ring->tail), off;
+
+  if (ring->size - (tail - ring->headcache) < size) {
+    ring->headcache = r_atomic_uint_load (&ring->head);
+    if (ring->size - (tail - ring->headcache) < size)
+      return FALSE;
+  }
+
+  off = tail & (ring->size - 1);
+  if (off + size <= ring->size) {
+    r_memcpy (ring->data + off, str, size);
+  } else {
+    ruint n = ring->size - off;
+    r_memcpy (ring->data + off, str, n);
+    r_memcpy (ring->data, str + n, size - n);
+  }
+  r_atomic_uint_store (&ring->tail, tail + size);
+
+  return TRUE;
+}
+
+static rboolean
+r_log_async_pending (RLogAsync * async)
+{
+  RLogAsyncRing * ring;
+
+  for (ring = async->rings; ring != NULL; ring = ring->next) {
+    if (r_atomic_uint_load (&ring->head) != r_atomic_uint_load (&ring->tail))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+/* Must be called with g__r_log_async_mutex held */
+static void
+r_log_async_wake_writer (RLogAsync * async)
+{
+  r_atomic_uint_store (&async->sleeping, FALSE);
+  r_cond_signal (&async->wakecond);
+}
+
+static rboolean
+r_log_async_wait_for_space (RLogAsync * async, RLogAsyncRing * ring, ruint size)
+{
+  rboolean ret;
+
+  r_mutex_lock (&g__r_log_async_mutex);
+  while ((ret = async->running) && ring->size <
+      r_atomic_uint_load (&ring->tail) - r_atomic_uint_load (&ring->head) + size) {
+    r_log_async_wake_writer (async);
+    r_cond_wait (&async->spacecond, &g__r_log_async_mutex);
+  }
+  r_mutex_unlock (&g__r_log_async_mutex);
+
+  return ret;
+}
+
+/* Collects the pending lines of up to R_LOG_ASYNC_IOV_MAX / 2 rings starting
+ * at cursor, which is advanced past them. Rings of exited threads are
+ * unlinked and freed once drained.
+ * Must be called with g__r_log_async_mutex held. */
+static ruint
+r_log_async_collect (RLogAsyncRing *** cursor, struct iovec * iov, ruint * niov,
+    RLogAsyncRing ** rings, ruint * tails)
+{
+  RLogAsyncRing * ring;
+  ruint n = 0, v = 0;
+
+  while (n < R_LOG_ASYNC_IOV_MAX / 2 && (ring = **cursor) != NULL) {
+    ruint head = r_atomic_uint_load (&ring->head);
+    ruint tail = r_atomic_uint_load (&ring->tail);
+
+    if (head != tail) {
+      ruint off = head & (ring->size - 1), size = tail - head;
+
+      iov[v].iov_base = ring->data + off;
+      iov[v].iov_len = MIN (size, ring->size - off);
+      if (iov[v].iov_len < size) {
+        iov[v + 1].iov_base = ring->data;
+        iov[v + 1].iov_len = size - iov[v].iov_len;
+        v++;
+      }
+      v++;
+      rings[n] = ring;
+      tails[n++] = tail;
+    } else if (ring->closed) {
+      **cursor = ring->next;
+      r_free (ring);
+      continue;
+    }
+
+    *cursor = &ring->next;
+  }
+
+  *niov = v;
+  return n;
+}
+
+static void
+r_log_async_write (RIOHandle handle, struct iovec * iov, ruint n)
+{
+#ifdef HAVE_WRITEV
+  while (n > 0) {
+    rssize res;
+
+    if ((res = writev (handle, iov, (int)n)) < 0) {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    for (; n > 0 && (rsize)res >= iov->iov_len; iov++, n--)
+      res -= iov->iov_len;
+    if (n > 0) {
+      iov->iov_base = (ruint8 *)iov->iov_base + res;
+      iov->iov_len -= res;
+    }
+  }
+#else
+  for (; n > 0; iov++, n--) {
+    const ruint8 * p = iov->iov_base;
+    rsize size = iov->iov_len;
+    rssize res;
+
+    for (; size > 0; p += res, size -= res) {
+      if ((res = r_io_write (handle, p, size)) <= 0)
+        return;
+    }
+  }
+#endif
+}
+
+static rpointer
+r_log_async_writer (rpointer data)
+{
+  RLogAsync * async = data;
+  struct iovec iov[R_LOG_ASYNC_IOV_MAX];
+  RLogAsyncRing * rings[R_LOG_ASYNC_IOV_MAX / 2];
+  ruint tails[R_LOG_ASYNC_IOV_MAX / 2];
+  RLogAsyncRing ** cursor;
+
+  r_mutex_lock (&g__r_log_async_mutex);
+  for (;;) {
+    rboolean written = FALSE;
+
+    /* One pass over all rings, in batches of rings per writev() */
+    for (cursor = &async->rings; *cursor != NULL; ) {
+      ruint i, n, niov;
+
+      if ((n = r_log_async_collect (&cursor, iov, &niov, rings, tails)) == 0)
+        continue;
+
+      r_mutex_unlock (&g__r_log_async_mutex);
+      r_log_async_write (async->handle, iov, niov);
+      for (i = 0; i < n; i++)
+        r_atomic_uint_store (&rings[i]->head, tails[i]);
+      r_mutex_lock (&g__r_log_async_mutex);
+
+      r_cond_broadcast (&async->spacecond);
+      written = TRUE;
+    }
+
+    if (written)
+      continue;
+    if (!async->running)
+      break;
+
+    /* Producers check sleeping after publishing, so either they see it or
+     * r_log_async_pending() sees their lines */
+    r_atomic_uint_store (&async->sleeping, TRUE);
+    if (!r_log_async_pending (async)) {
+      while (r_atomic_uint_load (&async->sleeping) && async->running)
+        r_cond_wait (&async->wakecond, &g__r_log_async_mutex);
+    }
+    r_atomic_uint_store (&async->sleeping, FALSE);
+  }
+  r_cond_broadcast (&async->spacecond);
+  r_mutex_unlock (&g__r_log_async_mutex);
+
+  return NULL;
+}
+
+RLogAsync *
+r_log_async_new (RIOHandle handle, rsize ringsize, RLogAsyncPolicy policy)
+{
+#ifdef RLIB_HAVE_THREADS
+  RLogAsync * ret;
+
+  if (R_UNLIKELY (handle == R_IO_HANDLE_INVALID))
+    return NULL;
+
+  if (ringsize == 0)
+    ringsize = R_LOG_ASYNC_RING_SIZE_DEFAULT;
+  ringsize = CLAMP (ringsize, R_LOG_ASYNC_RING_SIZE_MIN, R_LOG_ASYNC_RING_SIZE_MAX);
+
+  if ((ret = r_mem_new0 (RLogAsync)) != NULL) {
+    ret->pid = r_proc_get_id ();
+    ret->handle = handle;
+    ret->policy = policy;
+    /* Round up to power of two, for masking */
+    ret->ringsize = 1U << (32 - RUINT32_CLZ ((ruint32)ringsize - 1));
+#ifdef R_OS_UNIX
+    ret->color = g__r_log_color && r_isatty (handle);
+#endif
+    ret->running = TRUE;
+    r_cond_init (&ret->wakecond);
+    r_cond_init (&ret->spacecond);
+
+    if ((ret->thread = r_thread_new ("rlog-async", r_log_async_writer, ret)) == NULL) {
+      r_cond_clear (&ret->wakecond);
+      r_cond_clear (&ret->spacecond);
+      r_free (ret);
+      ret = NULL;
+    }
+  }
+
+  return ret;
+#else
+  (void) handle;
+  (void) ringsize;
+  (void) policy;
+  return NULL;
+#endif
+}
+
+void
+r_log_async_free (RLogAsync * async)
+{
+  RLogAsyncRing * ring, * next;
+
+  if (R_UNLIKELY (async == NULL))
+    return;
+  /* In a forked child the writer thread and the other threads only exist in
+   * the parent process, leave everything as is */
+  if (R_UNLIKELY (async->pid != r_proc_get_id ()))
+    return;
+
+  /* The writer drains all rings before exiting */
+  r_mutex_lock (&g__r_log_async_mutex);
+  async->running = FALSE;
+  r_log_async_wake_writer (async);
+  r_mutex_unlock (&g__r_log_async_mutex);
+  r_thread_join (async->thread);
+  r_thread_unref (async->thread);
+
+  r_mutex_lock (&g__r_log_async_mutex);
+  for (ring = async->rings; ring != NULL; ring = next) {
+    next = ring->next;
+    if (ring->closed)
+      r_free (ring);
+    else
+      ring->async = NULL;
+  }
+  r_mutex_unlock (&g__r_log_async_mutex);
+
+  r_cond_clear (&async->wakecond);
+  r_cond_clear (&async->spacecond);
+  r_free (async);
+}
+
+void
+r_log_async_flush (RLogAsync * async)
+{
+  r_mutex_lock (&g__r_log_async_mutex);
+  while (async->running && r_log_async_pending (async)) {
+    r_log_async_wake_writer (async);
+    r_cond_wait (&async->spacecond, &g__r_log_async_mutex);
+  }
+  r_mutex_unlock (&g__r_log_async_mutex);
+}
+
+ruint
+r_log_async_get_dropped (RLogAsync * async)
+{
+  return r_atomic_uint_load (&async->dropped);
+}
+
+void
+r_log_async_handler (RLogCategory * cat, RLogLevel lvl,
+    const rchar * file, ruint line, const rchar * func,
+    const rchar * msg, rpointer user_data)
+{
+  RLogAsync * async = user_data;
+  RLogAsyncRing * ring;
+  rchar buf[R_LOG_ASYNC_LINE_SIZE], * str = buf;
+  int len, pid = r_proc_get_id ();
+
+  if (R_UNLIKELY (pid != async->pid)) {
+    /* Forked child without writer thread, write synchronously */
+    if ((len = r_log_format_line (buf, sizeof (buf), async->color, pid,
+            cat, lvl, file, line, func, msg)) > 0) {
+      struct iovec iov = { buf, MIN ((rsize)len, sizeof (buf) - 1) };
+      buf[iov.iov_len - 1] = '\n';
+      r_log_async_write (async->handle, &iov, 1);
+    }
+    return;
+  }
+
+  if (R_UNLIKELY ((ring = r_log_async_ring_get (async)) == NULL)) {
+    r_atomic_uint_fetch_add (&async->dropped, 1);
+    return;
+  }
+
+  len = r_log_format_line (buf, sizeof (buf), async->color, pid,
+      cat, lvl, file, line, func, msg);
+  if (R_UNLIKELY (len < 0))
+    return;
+
+  if (R_UNLIKELY ((rsize)len >= sizeof (buf))) {
+    rsize size = MIN ((rsize)len, ring->size) + 1;
+
+    if ((str = r_malloc (size)) == NULL) {
+      r_atomic_uint_fetch_add (&async->dropped, 1);
+      return;
+    }
+    r_log_format_line (str, size, async->color, pid,
+        cat, lvl, file, line, func, msg);
+  }
+  if (R_UNLIKELY ((ruint)len > ring->size)) {
+    /* Lines longer than the ring are truncated */
+    len = (int)ring->size;
+    str[len - 1] = '\n';
+  }
+
+  while (!r_log_async_ring_push (ring, str, (ruint)len)) {
+    if (async->policy != R_LOG_ASYNC_BLOCK ||
+        !r_log_async_wait_for_space (async, ring, (ruint)len)) {
+      r_atomic_uint_fetch_add (&async->dropped, 1);
+      break;
+    }
+  }
+
+  if (str != buf)
+    r_free (str);
+
+  if (r_atomic_uint_load (&async->sleeping)) {
+    r_mutex_lock (&g__r_log_async_mutex);
+    r_log_async_wake_writer (async);
+    r_mutex_unlock (&g__r_log_async_mutex);
+  }
+}
+
 
 static void
 r_log_keep_last_log_last (const RLogKeepLastCtx * ctx)
@@ -22,6 +22,7 @@
 
 #include <rlib/rassert.h>
 #include <rlib/rstr.h>
+#include <rlib/rthreads.h>
 
 static RMemAllocator ** g__r_mem_allocator = NULL;
 static rsize g__r_mem_allocator_size = 0;
@@ -128,7 +129,7 @@ r_system_mem_allocator_copy (RMem * mem, rssize offset, rssize size)
   params.prefix = 0;
   params.padding = 0;
   params.alignmask = mem->alignmask;
-  if ((ret = r_system_mem_allocator_alloc (mem->allocator, size, &params)) != NULL)
+  if ((ret = mem->allocator->alloc (mem->allocator, size, &params)) != NULL)
     r_memcpy (((RSystemMem *)ret)->data, sysmem->data + mem->offset + offset, size);
 
   return ret;
@@ -171,7 +172,7 @@ r_system_mem_allocator_merge (const RMemAllocationParams * params,
   for (i = 0, size = 0; i < count; i++)
     size += mems[i]->size;
 
-  if ((ret = r_system_mem_allocator_alloc (mems[0]->allocator, size, params)) != NULL) {
+  if ((ret = mems[0]->allocator->alloc (mems[0]->allocator, size, params)) != NULL) {
     ruint8 * dst = ((RSystemMem *) ret)->data + ret->offset;
     RMemMapInfo info;
     for (i = 0; i < count; i++) {
@@ -205,9 +206,16 @@ static RMemAllocator g__r_mem_allocator_system = {
   r_system_mem_allocator_view
 };
 
+/* Pool allocator thread caches, see below. The mutex protects the
+ * pool <-> cache links, not the free lists themselves. */
+static RTss g__r_pool_mem_tss;
+static RMutex g__r_pool_mem_mutex;
+static void r_pool_mem_thread_release (rpointer lst);
+
 void
 r_mem_allocator_init (void)
 {
+  r_mutex_init (&g__r_pool_mem_mutex);
   r_mem_allocator_register (&g__r_mem_allocator_system);
 }
 
@@ -219,13 +227,17 @@ r_mem_allocator_deinit (void)
     r_mem_allocator_unref (g__r_mem_allocator[i]);
 
   r_free (g__r_mem_allocator);
+
+  r_pool_mem_thread_release (r_tss_get (&g__r_pool_mem_tss));
+  r_tss_set (&g__r_pool_mem_tss, NULL);
+  r_mutex_clear (&g__r_pool_mem_mutex);
 }
 
 RMemAllocator *
 r_mem_allocator_find (const rchar * name)
 {
   rsize i;
-  for (i = 0; i < g__r_mem_allocator_size; i++) {
+  for (i = 0; i < g__r_mem_allocator_idx; i++) {
     if (r_str_equals (g__r_mem_allocator[i]->mem_type, name))
       return r_mem_allocator_ref (g__r_mem_allocator[i]);
   }
@@ -480,3 +492,313 @@ r_mem_take_array (const RMemAllocationParams * params, RMem ** mems, ruint count
   return ret;
 }
 
+
+
+/******************************************************************************/
+/* Pool allocator - Recycles fixed size slabs through per-thread free lists   */
+/******************************************************************************/
+#define R_POOL_MEM_DEPOT_FACTOR     4
+
+typedef struct _RPoolMem            RPoolMem;
+typedef struct _RPoolMemCache       RPoolMemCache;
+typedef struct _RPoolMemAllocator   RPoolMemAllocator;
+
+struct _RPoolMem {
+  RSystemMem sys; /* Must be first, system map/unmap/view is reused */
+  RPoolMem * next;
+  rsize capacity;
+};
+
+/* One per thread and pool. Linked into the owning thread's list (tnext) and
+ * the pool's list (pnext/pprev). pool is set to NULL when the pool goes away
+ * and the thread still holds the cache; it is then freed at thread exit. */
+struct _RPoolMemCache {
+  RPoolMemAllocator * pool;
+  RPoolMemCache * tnext;
+  RPoolMemCache * pnext, * pprev;
+
+  RPoolMem * free;
+  ruint count;
+};
+
+struct _RPoolMemAllocator {
+  RMemAllocator allocator;
+  rchar * name;
+  rsize slabsize;
+  ruint maxcached;
+
+  RMutex mutex;
+  RPoolMem * depot;
+  ruint depotcount;
+
+  RPoolMemCache * caches;
+};
+
+static RTss g__r_pool_mem_tss = R_TSS_INIT (r_pool_mem_thread_release);
+
+static void
+r_pool_mem_free_list (RPoolMem * lst)
+{
+  RPoolMem * next;
+
+  for (; lst != NULL; lst = next) {
+    next = lst->next;
+    r_free (lst);
+  }
+}
+
+static void
+r_pool_mem_thread_release (rpointer data)
+{
+  RPoolMemCache * lst = data, * cache;
+
+  r_mutex_lock (&g__r_pool_mem_mutex);
+  while ((cache = lst) != NULL) {
+    RPoolMemAllocator * pool;
+    lst = cache->tnext;
+
+    if ((pool = cache->pool) != NULL) {
+      if (cache->pprev != NULL)
+        cache->pprev->pnext = cache->pnext;
+      else
+        pool->caches = cache->pnext;
+      if (cache->pnext != NULL)
+        cache->pnext->pprev = cache->pprev;
+
+      r_mutex_lock (&pool->mutex);
+      while (cache->free != NULL &&
+          pool->depotcount < pool->maxcached * R_POOL_MEM_DEPOT_FACTOR) {
+        RPoolMem * pmem = cache->free;
+        cache->free = pmem->next;
+        pmem->next = pool->depot;
+        pool->depot = pmem;
+        pool->depotcount++;
+      }
+      r_mutex_unlock (&pool->mutex);
+    }
+
+    r_pool_mem_free_list (cache->free);
+    r_free (cache);
+  }
+  r_mutex_unlock (&g__r_pool_mem_mutex);
+}
+
+static RPoolMemCache *
+r_pool_mem_cache_get (RPoolMemAllocator * pool)
+{
+  RPoolMemCache * head, * cache, ** prev;
+
+  head = r_tss_get (&g__r_pool_mem_tss);
+  if (R_LIKELY (head != NULL && head->pool == pool))
+    return head;
+
+  r_mutex_lock (&g__r_pool_mem_mutex);
+  for (prev = &head; (cache = *prev) != NULL; ) {
+    if (cache->pool == pool) {
+      /* Move to front, so the next lookup is fast */
+      *prev = cache->tnext;
+      break;
+    } else if (cache->pool == NULL) {
+      *prev = cache->tnext;
+      r_free (cache);
+    } else {
+      prev = &cache->tnext;
+    }
+  }
+
+  if (cache == NULL && (cache = r_mem_new0 (RPoolMemCache)) != NULL) {
+    cache->pool = pool;
+    if ((cache->pnext = pool->caches) != NULL)
+      cache->pnext->pprev = cache;
+    pool->caches = cache;
+  }
+  r_mutex_unlock (&g__r_pool_mem_mutex);
+
+  if (cache != NULL) {
+    cache->tnext = head;
+    head = cache;
+  }
+  r_tss_set (&g__r_pool_mem_tss, head);
+
+  return cache;
+}
+
+static RPoolMem *
+r_pool_mem_cache_pop (RPoolMemAllocator * pool)
+{
+  RPoolMemCache * cache;
+  RPoolMem * ret;
+
+  if (R_UNLIKELY ((cache = r_pool_mem_cache_get (pool)) == NULL))
+    return NULL;
+
+  if (cache->free == NULL) {
+    /* Refill half a cache worth of slabs from the shared depot */
+    r_mutex_lock (&pool->mutex);
+    while (pool->depot != NULL && cache->count < pool->maxcached / 2 + 1) {
+      RPoolMem * pmem = pool->depot;
+      pool->depot = pmem->next;
+      pool->depotcount--;
+      pmem->next = cache->free;
+      cache->free = pmem;
+      cache->count++;
+    }
+    r_mutex_unlock (&pool->mutex);
+  }
+
+  if ((ret = cache->free) != NULL) {
+    cache->free = ret->next;
+    cache->count--;
+  }
+
+  return ret;
+}
+
+static void
+r_pool_mem_cache_push (RPoolMemAllocator * pool, RPoolMem * pmem)
+{
+  RPoolMemCache * cache;
+
+  if (R_UNLIKELY ((cache = r_pool_mem_cache_get (pool)) == NULL)) {
+    r_free (pmem);
+    return;
+  }
+
+  pmem->next = cache->free;
+  cache->free = pmem;
+
+  if (++cache->count > pool->maxcached) {
+    /* Spill half the cache to the depot, or give it back to the system */
+    RPoolMem * spill = NULL;
+    ruint n = pool->maxcached / 2 + 1;
+
+    r_mutex_lock (&pool->mutex);
+    for (; n > 0; n--) {
+      pmem = cache->free;
+      cache->free = pmem->next;
+      cache->count--;
+      if (pool->depotcount < pool->maxcached * R_POOL_MEM_DEPOT_FACTOR) {
+        pmem->next = pool->depot;
+        pool->depot = pmem;
+        pool->depotcount++;
+      } else {
+        pmem->next = spill;
+        spill = pmem;
+      }
+    }
+    r_mutex_unlock (&pool->mutex);
+
+    r_pool_mem_free_list (spill);
+  }
+}
+
+static RMem *
+r_pool_mem_allocator_alloc (RMemAllocator * allocator, rsize size,
+    const RMemAllocationParams * params)
+{
+  RPoolMemAllocator * pool = (RPoolMemAllocator *) allocator;
+  rsize allocsize = size + params->prefix + params->padding;
+  rsize align = allocator->alignmask | params->alignmask;
+  RPoolMem * pmem;
+  ruint8 * data;
+  rsize aoff;
+
+  if (allocsize + align <= pool->slabsize + allocator->alignmask) {
+    if ((pmem = r_pool_mem_cache_pop (pool)) == NULL) {
+      if ((pmem = r_malloc (sizeof (RPoolMem) +
+              pool->slabsize + allocator->alignmask)) == NULL)
+        return NULL;
+    }
+    pmem->capacity = pool->slabsize;
+  } else {
+    /* Oversized or overaligned requests are never recycled */
+    if ((pmem = r_malloc (sizeof (RPoolMem) + allocsize + align)) == NULL)
+      return NULL;
+    pmem->capacity = 0;
+  }
+
+  data = (ruint8 *)(pmem + 1);
+  if ((aoff = RPOINTER_TO_SIZE (data) & align) > 0)
+    data += align + 1 - aoff;
+
+  r_system_mem_init (&pmem->sys, params->flags, allocator, NULL,
+      allocsize, size, align, params->prefix, data, NULL, NULL);
+
+  if ((params->flags & R_MEM_FLAG_ZERO_PREFIXED) && params->prefix > 0)
+    r_memset (data, 0, params->prefix);
+  if ((params->flags & R_MEM_FLAG_ZERO_PADDED) && params->padding > 0)
+    r_memset (data + params->prefix + size, 0, params->padding);
+
+  return (RMem *) pmem;
+}
+
+static rboolean
+r_pool_mem_allocator_free (RMemAllocator * allocator, RMem * mem)
+{
+  RPoolMemAllocator * pool = (RPoolMemAllocator *) allocator;
+
+  /* Views are plain RSystemMem instances pointing into their parent */
+  if (mem->parent == NULL && ((RPoolMem *) mem)->capacity == pool->slabsize)
+    r_pool_mem_cache_push (pool, (RPoolMem *) mem);
+  else
+    r_free (mem);
+
+  return TRUE;
+}
+
+static void
+r_pool_mem_allocator_destroy (RPoolMemAllocator * pool)
+{
+  RPoolMemCache * cache;
+
+  r_mutex_lock (&g__r_pool_mem_mutex);
+  for (cache = pool->caches; cache != NULL; cache = cache->pnext) {
+    r_pool_mem_free_list (cache->free);
+    cache->free = NULL;
+    cache->count = 0;
+    cache->pool = NULL;
+  }
+  r_mutex_unlock (&g__r_pool_mem_mutex);
+
+  r_pool_mem_free_list (pool->depot);
+  r_mutex_clear (&pool->mutex);
+  r_free (pool->name);
+  r_free (pool);
+}
+
+RMemAllocator *
+r_mem_allocator_pool_new (const rchar * name, rsize slabsize, ruint maxcached)
+{
+  RPoolMemAllocator * ret;
+
+  if (R_UNLIKELY (name == NULL)) return NULL;
+  if (R_UNLIKELY (slabsize == 0)) return NULL;
+
+  if ((ret = r_mem_new0 (RPoolMemAllocator)) != NULL) {
+    r_ref_init (ret, r_pool_mem_allocator_destroy);
+    ret->name = r_strdup (name);
+    ret->slabsize = slabsize;
+    ret->maxcached = MAX (maxcached, 1);
+    r_mutex_init (&ret->mutex);
+
+    ret->allocator.mem_type = ret->name;
+    ret->allocator.alignmask = R_MEM_ALLOCATOR_SYSTEM_ALIGNMASK;
+    ret->allocator.alloc = r_pool_mem_allocator_alloc;
+    ret->allocator.free = r_pool_mem_allocator_free;
+    ret->allocator.map = r_system_mem_allocator_map;
+    ret->allocator.unmap = r_system_mem_allocator_unmap;
+    ret->allocator.merge = r_system_mem_allocator_merge;
+    ret->allocator.copy = r_system_mem_allocator_copy;
+    ret->allocator.view = r_system_mem_allocator_view;
+  }
+
+  return (RMemAllocator *) ret;
+}
+
+rsize
+r_mem_allocator_pool_slab_size (const RMemAllocator * allocator)
+{
+  if (R_UNLIKELY (allocator == NULL)) return 0;
+  if (R_UNLIKELY (allocator->alloc != r_pool_mem_allocator_alloc)) return 0;
+  return ((const RPoolMemAllocator *) allocator)->slabsize;
+}
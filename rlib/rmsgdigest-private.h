@@ -0,0 +1,46 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+#ifndef __R_MSG_DIGEST_PRIV_H__
+#define __R_MSG_DIGEST_PRIV_H__
+
+#if !defined(RLIB_COMPILATION)
+#error "rmsgdigest-private.h should only be used internally in rlib!"
+#endif
+
+#include <rlib/rmsgdigest.h>
+
+R_BEGIN_DECLS
+
+/* x86 backend (rmsgdigest-x86.c). The compress functions run blocks
+ * consecutive 64 byte blocks through the host endian state words. */
+R_API_HIDDEN rboolean r_msg_digest_x86_sha_available (void);
+R_API_HIDDEN rboolean r_msg_digest_x86_avx2_available (void);
+R_API_HIDDEN void r_sha1_x86_compress (ruint32 * state, const ruint8 * data, rsize blocks);
+R_API_HIDDEN void r_sha256_x86_compress (ruint32 * state, const ruint8 * data, rsize blocks);
+
+/* Multi-buffer, one independent state and message per 32 bit AVX2 lane.
+ * Every lane is fed the same number of blocks. */
+#define R_MSG_DIGEST_X86_LANES    8
+R_API_HIDDEN void r_sha1_x86_compress_x8 (ruint32 * const * state,
+    const ruint8 * const * data, rsize blocks);
+R_API_HIDDEN void r_sha256_x86_compress_x8 (ruint32 * const * state,
+    const ruint8 * const * data, rsize blocks);
+
+R_END_DECLS
+
+#endif /* __R_MSG_DIGEST_PRIV_H__ */
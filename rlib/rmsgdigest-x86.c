@@ -0,0 +1,386 @@
+/* RLIB - Convenience library for useful things
+ * Copyright (C) 2026 Haakon Sporsheim <haakon.sporsheim@gmail.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3.0 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.
+ * See the COPYING file at the root of the source repository.
+ */
+
+#include "config.h"
+#include "rmsgdigest-private.h"
+
+#include <rlib/ratomic.h>
+
+#if defined (HAVE_X86_SHA)
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define R_SHA_X86_TARGET      __attribute__ ((target ("sha,sse4.1,ssse3")))
+#define R_SHA_X86_AVX2_TARGET __attribute__ ((target ("avx2")))
+
+#define R_SHA_X86_FEATURE_SHA     (1 << 0)
+#define R_SHA_X86_FEATURE_AVX2    (1 << 1)
+
+static raint g__r_sha_x86_features = -1;
+
+static int
+r_sha_x86_features (void)
+{
+  int features = r_atomic_int_load (&g__r_sha_x86_features);
+
+  if (R_UNLIKELY (features < 0)) {
+    unsigned int eax, ebx, ecx, edx, ecx1;
+
+    features = 0;
+    if (__get_cpuid (1, &eax, &ebx, &ecx1, &edx) && __get_cpuid_max (0, NULL) >= 7) {
+      __cpuid_count (7, 0, eax, ebx, ecx, edx);
+      /* CPUID.07H:EBX.SHA[bit 29], the round helpers need SSSE3 and SSE4.1 */
+      if ((ebx & bit_SHA) && (ecx1 & bit_SSSE3) && (ecx1 & bit_SSE4_1))
+        features |= R_SHA_X86_FEATURE_SHA;
+      /* CPUID.07H:EBX.AVX2[bit 5], and the OS must save the ymm registers */
+      if ((ebx & bit_AVX2) && (ecx1 & bit_OSXSAVE)) {
+        unsigned int xcr0, xcr0hi;
+        __asm__ ("xgetbv" : "=a" (xcr0), "=d" (xcr0hi) : "c" (0));
+        if ((xcr0 & 0x6) == 0x6)
+          features |= R_SHA_X86_FEATURE_AVX2;
+      }
+    }
+    r_atomic_int_store (&g__r_sha_x86_features, features);
+  }
+
+  return features;
+}
+
+rboolean
+r_msg_digest_x86_sha_available (void)
+{
+  return (r_sha_x86_features () & R_SHA_X86_FEATURE_SHA) != 0;
+}
+
+rboolean
+r_msg_digest_x86_avx2_available (void)
+{
+  return (r_sha_x86_features () & R_SHA_X86_FEATURE_AVX2) != 0;
+}
+
+static const ruint32 r_sha256_x86_k[64] R_ATTR_ALIGN (16) = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+/**************************************/
+/*          SHA-1 with SHA-NI         */
+/**************************************/
+
+/* Message words for rounds 4g to 4g+3 out of the previous four groups,
+ * m[g & 3] holds group g - 4 on entry */
+#define R_SHA1_X86_MSG(m, g)                                                  \
+  m[(g) & 3] = _mm_sha1msg2_epu32 (_mm_xor_si128 (                            \
+        _mm_sha1msg1_epu32 (m[(g) & 3], m[((g) + 1) & 3]), m[((g) + 2) & 3]), \
+      m[((g) + 3) & 3])
+
+/* e0 is abcd from before the previous four rounds, so sha1nexte turns its
+ * a into the e of this group */
+#define R_SHA1_X86_RNDS4(m, g) do {                                           \
+  if ((g) >= 4) R_SHA1_X86_MSG (m, g);                                        \
+  e1 = (g) == 0 ? _mm_add_epi32 (e0, m[0]) : _mm_sha1nexte_epu32 (e0, m[(g) & 3]); \
+  e0 = abcd;                                                                  \
+  abcd = _mm_sha1rnds4_epu32 (abcd, e1, (g) / 5);                             \
+} while (0)
+
+R_SHA_X86_TARGET void
+r_sha1_x86_compress (ruint32 * state, const ruint8 * data, rsize blocks)
+{
+  const __m128i mask = _mm_set_epi64x (0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+  __m128i abcd, e0, e1, abcd_save, e_save, m[4];
+
+  abcd = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)state), 0x1b);
+  e0 = _mm_set_epi32 ((int)state[4], 0, 0, 0);
+
+  for (; blocks > 0; blocks--, data += 64) {
+    abcd_save = abcd;
+    e_save = e0;
+
+    m[0] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data +  0)), mask);
+    m[1] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data + 16)), mask);
+    m[2] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data + 32)), mask);
+    m[3] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data + 48)), mask);
+
+    R_SHA1_X86_RNDS4 (m,  0); R_SHA1_X86_RNDS4 (m,  1);
+    R_SHA1_X86_RNDS4 (m,  2); R_SHA1_X86_RNDS4 (m,  3);
+    R_SHA1_X86_RNDS4 (m,  4); R_SHA1_X86_RNDS4 (m,  5);
+    R_SHA1_X86_RNDS4 (m,  6); R_SHA1_X86_RNDS4 (m,  7);
+    R_SHA1_X86_RNDS4 (m,  8); R_SHA1_X86_RNDS4 (m,  9);
+    R_SHA1_X86_RNDS4 (m, 10); R_SHA1_X86_RNDS4 (m, 11);
+    R_SHA1_X86_RNDS4 (m, 12); R_SHA1_X86_RNDS4 (m, 13);
+    R_SHA1_X86_RNDS4 (m, 14); R_SHA1_X86_RNDS4 (m, 15);
+    R_SHA1_X86_RNDS4 (m, 16); R_SHA1_X86_RNDS4 (m, 17);
+    R_SHA1_X86_RNDS4 (m, 18); R_SHA1_X86_RNDS4 (m, 19);
+
+    e0 = _mm_sha1nexte_epu32 (e0, e_save);
+    abcd = _mm_add_epi32 (abcd, abcd_save);
+  }
+
+  _mm_storeu_si128 ((__m128i *)state, _mm_shuffle_epi32 (abcd, 0x1b));
+  state[4] = (ruint32)_mm_extract_epi32 (e0, 3);
+}
+
+#undef R_SHA1_X86_RNDS4
+#undef R_SHA1_X86_MSG
+
+/**************************************/
+/*         SHA-256 with SHA-NI        */
+/**************************************/
+R_SHA_X86_TARGET void
+r_sha256_x86_compress (ruint32 * state, const ruint8 * data, rsize blocks)
+{
+  const __m128i mask = _mm_set_epi64x (0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m128i s0, s1, tmp, abef_save, cdgh_save, m[4];
+  ruint g;
+
+  /* The rounds work on the state as ABEF and CDGH */
+  tmp = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)&state[0]), 0xb1);
+  s1 = _mm_shuffle_epi32 (_mm_loadu_si128 ((const __m128i *)&state[4]), 0x1b);
+  s0 = _mm_alignr_epi8 (tmp, s1, 8);
+  s1 = _mm_blend_epi16 (s1, tmp, 0xf0);
+
+  for (; blocks > 0; blocks--, data += 64) {
+    abef_save = s0;
+    cdgh_save = s1;
+
+    m[0] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data +  0)), mask);
+    m[1] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data + 16)), mask);
+    m[2] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data + 32)), mask);
+    m[3] = _mm_shuffle_epi8 (_mm_loadu_si128 ((const __m128i *)(data + 48)), mask);
+
+    for (g = 0; g < 16; g++) {
+      if (g >= 4) {
+        m[g & 3] = _mm_sha256msg2_epu32 (_mm_add_epi32 (
+              _mm_sha256msg1_epu32 (m[g & 3], m[(g + 1) & 3]),
+              _mm_alignr_epi8 (m[(g + 3) & 3], m[(g + 2) & 3], 4)),
+            m[(g + 3) & 3]);
+      }
+      tmp = _mm_add_epi32 (m[g & 3], _mm_load_si128 ((const __m128i *)&r_sha256_x86_k[g * 4]));
+      s1 = _mm_sha256rnds2_epu32 (s1, s0, tmp);
+      s0 = _mm_sha256rnds2_epu32 (s0, s1, _mm_shuffle_epi32 (tmp, 0x0e));
+    }
+
+    s0 = _mm_add_epi32 (s0, abef_save);
+    s1 = _mm_add_epi32 (s1, cdgh_save);
+  }
+
+  tmp = _mm_shuffle_epi32 (s0, 0x1b);
+  s1 = _mm_shuffle_epi32 (s1, 0xb1);
+  _mm_storeu_si128 ((__m128i *)&state[0], _mm_blend_epi16 (tmp, s1, 0xf0));
+  _mm_storeu_si128 ((__m128i *)&state[4], _mm_alignr_epi8 (s1, tmp, 8));
+}
+
+/**************************************/
+/*        AVX2 multi-buffer           */
+/**************************************/
+#define R_SHA_X86_ROTL(x, n)  \
+  _mm256_or_si256 (_mm256_slli_epi32 (x, n), _mm256_srli_epi32 (x, 32 - (n)))
+#define R_SHA_X86_ROTR(x, n)  R_SHA_X86_ROTL (x, 32 - (n))
+
+/* Load one block from each lane, w[t] gets word t of all eight */
+static R_SHA_X86_AVX2_TARGET void
+r_sha_x86_load_x8 (__m256i * w, const ruint8 * const * data, rsize off)
+{
+  const __m256i bswap = _mm256_set_epi64x (0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL,
+      0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+  __m256i r[8], t[8], u[8];
+  ruint i, half;
+
+  for (half = 0; half < 2; half++) {
+    for (i = 0; i < 8; i++)
+      r[i] = _mm256_loadu_si256 ((const __m256i *)(data[i] + off + half * 32));
+
+    /* 8x8 transpose of 32 bit words */
+    for (i = 0; i < 8; i += 2) {
+      t[i + 0] = _mm256_unpacklo_epi32 (r[i], r[i + 1]);
+      t[i + 1] = _mm256_unpackhi_epi32 (r[i], r[i + 1]);
+    }
+    for (i = 0; i < 8; i += 4) {
+      u[i + 0] = _mm256_unpacklo_epi64 (t[i + 0], t[i + 2]);
+      u[i + 1] = _mm256_unpackhi_epi64 (t[i + 0], t[i + 2]);
+      u[i + 2] = _mm256_unpacklo_epi64 (t[i + 1], t[i + 3]);
+      u[i + 3] = _mm256_unpackhi_epi64 (t[i + 1], t[i + 3]);
+    }
+    for (i = 0; i < 4; i++) {
+      w[half * 8 + i + 0] = _mm256_shuffle_epi8 (
+          _mm256_permute2x128_si256 (u[i], u[i + 4], 0x20), bswap);
+      w[half * 8 + i + 4] = _mm256_shuffle_epi8 (
+          _mm256_permute2x128_si256 (u[i], u[i + 4], 0x31), bswap);
+    }
+  }
+}
+
+static R_SHA_X86_AVX2_TARGET void
+r_sha_x86_state_load_x8 (__m256i * v, ruint32 * const * state, ruint words)
+{
+  ruint i;
+
+  for (i = 0; i < words; i++) {
+    v[i] = _mm256_set_epi32 ((int)state[7][i], (int)state[6][i],
+        (int)state[5][i], (int)state[4][i], (int)state[3][i],
+        (int)state[2][i], (int)state[1][i], (int)state[0][i]);
+  }
+}
+
+static R_SHA_X86_AVX2_TARGET void
+r_sha_x86_state_store_x8 (ruint32 * const * state, const __m256i * v, ruint words)
+{
+  ruint32 tmp[8] R_ATTR_ALIGN (32);
+  ruint i, j;
+
+  for (i = 0; i < words; i++) {
+    _mm256_store_si256 ((__m256i *)tmp, v[i]);
+    for (j = 0; j < 8; j++)
+      state[j][i] = tmp[j];
+  }
+}
+
+R_SHA_X86_AVX2_TARGET void
+r_sha1_x86_compress_x8 (ruint32 * const * state,
+    const ruint8 * const * data, rsize blocks)
+{
+  __m256i s[5], w[16], a, b, c, d, e, f, tmp;
+  rsize off;
+  ruint t;
+
+  r_sha_x86_state_load_x8 (s, state, 5);
+
+  for (off = 0; off < blocks * 64; off += 64) {
+    r_sha_x86_load_x8 (w, data, off);
+    a = s[0]; b = s[1]; c = s[2]; d = s[3]; e = s[4];
+
+    for (t = 0; t < 80; t++) {
+      if (t >= 16) {
+        tmp = _mm256_xor_si256 (_mm256_xor_si256 (w[(t - 3) & 15], w[(t - 8) & 15]),
+            _mm256_xor_si256 (w[(t - 14) & 15], w[t & 15]));
+        w[t & 15] = R_SHA_X86_ROTL (tmp, 1);
+      }
+
+      if (t < 20) {
+        f = _mm256_xor_si256 (d, _mm256_and_si256 (b, _mm256_xor_si256 (c, d)));
+        f = _mm256_add_epi32 (f, _mm256_set1_epi32 (0x5a827999));
+      } else if (t < 40) {
+        f = _mm256_xor_si256 (b, _mm256_xor_si256 (c, d));
+        f = _mm256_add_epi32 (f, _mm256_set1_epi32 (0x6ed9eba1));
+      } else if (t < 60) {
+        f = _mm256_or_si256 (_mm256_and_si256 (b, c), _mm256_and_si256 (d, _mm256_or_si256 (b, c)));
+        f = _mm256_add_epi32 (f, _mm256_set1_epi32 ((int)0x8f1bbcdc));
+      } else {
+        f = _mm256_xor_si256 (b, _mm256_xor_si256 (c, d));
+        f = _mm256_add_epi32 (f, _mm256_set1_epi32 ((int)0xca62c1d6));
+      }
+
+      tmp = _mm256_add_epi32 (_mm256_add_epi32 (R_SHA_X86_ROTL (a, 5), f),
+          _mm256_add_epi32 (e, w[t & 15]));
+      e = d;
+      d = c;
+      c = R_SHA_X86_ROTL (b, 30);
+      b = a;
+      a = tmp;
+    }
+
+    s[0] = _mm256_add_epi32 (s[0], a);
+    s[1] = _mm256_add_epi32 (s[1], b);
+    s[2] = _mm256_add_epi32 (s[2], c);
+    s[3] = _mm256_add_epi32 (s[3], d);
+    s[4] = _mm256_add_epi32 (s[4], e);
+  }
+
+  r_sha_x86_state_store_x8 (state, s, 5);
+}
+
+R_SHA_X86_AVX2_TARGET void
+r_sha256_x86_compress_x8 (ruint32 * const * state,
+    const ruint8 * const * data, rsize blocks)
+{
+  __m256i s[8], w[16], v[8], t1, t2, x;
+  rsize off;
+  ruint t, i;
+
+  r_sha_x86_state_load_x8 (s, state, 8);
+
+  for (off = 0; off < blocks * 64; off += 64) {
+    r_sha_x86_load_x8 (w, data, off);
+    for (i = 0; i < 8; i++)
+      v[i] = s[i];
+
+    for (t = 0; t < 64; t++) {
+      if (t >= 16) {
+        x = w[(t - 15) & 15];
+        t1 = _mm256_xor_si256 (_mm256_xor_si256 (R_SHA_X86_ROTR (x, 7),
+              R_SHA_X86_ROTR (x, 18)), _mm256_srli_epi32 (x, 3));
+        x = w[(t - 2) & 15];
+        t2 = _mm256_xor_si256 (_mm256_xor_si256 (R_SHA_X86_ROTR (x, 17),
+              R_SHA_X86_ROTR (x, 19)), _mm256_srli_epi32 (x, 10));
+        w[t & 15] = _mm256_add_epi32 (_mm256_add_epi32 (w[t & 15], t1),
+            _mm256_add_epi32 (w[(t - 7) & 15], t2));
+      }
+
+      /* v holds a to h */
+      t1 = _mm256_xor_si256 (_mm256_xor_si256 (R_SHA_X86_ROTR (v[4], 6),
+            R_SHA_X86_ROTR (v[4], 11)), R_SHA_X86_ROTR (v[4], 25));
+      t1 = _mm256_add_epi32 (_mm256_add_epi32 (v[7], t1), _mm256_xor_si256 (v[6],
+            _mm256_and_si256 (v[4], _mm256_xor_si256 (v[5], v[6]))));
+      t1 = _mm256_add_epi32 (t1, _mm256_add_epi32 (w[t & 15],
+            _mm256_set1_epi32 ((int)r_sha256_x86_k[t])));
+      t2 = _mm256_xor_si256 (_mm256_xor_si256 (R_SHA_X86_ROTR (v[0], 2),
+            R_SHA_X86_ROTR (v[0], 13)), R_SHA_X86_ROTR (v[0], 22));
+      t2 = _mm256_add_epi32 (t2, _mm256_or_si256 (_mm256_and_si256 (v[0], v[1]),
+            _mm256_and_si256 (v[2], _mm256_or_si256 (v[0], v[1]))));
+
+      v[7] = v[6];
+      v[6] = v[5];
+      v[5] = v[4];
+      v[4] = _mm256_add_epi32 (v[3], t1);
+      v[3] = v[2];
+      v[2] = v[1];
+      v[1] = v[0];
+      v[0] = _mm256_add_epi32 (t1, t2);
+    }
+
+    for (i = 0; i < 8; i++)
+      s[i] = _mm256_add_epi32 (s[i], v[i]);
+  }
+
+  r_sha_x86_state_store_x8 (state, s, 8);
+}
+
+#undef R_SHA_X86_ROTR
+#undef R_SHA_X86_ROTL
+
+#else
+
+rboolean
+r_msg_digest_x86_sha_available (void)
+{
+  return FALSE;
+}
+
+rboolean
+r_msg_digest_x86_avx2_available (void)
+{
+  return FALSE;
+}
+
+#endif
@@ -17,6 +17,7 @@
  */
 
 #include "config.h"
+#include "rmsgdigest-private.h"
 #include <rlib/rmsgdigest.h>
 
 #include <rlib/rmem.h>
@@ -26,6 +27,7 @@ typedef     void (*RMDInit) (RMsgDigest * md);
 typedef rboolean (*RMDFinal) (RMsgDigest * md);
 typedef rboolean (*RMDUpdate) (RMsgDigest * md, rconstpointer data, rsize size);
 typedef rboolean (*RMDGet) (const RMsgDigest * md, ruint8 * data, rsize size, rsize * out);
+typedef     void (*RMDCompress) (ruint32 * state, const ruint8 * data, rsize blocks);
 
 /* MD5 */
 #define R_MD5_SIZE         (128 / 8)
@@ -53,11 +55,13 @@ typedef struct {
 
   ruint8 buffer[R_SHA1_BLOCK_SIZE];
   rsize bufsize;
+  RMDCompress compress;
 } RSha1;
 static void r_sha1_init (RMsgDigest * md);
 static rboolean r_sha1_final (RMsgDigest * md);
 static rboolean r_sha1_update (RMsgDigest * md, rconstpointer data, rsize size);
 static rboolean r_sha1_get (const RMsgDigest * md, ruint8 * data, rsize size, rsize * out);
+static void r_sha1_compress (ruint32 * state, const ruint8 * data, rsize blocks);
 
 /* SHA-224 */
 #define R_SHA224_SIZE          (224 / 8)
@@ -74,11 +78,13 @@ typedef struct {
 
   ruint8 buffer[R_SHA256_BLOCK_SIZE];
   rsize bufsize;
+  RMDCompress compress;
 } RSha256;
 static void r_sha256_init (RMsgDigest * md);
 static rboolean r_sha256_final (RMsgDigest * md);
 static rboolean r_sha256_update (RMsgDigest * md, rconstpointer data, rsize size);
 static rboolean r_sha256_get (const RMsgDigest * md, ruint8 * data, rsize size, rsize * out);
+static void r_sha256_compress (ruint32 * state, const ruint8 * data, rsize blocks);
 
 /* SHA-384 */
 #define R_SHA384_SIZE          (384 / 8)
@@ -103,6 +109,9 @@ static rboolean r_sha512_get (const RMsgDigest * md, ruint8 * data, rsize size,
 
 struct _RMsgDigest {
   RMsgDigestType type;
+  RMsgDigestImpl impl;
+  /* r_msg_digest_compute_multi runs 8 messages at a time with AVX2 */
+  rboolean multi_x8;
   rboolean is_final;
 
   rsize mdsize;
@@ -121,8 +130,12 @@ r_msg_digest_new (RMsgDigestType type)
       return r_msg_digest_new_md5 ();
     case R_MSG_DIGEST_TYPE_SHA1:
       return r_msg_digest_new_sha1 ();
+    case R_MSG_DIGEST_TYPE_SHA224:
+      return r_msg_digest_new_sha224 ();
     case R_MSG_DIGEST_TYPE_SHA256:
       return r_msg_digest_new_sha256 ();
+    case R_MSG_DIGEST_TYPE_SHA384:
+      return r_msg_digest_new_sha384 ();
     case R_MSG_DIGEST_TYPE_SHA512:
       return r_msg_digest_new_sha512 ();
     default:
@@ -137,6 +150,272 @@ r_msg_digest_free (RMsgDigest * md)
   r_free (md);
 }
 
+RMsgDigest *
+r_msg_digest_clone (const RMsgDigest * md)
+{
+  if (R_UNLIKELY (md == NULL))
+    return NULL;
+
+  return r_memdup (md, md->mdsize);
+}
+
+rboolean
+r_msg_digest_copy (RMsgDigest * dst, const RMsgDigest * src)
+{
+  if (R_UNLIKELY (dst == NULL || src == NULL))
+    return FALSE;
+  if (R_UNLIKELY (dst->type != src->type || dst->mdsize != src->mdsize))
+    return FALSE;
+
+  r_memcpy (dst, src, src->mdsize);
+  return TRUE;
+}
+
+rboolean
+r_msg_digest_impl_available (RMsgDigestImpl impl)
+{
+  switch (impl) {
+    case R_MSG_DIGEST_IMPL_AUTO:
+    case R_MSG_DIGEST_IMPL_PORTABLE:
+      return TRUE;
+    case R_MSG_DIGEST_IMPL_SHANI:
+      return r_msg_digest_x86_sha_available ();
+    case R_MSG_DIGEST_IMPL_AVX2:
+      return r_msg_digest_x86_avx2_available ();
+    default:
+      return FALSE;
+  }
+}
+
+static rboolean
+r_msg_digest_set_impl (RMsgDigest * md, RMsgDigestImpl impl)
+{
+  RMsgDigestType type = md->type;
+  RMDCompress compress;
+
+  md->multi_x8 = FALSE;
+  switch (type) {
+    case R_MSG_DIGEST_TYPE_SHA1:
+    case R_MSG_DIGEST_TYPE_SHA224:
+    case R_MSG_DIGEST_TYPE_SHA256:
+      if (impl == R_MSG_DIGEST_IMPL_AUTO) {
+        /* For batches the AVX2 lanes beat SHA-NI at SHA-1, but not at
+         * SHA-256 where they are about even */
+        md->multi_x8 = type == R_MSG_DIGEST_TYPE_SHA1 &&
+          r_msg_digest_x86_avx2_available ();
+        if (r_msg_digest_x86_sha_available ())
+          impl = R_MSG_DIGEST_IMPL_SHANI;
+        else if (r_msg_digest_x86_avx2_available ())
+          impl = R_MSG_DIGEST_IMPL_AVX2;
+        else
+          impl = R_MSG_DIGEST_IMPL_PORTABLE;
+      }
+      if (impl == R_MSG_DIGEST_IMPL_AVX2)
+        md->multi_x8 = TRUE;
+      break;
+    default:
+      if (impl == R_MSG_DIGEST_IMPL_AUTO)
+        impl = R_MSG_DIGEST_IMPL_PORTABLE;
+      md->impl = impl;
+      return impl == R_MSG_DIGEST_IMPL_PORTABLE;
+  }
+
+  if (type == R_MSG_DIGEST_TYPE_SHA1) {
+    compress = r_sha1_compress;
+#if defined (HAVE_X86_SHA)
+    if (impl == R_MSG_DIGEST_IMPL_SHANI)
+      compress = r_sha1_x86_compress;
+#endif
+    ((RSha1 *)(md + 1))->compress = compress;
+  } else {
+    compress = r_sha256_compress;
+#if defined (HAVE_X86_SHA)
+    if (impl == R_MSG_DIGEST_IMPL_SHANI)
+      compress = r_sha256_x86_compress;
+#endif
+    ((RSha256 *)(md + 1))->compress = compress;
+  }
+
+  md->impl = impl;
+  return TRUE;
+}
+
+RMsgDigest *
+r_msg_digest_new_with_impl (RMsgDigestType type, RMsgDigestImpl impl)
+{
+  RMsgDigest * ret;
+
+  if (R_UNLIKELY (!r_msg_digest_impl_available (impl)))
+    return NULL;
+
+  if ((ret = r_msg_digest_new (type)) != NULL && !r_msg_digest_set_impl (ret, impl)) {
+    r_msg_digest_free (ret);
+    ret = NULL;
+  }
+
+  return ret;
+}
+
+RMsgDigestImpl
+r_msg_digest_get_impl (const RMsgDigest * md)
+{
+  return md->impl;
+}
+
+#if defined (HAVE_X86_SHA)
+/* The parts of a SHA-1 or SHA-256 state the multi-buffer path needs */
+typedef struct {
+  RMsgDigest * md;
+  ruint32 * state;
+  ruint64 * len;
+  ruint8 * buffer;
+  rsize * bufsize;
+  RMDCompress compress;
+
+  const ruint8 * ptr;
+  rsize left;
+} RMDLane;
+
+static void
+r_msg_digest_lane_init (RMDLane * lane, RMsgDigest * md, const RMemChunk * msg)
+{
+  lane->md = md;
+  if (md->type == R_MSG_DIGEST_TYPE_SHA1) {
+    RSha1 * sha1 = (RSha1 *)(md + 1);
+    lane->state = sha1->data;
+    lane->len = &sha1->len;
+    lane->buffer = sha1->buffer;
+    lane->bufsize = &sha1->bufsize;
+    lane->compress = sha1->compress;
+  } else {
+    RSha256 * sha256 = (RSha256 *)(md + 1);
+    lane->state = sha256->data;
+    lane->len = &sha256->len;
+    lane->buffer = sha256->buffer;
+    lane->bufsize = &sha256->bufsize;
+    lane->compress = sha256->compress;
+  }
+  lane->ptr = msg->data;
+  lane->left = msg->size;
+}
+
+/* Feed the lanes their messages, the full blocks they have in common in
+ * parallel, then pad them and run the final blocks in parallel too */
+static rboolean
+r_msg_digest_compute_x8 (const RMsgDigest * init,
+    const RMemChunk * msgs, rsize count, ruint8 * out)
+{
+  void (*compress_x8) (ruint32 * const *, const ruint8 * const *, rsize);
+  RMDLane lane[R_MSG_DIGEST_X86_LANES];
+  ruint32 * state[R_MSG_DIGEST_X86_LANES], scratch[R_SHA256_WORD_SIZE];
+  const ruint8 * data[R_MSG_DIGEST_X86_LANES];
+  ruint8 tail[R_MSG_DIGEST_X86_LANES][2 * R_SHA256_BLOCK_SIZE];
+  rsize tailblocks[R_MSG_DIGEST_X86_LANES];
+  rsize mdsize = r_msg_digest_size (init);
+  rsize i, n, blocks;
+  ruint8 * mds;
+
+  compress_x8 = init->type == R_MSG_DIGEST_TYPE_SHA1 ?
+    r_sha1_x86_compress_x8 : r_sha256_x86_compress_x8;
+  mds = r_alloca (R_MSG_DIGEST_X86_LANES * init->mdsize);
+
+  for (; count > 0; count -= n, msgs += n, out += n * mdsize) {
+    n = MIN (count, R_MSG_DIGEST_X86_LANES);
+
+    /* Top up any partial buffer so every lane starts on a block boundary */
+    blocks = RSIZE_MAX;
+    for (i = 0; i < n; i++) {
+      RMsgDigest * md = (RMsgDigest *)(mds + i * init->mdsize);
+      r_memcpy (md, init, init->mdsize);
+      r_msg_digest_lane_init (&lane[i], md, &msgs[i]);
+      if (*lane[i].bufsize > 0) {
+        rsize s = MIN (lane[i].left, R_SHA256_BLOCK_SIZE - *lane[i].bufsize);
+        if (s > 0 && !md->update (md, lane[i].ptr, s))
+          return FALSE;
+        lane[i].ptr += s;
+        lane[i].left -= s;
+      }
+      blocks = *lane[i].bufsize > 0 ? 0 : MIN (blocks, lane[i].left / R_SHA256_BLOCK_SIZE);
+    }
+
+    for (i = 0; i < R_MSG_DIGEST_X86_LANES; i++) {
+      state[i] = i < n ? lane[i].state : scratch;
+      data[i] = i < n ? lane[i].ptr : lane[0].ptr;
+    }
+    if (blocks > 0) {
+      compress_x8 (state, data, blocks);
+      for (i = 0; i < n; i++) {
+        *lane[i].len += blocks * R_SHA256_BLOCK_SIZE;
+        lane[i].ptr += blocks * R_SHA256_BLOCK_SIZE;
+        lane[i].left -= blocks * R_SHA256_BLOCK_SIZE;
+      }
+    }
+
+    /* What is left of the longer messages, then the padding */
+    blocks = 2;
+    for (i = 0; i < n; i++) {
+      rsize bufsize;
+
+      if (lane[i].left > 0 && !lane[i].md->update (lane[i].md, lane[i].ptr, lane[i].left))
+        return FALSE;
+
+      bufsize = *lane[i].bufsize;
+      r_memcpy (tail[i], lane[i].buffer, bufsize);
+      tail[i][bufsize++] = 0x80;
+      tailblocks[i] = bufsize + sizeof (ruint64) > R_SHA256_BLOCK_SIZE ? 2 : 1;
+      r_memset (&tail[i][bufsize], 0, tailblocks[i] * R_SHA256_BLOCK_SIZE - bufsize);
+      *(ruint64 *)&tail[i][tailblocks[i] * R_SHA256_BLOCK_SIZE - sizeof (ruint64)] =
+        RUINT64_TO_BE (*lane[i].len << 3);
+      blocks = MIN (blocks, tailblocks[i]);
+    }
+
+    for (i = 0; i < R_MSG_DIGEST_X86_LANES; i++)
+      data[i] = i < n ? tail[i] : tail[0];
+    compress_x8 (state, data, blocks);
+
+    for (i = 0; i < n; i++) {
+      if (tailblocks[i] > blocks)
+        lane[i].compress (lane[i].state, tail[i] + blocks * R_SHA256_BLOCK_SIZE, 1);
+      if (!lane[i].md->get (lane[i].md, out + i * mdsize, mdsize, NULL))
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+#endif
+
+rboolean
+r_msg_digest_compute_multi (const RMsgDigest * init,
+    const RMemChunk * msgs, rsize count, ruint8 * out, rsize size)
+{
+  RMsgDigest * md;
+  rsize i, mdsize;
+
+  if (R_UNLIKELY (init == NULL || init->is_final || out == NULL))
+    return FALSE;
+  if (R_UNLIKELY (msgs == NULL && count > 0))
+    return FALSE;
+  if (R_UNLIKELY ((mdsize = r_msg_digest_size (init)) == 0 || size / mdsize < count))
+    return FALSE;
+
+#if defined (HAVE_X86_SHA)
+  /* Too few lanes in use and the single message code is faster */
+  if (init->multi_x8 && count >= R_MSG_DIGEST_X86_LANES / 2)
+    return r_msg_digest_compute_x8 (init, msgs, count, out);
+#endif
+
+  md = r_alloca (init->mdsize);
+  for (i = 0; i < count; i++, out += mdsize) {
+    r_memcpy (md, init, init->mdsize);
+    if ((msgs[i].size > 0 && !md->update (md, msgs[i].data, msgs[i].size)) ||
+        !md->final (md) || !md->get (md, out, mdsize, NULL))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
 rsize
 r_msg_digest_type_size (RMsgDigestType type)
 {
@@ -302,6 +581,8 @@ r_msg_digest_new_md5 (void)
     ret->final = r_md5_final;
     ret->update = r_md5_update;
     ret->get = r_md5_get;
+    ret->impl = R_MSG_DIGEST_IMPL_PORTABLE;
+    ret->multi_x8 = FALSE;
 
     ret->init (ret);
   }
@@ -534,6 +815,7 @@ r_msg_digest_new_sha1 (void)
     ret->final = r_sha1_final;
     ret->update = r_sha1_update;
     ret->get = r_sha1_get;
+    r_msg_digest_set_impl (ret, R_MSG_DIGEST_IMPL_AUTO);
 
     ret->init (ret);
   }
@@ -555,7 +837,7 @@ r_sha1_init (RMsgDigest * md)
 }
 
 static void
-r_sha1_update_block (RSha1 * sha1, const ruint8 * data)
+r_sha1_block (ruint32 * state, const ruint8 * data)
 {
   ruint32 a, b, c, d, e, x[R_SHA1_BLOCK_SIZE / sizeof (ruint32)];
   rsize i;
@@ -563,11 +845,11 @@ r_sha1_update_block (RSha1 * sha1, const ruint8 * data)
   for (i = 0; i < R_SHA1_BLOCK_SIZE / sizeof (ruint32); i++)
     x[i] = RUINT32_FROM_BE (((ruint32 *)data)[i]);
 
-  a = sha1->data[0];
-  b = sha1->data[1];
-  c = sha1->data[2];
-  d = sha1->data[3];
-  e = sha1->data[4];
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
 
 #define SHA1_W(w, t) \
   ((w)[(t) & 15] = RUINT32_ROTL ( \
@@ -675,11 +957,18 @@ r_sha1_update_block (RSha1 * sha1, const ruint8 * data)
 
 #undef SHA1_W
 
-  sha1->data[0] += a;
-  sha1->data[1] += b;
-  sha1->data[2] += c;
-  sha1->data[3] += d;
-  sha1->data[4] += e;
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+}
+
+static void
+r_sha1_compress (ruint32 * state, const ruint8 * data, rsize blocks)
+{
+  for (; blocks > 0; blocks--, data += R_SHA1_BLOCK_SIZE)
+    r_sha1_block (state, data);
 }
 
 static rboolean
@@ -701,7 +990,7 @@ r_sha1_update (RMsgDigest * md, rconstpointer data, rsize size)
       ptr += s;
       size -= s;
       sha1->bufsize = 0;
-      r_sha1_update_block (sha1, sha1->buffer);
+      sha1->compress (sha1->data, sha1->buffer, 1);
       r_memset (sha1->buffer, 0, sizeof (sha1->buffer));
     } else {
       r_memcpy (&sha1->buffer[sha1->bufsize], ptr, size);
@@ -710,9 +999,10 @@ r_sha1_update (RMsgDigest * md, rconstpointer data, rsize size)
     }
   }
 
-  for (; size >= R_SHA1_BLOCK_SIZE; size -= R_SHA1_BLOCK_SIZE) {
-    r_sha1_update_block (sha1, ptr);
-    ptr += R_SHA1_BLOCK_SIZE;
+  if (size >= R_SHA1_BLOCK_SIZE) {
+    sha1->compress (sha1->data, ptr, size / R_SHA1_BLOCK_SIZE);
+    ptr += size - (size % R_SHA1_BLOCK_SIZE);
+    size %= R_SHA1_BLOCK_SIZE;
   }
 
   if ((sha1->bufsize = size) > 0)
@@ -737,14 +1027,14 @@ r_sha1_final (RMsgDigest * md)
     rsize s = sizeof (sha1->buffer) - bufsize;
     r_memset (&ptr[bufsize], 0, s);
 
-    r_sha1_update_block (sha1, sha1->buffer);
+    sha1->compress (sha1->data, sha1->buffer, 1);
     r_memset (sha1->buffer, 0, sizeof (sha1->buffer));
     ptr = r_alloca0 (R_SHA1_BLOCK_SIZE);
   }
 
   *(ruint64 *)(&ptr[R_SHA1_BLOCK_SIZE - sizeof (ruint64)]) =
     RUINT64_TO_BE (sha1->len << 3);
-  r_sha1_update_block (sha1, ptr);
+  sha1->compress (sha1->data, ptr, 1);
   return TRUE;
 }
 
@@ -784,6 +1074,7 @@ r_msg_digest_new_sha224 (void)
     ret->final = r_sha256_final;
     ret->update = r_sha256_update;
     ret->get = r_sha224_get;
+    r_msg_digest_set_impl (ret, R_MSG_DIGEST_IMPL_AUTO);
 
     ret->init (ret);
   }
@@ -843,6 +1134,7 @@ r_msg_digest_new_sha256 (void)
     ret->final = r_sha256_final;
     ret->update = r_sha256_update;
     ret->get = r_sha256_get;
+    r_msg_digest_set_impl (ret, R_MSG_DIGEST_IMPL_AUTO);
 
     ret->init (ret);
   }
@@ -867,7 +1159,7 @@ r_sha256_init (RMsgDigest * md)
 }
 
 static void
-r_sha256_update_block (RSha256 * sha256, const ruint8 * data)
+r_sha256_block (ruint32 * state, const ruint8 * data)
 {
   ruint32 a, b, c, d, e, f, g, h;
   ruint32 x[R_SHA256_BLOCK_SIZE / sizeof (ruint32)];
@@ -876,14 +1168,14 @@ r_sha256_update_block (RSha256 * sha256, const ruint8 * data)
   for (i = 0; i < R_SHA256_BLOCK_SIZE / sizeof (ruint32); i++)
     x[i] = RUINT32_FROM_BE (((ruint32 *)data)[i]);
 
-  a = sha256->data[0];
-  b = sha256->data[1];
-  c = sha256->data[2];
-  d = sha256->data[3];
-  e = sha256->data[4];
-  f = sha256->data[5];
-  g = sha256->data[6];
-  h = sha256->data[7];
+  a = state[0];
+  b = state[1];
+  c = state[2];
+  d = state[3];
+  e = state[4];
+  f = state[5];
+  g = state[6];
+  h = state[7];
 
 #define SHA256_SIG0(x) (RUINT32_ROTR (x, 7) ^ RUINT32_ROTR (x,18) ^ RUINT32_SHR  (x, 3))
 #define SHA256_SIG1(x) (RUINT32_ROTR (x,17) ^ RUINT32_ROTR (x,19) ^ RUINT32_SHR  (x,10))
@@ -967,14 +1259,21 @@ r_sha256_update_block (RSha256 * sha256, const ruint8 * data)
 #undef SHA256_SIG1
 #undef SHA256_SIG0
 
-  sha256->data[0] += a;
-  sha256->data[1] += b;
-  sha256->data[2] += c;
-  sha256->data[3] += d;
-  sha256->data[4] += e;
-  sha256->data[5] += f;
-  sha256->data[6] += g;
-  sha256->data[7] += h;
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+static void
+r_sha256_compress (ruint32 * state, const ruint8 * data, rsize blocks)
+{
+  for (; blocks > 0; blocks--, data += R_SHA256_BLOCK_SIZE)
+    r_sha256_block (state, data);
 }
 
 static rboolean
@@ -993,14 +1292,14 @@ r_sha256_final (RMsgDigest * md)
     rsize s = sizeof (sha256->buffer) - bufsize;
     r_memset (&ptr[bufsize], 0, s);
 
-    r_sha256_update_block (sha256, sha256->buffer);
+    sha256->compress (sha256->data, sha256->buffer, 1);
     r_memset (sha256->buffer, 0, sizeof (sha256->buffer));
     ptr = r_alloca0 (R_SHA256_BLOCK_SIZE);
   }
 
   *(ruint64 *)(&ptr[R_SHA256_BLOCK_SIZE - sizeof (ruint64)]) =
     RUINT64_TO_BE (sha256->len << 3);
-  r_sha256_update_block (sha256, ptr);
+  sha256->compress (sha256->data, ptr, 1);
   return TRUE;
 }
 
@@ -1023,7 +1322,7 @@ r_sha256_update (RMsgDigest * md, rconstpointer data, rsize size)
       ptr += s;
       size -= s;
       sha256->bufsize = 0;
-      r_sha256_update_block (sha256, sha256->buffer);
+      sha256->compress (sha256->data, sha256->buffer, 1);
       r_memset (sha256->buffer, 0, sizeof (sha256->buffer));
     } else {
       r_memcpy (&sha256->buffer[sha256->bufsize], ptr, size);
@@ -1032,9 +1331,10 @@ r_sha256_update (RMsgDigest * md, rconstpointer data, rsize size)
     }
   }
 
-  for (; size >= R_SHA256_BLOCK_SIZE; size -= R_SHA256_BLOCK_SIZE) {
-    r_sha256_update_block (sha256, ptr);
-    ptr += R_SHA256_BLOCK_SIZE;
+  if (size >= R_SHA256_BLOCK_SIZE) {
+    sha256->compress (sha256->data, ptr, size / R_SHA256_BLOCK_SIZE);
+    ptr += size - (size % R_SHA256_BLOCK_SIZE);
+    size %= R_SHA256_BLOCK_SIZE;
   }
 
   if ((sha256->bufsize = size) > 0)
@@ -1079,6 +1379,8 @@ r_msg_digest_new_sha384 (void)
     ret->final = r_sha512_final;
     ret->update = r_sha512_update;
     ret->get = r_sha384_get;
+    ret->impl = R_MSG_DIGEST_IMPL_PORTABLE;
+    ret->multi_x8 = FALSE;
 
     ret->init (ret);
   }
@@ -1138,6 +1440,8 @@ r_msg_digest_new_sha512 (void)
     ret->final = r_sha512_final;
     ret->update = r_sha512_update;
     ret->get = r_sha512_get;
+    ret->impl = R_MSG_DIGEST_IMPL_PORTABLE;
+    ret->multi_x8 = FALSE;
 
     ret->init (ret);
   }
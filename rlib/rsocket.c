@@ -170,6 +170,14 @@ r_socket_get_keepalive (RSocket * socket)
   return ret;
 }
 
+rboolean
+r_socket_get_reuseport (RSocket * socket)
+{
+  rboolean ret = FALSE;
+  r_io_get_socket_reuseport (socket->handle, &ret);
+  return ret;
+}
+
 rboolean
 r_socket_get_multicast_loop (RSocket * socket)
 {
@@ -270,6 +278,27 @@ r_socket_set_keepalive (RSocket * socket, rboolean keepalive)
   return r_io_set_socket_keepalive (socket->handle, keepalive) == R_SOCKET_OK;
 }
 
+rboolean
+r_socket_set_reuseport (RSocket * socket, rboolean reuse)
+{
+  if (R_UNLIKELY (socket == NULL)) return FALSE;
+  return r_io_set_socket_reuseport (socket->handle, reuse) == R_SOCKET_OK;
+}
+
+rboolean
+r_socket_set_incoming_cpu (RSocket * socket, int cpu)
+{
+  if (R_UNLIKELY (socket == NULL)) return FALSE;
+  return r_io_set_socket_incoming_cpu (socket->handle, cpu) == R_SOCKET_OK;
+}
+
+rboolean
+r_socket_set_reuseport_cpus (RSocket * socket, const ruint * cpus, ruint count)
+{
+  if (R_UNLIKELY (socket == NULL)) return FALSE;
+  return r_io_set_socket_reuseport_cpus (socket->handle, cpus, count) == R_SOCKET_OK;
+}
+
 rboolean
 r_socket_set_multicast_loop (RSocket * socket, rboolean loop)
 {
@@ -355,10 +384,10 @@ r_socket_bind (RSocket * socket, const RSocketAddress * address, rboolean reuse)
   if (R_UNLIKELY (address == NULL)) return R_SOCKET_INVAL;
 
   r_io_set_socket_reuseaddr (socket->handle, reuse);
-#ifdef SO_REUSEPORT
-  r_io_set_socket_option (socket->handle, SOL_SOCKET, SO_REUSEPORT,
-      (reuse && socket->type == R_SOCKET_TYPE_DATAGRAM) ? 1 : 0);
-#endif
+  /* Stream sockets only share a port when explicitly asked to, see
+   * r_socket_set_reuseport (), so leave the option alone for those */
+  if (reuse && socket->type == R_SOCKET_TYPE_DATAGRAM)
+    r_io_set_socket_reuseport (socket->handle, TRUE);
 
   return r_io_socket_bind (socket->handle, address);
 }
@@ -481,3 +510,18 @@ r_socket_send_message (RSocket * socket, const RSocketAddress * address,
   return r_io_socket_send_message (socket->handle, address, buffer, sent);
 }
 
+RSocketStatus
+r_socket_receive_messages (RSocket * socket, RSocketAddress ** addresses,
+    RBuffer ** buffers, rsize * received, ruint count, ruint * msgs)
+{
+  return r_io_socket_receive_messages (socket->handle, addresses,
+      buffers, received, count, msgs);
+}
+
+RSocketStatus
+r_socket_send_messages (RSocket * socket, RSocketAddress * const * addresses,
+    RBuffer ** buffers, rsize * sent, ruint count, ruint * msgs)
+{
+  return r_io_socket_send_messages (socket->handle, addresses,
+      buffers, sent, count, msgs);
+}
@@ -28,11 +28,21 @@
 #include <rlib/rlog.h>
 #include <rlib/rthreadpool.h>
 
+#include <stddef.h>
+
 R_LOG_CATEGORY_DEFINE_STATIC (tqcat, "taskqueue", "RLib TaskQueue",
     R_CLR_BG_BLUE);
 #define R_LOG_CAT_DEFAULT &tqcat
 
 static RTss  g__r_task_queue_tss = R_TSS_INIT (NULL);
+static RTss  g__r_task_queue_worker_tss = R_TSS_INIT (NULL);
+
+/* Capacity of each worker deque (power of two), overflow goes to injection */
+#define R_TASK_QUEUE_DEQUE_SIZE       256
+/* Max number of injected tasks a thread moves to its deque at once */
+#define R_TASK_QUEUE_INJECT_BATCH     32
+/* Rounds of looking for work before an idle work stealing thread parks */
+#define R_TASK_QUEUE_IDLE_SPINS       64
 
 typedef enum {
   R_TASK_NONE     = 0x00,
@@ -42,9 +52,14 @@ typedef enum {
   R_TASK_CANCELED = 0xf1,
 } RTaskState;
 
+typedef struct {
+  raptr next;
+} RTQLink;
+
 struct _RTask {
   RRef ref;
-  RTaskState state;
+  rauint state;
+  RTQLink link;
 
   RTaskQueue * queue;
   ruint group;
@@ -52,28 +67,86 @@ struct _RTask {
   rpointer data;
   RDestroyNotify datanotify;
 
-  RSList * dep;
+  rauint pending;   /* Unfinished deps, plus one until queued */
+  raptr succ;       /* RSList of tasks depending on this one */
+  raptr waiters;    /* RSList of RTaskParker waiting for this one */
 };
 
+/* A waiting thread, woken once for every task it waits for finishing */
+typedef struct {
+  RRef ref;
+  RMutex mutex;
+  RCond cond;
+  ruint fired;
+} RTaskParker;
+
+/* succ and waiters of tasks that are done */
+static ruint8 g__r_task_succ_closed;
+#define R_TASK_SUCC_CLOSED    ((rpointer)&g__r_task_succ_closed)
+#define R_TASK_WAITERS_CLOSED ((rpointer)&g__r_task_succ_closed)
+
+static void
+r_task_parker_free (RTaskParker * parker)
+{
+  r_cond_clear (&parker->cond);
+  r_mutex_clear (&parker->mutex);
+  r_free (parker);
+}
+
+/* Parker of the current thread, kept for the next wait */
+static RTss g__r_task_parker_tss = R_TSS_INIT (r_ref_unref);
+
+#define r_tq_link_task(l) ((RTask *)((ruint8 *)(l) - offsetof (RTask, link)))
+
+typedef struct _RTQWorker RTQWorker;
+
 typedef struct {
   RQueue *  q;
   rboolean  running;
   RCond     cond;
   RMutex    mutex;
   ruint     threads;
+
+  /* Work stealing */
+  ruint     idx;
+  raptr     inject_head;  /* Intrusive MPSC FIFO of RTask::link */
+  raptr     inject_tail;  /* Only changed while holding inject_busy */
+  RTQLink   inject_stub;
+  rauint    inject_busy;
+  raptr     workers;      /* RTQWorker list, only ever prepended to */
+  rauint    wcount;
 } RTQCtx;
 
+/* Chase-Lev deque of one work stealing thread. The owner pushes and pops at
+ * the bottom, others steal from the top. */
+struct _RTQWorker {
+  RTaskQueue * queue;
+  RTQCtx * ctx;
+  RTQWorker * next;
+  ruint32 rnd;
+
+  rauint top;
+  ruint8 pad[64 - sizeof (rauint)];
+  rauint bottom;
+  raptr tasks[R_TASK_QUEUE_DEQUE_SIZE];
+};
+
 struct _RTaskQueue {
   RRef ref;
 
   RThreadPool * pool;
   RDestroyNotify stop;
-
-  RCond   wait_cond;
-  RMutex  wait_mutex;
+  RTaskQueueFlags flags;
 
   ruint ctxcount;
   RTQCtx * ctx;
+
+  /* Work stealing */
+  rauint  running;
+  rauint  queued;
+  rauint  sleepers;
+  RCond   idle_cond;
+  RMutex  idle_mutex;
 };
 
 
@@ -85,6 +158,8 @@ r_task_queue_init (void)
 
 
 static rpointer r_task_queue_loop (rpointer data, rpointer spec);
+static rpointer r_task_queue_ws_loop (rpointer data, rpointer spec);
+static void r_task_queue_ws_push (RTaskQueue * queue, RTask * task);
 
 rboolean
 r_task_add_dep (RTask * task, RTask * dep, ...)
@@ -102,47 +177,146 @@ r_task_add_dep (RTask * task, RTask * dep, ...)
 rboolean
 r_task_add_dep_v (RTask * task, RTask * dep, va_list args)
 {
+  if (R_UNLIKELY (r_atomic_uint_load (&task->state) != R_TASK_NONE))
+    return FALSE;
+
   for (; dep != NULL; dep = va_arg (args, RTask *)) {
-    if (R_UNLIKELY (dep->state < R_TASK_QUEUED))
+    RSList * lnk, * head;
+
+    if (R_UNLIKELY (r_atomic_uint_load (&dep->state) < R_TASK_QUEUED))
       return FALSE;
-    task->dep = r_slist_prepend (task->dep, r_task_ref (dep));
+    if (R_UNLIKELY ((lnk = r_slist_alloc_copy (task)) == NULL))
+      return FALSE;
+
+    /* dep might finish and release it as soon as it is linked */
+    r_task_ref (task);
+    r_atomic_uint_fetch_add (&task->pending, 1);
+    head = r_atomic_ptr_load (&dep->succ);
+    do {
+      if (head == R_TASK_SUCC_CLOSED) {
+        /* dep is already done */
+        r_atomic_uint_fetch_sub (&task->pending, 1);
+        r_slist_free1_full (lnk, r_task_unref);
+        break;
+      }
+      lnk->next = head;
+    } while (!r_atomic_ptr_cmp_xchg_weak (&dep->succ, &head, lnk));
+  }
+
+  return TRUE;
+}
+
+static RTaskParker *
+r_task_parker_get (void)
+{
+  RTaskParker * ret;
+
+  if ((ret = r_tss_get (&g__r_task_parker_tss)) != NULL) {
+    r_tss_set (&g__r_task_parker_tss, NULL);
+  } else if ((ret = r_mem_new (RTaskParker)) != NULL) {
+    r_ref_init (ret, r_task_parker_free);
+    r_mutex_init (&ret->mutex);
+    r_cond_init (&ret->cond);
+  } else {
+    return NULL;
+  }
+
+  ret->fired = 0;
+  return ret;
+}
+
+static void
+r_task_parker_put (RTaskParker * parker)
+{
+  /* Only reusable when no task still has it in its waiter list */
+  if (r_ref_refcount (parker) == 1 && r_tss_get (&g__r_task_parker_tss) == NULL)
+    r_tss_set (&g__r_task_parker_tss, parker);
+  else
+    r_ref_unref (parker);
+}
+
+static void
+r_task_parker_park (RTaskParker * parker, ruint fired)
+{
+  r_mutex_lock (&parker->mutex);
+  while (parker->fired < fired)
+    r_cond_wait (&parker->cond, &parker->mutex);
+  r_mutex_unlock (&parker->mutex);
+}
+
+/* FALSE if the task has finished already */
+static rboolean
+r_task_add_waiter (RTask * task, RTaskParker * parker)
+{
+  RSList * lnk, * head = r_atomic_ptr_load (&task->waiters);
+
+  if (head == R_TASK_WAITERS_CLOSED)
+    return FALSE;
+  if (R_UNLIKELY ((lnk = r_slist_alloc_copy (r_ref_ref (parker))) == NULL)) {
+    r_ref_unref (parker);
+    return FALSE;
   }
 
+  do {
+    if (head == R_TASK_WAITERS_CLOSED) {
+      r_slist_free1_full (lnk, r_ref_unref);
+      return FALSE;
+    }
+    lnk->next = head;
+  } while (!r_atomic_ptr_cmp_xchg_weak (&task->waiters, &head, lnk));
+
   return TRUE;
 }
 
+/* Called once state is DONE or CANCELED, wakes whoever is waiting */
+static void
+r_task_notify_waiters (RTask * task)
+{
+  RSList * waiters, * it;
+
+  waiters = r_atomic_ptr_exchange (&task->waiters, R_TASK_WAITERS_CLOSED);
+  if (waiters == R_TASK_WAITERS_CLOSED)
+    return;
+
+  for (it = waiters; it != NULL; it = it->next) {
+    RTaskParker * parker = it->data;
+    r_mutex_lock (&parker->mutex);
+    parker->fired++;
+    r_cond_signal (&parker->cond);
+    r_mutex_unlock (&parker->mutex);
+  }
+  r_slist_destroy_full (waiters, r_ref_unref);
+}
+
 rboolean
 r_task_cancel (RTask * task, rboolean wait_if_running)
 {
-  RTQCtx * ctx;
-  rboolean ret;
+  ruint state;
 
   if (R_UNLIKELY (task == NULL || task->queue == NULL)) return FALSE;
 
-  ctx = &task->queue->ctx[task->group];
+  if (wait_if_running && r_task_queue_current () != NULL)
+    wait_if_running = FALSE;
 
-  r_mutex_lock (&(ctx)->mutex);
-  if ((ret = (task->state >= R_TASK_QUEUED))) {
-    if (wait_if_running && r_task_queue_current () == NULL &&
-        task->state == R_TASK_RUNNING) {
-      r_mutex_unlock (&(ctx)->mutex);
+  /* Threads only move a task from QUEUED to RUNNING with a cmp_xchg */
+  state = r_atomic_uint_load (&task->state);
+  if (state < R_TASK_QUEUED)
+    return FALSE;
+  while (state < R_TASK_DONE) {
+    if (state == R_TASK_RUNNING && wait_if_running) {
       r_task_wait (task);
-      r_mutex_lock (&(ctx)->mutex);
-    }
-    if (task->state < R_TASK_DONE) {
-      r_mutex_lock (&task->queue->wait_mutex);
-      task->state = R_TASK_CANCELED;
-      r_cond_broadcast (&task->queue->wait_cond);
-      r_mutex_unlock (&task->queue->wait_mutex);
+      state = r_atomic_uint_load (&task->state);
+    } else if (r_atomic_uint_cmp_xchg_strong (&task->state, &state, R_TASK_CANCELED)) {
+      r_task_notify_waiters (task);
+      break;
     }
   }
-  r_mutex_unlock (&(ctx)->mutex);
 
-  return ret;
+  return TRUE;
 }
 
-rboolean
-r_task_wait (RTask * task)
+static rboolean
+r_task_check_wait (RTask * task)
 {
   if (R_UNLIKELY (task == NULL || task->queue == NULL)) return FALSE;
   if (R_UNLIKELY (r_task_queue_current () != NULL)) {
@@ -151,14 +325,81 @@ r_task_wait (RTask * task)
     return FALSE;
   }
 
-  r_mutex_lock (&task->queue->wait_mutex);
-  while (task->state < R_TASK_DONE)
-    r_cond_wait (&task->queue->wait_cond, &task->queue->wait_mutex);
-  r_mutex_unlock (&task->queue->wait_mutex);
+  return TRUE;
+}
+
+rboolean
+r_task_wait (RTask * task)
+{
+  RTaskParker * parker;
+
+  if (R_UNLIKELY (!r_task_check_wait (task))) return FALSE;
+  if (r_atomic_uint_load (&task->state) >= R_TASK_DONE) return TRUE;
+
+  if (R_UNLIKELY ((parker = r_task_parker_get ()) == NULL)) return FALSE;
+  if (r_task_add_waiter (task, parker))
+    r_task_parker_park (parker, 1);
+  r_task_parker_put (parker);
+
+  return TRUE;
+}
+
+rboolean
+r_task_wait_many (RTask ** tasks, rsize count)
+{
+  RTaskParker * parker;
+  ruint pending = 0;
+  rsize i;
+
+  for (i = 0; i < count; i++) {
+    if (R_UNLIKELY (!r_task_check_wait (tasks[i]))) return FALSE;
+  }
+
+  if (R_UNLIKELY ((parker = r_task_parker_get ()) == NULL)) return FALSE;
+  for (i = 0; i < count; i++) {
+    if (r_atomic_uint_load (&tasks[i]->state) < R_TASK_DONE &&
+        r_task_add_waiter (tasks[i], parker))
+      pending++;
+  }
+  if (pending > 0)
+    r_task_parker_park (parker, pending);
+  r_task_parker_put (parker);
 
   return TRUE;
 }
 
+rssize
+r_task_wait_any (RTask ** tasks, rsize count)
+{
+  RTaskParker * parker;
+  rsize i;
+
+  for (i = 0; i < count; i++) {
+    if (R_UNLIKELY (!r_task_check_wait (tasks[i]))) return -1;
+    if (r_atomic_uint_load (&tasks[i]->state) >= R_TASK_DONE)
+      return (rssize)i;
+  }
+  if (R_UNLIKELY (count == 0)) return -1;
+
+  if (R_UNLIKELY ((parker = r_task_parker_get ()) == NULL)) return -1;
+  for (i = 0; i < count; i++) {
+    if (!r_task_add_waiter (tasks[i], parker))
+      break;
+  }
+  if (i == count)
+    r_task_parker_park (parker, 1);
+  /* The other tasks keep their reference to parker until they finish */
+  r_task_parker_put (parker);
+
+  for (i = 0; i < count; i++) {
+    if (r_atomic_uint_load (&tasks[i]->state) >= R_TASK_DONE)
+      return (rssize)i;
+  }
+
+  r_assert_not_reached ();
+  return -1;
+}
+
 static void
 r_task_queue_free (RTaskQueue * queue)
 {
@@ -172,18 +413,39 @@ r_task_queue_free (RTaskQueue * queue)
       r_cond_broadcast (&queue->ctx[i].cond);
       r_mutex_unlock (&queue->ctx[i].mutex);
     }
+    r_mutex_lock (&queue->idle_mutex);
+    r_atomic_uint_store (&queue->running, FALSE);
+    r_cond_broadcast (&queue->idle_cond);
+    r_mutex_unlock (&queue->idle_mutex);
 
     r_thread_pool_join (queue->pool);
     r_thread_pool_unref (queue->pool);
 
     for (i = 0; i < queue->ctxcount; i++) {
+      RTQWorker * w, * wnext;
+      RTQLink * l, * lnext;
+
+      for (w = r_atomic_ptr_load (&queue->ctx[i].workers); w != NULL; w = wnext) {
+        ruint b = r_atomic_uint_load (&w->bottom);
+        ruint top;
+        for (top = r_atomic_uint_load (&w->top); top != b; top++)
+          r_task_unref (r_atomic_ptr_load (&w->tasks[top & (R_TASK_QUEUE_DEQUE_SIZE - 1)]));
+        wnext = w->next;
+        r_free (w);
+      }
+      for (l = r_atomic_ptr_load (&queue->ctx[i].inject_tail); l != NULL; l = lnext) {
+        lnext = r_atomic_ptr_load (&l->next);
+        if (l != &queue->ctx[i].inject_stub)
+          r_task_unref (r_tq_link_task (l));
+      }
+
       r_queue_free (queue->ctx[i].q, r_task_unref);
       r_cond_clear (&queue->ctx[i].cond);
       r_mutex_clear (&queue->ctx[i].mutex);
     }
 
-    r_cond_clear (&queue->wait_cond);
-    r_mutex_clear (&queue->wait_mutex);
+    r_cond_clear (&queue->idle_cond);
+    r_mutex_clear (&queue->idle_mutex);
 
     r_free (queue->ctx);
     r_free (queue);
@@ -191,7 +453,7 @@ r_task_queue_free (RTaskQueue * queue)
 }
 
 static RTaskQueue *
-r_task_queue_alloc (rsize ctxcount)
+r_task_queue_alloc (rsize ctxcount, RTaskQueueFlags flags)
 {
   RTaskQueue * ret;
 
@@ -199,8 +461,12 @@ r_task_queue_alloc (rsize ctxcount)
     ruint i;
     r_ref_init (ret, r_task_queue_free);
 
-    r_mutex_init (&ret->wait_mutex);
-    r_cond_init (&ret->wait_cond);
+    r_mutex_init (&ret->idle_mutex);
+    r_cond_init (&ret->idle_cond);
+    r_atomic_uint_store (&ret->running, TRUE);
+    r_atomic_uint_store (&ret->queued, 0);
+    r_atomic_uint_store (&ret->sleepers, 0);
+    ret->flags = flags;
 
     ret->ctxcount = ctxcount;
     ret->ctx = r_mem_new_n (RTQCtx, ctxcount);
@@ -211,9 +477,18 @@ r_task_queue_alloc (rsize ctxcount)
       ret->ctx[i].threads = 0;
       r_mutex_init (&ret->ctx[i].mutex);
       r_cond_init (&ret->ctx[i].cond);
+      ret->ctx[i].idx = i;
+      r_atomic_ptr_store (&ret->ctx[i].inject_stub.next, NULL);
+      r_atomic_ptr_store (&ret->ctx[i].inject_head, &ret->ctx[i].inject_stub);
+      r_atomic_ptr_store (&ret->ctx[i].inject_tail, &ret->ctx[i].inject_stub);
+      r_atomic_uint_store (&ret->ctx[i].inject_busy, FALSE);
+      r_atomic_ptr_store (&ret->ctx[i].workers, NULL);
+      r_atomic_uint_store (&ret->ctx[i].wcount, 0);
     }
 
-    ret->pool = r_thread_pool_new ("taskqueue", r_task_queue_loop, ret);
+    ret->pool = r_thread_pool_new ("taskqueue",
+        (flags & R_TASK_QUEUE_FLAG_WORK_STEALING) ?
+        r_task_queue_ws_loop : r_task_queue_loop, ret);
   }
 
   return ret;
@@ -221,14 +496,14 @@ r_task_queue_alloc (rsize ctxcount)
 
 
 RTaskQueue *
-r_task_queue_new (ruint groups, ruint threads_per_group)
+r_task_queue_new_full (ruint groups, ruint threads_per_group, RTaskQueueFlags flags)
 {
   RTaskQueue * ret;
 
   if (R_UNLIKELY (groups == 0)) return NULL;
   if (R_UNLIKELY (threads_per_group == 0)) return NULL;
 
-  if ((ret = r_task_queue_alloc (groups)) != NULL) {
+  if ((ret = r_task_queue_alloc (groups, flags)) != NULL) {
     ruint g, t;
     for (g = 0; g < groups; g++) {
       for (t = 0; t < threads_per_group; t++) {
@@ -241,7 +516,8 @@ r_task_queue_new (ruint groups, ruint threads_per_group)
 }
 
 RTaskQueue *
-r_task_queue_new_pin_and_group_on_numa_node (const RBitset * nodeset, ruint threads_per_group)
+r_task_queue_new_pin_and_group_on_numa_node_full (const RBitset * nodeset,
+    ruint threads_per_group, RTaskQueueFlags flags)
 {
   RTaskQueue * ret;
   RBitset * cpuset, * cpuset_allowed, * nodeset_allowed;
@@ -259,7 +535,7 @@ r_task_queue_new_pin_and_group_on_numa_node (const RBitset * nodeset, ruint thre
     r_bitset_and (nodeset_allowed, nodeset_allowed, nodeset);
   if (R_UNLIKELY ((groups = r_bitset_popcount (nodeset_allowed)) == 0)) return NULL;
 
-  if ((ret = r_task_queue_alloc (groups)) != NULL) {
+  if ((ret = r_task_queue_alloc (groups, flags)) != NULL) {
     for (i = g = 0; i < nodeset_allowed->bits; i++) {
       r_bitset_clear (cpuset);
       if (r_bitset_is_bit_set (nodeset_allowed, i) &&
@@ -296,7 +572,7 @@ r_task_queue_new_pin_on_cpu_group_numa_node (const RBitset * nodeset)
     r_bitset_and (nodeset_allowed, nodeset_allowed, nodeset);
   if (R_UNLIKELY ((groups = r_bitset_popcount (nodeset_allowed)) == 0)) return NULL;
 
-  if ((ret = r_task_queue_alloc (groups)) != NULL) {
+  if ((ret = r_task_queue_alloc (groups, R_TASK_QUEUE_FLAG_NONE)) != NULL) {
     for (i = g = 0; i < nodeset_allowed->bits; i++) {
       r_bitset_clear (cpuset);
       if (r_bitset_is_bit_set (nodeset_allowed, i) &&
@@ -326,7 +602,7 @@ r_task_queue_new_pin_on_each_cpu (const RBitset * cpuset, ruint groups)
   if (groups > r_bitset_popcount (cpuset_allowed))
     groups = r_bitset_popcount (cpuset_allowed);
 
-  if ((ret = r_task_queue_alloc (groups)) != NULL) {
+  if ((ret = r_task_queue_alloc (groups, R_TASK_QUEUE_FLAG_NONE)) != NULL) {
     rsize i;
     for (i = 0; i < cpuset_allowed->bits; i++) {
       if (r_bitset_is_bit_set (cpuset_allowed, i))
@@ -356,7 +632,7 @@ r_task_queue_new_pin_on_each_cpu_group_numa_node (const RBitset * cpuset)
   if (R_UNLIKELY (!r_sys_nodeset_for_cpuset (nodeset_allowed, cpuset_allowed))) return NULL;
   if (R_UNLIKELY ((groups = r_bitset_popcount (nodeset_allowed)) == 0)) return NULL;
 
-  if ((ret = r_task_queue_alloc (groups)) != NULL) {
+  if ((ret = r_task_queue_alloc (groups, R_TASK_QUEUE_FLAG_NONE)) != NULL) {
     for (i = g = 0; i < nodeset_allowed->bits; i++) {
       r_bitset_clear (cpuset_node);
       if (r_bitset_is_bit_set (nodeset_allowed, i) &&
@@ -381,9 +657,15 @@ static void
 r_task_free (RTask * task)
 {
   if (R_LIKELY (task != NULL)) {
+    RSList * succ = r_atomic_ptr_load (&task->succ), * waiters;
+
     if (task->datanotify != NULL)
       task->datanotify (task->data);
-    r_slist_destroy_full (task->dep, r_task_unref);
+    /* Never ran, so the tasks depending on it never will either */
+    if (succ != R_TASK_SUCC_CLOSED)
+      r_slist_destroy_full (succ, r_task_unref);
+    if ((waiters = r_atomic_ptr_load (&task->waiters)) != R_TASK_WAITERS_CLOSED)
+      r_slist_destroy_full (waiters, r_ref_unref);
     r_free (task);
   }
 }
@@ -402,34 +684,77 @@ r_task_queue_allocate (RTaskQueue * queue, RTaskFunc func,
     ret->func = func;
     ret->data = data;
     ret->datanotify = datanotify;
+    r_atomic_uint_store (&ret->pending, 1);
+    r_atomic_ptr_store (&ret->succ, NULL);
+    r_atomic_ptr_store (&ret->waiters, NULL);
   }
 
   return ret;
 }
 
-rboolean
-r_task_queue_add_task_with_group (RTaskQueue * queue,
-    RTask * task, ruint group)
+/* Queues a task with all dependencies done */
+static void
+r_task_queue_push_ready (RTaskQueue * queue, RTask * task)
 {
   RTQCtx * ctx;
 
-  if (R_UNLIKELY (queue == NULL)) return FALSE;
-  if (R_UNLIKELY (task == NULL)) return FALSE;
-  if (R_UNLIKELY (task->queue != queue)) return FALSE;
-  if (group == RUINT_MAX) group = 0;
-  else if (R_UNLIKELY (group >= queue->ctxcount)) return FALSE;
+  if (queue->flags & R_TASK_QUEUE_FLAG_WORK_STEALING) {
+    r_task_queue_ws_push (queue, task);
+    return;
+  }
 
-  ctx = &queue->ctx[group];
+  ctx = &queue->ctx[task->group];
   r_mutex_lock (&ctx->mutex);
   if (ctx->threads > 0)
-    R_LOG_DEBUG ("TQ: %p [%u] - push task %p", queue, group, task);
+    R_LOG_DEBUG ("TQ: %p [%u] - push task %p", queue, task->group, task);
   else
-    R_LOG_WARNING ("TQ: %p [%u] - push task %p (no threads)", queue, group, task);
-  task->group = group;
-  task->state = R_TASK_QUEUED;
+    R_LOG_WARNING ("TQ: %p [%u] - push task %p (no threads)", queue, task->group, task);
   r_queue_push (ctx->q, r_task_ref (task));
   r_cond_signal (&ctx->cond);
   r_mutex_unlock (&ctx->mutex);
+}
+
+/* Releases the tasks depending on a task which just finished */
+static void
+r_task_queue_task_finished (RTask * task)
+{
+  RSList * succ, * it;
+
+  succ = r_atomic_ptr_exchange (&task->succ, R_TASK_SUCC_CLOSED);
+  for (it = succ; it != NULL; it = it->next) {
+    RTask * s = it->data;
+    if (r_atomic_uint_fetch_sub (&s->pending, 1) == 1)
+      r_task_queue_push_ready (s->queue, s);
+  }
+  r_slist_destroy_full (succ, r_task_unref);
+}
+
+rboolean
+r_task_queue_add_task_with_group (RTaskQueue * queue,
+    RTask * task, ruint group)
+{
+  ruint state = R_TASK_NONE;
+
+  if (R_UNLIKELY (queue == NULL)) return FALSE;
+  if (R_UNLIKELY (task == NULL)) return FALSE;
+  if (R_UNLIKELY (task->queue != queue)) return FALSE;
+  if (group == RUINT_MAX) {
+    RTQWorker * w = r_tss_get (&g__r_task_queue_worker_tss);
+    group = (w != NULL && w->queue == queue) ? w->ctx->idx : 0;
+  } else if (R_UNLIKELY (group >= queue->ctxcount)) {
+    return FALSE;
+  }
+
+  task->group = group;
+  if (R_UNLIKELY (!r_atomic_uint_cmp_xchg_strong (&task->state, &state, R_TASK_QUEUED)))
+    return FALSE;
+
+  /* Drop the hold taken at allocation, the last dependency to finish
+   * queues it otherwise */
+  if (r_atomic_uint_fetch_sub (&task->pending, 1) == 1)
+    r_task_queue_push_ready (queue, task);
+  else
+    R_LOG_DEBUG ("TQ: %p [%u] - task %p waiting for deps", queue, group, task);
 
   return TRUE;
 }
@@ -466,27 +791,6 @@ r_task_queue_add_full_v (RTaskQueue * queue, ruint group,
   return ret;
 }
 
-static RTask *
-r_task_queue_ctx_pop_locked (RTQCtx * ctx)
-{
-  RTask * t, * dep;
-
-  /* FIXME: Traverse the queue internally to pick the first task with all
-   * deps satisfied ?? */
-  if ((t = r_queue_peek (ctx->q)) != NULL) {
-    RSList * it;
-    for (it = t->dep; it != NULL; it = it->next) {
-      dep = it->data;
-      if (dep->state < R_TASK_DONE)
-        return NULL;
-    }
-
-    return r_queue_pop (ctx->q);
-  }
-
-  return NULL;
-}
-
 static rpointer
 r_task_queue_loop (rpointer common, rpointer spec)
 {
@@ -505,32 +809,23 @@ r_task_queue_loop (rpointer common, rpointer spec)
   r_mutex_lock (&(ctx)->mutex);
   ctx->threads++;
   while (ctx->running) {
-    if (R_LIKELY ((task = r_task_queue_ctx_pop_locked (ctx)) != NULL)) {
-      RSList * dep = task->dep;
-      task->dep = NULL;
-      if (task->state == R_TASK_QUEUED) {
-        task->state = R_TASK_RUNNING;
-        r_mutex_unlock (&(ctx)->mutex);
-        {
-          r_slist_destroy_full (dep, r_task_unref);
-          R_LOG_TRACE ("TQ: %p [%p] - process task %p", queue, ctx, task);
-          task->func (task->data, queue, task);
-        }
-        r_mutex_lock (&(ctx)->mutex);
-        r_mutex_lock (&queue->wait_mutex);
-        task->state = R_TASK_DONE;
-        r_cond_broadcast (&queue->wait_cond);
-        r_mutex_unlock (&queue->wait_mutex);
+    /* Only tasks with all dependencies done are ever queued */
+    if (R_LIKELY ((task = r_queue_pop (ctx->q)) != NULL)) {
+      ruint state = R_TASK_QUEUED;
+      r_mutex_unlock (&(ctx)->mutex);
+      if (r_atomic_uint_cmp_xchg_strong (&task->state, &state, R_TASK_RUNNING)) {
+        R_LOG_TRACE ("TQ: %p [%p] - process task %p", queue, ctx, task);
+        task->func (task->data, queue, task);
+
+        r_atomic_uint_store (&task->state, R_TASK_DONE);
+        r_task_notify_waiters (task);
       } else {
         R_LOG_DEBUG ("TQ: %p [%p] - process task %p - not queued 0x%.2x",
-            queue, ctx, task, task->state);
-        if (dep != NULL) {
-          r_mutex_unlock (&(ctx)->mutex);
-          r_slist_destroy_full (dep, r_task_unref);
-          r_mutex_lock (&(ctx)->mutex);
-        }
+            queue, ctx, task, state);
       }
+      r_task_queue_task_finished (task);
       r_task_unref (task);
+      r_mutex_lock (&(ctx)->mutex);
     } else {
       R_LOG_TRACE ("TQ: %p [%p] - wait", queue, ctx);
       r_cond_wait (&(ctx)->cond, &(ctx)->mutex);
@@ -544,12 +839,307 @@ r_task_queue_loop (rpointer common, rpointer spec)
   return NULL;
 }
 
+/******************************************************************************/
+/* Work stealing                                                              */
+/******************************************************************************/
+static rboolean
+r_tq_worker_push (RTQWorker * w, RTask * task)
+{
+  ruint b = r_atomic_uint_load (&w->bottom);
+
+  if (b - r_atomic_uint_load (&w->top) >= R_TASK_QUEUE_DEQUE_SIZE)
+    return FALSE;
+
+  r_atomic_ptr_store (&w->tasks[b & (R_TASK_QUEUE_DEQUE_SIZE - 1)], task);
+  r_atomic_uint_store (&w->bottom, b + 1);
+  return TRUE;
+}
+
+static RTask *
+r_tq_worker_pop (RTQWorker * w)
+{
+  ruint b = r_atomic_uint_load (&w->bottom) - 1;
+  ruint top;
+  RTask * ret;
+
+  r_atomic_uint_store (&w->bottom, b);
+  top = r_atomic_uint_load (&w->top);
+  if ((int)(b - top) < 0) {
+    r_atomic_uint_store (&w->bottom, b + 1);
+    return NULL;
+  }
+
+  ret = r_atomic_ptr_load (&w->tasks[b & (R_TASK_QUEUE_DEQUE_SIZE - 1)]);
+  if (b == top) {
+    /* Last one, race against thieves */
+    if (!r_atomic_uint_cmp_xchg_strong (&w->top, &top, top + 1))
+      ret = NULL;
+    r_atomic_uint_store (&w->bottom, b + 1);
+  }
+
+  return ret;
+}
+
+static RTask *
+r_tq_worker_steal (RTQWorker * w)
+{
+  ruint top = r_atomic_uint_load (&w->top);
+  RTask * ret;
+
+  if ((int)(r_atomic_uint_load (&w->bottom) - top) <= 0)
+    return NULL;
+
+  ret = r_atomic_ptr_load (&w->tasks[top & (R_TASK_QUEUE_DEQUE_SIZE - 1)]);
+  return r_atomic_uint_cmp_xchg_strong (&w->top, &top, top + 1) ? ret : NULL;
+}
+
+static void
+r_tq_ctx_inject_link (RTQCtx * ctx, RTQLink * link)
+{
+  RTQLink * prev;
+
+  r_atomic_ptr_store (&link->next, NULL);
+  prev = r_atomic_ptr_exchange (&ctx->inject_head, link);
+  r_atomic_ptr_store (&prev->next, link);
+}
+
+#define r_tq_ctx_inject(ctx, task) r_tq_ctx_inject_link (ctx, &(task)->link)
+
+/* Consumer side of the injection queue, inject_busy must be held */
+static RTask *
+r_tq_ctx_inject_pop (RTQCtx * ctx)
+{
+  RTQLink * tail = r_atomic_ptr_load (&ctx->inject_tail);
+  RTQLink * next = r_atomic_ptr_load (&tail->next);
+
+  if (tail == &ctx->inject_stub) {
+    if (next == NULL)
+      return NULL;
+    r_atomic_ptr_store (&ctx->inject_tail, next);
+    tail = next;
+    next = r_atomic_ptr_load (&tail->next);
+  }
+
+  if (next == NULL) {
+    /* Last one, requeue the stub behind it unless a push is in progress */
+    if (tail != r_atomic_ptr_load (&ctx->inject_head))
+      return NULL;
+    r_tq_ctx_inject_link (ctx, &ctx->inject_stub);
+    if ((next = r_atomic_ptr_load (&tail->next)) == NULL)
+      return NULL;
+  }
+
+  r_atomic_ptr_store (&ctx->inject_tail, next);
+  return r_tq_link_task (tail);
+}
+
+/* Returns the oldest injected task and moves a batch of the following ones
+ * to the local deque. Only one thread at a time consumes from a group,
+ * others just move on to stealing. */
+static RTask *
+r_tq_ctx_take_injected (RTQCtx * ctx, RTQWorker * w)
+{
+  RTask * batch[R_TASK_QUEUE_INJECT_BATCH];
+  ruint busy = FALSE, n, max;
+
+  /* Empty, nothing but the stub queued */
+  if ((r_atomic_ptr_load (&ctx->inject_tail) == &ctx->inject_stub &&
+        r_atomic_ptr_load (&ctx->inject_head) == &ctx->inject_stub) ||
+      !r_atomic_uint_cmp_xchg_strong (&ctx->inject_busy, &busy, TRUE))
+    return NULL;
+
+  max = R_TASK_QUEUE_DEQUE_SIZE -
+    (r_atomic_uint_load (&w->bottom) - r_atomic_uint_load (&w->top)) + 1;
+  if (max > R_N_ELEMENTS (batch))
+    max = R_N_ELEMENTS (batch);
+  for (n = 0; n < max && (batch[n] = r_tq_ctx_inject_pop (ctx)) != NULL; n++);
+  r_atomic_uint_store (&ctx->inject_busy, FALSE);
+
+  if (n == 0)
+    return NULL;
+  /* Newest first, so that the local pops are FIFO */
+  while (--n > 0) {
+    if (!r_tq_worker_push (w, batch[n]))
+      r_tq_ctx_inject (ctx, batch[n]);
+  }
+  return batch[0];
+}
+
+static RTask *
+r_tq_ctx_steal (RTQCtx * ctx, RTQWorker * self)
+{
+  RTQWorker * first, * start, * w;
+  ruint n, skip;
+  RTask * ret;
+
+  if ((n = r_atomic_uint_load (&ctx->wcount)) == 0)
+    return NULL;
+
+  /* Random victim to start with, then everyone after and before it */
+  self->rnd ^= self->rnd << 13;
+  self->rnd ^= self->rnd >> 17;
+  self->rnd ^= self->rnd << 5;
+  first = r_atomic_ptr_load (&ctx->workers);
+  for (start = first, skip = self->rnd % n; skip > 0 && start->next != NULL; skip--)
+    start = start->next;
+
+  for (w = start; w != NULL; w = w->next) {
+    if (w != self && (ret = r_tq_worker_steal (w)) != NULL)
+      return ret;
+  }
+  for (w = first; w != start; w = w->next) {
+    if (w != self && (ret = r_tq_worker_steal (w)) != NULL)
+      return ret;
+  }
+
+  return NULL;
+}
+
+static RTask *
+r_task_queue_ws_find (RTaskQueue * queue, RTQWorker * w)
+{
+  RTask * ret;
+  ruint i;
+
+  if ((ret = r_tq_worker_pop (w)) != NULL)
+    return ret;
+  if ((ret = r_tq_ctx_take_injected (w->ctx, w)) != NULL)
+    return ret;
+  if ((ret = r_tq_ctx_steal (w->ctx, w)) != NULL)
+    return ret;
+
+  for (i = 1; i < queue->ctxcount; i++) {
+    RTQCtx * ctx = &queue->ctx[(w->ctx->idx + i) % queue->ctxcount];
+    if ((ret = r_tq_ctx_take_injected (ctx, w)) != NULL)
+      return ret;
+    if ((ret = r_tq_ctx_steal (ctx, w)) != NULL)
+      return ret;
+  }
+
+  return NULL;
+}
+
+static void
+r_task_queue_ws_wake (RTaskQueue * queue)
+{
+  if (r_atomic_uint_load (&queue->sleepers) > 0) {
+    r_mutex_lock (&queue->idle_mutex);
+    r_cond_signal (&queue->idle_cond);
+    r_mutex_unlock (&queue->idle_mutex);
+  }
+}
+
+static void
+r_task_queue_ws_push (RTaskQueue * queue, RTask * task)
+{
+  RTQWorker * w = r_tss_get (&g__r_task_queue_worker_tss);
+
+  if (w != NULL && w->queue != queue)
+    w = NULL;
+
+  R_LOG_DEBUG ("TQ: %p [%u] - push task %p%s", queue, task->group, task,
+      w != NULL ? " (local)" : "");
+  r_task_ref (task);
+
+  /* Counted before it can be found, so a parking thread never misses it */
+  r_atomic_uint_fetch_add (&queue->queued, 1);
+  if (w == NULL || w->ctx->idx != task->group || !r_tq_worker_push (w, task))
+    r_tq_ctx_inject (&queue->ctx[task->group], task);
+  r_task_queue_ws_wake (queue);
+}
+
+static void
+r_task_queue_ws_run (RTaskQueue * queue, RTQWorker * w, RTask * task)
+{
+  ruint state = R_TASK_QUEUED;
+
+  r_atomic_uint_fetch_sub (&queue->queued, 1);
+
+  if (r_atomic_uint_cmp_xchg_strong (&task->state, &state, R_TASK_RUNNING)) {
+    R_LOG_TRACE ("TQ: %p [%p] - process task %p", queue, w, task);
+    task->func (task->data, queue, task);
+
+    r_atomic_uint_store (&task->state, R_TASK_DONE);
+    r_task_notify_waiters (task);
+  } else {
+    R_LOG_DEBUG ("TQ: %p [%p] - process task %p - not queued 0x%.2x",
+        queue, w, task, state);
+  }
+
+  r_task_queue_task_finished (task);
+  r_task_unref (task);
+}
+
+static rpointer
+r_task_queue_ws_loop (rpointer common, rpointer spec)
+{
+  RTaskQueue * queue = common;
+  RTQCtx * ctx = spec;
+  RTQWorker * w;
+  RTask * task;
+  ruint idle = 0;
+
+  if (R_UNLIKELY (r_tss_get (&g__r_task_queue_tss) != NULL)) {
+    R_LOG_ERROR ("Nested task queue???? %p ---> %p",
+        queue, r_tss_get (&g__r_task_queue_tss));
+    abort ();
+  }
+
+  /* Workers are owned by the queue, thieves may look at them until the end */
+  if (R_UNLIKELY ((w = r_mem_new0 (RTQWorker)) == NULL))
+    return NULL;
+  w->queue = queue;
+  w->ctx = ctx;
+  w->rnd = (ruint32)(ruintptr)w | 1;
+  w->next = r_atomic_ptr_load (&ctx->workers);
+  while (!r_atomic_ptr_cmp_xchg_weak (&ctx->workers, &w->next, w));
+  r_atomic_uint_fetch_add (&ctx->wcount, 1);
+
+  R_LOG_DEBUG ("TQ: %p - start work stealing thread %p for ctx %p", queue, w, ctx);
+  r_tss_set (&g__r_task_queue_tss, queue);
+  r_tss_set (&g__r_task_queue_worker_tss, w);
+  r_mutex_lock (&ctx->mutex);
+  ctx->threads++;
+  r_mutex_unlock (&ctx->mutex);
+
+  while (r_atomic_uint_load (&queue->running)) {
+    if ((task = r_task_queue_ws_find (queue, w)) != NULL) {
+      r_task_queue_ws_run (queue, w, task);
+      idle = 0;
+    } else if (++idle < R_TASK_QUEUE_IDLE_SPINS) {
+      r_thread_yield ();
+    } else {
+      R_LOG_TRACE ("TQ: %p [%p] - wait", queue, w);
+      r_mutex_lock (&queue->idle_mutex);
+      r_atomic_uint_fetch_add (&queue->sleepers, 1);
+      while (r_atomic_uint_load (&queue->running) &&
+          r_atomic_uint_load (&queue->queued) == 0)
+        r_cond_wait (&queue->idle_cond, &queue->idle_mutex);
+      r_atomic_uint_fetch_sub (&queue->sleepers, 1);
+      r_mutex_unlock (&queue->idle_mutex);
+      idle = 0;
+    }
+  }
+
+  r_mutex_lock (&ctx->mutex);
+  ctx->threads--;
+  r_mutex_unlock (&ctx->mutex);
+  r_tss_set (&g__r_task_queue_worker_tss, NULL);
+  r_tss_set (&g__r_task_queue_tss, NULL);
+  R_LOG_DEBUG ("TQ: %p - end work stealing thread %p for ctx %p", queue, w, ctx);
+
+  return NULL;
+}
+
 rsize
 r_task_queue_queued_tasks (const RTaskQueue * queue)
 {
   ruint i;
   rsize ret = 0;
 
+  if (queue->flags & R_TASK_QUEUE_FLAG_WORK_STEALING)
+    return r_atomic_uint_load ((rauint *)&queue->queued);
+
   for (i = 0; i < queue->ctxcount; i++)
     ret += r_queue_size (queue->ctx[i].q);
 
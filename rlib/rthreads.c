@@ -42,6 +42,10 @@
 #ifdef HAVE_SYS_PRCTL_H
 #include <sys/prctl.h>
 #endif
+#ifdef HAVE_LINUX_FUTEX_H
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
 #include <string.h>
 #include <time.h>
 
@@ -592,6 +596,247 @@ r_cond_broadcast (RCond * cond)
 #endif
 }
 
+/******************************************************************************/
+/*  RFastMutex, RFastCond and RFastRWMutex - Lightweight locks                */
+/******************************************************************************/
+/* Times to check a taken lock before parking, roughly a microsecond */
+#define R_FAST_LOCK_SPIN          128
+
+#define R_FAST_RWMUTEX_WRITER     0x80000000u
+#define R_FAST_RWMUTEX_WAITERS    0x40000000u
+#define R_FAST_RWMUTEX_READERS    (R_FAST_RWMUTEX_WAITERS - 1)
+
+static inline void
+r_fast_lock_relax (void)
+{
+#if defined (__i386__) || defined (__x86_64__)
+  __asm__ __volatile__ ("pause");
+#elif defined (__aarch64__)
+  __asm__ __volatile__ ("yield");
+#endif
+}
+
+/* Sleep for as long as *addr is val, or until woken. Might return early */
+static void
+r_fast_lock_park (rauint * addr, ruint val)
+{
+#ifdef HAVE_LINUX_FUTEX_H
+  syscall (SYS_futex, addr, FUTEX_WAIT_PRIVATE, val, NULL, NULL, 0);
+#else
+  (void) addr;
+  (void) val;
+  r_thread_yield ();
+#endif
+}
+
+static void
+r_fast_lock_wake (rauint * addr, int count)
+{
+#ifdef HAVE_LINUX_FUTEX_H
+  syscall (SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+#else
+  (void) addr;
+  (void) count;
+#endif
+}
+
+/* state is 0 when unlocked, 1 when locked and 2 when threads might be
+ * parked waiting for it, as in "Futexes Are Tricky" by Ulrich Drepper */
+void
+r_fast_mutex_init (RFastMutex * mutex)
+{
+  r_atomic_uint_store (&mutex->state, 0);
+  mutex->stats = NULL;
+}
+
+void
+r_fast_mutex_set_stats (RFastMutex * mutex, RFastLockStats * stats)
+{
+  mutex->stats = stats;
+}
+
+static void
+r_fast_mutex_lock_contended (RFastMutex * mutex)
+{
+  ruint i, c;
+
+  if (mutex->stats != NULL)
+    r_atomic_uint_fetch_add (&mutex->stats->contended, 1);
+
+  /* The owner is likely to be running, so spin before parking. Taking it
+   * as 1 with threads parked is fine, as they mark it 2 again once woken */
+  for (i = 0; i < R_FAST_LOCK_SPIN; i++) {
+    r_fast_lock_relax ();
+    if ((c = r_atomic_uint_load (&mutex->state)) == 0 &&
+        r_atomic_uint_cmp_xchg_weak (&mutex->state, &c, 1)) {
+      if (mutex->stats != NULL)
+        r_atomic_uint_fetch_add (&mutex->stats->spun, 1);
+      return;
+    }
+  }
+
+  if (mutex->stats != NULL)
+    r_atomic_uint_fetch_add (&mutex->stats->parked, 1);
+  while (r_atomic_uint_exchange (&mutex->state, 2) != 0)
+    r_fast_lock_park (&mutex->state, 2);
+}
+
+void
+r_fast_mutex_lock (RFastMutex * mutex)
+{
+  ruint c = 0;
+
+  if (R_UNLIKELY (!r_atomic_uint_cmp_xchg_strong (&mutex->state, &c, 1)))
+    r_fast_mutex_lock_contended (mutex);
+}
+
+rboolean
+r_fast_mutex_trylock (RFastMutex * mutex)
+{
+  ruint c = 0;
+  return r_atomic_uint_cmp_xchg_strong (&mutex->state, &c, 1);
+}
+
+void
+r_fast_mutex_unlock (RFastMutex * mutex)
+{
+  if (r_atomic_uint_exchange (&mutex->state, 0) == 2)
+    r_fast_lock_wake (&mutex->state, 1);
+}
+
+/* Waiters park on the sequence number, which every signal bumps */
+void
+r_fast_cond_init (RFastCond * cond)
+{
+  r_atomic_uint_store (&cond->seq, 0);
+}
+
+void
+r_fast_cond_wait (RFastCond * cond, RFastMutex * mutex)
+{
+  ruint seq = r_atomic_uint_load (&cond->seq);
+
+  r_fast_mutex_unlock (mutex);
+  r_fast_lock_park (&cond->seq, seq);
+
+  /* Other waiters might be woken along with us, so lock as contended */
+  while (r_atomic_uint_exchange (&mutex->state, 2) != 0)
+    r_fast_lock_park (&mutex->state, 2);
+}
+
+void
+r_fast_cond_signal (RFastCond * cond)
+{
+  r_atomic_uint_fetch_add (&cond->seq, 1);
+  r_fast_lock_wake (&cond->seq, 1);
+}
+
+void
+r_fast_cond_broadcast (RFastCond * cond)
+{
+  r_atomic_uint_fetch_add (&cond->seq, 1);
+  r_fast_lock_wake (&cond->seq, RINT_MAX);
+}
+
+/* state holds the number of readers, a writer bit and a bit telling
+ * whether threads might be parked waiting for it */
+void
+r_fast_rwmutex_init (RFastRWMutex * mutex)
+{
+  r_atomic_uint_store (&mutex->state, 0);
+}
+
+/* Park until state changes, after flagging that someone is waiting */
+static void
+r_fast_rwmutex_park (RFastRWMutex * mutex, ruint s)
+{
+  if ((s & R_FAST_RWMUTEX_WAITERS) ||
+      r_atomic_uint_cmp_xchg_strong (&mutex->state, &s, s | R_FAST_RWMUTEX_WAITERS))
+    r_fast_lock_park (&mutex->state, s | R_FAST_RWMUTEX_WAITERS);
+}
+
+static void
+r_fast_rwmutex_wake (RFastRWMutex * mutex)
+{
+  /* Wake everyone, those who still can't get it will flag it again */
+  if (r_atomic_uint_fetch_and (&mutex->state, ~R_FAST_RWMUTEX_WAITERS) & R_FAST_RWMUTEX_WAITERS)
+    r_fast_lock_wake (&mutex->state, RINT_MAX);
+}
+
+rboolean
+r_fast_rwmutex_tryrdlock (RFastRWMutex * mutex)
+{
+  ruint s = r_atomic_uint_load (&mutex->state);
+
+  while (!(s & R_FAST_RWMUTEX_WRITER)) {
+    if (r_atomic_uint_cmp_xchg_weak (&mutex->state, &s, s + 1))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+void
+r_fast_rwmutex_rdlock (RFastRWMutex * mutex)
+{
+  ruint i, s;
+
+  for (i = 0; !r_fast_rwmutex_tryrdlock (mutex); i++) {
+    if (i < R_FAST_LOCK_SPIN) {
+      r_fast_lock_relax ();
+    } else if ((s = r_atomic_uint_load (&mutex->state)) & R_FAST_RWMUTEX_WRITER) {
+      r_fast_rwmutex_park (mutex, s);
+    }
+  }
+}
+
+rboolean
+r_fast_rwmutex_trywrlock (RFastRWMutex * mutex)
+{
+  ruint s = r_atomic_uint_load (&mutex->state);
+
+  while (!(s & (R_FAST_RWMUTEX_WRITER | R_FAST_RWMUTEX_READERS))) {
+    if (r_atomic_uint_cmp_xchg_weak (&mutex->state, &s, s | R_FAST_RWMUTEX_WRITER))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+void
+r_fast_rwmutex_wrlock (RFastRWMutex * mutex)
+{
+  ruint i, s;
+
+  for (i = 0; !r_fast_rwmutex_trywrlock (mutex); i++) {
+    if (i < R_FAST_LOCK_SPIN) {
+      r_fast_lock_relax ();
+    } else if ((s = r_atomic_uint_load (&mutex->state)) &
+        (R_FAST_RWMUTEX_WRITER | R_FAST_RWMUTEX_READERS)) {
+      r_fast_rwmutex_park (mutex, s);
+    }
+  }
+}
+
+void
+r_fast_rwmutex_rdunlock (RFastRWMutex * mutex)
+{
+  ruint s = r_atomic_uint_fetch_sub (&mutex->state, 1) - 1;
+
+  /* Only writers wait while there are readers */
+  if (s == R_FAST_RWMUTEX_WAITERS)
+    r_fast_rwmutex_wake (mutex);
+}
+
+void
+r_fast_rwmutex_wrunlock (RFastRWMutex * mutex)
+{
+  ruint s = r_atomic_uint_fetch_and (&mutex->state, ~R_FAST_RWMUTEX_WRITER);
+
+  if (s & R_FAST_RWMUTEX_WAITERS)
+    r_fast_rwmutex_wake (mutex);
+}
+
 /******************************************************************************/
 /*  RThread                                                                   */
 /******************************************************************************/
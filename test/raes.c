@@ -20,7 +20,8 @@ RTEST (raes, new_args, RTEST_FAST)
 
   r_assert_cmpptr (r_cipher_aes_new (R_CRYPTO_CIPHER_MODE_CFB, 128, key), ==, NULL);
   r_assert_cmpptr (r_cipher_aes_new (R_CRYPTO_CIPHER_MODE_OFB, 128, key), ==, NULL);
-  r_assert_cmpptr (r_cipher_aes_new (R_CRYPTO_CIPHER_MODE_GCM, 128, key), ==, NULL);
+  r_assert_cmpptr (r_cipher_aes_new (R_CRYPTO_CIPHER_MODE_GCM, 0, key), ==, NULL);
+  r_assert_cmpptr (r_cipher_aes_new (R_CRYPTO_CIPHER_MODE_GCM, 129, key), ==, NULL);
   r_assert_cmpptr (r_cipher_aes_new (R_CRYPTO_CIPHER_MODE_CCM, 128, key), ==, NULL);
 }
 RTEST_END;
@@ -296,3 +297,294 @@ RTEST_LOOP (raes, ctr, RTEST_FAST, 0, R_N_ELEMENTS (CTR_test_data))
 }
 RTEST_END;
 
+
+typedef struct {
+  rsize keybits;
+  const rchar * key;
+  const rchar * iv;
+  const rchar * aad;
+  const rchar * plaintxt;
+  const rchar * ciphertxt;
+  const rchar * tag;
+} RCryptoCipherGcmTestData;
+
+static const RCryptoCipherGcmTestData GCM_test_data[] = {
+  /* The Galois/Counter Mode of Operation (GCM) - McGrew, Viega. Test cases 1-6, 13-16 */
+  { 128, "00000000000000000000000000000000", "000000000000000000000000", "", "", "", "58e2fccefa7e3061367f1d57a4e7455a" },
+  { 128, "00000000000000000000000000000000", "000000000000000000000000", "", "00000000000000000000000000000000", "0388dace60b6a392f328c2b971b2fe78", "ab6e47d42cec13bdf53a67b21257bddf" },
+  { 128, "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255",
+    "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985",
+    "4d5c2af327cd64a62cf35abd2ba6fab4" },
+  { 128, "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+    "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+    "5bc94fbc3221a5db94fae95ae7121a47" },
+  { 128, "feffe9928665731c6d6a8f9467308308", "cafebabefacedbad", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+    "61353b4c2806934a777ff51fa22a4755699b2a714fcdc6f83766e5f97b6c742373806900e49f24b22b097544d4896b424989b5e1ebac0f07c23f4598",
+    "3612d2e79e3b0785561be14aaca2fccb" },
+  { 128, "feffe9928665731c6d6a8f9467308308",
+    "9313225df88406e555909c5aff5269aa6a7a9538534f7da1e4c303d2a318a728c3c0c95156809539fcf0e2429a6b525416aedbf5a0de6a57a637b39b",
+    "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+    "8ce24998625615b603a033aca13fb894be9112a5c3a211a8ba262a3cca7e2ca701e4a9a4fba43c90ccdcb281d48c7c6fd62875d2aca417034c34aee5",
+    "619cc5aefffe0bfa462af43c1699d050" },
+  { 256, "0000000000000000000000000000000000000000000000000000000000000000", "000000000000000000000000", "", "", "", "530f8afbc74536b9a963b4f1c4cb738b" },
+  { 256, "0000000000000000000000000000000000000000000000000000000000000000", "000000000000000000000000", "", "00000000000000000000000000000000", "cea7403d4d606b6e074ec5d3baf39d18", "d0d1c8a799996bf0265b98b5d48ab919" },
+  { 256, "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255",
+    "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662898015ad",
+    "b094dac5d93471bdec1a502270e3cc6c" },
+  { 256, "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+    "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662",
+    "76fc6ece0f4e1768cddf8853bb2d551b" },
+};
+
+static void
+aes_gcm_check (const RCryptoCipherGcmTestData * data, RAesImpl impl)
+{
+  RCryptoCipher * cipher;
+  ruint8 * key, * iv, * aad, * plaintxt, * ciphertxt, * tag, * out;
+  ruint8 calctag[R_AES_GCM_TAG_BYTES];
+  rsize keysize, ivsize, aadsize = 0, plainsize = 0, ciphersize = 0, tagsize;
+
+  r_assert_cmpptr ((key = r_str_hex_mem (data->key, &keysize)), !=, NULL);
+  r_assert_cmpptr ((iv = r_str_hex_mem (data->iv, &ivsize)), !=, NULL);
+  aad = r_str_hex_mem (data->aad, &aadsize);
+  plaintxt = r_str_hex_mem (data->plaintxt, &plainsize);
+  ciphertxt = r_str_hex_mem (data->ciphertxt, &ciphersize);
+  r_assert_cmpptr ((tag = r_str_hex_mem (data->tag, &tagsize)), !=, NULL);
+  r_assert_cmpuint (plainsize, ==, ciphersize);
+  r_assert_cmpuint (tagsize, ==, R_AES_GCM_TAG_BYTES);
+
+  r_assert_cmpptr ((cipher = r_cipher_aes_new_with_impl (R_CRYPTO_CIPHER_MODE_GCM,
+          data->keybits, key, impl)), !=, NULL);
+  r_assert_cmpuint (cipher->info->mode, ==, R_CRYPTO_CIPHER_MODE_GCM);
+  out = r_malloc (plainsize + R_AES_GCM_TAG_BYTES);
+
+  r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (cipher, out, plainsize, plaintxt,
+        iv, ivsize, aad, aadsize, calctag, sizeof (calctag)), ==, R_CRYPTO_CIPHER_OK);
+  if (ciphersize > 0)
+    r_assert_cmpmem (out, ==, ciphertxt, ciphersize);
+  r_assert_cmpmem (calctag, ==, tag, tagsize);
+
+  r_assert_cmpint (r_cipher_aes_gcm_decrypt_full (cipher, out, ciphersize, out,
+        iv, ivsize, aad, aadsize, tag, tagsize), ==, R_CRYPTO_CIPHER_OK);
+  if (plainsize > 0)
+    r_assert_cmpmem (out, ==, plaintxt, plainsize);
+
+  /* Truncated tags are accepted, a flipped bit anywhere is not */
+  r_assert_cmpint (r_cipher_aes_gcm_decrypt_full (cipher, out, ciphersize, ciphertxt,
+        iv, ivsize, aad, aadsize, tag, 12), ==, R_CRYPTO_CIPHER_OK);
+  tag[15] ^= 0x01;
+  r_assert_cmpint (r_cipher_aes_gcm_decrypt_full (cipher, out, ciphersize, ciphertxt,
+        iv, ivsize, aad, aadsize, tag, tagsize), ==, R_CRYPTO_CIPHER_AUTH_FAILED);
+  tag[15] ^= 0x01;
+  if (aadsize > 0) {
+    aad[0] ^= 0x80;
+    r_assert_cmpint (r_cipher_aes_gcm_decrypt_full (cipher, out, ciphersize, ciphertxt,
+          iv, ivsize, aad, aadsize, tag, tagsize), ==, R_CRYPTO_CIPHER_AUTH_FAILED);
+    aad[0] ^= 0x80;
+  }
+
+  /* No room for the tag through the generic cipher interface */
+  r_assert_cmpint (r_crypto_cipher_encrypt (cipher, out, plainsize, plaintxt,
+        iv, ivsize), ==, R_CRYPTO_CIPHER_INVAL);
+  r_assert_cmpint (r_crypto_cipher_decrypt (cipher, out, ciphersize, ciphertxt,
+        iv, ivsize), ==, R_CRYPTO_CIPHER_INVAL);
+
+  r_crypto_cipher_unref (cipher);
+  r_free (key);
+  r_free (iv);
+  r_free (aad);
+  r_free (plaintxt);
+  r_free (ciphertxt);
+  r_free (tag);
+  r_free (out);
+}
+
+RTEST_LOOP (raes, gcm, RTEST_FAST, 0, R_N_ELEMENTS (GCM_test_data))
+{
+  aes_gcm_check (&GCM_test_data[__i], R_AES_IMPL_PORTABLE);
+  if (r_cipher_aes_impl_available (R_AES_IMPL_AESNI))
+    aes_gcm_check (&GCM_test_data[__i], R_AES_IMPL_AESNI);
+}
+RTEST_END;
+
+RTEST (raes, gcm_args, RTEST_FAST)
+{
+  RCryptoCipher * gcm, * ctr;
+  ruint8 key[16] = { 0 }, iv[12] = { 0 }, buf[32] = { 0 }, tag[16];
+
+  r_assert_cmpptr ((gcm = r_cipher_aes_128_gcm_new (key)), !=, NULL);
+  r_assert_cmpptr ((ctr = r_cipher_aes_128_ctr_new (key)), !=, NULL);
+  r_assert_cmpptr (r_crypto_cipher_find_by_str ("AES-256-GCM"), !=, NULL);
+  r_assert_cmpuint (gcm->info->ivsize, ==, R_AES_GCM_IV_BYTES);
+
+  r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (NULL, buf, 16, buf,
+        iv, sizeof (iv), NULL, 0, tag, sizeof (tag)), ==, R_CRYPTO_CIPHER_INVAL);
+  r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (ctr, buf, 16, buf,
+        iv, sizeof (iv), NULL, 0, tag, sizeof (tag)), ==, R_CRYPTO_CIPHER_INVAL);
+  r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (gcm, buf, 16, buf,
+        NULL, 0, NULL, 0, tag, sizeof (tag)), ==, R_CRYPTO_CIPHER_INVAL);
+  r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (gcm, buf, 16, buf,
+        iv, sizeof (iv), NULL, 4, tag, sizeof (tag)), ==, R_CRYPTO_CIPHER_INVAL);
+  r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (gcm, buf, 16, buf,
+        iv, sizeof (iv), NULL, 0, tag, 3), ==, R_CRYPTO_CIPHER_INVAL);
+  r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (gcm, buf, 16, buf,
+        iv, sizeof (iv), NULL, 0, tag, 17), ==, R_CRYPTO_CIPHER_INVAL);
+
+  r_crypto_cipher_unref (gcm);
+  r_crypto_cipher_unref (ctr);
+}
+RTEST_END;
+
+RTEST (raes, gcm_impl_cross_check, RTEST_FAST)
+{
+  ruint8 key[32], iv[R_AES_GCM_IV_BYTES], aad[40], * data, * a, * b;
+  ruint8 taga[R_AES_GCM_TAG_BYTES], tagb[R_AES_GCM_TAG_BYTES];
+  RCryptoCipher * portable, * hw;
+  rsize i, size;
+
+  if (!r_cipher_aes_impl_available (R_AES_IMPL_AESNI))
+    return;
+
+  for (i = 0; i < sizeof (key); i++)
+    key[i] = (ruint8)(i * 13);
+  for (i = 0; i < sizeof (aad); i++)
+    aad[i] = (ruint8)(i * 3);
+  /* Counter wraps the low 32 bits while encrypting */
+  r_memset (iv, 0xa5, sizeof (iv));
+
+  data = r_malloc (2048);
+  a = r_malloc (2048);
+  b = r_malloc (2048);
+  for (i = 0; i < 2048; i++)
+    data[i] = (ruint8)(i ^ (i >> 7));
+
+  r_assert_cmpptr ((portable = r_cipher_aes_new_with_impl (R_CRYPTO_CIPHER_MODE_GCM, 256, key, R_AES_IMPL_PORTABLE)), !=, NULL);
+  r_assert_cmpptr ((hw = r_cipher_aes_new_with_impl (R_CRYPTO_CIPHER_MODE_GCM, 256, key, R_AES_IMPL_AESNI)), !=, NULL);
+
+  for (size = 0; size < 2048; size = size * 2 + 7) {
+    for (i = 0; i <= sizeof (aad); i += 13) {
+      r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (portable, a, size, data,
+            iv, sizeof (iv), aad, i, taga, sizeof (taga)), ==, R_CRYPTO_CIPHER_OK);
+      r_assert_cmpint (r_cipher_aes_gcm_encrypt_full (hw, b, size, data,
+            iv, sizeof (iv), aad, i, tagb, sizeof (tagb)), ==, R_CRYPTO_CIPHER_OK);
+      r_assert_cmpmem (a, ==, b, size);
+      r_assert_cmpmem (taga, ==, tagb, sizeof (taga));
+      r_assert_cmpint (r_cipher_aes_gcm_decrypt_full (hw, b, size, b,
+            iv, sizeof (iv), aad, i, taga, sizeof (taga)), ==, R_CRYPTO_CIPHER_OK);
+      r_assert_cmpmem (b, ==, data, size);
+    }
+  }
+
+  r_crypto_cipher_unref (portable);
+  r_crypto_cipher_unref (hw);
+  r_free (data);
+  r_free (a);
+  r_free (b);
+}
+RTEST_END;
+
+RTEST (raes, impl, RTEST_FAST)
+{
+  ruint8 key[32] = { 0 };
+  RCryptoCipher * cipher;
+
+  r_assert (r_cipher_aes_impl_available (R_AES_IMPL_AUTO));
+  r_assert (r_cipher_aes_impl_available (R_AES_IMPL_PORTABLE));
+  r_assert_cmpint (r_cipher_aes_get_impl (NULL), ==, R_AES_IMPL_AUTO);
+
+  r_assert_cmpptr ((cipher = r_cipher_aes_new_with_impl (R_CRYPTO_CIPHER_MODE_CTR,
+          128, key, R_AES_IMPL_PORTABLE)), !=, NULL);
+  r_assert_cmpint (r_cipher_aes_get_impl (cipher), ==, R_AES_IMPL_PORTABLE);
+  r_crypto_cipher_unref (cipher);
+
+  r_assert_cmpptr ((cipher = r_cipher_aes_128_ctr_new (key)), !=, NULL);
+  if (r_cipher_aes_impl_available (R_AES_IMPL_AESNI))
+    r_assert_cmpint (r_cipher_aes_get_impl (cipher), ==, R_AES_IMPL_AESNI);
+  else
+    r_assert_cmpint (r_cipher_aes_get_impl (cipher), ==, R_AES_IMPL_PORTABLE);
+  r_crypto_cipher_unref (cipher);
+
+  cipher = r_cipher_aes_new_with_impl (R_CRYPTO_CIPHER_MODE_CTR, 128, key, R_AES_IMPL_AESNI);
+  if (r_cipher_aes_impl_available (R_AES_IMPL_AESNI)) {
+    r_assert_cmpptr (cipher, !=, NULL);
+    r_crypto_cipher_unref (cipher);
+  } else {
+    r_assert_cmpptr (cipher, ==, NULL);
+  }
+}
+RTEST_END;
+
+static void
+aes_impl_cross_check (RCryptoCipherMode mode, ruint bits, const ruint8 * key,
+    const ruint8 * data, rsize size, const ruint8 ivinit[R_AES_BLOCK_BYTES])
+{
+  RCryptoCipher * portable, * hw;
+  ruint8 * a, * b, iva[R_AES_BLOCK_BYTES], ivb[R_AES_BLOCK_BYTES];
+
+  r_assert_cmpptr ((portable = r_cipher_aes_new_with_impl (mode, bits, key, R_AES_IMPL_PORTABLE)), !=, NULL);
+  r_assert_cmpptr ((hw = r_cipher_aes_new_with_impl (mode, bits, key, R_AES_IMPL_AESNI)), !=, NULL);
+  a = r_malloc (size + 1);
+  b = r_malloc (size + 1);
+
+  /* Out of place encryption */
+  r_memcpy (iva, ivinit, R_AES_BLOCK_BYTES);
+  r_memcpy (ivb, ivinit, R_AES_BLOCK_BYTES);
+  r_assert_cmpint (r_crypto_cipher_encrypt (portable, a, size, data, iva, sizeof (iva)), ==, R_CRYPTO_CIPHER_OK);
+  r_assert_cmpint (r_crypto_cipher_encrypt (hw, b, size, data, ivb, sizeof (ivb)), ==, R_CRYPTO_CIPHER_OK);
+  r_assert_cmpmem (a, ==, b, size);
+  r_assert_cmpmem (iva, ==, ivb, R_AES_BLOCK_BYTES);
+
+  /* In place decryption back to the plaintext */
+  r_memcpy (iva, ivinit, R_AES_BLOCK_BYTES);
+  r_memcpy (ivb, ivinit, R_AES_BLOCK_BYTES);
+  r_assert_cmpint (r_crypto_cipher_decrypt (portable, a, size, a, iva, sizeof (iva)), ==, R_CRYPTO_CIPHER_OK);
+  r_assert_cmpint (r_crypto_cipher_decrypt (hw, b, size, b, ivb, sizeof (ivb)), ==, R_CRYPTO_CIPHER_OK);
+  r_assert_cmpmem (a, ==, data, size);
+  r_assert_cmpmem (b, ==, data, size);
+  r_assert_cmpmem (iva, ==, ivb, R_AES_BLOCK_BYTES);
+
+  r_free (a);
+  r_free (b);
+  r_crypto_cipher_unref (portable);
+  r_crypto_cipher_unref (hw);
+}
+
+RTEST_LOOP (raes, impl_cross_check, RTEST_FAST, 0, 3)
+{
+  static const ruint bits[] = { 128, 192, 256 };
+  static const rsize sizes[] = { 16, 32, 112, 128, 144, 256, 1200, 4096 };
+  static const rsize ctrsizes[] = { 1, 15, 17, 127, 129, 1199 };
+  ruint8 key[32], ivinit[R_AES_BLOCK_BYTES], * data;
+  rsize i;
+
+  if (!r_cipher_aes_impl_available (R_AES_IMPL_AESNI))
+    return;
+
+  for (i = 0; i < sizeof (key); i++)
+    key[i] = (ruint8)(i * 7 + __i);
+  /* Counter close to wrapping so the carry crosses the 64 bit halves */
+  for (i = 0; i < sizeof (ivinit); i++)
+    ivinit[i] = i < 8 ? (ruint8)i : 0xff;
+  ivinit[15] = 0xfb;
+
+  data = r_malloc (4096);
+  for (i = 0; i < 4096; i++)
+    data[i] = (ruint8)(i ^ (i >> 8));
+
+  for (i = 0; i < R_N_ELEMENTS (sizes); i++) {
+    aes_impl_cross_check (R_CRYPTO_CIPHER_MODE_ECB, bits[__i], key, data, sizes[i], ivinit);
+    aes_impl_cross_check (R_CRYPTO_CIPHER_MODE_CBC, bits[__i], key, data, sizes[i], ivinit);
+    aes_impl_cross_check (R_CRYPTO_CIPHER_MODE_CTR, bits[__i], key, data, sizes[i], ivinit);
+  }
+  for (i = 0; i < R_N_ELEMENTS (ctrsizes); i++)
+    aes_impl_cross_check (R_CRYPTO_CIPHER_MODE_CTR, bits[__i], key, data, ctrsizes[i], ivinit);
+
+  r_free (data);
+}
+RTEST_END;
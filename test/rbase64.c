@@ -212,3 +212,160 @@ RTEST (rbase64, decode_spacing, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rbase64, impl, RTEST_FAST)
+{
+  static const RBase64Impl impls[] = {
+    R_BASE64_IMPL_AUTO, R_BASE64_IMPL_SSE41, R_BASE64_IMPL_AVX2 };
+  ruint8 data[300], dec[300], ref[300];
+  rchar enc[404], tmp[404];
+  rsize i, size, encsize, decsize;
+
+  r_assert (r_base64_impl_available (R_BASE64_IMPL_SCALAR));
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = (ruint8)(i * 167 + (i >> 3));
+
+  for (i = 0; i < R_N_ELEMENTS (impls); i++) {
+    for (size = 0; size < sizeof (data); size++) {
+      encsize = r_base64_encode_with_impl (R_BASE64_IMPL_SCALAR, enc, sizeof (enc), data, size);
+      r_assert_cmpuint (r_base64_encode_with_impl (impls[i], tmp, sizeof (tmp), data, size), ==, encsize);
+      r_assert_cmpmem (tmp, ==, enc, encsize);
+
+      /* Too small dst stops at a whole group */
+      r_assert_cmpuint (r_base64_encode_with_impl (impls[i], tmp, encsize / 2, data, size), ==,
+          r_base64_encode_with_impl (R_BASE64_IMPL_SCALAR, tmp, encsize / 2, data, size));
+
+      r_assert_cmpuint (r_base64_decode_with_impl (impls[i], dec, sizeof (dec), enc, encsize), ==, size);
+      r_assert_cmpmem (dec, ==, data, size);
+      r_assert_cmpuint (r_base64_decode_with_impl (impls[i], dec, size / 2, enc, encsize), ==,
+          r_base64_decode_with_impl (R_BASE64_IMPL_SCALAR, ref, size / 2, enc, encsize));
+    }
+
+    /* Anything outside the alphabet hits the vector validation, white
+     * space is skipped and the rest ends the input */
+    encsize = r_base64_encode_with_impl (R_BASE64_IMPL_SCALAR, enc, sizeof (enc), data, 240);
+    for (size = 0; size < 256; size++) {
+      r_memcpy (tmp, enc, encsize);
+      tmp[(size * 7) % 100 + 40] = (rchar)size;
+      decsize = r_base64_decode_with_impl (R_BASE64_IMPL_SCALAR, ref, sizeof (ref), tmp, encsize);
+      r_assert_cmpuint (r_base64_decode_with_impl (impls[i], dec, sizeof (dec), tmp, encsize), ==, decsize);
+      r_assert_cmpmem (dec, ==, ref, decsize);
+    }
+  }
+}
+RTEST_END;
+
+/* The kernels must be usable on any CPU that can run them, not compiled
+ * out by a config.h that missed HAVE_X86_AVX2 */
+RTEST (rbase64, impl_cpu, RTEST_FAST)
+{
+#if defined (__x86_64__) && defined (__GNUC__)
+  r_assert_cmpint (r_base64_impl_available (R_BASE64_IMPL_SSE41), ==,
+      __builtin_cpu_supports ("ssse3") && __builtin_cpu_supports ("sse4.1"));
+  r_assert_cmpint (r_base64_impl_available (R_BASE64_IMPL_AVX2), ==,
+      __builtin_cpu_supports ("avx2") != 0);
+#else
+  r_assert (!r_base64_impl_available (R_BASE64_IMPL_SSE41));
+  r_assert (!r_base64_impl_available (R_BASE64_IMPL_AVX2));
+#endif
+}
+RTEST_END;
+
+RTEST (rbase64, encoder, RTEST_FAST)
+{
+  RBase64Encoder enc = R_BASE64_ENCODER_INIT;
+  ruint8 data[100];
+  rchar * ref, out[R_BASE64_ENCODED_SIZE (sizeof (data))];
+  rsize i, split, refsize, size;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = (ruint8)(i * 31);
+  r_assert_cmpptr ((ref = r_base64_encode_dup (data, sizeof (data), &refsize)), !=, NULL);
+
+  for (split = 0; split <= sizeof (data); split++) {
+    size = r_base64_encoder_update (&enc, out, sizeof (out), data, split);
+    size += r_base64_encoder_update (&enc, out + size, sizeof (out) - size,
+        data + split, sizeof (data) - split);
+    size += r_base64_encoder_finish (&enc, out + size, sizeof (out) - size);
+    r_assert_cmpuint (size, ==, refsize);
+    r_assert_cmpmem (out, ==, ref, refsize);
+  }
+
+  /* One byte at a time */
+  for (i = 0, size = 0; i < sizeof (data); i++)
+    size += r_base64_encoder_update (&enc, out + size, sizeof (out) - size, data + i, 1);
+  size += r_base64_encoder_finish (&enc, out + size, sizeof (out) - size);
+  r_assert_cmpmem (out, ==, ref, refsize);
+
+  r_assert_cmpuint (r_base64_encoder_update (&enc, out, 4, data, 6), ==, 0);
+  r_assert_cmpuint (r_base64_encoder_finish (&enc, out, sizeof (out)), ==, 0);
+  r_free (ref);
+}
+RTEST_END;
+
+RTEST (rbase64, decoder, RTEST_FAST)
+{
+  static const rchar b64[] = "Zm9v YmFy\nYmF6 cXV4\nQkFBRA==ignored";
+  RBase64Decoder dec = R_BASE64_DECODER_INIT;
+  ruint8 out[R_BASE64_DECODED_SIZE (sizeof (b64))];
+  rsize i, split, size;
+
+  for (split = 0; split < sizeof (b64); split++) {
+    size = r_base64_decoder_update (&dec, out, sizeof (out), b64, split);
+    size += r_base64_decoder_update (&dec, out + size, sizeof (out) - size,
+        b64 + split, sizeof (b64) - 1 - split);
+    size += r_base64_decoder_finish (&dec, out + size, sizeof (out) - size);
+    r_assert_cmpuint (size, ==, 16);
+    r_assert_cmpmem (out, ==, "foobarbazquxBAAD", 16);
+  }
+
+  for (i = 0, size = 0; i < sizeof (b64) - 1; i++)
+    size += r_base64_decoder_update (&dec, out + size, sizeof (out) - size, b64 + i, 1);
+  size += r_base64_decoder_finish (&dec, out + size, sizeof (out) - size);
+  r_assert_cmpuint (size, ==, 16);
+  r_assert_cmpmem (out, ==, "foobarbazquxBAAD", 16);
+
+  /* "QkFBRP" without padding leaves three values for finish */
+  size = r_base64_decoder_update (&dec, out, sizeof (out), "QkFBRP", 6);
+  r_assert_cmpuint (size, ==, 3);
+  r_assert_cmpuint (r_base64_decoder_finish (&dec, out + size, 2), ==, 1);
+  r_assert_cmpmem (out, ==, "BAAD", 4);
+}
+RTEST_END;
+
+RTEST (rbase64, buffer, RTEST_FAST)
+{
+  RBuffer * a, * b, * buf;
+  ruint8 data[200];
+  rchar * ref, * str;
+  ruint8 * dec;
+  rsize i, refsize, size;
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = (ruint8)(i * 13 + 5);
+  r_assert_cmpptr ((ref = r_base64_encode_dup (data, sizeof (data), &refsize)), !=, NULL);
+
+  r_assert_cmpptr ((a = r_buffer_new_dup (data, 67)), !=, NULL);
+  r_assert_cmpptr ((b = r_buffer_new_dup (data + 67, sizeof (data) - 67)), !=, NULL);
+  r_assert_cmpptr ((buf = r_buffer_merge_take (a, b, NULL)), !=, NULL);
+  r_assert_cmpuint (r_buffer_mem_count (buf), ==, 2);
+  r_assert_cmpptr ((str = r_base64_encode_buffer_dup (buf, &size)), !=, NULL);
+  r_assert_cmpuint (size, ==, refsize);
+  r_assert_cmpstr (str, ==, ref);
+  r_buffer_unref (buf);
+
+  /* Split the text in the middle of a group */
+  r_assert_cmpptr ((a = r_buffer_new_dup (ref, 101)), !=, NULL);
+  r_assert_cmpptr ((b = r_buffer_new_dup (ref + 101, refsize - 101)), !=, NULL);
+  r_assert_cmpptr ((buf = r_buffer_merge_take (a, b, NULL)), !=, NULL);
+  r_assert_cmpptr ((dec = r_base64_decode_buffer_dup (buf, &size)), !=, NULL);
+  r_assert_cmpuint (size, ==, sizeof (data));
+  r_assert_cmpmem (dec, ==, data, sizeof (data));
+  r_buffer_unref (buf);
+
+  r_free (dec);
+  r_free (str);
+  r_free (ref);
+}
+RTEST_END;
@@ -1048,3 +1048,56 @@ RTEST (rbuffer, replace_byte_range, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rbuffer, pool, RTEST_FAST)
+{
+  RBufferPool * pool;
+  RBuffer * buf, * buf2;
+  RMem * mem, * mem2;
+  rpointer prev;
+  RMemAllocationParams params = { R_MEM_FLAG_ZERO_PREFIXED, 0, 8, 0 };
+
+  r_assert_cmpptr (r_buffer_pool_new (NULL, 0, NULL, 4), ==, NULL);
+  r_assert_cmpptr ((pool = r_buffer_pool_new (NULL, 1500, &params, 1)), !=, NULL);
+  r_assert_cmpuint (r_buffer_pool_get_allocsize (pool), ==, 1500);
+
+  r_assert_cmpptr ((buf = r_buffer_pool_acquire (pool)), !=, NULL);
+  r_assert_cmpuint (r_buffer_mem_count (buf), ==, 1);
+  r_assert_cmpuint (r_buffer_get_size (buf), ==, 1500);
+  r_assert_cmpuint (r_buffer_get_offset (buf), ==, 8);
+  r_assert (r_buffer_is_all_writable (buf));
+
+  /* Shrunk and dirty prefix is restored when recycled */
+  r_assert (r_buffer_resize (buf, 0, 42));
+  r_assert_cmpuint (r_buffer_memset (buf, 0, 0xaa, 42), ==, 42);
+  prev = buf;
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr ((buf = r_buffer_pool_acquire (pool)), ==, prev);
+  r_assert_cmpuint (r_buffer_get_size (buf), ==, 1500);
+  r_assert_cmpuint (r_buffer_get_offset (buf), ==, 8);
+  r_assert (r_buffer_resize (buf, 0, 8));
+  r_assert_cmpint (r_buffer_memcmp (buf, 0, "\0\0\0\0\0\0\0\0", 8), ==, 0);
+  r_assert (r_buffer_resize (buf, 8, 1500));
+
+  /* Only one buffer is kept around */
+  r_assert_cmpptr ((buf2 = r_buffer_pool_acquire (pool)), !=, NULL);
+  r_assert_cmpptr (buf2, !=, buf);
+  r_buffer_unref (buf2);
+  r_buffer_unref (buf);
+  r_assert_cmpptr ((buf = r_buffer_pool_acquire (pool)), ==, buf2);
+
+  /* Buffers with extra references to the mem are not recycled */
+  r_assert_cmpptr ((mem = r_buffer_mem_peek (buf, 0)), !=, NULL);
+  r_buffer_unref (buf);
+  r_assert_cmpptr ((buf = r_buffer_pool_acquire (pool)), !=, NULL);
+  r_assert_cmpptr ((mem2 = r_buffer_mem_peek (buf, 0)), !=, mem);
+  r_mem_unref (mem2);
+  r_mem_unref (mem);
+
+  /* Buffers may outlive the pool */
+  r_buffer_pool_unref (pool);
+  r_assert_cmpuint (r_buffer_get_size (buf), ==, 1500);
+  r_buffer_unref (buf);
+}
+RTEST_END;
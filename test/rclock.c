@@ -17,6 +17,36 @@ RTEST (rsystemclock, system, RTEST_FAST | RTEST_SYSTEM)
 }
 RTEST_END;
 
+static void
+clock_nop_cb (rpointer data, rpointer user)
+{
+  (void) data;
+  (void) user;
+}
+
+RTEST (rsystemclock, new, RTEST_FAST | RTEST_SYSTEM)
+{
+  RClock * sys, * clock;
+  RClockEntry * entry;
+
+  r_assert_cmpptr ((sys = r_system_clock_get ()), !=, NULL);
+  r_assert_cmpptr ((clock = r_system_clock_new ()), !=, NULL);
+  r_assert_cmpptr (clock, !=, sys);
+  r_assert (!r_clock_is_synthetic (clock));
+  r_assert_cmpuint (r_clock_get_time (clock), >, 0);
+
+  /* Timers are private to the instance */
+  r_assert_cmpptr ((entry = r_clock_add_timeout_callback (clock,
+          r_clock_get_time (clock) + R_SECOND, clock_nop_cb, NULL, NULL, NULL, NULL)), !=, NULL);
+  r_assert_cmpuint (r_clock_timeout_count (clock), ==, 1);
+  r_assert_cmpuint (r_clock_timeout_count (sys), ==, 0);
+  r_clock_entry_unref (entry);
+
+  r_clock_unref (clock);
+  r_clock_unref (sys);
+}
+RTEST_END;
+
 RTEST (rsystemclock, wait, RTEST_FAST | RTEST_SYSTEM)
 {
   RClock * clock;
@@ -168,6 +198,12 @@ RTEST (rtestclock, process_entries, RTEST_FAST)
   r_assert_cmpuint (r_clock_timeout_count (clock), ==, 1);
   r_assert_cmpuint (r_clock_first_timeout (clock), ==, 3);
 
+  /* Due entries only, regardless of the time of the clock */
+  r_assert_cmpuint (r_clock_process_entries_until (clock, 2), ==, 0);
+  r_assert_cmpuint (r_clock_process_entries_until (clock, 3), ==, 1);
+  r_assert_cmpuint (r_clock_timeout_count (clock), ==, 0);
+  r_assert_cmpuint (count, ==, 3);
+
   r_clock_entry_unref (entry[3]);
   r_clock_entry_unref (entry[2]);
   r_clock_entry_unref (entry[1]);
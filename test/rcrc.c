@@ -25,3 +25,91 @@ RTEST (rcrc, crc32bzip, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rcrc, impl, RTEST_FAST)
+{
+  static const RCrcImpl impls[] = {
+    R_CRC_IMPL_AUTO, R_CRC_IMPL_SLICE8, R_CRC_IMPL_SLICE16,
+    R_CRC_IMPL_SSE42, R_CRC_IMPL_PCLMUL };
+  ruint8 * buf;
+  rsize i, off, size;
+
+  r_assert (r_crc32_impl_available (R_CRC_IMPL_BYTEWISE));
+  r_assert (r_crc32c_impl_available (R_CRC_IMPL_SLICE16));
+  r_assert (!r_crc32_impl_available (R_CRC_IMPL_SSE42));
+
+  r_assert_cmpptr ((buf = r_malloc (4096 + 16)), !=, NULL);
+  for (i = 0; i < 4096 + 16; i++)
+    buf[i] = (ruint8)(i * 131 + (i >> 7));
+
+  for (i = 0; i < R_N_ELEMENTS (impls); i++) {
+    r_assert_cmphex (r_crc32_update_with_impl (impls[i], R_CRC32_INIT,
+          r_crc_test_vec, r_crc_test_vec_size), ==, 0xcbf43926);
+    r_assert_cmphex (r_crc32c_update_with_impl (impls[i], R_CRC32_INIT,
+          r_crc_test_vec, r_crc_test_vec_size), ==, 0xe3069283);
+
+    /* Every tail length and alignment around the 64 byte folding blocks */
+    for (off = 0; off < 8; off++) {
+      for (size = 0; size < 300; size++) {
+        r_assert_cmphex (r_crc32_update_with_impl (impls[i], 0x1234, buf + off, size), ==,
+            r_crc32_update_with_impl (R_CRC_IMPL_BYTEWISE, 0x1234, buf + off, size));
+        r_assert_cmphex (r_crc32c_update_with_impl (impls[i], 0x1234, buf + off, size), ==,
+            r_crc32c_update_with_impl (R_CRC_IMPL_BYTEWISE, 0x1234, buf + off, size));
+      }
+    }
+    r_assert_cmphex (r_crc32_update_with_impl (impls[i], R_CRC32_INIT, buf + 3, 4096 + 13), ==,
+        r_crc32_update_with_impl (R_CRC_IMPL_BYTEWISE, R_CRC32_INIT, buf + 3, 4096 + 13));
+    r_assert_cmphex (r_crc32c_update_with_impl (impls[i], R_CRC32_INIT, buf + 3, 4096 + 13), ==,
+        r_crc32c_update_with_impl (R_CRC_IMPL_BYTEWISE, R_CRC32_INIT, buf + 3, 4096 + 13));
+  }
+
+  /* bzip2 slicing against two halves */
+  r_assert_cmphex (r_crc32bzip2 (buf, 1000), ==,
+      r_crc32bzip2_update (r_crc32bzip2 (buf, 3), buf + 3, 997));
+
+  r_free (buf);
+}
+RTEST_END;
+
+/* Whatever the CPU supports has to be there, a build that quietly leaves
+ * out the x86 code fails here */
+RTEST (rcrc, impl_cpu, RTEST_FAST)
+{
+#if defined (__x86_64__) && defined (__GNUC__)
+  r_assert_cmpint (r_crc32c_impl_available (R_CRC_IMPL_SSE42), ==,
+      __builtin_cpu_supports ("sse4.2") != 0);
+  r_assert_cmpint (r_crc32_impl_available (R_CRC_IMPL_PCLMUL), ==,
+      __builtin_cpu_supports ("pclmul") != 0);
+  r_assert_cmpint (r_crc32c_impl_available (R_CRC_IMPL_PCLMUL), ==,
+      __builtin_cpu_supports ("pclmul") != 0);
+#else
+  r_assert (!r_crc32c_impl_available (R_CRC_IMPL_SSE42));
+  r_assert (!r_crc32_impl_available (R_CRC_IMPL_PCLMUL));
+#endif
+}
+RTEST_END;
+
+RTEST (rcrc, combine, RTEST_FAST)
+{
+  ruint8 buf[1024];
+  rsize i, split;
+
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = (ruint8)(i * 7 + 3);
+
+  r_assert_cmphex (r_crc32_combine (r_crc32 (r_crc_test_vec, 4),
+        r_crc32 (r_crc_test_vec + 4, 5), 5), ==, 0xcbf43926);
+  r_assert_cmphex (r_crc32c_combine (r_crc32c (r_crc_test_vec, 4),
+        r_crc32c (r_crc_test_vec + 4, 5), 5), ==, 0xe3069283);
+  r_assert_cmphex (r_crc32_combine (0x12345678, r_crc32 (buf, 0), 0), ==, 0x12345678);
+
+  for (split = 0; split <= sizeof (buf); split += 61) {
+    r_assert_cmphex (r_crc32_combine (r_crc32 (buf, split),
+          r_crc32 (buf + split, sizeof (buf) - split), sizeof (buf) - split), ==,
+        r_crc32 (buf, sizeof (buf)));
+    r_assert_cmphex (r_crc32c_combine (r_crc32c (buf, split),
+          r_crc32c (buf + split, sizeof (buf) - split), sizeof (buf) - split), ==,
+        r_crc32c (buf, sizeof (buf)));
+  }
+}
+RTEST_END;
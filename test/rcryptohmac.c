@@ -56,3 +56,98 @@ RTEST (rcryptomac, hmac_sha1, R_TEST_TYPE_FAST)
 }
 RTEST_END;
 
+
+RTEST (rcryptomac, hmac_long_key, R_TEST_TYPE_FAST)
+{
+  RHmac * hmac;
+  ruint8 key[131];
+  rchar * tmp;
+
+  r_memset (key, 0xaa, sizeof (key));
+
+  /* RFC 2202 and RFC 4231, keys longer than the block are hashed first */
+  r_assert_cmpptr ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, key, 80)), !=, NULL);
+  r_assert (r_hmac_update (hmac, "Test Using Larger Than Block-Size Key - Hash Key First", 54));
+  r_assert_cmpstr ((tmp = r_hmac_get_hex (hmac)), ==,
+      "aa4ae5e15272d00e95705637ce8a3b55ed402112");
+  r_free (tmp);
+  r_hmac_free (hmac);
+
+  r_assert_cmpptr ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA256, key, sizeof (key))), !=, NULL);
+  r_assert (r_hmac_update (hmac, "Test Using Larger Than Block-Size Key - Hash Key First", 54));
+  r_assert_cmpstr ((tmp = r_hmac_get_hex (hmac)), ==,
+      "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+  r_free (tmp);
+  r_hmac_free (hmac);
+}
+RTEST_END;
+
+RTEST (rcryptomac, hmac_reset, R_TEST_TYPE_FAST)
+{
+  RHmac * hmac;
+  rchar * tmp;
+  int i;
+
+  r_assert_cmpptr ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, "key", 3)), !=, NULL);
+  for (i = 0; i < 3; i++) {
+    r_assert (r_hmac_update (hmac, "The quick brown fox jumps over the lazy dog", 43));
+    r_assert_cmpstr ((tmp = r_hmac_get_hex (hmac)), ==,
+        "de7c9b85b8b78aa6bc8a7a36f70a90701c9db4d9");
+    r_free (tmp);
+    r_hmac_reset (hmac);
+  }
+  r_hmac_free (hmac);
+}
+RTEST_END;
+
+RTEST (rcryptomac, hmac_compute_iov, R_TEST_TYPE_FAST)
+{
+  RHmac * hmac;
+  RMemChunk iov[3] = {
+    { (ruint8 *)"The quick ", 10 },
+    { (ruint8 *)"brown fox jumps", 15 },
+    { (ruint8 *)" over the lazy dog", 18 },
+  };
+  ruint8 actual[64];
+  rsize size;
+
+  r_assert_cmpptr ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA256, "key", 3)), !=, NULL);
+  r_assert (r_hmac_update (hmac, "garbage before the reset", 24));
+  r_assert (r_hmac_compute_iov (hmac, iov, R_N_ELEMENTS (iov), actual, sizeof (actual), &size));
+  r_assert_cmpuint (size, ==, 32);
+  r_assert_cmpmem (actual, ==,
+      "\xf7\xbc\x83\xf4\x30\x53\x84\x24\xb1\x32\x98\xe6\xaa\x6f\xb1\x43"
+      "\xef\x4d\x59\xa1\x49\x46\x17\x59\x97\x47\x9d\xbc\x2d\x1a\x3c\xd8", size);
+
+  r_assert (r_hmac_compute_iov (hmac, NULL, 0, actual, sizeof (actual), &size));
+  r_assert_cmpmem (actual, ==,
+      "\x5d\x5d\x13\x95\x63\xc9\x5b\x59\x67\xb9\xbd\x9a\x8c\x9b\x23\x3a"
+      "\x9d\xed\xb4\x50\x72\x79\x4c\xd2\x32\xdc\x1b\x74\x83\x26\x07\xd0", size);
+  r_hmac_free (hmac);
+}
+RTEST_END;
+
+RTEST (rcryptomac, hmac_compute_multi, R_TEST_TYPE_FAST)
+{
+  RHmac * hmac;
+  ruint8 buf[512], expected[32], out[20 * 32];
+  RMemChunk msgs[20];
+  rsize i;
+
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = (ruint8)(i * 3);
+  for (i = 0; i < R_N_ELEMENTS (msgs); i++) {
+    msgs[i].data = buf + i;
+    msgs[i].size = 160 + i * 9;
+  }
+
+  r_assert_cmpptr ((hmac = r_hmac_new (R_MSG_DIGEST_TYPE_SHA1, "key", 3)), !=, NULL);
+  r_assert (r_hmac_compute_multi (hmac, msgs, R_N_ELEMENTS (msgs), out, sizeof (out)));
+  for (i = 0; i < R_N_ELEMENTS (msgs); i++) {
+    r_assert (r_hmac_compute_iov (hmac, &msgs[i], 1, expected, sizeof (expected), NULL));
+    r_assert_cmpmem (out + i * 20, ==, expected, 20);
+  }
+  r_assert (!r_hmac_compute_multi (hmac, msgs, R_N_ELEMENTS (msgs), out, 20));
+  r_hmac_free (hmac);
+}
+RTEST_END;
@@ -5,10 +5,13 @@ RTEST (rsrtpciphersuite, is_supported, RTEST_FAST)
   /* Update when new cipher suites are added!!! */
   r_assert (!r_srtp_cipher_suite_is_supported (R_SRTP_CS_F8_128_HMAC_SHA1_80));
 
-  r_assert (!r_srtp_cipher_suite_is_supported (R_SRTP_CS_AEAD_AES_128_GCM));
-  r_assert (!r_srtp_cipher_suite_is_supported (R_SRTP_CS_AEAD_AES_256_GCM));
+  r_assert (!r_srtp_cipher_suite_is_supported (R_SRTP_CS_SEED_128_GCM_96));
+  r_assert (!r_srtp_cipher_suite_is_supported (R_SRTP_CS_AES_256_CM_HMAC_SHA1_80));
 
   /* We support these srtp cipher suites! Yay*/
+  r_assert (r_srtp_cipher_suite_is_supported (R_SRTP_CS_AEAD_AES_128_GCM));
+  r_assert (r_srtp_cipher_suite_is_supported (R_SRTP_CS_AEAD_AES_256_GCM));
+
   r_assert (r_srtp_cipher_suite_is_supported (R_SRTP_CS_AES_128_CM_HMAC_SHA1_80));
   r_assert (r_srtp_cipher_suite_is_supported (R_SRTP_CS_AES_128_CM_HMAC_SHA1_32));
 
@@ -23,7 +26,24 @@ RTEST (rsrtpciphersuite, get_info, RTEST_FAST)
 {
   const RSRTPCipherSuiteInfo * info;
 
-  r_assert_cmpptr ((info = r_srtp_cipher_suite_get_info (R_SRTP_CS_AEAD_AES_256_GCM)), ==, NULL);
+  r_assert_cmpptr ((info = r_srtp_cipher_suite_get_info (R_SRTP_CS_SEED_128_GCM_96)), ==, NULL);
+
+  r_assert_cmpptr ((info = r_srtp_cipher_suite_get_info (R_SRTP_CS_AEAD_AES_128_GCM)), !=, NULL);
+  r_assert_cmpint (info->suite, ==, R_SRTP_CS_AEAD_AES_128_GCM);
+  r_assert_cmpint (info->cipher->type, ==, R_CRYPTO_CIPHER_ALGO_AES);
+  r_assert_cmpint (info->cipher->mode, ==, R_CRYPTO_CIPHER_MODE_GCM);
+  r_assert_cmpuint (info->cipher->keybits, ==, 128);
+  r_assert_cmpuint (info->cipher->ivsize, ==, 12);
+  r_assert_cmpint (info->saltbits, ==, 96);
+  r_assert_cmpint (info->auth, ==, R_MSG_DIGEST_TYPE_NONE);
+  r_assert_cmpint (info->srtp_tagbits, ==, 128);
+  r_assert_cmpint (info->srtcp_tagbits, ==, 128);
+
+  r_assert_cmpptr ((info = r_srtp_cipher_suite_get_info (R_SRTP_CS_AEAD_AES_256_GCM)), !=, NULL);
+  r_assert_cmpint (info->cipher->mode, ==, R_CRYPTO_CIPHER_MODE_GCM);
+  r_assert_cmpuint (info->cipher->keybits, ==, 256);
+  r_assert_cmpuint (info->kdprf->keybits, ==, 256);
+  r_assert_cmpint (info->saltbits, ==, 96);
 
   r_assert_cmpptr ((info = r_srtp_cipher_suite_get_info (R_SRTP_CS_AES_128_CM_HMAC_SHA1_80)), !=, NULL);
   r_assert_cmpint (info->suite, ==, R_SRTP_CS_AES_128_CM_HMAC_SHA1_80);
@@ -80,13 +100,13 @@ RTEST (rsrtpciphersuite, filter, RTEST_FAST)
     R_SRTP_CS_AES_128_CM_HMAC_SHA1_80,
   };
   const RSRTPCipherSuite nonsuites[] = {
-    R_SRTP_CS_AEAD_AES_256_GCM, /* Not supported */
+    R_SRTP_CS_SEED_128_GCM_96, /* Not supported */
     R_SRTP_CS_F8_128_HMAC_SHA1_80, /* Not supported */
     R_SRTP_CS_AES_128_CM_HMAC_SHA1_32,
     R_SRTP_CS_NULL_NULL,
   };
   const RSRTPCipherSuite suites[] = {
-    R_SRTP_CS_AEAD_AES_256_GCM, /* Not supported */
+    R_SRTP_CS_SEED_128_GCM_96, /* Not supported */
     R_SRTP_CS_F8_128_HMAC_SHA1_80, /* Not supported */
     R_SRTP_CS_AES_128_CM_HMAC_SHA1_80,
     R_SRTP_CS_NULL_NULL,
@@ -0,0 +1,172 @@
+#include <rlib/rlib.h>
+
+RTEST (repochptr, rec, RTEST_FAST)
+{
+  REpochPtrRec * rec = r_epoch_ptr_rec_new ();
+  r_assert_cmpptr (rec, !=, NULL);
+  r_epoch_ptr_rec_free (rec);
+}
+RTEST_END;
+
+RTEST (repochptr, read, RTEST_FAST)
+{
+  repochptr hp = R_EPOCH_PTR_INIT (NULL);
+  rpointer ptr;
+
+  ptr = r_epoch_ptr_aqcuire (&hp, NULL);
+  r_assert_cmpptr (ptr, ==, NULL);
+  r_epoch_ptr_release (&hp, NULL);
+}
+RTEST_END;
+
+RTEST (repochptr, replace, RTEST_FAST)
+{
+  repochptr hp = R_EPOCH_PTR_INIT (NULL);
+  rpointer ptr;
+
+  ptr = r_epoch_ptr_aqcuire (&hp, NULL);
+  r_assert_cmpptr (ptr, ==, NULL);
+  r_epoch_ptr_release (&hp, NULL);
+
+  r_epoch_ptr_replace (&hp, RUINT_TO_POINTER (0xCAFEBABE));
+
+  ptr = r_epoch_ptr_aqcuire (&hp, NULL);
+  r_assert_cmpptr (ptr, ==, RUINT_TO_POINTER (0xCAFEBABE));
+  r_epoch_ptr_release (&hp, NULL);
+}
+RTEST_END;
+
+typedef struct {
+  int i;
+  rpointer ptr;
+} TestHP;
+
+RTEST (repochptr, read_replace, RTEST_FAST)
+{
+  repochptr hp = R_EPOCH_PTR_INIT (r_free);
+  TestHP * ptr;
+
+  r_epoch_ptr_replace (&hp, r_mem_new0 (TestHP));
+
+  ptr = r_epoch_ptr_aqcuire (&hp, NULL);
+  r_assert_cmpptr (ptr, !=, NULL);
+  r_epoch_ptr_replace (&hp, NULL);
+
+  /* hp is set to NULL, but ptr should still be addressable */
+  r_assert_cmpint (ptr->i, ==, 0);
+  r_assert_cmpptr (ptr->ptr, ==, NULL);
+
+  r_epoch_ptr_release (&hp, NULL);
+
+  ptr = r_epoch_ptr_aqcuire (&hp, NULL);
+  r_assert_cmpptr (ptr, ==, NULL);
+  r_epoch_ptr_release (&hp, NULL);
+}
+RTEST_END;
+
+
+static rauint g__test_hp_freed;
+
+static void
+test_hp_free (rpointer data)
+{
+  r_atomic_uint_fetch_add (&g__test_hp_freed, 1);
+  r_free (data);
+}
+
+RTEST (repochptr, nested, RTEST_FAST)
+{
+  repochptr a = R_EPOCH_PTR_INIT (test_hp_free), b = R_EPOCH_PTR_INIT (test_hp_free);
+  REpochPtrRec * rec = r_epoch_ptr_rec_new ();
+  TestHP * pa, * pb;
+
+  r_atomic_uint_store (&g__test_hp_freed, 0);
+  r_epoch_ptr_replace (&a, r_mem_new0 (TestHP));
+  r_epoch_ptr_replace (&b, r_mem_new0 (TestHP));
+
+  r_assert_cmpptr ((pa = r_epoch_ptr_aqcuire (&a, rec)), !=, NULL);
+  r_assert_cmpptr ((pb = r_epoch_ptr_aqcuire (&b, rec)), !=, NULL);
+  r_epoch_ptr_replace (&a, NULL);
+  r_epoch_ptr_replace (&b, NULL);
+  r_assert_cmpuint (r_epoch_ptr_reclaim (NULL), ==, 2);
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 0);
+
+  /* Nothing is freed until the outermost release */
+  r_epoch_ptr_release (&a, rec);
+  r_assert_cmpuint (r_epoch_ptr_reclaim (NULL), ==, 2);
+  r_assert_cmpint (pb->i, ==, 0);
+  r_epoch_ptr_release (&b, rec);
+  r_assert_cmpuint (r_epoch_ptr_reclaim (NULL), ==, 0);
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 2);
+
+  r_epoch_ptr_rec_free (rec);
+}
+RTEST_END;
+
+RTEST (repochptr, batch, RTEST_FAST)
+{
+  repochptr hp = R_EPOCH_PTR_INIT (test_hp_free);
+  TestHP * first;
+  ruint i;
+
+  r_atomic_uint_store (&g__test_hp_freed, 0);
+  r_epoch_ptr_replace (&hp, r_mem_new0 (TestHP));
+  first = r_epoch_ptr_aqcuire (&hp, NULL);
+
+  /* The reader holds back everything retired since it aqcuired first */
+  for (i = 0; i < 1000; i++)
+    r_epoch_ptr_replace (&hp, r_mem_new0 (TestHP));
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 0);
+  r_assert_cmpint (first->i, ==, 0);
+  r_assert_cmpuint (r_epoch_ptr_reclaim (NULL), ==, 1000);
+  r_epoch_ptr_release (&hp, NULL);
+
+  /* Freed in batches along the way */
+  for (i = 0; i < 1000; i++)
+    r_epoch_ptr_replace (&hp, r_mem_new0 (TestHP));
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), >, 1500);
+
+  r_epoch_ptr_replace (&hp, NULL);
+  r_assert_cmpuint (r_epoch_ptr_reclaim (NULL), ==, 0);
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 2001);
+}
+RTEST_END;
+
+static rpointer
+test_hp_thread (rpointer data)
+{
+  repochptr * hp = data;
+  TestHP * ptr;
+  ruint i;
+
+  for (i = 0; i < 10000; i++) {
+    if ((ptr = r_epoch_ptr_aqcuire (hp, NULL)) != NULL)
+      r_assert_cmpint (ptr->i, ==, 42);
+    r_epoch_ptr_release (hp, NULL);
+
+    if ((i % 16) == 0) {
+      ptr = r_mem_new0 (TestHP);
+      ptr->i = 42;
+      r_epoch_ptr_replace (hp, ptr);
+    }
+  }
+
+  return NULL;
+}
+
+RTEST (repochptr, threads, RTEST_FAST)
+{
+  repochptr hp = R_EPOCH_PTR_INIT (test_hp_free);
+  RThread * threads[4];
+  ruint i;
+
+  for (i = 0; i < R_N_ELEMENTS (threads); i++)
+    r_assert_cmpptr ((threads[i] = r_thread_new (NULL, test_hp_thread, &hp)), !=, NULL);
+  for (i = 0; i < R_N_ELEMENTS (threads); i++) {
+    r_thread_join (threads[i]);
+    r_thread_unref (threads[i]);
+  }
+
+  r_epoch_ptr_replace (&hp, NULL);
+}
+RTEST_END;
@@ -1,6 +1,12 @@
 #include <rlib/rev.h>
 #include <rlib/ros.h>
 
+#if defined (__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
 RTEST (revloop, default, RTEST_FAST)
 {
   REvLoop * loop;
@@ -16,6 +22,33 @@ RTEST (revloop, default, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST (revloop, backend, RTEST_FAST)
+{
+  REvLoop * loop;
+  RClock * clock;
+
+  r_assert (r_ev_loop_backend_is_supported (R_EV_LOOP_BACKEND_DEFAULT));
+  r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+  r_assert_cmpint (r_ev_loop_get_backend (loop), !=, R_EV_LOOP_BACKEND_DEFAULT);
+  r_assert (r_ev_loop_backend_is_supported (r_ev_loop_get_backend (loop)));
+  r_ev_loop_unref (loop);
+
+  if (!r_ev_loop_backend_is_supported (R_EV_LOOP_BACKEND_IO_URING)) {
+    r_assert_cmpptr (r_ev_loop_new_with_backend (NULL, NULL,
+          R_EV_LOOP_BACKEND_IO_URING), ==, NULL);
+    return;
+  }
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_with_backend (clock, NULL,
+          R_EV_LOOP_BACKEND_IO_URING)), !=, NULL);
+  r_assert_cmpint (r_ev_loop_get_backend (loop), ==, R_EV_LOOP_BACKEND_IO_URING);
+  r_assert_cmpuint (r_ev_loop_get_syscalls (loop), ==, 0);
+  r_ev_loop_unref (loop);
+  r_clock_unref (clock);
+}
+RTEST_END;
+
 static rboolean
 prepare_cb (rpointer data, REvLoop * loop)
 {
@@ -272,6 +305,93 @@ RTEST (revloop, callback_later_cancel, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST (revloop, timer_stats, RTEST_FAST)
+{
+  REvLoop * loop;
+  RClock * clock;
+  REvLoopStats stats;
+  rsize size = 0;
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (clock, NULL)), !=, NULL);
+
+  r_assert (r_ev_loop_add_callback_at (loop, NULL, 0,
+        increment_rsize, &size, NULL));
+  r_assert (r_ev_loop_add_callback_at (loop, NULL, 5 * R_MSECOND,
+        increment_rsize, &size, NULL));
+  r_assert (r_ev_loop_add_callback_at (loop, NULL, 5 * R_MSECOND,
+        increment_rsize, &size, NULL));
+  r_test_clock_update_time (clock, 5 * R_MSECOND);
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+  r_assert_cmpuint (size, ==, 3);
+
+  r_ev_loop_get_stats (loop, &stats);
+  r_assert_cmpuint (stats.timers, ==, 3);
+  r_assert_cmpint (stats.lateness_sum, ==, 5 * R_MSECOND);
+  r_assert_cmpint (stats.lateness_max, ==, 5 * R_MSECOND);
+  r_assert_cmpuint (stats.lateness[0], ==, 2);
+  /* 5000us is in [2^12, 2^13) */
+  r_assert_cmpuint (stats.lateness[13], ==, 1);
+
+  r_ev_loop_reset_stats (loop);
+  r_ev_loop_get_stats (loop, &stats);
+  r_assert_cmpuint (stats.timers, ==, 0);
+  r_assert_cmpint (stats.lateness_max, ==, 0);
+  r_assert_cmpuint (stats.lateness[13], ==, 0);
+
+  r_ev_loop_unref (loop);
+  r_clock_unref (clock);
+}
+RTEST_END;
+
+/* Asks the kernel directly, so a build that ends up without epoll_pwait2
+ * shows up as a failure rather than a silent fallback to epoll_wait */
+static rboolean
+kernel_has_epoll_pwait2 (void)
+{
+#if defined (__linux__) && defined (SYS_epoll_pwait2)
+  return syscall (SYS_epoll_pwait2, -1, NULL, 0, NULL, NULL, 0) < 0 && errno != ENOSYS;
+#else
+  return FALSE;
+#endif
+}
+
+RTEST (revloop, high_res_timers, RTEST_FAST)
+{
+  REvLoop * loop;
+  REvLoopStats stats;
+  RClockTime deadline;
+  rsize size = 0;
+
+  r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+  r_assert (!r_ev_loop_get_high_res_timers (loop));
+
+  if (r_ev_loop_get_backend (loop) == R_EV_LOOP_BACKEND_EPOLL &&
+      !kernel_has_epoll_pwait2 ()) {
+    r_assert (!r_ev_loop_set_high_res_timers (loop, TRUE));
+    r_assert (!r_ev_loop_get_high_res_timers (loop));
+  } else {
+    r_assert (r_ev_loop_set_high_res_timers (loop, TRUE));
+    r_assert (r_ev_loop_get_high_res_timers (loop));
+
+    deadline = r_time_get_ts_monotonic () + R_USECOND * 300;
+    r_assert (r_ev_loop_add_callback_at (loop, NULL, deadline,
+          increment_rsize, &size, NULL));
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+    r_assert_cmpuint (size, ==, 1);
+    r_assert_cmpuint (r_time_get_ts_monotonic (), >=, deadline);
+
+    r_ev_loop_get_stats (loop, &stats);
+    r_assert_cmpuint (stats.timers, ==, 1);
+  }
+
+  r_assert (r_ev_loop_set_high_res_timers (loop, FALSE));
+  r_assert (!r_ev_loop_get_high_res_timers (loop));
+
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
+
 #if defined (R_OS_UNIX)
 typedef struct {
   REvIO * evio;
@@ -434,6 +554,103 @@ RTEST (revloop, add_task_with_taskgroup, RTEST_FAST)
 }
 RTEST_END;
 
+#define INVOKE_THREADS  4
+#define INVOKE_COUNT    1000
+
+typedef struct {
+  REvLoop * loop;
+  RThread * thread;
+  ruint count;
+} RInvokeCtx;
+
+static void
+invoke_count (rpointer data, REvLoop * loop)
+{
+  RInvokeCtx * ctx = data;
+
+  r_assert_cmpptr (loop, ==, ctx->loop);
+  r_assert_cmpptr (r_thread_current (), ==, ctx->thread);
+  ctx->count++;
+}
+
+static rpointer
+invoke_thread (rpointer data)
+{
+  RInvokeCtx * ctx = data;
+  ruint i;
+
+  for (i = 0; i < INVOKE_COUNT; i++)
+    r_assert (r_ev_loop_invoke (ctx->loop, invoke_count, ctx));
+
+  return NULL;
+}
+
+RTEST (revloop, invoke, RTEST_FAST)
+{
+  RThread * threads[INVOKE_THREADS];
+  RClock * clock;
+  RInvokeCtx ctx;
+  ruint i;
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((ctx.loop = r_ev_loop_new_full (clock, NULL)), !=, NULL);
+  r_clock_unref (clock);
+  ctx.thread = r_thread_current ();
+  ctx.count = 0;
+
+  r_assert (!r_ev_loop_invoke (NULL, invoke_count, &ctx));
+  r_assert (!r_ev_loop_invoke (ctx.loop, NULL, &ctx));
+
+  /* From the loop thread itself */
+  r_assert (r_ev_loop_invoke (ctx.loop, invoke_count, &ctx));
+  r_assert_cmpuint (ctx.count, ==, 0);
+  r_assert_cmpuint (r_ev_loop_run (ctx.loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+  r_assert_cmpuint (ctx.count, ==, 1);
+
+  ctx.count = 0;
+  for (i = 0; i < INVOKE_THREADS; i++)
+    r_assert_cmpptr ((threads[i] = r_thread_new ("invoke", invoke_thread, &ctx)), !=, NULL);
+  while (ctx.count < INVOKE_THREADS * INVOKE_COUNT)
+    r_ev_loop_run (ctx.loop, R_EV_LOOP_RUN_ONCE);
+  for (i = 0; i < INVOKE_THREADS; i++) {
+    r_thread_join (threads[i]);
+    r_thread_unref (threads[i]);
+  }
+  r_assert_cmpuint (ctx.count, ==, INVOKE_THREADS * INVOKE_COUNT);
+  r_assert_cmpuint (r_ev_loop_run (ctx.loop, R_EV_LOOP_RUN_NOWAIT), ==, 0);
+
+  r_ev_loop_unref (ctx.loop);
+}
+RTEST_END;
+
+static void
+invoke_not_reached (rpointer data, REvLoop * loop)
+{
+  (void) data;
+  (void) loop;
+
+  r_assert_not_reached ();
+}
+
+static void
+invoke_notify (rpointer data)
+{
+  (*(ruint *)data)++;
+}
+
+RTEST (revloop, invoke_pending_on_free, RTEST_FAST)
+{
+  REvLoop * loop;
+  ruint notified = 0;
+
+  r_assert_cmpptr ((loop = r_ev_loop_new ()), !=, NULL);
+  r_assert (r_ev_loop_invoke_full (loop, invoke_not_reached, &notified, invoke_notify));
+  r_assert (r_ev_loop_invoke_full (loop, invoke_not_reached, &notified, invoke_notify));
+  r_ev_loop_unref (loop);
+  r_assert_cmpuint (notified, ==, 2);
+}
+RTEST_END;
+
 RTEST (revio, user, RTEST_FAST)
 {
   REvLoop * loop;
@@ -0,0 +1,260 @@
+#include <rlib/rev.h>
+#include <rlib/ros.h>
+
+RTEST (revloopgroup, new, RTEST_FAST)
+{
+  REvLoopGroup * group;
+  ruint i;
+
+  r_assert_cmpptr (r_ev_loop_group_new (0), ==, NULL);
+
+  r_assert_cmpptr ((group = r_ev_loop_group_new (3)), !=, NULL);
+  r_assert_cmpuint (r_ev_loop_group_size (group), ==, 3);
+  for (i = 0; i < 3; i++) {
+    r_assert_cmpptr (r_ev_loop_group_get_loop (group, i), !=, NULL);
+    r_assert_cmpuint (r_ev_loop_group_get_cpu (group, i), ==, RSIZE_MAX);
+  }
+  r_assert_cmpptr (r_ev_loop_group_get_loop (group, 0), !=,
+      r_ev_loop_group_get_loop (group, 1));
+  r_assert_cmpptr (r_ev_loop_group_get_loop (group, 3), ==, NULL);
+  r_assert (!r_ev_loop_group_is_running (group));
+  r_ev_loop_group_unref (group);
+
+  r_assert_cmpptr ((group = r_ev_loop_group_new_on_cpus (NULL)), !=, NULL);
+  r_assert_cmpuint (r_ev_loop_group_size (group), ==, r_sys_cpu_allowed_count ());
+  for (i = 0; i < r_ev_loop_group_size (group); i++)
+    r_assert_cmpuint (r_ev_loop_group_get_cpu (group, i), <, RSIZE_MAX);
+  r_ev_loop_group_unref (group);
+}
+RTEST_END;
+
+typedef struct {
+  REvLoopGroup * group;
+  RThread * thread;
+  REvLoop * loops[4];
+  ruint count;
+} RGroupForeachCtx;
+
+static void
+group_foreach_record (rpointer data, REvLoop * loop)
+{
+  RGroupForeachCtx * ctx = data;
+
+  r_assert_cmpptr (loop, ==, r_ev_loop_group_get_loop (ctx->group, ctx->count));
+  if (r_ev_loop_group_is_running (ctx->group)) {
+    r_assert_cmpptr (r_ev_loop_current (), ==, loop);
+    r_assert_cmpptr (r_thread_current (), !=, ctx->thread);
+  } else {
+    r_assert_cmpptr (r_ev_loop_current (), ==, NULL);
+    r_assert_cmpptr (r_thread_current (), ==, ctx->thread);
+  }
+  ctx->loops[ctx->count++] = loop;
+}
+
+RTEST (revloopgroup, start_stop_foreach, RTEST_FAST)
+{
+  RGroupForeachCtx ctx;
+
+  r_assert_cmpptr ((ctx.group = r_ev_loop_group_new (4)), !=, NULL);
+  ctx.thread = r_thread_current ();
+
+  /* Not started, called right here */
+  ctx.count = 0;
+  r_assert (r_ev_loop_group_foreach (ctx.group, group_foreach_record, &ctx));
+  r_assert_cmpuint (ctx.count, ==, 4);
+
+  r_assert (r_ev_loop_group_start (ctx.group));
+  r_assert (r_ev_loop_group_is_running (ctx.group));
+  r_assert (!r_ev_loop_group_start (ctx.group));
+
+  /* Loops without any sources keep running */
+  r_thread_usleep (1000);
+  ctx.count = 0;
+  r_assert (r_ev_loop_group_foreach (ctx.group, group_foreach_record, &ctx));
+  r_assert_cmpuint (ctx.count, ==, 4);
+
+  r_ev_loop_group_stop (ctx.group);
+  r_assert (!r_ev_loop_group_is_running (ctx.group));
+  r_assert (!r_ev_loop_group_start (ctx.group));
+  r_assert (!r_ev_loop_group_foreach (ctx.group, group_foreach_record, &ctx));
+
+  r_ev_loop_group_unref (ctx.group);
+}
+RTEST_END;
+
+RTEST (revloopgroup, unref_running, RTEST_FAST)
+{
+  REvLoopGroup * group;
+
+  r_assert_cmpptr ((group = r_ev_loop_group_new (2)), !=, NULL);
+  r_assert (r_ev_loop_group_start (group));
+  r_ev_loop_group_unref (group);
+}
+RTEST_END;
+
+#define GROUP_UDP_LOOPS     3
+#define GROUP_UDP_SENDERS   64
+
+typedef struct {
+  REvUDP * evudp[GROUP_UDP_LOOPS];
+  ruint16 port[GROUP_UDP_LOOPS];
+  ruint count;
+  rauint received[GROUP_UDP_LOOPS];
+} RGroupUDPCtx;
+
+static void
+group_udp_recv (rpointer data, RBuffer * buf, RSocketAddress * addr, REvUDP * evudp)
+{
+  RGroupUDPCtx * ctx = data;
+  ruint i;
+  (void) buf;
+  (void) addr;
+
+  for (i = 0; i < GROUP_UDP_LOOPS; i++) {
+    if (ctx->evudp[i] == evudp) {
+      r_assert_cmpptr (r_ev_loop_current (), !=, NULL);
+      r_atomic_uint_fetch_add (&ctx->received[i], 1);
+      return;
+    }
+  }
+  r_assert_not_reached ();
+}
+
+static void
+group_udp_bound (rpointer data, REvUDP * evudp, REvLoop * loop)
+{
+  RGroupUDPCtx * ctx = data;
+  RSocketAddress * addr;
+
+  r_assert_cmpptr (r_ev_loop_current (), ==, loop);
+  r_assert_cmpptr ((addr = r_socket_get_local_address (r_ev_udp_get_socket (evudp))), !=, NULL);
+  r_assert (r_socket_get_reuseport (r_ev_udp_get_socket (evudp)));
+  ctx->port[ctx->count] = r_socket_address_ipv4_get_port (addr);
+  ctx->evudp[ctx->count++] = evudp;
+  r_socket_address_unref (addr);
+
+  r_assert (r_ev_udp_recv_start (evudp, NULL, group_udp_recv, ctx, NULL));
+}
+
+RTEST (revloopgroup, bind_udp, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoopGroup * group;
+  RSocketAddress * addr;
+  RGroupUDPCtx ctx;
+  ruint i, total;
+
+  r_memclear (&ctx, sizeof (RGroupUDPCtx));
+  r_assert_cmpptr ((group = r_ev_loop_group_new (GROUP_UDP_LOOPS)), !=, NULL);
+  r_assert (r_ev_loop_group_start (group));
+
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0)), !=, NULL);
+  r_assert (!r_ev_loop_group_bind_udp (group, addr, R_EV_LOOP_GROUP_BIND_NONE, NULL, &ctx));
+  r_assert (r_ev_loop_group_bind_udp (group, addr, R_EV_LOOP_GROUP_BIND_NONE, group_udp_bound, &ctx));
+  r_socket_address_unref (addr);
+
+  /* Every loop got its own socket on the same port */
+  r_assert_cmpuint (ctx.count, ==, GROUP_UDP_LOOPS);
+  r_assert_cmpuint (ctx.port[0], !=, 0);
+  for (i = 1; i < GROUP_UDP_LOOPS; i++)
+    r_assert_cmpuint (ctx.port[i], ==, ctx.port[0]);
+
+  /* The kernel spreads senders over the group by their address */
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, ctx.port[0])), !=, NULL);
+  for (i = 0; i < GROUP_UDP_SENDERS; i++) {
+    RSocket * s;
+    rsize sent;
+    r_assert_cmpptr ((s = r_socket_new (R_SOCKET_FAMILY_IPV4,
+            R_SOCKET_TYPE_DATAGRAM, R_SOCKET_PROTOCOL_UDP)), !=, NULL);
+    r_assert_cmpint (r_socket_send_to (s, addr, (const ruint8 *)"rlib", 4, &sent), ==, R_SOCKET_OK);
+    r_socket_unref (s);
+  }
+  r_socket_address_unref (addr);
+
+  do {
+    r_thread_usleep (1000);
+    for (i = 0, total = 0; i < GROUP_UDP_LOOPS; i++)
+      total += r_atomic_uint_load (&ctx.received[i]);
+  } while (total < GROUP_UDP_SENDERS);
+  r_assert_cmpuint (total, ==, GROUP_UDP_SENDERS);
+  for (i = 0; i < GROUP_UDP_LOOPS; i++)
+    r_assert_cmpuint (r_atomic_uint_load (&ctx.received[i]), >, 0);
+
+  r_ev_loop_group_unref (group);
+}
+RTEST_END;
+
+typedef struct {
+  RSocketAddress * bound;
+  rauint closed;
+} RGroupTCPCtx;
+
+static void
+group_tcp_echo (rpointer data, RBuffer * buf, REvTCP * evtcp)
+{
+  RGroupTCPCtx * ctx = data;
+
+  if (buf != NULL) {
+    r_assert (r_ev_tcp_send_and_forget (evtcp, buf));
+  } else {
+    r_ev_tcp_close (evtcp, NULL, NULL, NULL);
+    r_ev_tcp_unref (evtcp);
+    r_atomic_uint_store (&ctx->closed, TRUE);
+  }
+}
+
+static void
+group_tcp_connection (rpointer data, REvTCP * newtcp, REvTCP * listening)
+{
+  (void) listening;
+
+  r_assert (r_ev_tcp_recv_start (r_ev_tcp_ref (newtcp), NULL, group_tcp_echo, data, NULL));
+}
+
+static void
+group_tcp_bound (rpointer data, REvTCP * evtcp, REvLoop * loop)
+{
+  RGroupTCPCtx * ctx = data;
+  (void) loop;
+
+  if (ctx->bound == NULL)
+    r_assert_cmpptr ((ctx->bound = r_ev_tcp_get_local_address (evtcp)), !=, NULL);
+  r_assert_cmpint (r_ev_tcp_listen (evtcp, 16, group_tcp_connection, ctx, NULL), ==, R_SOCKET_OK);
+}
+
+RTEST (revloopgroup, bind_tcp_pinned, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoopGroup * group;
+  RSocketAddress * addr;
+  RGroupTCPCtx ctx;
+  RSocket * s;
+  ruint8 res[4];
+  rsize sent, recvd;
+
+  ctx.bound = NULL;
+  r_atomic_uint_store (&ctx.closed, FALSE);
+  r_assert_cmpptr ((group = r_ev_loop_group_new_on_cpus (NULL)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0)), !=, NULL);
+  r_assert (r_ev_loop_group_bind_tcp (group, addr,
+        R_EV_LOOP_GROUP_BIND_INCOMING_CPU | R_EV_LOOP_GROUP_BIND_CPU_STEERING,
+        group_tcp_bound, &ctx));
+  r_socket_address_unref (addr);
+  r_assert_cmpptr (ctx.bound, !=, NULL);
+  r_assert (r_ev_loop_group_start (group));
+
+  r_assert_cmpptr ((s = r_socket_new (R_SOCKET_FAMILY_IPV4,
+          R_SOCKET_TYPE_STREAM, R_SOCKET_PROTOCOL_TCP)), !=, NULL);
+  r_assert (r_socket_set_blocking (s, TRUE));
+  r_assert_cmpint (r_socket_connect (s, ctx.bound), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_socket_send (s, (const ruint8 *)"rlib", 4, &sent), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_socket_receive (s, res, sizeof (res), &recvd), ==, R_SOCKET_OK);
+  r_assert_cmpuint (recvd, ==, 4);
+  r_assert_cmpint (r_memcmp (res, "rlib", 4), ==, 0);
+  r_socket_close (s);
+  r_socket_unref (s);
+  while (!r_atomic_uint_load (&ctx.closed))
+    r_thread_usleep (1000);
+
+  r_socket_address_unref (ctx.bound);
+  r_ev_loop_group_unref (group);
+}
+RTEST_END;
@@ -76,3 +76,80 @@ RTEST (revtcp, listen_connect_accept_send_recv, RTEST_FAST | RTEST_SYSTEM)
 }
 RTEST_END;
 
+typedef struct {
+  ruint8 * data;
+  rsize size;
+} REvTCPTestRecvCtx;
+
+static void
+data_received_append (rpointer data, RBuffer * buf, REvTCP * evtcp)
+{
+  REvTCPTestRecvCtx * ctx = data;
+
+  (void) evtcp;
+
+  if (buf != NULL)
+    ctx->size += r_buffer_extract (buf, 0, ctx->data + ctx->size, 64 * 1024 - ctx->size);
+}
+
+RTEST (revtcp, ring_send_recv, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RClock * clock;
+  RSocketAddress * addr;
+  REvTCP * server, * servcli = NULL, * client;
+  rboolean conn = FALSE;
+  REvTCPTestRecvCtx ctx;
+  ruint8 * data;
+  rsize i;
+
+  if (!r_ev_loop_backend_is_supported (R_EV_LOOP_BACKEND_IO_URING))
+    return;
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_with_backend (clock, NULL,
+          R_EV_LOOP_BACKEND_IO_URING)), !=, NULL);
+  r_clock_unref (clock);
+
+  r_assert_cmpptr ((client = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((server = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x6364)), !=, NULL);
+  r_assert_cmpint (r_ev_tcp_bind (server, addr, TRUE), ==, R_SOCKET_OK);
+
+  r_assert_cmpint (r_ev_tcp_listen (server, 10, new_connection_ready, &servcli, NULL), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_ev_tcp_connect (client, addr, client_connected, &conn, NULL), ==, R_SOCKET_WOULD_BLOCK);
+  r_socket_address_unref (addr);
+
+  while (servcli == NULL)
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE), >, 0);
+  r_assert (conn);
+  r_assert (r_ev_tcp_close (server, NULL, NULL, NULL));
+  r_ev_tcp_unref (server);
+
+  /* Sends bigger than the provided buffers, gathered into one sendmsg */
+  data = r_malloc (64 * 1024);
+  ctx.data = r_malloc (64 * 1024);
+  ctx.size = 0;
+  for (i = 0; i < 64 * 1024; i++)
+    data[i] = (ruint8)(i * 7);
+  for (i = 0; i < 4; i++)
+    r_assert (r_ev_tcp_send_dup (client, data + i * 16 * 1024, 16 * 1024, NULL, NULL, NULL));
+  r_assert (r_ev_tcp_recv_start (servcli, NULL, data_received_append, &ctx, NULL));
+  while (ctx.size < 64 * 1024)
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE), >, 0);
+  r_assert (r_ev_tcp_recv_stop (servcli));
+
+  r_assert_cmpint (r_memcmp (ctx.data, data, 64 * 1024), ==, 0);
+  r_assert_cmpuint (r_ev_loop_get_syscalls (loop), >, 0);
+  r_free (ctx.data);
+  r_free (data);
+
+  r_assert (r_ev_tcp_close (client, NULL, NULL, NULL));
+  r_assert (r_ev_tcp_close (servcli, NULL, NULL, NULL));
+  r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP), ==, 0);
+
+  r_ev_tcp_unref (client);
+  r_ev_tcp_unref (servcli);
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
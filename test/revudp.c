@@ -172,3 +172,180 @@ RTEST (revudp, task_recv, RTEST_FAST | RTEST_SYSTEM)
 }
 RTEST_END;
 
+
+static void
+buffer_recv_batch (rpointer user, RBuffer ** bufs, RSocketAddress ** addrs,
+    ruint count, REvUDP * evudp)
+{
+  ruint i;
+
+  for (i = 0; i < count; i++)
+    buffer_recv (user, bufs[i], addrs[i], evudp);
+}
+
+RTEST (revudp, batch_send_recv, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RClock * clock;
+  RSocketAddress * addr;
+  REvUDP * udp1, * udp2;
+  REvUDPTestRecvCtx ctx;
+  ruint8 sendbuf[8][64];
+  RBuffer * sentbuf[8];
+  RList * it;
+  ruint i;
+
+  r_memclear (&ctx, sizeof (REvUDPTestRecvCtx));
+  r_memclear (sentbuf, sizeof (sentbuf));
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (clock, NULL)), !=, NULL);
+  r_clock_unref (clock);
+
+  r_assert_cmpptr ((udp1 = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x4242)), !=, NULL);
+  r_assert (r_ev_udp_bind (udp1, addr, TRUE));
+
+  r_assert (!r_ev_udp_recv_batch_start (udp1, 0, NULL, buffer_recv_batch, &ctx, NULL));
+  r_assert (!r_ev_udp_recv_batch_start (udp1, 4, NULL, NULL, &ctx, NULL));
+  r_assert (r_ev_udp_recv_batch_start (udp1, 4, NULL, buffer_recv_batch, &ctx, NULL));
+
+  r_assert_cmpptr ((udp2 = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  for (i = 0; i < R_N_ELEMENTS (sendbuf); i++) {
+    r_memset (sendbuf[i], 0x42 + i, sizeof (sendbuf[i]));
+    r_assert (r_ev_udp_send_take (udp2, r_memdup (sendbuf[i], 64), 64, addr,
+          buffer_send_done, &sentbuf[i], NULL));
+  }
+
+  while (r_list_len (ctx.buffers) < R_N_ELEMENTS (sendbuf))
+    r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE);
+
+  r_assert (r_ev_udp_recv_stop (udp1));
+
+  for (i = 0, it = ctx.buffers; it != NULL; it = it->next, i++) {
+    r_assert_cmpptr (sentbuf[i], !=, NULL);
+    r_assert_cmpbufmem (sentbuf[i], 0, -1, ==, sendbuf[i], 64);
+    r_assert_cmpbufmem (it->data, 0, -1, ==, sendbuf[i], 64);
+    r_buffer_unref (sentbuf[i]);
+  }
+  r_assert_cmpuint (r_list_len (ctx.addrs), ==, R_N_ELEMENTS (sendbuf));
+
+  r_list_destroy_full (ctx.buffers, r_buffer_unref);
+  r_list_destroy_full (ctx.addrs, r_socket_address_unref);
+
+  r_socket_address_unref (addr);
+  r_ev_udp_unref (udp1);
+  r_ev_udp_unref (udp2);
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
+
+static void
+buffer_recv_batch_stop (rpointer user, RBuffer ** bufs, RSocketAddress ** addrs,
+    ruint count, REvUDP * evudp)
+{
+  buffer_recv_batch (user, bufs, addrs, count, evudp);
+  r_assert (r_ev_udp_recv_stop (evudp));
+}
+
+RTEST (revudp, batch_recv_stop_in_callback, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RClock * clock;
+  RSocketAddress * addr;
+  REvUDP * udp1, * udp2;
+  REvUDPTestRecvCtx ctx;
+  ruint8 sendbuf[64];
+  ruint i;
+
+  r_memclear (&ctx, sizeof (REvUDPTestRecvCtx));
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (clock, NULL)), !=, NULL);
+  r_clock_unref (clock);
+
+  r_assert_cmpptr ((udp1 = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x4244)), !=, NULL);
+  r_assert (r_ev_udp_bind (udp1, addr, TRUE));
+  r_assert (r_ev_udp_recv_batch_start (udp1, 4, NULL, buffer_recv_batch_stop, &ctx, NULL));
+
+  /* More than one batch waiting, but nothing after the stop is delivered */
+  r_assert_cmpptr ((udp2 = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_memset (sendbuf, 0x42, sizeof (sendbuf));
+  for (i = 0; i < 8; i++) {
+    r_assert (r_ev_udp_send_take (udp2, r_memdup (sendbuf, 64), 64, addr,
+          NULL, NULL, NULL));
+  }
+
+  while (r_list_len (ctx.buffers) == 0)
+    r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE);
+  r_ev_loop_run (loop, R_EV_LOOP_RUN_NOWAIT);
+
+  r_assert_cmpuint (r_list_len (ctx.buffers), >, 0);
+  r_assert_cmpuint (r_list_len (ctx.buffers), <=, 4);
+  r_assert_cmpuint (r_list_len (ctx.addrs), ==, r_list_len (ctx.buffers));
+
+  r_list_destroy_full (ctx.buffers, r_buffer_unref);
+  r_list_destroy_full (ctx.addrs, r_socket_address_unref);
+
+  r_socket_address_unref (addr);
+  r_ev_udp_unref (udp1);
+  r_ev_udp_unref (udp2);
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
+
+RTEST (revudp, ring_batch_send_recv, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RClock * clock;
+  RSocketAddress * addr;
+  REvUDP * udp1, * udp2;
+  REvUDPTestRecvCtx ctx;
+  ruint8 sendbuf[64][64];
+  RList * it;
+  ruint i;
+
+  if (!r_ev_loop_backend_is_supported (R_EV_LOOP_BACKEND_IO_URING))
+    return;
+
+  r_memclear (&ctx, sizeof (REvUDPTestRecvCtx));
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_with_backend (clock, NULL,
+          R_EV_LOOP_BACKEND_IO_URING)), !=, NULL);
+  r_clock_unref (clock);
+
+  r_assert_cmpptr ((udp1 = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x4243)), !=, NULL);
+  r_assert (r_ev_udp_bind (udp1, addr, TRUE));
+  r_assert (r_ev_udp_recv_batch_start (udp1, 8, NULL, buffer_recv_batch, &ctx, NULL));
+
+  r_assert_cmpptr ((udp2 = r_ev_udp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  for (i = 0; i < R_N_ELEMENTS (sendbuf); i++) {
+    r_memset (sendbuf[i], 0x42 + i, sizeof (sendbuf[i]));
+    r_assert (r_ev_udp_send_take (udp2, r_memdup (sendbuf[i], 64), 64, addr,
+          NULL, NULL, NULL));
+  }
+
+  while (r_list_len (ctx.buffers) < R_N_ELEMENTS (sendbuf))
+    r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE);
+  r_assert (r_ev_udp_recv_stop (udp1));
+
+  for (i = 0, it = ctx.buffers; it != NULL; it = it->next, i++)
+    r_assert_cmpbufmem (it->data, 0, -1, ==, sendbuf[i], 64);
+  for (it = ctx.addrs; it != NULL; it = it->next)
+    r_assert_cmpuint (r_socket_address_get_family (it->data), ==, R_SOCKET_FAMILY_IPV4);
+  r_assert_cmpuint (r_list_len (ctx.addrs), ==, R_N_ELEMENTS (sendbuf));
+  /* One sendmmsg and no more than a couple of io_uring_enter */
+  r_assert_cmpuint (r_ev_loop_get_syscalls (loop), <, 8);
+
+  r_list_destroy_full (ctx.buffers, r_buffer_unref);
+  r_list_destroy_full (ctx.addrs, r_socket_address_unref);
+
+  r_socket_address_unref (addr);
+  r_ev_udp_unref (udp1);
+  r_ev_udp_unref (udp2);
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
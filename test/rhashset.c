@@ -101,3 +101,26 @@ RTEST (rhashset, foreach, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rhashset, reserve, RTEST_FAST)
+{
+  RHashSet * hs;
+  rsize allocsize, i;
+
+  r_assert_cmpptr ((hs = r_hash_set_new (NULL, NULL)), !=, NULL);
+  r_assert (r_hash_set_reserve (hs, 500));
+  r_assert_cmpuint ((allocsize = r_hash_set_current_alloc_size (hs)), >=, 500);
+
+  for (i = 0; i < 500; i++)
+    r_assert (r_hash_set_insert (hs, RSIZE_TO_POINTER (i)));
+  r_assert_cmpuint (r_hash_set_size (hs), ==, 500);
+  r_assert_cmpuint (r_hash_set_current_alloc_size (hs), ==, allocsize);
+
+  for (i = 0; i < 500; i += 2)
+    r_assert (r_hash_set_remove (hs, RSIZE_TO_POINTER (i)));
+  for (i = 0; i < 500; i++)
+    r_assert_cmpint (r_hash_set_contains (hs, RSIZE_TO_POINTER (i)), ==, i & 1);
+
+  r_hash_set_unref (hs);
+}
+RTEST_END;
@@ -232,3 +232,66 @@ RTEST (rhashtable, foreach, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rhashtable, reserve, RTEST_FAST)
+{
+  RHashTable * ht;
+  rsize allocsize, i;
+
+  r_assert_cmpptr ((ht = r_hash_table_new (NULL, NULL)), !=, NULL);
+  r_assert_cmpint (r_hash_table_reserve (NULL, 1000), ==, R_HASH_TABLE_INVAL);
+  r_assert_cmpint (r_hash_table_reserve (ht, 1000), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint ((allocsize = r_hash_table_current_alloc_size (ht)), >=, 1000);
+
+  for (i = 0; i < 1000; i++) {
+    r_assert_cmpint (r_hash_table_insert (ht, RSIZE_TO_POINTER (i),
+          RSIZE_TO_POINTER (i + 1)), ==, R_HASH_TABLE_OK);
+  }
+  r_assert_cmpuint (r_hash_table_current_alloc_size (ht), ==, allocsize);
+
+  /* Never shrinks */
+  r_assert_cmpint (r_hash_table_reserve (ht, 10), ==, R_HASH_TABLE_OK);
+  r_assert_cmpuint (r_hash_table_current_alloc_size (ht), ==, allocsize);
+  for (i = 0; i < 1000; i++) {
+    r_assert_cmpuint (RPOINTER_TO_SIZE (r_hash_table_lookup (ht,
+            RSIZE_TO_POINTER (i))), ==, i + 1);
+  }
+
+  r_hash_table_unref (ht);
+}
+RTEST_END;
+
+RTEST (rhashtable, insert_remove_churn, RTEST_FAST)
+{
+  RHashTable * ht;
+  rsize i, j;
+
+  r_assert_cmpptr ((ht = r_hash_table_new (NULL, NULL)), !=, NULL);
+
+  /* A sliding window of keys leaves a trail of removed slots behind,
+   * which must be reused rather than grow the table. */
+  for (i = 0; i < 100000; i++) {
+    r_assert_cmpint (r_hash_table_insert (ht, RSIZE_TO_POINTER (i),
+          RSIZE_TO_POINTER (i + 1)), ==, R_HASH_TABLE_OK);
+    if (i >= 64) {
+      r_assert_cmpint (r_hash_table_remove (ht, RSIZE_TO_POINTER (i - 64)),
+          ==, R_HASH_TABLE_OK);
+    }
+    if (i % 997 == 0) {
+      for (j = i > 64 ? i - 64 : 0; j <= i; j++) {
+        r_assert_cmpint (r_hash_table_contains (ht, RSIZE_TO_POINTER (j)),
+            ==, (i >= 64 && j == i - 64) ? R_HASH_TABLE_NOT_FOUND : R_HASH_TABLE_OK);
+      }
+    }
+  }
+
+  r_assert_cmpuint (r_hash_table_size (ht), ==, 64);
+  r_assert_cmpuint (r_hash_table_current_alloc_size (ht), <=, 256);
+  for (i = 100000 - 64; i < 100000; i++) {
+    r_assert_cmpuint (RPOINTER_TO_SIZE (r_hash_table_lookup (ht,
+            RSIZE_TO_POINTER (i))), ==, i + 1);
+  }
+
+  r_hash_table_unref (ht);
+}
+RTEST_END;
@@ -173,6 +173,139 @@ RTEST (rhttp, body_buffer, RTEST_FAST)
 }
 RTEST_END;
 
+static const rchar http_pipelined_requests[] =
+  "GET /a HTTP/1.1\r\n"
+  "Host: example.org\r\n"
+  "\r\n"
+  "POST /b HTTP/1.1\r\n"
+  "Host: example.org\r\n"
+  "Content-Length: 6\r\n"
+  "\r\n"
+  "foobar"
+  "POST /c HTTP/1.1\r\n"
+  "Host: example.org\r\n"
+  "Transfer-Encoding: chunked\r\n"
+  "\r\n"
+  "4\r\nWiki\r\n"
+  "5;ext=1\r\npedia\r\n"
+  "e\r\n in\r\n\r\nchunks.\r\n"
+  "0\r\n"
+  "X-Trailer: ignored\r\n"
+  "\r\n"
+  "GET /d HTTP/1.0\r\n"
+  "Host: example.org\r\n"
+  "\r\n";
+
+static void
+r_test_http_request_parser_run (RHttpRequestParser * parser,
+    rsize step, RString * log)
+{
+  const rchar * ptr = http_pipelined_requests;
+  rsize left = sizeof (http_pipelined_requests) - 1;
+
+  while (left > 0) {
+    RHttpParseEvent ev;
+    RHttpRequest * req;
+    RBuffer * buf;
+    RHttpError err;
+    rsize size = MIN (step, left);
+
+    r_assert_cmpptr ((buf = r_buffer_new_dup (ptr, size)), !=, NULL);
+    r_assert (r_http_request_parser_push (parser, buf));
+    r_buffer_unref (buf);
+    ptr += size;
+    left -= size;
+
+    while ((ev = r_http_request_parser_next (parser, &req, &buf, &err)) != R_HTTP_PARSE_NEED_DATA) {
+      RUri * uri;
+      rchar * tmp;
+
+      r_assert_cmpint (err, ==, R_HTTP_OK);
+      switch (ev) {
+        case R_HTTP_PARSE_REQUEST:
+        case R_HTTP_PARSE_END:
+          r_assert_cmpptr (req, !=, NULL);
+          r_assert_cmpptr ((uri = r_http_request_get_uri (req)), !=, NULL);
+          r_string_append_printf (log, "%s%s%s", ev == R_HTTP_PARSE_REQUEST ? "<" : ">",
+              (tmp = r_uri_get_path (uri)), r_http_request_is_persistent (req) ? "" : "!");
+          r_free (tmp);
+          r_uri_unref (uri);
+          r_http_request_unref (req);
+          break;
+        case R_HTTP_PARSE_BODY:
+          r_assert_cmpptr (buf, !=, NULL);
+          r_assert_cmpptr ((tmp = r_buffer_extract_dup (buf, 0, -1, &size)), !=, NULL);
+          r_string_append_len (log, tmp, size);
+          r_free (tmp);
+          r_buffer_unref (buf);
+          break;
+        default:
+          r_assert_not_reached ();
+      }
+    }
+  }
+}
+
+RTEST (rhttp, request_parser_pipelined, RTEST_FAST)
+{
+  static const rsize steps[] = { 1, 2, 3, 7, 64, sizeof (http_pipelined_requests) };
+  RHttpRequestParser * parser;
+  rsize i;
+
+  for (i = 0; i < R_N_ELEMENTS (steps); i++) {
+    RString * log;
+    rchar * tmp;
+
+    r_assert_cmpptr ((parser = r_http_request_parser_new ()), !=, NULL);
+    r_assert_cmpptr ((log = r_string_new (NULL)), !=, NULL);
+
+    r_test_http_request_parser_run (parser, steps[i], log);
+    r_assert_cmpstr ((tmp = r_string_free_keep (log)), ==,
+        "</a>/a</bfoobar>/b</cWikipedia in\r\n\r\nchunks.>/c</d!>/d!");
+    r_free (tmp);
+    r_assert_cmpuint (r_http_request_parser_get_buffered (parser), ==, 0);
+
+    r_http_request_parser_free (parser);
+  }
+}
+RTEST_END;
+
+RTEST (rhttp, request_parser_error, RTEST_FAST)
+{
+  RHttpRequestParser * parser;
+  RHttpRequest * req;
+  RBuffer * buf;
+  RHttpError err;
+
+  r_assert_cmpptr ((parser = r_http_request_parser_new ()), !=, NULL);
+  r_assert_cmpint (r_http_request_parser_next (parser, &req, &buf, &err), ==, R_HTTP_PARSE_NEED_DATA);
+
+  r_assert_cmpptr ((buf = r_buffer_new_dup (R_STR_WITH_SIZE_ARGS (
+            "POST / HTTP/1.1\r\nHost: example.org\r\nTransfer-Encoding: chunked\r\n\r\n"
+            "zz\r\n"))), !=, NULL);
+  r_assert (r_http_request_parser_push (parser, buf));
+  r_buffer_unref (buf);
+
+  r_assert_cmpint (r_http_request_parser_next (parser, &req, &buf, &err), ==, R_HTTP_PARSE_REQUEST);
+  r_assert_cmpptr (req, !=, NULL);
+  r_http_request_unref (req);
+  r_assert_cmpint (r_http_request_parser_next (parser, &req, &buf, &err), ==, R_HTTP_PARSE_ERROR);
+  r_assert_cmpint (err, ==, R_HTTP_BAD_DATA);
+  r_assert_cmpptr (req, ==, NULL);
+  r_assert_cmpptr (buf, ==, NULL);
+  r_http_request_parser_free (parser);
+
+  r_assert_cmpptr ((parser = r_http_request_parser_new ()), !=, NULL);
+  r_assert_cmpptr ((buf = r_buffer_new_dup (R_STR_WITH_SIZE_ARGS (
+            "GET / HTTP/1.1\r\nX-Foo: bar\r\n\r\n"))), !=, NULL);
+  r_assert (r_http_request_parser_push (parser, buf));
+  r_buffer_unref (buf);
+  r_assert_cmpint (r_http_request_parser_next (parser, &req, &buf, &err), ==, R_HTTP_PARSE_ERROR);
+  r_assert_cmpint (err, ==, R_HTTP_MISSING_HOST);
+  r_http_request_parser_free (parser);
+}
+RTEST_END;
+
 RTEST (rhttp, new_200_response, RTEST_FAST)
 {
   RHttpResponse * res;
@@ -1,4 +1,5 @@
 #include <rlib/rnet.h>
+#include <rlib/rev.h>
 
 static void
 r_test_http_server_stop (RHttpServer * server)
@@ -145,3 +146,136 @@ RTEST (rhttpserver, handle_GET, RTEST_FAST)
 }
 RTEST_END;
 
+
+static RHttpResponse *
+r_test_http_echo_handler (rpointer data,
+    RHttpRequest * req, RSocketAddress * addr, RHttpServer * server)
+{
+  RHttpResponse * ret;
+  RBuffer * body;
+
+  (void) data;
+  (void) addr;
+  (void) server;
+
+  if ((ret = r_http_response_new (req, R_HTTP_STATUS_OK, NULL, NULL, NULL)) != NULL) {
+    if ((body = r_http_request_get_body_buffer (req)) != NULL) {
+      r_http_response_set_body_buffer (ret, body);
+      r_buffer_unref (body);
+    }
+  }
+
+  return ret;
+}
+
+static void
+r_test_http_stream_body (rpointer data,
+    RHttpRequest * req, RBuffer * buf, RHttpServer * server)
+{
+  RString * str = data;
+  rchar * tmp;
+  rsize size;
+
+  (void) req;
+  (void) server;
+
+  if (buf != NULL) {
+    tmp = r_buffer_extract_dup (buf, 0, -1, &size);
+    r_string_append_printf (str, "[%.*s]", (int)size, tmp);
+    r_free (tmp);
+  } else {
+    r_string_append (str, "$");
+  }
+}
+
+typedef struct {
+  const rchar * reqs;
+  RString * str;
+} RTestHttpClient;
+
+static void
+r_test_http_client_recv (rpointer data, RBuffer * buf, REvTCP * evtcp)
+{
+  RTestHttpClient * cli = data;
+
+  (void) evtcp;
+
+  if (buf != NULL) {
+    rchar * tmp;
+    rsize size;
+
+    tmp = r_buffer_extract_dup (buf, 0, -1, &size);
+    r_string_append_len (cli->str, tmp, size);
+    r_free (tmp);
+  }
+}
+
+static void
+r_test_http_client_connected (rpointer data, REvTCP * evtcp, int status)
+{
+  RTestHttpClient * cli = data;
+
+  r_assert_cmpint (status, ==, R_SOCKET_OK);
+  r_assert (r_ev_tcp_send_dup (evtcp, cli->reqs, r_strlen (cli->reqs), NULL, NULL, NULL));
+  r_assert (r_ev_tcp_recv_start (evtcp, NULL, r_test_http_client_recv, cli, NULL));
+}
+
+RTEST (rhttpserver, tcp_pipelined_chunked, RTEST_FAST | RTEST_SYSTEM)
+{
+  REvLoop * loop;
+  RClock * clock;
+  RHttpServer * srv;
+  RSocketAddress * addr;
+  REvTCP * client;
+  RTestHttpClient cli = { NULL, NULL };
+  RString * stream;
+  rchar * tmp;
+  static const rchar expected[] =
+    "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"
+    "HTTP/1.1 200 OK\r\nContent-Length: 6\r\n\r\nfoobar"
+    "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n"
+    "HTTP/1.1 200 OK\r\n\r\n";
+  static const rchar reqs[] =
+    "GET /echo HTTP/1.1\r\nHost: localhost\r\n\r\n"
+    "POST /echo HTTP/1.1\r\nHost: localhost\r\nTransfer-Encoding: chunked\r\n\r\n"
+    "3\r\nfoo\r\n3\r\nbar\r\n0\r\n\r\n"
+    "PUT /stream HTTP/1.1\r\nHost: localhost\r\nContent-Length: 4\r\n\r\n"
+    "1337"
+    "GET /echo HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+
+  r_assert_cmpptr ((clock = r_test_clock_new (FALSE)), !=, NULL);
+  r_assert_cmpptr ((loop = r_ev_loop_new_full (clock, NULL)), !=, NULL);
+  r_clock_unref (clock);
+
+  cli.reqs = reqs;
+  r_assert_cmpptr ((cli.str = r_string_new (NULL)), !=, NULL);
+  r_assert_cmpptr ((stream = r_string_new (NULL)), !=, NULL);
+  r_assert_cmpptr ((srv = r_http_server_new (loop)), !=, NULL);
+  r_assert (r_http_server_set_handler (srv, "/", -1,
+        r_test_http_echo_handler, NULL, NULL));
+  r_assert (r_http_server_set_body_handler (srv, "/stream", -1,
+        r_test_http_stream_body, stream, NULL));
+
+  r_assert_cmpptr ((addr = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 4243)), !=, NULL);
+  r_assert (r_http_server_listen (srv, addr));
+
+  r_assert_cmpptr ((client = r_ev_tcp_new (R_SOCKET_FAMILY_IPV4, loop)), !=, NULL);
+  r_assert_cmpint (r_ev_tcp_connect (client, addr,
+        r_test_http_client_connected, &cli, NULL), ==, R_SOCKET_WOULD_BLOCK);
+  r_socket_address_unref (addr);
+
+  while (r_string_length (cli.str) < sizeof (expected) - 1)
+    r_assert_cmpuint (r_ev_loop_run (loop, R_EV_LOOP_RUN_ONCE), >, 0);
+  r_assert (r_ev_tcp_close (client, NULL, NULL, NULL));
+  r_http_server_stop (srv, NULL, NULL, NULL);
+  r_ev_loop_run (loop, R_EV_LOOP_RUN_LOOP);
+
+  r_assert_cmpstr ((tmp = r_string_free_keep (stream)), ==, "[1337]$"); r_free (tmp);
+  r_assert_cmpstr ((tmp = r_string_free_keep (cli.str)), ==, expected);
+  r_free (tmp);
+
+  r_ev_tcp_unref (client);
+  r_http_server_unref (srv);
+  r_ev_loop_unref (loop);
+}
+RTEST_END;
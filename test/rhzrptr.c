@@ -64,3 +64,105 @@ RTEST (rhzrptr, read_replace, RTEST_FAST)
 }
 RTEST_END;
 
+
+static rauint g__test_hp_freed;
+
+static void
+test_hp_free (rpointer data)
+{
+  r_atomic_uint_fetch_add (&g__test_hp_freed, 1);
+  r_free (data);
+}
+
+RTEST (rhzrptr, slots, RTEST_FAST)
+{
+  rhzrptr a = R_HZR_PTR_INIT (test_hp_free), b = R_HZR_PTR_INIT (test_hp_free);
+  RHzrPtrRec * rec = r_hzr_ptr_rec_new ();
+  TestHP * pa, * pb;
+
+  r_atomic_uint_store (&g__test_hp_freed, 0);
+  r_hzr_ptr_replace (&a, r_mem_new0 (TestHP));
+  r_hzr_ptr_replace (&b, r_mem_new0 (TestHP));
+
+  r_assert_cmpptr ((pa = r_hzr_ptr_aqcuire (&a, rec)), !=, NULL);
+  r_assert_cmpptr ((pb = r_hzr_ptr_aqcuire (&b, rec)), !=, NULL);
+  r_hzr_ptr_replace (&a, NULL);
+  r_hzr_ptr_replace (&b, NULL);
+  r_assert_cmpuint (r_hzr_ptr_reclaim (NULL), ==, 2);
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 0);
+
+  /* Released out of order */
+  r_hzr_ptr_release (&a, rec);
+  r_assert_cmpuint (r_hzr_ptr_reclaim (NULL), ==, 1);
+  r_assert_cmpint (pb->i, ==, 0);
+  r_hzr_ptr_release (&b, rec);
+  r_assert_cmpuint (r_hzr_ptr_reclaim (NULL), ==, 0);
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 2);
+
+  r_hzr_ptr_rec_free (rec);
+}
+RTEST_END;
+
+RTEST (rhzrptr, batch, RTEST_FAST)
+{
+  rhzrptr hp = R_HZR_PTR_INIT (test_hp_free);
+  TestHP * first;
+  ruint i;
+
+  r_atomic_uint_store (&g__test_hp_freed, 0);
+  r_hzr_ptr_replace (&hp, r_mem_new0 (TestHP));
+  first = r_hzr_ptr_aqcuire (&hp, NULL);
+
+  for (i = 0; i < 1000; i++)
+    r_hzr_ptr_replace (&hp, r_mem_new0 (TestHP));
+  /* Freed in batches along the way, except for the one held */
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), >, 900);
+  r_assert_cmpint (first->i, ==, 0);
+  r_assert_cmpuint (r_hzr_ptr_reclaim (NULL), ==, 1);
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 999);
+
+  r_hzr_ptr_release (&hp, NULL);
+  r_hzr_ptr_replace (&hp, NULL);
+  r_assert_cmpuint (r_hzr_ptr_reclaim (NULL), ==, 0);
+  r_assert_cmpuint (r_atomic_uint_load (&g__test_hp_freed), ==, 1001);
+}
+RTEST_END;
+
+static rpointer
+test_hp_thread (rpointer data)
+{
+  rhzrptr * hp = data;
+  TestHP * ptr;
+  ruint i;
+
+  for (i = 0; i < 10000; i++) {
+    if ((ptr = r_hzr_ptr_aqcuire (hp, NULL)) != NULL)
+      r_assert_cmpint (ptr->i, ==, 42);
+    r_hzr_ptr_release (hp, NULL);
+
+    if ((i % 16) == 0) {
+      ptr = r_mem_new0 (TestHP);
+      ptr->i = 42;
+      r_hzr_ptr_replace (hp, ptr);
+    }
+  }
+
+  return NULL;
+}
+
+RTEST (rhzrptr, threads, RTEST_FAST)
+{
+  rhzrptr hp = R_HZR_PTR_INIT (test_hp_free);
+  RThread * threads[4];
+  ruint i;
+
+  for (i = 0; i < R_N_ELEMENTS (threads); i++)
+    r_assert_cmpptr ((threads[i] = r_thread_new (NULL, test_hp_thread, &hp)), !=, NULL);
+  for (i = 0; i < R_N_ELEMENTS (threads); i++) {
+    r_thread_join (threads[i]);
+    r_thread_unref (threads[i]);
+  }
+
+  r_hzr_ptr_replace (&hp, NULL);
+}
+RTEST_END;
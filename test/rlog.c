@@ -94,3 +94,92 @@ RTEST_F (rlog, threshold, RTEST_FAST)
 }
 RTEST_END;
 
+
+#ifdef R_OS_UNIX
+#define ASYNC_THREADS   4
+#define ASYNC_MSGS      1000
+
+static rpointer
+rlog_async_thread (rpointer data)
+{
+  ruint i;
+
+  (void) data;
+
+  for (i = 0; i < ASYNC_MSGS; i++) {
+    r_log_msg (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_INFO,
+        __FILE__, __LINE__, R_STRFUNC, "asynctest");
+  }
+
+  return NULL;
+}
+
+/* Logs ASYNC_MSGS from ASYNC_THREADS threads through a RLogAsync writing
+ * to a temporary file and returns the number of lines that made it */
+static rsize
+rlog_async_run (RLogAsyncPolicy policy, rsize ringsize, ruint * dropped)
+{
+  RThread * threads[ASYNC_THREADS];
+  RLogLevel oldlvl = r_log_category_get_threshold (R_LOG_CAT_DEFAULT);
+  RLogAsync * async;
+  RLogFunc oldfunc;
+  RIOHandle handle;
+  rpointer olddata;
+  rchar * path = NULL;
+  ruint8 * data;
+  rsize i, size, ret;
+
+  r_assert_cmpint ((handle = r_io_open_tmp_full (NULL, "rlogasync", R_FILE_RDWR,
+          R_FILE_SHARE_EXCLUSIVE, R_FILE_FLAG_NONE, NULL, &path)), !=, R_IO_HANDLE_INVALID);
+  r_assert_cmpptr ((async = r_log_async_new (handle, ringsize, policy)), !=, NULL);
+
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, R_LOG_LEVEL_INFO);
+  oldfunc = r_log_override_default_handler (r_log_async_handler, async, &olddata);
+  for (i = 0; i < ASYNC_THREADS; i++)
+    r_assert_cmpptr ((threads[i] = r_thread_new ("logger", rlog_async_thread, NULL)), !=, NULL);
+  for (i = 0; i < ASYNC_THREADS; i++) {
+    r_thread_join (threads[i]);
+    r_thread_unref (threads[i]);
+  }
+  r_log_async_flush (async);
+  r_log_override_default_handler (oldfunc, olddata, NULL);
+  r_log_category_set_threshold (R_LOG_CAT_DEFAULT, oldlvl);
+
+  *dropped = r_log_async_get_dropped (async);
+  r_log_async_free (async);
+  r_assert (r_io_close (handle));
+
+  r_assert (r_file_read_all (path, &data, &size));
+  for (i = ret = 0; i < size; i++) {
+    if (data[i] == '\n' && i >= 9 && r_memcmp (&data[i - 9], "asynctest", 9) == 0)
+      ret++;
+  }
+  r_free (data);
+  remove (path);
+  r_free (path);
+
+  return ret;
+}
+
+RTEST (rlog, async_block, RTEST_FAST | RTEST_SYSTEM)
+{
+  ruint dropped = 0;
+
+  /* Small rings, so producers have to wait for the writer */
+  r_assert_cmpuint (rlog_async_run (R_LOG_ASYNC_BLOCK, 1024, &dropped), ==,
+      ASYNC_THREADS * ASYNC_MSGS);
+  r_assert_cmpuint (dropped, ==, 0);
+}
+RTEST_END;
+
+RTEST (rlog, async_drop, RTEST_FAST | RTEST_SYSTEM)
+{
+  ruint dropped = 0;
+  rsize lines;
+
+  lines = rlog_async_run (R_LOG_ASYNC_DROP, 256, &dropped);
+  r_assert_cmpuint (lines, >, 0);
+  r_assert_cmpuint (lines + dropped, ==, ASYNC_THREADS * ASYNC_MSGS);
+}
+RTEST_END;
+#endif
@@ -44,6 +44,110 @@ RTEST (rmemallocator, alloc, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST (rmemallocator, pool_recycle, RTEST_FAST)
+{
+  RMemAllocator * a;
+  RMem * mem, * view, * copy;
+  rpointer prev;
+
+  r_assert_cmpptr ((a = r_mem_allocator_pool_new ("test-pool", 2048, 4)), !=, NULL);
+  r_assert_cmpstr (a->mem_type, ==, "test-pool");
+  r_assert_cmpuint (r_mem_allocator_pool_slab_size (a), ==, 2048);
+
+  r_assert_cmpptr ((mem = r_mem_allocator_alloc (a, 0, 1024, 16, 16, 0x0f)), !=, NULL);
+  r_assert_cmpptr (mem->allocator, ==, a);
+  r_assert_cmpuint (mem->size, ==, 1024);
+  r_assert_cmpuint (mem->offset, ==, 16);
+  prev = mem;
+  r_mem_unref (mem);
+
+  /* Freed slab is handed out again */
+  r_assert_cmpptr ((mem = r_mem_allocator_alloc (a, 0, 2048, 0, 0, 0)), ==, prev);
+  r_assert_cmpuint (mem->allocsize, ==, 2048);
+  r_assert (r_mem_resize (mem, 0, 4));
+
+  r_assert_cmpptr ((view = r_mem_view (mem, 1, 2)), !=, NULL);
+  r_assert_cmpptr ((copy = r_mem_copy (mem, 1, 2)), !=, NULL);
+  r_assert_cmpptr (copy->allocator, ==, a);
+  r_mem_unref (mem);
+  r_mem_unref (view);
+  r_mem_unref (copy);
+
+  /* Oversized requests bypass the pool */
+  r_assert_cmpptr ((mem = r_mem_allocator_alloc (a, R_MEM_FLAG_ZERO_PADDED, 4096, 0, 64, 0x0f)), !=, NULL);
+  r_assert_cmpptr (mem->allocator, ==, a);
+  r_assert_cmpuint (mem->allocsize, ==, 4096 + 64);
+  r_assert (r_mem_is_zero_padded (mem));
+  r_mem_unref (mem);
+
+  r_mem_allocator_unref (a);
+
+  r_assert_cmpptr (r_mem_allocator_pool_slab_size (NULL), ==, 0);
+  r_assert_cmpptr ((a = r_mem_allocator_default ()), !=, NULL);
+  r_assert_cmpptr (r_mem_allocator_pool_slab_size (a), ==, 0);
+  r_mem_allocator_unref (a);
+}
+RTEST_END;
+
+RTEST (rmemallocator, pool_register, RTEST_FAST)
+{
+  RMemAllocator * a;
+
+  r_assert_cmpptr (r_mem_allocator_find ("test-register-pool"), ==, NULL);
+  r_assert_cmpptr ((a = r_mem_allocator_pool_new ("test-register-pool", 512, 16)), !=, NULL);
+  r_mem_allocator_register (a);
+
+  r_assert_cmpptr ((a = r_mem_allocator_find ("test-register-pool")), !=, NULL);
+  r_assert_cmpuint (r_mem_allocator_pool_slab_size (a), ==, 512);
+  r_mem_allocator_unref (a);
+}
+RTEST_END;
+
+#define POOL_THREAD_MEMS  64
+typedef struct {
+  RMemAllocator * a;
+  RMem * mems[POOL_THREAD_MEMS];
+} PoolThreadCtx;
+
+static rpointer
+pool_thread_alloc (rpointer data)
+{
+  PoolThreadCtx * ctx = data;
+  ruint i;
+
+  for (i = 0; i < POOL_THREAD_MEMS; i++) {
+    r_assert_cmpptr ((ctx->mems[i] = r_mem_allocator_alloc (ctx->a,
+            0, 256, 0, 0, 0)), !=, NULL);
+  }
+
+  return NULL;
+}
+
+RTEST (rmemallocator, pool_cross_thread, RTEST_FAST)
+{
+  PoolThreadCtx ctx;
+  RThread * t;
+  ruint i, round;
+
+  r_assert_cmpptr ((ctx.a = r_mem_allocator_pool_new ("test-thread-pool", 256, 8)), !=, NULL);
+
+  /* Allocate on another thread, release here, so slabs flow through the depot */
+  for (round = 0; round < 4; round++) {
+    r_assert_cmpptr ((t = r_thread_new ("pool-alloc", pool_thread_alloc, &ctx)), !=, NULL);
+    r_thread_join (t);
+    r_thread_unref (t);
+
+    for (i = 0; i < POOL_THREAD_MEMS; i++) {
+      r_assert_cmpptr (ctx.mems[i]->allocator, ==, ctx.a);
+      r_assert_cmpuint (ctx.mems[i]->size, ==, 256);
+      r_mem_unref (ctx.mems[i]);
+    }
+  }
+
+  r_mem_allocator_unref (ctx.a);
+}
+RTEST_END;
+
 RTEST (rmem, resize, RTEST_FAST)
 {
   RMem * mem;
@@ -1,5 +1,9 @@
 #include <rlib/rlib.h>
 
+#if defined (__x86_64__) && defined (__GNUC__)
+#include <cpuid.h>
+#endif
+
 RTEST (rmsgdigest, type_string, R_TEST_TYPE_FAST)
 {
   r_assert_cmpstr (r_msg_digest_type_string (R_MSG_DIGEST_TYPE_MD5), ==, "md5");
@@ -267,3 +271,151 @@ RTEST (rmsgdigest, sha512_fill_block, R_TEST_TYPE_FAST)
 }
 RTEST_END;
 
+
+RTEST (rmsgdigest, clone, R_TEST_TYPE_FAST)
+{
+  RMsgDigest * md = r_msg_digest_new_sha1 ();
+  RMsgDigest * other = r_msg_digest_new_sha256 ();
+  RMsgDigest * snapshot;
+  rchar * hex;
+
+  r_assert (r_msg_digest_update (md, "foo", 3));
+  r_assert_cmpptr ((snapshot = r_msg_digest_clone (md)), !=, NULL);
+  r_assert (r_msg_digest_update (md, "bar", 3));
+  r_assert_cmpstr ((hex = r_msg_digest_get_hex (md)), ==,
+      "8843d7f92416211de9ebb963ff4ce28125932878");
+  r_free (hex);
+
+  /* Restore a finished digest to the snapshot */
+  r_assert (r_msg_digest_finish (md));
+  r_assert (r_msg_digest_copy (md, snapshot));
+  r_assert (r_msg_digest_update (md, "bar", 3));
+  r_assert_cmpstr ((hex = r_msg_digest_get_hex (md)), ==,
+      "8843d7f92416211de9ebb963ff4ce28125932878");
+  r_free (hex);
+
+  r_assert (!r_msg_digest_copy (other, snapshot));
+  r_assert_cmpptr (r_msg_digest_clone (NULL), ==, NULL);
+
+  r_msg_digest_free (snapshot);
+  r_msg_digest_free (other);
+  r_msg_digest_free (md);
+}
+RTEST_END;
+
+RTEST (rmsgdigest, impl, R_TEST_TYPE_FAST)
+{
+  static const RMsgDigestType types[] = {
+    R_MSG_DIGEST_TYPE_SHA1, R_MSG_DIGEST_TYPE_SHA224, R_MSG_DIGEST_TYPE_SHA256 };
+  static const RMsgDigestImpl impls[] = {
+    R_MSG_DIGEST_IMPL_SHANI, R_MSG_DIGEST_IMPL_AVX2 };
+  ruint8 msg[300], expected[32], actual[32];
+  rsize i, j, size;
+
+  for (size = 0; size < sizeof (msg); size++)
+    msg[size] = (ruint8)(size * 7 + 1);
+
+  r_assert (r_msg_digest_impl_available (R_MSG_DIGEST_IMPL_AUTO));
+  r_assert (r_msg_digest_impl_available (R_MSG_DIGEST_IMPL_PORTABLE));
+  r_assert_cmpptr (r_msg_digest_new_with_impl (R_MSG_DIGEST_TYPE_MD5, R_MSG_DIGEST_IMPL_SHANI), ==, NULL);
+
+  for (i = 0; i < R_N_ELEMENTS (impls); i++) {
+    if (!r_msg_digest_impl_available (impls[i])) {
+      r_assert_cmpptr (r_msg_digest_new_with_impl (R_MSG_DIGEST_TYPE_SHA1, impls[i]), ==, NULL);
+      continue;
+    }
+
+    for (j = 0; j < R_N_ELEMENTS (types); j++) {
+      for (size = 0; size < sizeof (msg); size += 13) {
+        RMsgDigest * ref = r_msg_digest_new_with_impl (types[j], R_MSG_DIGEST_IMPL_PORTABLE);
+        RMsgDigest * md = r_msg_digest_new_with_impl (types[j], impls[i]);
+
+        r_assert_cmpptr (md, !=, NULL);
+        r_assert_cmpint (r_msg_digest_get_impl (md), ==, impls[i]);
+        r_assert (r_msg_digest_update (ref, msg, size));
+        /* Split so both the buffered and the multi-block paths are hit */
+        r_assert (r_msg_digest_update (md, msg, size / 3));
+        r_assert (r_msg_digest_update (md, msg + size / 3, size - size / 3));
+        r_assert (r_msg_digest_get_data (ref, expected, sizeof (expected), NULL));
+        r_assert (r_msg_digest_get_data (md, actual, sizeof (actual), NULL));
+        r_assert_cmpmem (actual, ==, expected, r_msg_digest_size (md));
+
+        r_msg_digest_free (ref);
+        r_msg_digest_free (md);
+      }
+    }
+  }
+}
+RTEST_END;
+
+/* SHA-NI and the AVX2 lanes have to follow the CPU, so a build without
+ * HAVE_X86_SHA shows up here rather than only in the benchmarks */
+RTEST (rmsgdigest, impl_cpu, R_TEST_TYPE_FAST)
+{
+#if defined (__x86_64__) && defined (__GNUC__)
+  unsigned int eax, ebx = 0, ecx, edx;
+
+  if (__get_cpuid_max (0, NULL) >= 7)
+    __cpuid_count (7, 0, eax, ebx, ecx, edx);
+  r_assert_cmpint (r_msg_digest_impl_available (R_MSG_DIGEST_IMPL_SHANI), ==,
+      (ebx & bit_SHA) && __builtin_cpu_supports ("ssse3") && __builtin_cpu_supports ("sse4.1"));
+  r_assert_cmpint (r_msg_digest_impl_available (R_MSG_DIGEST_IMPL_AVX2), ==,
+      __builtin_cpu_supports ("avx2") != 0);
+#else
+  r_assert (!r_msg_digest_impl_available (R_MSG_DIGEST_IMPL_SHANI));
+  r_assert (!r_msg_digest_impl_available (R_MSG_DIGEST_IMPL_AVX2));
+#endif
+}
+RTEST_END;
+
+RTEST (rmsgdigest, compute_multi, R_TEST_TYPE_FAST)
+{
+  static const RMsgDigestType types[] = {
+    R_MSG_DIGEST_TYPE_MD5, R_MSG_DIGEST_TYPE_SHA1, R_MSG_DIGEST_TYPE_SHA256 };
+  static const RMsgDigestImpl impls[] = {
+    R_MSG_DIGEST_IMPL_AUTO, R_MSG_DIGEST_IMPL_PORTABLE, R_MSG_DIGEST_IMPL_SHANI,
+    R_MSG_DIGEST_IMPL_AVX2 };
+  ruint8 buf[1024], expected[32], out[13 * 32];
+  RMemChunk msgs[13];
+  rsize i, j, k, count, mdsize;
+
+  for (i = 0; i < sizeof (buf); i++)
+    buf[i] = (ruint8)(i * 13 + 5);
+  /* Different lengths, a few of them sharing full blocks */
+  for (k = 0; k < R_N_ELEMENTS (msgs); k++) {
+    msgs[k].data = buf + k * 17;
+    msgs[k].size = (k * 71) % 300;
+  }
+
+  for (i = 0; i < R_N_ELEMENTS (impls); i++) {
+    for (j = 0; j < R_N_ELEMENTS (types); j++) {
+      RMsgDigest * init, * ref;
+
+      if ((init = r_msg_digest_new_with_impl (types[j], impls[i])) == NULL)
+        continue;
+      mdsize = r_msg_digest_size (init);
+
+      for (count = 0; count <= R_N_ELEMENTS (msgs); count += 4) {
+        /* Start both from a fresh state and from a partially filled one */
+        r_msg_digest_reset (init);
+        if (count & 4)
+          r_assert (r_msg_digest_update (init, "rlib", 4));
+
+        r_assert (r_msg_digest_compute_multi (init, msgs, count, out, sizeof (out)));
+        for (k = 0; k < count; k++) {
+          r_assert_cmpptr ((ref = r_msg_digest_new (types[j])), !=, NULL);
+          if (count & 4)
+            r_assert (r_msg_digest_update (ref, "rlib", 4));
+          r_assert (r_msg_digest_update (ref, msgs[k].data, msgs[k].size));
+          r_assert (r_msg_digest_get_data (ref, expected, sizeof (expected), NULL));
+          r_assert_cmpmem (out + k * mdsize, ==, expected, mdsize);
+          r_msg_digest_free (ref);
+        }
+      }
+
+      r_assert (!r_msg_digest_compute_multi (init, msgs, R_N_ELEMENTS (msgs), out, mdsize));
+      r_msg_digest_free (init);
+    }
+  }
+}
+RTEST_END;
@@ -69,3 +69,187 @@ RTEST (rqueuering, clear, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rqueuespsc, basics, RTEST_FAST)
+{
+  RQueueSPSC * q;
+  rpointer items[8];
+  rpointer in[] = { RUINT_TO_POINTER (1), RUINT_TO_POINTER (2),
+    RUINT_TO_POINTER (3), RUINT_TO_POINTER (4), RUINT_TO_POINTER (5) };
+
+  r_assert_cmpptr (r_queue_spsc_new (0), ==, NULL);
+  r_assert_cmpptr (r_queue_spsc_new (RSIZE_MAX), ==, NULL);
+
+  /* Rounded up to a power of 2 */
+  r_assert_cmpptr ((q = r_queue_spsc_new (3)), !=, NULL);
+  r_assert_cmpuint (r_queue_spsc_capacity (q), ==, 4);
+  r_assert_cmpptr (r_queue_spsc_pop (q), ==, NULL);
+  r_assert (!r_queue_spsc_push (q, NULL));
+
+  r_assert (r_queue_spsc_push (q, RUINT_TO_POINTER (42)));
+  r_assert_cmpuint (r_queue_spsc_size (q), ==, 1);
+  r_assert_cmpptr (r_queue_spsc_pop (q), ==, RUINT_TO_POINTER (42));
+  r_assert_cmpuint (r_queue_spsc_size (q), ==, 0);
+
+  /* Partial batches when full or empty, wrapping around the ring */
+  r_assert_cmpuint (r_queue_spsc_push_n (q, in, R_N_ELEMENTS (in)), ==, 4);
+  r_assert (!r_queue_spsc_push (q, RUINT_TO_POINTER (42)));
+  r_assert_cmpuint (r_queue_spsc_pop_n (q, items, 3), ==, 3);
+  r_assert_cmpptr (items[0], ==, RUINT_TO_POINTER (1));
+  r_assert_cmpptr (items[2], ==, RUINT_TO_POINTER (3));
+  r_assert_cmpuint (r_queue_spsc_push_n (q, in + 4, 1), ==, 1);
+  r_assert_cmpuint (r_queue_spsc_pop_n (q, items, R_N_ELEMENTS (items)), ==, 2);
+  r_assert_cmpptr (items[0], ==, RUINT_TO_POINTER (4));
+  r_assert_cmpptr (items[1], ==, RUINT_TO_POINTER (5));
+  r_assert_cmpuint (r_queue_spsc_pop_n (q, items, R_N_ELEMENTS (items)), ==, 0);
+
+  r_queue_spsc_unref (q);
+}
+RTEST_END;
+
+RTEST (rqueuempmc, basics, RTEST_FAST)
+{
+  RQueueMPMC * q;
+  rpointer items[8];
+  rpointer in[] = { RUINT_TO_POINTER (1), RUINT_TO_POINTER (2),
+    RUINT_TO_POINTER (3), RUINT_TO_POINTER (4), RUINT_TO_POINTER (5) };
+
+  r_assert_cmpptr (r_queue_mpmc_new (0), ==, NULL);
+  r_assert_cmpptr (r_queue_mpmc_new (RSIZE_MAX), ==, NULL);
+
+  r_assert_cmpptr ((q = r_queue_mpmc_new (3)), !=, NULL);
+  r_assert_cmpuint (r_queue_mpmc_capacity (q), ==, 4);
+  r_assert_cmpptr (r_queue_mpmc_pop (q), ==, NULL);
+  r_assert (!r_queue_mpmc_push (q, NULL));
+
+  r_assert (r_queue_mpmc_push (q, RUINT_TO_POINTER (42)));
+  r_assert_cmpuint (r_queue_mpmc_size (q), ==, 1);
+  r_assert_cmpptr (r_queue_mpmc_pop (q), ==, RUINT_TO_POINTER (42));
+  r_assert_cmpuint (r_queue_mpmc_size (q), ==, 0);
+
+  r_assert_cmpuint (r_queue_mpmc_push_n (q, in, R_N_ELEMENTS (in)), ==, 4);
+  r_assert (!r_queue_mpmc_push (q, RUINT_TO_POINTER (42)));
+  r_assert_cmpuint (r_queue_mpmc_size (q), ==, 4);
+  r_assert_cmpuint (r_queue_mpmc_pop_n (q, items, 3), ==, 3);
+  r_assert_cmpptr (items[0], ==, RUINT_TO_POINTER (1));
+  r_assert_cmpptr (items[2], ==, RUINT_TO_POINTER (3));
+  r_assert_cmpuint (r_queue_mpmc_push_n (q, in + 4, 1), ==, 1);
+  r_assert_cmpuint (r_queue_mpmc_pop_n (q, items, R_N_ELEMENTS (items)), ==, 2);
+  r_assert_cmpptr (items[0], ==, RUINT_TO_POINTER (4));
+  r_assert_cmpptr (items[1], ==, RUINT_TO_POINTER (5));
+  r_assert_cmpuint (r_queue_mpmc_pop_n (q, items, R_N_ELEMENTS (items)), ==, 0);
+
+  r_queue_mpmc_unref (q);
+}
+RTEST_END;
+
+#define TEST_QUEUE_ITEMS    100000
+
+static rpointer
+test_spsc_producer (rpointer data)
+{
+  RQueueSPSC * q = data;
+  rsize i;
+
+  for (i = 1; i <= TEST_QUEUE_ITEMS; i++) {
+    while (!r_queue_spsc_push (q, RSIZE_TO_POINTER (i)))
+      r_thread_yield ();
+  }
+
+  return NULL;
+}
+
+RTEST (rqueuespsc, threads, RTEST_FAST)
+{
+  RQueueSPSC * q;
+  RThread * thread;
+  rpointer items[16];
+  rsize i, n, next = 1;
+
+  r_assert_cmpptr ((q = r_queue_spsc_new (64)), !=, NULL);
+  r_assert_cmpptr ((thread = r_thread_new (NULL, test_spsc_producer, q)), !=, NULL);
+
+  while (next <= TEST_QUEUE_ITEMS) {
+    if ((n = r_queue_spsc_pop_n (q, items, R_N_ELEMENTS (items))) == 0)
+      r_thread_yield ();
+    for (i = 0; i < n; i++)
+      r_assert_cmpptr (items[i], ==, RSIZE_TO_POINTER (next++));
+  }
+
+  r_thread_join (thread);
+  r_thread_unref (thread);
+  r_assert_cmpuint (r_queue_spsc_size (q), ==, 0);
+  r_queue_spsc_unref (q);
+}
+RTEST_END;
+
+typedef struct {
+  RQueueMPMC * q;
+  rauint popped;
+  rauint sum;
+} TestMPMC;
+
+static rpointer
+test_mpmc_producer (rpointer data)
+{
+  TestMPMC * t = data;
+  rpointer items[4];
+  rsize i, j, n;
+
+  for (i = 1; i <= TEST_QUEUE_ITEMS; i += R_N_ELEMENTS (items)) {
+    for (j = 0; j < R_N_ELEMENTS (items); j++)
+      items[j] = RSIZE_TO_POINTER (i + j);
+    for (j = 0; j < R_N_ELEMENTS (items); j += n) {
+      if ((n = r_queue_mpmc_push_n (t->q, items + j, R_N_ELEMENTS (items) - j)) == 0)
+        r_thread_yield ();
+    }
+  }
+
+  return NULL;
+}
+
+static rpointer
+test_mpmc_consumer (rpointer data)
+{
+  TestMPMC * t = data;
+  rpointer item;
+
+  while (r_atomic_uint_load (&t->popped) < 2 * TEST_QUEUE_ITEMS) {
+    if ((item = r_queue_mpmc_pop (t->q)) != NULL) {
+      r_atomic_uint_fetch_add (&t->sum, RPOINTER_TO_UINT (item));
+      r_atomic_uint_fetch_add (&t->popped, 1);
+    } else {
+      r_thread_yield ();
+    }
+  }
+
+  return NULL;
+}
+
+RTEST (rqueuempmc, threads, RTEST_FAST)
+{
+  TestMPMC t;
+  RThread * threads[4];
+  ruint i;
+
+  r_assert_cmpptr ((t.q = r_queue_mpmc_new (64)), !=, NULL);
+  r_atomic_uint_store (&t.popped, 0);
+  r_atomic_uint_store (&t.sum, 0);
+
+  for (i = 0; i < R_N_ELEMENTS (threads); i++) {
+    r_assert_cmpptr ((threads[i] = r_thread_new (NULL,
+            (i % 2) ? test_mpmc_consumer : test_mpmc_producer, &t)), !=, NULL);
+  }
+  for (i = 0; i < R_N_ELEMENTS (threads); i++) {
+    r_thread_join (threads[i]);
+    r_thread_unref (threads[i]);
+  }
+
+  /* Two producers pushing 1 to TEST_QUEUE_ITEMS each */
+  r_assert_cmpuint (r_atomic_uint_load (&t.popped), ==, 2 * TEST_QUEUE_ITEMS);
+  r_assert_cmpuint (r_atomic_uint_load (&t.sum), ==,
+      (ruint)((rsize)TEST_QUEUE_ITEMS * (TEST_QUEUE_ITEMS + 1)));
+  r_assert_cmpuint (r_queue_mpmc_size (t.q), ==, 0);
+  r_queue_mpmc_unref (t.q);
+}
+RTEST_END;
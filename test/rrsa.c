@@ -146,6 +146,63 @@ RTEST (rrsa, encrypt_decrypt_1024, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST (rrsa, crt, RTEST_FAST)
+{
+  RCryptoKey * key, * full, * plain, * bad;
+  rmpint n, e, d, p, q, dp, dq, qp;
+  ruint8 in[64], a[64], b[64], c[64];
+  rsize size;
+  RPrng * prng;
+  ruint i;
+
+  r_assert_cmpptr ((prng = r_prng_new_mt_with_seed (42)), !=, NULL);
+  r_assert_cmpptr ((key = r_rsa_priv_key_new_gen (512, 65537, prng)), !=, NULL);
+  r_mpint_init (&n); r_mpint_init (&e); r_mpint_init (&d);
+  r_mpint_init (&p); r_mpint_init (&q);
+  r_mpint_init (&dp); r_mpint_init (&dq); r_mpint_init (&qp);
+  r_assert (r_rsa_pub_key_get_n (key, &n));
+  r_assert (r_rsa_pub_key_get_e (key, &e));
+  r_assert (r_rsa_priv_key_get_d (key, &d));
+  r_assert (r_rsa_priv_key_get_p (key, &p));
+  r_assert (r_rsa_priv_key_get_q (key, &q));
+  r_assert (r_rsa_priv_key_get_dp (key, &dp));
+  r_assert (r_rsa_priv_key_get_dq (key, &dq));
+  r_assert (r_rsa_priv_key_get_qp (key, &qp));
+
+  /* Without p and q the private exponent is used as is */
+  r_assert_cmpptr ((plain = r_rsa_priv_key_new (&n, &e, &d)), !=, NULL);
+  r_assert_cmpptr ((full = r_rsa_priv_key_new_full (0, &n, &e, &d, &p, &q, &dp, &dq, &qp)), !=, NULL);
+
+  for (i = 0; i < 16; i++) {
+    r_assert (r_prng_fill (prng, in, sizeof (in)));
+    in[0] &= 0x7f;
+    size = sizeof (a);
+    r_assert_cmpint (r_rsa_raw_decrypt (full, in, sizeof (in), a, &size), ==, R_CRYPTO_OK);
+    size = sizeof (b);
+    r_assert_cmpint (r_rsa_raw_decrypt (plain, in, sizeof (in), b, &size), ==, R_CRYPTO_OK);
+    r_assert_cmpmem (a, ==, b, sizeof (a));
+    size = sizeof (c);
+    r_assert_cmpint (r_rsa_raw_encrypt (full, NULL, a, sizeof (a), c, &size), ==, R_CRYPTO_OK);
+    r_assert_cmpmem (c, ==, in, sizeof (in));
+  }
+
+  /* A faulty CRT result must never be returned */
+  r_assert (r_mpint_add_u32 (&qp, &qp, 1));
+  r_assert_cmpptr ((bad = r_rsa_priv_key_new_full (0, &n, &e, &d, &p, &q, &dp, &dq, &qp)), !=, NULL);
+  size = sizeof (a);
+  r_assert_cmpint (r_rsa_raw_decrypt (bad, in, sizeof (in), a, &size), ==, R_CRYPTO_DECRYPT_FAILED);
+
+  r_mpint_clear (&n); r_mpint_clear (&e); r_mpint_clear (&d);
+  r_mpint_clear (&p); r_mpint_clear (&q);
+  r_mpint_clear (&dp); r_mpint_clear (&dq); r_mpint_clear (&qp);
+  r_crypto_key_unref (bad);
+  r_crypto_key_unref (full);
+  r_crypto_key_unref (plain);
+  r_crypto_key_unref (key);
+  r_prng_unref (prng);
+}
+RTEST_END;
+
 RTEST (rrsa, sign_FIPS_186_3_SHA256, RTEST_SLOW)
 {
   rmpint n, e, d;
@@ -398,3 +398,68 @@ RTEST (rsocket, sendmsg_recvmsg, RTEST_FAST | RTEST_SYSTEM)
 }
 RTEST_END;
 
+
+RTEST (rsocket, sendmmsg_recvmmsg, RTEST_FAST | RTEST_SYSTEM)
+{
+  RSocket * sock1, * sock2;
+  RSocketAddress * addr1, * addr2;
+  RSocketAddress * dst[4], * src[4];
+  RBuffer * txbufs[4], * rxbufs[4];
+  rsize sizes[4];
+  ruint8 txbuf[4][128];
+  ruint i, msgs = 0;
+
+  r_assert_cmpptr ((sock1 = r_socket_new (R_SOCKET_FAMILY_IPV4,
+          R_SOCKET_TYPE_DATAGRAM, R_SOCKET_PROTOCOL_UDP)), !=, NULL);
+  r_assert_cmpptr ((sock2 = r_socket_new (R_SOCKET_FAMILY_IPV4,
+          R_SOCKET_TYPE_DATAGRAM, R_SOCKET_PROTOCOL_UDP)), !=, NULL);
+
+  r_assert_cmpptr ((addr1 = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x4242)), !=, NULL);
+  r_assert_cmpptr ((addr2 = r_socket_address_ipv4_new_uint8 (127, 0, 0, 1, 0x2222)), !=, NULL);
+  r_assert_cmpint (r_socket_bind (sock1, addr1, TRUE), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_socket_bind (sock2, addr2, TRUE), ==, R_SOCKET_OK);
+
+  r_assert_cmpint (r_socket_receive_messages (sock2, NULL, NULL, NULL, 4, &msgs), ==, R_SOCKET_INVAL);
+
+  for (i = 0; i < R_N_ELEMENTS (txbufs); i++) {
+    r_memset (txbuf[i], 0x10 + i, sizeof (txbuf[i]));
+    r_assert_cmpptr ((txbufs[i] = r_buffer_new_dup (txbuf[i], 32 * (i + 1))), !=, NULL);
+    r_assert_cmpptr ((rxbufs[i] = r_buffer_new_alloc (NULL, 1024, NULL)), !=, NULL);
+    r_assert_cmpptr ((src[i] = r_socket_address_new ()), !=, NULL);
+    dst[i] = addr2;
+  }
+
+  /* Nothing to receive yet */
+  r_assert_cmpint (r_socket_receive_messages (sock2, src, rxbufs, sizes, 4, &msgs), ==, R_SOCKET_WOULD_BLOCK);
+  r_assert_cmpuint (msgs, ==, 0);
+
+  r_assert_cmpint (r_socket_send_messages (sock1, dst, txbufs, sizes, 4, &msgs), ==, R_SOCKET_OK);
+  r_assert_cmpuint (msgs, ==, 4);
+  for (i = 0; i < R_N_ELEMENTS (txbufs); i++)
+    r_assert_cmpuint (sizes[i], ==, 32 * (i + 1));
+
+  r_assert (r_socket_set_blocking (sock2, TRUE));
+  for (i = 0; i < R_N_ELEMENTS (rxbufs); i += msgs) {
+    r_assert_cmpint (r_socket_receive_messages (sock2, &src[i], &rxbufs[i], &sizes[i],
+          R_N_ELEMENTS (rxbufs) - i, &msgs), ==, R_SOCKET_OK);
+    r_assert_cmpuint (msgs, >, 0);
+  }
+
+  for (i = 0; i < R_N_ELEMENTS (rxbufs); i++) {
+    r_assert_cmpuint (sizes[i], ==, 32 * (i + 1));
+    r_assert_cmpuint (r_buffer_get_size (rxbufs[i]), ==, sizes[i]);
+    r_assert_cmpbufmem (rxbufs[i], 0, -1, ==, txbuf[i], sizes[i]);
+    r_assert (r_socket_address_is_equal (src[i], addr1));
+    r_buffer_unref (txbufs[i]);
+    r_buffer_unref (rxbufs[i]);
+    r_socket_address_unref (src[i]);
+  }
+
+  r_assert_cmpint (r_socket_close (sock1), ==, R_SOCKET_OK);
+  r_assert_cmpint (r_socket_close (sock2), ==, R_SOCKET_OK);
+  r_socket_unref (sock1);
+  r_socket_unref (sock2);
+  r_socket_address_unref (addr1);
+  r_socket_address_unref (addr2);
+}
+RTEST_END;
@@ -1,4 +1,5 @@
 #include <rlib/rnet.h>
+#include <rlib/rcrypto.h>
 
 /* SRTP-AES-128-CM-HMAC-SHA1-80 */
 /* a=ssrc:3027665466 cname:ceiNLmy6VHSE5Ja7 */
@@ -131,6 +132,342 @@ RTEST (rsrtp, encrypt_aes_128_cm, RTEST_FAST)
 }
 RTEST_END;
 
+static RBuffer *
+rtp_buffer_with_tailroom (const ruint8 * data, rsize size, rsize tailroom)
+{
+  RBuffer * ret;
+
+  r_assert_cmpptr ((ret = r_buffer_new_alloc (NULL, size + tailroom, NULL)), !=, NULL);
+  r_assert_cmpuint (r_buffer_fill (ret, 0, data, size), ==, size);
+  r_assert (r_buffer_set_size (ret, size));
+  return ret;
+}
+
+RTEST (rsrtp, encrypt_inplace, RTEST_FAST)
+{
+  RSRTPCtx * ctx;
+  RBuffer * buf;
+
+  r_assert_cmpptr ((ctx = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_for_ssrc (ctx, ssrc,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+
+  /* No tailroom for the auth tag, must leave stream state untouched */
+  r_assert_cmpptr ((buf = r_buffer_new_dup (pkt_rtp_opus, sizeof (pkt_rtp_opus))), !=, NULL);
+  r_assert_cmpint (r_srtp_encrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_NOT_WRITABLE);
+  r_assert_cmpbufmem (buf, 0, -1, ==, pkt_rtp_opus, sizeof (pkt_rtp_opus));
+  r_buffer_unref (buf);
+
+  buf = rtp_buffer_with_tailroom (pkt_rtp_opus, sizeof (pkt_rtp_opus), 10);
+  r_assert_cmpint (r_srtp_encrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpbufmem (buf, 0, -1, ==, pkt_srtp_aes_128_cm_opus, sizeof (pkt_srtp_aes_128_cm_opus));
+  r_buffer_unref (buf);
+
+  buf = rtp_buffer_with_tailroom (pkt_rtp_opus, sizeof (pkt_rtp_opus), 10);
+  r_assert_cmpint (r_srtp_encrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_REPLAYED);
+  r_buffer_unref (buf);
+
+  r_srtp_ctx_unref (ctx);
+}
+RTEST_END;
+
+RTEST (rsrtp, encrypt_inplace_not_writable_keeps_direction, RTEST_FAST)
+{
+  RSRTPCtx * ctx;
+  RBuffer * buf;
+
+  r_assert_cmpptr ((ctx = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_for_ssrc (ctx, ssrc,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+
+  /* A failed encrypt doesn't make the stream outbound */
+  r_assert_cmpptr ((buf = r_buffer_new_dup (pkt_rtp_opus, sizeof (pkt_rtp_opus))), !=, NULL);
+  r_assert_cmpint (r_srtp_encrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_NOT_WRITABLE);
+  r_buffer_unref (buf);
+
+  buf = rtp_buffer_with_tailroom (pkt_srtp_aes_128_cm_opus, sizeof (pkt_srtp_aes_128_cm_opus), 0);
+  r_assert_cmpint (r_srtp_decrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpbufmem (buf, 0, -1, ==, pkt_rtp_opus, sizeof (pkt_rtp_opus));
+  r_buffer_unref (buf);
+
+  /* Now it is inbound */
+  buf = rtp_buffer_with_tailroom (pkt_rtp_opus, sizeof (pkt_rtp_opus), 10);
+  r_assert_cmpint (r_srtp_encrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_WRONG_DIRECTION);
+  r_buffer_unref (buf);
+
+  r_srtp_ctx_unref (ctx);
+}
+RTEST_END;
+
+RTEST (rsrtp, decrypt_inplace, RTEST_FAST)
+{
+  RSRTPCtx * ctx;
+  RBuffer * buf, * view;
+
+  r_assert_cmpptr ((ctx = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_for_ssrc (ctx, ssrc,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+
+  /* Corrupt auth tag, must not mark the packet as received */
+  buf = rtp_buffer_with_tailroom (pkt_srtp_aes_128_cm_opus, sizeof (pkt_srtp_aes_128_cm_opus), 0);
+  r_assert_cmpuint (r_buffer_memset (buf, sizeof (pkt_srtp_aes_128_cm_opus) - 1, 0, 1), ==, 1);
+  r_assert_cmpint (r_srtp_decrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_AUTH);
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr ((buf = r_buffer_new_dup (pkt_srtp_aes_128_cm_opus, sizeof (pkt_srtp_aes_128_cm_opus))), !=, NULL);
+
+  /* Views are readonly */
+  r_assert_cmpptr ((view = r_buffer_view (buf, 0, -1)), !=, NULL);
+  r_assert_cmpint (r_srtp_decrypt_rtp_inplace (ctx, view), ==, R_SRTP_ERROR_NOT_WRITABLE);
+  r_buffer_unref (view);
+
+  r_assert_cmpint (r_srtp_decrypt_rtp_inplace (ctx, buf), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpbufmem (buf, 0, -1, ==, pkt_rtp_opus, sizeof (pkt_rtp_opus));
+  r_buffer_unref (buf);
+
+  r_srtp_ctx_unref (ctx);
+}
+RTEST_END;
+
+#define BATCH_PACKETS   16
+RTEST (rsrtp, batch, RTEST_FAST)
+{
+  RSRTPCtx * enc, * dec, * ref;
+  RBuffer * bufs[BATCH_PACKETS];
+  RSRTPError errs[BATCH_PACKETS];
+  ruint8 pkt[sizeof (pkt_rtp_opus)];
+  ruint i;
+
+  r_assert_cmpptr ((enc = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpptr ((dec = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpptr ((ref = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_with_filter (enc, R_SRTP_FILTER_ANY,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpint (r_srtp_add_crypto_context_with_filter (dec, R_SRTP_FILTER_ANY,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpint (r_srtp_add_crypto_context_with_filter (ref, R_SRTP_FILTER_ANY,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+
+  /* Runs of 4 packets per SSRC, with increasing sequence numbers */
+  r_memcpy (pkt, pkt_rtp_opus, sizeof (pkt));
+  for (i = 0; i < BATCH_PACKETS; i++) {
+    pkt[3] = (ruint8)i;
+    pkt[11] = (ruint8)(i / 4);
+    bufs[i] = rtp_buffer_with_tailroom (pkt, sizeof (pkt), 32);
+  }
+
+  r_assert_cmpuint (r_srtp_encrypt_rtp_batch (enc, bufs, BATCH_PACKETS, errs), ==, BATCH_PACKETS);
+  for (i = 0; i < BATCH_PACKETS; i++) {
+    RBuffer * buf, * res;
+    RSRTPError err;
+
+    r_assert_cmpint (errs[i], ==, R_SRTP_ERROR_OK);
+    pkt[3] = (ruint8)i;
+    pkt[11] = (ruint8)(i / 4);
+    r_assert_cmpptr ((buf = r_buffer_new_dup (pkt, sizeof (pkt))), !=, NULL);
+    r_assert_cmpptr ((res = r_srtp_encrypt_rtp (ref, buf, &err)), !=, NULL);
+    r_assert_cmpint (r_buffer_cmp (res, 0, bufs[i], 0, r_buffer_get_size (res)), ==, 0);
+    r_buffer_unref (res);
+    r_buffer_unref (buf);
+  }
+
+  /* Encrypting again is a replay for every packet */
+  r_assert_cmpuint (r_srtp_encrypt_rtp_batch (enc, bufs, BATCH_PACKETS, errs), ==, 0);
+  r_assert_cmpint (errs[0], ==, R_SRTP_ERROR_REPLAYED);
+
+  r_assert_cmpuint (r_srtp_decrypt_rtp_batch (dec, bufs, BATCH_PACKETS, NULL), ==, BATCH_PACKETS);
+  for (i = 0; i < BATCH_PACKETS; i++) {
+    pkt[3] = (ruint8)i;
+    pkt[11] = (ruint8)(i / 4);
+    r_assert_cmpbufmem (bufs[i], 0, -1, ==, pkt, sizeof (pkt));
+    r_buffer_unref (bufs[i]);
+  }
+
+  r_srtp_ctx_unref (ref);
+  r_srtp_ctx_unref (dec);
+  r_srtp_ctx_unref (enc);
+}
+RTEST_END;
+
+#define BATCH_AUTH_PACKETS  20
+RTEST (rsrtp, batch_auth_failures, RTEST_FAST)
+{
+  RSRTPCtx * enc, * dec;
+  RBuffer * bufs[BATCH_AUTH_PACKETS];
+  RSRTPError errs[BATCH_AUTH_PACKETS];
+  ruint8 pkt[sizeof (pkt_rtp_opus)];
+  ruint8 tampered[sizeof (pkt_srtp_aes_128_cm_opus)];
+  ruint i;
+
+  r_assert_cmpptr ((enc = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpptr ((dec = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_for_ssrc (enc, ssrc,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpint (r_srtp_add_crypto_context_for_ssrc (dec, ssrc,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, masterkey), ==, R_SRTP_ERROR_OK);
+
+  r_memcpy (pkt, pkt_rtp_opus, sizeof (pkt));
+  for (i = 0; i < BATCH_AUTH_PACKETS; i++) {
+    pkt[3] = (ruint8)i;
+    bufs[i] = rtp_buffer_with_tailroom (pkt, sizeof (pkt), 32);
+  }
+  r_assert_cmpuint (r_srtp_encrypt_rtp_batch (enc, bufs, BATCH_AUTH_PACKETS, errs),
+      ==, BATCH_AUTH_PACKETS);
+
+  /* A bad tag and the same packet twice, on both sides of a flush */
+  r_assert_cmpuint (r_buffer_memset (bufs[3], sizeof (tampered) - 1, 0, 1), ==, 1);
+  r_assert_cmpuint (r_buffer_extract (bufs[3], 0, tampered, sizeof (tampered)), ==, sizeof (tampered));
+  for (i = 7; i < BATCH_AUTH_PACKETS; i += 10) {
+    ruint8 srtp[sizeof (pkt_srtp_aes_128_cm_opus)];
+    r_assert_cmpuint (r_buffer_extract (bufs[i - 1], 0, srtp, sizeof (srtp)), ==, sizeof (srtp));
+    r_buffer_unref (bufs[i]);
+    bufs[i] = rtp_buffer_with_tailroom (srtp, sizeof (srtp), 0);
+  }
+
+  r_assert_cmpuint (r_srtp_decrypt_rtp_batch (dec, bufs, BATCH_AUTH_PACKETS, errs),
+      ==, BATCH_AUTH_PACKETS - 3);
+  for (i = 0; i < BATCH_AUTH_PACKETS; i++) {
+    if (i == 3) {
+      r_assert_cmpint (errs[i], ==, R_SRTP_ERROR_AUTH);
+      r_assert_cmpbufmem (bufs[i], 0, -1, ==, tampered, sizeof (tampered));
+    } else if (i == 7 || i == 17) {
+      r_assert_cmpint (errs[i], ==, R_SRTP_ERROR_REPLAYED);
+    } else {
+      r_assert_cmpint (errs[i], ==, R_SRTP_ERROR_OK);
+      pkt[3] = (ruint8)i;
+      r_assert_cmpbufmem (bufs[i], 0, -1, ==, pkt, sizeof (pkt));
+    }
+    r_buffer_unref (bufs[i]);
+  }
+
+  r_srtp_ctx_unref (dec);
+  r_srtp_ctx_unref (enc);
+}
+RTEST_END;
+
+/* RFC 7714 section 16 and 17, session key || session salt */
+static const ruint8 rfc7714_key[] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+  0x51, 0x75, 0x69, 0x64, 0x20, 0x70, 0x72, 0x6f, 0x20, 0x71, 0x75, 0x6f
+};
+static const ruint8 rfc7714_rtp[] = {
+  0x80, 0x40, 0xf1, 0x7b, 0x80, 0x41, 0xf8, 0xd3, 0x55, 0x01, 0xa0, 0xb2, 0x47, 0x61, 0x6c, 0x6c,
+  0x69, 0x61, 0x20, 0x65, 0x73, 0x74, 0x20, 0x6f, 0x6d, 0x6e, 0x69, 0x73, 0x20, 0x64, 0x69, 0x76,
+  0x69, 0x73, 0x61, 0x20, 0x69, 0x6e, 0x20, 0x70, 0x61, 0x72, 0x74, 0x65, 0x73, 0x20, 0x74, 0x72,
+  0x65, 0x73
+};
+/* Section 16.1.1 */
+static const ruint8 rfc7714_srtp_aes_128_gcm[] = {
+  0x80, 0x40, 0xf1, 0x7b, 0x80, 0x41, 0xf8, 0xd3, 0x55, 0x01, 0xa0, 0xb2, 0xf2, 0x4d, 0xe3, 0xa3,
+  0xfb, 0x34, 0xde, 0x6c, 0xac, 0xba, 0x86, 0x1c, 0x9d, 0x7e, 0x4b, 0xca, 0xbe, 0x63, 0x3b, 0xd5,
+  0x0d, 0x29, 0x4e, 0x6f, 0x42, 0xa5, 0xf4, 0x7a, 0x51, 0xc7, 0xd1, 0x9b, 0x36, 0xde, 0x3a, 0xdf,
+  0x88, 0x33, 0x89, 0x9d, 0x7f, 0x27, 0xbe, 0xb1, 0x6a, 0x91, 0x52, 0xcf, 0x76, 0x5e, 0xe4, 0x39,
+  0x0c, 0xce
+};
+static const ruint8 rfc7714_rtcp[] = {
+  0x81, 0xc8, 0x00, 0x0d, 0x4d, 0x61, 0x72, 0x73, 0x4e, 0x54, 0x50, 0x31, 0x4e, 0x54, 0x50, 0x32,
+  0x52, 0x54, 0x50, 0x20, 0x00, 0x00, 0x04, 0x2a, 0x00, 0x00, 0xe9, 0x30, 0x4c, 0x75, 0x6e, 0x61,
+  0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef, 0xde, 0xad, 0xbe, 0xef,
+  0xde, 0xad, 0xbe, 0xef
+};
+/* Section 17.1.1, SRTCP index 0x5d4 */
+static const ruint8 rfc7714_srtcp_aes_128_gcm[] = {
+  0x81, 0xc8, 0x00, 0x0d, 0x4d, 0x61, 0x72, 0x73, 0x63, 0xe9, 0x48, 0x85, 0xdc, 0xda, 0xb6, 0x7c,
+  0xa7, 0x27, 0xd7, 0x66, 0x2f, 0x6b, 0x7e, 0x99, 0x7f, 0xf5, 0xc0, 0xf7, 0x6c, 0x06, 0xf3, 0x2d,
+  0xc6, 0x76, 0xa5, 0xf1, 0x73, 0x0d, 0x6f, 0xda, 0x4c, 0xe0, 0x9b, 0x46, 0x86, 0x30, 0x3d, 0xed,
+  0x0b, 0xb9, 0x27, 0x5b, 0xc8, 0x4a, 0xa4, 0x58, 0x96, 0xcf, 0x4d, 0x2f, 0xc5, 0xab, 0xf8, 0x72,
+  0x45, 0xd9, 0xea, 0xde, 0x80, 0x00, 0x05, 0xd4
+};
+
+RTEST (rsrtp, aead_aes_128_gcm, RTEST_FAST)
+{
+  RSRTPCtx * enc, * dec;
+  RBuffer * buf, * res, * out;
+  RSRTPError err;
+
+  r_assert_cmpptr ((enc = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpptr ((dec = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_session_key_for_ssrc (enc, 0x5501a0b2,
+        R_SRTP_CS_AES_128_CM_HMAC_SHA1_80, rfc7714_key), ==, R_SRTP_ERROR_INVAL);
+  r_assert_cmpint (r_srtp_add_session_key_for_ssrc (enc, 0x5501a0b2,
+        R_SRTP_CS_AEAD_AES_128_GCM, rfc7714_key), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpint (r_srtp_add_session_key_for_ssrc (dec, 0x5501a0b2,
+        R_SRTP_CS_AEAD_AES_128_GCM, rfc7714_key), ==, R_SRTP_ERROR_OK);
+
+  r_assert_cmpptr ((buf = r_buffer_new_dup (rfc7714_rtp, sizeof (rfc7714_rtp))), !=, NULL);
+  r_assert_cmpptr ((out = r_srtp_encrypt_rtp (enc, buf, &err)), !=, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_OK);
+  r_assert_cmpbufmem (out, 0, -1, ==, rfc7714_srtp_aes_128_gcm, sizeof (rfc7714_srtp_aes_128_gcm));
+  r_buffer_unref (buf);
+
+  /* Flipped AAD bit (marker) must fail authentication */
+  r_assert_cmpptr ((buf = r_buffer_new_dup (rfc7714_srtp_aes_128_gcm,
+          sizeof (rfc7714_srtp_aes_128_gcm))), !=, NULL);
+  r_assert_cmpuint (r_buffer_memset (buf, 1, 0xc0, 1), ==, 1);
+  r_assert_cmpptr ((res = r_srtp_decrypt_rtp (dec, buf, &err)), ==, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_AUTH);
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr ((res = r_srtp_decrypt_rtp (dec, out, &err)), !=, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_OK);
+  r_assert_cmpbufmem (res, 0, -1, ==, rfc7714_rtp, sizeof (rfc7714_rtp));
+  r_buffer_unref (res);
+  r_buffer_unref (out);
+
+  r_srtp_ctx_unref (dec);
+  r_srtp_ctx_unref (enc);
+}
+RTEST_END;
+
+RTEST (rsrtp, aead_aes_256_gcm_inplace, RTEST_FAST)
+{
+  static const ruint8 key256[44] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f,
+    0xa0, 0xa1, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xab
+  };
+  RSRTPCtx * enc, * dec;
+  RBuffer * bufs[BATCH_PACKETS];
+  ruint8 pkt[sizeof (pkt_rtp_opus)];
+  ruint i;
+
+  r_assert_cmpptr ((enc = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpptr ((dec = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_with_filter (enc, R_SRTP_FILTER_ANY,
+        R_SRTP_CS_AEAD_AES_256_GCM, key256), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpint (r_srtp_add_crypto_context_with_filter (dec, R_SRTP_FILTER_ANY,
+        R_SRTP_CS_AEAD_AES_256_GCM, key256), ==, R_SRTP_ERROR_OK);
+
+  /* Tag of 16 bytes needs tailroom */
+  r_memcpy (pkt, pkt_rtp_opus, sizeof (pkt));
+  bufs[0] = rtp_buffer_with_tailroom (pkt, sizeof (pkt), 10);
+  r_assert_cmpint (r_srtp_encrypt_rtp_inplace (enc, bufs[0]), ==, R_SRTP_ERROR_NOT_WRITABLE);
+  r_buffer_unref (bufs[0]);
+
+  for (i = 0; i < BATCH_PACKETS; i++) {
+    pkt[3] = (ruint8)i;
+    bufs[i] = rtp_buffer_with_tailroom (pkt, sizeof (pkt), R_AES_GCM_TAG_BYTES);
+  }
+
+  r_assert_cmpuint (r_srtp_encrypt_rtp_batch (enc, bufs, BATCH_PACKETS, NULL), ==, BATCH_PACKETS);
+  r_assert_cmpuint (r_buffer_get_size (bufs[0]), ==, sizeof (pkt) + R_AES_GCM_TAG_BYTES);
+
+  /* Corrupt the tag of the last packet */
+  r_assert_cmpuint (r_buffer_memset (bufs[BATCH_PACKETS - 1],
+        sizeof (pkt) + R_AES_GCM_TAG_BYTES - 1, 0, 1), ==, 1);
+  r_assert_cmpuint (r_srtp_decrypt_rtp_batch (dec, bufs, BATCH_PACKETS, NULL), ==, BATCH_PACKETS - 1);
+  for (i = 0; i < BATCH_PACKETS - 1; i++) {
+    pkt[3] = (ruint8)i;
+    r_assert_cmpbufmem (bufs[i], 0, -1, ==, pkt, sizeof (pkt));
+  }
+  for (i = 0; i < BATCH_PACKETS; i++)
+    r_buffer_unref (bufs[i]);
+
+  r_srtp_ctx_unref (dec);
+  r_srtp_ctx_unref (enc);
+}
+RTEST_END;
+
 RTEST (rsrtcp, decrypt_aes_128_cm, RTEST_FAST)
 {
   RSRTPCtx * ctx;
@@ -211,3 +548,82 @@ RTEST (rsrtcp, encrypt_aes_128_cm, RTEST_FAST)
 }
 RTEST_END;
 
+RTEST (rsrtcp, aead_aes_128_gcm, RTEST_FAST)
+{
+  RSRTPCtx * enc, * dec;
+  RBuffer * buf, * res;
+  RSRTPError err;
+  rsize size;
+
+  r_assert_cmpptr ((enc = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpptr ((dec = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_crypto_context_for_ssrc (enc, ssrc,
+        R_SRTP_CS_AEAD_AES_128_GCM, masterkey), ==, R_SRTP_ERROR_OK);
+  r_assert_cmpint (r_srtp_add_crypto_context_for_ssrc (dec, ssrc,
+        R_SRTP_CS_AEAD_AES_128_GCM, masterkey), ==, R_SRTP_ERROR_OK);
+
+  r_assert_cmpptr ((buf = r_buffer_new_dup (pkt_rtcp_sr_sdes, sizeof (pkt_rtcp_sr_sdes))), !=, NULL);
+  r_assert_cmpptr ((res = r_srtp_encrypt_rtcp (enc, buf, &err)), !=, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_OK);
+  r_buffer_unref (buf);
+
+  /* header || ciphertext || tag || E flag and SRTCP index */
+  size = sizeof (pkt_rtcp_sr_sdes) + R_AES_GCM_TAG_BYTES + sizeof (ruint32);
+  r_assert_cmpuint (r_buffer_get_size (res), ==, size);
+  r_assert_cmpbufmem (res, 0, 8, ==, pkt_rtcp_sr_sdes, 8);
+  r_assert_cmpbufmem (res, size - 4, 4, ==, "\x80\x00\x00\x01", 4);
+
+  /* Clearing the E flag is caught, as is a tampered index */
+  r_assert_cmpptr ((buf = r_buffer_copy (res, 0, -1)), !=, NULL);
+  r_assert_cmpuint (r_buffer_memset (buf, size - 4, 0x00, 1), ==, 1);
+  r_assert_cmpptr (r_srtp_decrypt_rtcp (dec, buf, &err), ==, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_E_BIT_MISMATCH);
+  r_assert_cmpuint (r_buffer_memset (buf, size - 4, 0x80, 1), ==, 1);
+  r_assert_cmpuint (r_buffer_memset (buf, size - 1, 0x02, 1), ==, 1);
+  r_assert_cmpptr (r_srtp_decrypt_rtcp (dec, buf, &err), ==, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_AUTH);
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr ((buf = r_srtp_decrypt_rtcp (dec, res, &err)), !=, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_OK);
+  r_assert_cmpbufmem (buf, 0, -1, ==, pkt_rtcp_sr_sdes, sizeof (pkt_rtcp_sr_sdes));
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr (r_srtp_decrypt_rtcp (dec, res, &err), ==, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_REPLAYED);
+  r_buffer_unref (res);
+
+  r_srtp_ctx_unref (dec);
+  r_srtp_ctx_unref (enc);
+}
+RTEST_END;
+
+RTEST (rsrtcp, aead_aes_128_gcm_rfc7714, RTEST_FAST)
+{
+  RSRTPCtx * dec;
+  RBuffer * buf, * res;
+  RSRTPError err;
+
+  r_assert_cmpptr ((dec = r_srtp_ctx_new ()), !=, NULL);
+  r_assert_cmpint (r_srtp_add_session_key_for_ssrc (dec, 0x4d617273,
+        R_SRTP_CS_AEAD_AES_128_GCM, rfc7714_key), ==, R_SRTP_ERROR_OK);
+
+  /* The SRTCP index is part of the AAD */
+  r_assert_cmpptr ((buf = r_buffer_new_dup (rfc7714_srtcp_aes_128_gcm,
+          sizeof (rfc7714_srtcp_aes_128_gcm))), !=, NULL);
+  r_assert_cmpuint (r_buffer_memset (buf, sizeof (rfc7714_srtcp_aes_128_gcm) - 1, 0xd0, 1), ==, 1);
+  r_assert_cmpptr (r_srtp_decrypt_rtcp (dec, buf, &err), ==, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_AUTH);
+  r_buffer_unref (buf);
+
+  r_assert_cmpptr ((buf = r_buffer_new_dup (rfc7714_srtcp_aes_128_gcm,
+          sizeof (rfc7714_srtcp_aes_128_gcm))), !=, NULL);
+  r_assert_cmpptr ((res = r_srtp_decrypt_rtcp (dec, buf, &err)), !=, NULL);
+  r_assert_cmpint (err, ==, R_SRTP_ERROR_OK);
+  r_assert_cmpbufmem (res, 0, -1, ==, rfc7714_rtcp, sizeof (rfc7714_rtcp));
+  r_buffer_unref (res);
+  r_buffer_unref (buf);
+
+  r_srtp_ctx_unref (dec);
+}
+RTEST_END;
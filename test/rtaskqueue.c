@@ -339,3 +339,301 @@ RTEST (rtaskqueue, pin_on_each_cpu, RTEST_FAST)
 }
 RTEST_END;
 
+
+RTEST (rtaskqueue, work_stealing, RTEST_FAST)
+{
+  RTaskQueue * tq;
+  rauint counter;
+  RTask * t[3];
+
+  r_assert_cmpptr (r_task_queue_new_full (0, 1, R_TASK_QUEUE_FLAG_WORK_STEALING), ==, NULL);
+  r_assert_cmpptr ((tq = r_task_queue_new_full (2, 2, R_TASK_QUEUE_FLAG_WORK_STEALING)), !=, NULL);
+  r_assert_cmpuint (r_task_queue_group_count (tq), ==, 2);
+  r_assert_cmpuint (r_task_queue_thread_count (tq), ==, 4);
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((t[0] = r_task_queue_add (tq, simple_adder, &counter, NULL)), !=, NULL);
+  r_assert (r_task_wait (t[0]));
+  r_assert_cmpuint (r_atomic_uint_load (&counter), ==, 1);
+  r_task_unref (t[0]);
+
+  /* Tasks added from tasks go to the local deque, others steal them */
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((t[0] = r_task_queue_add (tq, chain_adder, &counter, NULL)), !=, NULL);
+  r_assert_cmpptr ((t[1] = r_task_queue_add_full (tq, 1, chain_adder, &counter, NULL, NULL)), !=, NULL);
+  r_assert_cmpptr ((t[2] = r_task_queue_add_full (tq, 1, chain_adder, &counter, NULL, t[0], NULL)), !=, NULL);
+  r_assert_cmpptr (r_task_queue_add_full (tq, 2, simple_adder, &counter, NULL, NULL), ==, NULL);
+  while (r_atomic_uint_load (&counter) < 9)
+    r_thread_yield ();
+
+  r_task_unref (t[0]);
+  r_task_unref (t[1]);
+  r_task_unref (t[2]);
+  r_task_queue_unref (tq);
+}
+RTEST_END;
+
+static void
+spawn_adder (rpointer data, RTaskQueue * tq, RTask * task)
+{
+  RTQTestCtx * ctx = data;
+  ruint i;
+
+  (void) task;
+
+  if (r_atomic_uint_fetch_sub (&ctx->it, 1) > 1) {
+    for (i = 0; i < 2; i++)
+      r_task_unref (r_task_queue_add (tq, spawn_adder, ctx, NULL));
+  }
+  r_atomic_uint_fetch_add (ctx->counter, 1);
+}
+
+RTEST (rtaskqueue, work_stealing_spawn, RTEST_FAST)
+{
+  RTaskQueue * tq;
+  rauint counter;
+  RTQTestCtx ctx = { &counter, 2000 };
+  RTask * t;
+  ruint i;
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((tq = r_task_queue_new_full (1, 4, R_TASK_QUEUE_FLAG_WORK_STEALING)), !=, NULL);
+
+  /* Spawns two for each of the first 1999, more than a deque holds */
+  r_assert_cmpptr ((t = r_task_queue_add (tq, spawn_adder, &ctx, NULL)), !=, NULL);
+  while (r_atomic_uint_load (&counter) < 2 * 1999 + 1)
+    r_thread_yield ();
+  r_task_unref (t);
+
+  for (i = 0; i < 1000; i++)
+    r_task_unref (r_task_queue_add (tq, simple_adder, &counter, NULL));
+  while (r_atomic_uint_load (&counter) < 2 * 1999 + 1 + 1000)
+    r_thread_yield ();
+
+  r_task_queue_unref (tq);
+}
+RTEST_END;
+
+RTEST (rtaskqueue, work_stealing_dep_cancel, RTEST_FAST)
+{
+  RTaskQueue * tq;
+  rauint counter;
+  RTask * t[3];
+  RTQTestCtx ctx[3] = {
+    { &counter, 4 },
+    { &counter, 10 },
+    { &counter, 6 },
+  };
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((tq = r_task_queue_new_full (1, 4, R_TASK_QUEUE_FLAG_WORK_STEALING)), !=, NULL);
+
+  r_assert_cmpptr ((t[0] = r_task_queue_add_full (tq, 0, chain_ctx, &ctx[0], NULL, NULL)), !=, NULL);
+  r_assert_cmpptr ((t[1] = r_task_queue_add_full (tq, 0, chain_ctx, &ctx[1], NULL, t[0], NULL)), !=, NULL);
+  r_assert_cmpptr ((t[2] = r_task_queue_add_full (tq, 0, chain_ctx, &ctx[2], NULL, t[1], NULL)), !=, NULL);
+  while (r_atomic_uint_load (&counter) < 20)
+    r_thread_yield ();
+  r_task_unref (t[0]);
+  r_task_unref (t[1]);
+  r_task_unref (t[2]);
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((t[0] = r_task_queue_add (tq, simple_adder, &counter, NULL)), !=, NULL);
+  r_assert (r_task_cancel (t[0], TRUE));
+  r_assert (r_task_wait (t[0]));
+  r_assert_cmpuint (r_atomic_uint_load (&counter), <=, 1);
+  r_task_unref (t[0]);
+
+  r_task_queue_unref (tq);
+}
+RTEST_END;
+
+RTEST (rtaskqueue, work_stealing_group_numa_node, RTEST_FAST)
+{
+  RTaskQueue * tq;
+  rauint counter;
+  RTask * t;
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((tq = r_task_queue_new_pin_and_group_on_numa_node_full (NULL, 2,
+          R_TASK_QUEUE_FLAG_WORK_STEALING)), !=, NULL);
+  r_assert_cmpuint (r_task_queue_group_count (tq), ==, r_sys_node_count_with_allowed_cpus ());
+  r_assert_cmpuint (r_task_queue_thread_count (tq), ==, r_sys_node_count_with_allowed_cpus () * 2);
+
+  r_assert_cmpptr ((t = r_task_queue_add (tq, simple_adder, &counter, NULL)), !=, NULL);
+  r_assert (r_task_wait (t));
+  r_assert_cmpuint (r_atomic_uint_load (&counter), ==, 1);
+  r_assert_cmpuint (r_task_queue_queued_tasks (tq), ==, 0);
+
+  r_task_unref (t);
+  r_task_queue_unref (tq);
+}
+RTEST_END;
+
+static void
+store_counter (rpointer data, RTaskQueue * tq, RTask * task)
+{
+  RTQTestCtx * ctx = data;
+  (void) tq;
+  (void) task;
+  r_atomic_uint_store (&ctx->it, r_atomic_uint_load (ctx->counter));
+}
+
+static void
+r_test_task_queue_no_head_of_line_blocking (RTaskQueueFlags flags)
+{
+  RTaskQueue * tq;
+  rauint counter;
+  RTask * t[3];
+  RTQWaitCtx wctx;
+
+  r_mutex_init (&wctx.mutex);
+  r_cond_init (&wctx.cond);
+  wctx.func_running = FALSE;
+  wctx.wait = TRUE;
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((tq = r_task_queue_new_full (1, 2, flags)), !=, NULL);
+
+  r_assert_cmpptr ((t[0] = r_task_queue_add (tq, wait_func, &wctx, NULL)), !=, NULL);
+  r_mutex_lock (&wctx.mutex);
+  while (!wctx.func_running)
+    r_cond_wait (&wctx.cond, &wctx.mutex);
+  r_mutex_unlock (&wctx.mutex);
+
+  /* t[1] waits for t[0], which must not hold up t[2] queued after it */
+  r_assert_cmpptr ((t[1] = r_task_queue_add_full (tq, 0, simple_adder, &counter, NULL, t[0], NULL)), !=, NULL);
+  r_assert_cmpptr ((t[2] = r_task_queue_add (tq, simple_adder, &counter, NULL)), !=, NULL);
+  r_assert (r_task_wait (t[2]));
+  r_assert_cmpuint (r_atomic_uint_load (&counter), ==, 1);
+
+  r_mutex_lock (&wctx.mutex);
+  wctx.wait = FALSE;
+  r_cond_signal (&wctx.cond);
+  r_mutex_unlock (&wctx.mutex);
+  r_assert (r_task_wait (t[1]));
+  r_assert_cmpuint (r_atomic_uint_load (&counter), ==, 2);
+
+  r_task_unref (t[0]);
+  r_task_unref (t[1]);
+  r_task_unref (t[2]);
+  r_task_queue_unref (tq);
+
+  r_cond_clear (&wctx.cond);
+  r_mutex_clear (&wctx.mutex);
+}
+
+RTEST (rtaskqueue, no_head_of_line_blocking, RTEST_FAST)
+{
+  r_test_task_queue_no_head_of_line_blocking (R_TASK_QUEUE_FLAG_NONE);
+  r_test_task_queue_no_head_of_line_blocking (R_TASK_QUEUE_FLAG_WORK_STEALING);
+}
+RTEST_END;
+
+static void
+r_test_task_queue_fan_out_fan_in (RTaskQueueFlags flags)
+{
+  RTaskQueue * tq;
+  rauint counter;
+  RTQTestCtx ctx = { &counter, 0 };
+  RTask * root, * sink, * t;
+  ruint i;
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((tq = r_task_queue_new_full (2, 2, flags)), !=, NULL);
+
+  r_assert_cmpptr ((root = r_task_queue_allocate (tq, simple_adder, &counter, NULL)), !=, NULL);
+  r_assert_cmpptr ((sink = r_task_queue_allocate (tq, store_counter, &ctx, NULL)), !=, NULL);
+  r_assert (r_task_queue_add_task (tq, root));
+  for (i = 0; i < 100; i++) {
+    r_assert_cmpptr ((t = r_task_queue_add_full (tq, i % 2, simple_adder, &counter, NULL, root, NULL)), !=, NULL);
+    r_assert (r_task_add_dep (sink, t, NULL));
+    r_task_unref (t);
+  }
+  r_assert (r_task_add_dep (sink, root, NULL));
+  r_assert (r_task_queue_add_task_with_group (tq, sink, 1));
+  r_assert (!r_task_queue_add_task (tq, sink));
+  r_assert (!r_task_add_dep (sink, root, NULL));
+
+  r_assert (r_task_wait (sink));
+  r_assert_cmpuint (r_atomic_uint_load (&ctx.it), ==, 101);
+
+  r_task_unref (root);
+  r_task_unref (sink);
+  r_task_queue_unref (tq);
+}
+
+RTEST (rtaskqueue, fan_out_fan_in, RTEST_FAST)
+{
+  r_test_task_queue_fan_out_fan_in (R_TASK_QUEUE_FLAG_NONE);
+  r_test_task_queue_fan_out_fan_in (R_TASK_QUEUE_FLAG_WORK_STEALING);
+}
+RTEST_END;
+
+static void
+r_test_task_queue_wait_many_any (RTaskQueueFlags flags)
+{
+  RTaskQueue * tq;
+  rauint counter;
+  RTask * t[8];
+  RTQWaitCtx wctx;
+  ruint i;
+
+  r_mutex_init (&wctx.mutex);
+  r_cond_init (&wctx.cond);
+  wctx.func_running = FALSE;
+  wctx.wait = TRUE;
+
+  r_atomic_uint_store (&counter, 0);
+  r_assert_cmpptr ((tq = r_task_queue_new_full (2, 2, flags)), !=, NULL);
+
+  r_assert_cmpint (r_task_wait_any (t, 0), ==, -1);
+  r_assert (r_task_wait_many (t, 0));
+
+  /* t[0] blocks until told otherwise, the rest finish right away */
+  r_assert_cmpptr ((t[0] = r_task_queue_add (tq, wait_func, &wctx, NULL)), !=, NULL);
+  for (i = 1; i < R_N_ELEMENTS (t); i++)
+    r_assert_cmpptr ((t[i] = r_task_queue_add (tq, simple_adder, &counter, NULL)), !=, NULL);
+
+  r_assert_cmpint (r_task_wait_any (t, R_N_ELEMENTS (t)), >, 0);
+  r_assert (r_task_wait_many (t + 1, R_N_ELEMENTS (t) - 1));
+  r_assert_cmpuint (r_atomic_uint_load (&counter), ==, R_N_ELEMENTS (t) - 1);
+  r_assert_cmpint (r_task_wait_any (t, R_N_ELEMENTS (t)), >, 0);
+
+  r_mutex_lock (&wctx.mutex);
+  wctx.wait = FALSE;
+  r_cond_signal (&wctx.cond);
+  r_mutex_unlock (&wctx.mutex);
+  r_assert_cmpint (r_task_wait_any (t, 1), ==, 0);
+  r_assert (r_task_wait_many (t, R_N_ELEMENTS (t)));
+
+  /* Canceled before it runs, waiters are woken all the same */
+  wctx.wait = TRUE;
+  r_task_unref (t[0]);
+  r_task_unref (t[1]);
+  r_assert_cmpptr ((t[0] = r_task_queue_add (tq, wait_func, &wctx, NULL)), !=, NULL);
+  r_assert_cmpptr ((t[1] = r_task_queue_add_full (tq, 0, simple_adder, &counter, NULL, t[0], NULL)), !=, NULL);
+  r_assert (r_task_cancel (t[1], FALSE));
+  r_assert_cmpint (r_task_wait_any (t, 2), ==, 1);
+
+  r_mutex_lock (&wctx.mutex);
+  wctx.wait = FALSE;
+  r_cond_signal (&wctx.cond);
+  r_mutex_unlock (&wctx.mutex);
+  r_assert (r_task_wait_many (t, 2));
+  r_assert_cmpuint (r_atomic_uint_load (&counter), ==, R_N_ELEMENTS (t) - 1);
+
+  for (i = 0; i < R_N_ELEMENTS (t); i++)
+    r_task_unref (t[i]);
+  r_task_queue_unref (tq);
+
+  r_cond_clear (&wctx.cond);
+  r_mutex_clear (&wctx.mutex);
+}
+
+RTEST (rtaskqueue, wait_many_any, RTEST_FAST)
+{
+  r_test_task_queue_wait_many_any (R_TASK_QUEUE_FLAG_NONE);
+  r_test_task_queue_wait_many_any (R_TASK_QUEUE_FLAG_WORK_STEALING);
+}
+RTEST_END;
@@ -288,6 +288,198 @@ RTEST_STRESS (rthread, rwmutex_stress, RTEST_FAST)
 }
 RTEST_END;
 
+typedef struct {
+  RFastMutex mutex;
+  RFastCond cond;
+  RFastRWMutex rwmutex;
+  ruint counter;
+  ruint readers;
+} RThreadsTestFast;
+
+#define RTHREAD_TEST_FAST_ITERATIONS  20000
+
+static rpointer
+rthread_test_fast_mutex_inc (rpointer data)
+{
+  RThreadsTestFast * test_ctx = data;
+  ruint i;
+
+  for (i = 0; i < RTHREAD_TEST_FAST_ITERATIONS; i++) {
+    r_fast_mutex_lock (&test_ctx->mutex);
+    test_ctx->counter++;
+    r_fast_mutex_unlock (&test_ctx->mutex);
+  }
+
+  return NULL;
+}
+
+RTEST (rthread, fast_mutex, RTEST_FAST)
+{
+  RThreadsTestFast test_ctx = { R_FAST_MUTEX_INIT, R_FAST_COND_INIT, R_FAST_RWMUTEX_INIT, 0, 0 };
+  RFastLockStats stats = { 0, 0, 0 };
+  RThread * t[4];
+  ruint i;
+
+  r_assert (r_fast_mutex_trylock (&test_ctx.mutex));
+  r_assert (!r_fast_mutex_trylock (&test_ctx.mutex));
+  r_fast_mutex_unlock (&test_ctx.mutex);
+
+  r_fast_mutex_set_stats (&test_ctx.mutex, &stats);
+  for (i = 0; i < R_N_ELEMENTS (t); i++)
+    t[i] = r_thread_new ("fast_mutex", rthread_test_fast_mutex_inc, &test_ctx);
+  for (i = 0; i < R_N_ELEMENTS (t); i++) {
+    r_thread_join (t[i]);
+    r_thread_unref (t[i]);
+  }
+
+  r_assert_cmpuint (test_ctx.counter, ==, R_N_ELEMENTS (t) * RTHREAD_TEST_FAST_ITERATIONS);
+  r_assert_cmpuint (r_atomic_uint_load (&stats.spun) + r_atomic_uint_load (&stats.parked), ==,
+      r_atomic_uint_load (&stats.contended));
+}
+RTEST_END;
+
+static rpointer
+rthread_test_fast_cond_pong (rpointer data)
+{
+  RThreadsTestFast * test_ctx = data;
+
+  r_fast_mutex_lock (&test_ctx->mutex);
+  while (test_ctx->counter < RTHREAD_TEST_FAST_ITERATIONS) {
+    if (test_ctx->counter % 2 == 1) {
+      test_ctx->counter++;
+      r_fast_cond_signal (&test_ctx->cond);
+    } else {
+      r_fast_cond_wait (&test_ctx->cond, &test_ctx->mutex);
+    }
+  }
+  r_fast_mutex_unlock (&test_ctx->mutex);
+
+  return NULL;
+}
+
+RTEST (rthread, fast_cond, RTEST_FAST)
+{
+  RThreadsTestFast test_ctx = { R_FAST_MUTEX_INIT, R_FAST_COND_INIT, R_FAST_RWMUTEX_INIT, 0, 0 };
+  RThread * t;
+
+  /* Take turns bumping counter, odd numbers are for the other thread */
+  t = r_thread_new ("fast_cond", rthread_test_fast_cond_pong, &test_ctx);
+  r_fast_mutex_lock (&test_ctx.mutex);
+  while (test_ctx.counter < RTHREAD_TEST_FAST_ITERATIONS) {
+    if (test_ctx.counter % 2 == 0) {
+      test_ctx.counter++;
+      r_fast_cond_signal (&test_ctx.cond);
+    } else {
+      r_fast_cond_wait (&test_ctx.cond, &test_ctx.mutex);
+    }
+  }
+  r_fast_cond_broadcast (&test_ctx.cond);
+  r_fast_mutex_unlock (&test_ctx.mutex);
+
+  r_thread_join (t);
+  r_thread_unref (t);
+  r_assert_cmpuint (test_ctx.counter, ==, RTHREAD_TEST_FAST_ITERATIONS);
+}
+RTEST_END;
+
+#if defined (R_OS_LINUX)
+typedef struct {
+  RFastMutex mutex;
+  RFastCond cond;
+  rboolean done;
+  ruint wakeups;
+} RThreadsTestFastPark;
+
+static rpointer
+rthread_test_fast_cond_sleeper (rpointer data)
+{
+  RThreadsTestFastPark * test_ctx = data;
+
+  r_fast_mutex_lock (&test_ctx->mutex);
+  while (!test_ctx->done) {
+    r_fast_cond_wait (&test_ctx->cond, &test_ctx->mutex);
+    test_ctx->wakeups++;
+  }
+  r_fast_mutex_unlock (&test_ctx->mutex);
+
+  return NULL;
+}
+
+/* Linux always has futex, so a waiter has to sleep until signalled. The
+ * yielding fallback would return from r_fast_cond_wait over and over */
+RTEST (rthread, fast_cond_parks, RTEST_FAST)
+{
+  RThreadsTestFastPark test_ctx = { R_FAST_MUTEX_INIT, R_FAST_COND_INIT, FALSE, 0 };
+  RThread * t;
+
+  t = r_thread_new ("fast_cond_parks", rthread_test_fast_cond_sleeper, &test_ctx);
+  r_thread_usleep (50 * 1000);
+
+  r_fast_mutex_lock (&test_ctx.mutex);
+  test_ctx.done = TRUE;
+  r_fast_cond_signal (&test_ctx.cond);
+  r_fast_mutex_unlock (&test_ctx.mutex);
+
+  r_thread_join (t);
+  r_thread_unref (t);
+  r_assert_cmpuint (test_ctx.wakeups, <=, 2);
+}
+RTEST_END;
+#endif
+
+static rpointer
+rthread_test_fast_rwmutex (rpointer data)
+{
+  RThreadsTestFast * test_ctx = data;
+  ruint i;
+
+  for (i = 0; i < RTHREAD_TEST_FAST_ITERATIONS; i++) {
+    if (i % 8 == 0) {
+      r_fast_rwmutex_wrlock (&test_ctx->rwmutex);
+      r_assert_cmpuint (test_ctx->readers, ==, 0);
+      test_ctx->counter++;
+      r_fast_rwmutex_wrunlock (&test_ctx->rwmutex);
+    } else {
+      r_fast_rwmutex_rdlock (&test_ctx->rwmutex);
+      r_atomic_uint_fetch_add ((rauint *)&test_ctx->readers, 1);
+      r_thread_yield ();
+      r_atomic_uint_fetch_sub ((rauint *)&test_ctx->readers, 1);
+      r_fast_rwmutex_rdunlock (&test_ctx->rwmutex);
+    }
+  }
+
+  return NULL;
+}
+
+RTEST (rthread, fast_rwmutex, RTEST_FAST)
+{
+  RThreadsTestFast test_ctx = { R_FAST_MUTEX_INIT, R_FAST_COND_INIT, R_FAST_RWMUTEX_INIT, 0, 0 };
+  RThread * t[4];
+  ruint i;
+
+  r_assert (r_fast_rwmutex_tryrdlock (&test_ctx.rwmutex));
+  r_assert (r_fast_rwmutex_tryrdlock (&test_ctx.rwmutex));
+  r_assert (!r_fast_rwmutex_trywrlock (&test_ctx.rwmutex));
+  r_fast_rwmutex_rdunlock (&test_ctx.rwmutex);
+  r_fast_rwmutex_rdunlock (&test_ctx.rwmutex);
+
+  r_assert (r_fast_rwmutex_trywrlock (&test_ctx.rwmutex));
+  r_assert (!r_fast_rwmutex_tryrdlock (&test_ctx.rwmutex));
+  r_assert (!r_fast_rwmutex_trywrlock (&test_ctx.rwmutex));
+  r_fast_rwmutex_wrunlock (&test_ctx.rwmutex);
+
+  for (i = 0; i < R_N_ELEMENTS (t); i++)
+    t[i] = r_thread_new ("fast_rwmutex", rthread_test_fast_rwmutex, &test_ctx);
+  for (i = 0; i < R_N_ELEMENTS (t); i++) {
+    r_thread_join (t[i]);
+    r_thread_unref (t[i]);
+  }
+
+  r_assert_cmpuint (test_ctx.counter, ==,
+      R_N_ELEMENTS (t) * (RTHREAD_TEST_FAST_ITERATIONS / 8));
+}
+RTEST_END;
+
 #else
 RTEST (rthread, dummy, RTEST_FAST)
 {
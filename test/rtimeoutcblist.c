@@ -177,3 +177,95 @@ RTEST (rtimeoutcblist, cancel, RTEST_FAST)
 }
 RTEST_END;
 
+
+static void
+check_order (rpointer data, rpointer user)
+{
+  RClockTime * last = data;
+  RClockTime ts = RPOINTER_TO_SIZE (user);
+
+  r_assert_cmpuint (ts, >=, *last);
+  *last = ts;
+}
+
+RTEST (rtimeoutcblist, many_random_order, RTEST_FAST)
+{
+  RTimeoutCBList lst = R_TIMEOUT_CBLIST_INIT;
+  RToCB * cancel[64];
+  RPrng * prng;
+  RClockTime last = 0;
+  rsize i;
+
+  r_assert_cmpptr ((prng = r_rand_prng_new ()), !=, NULL);
+
+  for (i = 0; i < 1024; i++) {
+    RClockTime ts = r_prng_get_u64 (prng) % 4096;
+    r_assert (r_timeout_cblist_insert (&lst, i < R_N_ELEMENTS (cancel) ? &cancel[i] : NULL,
+          ts, check_order, &last, NULL, RSIZE_TO_POINTER (ts), NULL));
+  }
+  r_assert_cmpuint (r_timeout_cblist_len (&lst), ==, 1024);
+
+  for (i = 0; i < R_N_ELEMENTS (cancel); i++) {
+    r_assert (r_timeout_cblist_cancel (&lst, cancel[i]));
+    r_to_cb_unref (cancel[i]);
+  }
+  r_assert_cmpuint (r_timeout_cblist_len (&lst), ==, 1024 - R_N_ELEMENTS (cancel));
+
+  r_assert_cmpuint (r_timeout_cblist_update (&lst, 2048), >, 0);
+  r_assert_cmpuint (r_timeout_cblist_first_timeout (&lst), >, 2048);
+  r_assert_cmpuint (r_timeout_cblist_update (&lst, 4096), >, 0);
+  r_assert_cmpuint (r_timeout_cblist_len (&lst), ==, 0);
+  r_assert_cmpuint (r_timeout_cblist_first_timeout (&lst), ==, R_CLOCK_TIME_NONE);
+
+  r_prng_unref (prng);
+  r_timeout_cblist_clear (&lst);
+}
+RTEST_END;
+
+static void
+check_fifo (rpointer data, rpointer user)
+{
+  ruint * next = data;
+
+  r_assert_cmpuint (RPOINTER_TO_UINT (user), ==, *next);
+  (*next)++;
+}
+
+RTEST (rtimeoutcblist, same_timeout_fifo, RTEST_FAST)
+{
+  RTimeoutCBList lst = R_TIMEOUT_CBLIST_INIT;
+  ruint i, next = 0;
+
+  for (i = 0; i < 100; i++) {
+    r_assert (r_timeout_cblist_insert (&lst, NULL, 42,
+          check_fifo, &next, NULL, RUINT_TO_POINTER (i), NULL));
+  }
+
+  r_assert_cmpuint (r_timeout_cblist_update (&lst, 42), ==, 100);
+  r_assert_cmpuint (next, ==, 100);
+
+  r_timeout_cblist_clear (&lst);
+}
+RTEST_END;
+
+RTEST (rtimeoutcblist, reuse_after_update, RTEST_FAST)
+{
+  RTimeoutCBList lst = R_TIMEOUT_CBLIST_INIT;
+  RToCB * held;
+  ruint called = 0;
+
+  r_assert (r_timeout_cblist_insert (&lst, &held, 1, increment_data, &called, NULL, NULL, NULL));
+  r_assert (r_timeout_cblist_insert (&lst, NULL, 2, increment_data, &called, NULL, NULL, NULL));
+  r_assert_cmpuint (r_timeout_cblist_update (&lst, 2), ==, 2);
+  r_assert_cmpuint (called, ==, 2);
+  r_assert (!r_timeout_cblist_cancel (&lst, held));
+
+  r_assert (r_timeout_cblist_insert (&lst, NULL, 3, NULL, NULL, NULL, r_malloc (64), r_free));
+  r_assert (r_timeout_cblist_insert (&lst, NULL, 4, NULL, r_malloc (64), r_free, NULL, NULL));
+  r_assert_cmpuint (r_timeout_cblist_update (&lst, 4), ==, 2);
+  r_assert_cmpuint (r_timeout_cblist_len (&lst), ==, 0);
+
+  r_to_cb_unref (held);
+  r_timeout_cblist_clear (&lst);
+}
+RTEST_END;